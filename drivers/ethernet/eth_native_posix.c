@@ -35,10 +35,13 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #include <zephyr/net/lldp.h>
 
 #include "eth_native_posix_priv.h"
+#include "eth_native_posix_frags.h"
 #include "eth.h"
 
 #define NET_BUF_TIMEOUT K_MSEC(100)
 
+#define ETH_RX_MAX_FRAMES CONFIG_ETH_NATIVE_POSIX_RX_MAX_FRAMES
+
 #if defined(CONFIG_NET_VLAN)
 #define ETH_HDR_LEN sizeof(struct net_eth_vlan_hdr)
 #else
@@ -46,7 +49,8 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #endif
 
 struct eth_context {
-	uint8_t recv[NET_ETH_MTU + ETH_HDR_LEN];
+	uint8_t recv[ETH_RX_MAX_FRAMES][NET_ETH_MTU + ETH_HDR_LEN];
+	size_t recv_len[ETH_RX_MAX_FRAMES];
 	uint8_t send[NET_ETH_MTU + ETH_HDR_LEN];
 	uint8_t mac_addr[6];
 	struct net_linkaddr ll_addr;
@@ -54,6 +58,8 @@ struct eth_context {
 	const char *if_name;
 	k_tid_t rx_thread;
 	struct z_thread_stack_element *rx_stack;
+	/* Serializes the RX thread and the busy pollers over recv[] */
+	struct k_mutex rx_lock;
 	size_t rx_stack_size;
 	int dev_fd;
 	bool init_done;
@@ -181,19 +187,25 @@ static void update_gptp(struct net_if *iface, struct net_pkt *pkt,
 static int eth_send(const struct device *dev, struct net_pkt *pkt)
 {
 	struct eth_context *ctx = dev->data;
+	struct eth_frag frags[ETH_MAX_TX_FRAGS];
 	int count = net_pkt_get_len(pkt);
+	int nfrags;
 	int ret;
 
-	ret = net_pkt_read(pkt, ctx->send, count);
-	if (ret) {
-		return ret;
+	/* Hand the fragments to the host as they are, only a packet with
+	 * more fragments than we can pass at once is copied.
+	 */
+	nfrags = eth_native_posix_pkt_frags(pkt, frags, ctx->send,
+					    sizeof(ctx->send));
+	if (nfrags < 0) {
+		return nfrags;
 	}
 
 	update_gptp(net_pkt_iface(pkt), pkt, true);
 
 	LOG_DBG("Send pkt %p len %d", pkt, count);
 
-	ret = eth_write_data(ctx->dev_fd, ctx->send, count);
+	ret = eth_write_frags(ctx->dev_fd, frags, nfrags);
 	if (ret < 0) {
 		LOG_DBG("Cannot send pkt %p (%d)", pkt, ret);
 	}
@@ -236,9 +248,10 @@ static inline struct net_if *get_iface(struct eth_context *ctx,
 
 #if defined(CONFIG_NET_VLAN)
 static struct net_pkt *prepare_vlan_pkt(struct eth_context *ctx,
-					int count, uint16_t *vlan_tag, int *status)
+					uint8_t *frame, int count,
+					uint16_t *vlan_tag, int *status)
 {
-	struct net_eth_vlan_hdr *hdr = (struct net_eth_vlan_hdr *)ctx->recv;
+	struct net_eth_vlan_hdr *hdr = (struct net_eth_vlan_hdr *)frame;
 	struct net_pkt *pkt;
 	uint8_t pos;
 
@@ -259,7 +272,7 @@ static struct net_pkt *prepare_vlan_pkt(struct eth_context *ctx,
 	pos = 0;
 
 	if (IS_ENABLED(CONFIG_ETH_NATIVE_POSIX_VLAN_TAG_STRIP)) {
-		if (net_pkt_write(pkt, ctx->recv,
+		if (net_pkt_write(pkt, frame,
 				  2 * sizeof(struct net_eth_addr))) {
 			goto error;
 		}
@@ -268,7 +281,7 @@ static struct net_pkt *prepare_vlan_pkt(struct eth_context *ctx,
 		count -= (2 * sizeof(struct net_eth_addr));
 	}
 
-	if (net_pkt_write(pkt, ctx->recv + pos, count)) {
+	if (net_pkt_write(pkt, frame + pos, count)) {
 		goto error;
 	}
 
@@ -295,7 +308,8 @@ error:
 #endif
 
 static struct net_pkt *prepare_non_vlan_pkt(struct eth_context *ctx,
-					    int count, int *status)
+					    uint8_t *frame, int count,
+					    int *status)
 {
 	struct net_pkt *pkt;
 
@@ -306,7 +320,7 @@ static struct net_pkt *prepare_non_vlan_pkt(struct eth_context *ctx,
 		return NULL;
 	}
 
-	if (net_pkt_write(pkt, ctx->recv, count)) {
+	if (net_pkt_write(pkt, frame, count)) {
 		net_pkt_unref(pkt);
 		*status = -ENOBUFS;
 		return NULL;
@@ -319,30 +333,25 @@ static struct net_pkt *prepare_non_vlan_pkt(struct eth_context *ctx,
 	return pkt;
 }
 
-static int read_data(struct eth_context *ctx, int fd)
+static int recv_frame(struct eth_context *ctx, uint8_t *frame, int count)
 {
 	uint16_t vlan_tag = NET_VLAN_TAG_UNSPEC;
 	struct net_if *iface;
 	struct net_pkt *pkt = NULL;
 	int status;
-	int count;
-
-	count = eth_read_data(fd, ctx->recv, sizeof(ctx->recv));
-	if (count <= 0) {
-		return 0;
-	}
 
 #if defined(CONFIG_NET_VLAN)
 	{
-		struct net_eth_hdr *hdr = (struct net_eth_hdr *)(ctx->recv);
+		struct net_eth_hdr *hdr = (struct net_eth_hdr *)frame;
 
 		if (ntohs(hdr->type) == NET_ETH_PTYPE_VLAN) {
-			pkt = prepare_vlan_pkt(ctx, count, &vlan_tag, &status);
+			pkt = prepare_vlan_pkt(ctx, frame, count, &vlan_tag,
+					       &status);
 			if (!pkt) {
 				return status;
 			}
 		} else {
-			pkt = prepare_non_vlan_pkt(ctx, count, &status);
+			pkt = prepare_non_vlan_pkt(ctx, frame, count, &status);
 			if (!pkt) {
 				return status;
 			}
@@ -352,7 +361,7 @@ static int read_data(struct eth_context *ctx, int fd)
 	}
 #else
 	{
-		pkt = prepare_non_vlan_pkt(ctx, count, &status);
+		pkt = prepare_non_vlan_pkt(ctx, frame, count, &status);
 		if (!pkt) {
 			return status;
 		}
@@ -370,16 +379,42 @@ static int read_data(struct eth_context *ctx, int fd)
 	return 0;
 }
 
+/* Returns the number of frames read from the host, at most max_count */
+static int read_data(struct eth_context *ctx, int fd, int max_count)
+{
+	int count, i;
+
+	count = eth_read_frames(fd, ctx->recv, sizeof(ctx->recv[0]),
+			       ctx->recv_len, max_count);
+	if (count <= 0) {
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		(void)recv_frame(ctx, ctx->recv[i], ctx->recv_len[i]);
+	}
+
+	return count;
+}
+
 static void eth_rx(struct eth_context *ctx)
 {
+	int count;
+
 	LOG_DBG("Starting ZETH RX thread");
 
 	while (1) {
 		if (net_if_is_up(ctx->iface)) {
-			while (!eth_wait_data(ctx->dev_fd)) {
-				read_data(ctx, ctx->dev_fd);
-				k_yield();
-			}
+			do {
+				k_mutex_lock(&ctx->rx_lock, K_FOREVER);
+				count = read_data(ctx, ctx->dev_fd,
+						  ETH_RX_MAX_FRAMES);
+				k_mutex_unlock(&ctx->rx_lock);
+
+				if (count > 0) {
+					k_yield();
+				}
+			} while (count > 0);
 		}
 
 		if (IS_ENABLED(CONFIG_NET_GPTP)) {
@@ -478,6 +513,8 @@ static void eth_iface_init(struct net_if *iface)
 	net_if_set_link_addr(iface, ll_addr->addr, ll_addr->len,
 			     NET_LINK_ETHERNET);
 
+	k_mutex_init(&ctx->rx_lock);
+
 	ctx->dev_fd = eth_iface_create(ctx->if_name, false);
 	if (ctx->dev_fd < 0) {
 		LOG_ERR("Cannot create %s (%d)", ctx->if_name, -errno);
@@ -583,6 +620,37 @@ static int vlan_setup(const struct device *dev, struct net_if *iface,
 }
 #endif /* CONFIG_NET_VLAN */
 
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+static int eth_poll(const struct device *dev, int budget)
+{
+	struct eth_context *ctx = dev->data;
+	int count;
+
+	if (ctx->dev_fd < 0) {
+		return -ENETDOWN;
+	}
+
+	/* If the RX thread is reading, the frames are on their way anyway */
+	if (k_mutex_lock(&ctx->rx_lock, K_NO_WAIT) < 0) {
+		return 0;
+	}
+
+	count = read_data(ctx, ctx->dev_fd, MIN(budget, ETH_RX_MAX_FRAMES));
+
+	k_mutex_unlock(&ctx->rx_lock);
+
+	if (count == 0) {
+		/* The simulated time only advances when the CPU is held,
+		 * a caller spinning on its poll time would never see it
+		 * expire otherwise.
+		 */
+		k_busy_wait(1);
+	}
+
+	return count;
+}
+#endif /* CONFIG_NET_CONTEXT_BUSY_POLL */
+
 static int eth_start_device(const struct device *dev)
 {
 	struct eth_context *context = dev->data;
@@ -624,6 +692,9 @@ static const struct ethernet_api eth_if_api = {
 #if defined(CONFIG_ETH_NATIVE_POSIX_PTP_CLOCK)
 	.get_ptp_clock = eth_get_ptp_clock,
 #endif
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+	.poll = eth_poll,
+#endif
 };
 
 #define DEFINE_ETH_DEV_DATA(x, _)					     \
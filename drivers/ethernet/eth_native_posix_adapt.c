@@ -22,7 +22,7 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
-#include <sys/select.h>
+#include <sys/uio.h>
 #include <net/if.h>
 #include <time.h>
 #include <zephyr/arch/posix/posix_trace.h>
@@ -77,6 +77,16 @@ int eth_iface_create(const char *if_name, bool tun_only)
 	}
 #endif
 
+	/* The RX thread drains the device until it would block, so it does
+	 * not need to poll it before every read.
+	 */
+	ret = fcntl(fd, F_GETFL);
+	if (ret < 0 || fcntl(fd, F_SETFL, ret | O_NONBLOCK) < 0) {
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+
 	return fd;
 }
 
@@ -140,39 +150,61 @@ int eth_start_script(const char *if_name)
 	}
 }
 
-int eth_wait_data(int fd)
+/* Read up to max_frames frames, each into its own frame_len sized slot of
+ * buf. This is one read() per frame, a TUN/TAP device returns exactly one
+ * frame per read and recvmmsg() only works on sockets. Reading stops at
+ * the first read that would block.
+ */
+int eth_read_frames(int fd, void *buf, size_t frame_len, size_t *lens,
+		    int max_frames)
 {
-	struct timeval timeout;
-	fd_set rset;
-	int ret;
-
-	FD_ZERO(&rset);
+	uint8_t *slot = buf;
+	ssize_t ret = 0;
+	int count;
+
+	for (count = 0; count < max_frames; count++) {
+		ret = read(fd, slot, frame_len);
+		if (ret < 0 && errno == EINTR) {
+			count--;
+			continue;
+		}
 
-	FD_SET(fd, &rset);
+		if (ret <= 0) {
+			break;
+		}
 
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 0;
+		lens[count] = ret;
+		slot += frame_len;
+	}
 
-	ret = select(fd + 1, &rset, NULL, NULL, &timeout);
-	if (ret < 0 && errno != EINTR) {
+	if (count == 0 && ret < 0 && errno != EAGAIN &&
+	    errno != EWOULDBLOCK) {
 		return -errno;
-	} else if (ret > 0) {
-		if (FD_ISSET(fd, &rset)) {
-			return 0;
-		}
 	}
 
-	return -EAGAIN;
+	return count;
 }
 
-ssize_t eth_read_data(int fd, void *buf, size_t buf_len)
+ssize_t eth_write_frags(int fd, const struct eth_frag *frags, int count)
 {
-	return read(fd, buf, buf_len);
-}
+	struct iovec iov[ETH_MAX_TX_FRAGS];
+	ssize_t ret;
+	int i;
 
-ssize_t eth_write_data(int fd, void *buf, size_t buf_len)
-{
-	return write(fd, buf, buf_len);
+	if (count > ETH_MAX_TX_FRAGS) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < count; i++) {
+		iov[i].iov_base = (void *)frags[i].data;
+		iov[i].iov_len = frags[i].len;
+	}
+
+	do {
+		ret = writev(fd, iov, count);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : ret;
 }
 
 #if defined(CONFIG_NET_GPTP)
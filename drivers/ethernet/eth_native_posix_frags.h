@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/** @file
+ * @brief Fragment list of a packet sent by the native posix ethernet driver.
+ *
+ * This is on the Zephyr side of the driver, the host side only sees the
+ * resulting struct eth_frag array.
+ */
+
+#ifndef ZEPHYR_DRIVERS_ETHERNET_ETH_NATIVE_POSIX_FRAGS_H_
+#define ZEPHYR_DRIVERS_ETHERNET_ETH_NATIVE_POSIX_FRAGS_H_
+
+#include <zephyr/net/net_pkt.h>
+
+#include "eth_native_posix_priv.h"
+
+/**
+ * @brief Describe the data of a packet as a list of fragments.
+ *
+ * The fragments point to the net_buf data of the packet, so that it can be
+ * written with one writev(). Empty net_bufs are skipped. A packet with
+ * more than ETH_MAX_TX_FRAGS fragments is copied to @p copy_buf instead,
+ * which is then the only fragment.
+ *
+ * @param pkt Network packet to send
+ * @param frags Array of ETH_MAX_TX_FRAGS fragments to fill
+ * @param copy_buf Buffer used if the packet has too many fragments
+ * @param copy_len Size of @p copy_buf
+ *
+ * @return Number of fragments, <0 if the packet cannot be copied
+ */
+static inline int eth_native_posix_pkt_frags(struct net_pkt *pkt,
+					     struct eth_frag *frags,
+					     uint8_t *copy_buf,
+					     size_t copy_len)
+{
+	size_t count = net_pkt_get_len(pkt);
+	struct net_buf *buf;
+	int nfrags = 0;
+	int ret;
+
+	for (buf = pkt->buffer; buf; buf = buf->frags) {
+		if (buf->len == 0U) {
+			continue;
+		}
+
+		if (nfrags == ETH_MAX_TX_FRAGS) {
+			nfrags = 0;
+			break;
+		}
+
+		frags[nfrags].data = buf->data;
+		frags[nfrags].len = buf->len;
+		nfrags++;
+	}
+
+	if (nfrags > 0) {
+		return nfrags;
+	}
+
+	if (count > copy_len) {
+		return -EMSGSIZE;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	ret = net_pkt_read(pkt, copy_buf, count);
+	if (ret < 0) {
+		return ret;
+	}
+
+	frags[0].data = copy_buf;
+	frags[0].len = count;
+
+	return 1;
+}
+
+#endif /* ZEPHYR_DRIVERS_ETHERNET_ETH_NATIVE_POSIX_FRAGS_H_ */
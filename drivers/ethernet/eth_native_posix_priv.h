@@ -25,13 +25,21 @@
 #define ETH_NATIVE_POSIX_STARTUP_SCRIPT_USER ""
 #endif
 
+/* Fragment of a frame to send, converted to struct iovec by the host side */
+struct eth_frag {
+	const void *data;
+	size_t len;
+};
+
+#define ETH_MAX_TX_FRAGS 16
+
 int eth_iface_create(const char *if_name, bool tun_only);
 int eth_iface_remove(int fd);
 int eth_setup_host(const char *if_name);
 int eth_start_script(const char *if_name);
-int eth_wait_data(int fd);
-ssize_t eth_read_data(int fd, void *buf, size_t buf_len);
-ssize_t eth_write_data(int fd, void *buf, size_t buf_len);
+int eth_read_frames(int fd, void *buf, size_t frame_len, size_t *lens,
+		    int max_frames);
+ssize_t eth_write_frags(int fd, const struct eth_frag *frags, int count);
 int eth_if_up(const char *if_name);
 int eth_if_down(const char *if_name);
 
@@ -40,6 +40,8 @@ static void loopback_init(struct net_if *iface)
 	net_if_set_link_addr(iface, "\x00\x00\x5e\x00\x53\xff", 6,
 			     NET_LINK_DUMMY);
 
+	net_if_flag_set(iface, NET_IF_LOOPBACK);
+
 	if (IS_ENABLED(CONFIG_NET_IPV4)) {
 		struct in_addr ipv4_loopback = INADDR_LOOPBACK_INIT;
 
@@ -165,4 +167,4 @@ NET_DEVICE_INIT(loopback, "lo",
 		loopback_dev_init, NULL, NULL, NULL,
 		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
 		&loopback_api, DUMMY_L2,
-		NET_L2_GET_CTX_TYPE(DUMMY_L2), 576);
+		NET_L2_GET_CTX_TYPE(DUMMY_L2), CONFIG_NET_LOOPBACK_MTU);
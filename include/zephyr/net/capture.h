@@ -14,6 +14,7 @@
 #define ZEPHYR_INCLUDE_NET_CAPTURE_H_
 
 #include <zephyr/zephyr.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -192,8 +193,213 @@ static inline int net_capture_send(const struct device *dev, struct net_if *ifac
 #endif
 }
 
+/**
+ * @brief Local capture ring statistics
+ */
+struct net_capture_ring_stats {
+	/** Packets stored in the ring */
+	uint32_t captured;
+	/** Packets dropped because the ring was full */
+	uint32_t dropped;
+	/** Packets rejected by the capture filter */
+	uint32_t filtered;
+	/** Bytes of packet data stored in the ring */
+	uint32_t bytes;
+	/** Bytes currently used in the ring */
+	uint32_t used;
+	/** Size of the ring in bytes */
+	uint32_t size;
+};
+
+/**
+ * @typedef net_capture_filter_cb_t
+ * @brief Callback that selects the packets stored in the capture ring
+ *
+ * This is called in the packet path so it must be quick and must not block.
+ *
+ * @param iface Network interface of the packet
+ * @param pkt The network packet
+ * @param user_data User data given when the capture was started
+ *
+ * @return True if the packet is captured, false if it is skipped.
+ */
+typedef bool (*net_capture_filter_cb_t)(struct net_if *iface,
+					struct net_pkt *pkt,
+					void *user_data);
+
+/**
+ * @typedef net_capture_write_cb_t
+ * @brief Callback that receives the exported pcapng data
+ *
+ * @param data Data to write
+ * @param len Length of the data
+ * @param user_data User data given to the export function
+ *
+ * @return 0 if ok, <0 to stop the export
+ */
+typedef int (*net_capture_write_cb_t)(const void *data, size_t len,
+				      void *user_data);
+
+/**
+ * @brief Start capturing packets into the local capture ring.
+ *
+ * @details The packets are copied into a ring buffer in RAM without
+ * taking any lock, so that the capture can keep up with the traffic.
+ * If the ring is full, new packets are dropped and counted until the
+ * ring is drained by an export. Only the first @p snaplen bytes of each
+ * packet are stored. If the capture is already running, this waits for
+ * the packets being captured with the old settings before applying the
+ * new ones. Must not be called from the filter callback.
+ *
+ * @param iface Network interface to capture, NULL captures all of them.
+ * @param snaplen Max number of bytes stored per packet, 0 uses the
+ *        default from CONFIG_NET_CAPTURE_RING_SNAPLEN.
+ * @param cb Optional filter callback, NULL captures all the packets.
+ * @param user_data User data passed to the filter callback.
+ *
+ * @return 0 if ok, <0 if the capture cannot be started
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+int net_capture_ring_start(struct net_if *iface, uint16_t snaplen,
+			   net_capture_filter_cb_t cb, void *user_data);
+#else
+static inline int net_capture_ring_start(struct net_if *iface,
+					 uint16_t snaplen,
+					 net_capture_filter_cb_t cb,
+					 void *user_data)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(snaplen);
+	ARG_UNUSED(cb);
+	ARG_UNUSED(user_data);
+
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Stop capturing packets into the local capture ring.
+ *
+ * @details The packets already in the ring are kept until they are
+ * exported or cleared. When this returns, the filter callback given to
+ * net_capture_ring_start() is not called any more.
+ *
+ * @return 0 if ok, <0 if the capture was not running
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+int net_capture_ring_stop(void);
+#else
+static inline int net_capture_ring_stop(void)
+{
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Is the local capture ring enabled.
+ *
+ * @return True if packets are being captured to the ring, false otherwise.
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+bool net_capture_ring_is_enabled(void);
+#else
+static inline bool net_capture_ring_is_enabled(void)
+{
+	return false;
+}
+#endif
+
+/**
+ * @brief Get the local capture ring statistics.
+ *
+ * @param stats Statistics are returned here.
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+void net_capture_ring_stats_get(struct net_capture_ring_stats *stats);
+#else
+static inline void net_capture_ring_stats_get(
+					struct net_capture_ring_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+#endif
+
+/**
+ * @brief Export the packets in the local capture ring as pcapng.
+ *
+ * @details A section header and an interface description for every
+ * network interface are written first, then one enhanced packet block
+ * per captured packet. The exported packets are removed from the ring,
+ * so the capture can keep running while the ring is drained. The
+ * interface id of a packet is its network interface index minus one.
+ *
+ * @param cb Callback that writes the pcapng data.
+ * @param user_data User data passed to the callback.
+ *
+ * @return Number of packets exported, <0 if error
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+int net_capture_ring_export(net_capture_write_cb_t cb, void *user_data);
+#else
+static inline int net_capture_ring_export(net_capture_write_cb_t cb,
+					  void *user_data)
+{
+	ARG_UNUSED(cb);
+	ARG_UNUSED(user_data);
+
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Export the packets in the local capture ring to a pcapng file.
+ *
+ * @param path Name of the file, an existing file is overwritten.
+ *
+ * @return Number of packets exported, <0 if error
+ */
+#if defined(CONFIG_NET_CAPTURE_RING) && defined(CONFIG_FILE_SYSTEM)
+int net_capture_ring_export_file(const char *path);
+#else
+static inline int net_capture_ring_export_file(const char *path)
+{
+	ARG_UNUSED(path);
+
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Drop all the packets in the local capture ring and clear the
+ * statistics.
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+void net_capture_ring_clear(void);
+#else
+static inline void net_capture_ring_clear(void)
+{
+}
+#endif
+
 /** @cond INTERNAL_HIDDEN */
 
+/**
+ * @brief Store the network packet in the local capture ring if needed.
+ *
+ * @param iface Network interface of the packet
+ * @param pkt The network packet
+ */
+#if defined(CONFIG_NET_CAPTURE_RING)
+void net_capture_ring_pkt(struct net_if *iface, struct net_pkt *pkt);
+#else
+static inline void net_capture_ring_pkt(struct net_if *iface,
+					struct net_pkt *pkt)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+}
+#endif
+
 /**
  * @brief Check if the network packet needs to be captured or not.
  *        This is called for every network packet being sent.
@@ -201,7 +407,7 @@ static inline int net_capture_send(const struct device *dev, struct net_if *ifac
  * @param iface Network interface the packet is being sent
  * @param pkt The network packet that is sent
  */
-#if defined(CONFIG_NET_CAPTURE)
+#if defined(CONFIG_NET_CAPTURE) || defined(CONFIG_NET_CAPTURE_RING)
 void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt);
 #else
 static inline void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt)
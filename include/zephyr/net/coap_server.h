@@ -0,0 +1,322 @@
+/** @file
+ * @brief CoAP server engine
+ *
+ * An engine serving CoAP resources on a UDP socket, and sending CoAP
+ * requests from the same socket.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_COAP_SERVER_H_
+#define ZEPHYR_INCLUDE_NET_COAP_SERVER_H_
+
+/**
+ * @brief CoAP server engine
+ * @defgroup coap_server CoAP server engine
+ * @ingroup networking
+ * @{
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/dlist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct coap_server;
+struct coap_server_resource;
+
+/**
+ * @typedef coap_server_read_t
+ * @brief Callback reading a block of the representation of a resource.
+ *
+ * The callback is called for each block that is sent, so the
+ * representation never needs to be stored as a whole.
+ *
+ * @param resource Resource being read.
+ * @param request Request being answered, NULL for a notification.
+ * @param offset Offset of the block in the representation.
+ * @param buf Where to store the block.
+ * @param len Size of the block.
+ * @param more Set to true if the representation continues after the
+ *        block.
+ *
+ * @return Length of the block, <0 if error.
+ */
+typedef int (*coap_server_read_t)(struct coap_server_resource *resource,
+				  const struct coap_packet *request,
+				  size_t offset, uint8_t *buf, size_t len,
+				  bool *more);
+
+/**
+ * @typedef coap_server_write_t
+ * @brief Callback writing a block of a request payload to a resource.
+ *
+ * The callback is called for each block of a block-wise transfer, in
+ * order, so the payload never needs to be stored as a whole.
+ *
+ * @param resource Resource being written.
+ * @param request Request carrying the block.
+ * @param offset Offset of the block in the payload.
+ * @param data Block data.
+ * @param len Length of the block.
+ * @param last True for the last block of the payload.
+ *
+ * @return Response code for the last block, 0 for the default response
+ *         code, <0 if error.
+ */
+typedef int (*coap_server_write_t)(struct coap_server_resource *resource,
+				   const struct coap_packet *request,
+				   size_t offset, const uint8_t *data,
+				   size_t len, bool last);
+
+/**
+ * @typedef coap_server_delete_t
+ * @brief Callback deleting a resource.
+ *
+ * @param resource Resource to delete.
+ * @param request DELETE request.
+ *
+ * @return Response code, 0 for COAP_RESPONSE_CODE_DELETED, <0 if error.
+ */
+typedef int (*coap_server_delete_t)(struct coap_server_resource *resource,
+				    const struct coap_packet *request);
+
+/**
+ * @typedef coap_server_reply_t
+ * @brief Callback called when the response to a request is received.
+ *
+ * @param response Response received, NULL if none was received before
+ *        the request timed out or if it was rejected.
+ * @param from Address of the peer.
+ * @param user_data User data given with the request.
+ */
+typedef void (*coap_server_reply_t)(const struct coap_packet *response,
+				    const struct sockaddr *from,
+				    void *user_data);
+
+/** Resource served by the engine */
+struct coap_server_resource {
+	/** NULL terminated list of the segments of the resource path */
+	const char * const *path;
+
+	/** Handler of GET requests and notifications, NULL if not allowed */
+	coap_server_read_t get;
+
+	/** Handler of PUT requests, NULL if not allowed */
+	coap_server_write_t put;
+
+	/** Handler of POST requests, NULL if not allowed */
+	coap_server_write_t post;
+
+	/** Handler of DELETE requests, NULL if not allowed */
+	coap_server_delete_t del;
+
+	/** Content format of the representation */
+	uint16_t content_format;
+
+	/** Can the resource be observed */
+	bool observable;
+
+	/** User data of the resource */
+	void *user_data;
+
+	/** @cond INTERNAL_HIDDEN */
+	sys_snode_t node;
+	sys_slist_t observers;
+	uint32_t hash;
+	uint32_t age;
+	/** @endcond */
+};
+
+/** Observer slot, allocated by the application. Contents are internal. */
+struct coap_server_observer {
+	/** @cond INTERNAL_HIDDEN */
+	sys_snode_t node;
+	sys_snode_t hash_node;
+	struct coap_server_resource *resource;
+	struct coap_server_pending *pending;
+	struct sockaddr addr;
+	uint16_t id;
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+	uint8_t non_count;
+	bool stale;
+	/** @endcond */
+};
+
+/** Pending message slot, allocated by the application. Contents are
+ * internal.
+ */
+struct coap_server_pending {
+	/** @cond INTERNAL_HIDDEN */
+	struct coap_pending pending;
+	sys_dnode_t wheel_node;
+	sys_snode_t id_node;
+	sys_snode_t token_node;
+	struct coap_server_observer *observer;
+	coap_server_reply_t reply;
+	void *user_data;
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+	uint8_t acked : 1;
+	/** @endcond */
+};
+
+/** Engine configuration */
+struct coap_server_config {
+	/** Served resources */
+	struct coap_server_resource *resources;
+
+	/** Number of resources */
+	size_t resource_count;
+
+	/** Observer slots, one is used by each observation */
+	struct coap_server_observer *observers;
+
+	/** Number of observer slots */
+	size_t observer_count;
+
+	/** Pending message slots, one is used by each confirmable
+	 * notification and by each request until it is answered.
+	 */
+	struct coap_server_pending *pendings;
+
+	/** Number of pending message slots */
+	size_t pending_count;
+
+	/** Address family of the socket, AF_INET or AF_INET6 */
+	sa_family_t family;
+
+	/** Port to bind to, 0 for any */
+	uint16_t port;
+};
+
+/** @cond INTERNAL_HIDDEN */
+#define COAP_SERVER_WHEEL_SLOTS 32
+
+struct coap_server_block1 {
+	struct sockaddr addr;
+	struct coap_server_resource *resource;
+	size_t offset;
+	uint32_t last_used;
+	uint16_t id;
+};
+
+struct coap_server {
+	const struct coap_server_config *config;
+	struct k_mutex lock;
+	struct k_thread thread;
+	K_KERNEL_STACK_MEMBER(stack, CONFIG_COAP_SERVER_STACK_SIZE);
+
+	sys_slist_t resources[CONFIG_COAP_SERVER_HASH_SIZE];
+	sys_slist_t observers[CONFIG_COAP_SERVER_HASH_SIZE];
+	sys_slist_t pending_ids[CONFIG_COAP_SERVER_HASH_SIZE];
+	sys_slist_t pending_tokens[CONFIG_COAP_SERVER_HASH_SIZE];
+	sys_slist_t free_observers;
+	sys_slist_t free_pendings;
+
+	/** Retransmission timer wheel */
+	sys_dlist_t wheel[COAP_SERVER_WHEEL_SLOTS];
+	uint32_t wheel_tick;
+	size_t wheel_count;
+
+	struct coap_server_block1 transfers[CONFIG_COAP_SERVER_BLOCK1_TRANSFERS];
+
+	uint8_t rx_buf[CONFIG_COAP_SERVER_MESSAGE_SIZE];
+	uint8_t tx_buf[CONFIG_COAP_SERVER_MESSAGE_SIZE];
+	uint8_t block[CONFIG_COAP_SERVER_BLOCK_SIZE];
+
+	int sock;
+	bool running;
+};
+/** @endcond */
+
+/**
+ * @brief Start a CoAP server engine.
+ *
+ * A thread is started to receive the requests and to retransmit the
+ * confirmable messages. The resource callbacks are called from this
+ * thread.
+ *
+ * @param server Engine instance, must be valid until the engine is
+ *        stopped.
+ * @param config Engine configuration. It and the arrays it points to must
+ *        be valid until the engine is stopped.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int coap_server_start(struct coap_server *server,
+		      const struct coap_server_config *config);
+
+/**
+ * @brief Stop a CoAP server engine.
+ *
+ * The observations are dropped and the pending requests are completed
+ * without a response.
+ *
+ * @param server Engine instance.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int coap_server_stop(struct coap_server *server);
+
+/**
+ * @brief Notify the observers of a resource that it has changed.
+ *
+ * The representation is read once, and sent to all the observers. Every
+ * CONFIG_COAP_SERVER_OBSERVE_CON_INTERVAL notification to an observer is
+ * confirmable, and it is retransmitted with the representation current at
+ * the time of the retransmission. An observer is dropped when it rejects a
+ * notification or does not acknowledge it.
+ *
+ * This must not be called from a read callback.
+ *
+ * @param server Engine instance.
+ * @param resource Changed resource.
+ *
+ * @return Number of notified observers, <0 if error.
+ */
+int coap_server_notify(struct coap_server *server,
+		       struct coap_server_resource *resource);
+
+/**
+ * @brief Send a request from the engine socket.
+ *
+ * A confirmable request is retransmitted until it is acknowledged. The
+ * reply callback is called once, with the response or with NULL when no
+ * response is received. Only the first response to an observe request is
+ * reported.
+ *
+ * @param server Engine instance.
+ * @param request Request to send. Its data must be valid until the reply
+ *        callback is called.
+ * @param addr Address of the peer.
+ * @param addr_len Length of the address.
+ * @param reply Callback called with the response.
+ * @param user_data User data given to the reply callback.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int coap_server_request(struct coap_server *server,
+			const struct coap_packet *request,
+			const struct sockaddr *addr, socklen_t addr_len,
+			coap_server_reply_t reply, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_COAP_SERVER_H_ */
@@ -240,6 +240,16 @@ struct dns_resolve_context {
 		 * cannot be used to find correct pending query.
 		 */
 		uint16_t query_hash;
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		/** If set, this lookup waits for the answer to the query
+		 * in the given slot instead of sending its own.
+		 */
+		struct dns_pending_query *leader;
+
+		/** Smallest TTL of the CNAME records followed so far */
+		uint32_t cname_ttl;
+#endif
 	} queries[CONFIG_DNS_NUM_CONCUR_QUERIES];
 
 	/** Is this context in use */
@@ -358,7 +368,9 @@ int dns_resolve_cancel_with_name(struct dns_resolve_context *ctx,
  * @param type What kind of data the caller wants to get.
  * @param dns_id DNS id is returned to the caller. This is needed if one
  * wishes to cancel the query. This can be set to NULL if there is no need
- * to cancel the query.
+ * to cancel the query. If the answer comes from the cache, the callback
+ * has already been called and the returned id does not match any pending
+ * query.
  * @param cb Callback to call after the resolving has finished or timeout
  * has happened.
  * @param user_data The user data.
@@ -446,6 +458,48 @@ static inline int dns_cancel_addr_info(uint16_t dns_id)
 	return dns_resolve_cancel(dns_resolve_get_default(), dns_id);
 }
 
+/**
+ * DNS answer cache statistics.
+ */
+struct dns_resolve_cache_stats {
+	/** Lookups answered with addresses from the cache */
+	uint32_t hits;
+
+	/** Lookups answered with a cached negative answer */
+	uint32_t negative_hits;
+
+	/** Lookups that were not found in the cache */
+	uint32_t misses;
+
+	/** Misses that waited for an identical query already in flight */
+	uint32_t coalesced;
+
+	/** Valid entries that were replaced to make room for new ones */
+	uint32_t evictions;
+
+	/** Number of entries in use */
+	uint16_t entries;
+
+	/** Total number of entries */
+	uint16_t size;
+};
+
+/**
+ * @brief Get DNS answer cache statistics.
+ *
+ * @details Only available if CONFIG_DNS_RESOLVER_CACHE is enabled.
+ *
+ * @param stats Statistics are copied here.
+ */
+void dns_resolve_cache_stats_get(struct dns_resolve_cache_stats *stats);
+
+/**
+ * @brief Remove all the entries from the DNS answer cache.
+ *
+ * @details Only available if CONFIG_DNS_RESOLVER_CACHE is enabled.
+ */
+void dns_resolve_cache_flush(void);
+
 /**
  * @}
  */
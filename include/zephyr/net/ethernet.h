@@ -169,6 +169,14 @@ enum ethernet_hw_caps {
 
 	/** TXTIME supported */
 	ETHERNET_TXTIME			= BIT(19),
+
+	/** Multiple hardware RX/TX queues with flow hashing (RSS) supported.
+	 * The driver reports the hash of received packets, either with
+	 * net_pkt_set_flow_hash() or with the get_flow_hash() API, and can
+	 * use net_pkt_flow_hash() of sent packets to select the hardware TX
+	 * queue.
+	 */
+	ETHERNET_HW_FLOW_HASH		= BIT(20),
 };
 
 /** @cond INTERNAL_HIDDEN */
@@ -186,6 +194,7 @@ enum ethernet_config_type {
 	ETHERNET_CONFIG_TYPE_PRIORITY_QUEUES_NUM,
 	ETHERNET_CONFIG_TYPE_FILTER,
 	ETHERNET_CONFIG_TYPE_PORTS_NUM,
+	ETHERNET_CONFIG_TYPE_HW_QUEUES_NUM,
 };
 
 enum ethernet_qav_param_type {
@@ -391,6 +400,7 @@ struct ethernet_config {
 
 		int priority_queues_num;
 		int ports_num;
+		int hw_queues_num;
 
 		struct ethernet_filter filter;
 	};
@@ -446,6 +456,26 @@ struct ethernet_api {
 	const struct device *(*get_ptp_clock)(const struct device *dev);
 #endif /* CONFIG_PTP_CLOCK */
 
+#if defined(CONFIG_NET_TC_FLOW_STEERING)
+	/** Return the flow hash calculated by the hardware for a received
+	 * packet, or 0 if there is none. The network stack then calculates
+	 * the hash itself. Optional, only used if the driver has the
+	 * ETHERNET_HW_FLOW_HASH capability and did not already set the hash
+	 * of the packet.
+	 */
+	uint32_t (*get_flow_hash)(const struct device *dev,
+				  struct net_pkt *pkt);
+#endif /* CONFIG_NET_TC_FLOW_STEERING */
+
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+	/** Receive at most budget pending frames without waiting, in the
+	 * context of the calling thread. The frames are passed to
+	 * net_recv_data() as usual. Returns the number of frames received,
+	 * or <0 if error. Optional, needed for busy polling.
+	 */
+	int (*poll)(const struct device *dev, int budget);
+#endif /* CONFIG_NET_CONTEXT_BUSY_POLL */
+
 	/** Send a network packet */
 	int (*send)(const struct device *dev, struct net_pkt *pkt);
 };
@@ -51,6 +51,7 @@ enum net_request_ethernet_cmd {
 	NET_REQUEST_ETHERNET_CMD_GET_QBV_PARAM,
 	NET_REQUEST_ETHERNET_CMD_GET_QBU_PARAM,
 	NET_REQUEST_ETHERNET_CMD_GET_TXTIME_PARAM,
+	NET_REQUEST_ETHERNET_CMD_GET_HW_QUEUES_NUM,
 };
 
 #define NET_REQUEST_ETHERNET_SET_AUTO_NEGOTIATION			\
@@ -128,6 +129,11 @@ NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_ETHERNET_GET_QBU_PARAM);
 
 NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_ETHERNET_GET_TXTIME_PARAM);
 
+#define NET_REQUEST_ETHERNET_GET_HW_QUEUES_NUM				\
+	(_NET_ETHERNET_BASE | NET_REQUEST_ETHERNET_CMD_GET_HW_QUEUES_NUM)
+
+NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_ETHERNET_GET_HW_QUEUES_NUM);
+
 struct net_eth_addr;
 struct ethernet_qav_param;
 struct ethernet_qbv_param;
@@ -155,6 +161,7 @@ struct ethernet_req_params {
 
 		int priority_queues_num;
 		int ports_num;
+		int hw_queues_num;
 	};
 };
 
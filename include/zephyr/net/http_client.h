@@ -23,6 +23,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/net/net_ip.h>
 #include <zephyr/net/http_parser.h>
+#include <zephyr/net/tls_credentials.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,6 +81,26 @@ typedef int (*http_header_cb_t)(int sock,
 				struct http_request *req,
 				void *user_data);
 
+/**
+ * @typedef http_body_cb_t
+ * @brief Callback used to stream the request body to the server with
+ * chunked transfer encoding.
+ *
+ * @param req HTTP request information
+ * @param data Set by the callback to point to the next part of the body.
+ *        The data must stay valid until the callback is called again.
+ * @param user_data User specified data specified in http_client_req()
+ *
+ * @return >0 length of the data, in this case the data is sent as one chunk
+ *            and the callback is called again,
+ *         0  if the whole body has been given,
+ *         <0 if http_client_req() should return the error code to the
+ *            caller.
+ */
+typedef int (*http_body_cb_t)(struct http_request *req,
+			      const uint8_t **data,
+			      void *user_data);
+
 /**
  * @typedef http_response_cb_t
  * @brief Callback used when data is received from the server.
@@ -194,6 +215,11 @@ struct http_response {
 	uint8_t cl_present : 1;
 	uint8_t body_found : 1;
 	uint8_t message_complete : 1;
+
+	/** The server allows sending another request on the connection
+	 * after this response.
+	 */
+	uint8_t keep_alive : 1;
 };
 
 /** HTTP client internal data that the application should not touch
@@ -310,6 +336,17 @@ struct http_request {
 	 * headers will be placed into this field.
 	 */
 	const char **optional_headers;
+
+	/** User supplied callback function to call when the body of the
+	 * request is streamed with chunked transfer encoding. If set, the
+	 * payload, payload_len and payload_cb fields are not used.
+	 */
+	http_body_cb_t body_cb;
+
+	/** Give each part of the response body to the response callback as
+	 * soon as it is received, instead of when recv_buf is full.
+	 */
+	bool stream_response;
 };
 
 /**
@@ -330,6 +367,81 @@ struct http_request {
 int http_client_req(int sock, struct http_request *req,
 		    int32_t timeout, void *user_data);
 
+/**
+ * @brief Send several HTTP requests without waiting for the responses in
+ * between (HTTP/1.1 pipelining). The responses are given to the callbacks
+ * of the requests in order. The server must support persistent connections,
+ * and only idempotent requests should be pipelined.
+ *
+ * @param sock Socket id of the connection.
+ * @param reqs HTTP requests to send.
+ * @param count Number of requests.
+ * @param timeout Max timeout to wait for all the responses, in milliseconds.
+ * @param user_data User specified data that is passed to the callbacks.
+ *
+ * @note All the responses are received to the recv_buf of the first request.
+ *
+ * @return <0 if the requests could not be sent, otherwise the number of
+ *         requests for which a complete response was received.
+ */
+int http_client_req_pipeline(int sock, struct http_request **reqs,
+			     size_t count, int32_t timeout, void *user_data);
+
+/**
+ * Server connection information used for pooled connections.
+ */
+struct http_client_endpoint {
+	/** Address of the server */
+	const struct sockaddr *addr;
+
+	/** Length of the address */
+	socklen_t addrlen;
+
+	/** Host name of the server, also used for TLS server name
+	 * indication.
+	 */
+	const char *host;
+
+	/** TLS security tags, NULL for a plain TCP connection */
+	const sec_tag_t *sec_tag_list;
+
+	/** Number of TLS security tags */
+	size_t sec_tag_count;
+};
+
+/**
+ * @brief Get a connection to the server from the keep-alive connection pool.
+ * An idle connection with the same address, host and TLS configuration is
+ * reused, otherwise a new connection is created.
+ *
+ * @note Only available if CONFIG_HTTP_CLIENT_POOL is enabled.
+ *
+ * @param ep Server connection information.
+ *
+ * @return <0 if error, otherwise socket id of the connection.
+ */
+int http_client_pool_get(const struct http_client_endpoint *ep);
+
+/**
+ * @brief Give a connection back to the keep-alive connection pool.
+ * The connection is kept open for the next request if the last response
+ * allows it, otherwise it is closed.
+ *
+ * @note Only available if CONFIG_HTTP_CLIENT_POOL is enabled.
+ *
+ * @param sock Socket id returned by http_client_pool_get().
+ * @param req Last request done on the connection, NULL closes the
+ *        connection.
+ */
+void http_client_pool_put(int sock, const struct http_request *req);
+
+/**
+ * @brief Close all the idle connections of the keep-alive connection pool.
+ *
+ * @note Only available if CONFIG_HTTP_CLIENT_POOL is enabled.
+ */
+void http_client_pool_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
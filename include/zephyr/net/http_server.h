@@ -0,0 +1,337 @@
+/** @file
+ * @brief HTTP server API
+ *
+ * An API for applications to serve HTTP requests
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_
+#define ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_
+
+/**
+ * @brief HTTP server API
+ * @defgroup http_server HTTP server API
+ * @ingroup networking
+ * @{
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/http_parser.h>
+
+#if defined(CONFIG_FILE_SYSTEM)
+#include <zephyr/fs/fs.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct http_server;
+struct http_server_client;
+
+/** Where the content of a resource comes from */
+enum http_resource_type {
+	/** Constant data, for example in flash. Sent without copying. */
+	HTTP_RESOURCE_TYPE_STATIC,
+
+	/** File in a mounted file system */
+	HTTP_RESOURCE_TYPE_FS,
+
+	/** Generated by an application callback */
+	HTTP_RESOURCE_TYPE_DYNAMIC,
+};
+
+/** Request given to the callback of a dynamic resource */
+struct http_server_request {
+	/** Request method */
+	enum http_method method;
+
+	/** Requested path, without the query */
+	const char *path;
+
+	/** Query after '?' in the URL, NULL if there is none */
+	const char *query;
+
+	/** Request body */
+	const uint8_t *body;
+
+	/** Length of the request body */
+	size_t body_len;
+};
+
+/**
+ * @typedef http_resource_cb_t
+ * @brief Callback generating the response of a dynamic resource.
+ *
+ * The callback is called once the whole request has been received. It sends
+ * the response with http_server_respond(), or with
+ * http_server_respond_begin() and http_server_respond_chunk().
+ *
+ * @param client Connection of the request.
+ * @param req Request information, valid only during the callback.
+ * @param user_data User data of the resource.
+ *
+ * @return 0 if ok, <0 if error. If no response was sent, the server answers
+ *         with status 500 on error and with status 204 otherwise.
+ */
+typedef int (*http_resource_cb_t)(struct http_server_client *client,
+				  const struct http_server_request *req,
+				  void *user_data);
+
+/** Route table entry */
+struct http_resource {
+	/** Path of the resource. A path ending with '*' matches every path
+	 *  starting with the part before it.
+	 */
+	const char *path;
+
+	/** Content type of the resource. Guessed from the file name extension
+	 *  for a file system resource if NULL.
+	 */
+	const char *content_type;
+
+	/** Where the content comes from */
+	enum http_resource_type type;
+
+	union {
+		/** Static resource */
+		struct {
+			const uint8_t *data;
+			size_t len;
+
+			/** Precompressed content, NULL if there is none */
+			const uint8_t *gzip_data;
+			size_t gzip_len;
+		} static_data;
+
+		/** File system resource. The path is the file, or the
+		 *  directory matching the '*' of a wildcard resource. A file
+		 *  with a ".gz" suffix is used as a precompressed variant.
+		 */
+		struct {
+			const char *path;
+		} fs;
+
+		/** Dynamic resource */
+		struct {
+			http_resource_cb_t cb;
+			void *user_data;
+		} dynamic;
+	};
+};
+
+/** Static resource served from constant data. */
+#define HTTP_RESOURCE_STATIC(_path, _content_type, _data, _len)	\
+	{								\
+		.path = _path,						\
+		.content_type = _content_type,				\
+		.type = HTTP_RESOURCE_TYPE_STATIC,			\
+		.static_data = {					\
+			.data = _data,					\
+			.len = _len,					\
+		},							\
+	}
+
+/** Static resource with a precompressed gzip variant. */
+#define HTTP_RESOURCE_STATIC_GZIP(_path, _content_type, _data, _len,	\
+				  _gzip_data, _gzip_len)		\
+	{								\
+		.path = _path,						\
+		.content_type = _content_type,				\
+		.type = HTTP_RESOURCE_TYPE_STATIC,			\
+		.static_data = {					\
+			.data = _data,					\
+			.len = _len,					\
+			.gzip_data = _gzip_data,			\
+			.gzip_len = _gzip_len,				\
+		},							\
+	}
+
+/** Resource served from a file system. */
+#define HTTP_RESOURCE_FS(_path, _fs_path)				\
+	{								\
+		.path = _path,						\
+		.type = HTTP_RESOURCE_TYPE_FS,				\
+		.fs = {							\
+			.path = _fs_path,				\
+		},							\
+	}
+
+/** Resource generated by a callback. */
+#define HTTP_RESOURCE_DYNAMIC(_path, _cb, _user_data)			\
+	{								\
+		.path = _path,						\
+		.type = HTTP_RESOURCE_TYPE_DYNAMIC,			\
+		.dynamic = {						\
+			.cb = _cb,					\
+			.user_data = _user_data,			\
+		},							\
+	}
+
+/** Server configuration */
+struct http_server_config {
+	/** Route table, the first matching resource is used */
+	const struct http_resource *resources;
+
+	/** Number of resources */
+	size_t resource_count;
+
+	/** Address family to listen on, AF_INET or AF_INET6 */
+	sa_family_t family;
+
+	/** Port to listen on */
+	uint16_t port;
+};
+
+/** @cond INTERNAL_HIDDEN */
+#define HTTP_SERVER_HEADER_SIZE 192
+
+struct http_server_client {
+	struct http_server *server;
+
+	/** Uptime in ms of the last activity */
+	int64_t last_activity;
+
+	struct http_parser parser;
+
+	/** Resource of the response being sent */
+	const struct http_resource *resource;
+
+	/** Response data not sent yet, sent directly from the resource */
+	const uint8_t *tx_data;
+	size_t tx_len;
+
+#if defined(CONFIG_FILE_SYSTEM)
+	/** File being sent, and how much of it is left to read */
+	struct fs_file_t file;
+	size_t file_left;
+#endif
+
+	/** Received data not parsed yet, also used to read the files */
+	size_t data_len;
+	uint8_t buf[CONFIG_HTTP_SERVER_CLIENT_BUFFER_SIZE];
+
+	/** Response header, and how much of it has been sent */
+	size_t header_len;
+	size_t header_sent;
+	char header[HTTP_SERVER_HEADER_SIZE];
+
+	char path[CONFIG_HTTP_SERVER_MAX_URL_LENGTH];
+	size_t path_len;
+
+	size_t body_len;
+	uint8_t body[CONFIG_HTTP_SERVER_MAX_BODY_SIZE];
+
+	/** Value of the header being parsed, if it is of interest */
+	char header_value[32];
+	size_t header_value_len;
+	size_t header_field_match;
+
+	int sock;
+
+	/** Request errors found while parsing */
+	uint16_t error_status;
+
+	uint8_t header_field_done : 1;
+	uint8_t accept_gzip : 1;
+	uint8_t message_complete : 1;
+	uint8_t keep_alive : 1;
+	uint8_t responding : 1;
+	uint8_t chunked : 1;
+	uint8_t chunk_open : 1;
+	uint8_t file_open : 1;
+};
+
+struct http_server {
+	const struct http_server_config *config;
+	struct http_parser_settings parser_settings;
+	struct http_server_client clients[CONFIG_HTTP_SERVER_MAX_CLIENTS];
+	struct k_thread thread;
+	K_KERNEL_STACK_MEMBER(stack, CONFIG_HTTP_SERVER_STACK_SIZE);
+	int sock;
+	bool running;
+};
+/** @endcond */
+
+/**
+ * @brief Start an HTTP server.
+ *
+ * A thread is started to serve all the connections of the server, one
+ * request at a time per connection. Connections are kept open between the
+ * requests if the client allows it, and requests can be pipelined.
+ *
+ * @param server Server instance, must be valid until the server is stopped.
+ * @param config Server configuration, must be valid until the server is
+ *        stopped.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_start(struct http_server *server,
+		      const struct http_server_config *config);
+
+/**
+ * @brief Stop an HTTP server and close all its connections.
+ *
+ * @param server Server instance.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_stop(struct http_server *server);
+
+/**
+ * @brief Send the response of a dynamic resource.
+ *
+ * @param client Connection given to the resource callback.
+ * @param status HTTP status code.
+ * @param content_type Content type of the body, NULL if there is no body.
+ * @param body Response body.
+ * @param len Length of the response body.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_respond(struct http_server_client *client, uint16_t status,
+			const char *content_type, const void *body, size_t len);
+
+/**
+ * @brief Start a response of a dynamic resource with a body of unknown
+ * length. The body is then sent with http_server_respond_chunk().
+ *
+ * @param client Connection given to the resource callback.
+ * @param status HTTP status code.
+ * @param content_type Content type of the body.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_respond_begin(struct http_server_client *client,
+			      uint16_t status, const char *content_type);
+
+/**
+ * @brief Send a part of a response body started with
+ * http_server_respond_begin(). The body is sent with chunked transfer
+ * encoding, or until the connection is closed for an HTTP/1.0 client.
+ *
+ * @param client Connection given to the resource callback.
+ * @param data Body data.
+ * @param len Length of the data, 0 ends the body. The body is ended when the
+ *        resource callback returns if this was not done.
+ *
+ * @return 0 if ok, <0 if error.
+ */
+int http_server_respond_chunk(struct http_server_client *client,
+			      const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_ */
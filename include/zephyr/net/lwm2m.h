@@ -208,6 +208,15 @@ struct lwm2m_ctx {
 
 	lwm2m_ctx_event_cb_t event_cb;
 
+	/** Number of notifications sent to the server. */
+	uint32_t notify_messages;
+
+	/** Number of observed paths reported by these notifications.
+	 *  Compared to notify_messages, it tells how many paths the
+	 *  Observe-Composite notifications carry.
+	 */
+	uint32_t notify_paths;
+
 	/** Validation buffer. Used as a temporary buffer to decode the resource
 	 *  value before validation. On successful validation, its content is
 	 *  copied into the actual resource buffer.
@@ -444,6 +444,44 @@ struct mqtt_transport {
 #endif
 };
 
+#if defined(CONFIG_MQTT_SESSION)
+/** @brief Internal. Message stored in the session buffer. */
+struct mqtt_session_msg {
+	/** Internal. Offset of the encoded packet in the session buffer. */
+	uint32_t offset;
+
+	/** Internal. Length of the encoded packet. */
+	uint32_t len;
+
+	/** Internal. Message id of the publish message. */
+	uint16_t message_id;
+
+	/** Internal. QoS of the publish message. */
+	uint8_t qos;
+
+	/** Internal. Progress of the message, see mqtt_session.c. */
+	uint8_t state;
+};
+
+/** @brief Internal. Outbound session state. */
+struct mqtt_session {
+	/** Internal. Messages in the order they were published. */
+	struct mqtt_session_msg msgs[CONFIG_MQTT_SESSION_MAX_MSGS];
+
+	/** Internal. Offset where the next packet is stored. */
+	uint32_t tail;
+
+	/** Internal. Index of the oldest message. */
+	uint8_t head;
+
+	/** Internal. Number of messages in the session. */
+	uint8_t count;
+
+	/** Internal. Number of sent but unacknowledged messages. */
+	uint8_t inflight;
+};
+#endif /* CONFIG_MQTT_SESSION */
+
 /** @brief MQTT internal state. */
 struct mqtt_internal {
 	/** Internal. Mutex to protect access to the client instance. */
@@ -462,6 +500,11 @@ struct mqtt_internal {
 
 	/** Internal. Remaining payload length to read. */
 	uint32_t remaining_payload;
+
+#if defined(CONFIG_MQTT_SESSION)
+	/** Internal. Outbound QoS 1 and QoS 2 messages. */
+	struct mqtt_session session;
+#endif
 };
 
 /**
@@ -518,6 +561,18 @@ struct mqtt_client {
 	/** Size of transmit buffer. */
 	uint32_t tx_buf_size;
 
+#if defined(CONFIG_MQTT_SESSION)
+	/** Buffer keeping the QoS 1 and QoS 2 messages until the broker has
+	 *  acknowledged them. NULL disables the session layer for the client.
+	 *  Shall be large enough for the biggest message, including topic and
+	 *  payload.
+	 */
+	uint8_t *session_buf;
+
+	/** Size of session buffer. */
+	uint32_t session_buf_size;
+#endif
+
 	/** Keepalive interval for this client in seconds.
 	 *  Default is CONFIG_MQTT_KEEPALIVE.
 	 */
@@ -596,6 +651,12 @@ int mqtt_connect(struct mqtt_client *client);
  * @param[in] param Parameters to be used for the publish message.
  *                  Shall not be NULL.
  *
+ * @note If @kconfig{CONFIG_MQTT_SESSION} is enabled and the client has a
+ *       session buffer, QoS 1 and QoS 2 messages are copied to the session
+ *       and sent when the in-flight window allows. The library then sends
+ *       the PUBREL for QoS 2 messages itself, and -EAGAIN is returned
+ *       while the session is full.
+ *
  * @return 0 or a negative error code (errno.h) indicating reason of failure.
  */
 int mqtt_publish(struct mqtt_client *client,
@@ -808,6 +869,20 @@ int mqtt_read_publish_payload_blocking(struct mqtt_client *client, void *buffer,
 int mqtt_readall_publish_payload(struct mqtt_client *client, uint8_t *buffer,
 				 size_t length);
 
+#if defined(CONFIG_MQTT_SESSION)
+/**
+ * @brief Get the number of messages in the session.
+ *
+ * @param[in] client Client instance for which the procedure is requested.
+ *                   Shall not be NULL.
+ *
+ * @return Number of QoS 1 and QoS 2 messages not yet acknowledged by the
+ *         broker, including the ones waiting to be sent, or a negative
+ *         error code (errno.h) indicating reason of failure.
+ */
+int mqtt_session_pending(struct mqtt_client *client);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
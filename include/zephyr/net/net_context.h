@@ -281,6 +281,11 @@ __net_socket struct net_context {
 		/** Mutex used by condition variable */
 		struct k_mutex *lock;
 	} cond;
+
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+	/** Epoll instances watching this socket */
+	sys_slist_t epoll_items;
+#endif /* CONFIG_NET_SOCKETS_EPOLL */
 #endif /* CONFIG_NET_SOCKETS */
 
 #if defined(CONFIG_NET_OFFLOAD)
@@ -318,6 +323,10 @@ __net_socket struct net_context {
 #endif
 #if defined(CONFIG_NET_CONTEXT_SNDBUF)
 		uint16_t sndbuf;
+#endif
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+		/** Time to poll the interface before sleeping, in usec */
+		uint32_t busy_poll;
 #endif
 	} options;
 
@@ -1068,6 +1077,7 @@ enum net_context_option {
 	NET_OPT_SNDTIMEO        = 5,
 	NET_OPT_RCVBUF		= 6,
 	NET_OPT_SNDBUF		= 7,
+	NET_OPT_BUSY_POLL	= 8,
 };
 
 /**
@@ -149,6 +149,16 @@ int net_send_data(struct net_pkt *pkt);
 #define NET_TC_COUNT 0
 #endif /* CONFIG_NET_TC_TX_COUNT && CONFIG_NET_TC_RX_COUNT */
 
+#if defined(CONFIG_NET_TC_FLOW_QUEUES)
+#define NET_TC_FLOW_QUEUES CONFIG_NET_TC_FLOW_QUEUES
+#else
+#define NET_TC_FLOW_QUEUES 1
+#endif
+
+/* Total number of RX/TX queues (and handler threads) */
+#define NET_TC_TX_QUEUE_COUNT (NET_TC_TX_COUNT * NET_TC_FLOW_QUEUES)
+#define NET_TC_RX_QUEUE_COUNT (NET_TC_RX_COUNT * NET_TC_FLOW_QUEUES)
+
 /* @endcond */
 
 /**
@@ -175,6 +175,24 @@ enum net_event_ipv4_cmd {
 	(_NET_EVENT_IPV4_BASE |	NET_EVENT_IPV4_CMD_MCAST_LEAVE)
 
 
+/* Network packet pool events */
+#define _NET_PKT_POOL_LAYER	NET_MGMT_LAYER_L3
+#define _NET_PKT_POOL_CORE_CODE	0x005
+#define _NET_EVENT_PKT_POOL_BASE (NET_MGMT_EVENT_BIT |			\
+				  NET_MGMT_LAYER(_NET_PKT_POOL_LAYER) |	\
+				  NET_MGMT_LAYER_CODE(_NET_PKT_POOL_CORE_CODE))
+
+enum net_event_pkt_pool_cmd {
+	NET_EVENT_PKT_POOL_CMD_LOW = 1,
+	NET_EVENT_PKT_POOL_CMD_OK,
+};
+
+#define NET_EVENT_PKT_POOL_LOW					\
+	(_NET_EVENT_PKT_POOL_BASE | NET_EVENT_PKT_POOL_CMD_LOW)
+
+#define NET_EVENT_PKT_POOL_OK					\
+	(_NET_EVENT_PKT_POOL_BASE | NET_EVENT_PKT_POOL_CMD_OK)
+
 /* L4 network events */
 #define _NET_L4_LAYER		NET_MGMT_LAYER_L4
 #define _NET_L4_CORE_CODE	0x114
@@ -247,6 +265,20 @@ struct net_event_ipv6_route {
 	uint8_t prefix_len;
 };
 
+/**
+ * @brief Network Management event information structure
+ * Used to pass information on network events like
+ *   NET_EVENT_PKT_POOL_LOW and
+ *   NET_EVENT_PKT_POOL_OK
+ * when CONFIG_NET_MGMT_EVENT_INFO enabled and event generator pass the
+ * information.
+ */
+struct net_event_pkt_pool {
+	uint8_t pool; /* enum net_pkt_pool_type */
+	uint16_t free;
+	uint16_t total;
+};
+
 #endif /* CONFIG_NET_MGMT_EVENT_INFO */
 
 #ifdef __cplusplus
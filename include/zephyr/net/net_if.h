@@ -193,6 +193,14 @@ enum net_if_flag {
 	/** Interface supports IPv6 */
 	NET_IF_IPV6,
 
+	/** Received TCP segments are coalesced (GRO) on this interface */
+	NET_IF_GRO,
+
+	/** Interface is the loopback interface, its packets never leave the
+	 * device.
+	 */
+	NET_IF_LOOPBACK,
+
 /** @cond INTERNAL_HIDDEN */
 	/* Total number of flags - must be at the end of the enum */
 	NET_IF_NUM_FLAGS
@@ -2012,6 +2020,25 @@ void net_if_call_link_cb(struct net_if *iface, struct net_linkaddr *lladdr,
  */
 bool net_if_need_calc_rx_checksum(struct net_if *iface);
 
+/**
+ * @brief Poll the network interface driver for received packets.
+ *
+ * @details The packets for @p context are received and processed up to
+ * the socket layer in the context of the calling thread, bypassing the
+ * RX queues. The other packets are passed to the RX queues as usual.
+ * Only one thread at a time can poll, and only drivers providing a poll
+ * function support it. This needs CONFIG_NET_CONTEXT_BUSY_POLL.
+ *
+ * @param iface Network interface
+ * @param context Network context the caller waits data for, or NULL
+ * @param budget Maximum number of packets to receive
+ *
+ * @return Number of packets received, -EBUSY if another thread is
+ * polling, -ENOTSUP if the driver cannot be polled, <0 if other error.
+ */
+int net_if_busy_poll(struct net_if *iface, struct net_context *context,
+		     int budget);
+
 /**
  * @brief Check if network packet checksum calculation can be avoided or not
  * when sending the packet. For example many ethernet devices support network
@@ -118,6 +118,13 @@ struct net_pkt {
 	uint64_t txtime;
 #endif /* CONFIG_NET_PKT_TXTIME */
 
+#if defined(CONFIG_NET_TC_FLOW_STEERING)
+	/** Flow hash used to select the RX/TX queue. Value 0 means that
+	 * the hash has not been set.
+	 */
+	uint32_t flow_hash;
+#endif /* CONFIG_NET_TC_FLOW_STEERING */
+
 	/** Reference counter */
 	atomic_t atomic_ref;
 
@@ -194,6 +201,17 @@ struct net_pkt {
 				   * processed by the L2
 				   */
 
+	uint8_t chksum_done : 1; /* Set to 1 if the transport layer checksum
+				  * of this packet has already been verified,
+				  * for example by GRO when merging segments.
+				  */
+
+	uint8_t ip_reassembled : 1; /* Set to 1 if this packet was reassembled
+				     * from IP fragments. It is fed back to
+				     * the IP layer and has no link layer
+				     * header.
+				     */
+
 	union {
 		/* IPv6 hop limit or IPv4 ttl for this network packet.
 		 * The value is shared between IPv6 and IPv4.
@@ -225,6 +243,11 @@ struct net_pkt {
 	uint16_t vlan_tci;
 #endif /* CONFIG_NET_VLAN */
 
+#if defined(CONFIG_NET_IPV4_FRAGMENT)
+	uint16_t ipv4_fragment_flags;	/* Fragment offset and MF (More Fragments) flag */
+	uint16_t ipv4_fragment_id;	/* Fragment id */
+#endif /* CONFIG_NET_IPV4_FRAGMENT */
+
 #if defined(CONFIG_NET_IPV6)
 	/* Where is the start of the last header before payload data
 	 * in IPv6 packet. This is offset value from start of the IPv6
@@ -385,6 +408,53 @@ static inline void net_pkt_set_l2_processed(struct net_pkt *pkt,
 	pkt->l2_processed = is_l2_processed;
 }
 
+#if defined(CONFIG_NET_TC_FLOW_STEERING)
+static inline uint32_t net_pkt_flow_hash(struct net_pkt *pkt)
+{
+	return pkt->flow_hash;
+}
+
+static inline void net_pkt_set_flow_hash(struct net_pkt *pkt, uint32_t hash)
+{
+	pkt->flow_hash = hash;
+}
+#else
+static inline uint32_t net_pkt_flow_hash(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static inline void net_pkt_set_flow_hash(struct net_pkt *pkt, uint32_t hash)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(hash);
+}
+#endif /* CONFIG_NET_TC_FLOW_STEERING */
+
+static inline bool net_pkt_is_chksum_done(struct net_pkt *pkt)
+{
+	return !!(pkt->chksum_done);
+}
+
+static inline void net_pkt_set_chksum_done(struct net_pkt *pkt,
+					   bool is_chksum_done)
+{
+	pkt->chksum_done = is_chksum_done;
+}
+
+static inline bool net_pkt_is_ip_reassembled(struct net_pkt *pkt)
+{
+	return !!(pkt->ip_reassembled);
+}
+
+static inline void net_pkt_set_ip_reassembled(struct net_pkt *pkt,
+					      bool reassembled)
+{
+	pkt->ip_reassembled = reassembled;
+}
+
 static inline uint8_t net_pkt_ip_hdr_len(struct net_pkt *pkt)
 {
 	return pkt->ip_hdr_len;
@@ -652,6 +722,70 @@ static inline uint16_t net_pkt_ip_opts_len(struct net_pkt *pkt)
 #endif
 }
 
+#if defined(CONFIG_NET_IPV4_FRAGMENT)
+static inline uint16_t net_pkt_ipv4_fragment_offset(struct net_pkt *pkt)
+{
+	return (pkt->ipv4_fragment_flags & NET_IPV4_FRAGH_OFFSET_MASK) * 8;
+}
+
+static inline bool net_pkt_ipv4_fragment_more(struct net_pkt *pkt)
+{
+	return (pkt->ipv4_fragment_flags & NET_IPV4_MORE_FRAG_MASK) != 0;
+}
+
+static inline void net_pkt_set_ipv4_fragment_flags(struct net_pkt *pkt,
+						   uint16_t flags)
+{
+	pkt->ipv4_fragment_flags = flags;
+}
+
+static inline uint16_t net_pkt_ipv4_fragment_id(struct net_pkt *pkt)
+{
+	return pkt->ipv4_fragment_id;
+}
+
+static inline void net_pkt_set_ipv4_fragment_id(struct net_pkt *pkt,
+						uint16_t id)
+{
+	pkt->ipv4_fragment_id = id;
+}
+#else /* CONFIG_NET_IPV4_FRAGMENT */
+static inline uint16_t net_pkt_ipv4_fragment_offset(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static inline bool net_pkt_ipv4_fragment_more(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static inline void net_pkt_set_ipv4_fragment_flags(struct net_pkt *pkt,
+						   uint16_t flags)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(flags);
+}
+
+static inline uint16_t net_pkt_ipv4_fragment_id(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static inline void net_pkt_set_ipv4_fragment_id(struct net_pkt *pkt,
+						uint16_t id)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(id);
+}
+#endif /* CONFIG_NET_IPV4_FRAGMENT */
+
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
 static inline uint16_t net_pkt_ipv6_fragment_start(struct net_pkt *pkt)
 {
@@ -1558,6 +1692,76 @@ void net_pkt_get_info(struct k_mem_slab **rx,
 		      struct net_buf_pool **rx_data,
 		      struct net_buf_pool **tx_data);
 
+/** Predefined network packet pools that are monitored for usage */
+enum net_pkt_pool_type {
+	NET_PKT_POOL_RX,      /**< RX packets */
+	NET_PKT_POOL_TX,      /**< TX packets */
+	NET_PKT_POOL_RX_DATA, /**< RX data buffers */
+	NET_PKT_POOL_TX_DATA, /**< TX data buffers */
+	NET_PKT_POOL_TYPE_COUNT,
+};
+
+/** Number of buckets in the pool usage histogram */
+#define NET_PKT_POOL_HIST_BUCKETS 8
+
+/** Usage information of a predefined network packet pool */
+struct net_pkt_pool_usage {
+	/** Histogram of the used entries seen at allocation time, bucket i
+	 * counts the allocations after which at most (i + 1) / 8 of the
+	 * pool was in use.
+	 */
+	uint32_t hist[NET_PKT_POOL_HIST_BUCKETS];
+
+	/** Total number of entries in the pool */
+	uint16_t total;
+
+	/** Number of entries currently in use */
+	uint16_t used;
+
+	/** Max number of entries that have been in use at the same time */
+	uint16_t max_used;
+
+	/** Is the pool below the low watermark */
+	bool low;
+};
+
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+/**
+ * @brief Get usage information of a predefined network packet pool.
+ *
+ * @param type Pool to query
+ * @param usage Usage information is returned here
+ *
+ * @return 0 if ok, -EINVAL if the pool type is invalid
+ */
+int net_pkt_pool_usage_get(enum net_pkt_pool_type type,
+			   struct net_pkt_pool_usage *usage);
+
+/**
+ * @brief Check if the RX packet or RX data pool is under pressure.
+ *
+ * @return True if the free part of the pool is below the low watermark
+ */
+bool net_pkt_rx_pool_is_low(void);
+
+/**
+ * @brief Check if the TX packet or TX data pool is under pressure.
+ *
+ * @return True if the free part of the pool is below the low watermark
+ */
+bool net_pkt_tx_pool_is_low(void);
+#else
+static inline bool net_pkt_rx_pool_is_low(void)
+{
+	return false;
+}
+
+static inline bool net_pkt_tx_pool_is_low(void)
+{
+	return false;
+}
+#endif /* CONFIG_NET_PKT_POOL_MONITOR */
+
 /** @cond INTERNAL_HIDDEN */
 
 #if defined(CONFIG_NET_DEBUG_NET_PKT_ALLOC)
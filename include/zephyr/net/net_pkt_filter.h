@@ -17,6 +17,7 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <zephyr/sys/slist.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/net/net_core.h>
 #include <zephyr/net/ethernet.h>
 
@@ -34,6 +35,7 @@ extern "C" {
 /** @cond INTERNAL_HIDDEN */
 
 struct npf_test;
+struct npf_prog;
 
 typedef bool (npf_test_fn_t)(struct npf_test *test, struct net_pkt *pkt);
 
@@ -49,6 +51,7 @@ struct npf_rule {
 	sys_snode_t node;
 	enum net_verdict result;	/**< result if all tests pass */
 	uint32_t nb_tests;		/**< number of tests for this rule */
+	atomic_t hits;			/**< number of packets that matched */
 	struct npf_test *tests[];	/**< pointers to @ref npf_test instances */
 };
 
@@ -61,6 +64,12 @@ extern struct npf_rule npf_default_drop;
 struct npf_rule_list {
 	sys_slist_t rule_head;
 	struct k_spinlock lock;
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED) || defined(__DOXYGEN__)
+	/** Compiled rules used for the packets, NULL if not available */
+	atomic_ptr_t prog;
+	/** Storage for the compiled rules, one in use and one for updates */
+	struct npf_prog *progs;
+#endif
 };
 
 /** @brief  rule list applied to outgoing packets */
@@ -101,6 +110,30 @@ bool npf_remove_rule(struct npf_rule_list *rules, struct npf_rule *rule);
  */
 bool npf_remove_all_rules(struct npf_rule_list *rules);
 
+/**
+ * @brief Get the number of packets that matched a rule
+ *
+ * The counter is incremented when the rule decides the fate of a packet,
+ * i.e. when all of its tests pass and the rule is the first one to do so.
+ *
+ * @param rule the rule
+ * @return number of packets that matched the rule
+ */
+static inline uint32_t npf_rule_hits(struct npf_rule *rule)
+{
+	return (uint32_t)atomic_get(&rule->hits);
+}
+
+/**
+ * @brief Reset the matched packet counter of a rule
+ *
+ * @param rule the rule
+ */
+static inline void npf_rule_hits_reset(struct npf_rule *rule)
+{
+	atomic_clear(&rule->hits);
+}
+
 /* convenience shortcuts */
 #define npf_insert_send_rule(rule) npf_insert_rule(&npf_send_rules, rule)
 #define npf_insert_recv_rule(rule) npf_insert_rule(&npf_recv_rules, rule)
@@ -163,6 +163,43 @@ struct net_stats_tcp {
 
 	/** Number of connection attempts for closed ports, triggering a RST. */
 	net_stats_t connrst;
+
+	/** Number of sent keep-alive probes. */
+	net_stats_t keepalive;
+
+	/** Number of connections closed because the peer did not answer the
+	 * keep-alive probes or did not acknowledge data within the user
+	 * timeout.
+	 */
+	net_stats_t conntimeout;
+};
+
+/**
+ * @brief TCP receive coalescing (GRO) statistics
+ */
+struct net_stats_gro {
+	/** Number of TCP segments taken over by GRO. */
+	net_stats_t recv;
+
+	/** Number of TCP segments merged into a previous segment. */
+	net_stats_t merged;
+
+	/** Number of coalesced packets passed to TCP. */
+	net_stats_t flushed;
+};
+
+/**
+ * @brief Neighbor cache (ARP or IPv6 neighbor) statistics
+ */
+struct net_stats_nbr_cache {
+	/** Number of cache lookups in TX path that found an entry. */
+	net_stats_t hit;
+
+	/** Number of cache lookups in TX path that did not find an entry. */
+	net_stats_t miss;
+
+	/** Number of entries removed to make room for a new one. */
+	net_stats_t evicted;
 };
 
 /**
@@ -322,6 +359,19 @@ struct net_stats {
 	struct net_stats_tcp tcp;
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_GRO)
+	/** TCP receive coalescing statistics */
+	struct net_stats_gro gro;
+#endif
+
+#if defined(CONFIG_NET_STATISTICS_NBR_CACHE)
+	/** ARP cache statistics */
+	struct net_stats_nbr_cache arp;
+
+	/** IPv6 neighbor cache statistics */
+	struct net_stats_nbr_cache ipv6_nbr;
+#endif
+
 #if defined(CONFIG_NET_STATISTICS_UDP)
 	/** UDP statistics */
 	struct net_stats_udp udp;
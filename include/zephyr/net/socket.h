@@ -948,7 +948,7 @@ struct ifreq {
 /** sockopt: Size of socket recv buffer */
 #define SO_RCVBUF 8
 
-/** sockopt: Enable sending keep-alive messages on connections (ignored, for compatibility) */
+/** sockopt: Enable sending keep-alive messages on connections */
 #define SO_KEEPALIVE 9
 /** sockopt: Place out-of-band data into receive stream (ignored, for compatibility) */
 #define SO_OOBINLINE 10
@@ -977,11 +977,22 @@ struct ifreq {
 /** sockopt: Domain used with SOCKET (ignored, for compatibility) */
 #define SO_DOMAIN 39
 
+/** sockopt: Time in usec to poll the interface before blocking on receive */
+#define SO_BUSY_POLL 46
+
 /** End Socket options for SOL_SOCKET level */
 
 /* Socket options for IPPROTO_TCP level */
 /** sockopt: Disable TCP buffering (ignored, for compatibility) */
 #define TCP_NODELAY 1
+/** sockopt: Idle time in seconds before sending keep-alive probes */
+#define TCP_KEEPIDLE 4
+/** sockopt: Time in seconds between keep-alive probes */
+#define TCP_KEEPINTVL 5
+/** sockopt: Number of unanswered keep-alive probes before closing */
+#define TCP_KEEPCNT 6
+/** sockopt: Time in milliseconds sent data may stay unacknowledged */
+#define TCP_USER_TIMEOUT 18
 
 /* Socket options for IPPROTO_IPV6 level */
 /** sockopt: Don't support IPv4 access (ignored, for compatibility) */
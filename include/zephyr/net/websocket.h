@@ -166,7 +166,10 @@ int websocket_send_msg(int ws_sock, const uint8_t *payload, size_t payload_len,
  *        The value is in milliseconds. Value SYS_FOREVER_MS means to wait
  *        forever.
  *
- * @return <0 if error, >=0 amount of bytes received
+ * @return <0 if error, >=0 amount of bytes received. 0 means that the
+ * connection was closed. A frame without payload, like a ping, pong or
+ * close frame, returns -EAGAIN with @p message_type set to its type and
+ * @p remaining set to 0.
  */
 int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 		       uint32_t *message_type, uint64_t *remaining,
@@ -27,6 +27,8 @@ struct net_6lo_context {
 	struct in6_addr prefix;
 	struct net_if *iface;
 	uint16_t lifetime;
+	uint8_t next_prefix;	/* Next in the prefix hash chain */
+	uint8_t next_cid;	/* Next in the CID hash chain */
 	uint8_t is_used		: 1;
 	uint8_t compress	: 1;
 	uint8_t cid		: 4;
@@ -44,6 +46,43 @@ static inline uint8_t get_6co_cid(struct net_icmpv6_nd_opt_6co *opt)
 }
 
 static struct net_6lo_context ctx_6co[CONFIG_NET_MAX_6LO_CONTEXTS];
+
+/* The contexts are looked up for every compressed and uncompressed packet,
+ * so they are hashed on the interface and the prefix, and on the interface
+ * and the CID. The buckets and the chain links hold the index of the
+ * context plus one, zero ends a chain.
+ */
+#define NET_6LO_CTX_BUCKETS 16U
+
+static uint8_t ctx_prefix_bucket[NET_6LO_CTX_BUCKETS];
+static uint8_t ctx_cid_bucket[NET_6LO_CTX_BUCKETS];
+#endif
+
+#if defined(CONFIG_NET_6LO_COMPRESS_CACHE)
+/* How the addresses of a flow were compressed. The result only depends on
+ * the IPv6 and link layer addresses, and on the contexts of the interface.
+ */
+struct net_6lo_flow {
+	struct in6_addr src;
+	struct in6_addr dst;
+	struct net_if *iface;
+	uint8_t ll_src[NET_LINK_ADDR_MAX_LENGTH];
+	uint8_t ll_dst[NET_LINK_ADDR_MAX_LENGTH];
+	uint8_t ll_src_len;
+	uint8_t ll_dst_len;
+	uint16_t iphc;		/* CID, SAC, SAM, M, DAC and DAM bits */
+	uint8_t cid;		/* CID extension, if CID is set */
+	uint8_t inline_len;
+	uint8_t inline_addr[2 * sizeof(struct in6_addr)];
+	bool is_used;
+};
+
+#define NET_6LO_IPHC_ADDR_MASK (NET_6LO_IPHC_CID_MASK | \
+				NET_6LO_IPHC_SA_MASK | \
+				NET_6LO_IPHC_DA_MASK)
+
+static struct net_6lo_flow flow_cache[CONFIG_NET_6LO_COMPRESS_CACHE_SIZE];
+static struct k_spinlock flow_cache_lock;
 #endif
 
 static const uint8_t udp_nhc_inline_size_table[] = {4, 3, 3, 1};
@@ -155,7 +194,186 @@ static inline bool net_6lo_maddr_48_bit_compressible(struct in6_addr *addr)
 		 (addr->s6_addr[10] == 0x00));
 }
 
+#if defined(CONFIG_NET_6LO_COMPRESS_CACHE)
+static inline uint32_t flow_hash(struct net_pkt *pkt,
+				 struct net_ipv6_hdr *ipv6)
+{
+	uint32_t hash = 2166136261U;
+	uint8_t i;
+
+	hash = (hash ^ POINTER_TO_UINT(net_pkt_iface(pkt))) * 16777619U;
+
+	for (i = 0U; i < sizeof(struct in6_addr); i += sizeof(uint32_t)) {
+		hash = (hash ^ UNALIGNED_GET((uint32_t *)&ipv6->src[i])) *
+		       16777619U;
+		hash = (hash ^ UNALIGNED_GET((uint32_t *)&ipv6->dst[i])) *
+		       16777619U;
+	}
+
+	return hash ^ (hash >> 16);
+}
+
+static inline uint8_t flow_lladdr_len(struct net_linkaddr *lladdr)
+{
+	return lladdr->addr ? lladdr->len : 0U;
+}
+
+static inline bool flow_lladdr_match(const uint8_t *addr, uint8_t len,
+				     struct net_linkaddr *lladdr)
+{
+	return len == flow_lladdr_len(lladdr) &&
+	       (len == 0U || !memcmp(addr, lladdr->addr, len));
+}
+
+static bool flow_match(struct net_6lo_flow *flow, struct net_pkt *pkt,
+		       struct net_ipv6_hdr *ipv6)
+{
+	return flow->is_used &&
+	       flow->iface == net_pkt_iface(pkt) &&
+	       !memcmp(flow->src.s6_addr, ipv6->src, sizeof(flow->src)) &&
+	       !memcmp(flow->dst.s6_addr, ipv6->dst, sizeof(flow->dst)) &&
+	       flow_lladdr_match(flow->ll_src, flow->ll_src_len,
+				 net_pkt_lladdr_src(pkt)) &&
+	       flow_lladdr_match(flow->ll_dst, flow->ll_dst_len,
+				 net_pkt_lladdr_dst(pkt));
+}
+
+/* On a hit, the cached address fields are put right before inline_ptr */
+static uint8_t *flow_cache_get(struct net_pkt *pkt, struct net_ipv6_hdr *ipv6,
+			       uint32_t hash, uint8_t *inline_ptr,
+			       uint16_t *iphc, uint8_t *cid)
+{
+	struct net_6lo_flow *flow;
+	k_spinlock_key_t key;
+
+	flow = &flow_cache[hash % CONFIG_NET_6LO_COMPRESS_CACHE_SIZE];
+
+	key = k_spin_lock(&flow_cache_lock);
+
+	if (!flow_match(flow, pkt, ipv6)) {
+		k_spin_unlock(&flow_cache_lock, key);
+		return NULL;
+	}
+
+	/* The addresses are not used anymore once they are matched, so the
+	 * inlined fields can overwrite them.
+	 */
+	inline_ptr -= flow->inline_len;
+	memcpy(inline_ptr, flow->inline_addr, flow->inline_len);
+
+	*iphc |= flow->iphc;
+	*cid = flow->cid;
+
+	k_spin_unlock(&flow_cache_lock, key);
+
+	NET_DBG("Addresses compressed from flow cache");
+
+	return inline_ptr;
+}
+
+static void flow_cache_put(struct net_pkt *pkt, uint32_t hash,
+			   struct in6_addr *src, struct in6_addr *dst,
+			   uint8_t *inline_ptr, uint8_t inline_len,
+			   uint16_t iphc, uint8_t cid)
+{
+	struct net_linkaddr *ll_src = net_pkt_lladdr_src(pkt);
+	struct net_linkaddr *ll_dst = net_pkt_lladdr_dst(pkt);
+	struct net_6lo_flow *flow;
+	k_spinlock_key_t key;
+
+	if (flow_lladdr_len(ll_src) > NET_LINK_ADDR_MAX_LENGTH ||
+	    flow_lladdr_len(ll_dst) > NET_LINK_ADDR_MAX_LENGTH ||
+	    inline_len > sizeof(flow->inline_addr)) {
+		return;
+	}
+
+	flow = &flow_cache[hash % CONFIG_NET_6LO_COMPRESS_CACHE_SIZE];
+
+	key = k_spin_lock(&flow_cache_lock);
+
+	net_ipv6_addr_copy_raw(flow->src.s6_addr, src->s6_addr);
+	net_ipv6_addr_copy_raw(flow->dst.s6_addr, dst->s6_addr);
+	flow->iface = net_pkt_iface(pkt);
+
+	flow->ll_src_len = flow_lladdr_len(ll_src);
+	memcpy(flow->ll_src, ll_src->addr, flow->ll_src_len);
+
+	flow->ll_dst_len = flow_lladdr_len(ll_dst);
+	memcpy(flow->ll_dst, ll_dst->addr, flow->ll_dst_len);
+
+	flow->iphc = iphc & NET_6LO_IPHC_ADDR_MASK;
+	flow->cid = cid;
+	flow->inline_len = inline_len;
+	memcpy(flow->inline_addr, inline_ptr, inline_len);
+	flow->is_used = true;
+
+	k_spin_unlock(&flow_cache_lock, key);
+}
+
+static inline void flow_cache_flush(void)
+{
+	k_spinlock_key_t key;
+	uint8_t i;
+
+	key = k_spin_lock(&flow_cache_lock);
+
+	for (i = 0U; i < CONFIG_NET_6LO_COMPRESS_CACHE_SIZE; i++) {
+		flow_cache[i].is_used = false;
+	}
+
+	k_spin_unlock(&flow_cache_lock, key);
+}
+#else
+static inline void flow_cache_flush(void)
+{
+}
+#endif /* CONFIG_NET_6LO_COMPRESS_CACHE */
+
 #if defined(CONFIG_NET_6LO_CONTEXT)
+static inline uint8_t ctx_prefix_hash(struct net_if *iface,
+				      const uint8_t *prefix)
+{
+	uint32_t hash = POINTER_TO_UINT(iface) >> 2;
+
+	hash ^= UNALIGNED_GET((uint32_t *)&prefix[0]);
+	hash ^= UNALIGNED_GET((uint32_t *)&prefix[4]);
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return hash % NET_6LO_CTX_BUCKETS;
+}
+
+static inline uint8_t ctx_cid_hash(struct net_if *iface, uint8_t cid)
+{
+	return ((POINTER_TO_UINT(iface) >> 2) + cid) % NET_6LO_CTX_BUCKETS;
+}
+
+/* Contexts change rarely, so the chains are simply rebuilt */
+static void rehash_6lo_contexts(void)
+{
+	uint8_t bucket;
+	int i;
+
+	memset(ctx_prefix_bucket, 0, sizeof(ctx_prefix_bucket));
+	memset(ctx_cid_bucket, 0, sizeof(ctx_cid_bucket));
+
+	/* Going backwards keeps the chains in table order */
+	for (i = CONFIG_NET_MAX_6LO_CONTEXTS - 1; i >= 0; i--) {
+		if (!ctx_6co[i].is_used) {
+			continue;
+		}
+
+		bucket = ctx_prefix_hash(ctx_6co[i].iface,
+					 ctx_6co[i].prefix.s6_addr);
+		ctx_6co[i].next_prefix = ctx_prefix_bucket[bucket];
+		ctx_prefix_bucket[bucket] = i + 1;
+
+		bucket = ctx_cid_hash(ctx_6co[i].iface, ctx_6co[i].cid);
+		ctx_6co[i].next_cid = ctx_cid_bucket[bucket];
+		ctx_cid_bucket[bucket] = i + 1;
+	}
+}
+
 /* RFC 6775, 4.2, 5.4.2, 5.4.3 and 7.2*/
 static inline void set_6lo_context(struct net_if *iface, uint8_t index,
 				   struct net_icmpv6_nd_opt_6co *context)
@@ -170,6 +388,8 @@ static inline void set_6lo_context(struct net_if *iface, uint8_t index,
 	ctx_6co[index].cid = get_6co_cid(context);
 
 	net_ipv6_addr_copy_raw((uint8_t *)&ctx_6co[index].prefix, context->prefix);
+
+	rehash_6lo_contexts();
 }
 
 void net_6lo_set_context(struct net_if *iface,
@@ -178,6 +398,8 @@ void net_6lo_set_context(struct net_if *iface,
 	int unused = -1;
 	uint8_t i;
 
+	flow_cache_flush();
+
 	/* If the context information already exists, update or remove
 	 * as per data.
 	 */
@@ -192,6 +414,7 @@ void net_6lo_set_context(struct net_if *iface,
 			/* Remove if lifetime is zero */
 			if (!context->lifetime) {
 				ctx_6co[i].is_used = false;
+				rehash_6lo_contexts();
 				return;
 			}
 
@@ -214,16 +437,16 @@ void net_6lo_set_context(struct net_if *iface,
 static inline struct net_6lo_context *
 get_6lo_context_by_cid(struct net_if *iface, uint8_t cid)
 {
-	uint8_t i;
+	uint8_t i = ctx_cid_bucket[ctx_cid_hash(iface, cid)];
 
-	for (i = 0U; i < CONFIG_NET_MAX_6LO_CONTEXTS; i++) {
-		if (!ctx_6co[i].is_used) {
-			continue;
-		}
+	while (i) {
+		struct net_6lo_context *ctx = &ctx_6co[i - 1];
 
-		if (ctx_6co[i].iface == iface && ctx_6co[i].cid == cid) {
-			return &ctx_6co[i];
+		if (ctx->is_used && ctx->iface == iface && ctx->cid == cid) {
+			return ctx;
 		}
+
+		i = ctx->next_cid;
 	}
 
 	return NULL;
@@ -233,17 +456,17 @@ get_6lo_context_by_cid(struct net_if *iface, uint8_t cid)
 static inline struct net_6lo_context *
 get_6lo_context_by_addr(struct net_if *iface, struct in6_addr *addr)
 {
-	uint8_t i;
+	uint8_t i = ctx_prefix_bucket[ctx_prefix_hash(iface, addr->s6_addr)];
 
-	for (i = 0U; i < CONFIG_NET_MAX_6LO_CONTEXTS; i++) {
-		if (!ctx_6co[i].is_used) {
-			continue;
-		}
+	while (i) {
+		struct net_6lo_context *ctx = &ctx_6co[i - 1];
 
-		if (ctx_6co[i].iface == iface &&
-		    !memcmp(ctx_6co[i].prefix.s6_addr, addr->s6_addr, 8)) {
-			return &ctx_6co[i];
+		if (ctx->is_used && ctx->iface == iface &&
+		    !memcmp(ctx->prefix.s6_addr, addr->s6_addr, 8)) {
+			return ctx;
 		}
+
+		i = ctx->next_prefix;
 	}
 
 	return NULL;
@@ -730,12 +953,18 @@ static inline int compress_IPHC_header(struct net_pkt *pkt)
 #if defined(CONFIG_NET_6LO_CONTEXT)
 	struct net_6lo_context *src_ctx = NULL;
 	struct net_6lo_context *dst_ctx = NULL;
+#endif
+#if defined(CONFIG_NET_6LO_COMPRESS_CACHE)
+	struct in6_addr src, dst;
+	uint8_t *addr_pos;
+	uint32_t hash;
 #endif
 	uint8_t compressed = 0;
 	uint16_t iphc = (NET_6LO_DISPATCH_IPHC << 8);
 	struct net_ipv6_hdr *ipv6 = NET_IPV6_HDR(pkt);
 	struct net_udp_hdr *udp;
 	uint8_t *inline_pos;
+	uint8_t cid = 0U;
 
 	if (pkt->frags->len < NET_IPV6H_LEN) {
 		NET_ERR("Invalid length %d, min %d",
@@ -759,6 +988,21 @@ static inline int compress_IPHC_header(struct net_pkt *pkt)
 		inline_pos = compress_nh_udp(udp, inline_pos, false);
 	}
 
+#if defined(CONFIG_NET_6LO_COMPRESS_CACHE)
+	hash = flow_hash(pkt, ipv6);
+
+	addr_pos = flow_cache_get(pkt, ipv6, hash, inline_pos, &iphc, &cid);
+	if (addr_pos) {
+		inline_pos = addr_pos;
+		goto addr_end;
+	}
+
+	/* The addresses get overwritten while being compressed */
+	net_ipv6_addr_copy_raw(src.s6_addr, ipv6->src);
+	net_ipv6_addr_copy_raw(dst.s6_addr, ipv6->dst);
+	addr_pos = inline_pos;
+#endif
+
 	if (net_6lo_ll_prefix_padded_with_zeros((struct in6_addr *)ipv6->dst)) {
 		inline_pos = compress_da(ipv6, pkt, inline_pos, &iphc);
 		goto da_end;
@@ -807,24 +1051,30 @@ da_end:
 	inline_pos = set_sa_inline(ipv6, inline_pos, &iphc);
 sa_end:
 
+#if defined(CONFIG_NET_6LO_CONTEXT)
+	if (src_ctx) {
+		cid = src_ctx->cid << 4;
+	}
+
+	if (dst_ctx) {
+		cid |= dst_ctx->cid & 0x0F;
+	}
+#endif
+
+#if defined(CONFIG_NET_6LO_COMPRESS_CACHE)
+	flow_cache_put(pkt, hash, &src, &dst, inline_pos,
+		       addr_pos - inline_pos, iphc, cid);
+addr_end:
+#endif
+
 	inline_pos = compress_hoplimit(ipv6, inline_pos, &iphc);
 	inline_pos = compress_nh(ipv6, inline_pos, &iphc);
 	inline_pos = compress_tfl(ipv6, inline_pos, &iphc);
 
-#if defined(CONFIG_NET_6LO_CONTEXT)
 	if (iphc & NET_6LO_IPHC_CID_1) {
 		inline_pos -= sizeof(uint8_t);
-		*inline_pos = 0;
-
-		if (src_ctx) {
-			*inline_pos = src_ctx->cid << 4;
-		}
-
-		if (dst_ctx) {
-			*inline_pos |= dst_ctx->cid & 0x0F;
-		}
+		*inline_pos = cid;
 	}
-#endif
 
 	inline_pos -= sizeof(iphc);
 	iphc = htons(iphc);
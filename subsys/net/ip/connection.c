@@ -823,6 +823,12 @@ enum net_verdict net_conn_input(struct net_pkt *pkt,
 
 	NET_DBG("No match found.");
 
+	/* The connection might have been released in TIME_WAIT state */
+	if (IS_ENABLED(CONFIG_NET_TCP) && proto == IPPROTO_TCP &&
+	    net_tcp_time_wait_input(pkt)) {
+		goto drop;
+	}
+
 	/* Do not send ICMP error for Packet socket as that makes no
 	 * sense here.
 	 */
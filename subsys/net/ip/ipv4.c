@@ -24,6 +24,7 @@ LOG_MODULE_REGISTER(net_ipv4, CONFIG_NET_IPV4_LOG_LEVEL);
 #include "udp_internal.h"
 #include "tcp_internal.h"
 #include "ipv4.h"
+#include "route.h"
 
 BUILD_ASSERT(sizeof(struct in_addr) == NET_IPV4_ADDR_SIZE);
 
@@ -212,6 +213,72 @@ int net_ipv4_parse_hdr_options(struct net_pkt *pkt,
 }
 #endif
 
+#if defined(CONFIG_NET_ROUTE_IPV4)
+static enum net_verdict ipv4_route_packet(struct net_pkt *pkt,
+					  struct net_ipv4_hdr *hdr)
+{
+	struct net_route_entry_ipv4 route;
+	uint32_t chksum;
+	int ret;
+
+	if (net_ipv4_is_addr_bcast(net_pkt_iface(pkt),
+				   (struct in_addr *)hdr->dst) ||
+	    net_ipv4_addr_cmp((struct in_addr *)hdr->dst,
+			      net_ipv4_broadcast_address()) ||
+	    net_ipv4_is_addr_unspecified((struct in_addr *)hdr->src)) {
+		goto drop;
+	}
+
+	/* Work on a copy as the route can be changed or deleted while the
+	 * packet is being forwarded.
+	 */
+	if (!net_route_ipv4_lookup_copy((struct in_addr *)hdr->dst, &route)) {
+		NET_DBG("No route to %s pkt %p dropped",
+			net_sprint_ipv4_addr(&hdr->dst), pkt);
+		goto drop;
+	}
+
+	if (hdr->ttl <= 1) {
+		NET_DBG("DROP: TTL exceeded for pkt %p", pkt);
+		net_icmpv4_send_error(pkt, NET_ICMPV4_TIME_EXCEEDED,
+				      NET_ICMPV4_TIME_EXCEEDED_TTL);
+		goto drop;
+	}
+
+	/* The header is in the packet buffer, so update it in place. The
+	 * checksum is adjusted incrementally as only the TTL changes,
+	 * see RFC 1624.
+	 */
+	hdr->ttl--;
+	chksum = (uint32_t)hdr->chksum + htons(0x0100);
+	hdr->chksum = (uint16_t)(chksum + (chksum >= 0xffff));
+
+	ret = net_route_ipv4_packet(pkt, &route);
+	if (ret < 0) {
+		NET_DBG("Cannot re-route pkt %p via %s at iface %p (%d)",
+			pkt, net_sprint_ipv4_addr(
+				net_route_ipv4_get_nexthop(
+					&route, (struct in_addr *)hdr->dst)),
+			route.iface, ret);
+		goto drop;
+	}
+
+	return NET_OK;
+
+drop:
+	return NET_DROP;
+}
+#else
+static inline enum net_verdict ipv4_route_packet(struct net_pkt *pkt,
+						 struct net_ipv4_hdr *hdr)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(hdr);
+
+	return NET_DROP;
+}
+#endif /* CONFIG_NET_ROUTE_IPV4 */
+
 enum net_verdict net_ipv4_input(struct net_pkt *pkt)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
@@ -300,6 +367,15 @@ enum net_verdict net_ipv4_input(struct net_pkt *pkt)
 				   net_ipv4_unspecified_address()))))) ||
 	    (hdr->proto == IPPROTO_TCP &&
 	     net_ipv4_is_addr_bcast(net_pkt_iface(pkt), (struct in_addr *)hdr->dst))) {
+		if (IS_ENABLED(CONFIG_NET_ROUTE_IPV4) &&
+		    !net_ipv4_is_my_addr((struct in_addr *)hdr->dst) &&
+		    !net_ipv4_is_addr_mcast((struct in_addr *)hdr->dst)) {
+			verdict = ipv4_route_packet(pkt, hdr);
+			if (verdict == NET_OK) {
+				return verdict;
+			}
+		}
+
 		NET_DBG("DROP: not for me");
 		goto drop;
 	}
@@ -318,6 +394,16 @@ enum net_verdict net_ipv4_input(struct net_pkt *pkt)
 
 	net_pkt_set_family(pkt, PF_INET);
 
+	if (IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT) &&
+	    ((hdr->offset[0] << 8) | hdr->offset[1]) &
+	    (NET_IPV4_MORE_FRAG_MASK | NET_IPV4_FRAGH_OFFSET_MASK)) {
+		verdict = net_ipv4_handle_fragment_hdr(pkt, hdr);
+		if (verdict == NET_DROP) {
+			goto drop;
+		}
+		return verdict;
+	}
+
 	NET_DBG("IPv4 packet received from %s to %s",
 		net_sprint_ipv4_addr(&hdr->src),
 		net_sprint_ipv4_addr(&hdr->dst));
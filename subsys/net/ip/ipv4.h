@@ -29,6 +29,8 @@
 #define NET_IPV4_OPTS_TS   68  /* Timestamp */
 #define NET_IPV4_OPTS_RA   148 /* Router Alert */
 
+#define NET_IPV4_OPTS_COPIED 0x80 /* Option is copied into all fragments */
+
 /* IPv4 Options Timestamp flags */
 #define NET_IPV4_TS_OPT_TS_ONLY	0 /* Timestamp only */
 #define NET_IPV4_TS_OPT_TS_ADDR	1 /* Timestamp and address */
@@ -204,4 +206,49 @@ static inline int net_ipv4_parse_hdr_options(struct net_pkt *pkt,
 }
 #endif
 
+/**
+ * @brief Handles IPv4 fragmented packets.
+ *
+ * @param pkt Network head packet, the cursor is after the IPv4 header
+ *        and options.
+ * @param hdr The IPv4 header of the current packet
+ *
+ * @return Return verdict about the packet
+ */
+#if defined(CONFIG_NET_IPV4_FRAGMENT) && defined(CONFIG_NET_NATIVE_IPV4)
+enum net_verdict net_ipv4_handle_fragment_hdr(struct net_pkt *pkt,
+					      struct net_ipv4_hdr *hdr);
+#else
+static inline
+enum net_verdict net_ipv4_handle_fragment_hdr(struct net_pkt *pkt,
+					      struct net_ipv4_hdr *hdr)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(hdr);
+
+	return NET_DROP;
+}
+#endif /* CONFIG_NET_IPV4_FRAGMENT */
+
+/**
+ * @brief Split the IPv4 packet into fragments if it does not fit in the
+ * MTU of the network interface. The fragments are sent separately and
+ * the original packet is released.
+ *
+ * @param pkt Network packet
+ *
+ * @return NET_OK if the packet can be sent as is, NET_CONTINUE if it was
+ *         fragmented, NET_DROP if it cannot be sent.
+ */
+#if defined(CONFIG_NET_IPV4_FRAGMENT) && defined(CONFIG_NET_NATIVE_IPV4)
+enum net_verdict net_ipv4_prepare_for_send(struct net_pkt *pkt);
+#else
+static inline enum net_verdict net_ipv4_prepare_for_send(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return NET_OK;
+}
+#endif /* CONFIG_NET_IPV4_FRAGMENT */
+
 #endif /* __IPV4_H */
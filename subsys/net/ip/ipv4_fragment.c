@@ -0,0 +1,356 @@
+/** @file
+ * @brief IPv4 Fragment related functions
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_ipv4, CONFIG_NET_IPV4_LOG_LEVEL);
+
+#include <errno.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/net_stats.h>
+#include <zephyr/net/net_context.h>
+#include <zephyr/random/rand32.h>
+#include "net_private.h"
+#include "ipv4.h"
+#include "reassembly.h"
+
+#define BUF_ALLOC_TIMEOUT K_MSEC(100)
+
+static void reassemble_packet(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+
+	/* The payload of all the fragments has been chained to the first
+	 * one, only its header needs to be fixed.
+	 */
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!hdr) {
+		goto error;
+	}
+
+	hdr->len = htons(net_pkt_get_len(pkt));
+	hdr->offset[0] = 0U;
+	hdr->offset[1] = 0U;
+	hdr->chksum = 0U;
+	hdr->chksum = net_calc_chksum_ipv4(pkt);
+
+	net_pkt_set_data(pkt, &ipv4_access);
+
+	NET_DBG("New pkt %p IPv4 len is %zd bytes", pkt, net_pkt_get_len(pkt));
+
+	/* The packet is fed back to the IP stack through the RX queue. It
+	 * has no link layer header so process_data() does not pass it to L2.
+	 */
+	net_pkt_set_ip_reassembled(pkt, true);
+
+	if (net_recv_data(net_pkt_iface(pkt), pkt) >= 0) {
+		return;
+	}
+error:
+	net_pkt_unref(pkt);
+}
+
+enum net_verdict net_ipv4_handle_fragment_hdr(struct net_pkt *pkt,
+					      struct net_ipv4_hdr *hdr)
+{
+	struct net_reassembly_key key = { 0 };
+	struct net_pkt *complete;
+	size_t payload_len;
+	uint16_t hdr_len;
+	uint16_t offset;
+	bool more;
+	int ret;
+
+	net_pkt_set_ipv4_fragment_flags(pkt, (hdr->offset[0] << 8) |
+					hdr->offset[1]);
+	net_pkt_set_ipv4_fragment_id(pkt, (hdr->id[0] << 8) | hdr->id[1]);
+
+	hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv4_opts_len(pkt);
+	payload_len = net_pkt_get_len(pkt) - hdr_len;
+	offset = net_pkt_ipv4_fragment_offset(pkt);
+	more = net_pkt_ipv4_fragment_more(pkt);
+
+	if (more && payload_len % 8) {
+		NET_DBG("DROP: fragment length %zd is not multiple of 8",
+			payload_len);
+		return NET_DROP;
+	}
+
+	/* The reassembled packet must fit in the total length field */
+	if (hdr_len + offset + payload_len > UINT16_MAX) {
+		NET_DBG("DROP: fragment beyond max packet size");
+		return NET_DROP;
+	}
+
+	key.src.family = AF_INET;
+	key.dst.family = AF_INET;
+	net_ipv4_addr_copy_raw((uint8_t *)&key.src.in_addr, hdr->src);
+	net_ipv4_addr_copy_raw((uint8_t *)&key.dst.in_addr, hdr->dst);
+	key.id = net_pkt_ipv4_fragment_id(pkt);
+	key.proto = hdr->proto;
+
+	ret = net_reassembly_input(&key, pkt, offset, hdr_len, more, &complete);
+	if (ret < 0) {
+		NET_DBG("Cannot reassemble id 0x%x (%d), dropping pkt %p",
+			key.id, ret, pkt);
+		return NET_DROP;
+	}
+
+	if (complete) {
+		/* The last fragment received, reassemble the packet */
+		reassemble_packet(complete);
+	}
+
+	return NET_OK;
+}
+
+/* Only the options with the copied flag set are sent in all fragments,
+ * the other ones are replaced by No Operation options in the fragments
+ * following the first one so that the header length does not change.
+ */
+static void copied_options(const uint8_t *opts, uint8_t *copied, int len)
+{
+	int i = 0;
+
+	memset(copied, NET_IPV4_OPTS_NOP, len);
+
+	while (i < len) {
+		uint8_t opt_len;
+
+		if (opts[i] == NET_IPV4_OPTS_EO) {
+			break;
+		}
+
+		if (opts[i] == NET_IPV4_OPTS_NOP) {
+			i++;
+			continue;
+		}
+
+		if (i + 1 >= len) {
+			break;
+		}
+
+		opt_len = opts[i + 1];
+		if (opt_len < 2 || i + opt_len > len) {
+			break;
+		}
+
+		if (opts[i] & NET_IPV4_OPTS_COPIED) {
+			memcpy(&copied[i], &opts[i], opt_len);
+		}
+
+		i += opt_len;
+	}
+}
+
+static int send_ipv4_fragment(struct net_pkt *pkt, uint16_t id,
+			      const uint8_t *opts,
+			      uint16_t fit_len,
+			      uint16_t frag_offset,
+			      bool final)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	uint8_t opts_len = net_pkt_ipv4_opts_len(pkt);
+	struct net_ipv4_hdr *frag_hdr;
+	struct net_pkt *frag_pkt;
+	uint16_t flags;
+	int ret = -ENOBUFS;
+
+	frag_pkt = net_pkt_alloc_with_buffer(net_pkt_iface(pkt),
+					     net_pkt_ip_hdr_len(pkt) +
+					     opts_len + fit_len,
+					     AF_INET, 0, BUF_ALLOC_TIMEOUT);
+	if (!frag_pkt) {
+		return -ENOMEM;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	/* Copy the IPv4 header and options, then the payload part of this
+	 * fragment from the original packet.
+	 */
+	if (net_pkt_copy(frag_pkt, pkt, net_pkt_ip_hdr_len(pkt)) ||
+	    (opts_len && net_pkt_write(frag_pkt, opts, opts_len)) ||
+	    net_pkt_skip(pkt, opts_len + frag_offset) ||
+	    net_pkt_copy(frag_pkt, pkt, fit_len)) {
+		goto fail;
+	}
+
+	net_pkt_set_ip_hdr_len(frag_pkt, net_pkt_ip_hdr_len(pkt));
+	net_pkt_set_ipv4_opts_len(frag_pkt, opts_len);
+
+	flags = frag_offset / 8U;
+	if (!final) {
+		flags |= NET_IPV4_MORE_FRAG_MASK;
+	}
+
+	net_pkt_set_ipv4_fragment_flags(frag_pkt, flags);
+	net_pkt_set_ipv4_fragment_id(frag_pkt, id);
+
+	net_pkt_cursor_init(frag_pkt);
+	net_pkt_set_overwrite(frag_pkt, true);
+
+	frag_hdr = (struct net_ipv4_hdr *)net_pkt_get_data(frag_pkt,
+							   &ipv4_access);
+	if (!frag_hdr) {
+		goto fail;
+	}
+
+	frag_hdr->len = htons(net_pkt_get_len(frag_pkt));
+	frag_hdr->id[0] = id >> 8;
+	frag_hdr->id[1] = id;
+	frag_hdr->offset[0] = flags >> 8;
+	frag_hdr->offset[1] = flags;
+	frag_hdr->chksum = 0U;
+
+	if (net_if_need_calc_tx_checksum(net_pkt_iface(frag_pkt))) {
+		frag_hdr->chksum = net_calc_chksum_ipv4(frag_pkt);
+	}
+
+	if (net_pkt_set_data(frag_pkt, &ipv4_access)) {
+		goto fail;
+	}
+
+	/* If everything has been ok so far, we can send the packet. */
+	ret = net_send_data(frag_pkt);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	NET_DBG("Cannot send fragment (%d)", ret);
+	net_pkt_unref(frag_pkt);
+
+	return ret;
+}
+
+static int send_fragmented_pkt(struct net_pkt *pkt, uint16_t mtu)
+{
+	uint8_t opts[NET_IPV4_HDR_OPTNS_MAX_LEN];
+	uint8_t copied[NET_IPV4_HDR_OPTNS_MAX_LEN];
+	uint8_t opts_len = net_pkt_ipv4_opts_len(pkt);
+	uint16_t id = sys_rand32_get();
+	uint16_t frag_offset;
+	size_t length;
+	int fit_len;
+	int ret;
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt)) ||
+	    (opts_len && net_pkt_read(pkt, opts, opts_len))) {
+		return -ENOBUFS;
+	}
+
+	copied_options(opts, copied, opts_len);
+
+	/* The payload of all the fragments but the last one must be a
+	 * multiple of 8 bytes.
+	 */
+	fit_len = (mtu - net_pkt_ip_hdr_len(pkt) - opts_len) & ~7;
+	if (fit_len <= 0) {
+		NET_DBG("No room for IPv4 payload MTU %d hdrs_len %d",
+			mtu, net_pkt_ip_hdr_len(pkt) + opts_len);
+		return -EINVAL;
+	}
+
+	frag_offset = 0U;
+
+	length = net_pkt_get_len(pkt) - (net_pkt_ip_hdr_len(pkt) + opts_len);
+	while (length) {
+		bool final = false;
+
+		if (fit_len >= length) {
+			final = true;
+			fit_len = length;
+		}
+
+		ret = send_ipv4_fragment(pkt, id,
+					 frag_offset ? copied : opts,
+					 fit_len, frag_offset, final);
+		if (ret < 0) {
+			return ret;
+		}
+
+		length -= fit_len;
+		frag_offset += fit_len;
+	}
+
+	return 0;
+}
+
+enum net_verdict net_ipv4_prepare_for_send(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *ip_hdr;
+	size_t pkt_len;
+	uint16_t mtu;
+	int ret;
+
+	/* Fragments created here are already small enough */
+	if (net_pkt_ipv4_fragment_more(pkt) ||
+	    net_pkt_ipv4_fragment_offset(pkt)) {
+		return NET_OK;
+	}
+
+	mtu = net_if_get_mtu(net_pkt_iface(pkt));
+	mtu = MAX(NET_IPV4_MTU, mtu);
+	pkt_len = net_pkt_get_len(pkt);
+
+	if (pkt_len <= mtu) {
+		return NET_OK;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	ip_hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!ip_hdr) {
+		return NET_DROP;
+	}
+
+	if ((ip_hdr->offset[0] << 8) & NET_IPV4_DO_NOT_FRAG_MASK) {
+		NET_DBG("DROP: pkt %p %zd bytes larger than MTU %d with DF set",
+			pkt, pkt_len, mtu);
+		return NET_DROP;
+	}
+
+	ret = send_fragmented_pkt(pkt, mtu);
+	if (ret < 0) {
+		NET_DBG("Cannot fragment IPv4 pkt (%d)", ret);
+
+		if (ret == -ENOMEM) {
+			/* Try to send the packet if we could not allocate
+			 * enough network packets and hope the original large
+			 * packet can be sent ok.
+			 */
+			return NET_OK;
+		}
+	}
+
+	/* We "fake" the sending of the packet here so that
+	 * tcp.c:tcp_retry_expired() will increase the ref count when
+	 * re-sending the packet, like it is done for IPv6.
+	 */
+	if (IS_ENABLED(CONFIG_NET_TCP)) {
+		net_pkt_set_sent(pkt, true);
+	}
+
+	/* We need to unref here because we simulate the packet sending,
+	 * the fragments are sent separately to network.
+	 */
+	net_pkt_unref(pkt);
+
+	return NET_CONTINUE;
+}
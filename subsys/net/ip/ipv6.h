@@ -398,49 +398,6 @@ static inline void net_ipv6_nbr_set_reachable_timer(struct net_if *iface,
 }
 #endif
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
-/** Store pending IPv6 fragment information that is needed for reassembly. */
-struct net_ipv6_reassembly {
-	/** IPv6 source address of the fragment */
-	struct in6_addr src;
-
-	/** IPv6 destination address of the fragment */
-	struct in6_addr dst;
-
-	/**
-	 * Timeout for cancelling the reassembly. The timer is used
-	 * also to detect if this reassembly slot is used or not.
-	 */
-	struct k_work_delayable timer;
-
-	/** Pointers to pending fragments */
-	struct net_pkt *pkt[CONFIG_NET_IPV6_FRAGMENT_MAX_PKT];
-
-	/** IPv6 fragment identification */
-	uint32_t id;
-};
-#else
-struct net_ipv6_reassembly;
-#endif
-
-/**
- * @typedef net_ipv6_frag_cb_t
- * @brief Callback used while iterating over pending IPv6 fragments.
- *
- * @param reass IPv6 fragment reassembly struct
- * @param user_data A valid pointer on some user data or NULL
- */
-typedef void (*net_ipv6_frag_cb_t)(struct net_ipv6_reassembly *reass,
-				   void *user_data);
-
-/**
- * @brief Go through all the currently pending IPv6 fragments.
- *
- * @param cb Callback to call for each pending IPv6 fragment.
- * @param user_data User specified data or NULL.
- */
-void net_ipv6_frag_foreach(net_ipv6_frag_cb_t cb, void *user_data);
-
 /**
  * @brief Find the last IPv6 extension header in the network packet.
  *
@@ -254,12 +254,136 @@ void nbr_print(void)
 #define nbr_print(...)
 #endif
 
+/* Neighbors are also linked into a small hash table by pool index so that
+ * the TX path does not need to scan the whole pool. Readers do not take any
+ * lock, the sequence counter tells them if the chains were modified while
+ * they were walking them.
+ */
+#define NBR_HASH_END 0xff
+
+static uint8_t nbr_hash[CONFIG_NET_IPV6_NBR_HASH_SIZE] = {
+	[0 ... (CONFIG_NET_IPV6_NBR_HASH_SIZE - 1)] = NBR_HASH_END
+};
+static uint8_t nbr_hash_next[CONFIG_NET_IPV6_MAX_NEIGHBORS];
+static uint8_t nbr_hash_bucket[CONFIG_NET_IPV6_MAX_NEIGHBORS] = {
+	[0 ... (CONFIG_NET_IPV6_MAX_NEIGHBORS - 1)] = NBR_HASH_END
+};
+static atomic_t nbr_hash_seq;
+static struct k_spinlock nbr_hash_lock;
+
+static inline uint8_t nbr_hash_index(const struct in6_addr *addr)
+{
+	uint32_t key = UNALIGNED_GET(&addr->s6_addr32[2]) ^
+		       UNALIGNED_GET(&addr->s6_addr32[3]);
+
+	return ((key * 0x9e3779b1U) >> 16) % CONFIG_NET_IPV6_NBR_HASH_SIZE;
+}
+
+static inline int nbr_pool_index(struct net_nbr *nbr)
+{
+	return ((uint8_t *)nbr - (uint8_t *)&net_neighbor_pool[0].nbr) /
+		sizeof(net_neighbor_pool[0]);
+}
+
+static void nbr_hash_unlink(int idx)
+{
+	uint8_t *slot = &nbr_hash[nbr_hash_bucket[idx]];
+
+	while (*slot != NBR_HASH_END) {
+		if (*slot == idx) {
+			*slot = nbr_hash_next[idx];
+			break;
+		}
+
+		slot = &nbr_hash_next[*slot];
+	}
+
+	nbr_hash_bucket[idx] = NBR_HASH_END;
+}
+
+static void nbr_hash_add(struct net_nbr *nbr)
+{
+	int idx = nbr_pool_index(nbr);
+	uint8_t bucket = nbr_hash_index(&net_ipv6_nbr_data(nbr)->addr);
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&nbr_hash_lock);
+	atomic_inc(&nbr_hash_seq);
+
+	if (nbr_hash_bucket[idx] != NBR_HASH_END) {
+		nbr_hash_unlink(idx);
+	}
+
+	nbr_hash_next[idx] = nbr_hash[bucket];
+	nbr_hash_bucket[idx] = bucket;
+	nbr_hash[bucket] = idx;
+
+	atomic_inc(&nbr_hash_seq);
+	k_spin_unlock(&nbr_hash_lock, key);
+}
+
+static void nbr_hash_remove(struct net_nbr *nbr)
+{
+	int idx = nbr_pool_index(nbr);
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&nbr_hash_lock);
+
+	if (nbr_hash_bucket[idx] != NBR_HASH_END) {
+		atomic_inc(&nbr_hash_seq);
+		nbr_hash_unlink(idx);
+		atomic_inc(&nbr_hash_seq);
+	}
+
+	k_spin_unlock(&nbr_hash_lock, key);
+}
+
+/* Returns false if the result cannot be trusted because the table was
+ * modified during the lookup.
+ */
+static bool nbr_hash_lookup(struct net_if *iface, const struct in6_addr *addr,
+			    struct net_nbr **found)
+{
+	atomic_val_t seq = atomic_get(&nbr_hash_seq);
+	uint8_t idx;
+	int count = 0;
+
+	*found = NULL;
+
+	if (seq & 1) {
+		return false;
+	}
+
+	idx = nbr_hash[nbr_hash_index(addr)];
+
+	/* A racing update could create a loop, so limit the walk */
+	while (idx < CONFIG_NET_IPV6_MAX_NEIGHBORS &&
+	       count++ < CONFIG_NET_IPV6_MAX_NEIGHBORS) {
+		struct net_nbr *nbr = get_nbr(idx);
+
+		if (nbr->ref && (!iface || nbr->iface == iface) &&
+		    net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, addr)) {
+			*found = nbr;
+			break;
+		}
+
+		idx = nbr_hash_next[idx];
+	}
+
+	return atomic_get(&nbr_hash_seq) == seq;
+}
+
 static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
 				  struct net_if *iface,
 				  const struct in6_addr *addr)
 {
+	struct net_nbr *found;
 	int i;
 
+	if (nbr_hash_lookup(iface, addr, &found)) {
+		return found;
+	}
+
 	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
 		struct net_nbr *nbr = get_nbr(i);
 
@@ -406,6 +530,7 @@ static void nbr_init(struct net_nbr *nbr, struct net_if *iface,
 	nbr->iface = iface;
 
 	net_ipaddr_copy(&net_ipv6_nbr_data(nbr)->addr, addr);
+	nbr_hash_add(nbr);
 	ipv6_nbr_set_state(nbr, state);
 	net_ipv6_nbr_data(nbr)->is_router = is_router;
 	net_ipv6_nbr_data(nbr)->pending = NULL;
@@ -539,6 +664,8 @@ static void ipv6_nd_remove_old_stale_nbr(void)
 			return;
 		}
 
+		net_stats_update_ipv6_nbr_evicted(nbr->iface);
+
 		net_ipv6_nbr_rm(nbr->iface,
 				&net_ipv6_nbr_data(nbr)->addr);
 	}
@@ -649,6 +776,8 @@ void net_neighbor_data_remove(struct net_nbr *nbr)
 {
 	NET_DBG("Neighbor %p removed", nbr);
 
+	nbr_hash_remove(nbr);
+
 	return;
 }
 
@@ -907,6 +1036,8 @@ try_send:
 	if (nbr && nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
 		struct net_linkaddr_storage *lladdr;
 
+		net_stats_update_ipv6_nbr_hit(net_pkt_iface(pkt));
+
 		lladdr = net_nbr_get_lladdr(nbr->idx);
 
 		net_pkt_lladdr_dst(pkt)->addr = lladdr->addr;
@@ -929,6 +1060,8 @@ try_send:
 		return NET_OK;
 	}
 
+	net_stats_update_ipv6_nbr_miss(net_pkt_iface(pkt));
+
 #if defined(CONFIG_NET_IPV6_ND)
 	/* We need to send NS and wait for NA before sending the packet. */
 	ret = net_ipv6_send_ns(net_pkt_iface(pkt), pkt,
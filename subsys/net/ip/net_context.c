@@ -1272,6 +1272,22 @@ static int get_context_sndbuf(struct net_context *context,
 #endif
 }
 
+static int get_context_busy_poll(struct net_context *context,
+				 void *value, size_t *len)
+{
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+	*((int *)value) = (int)context->options.busy_poll;
+
+	if (len) {
+		*len = sizeof(int);
+	}
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 /* If buf is not NULL, then use it. Otherwise read the data to be written
  * to net_pkt from msghdr.
  */
@@ -1376,6 +1392,83 @@ static void context_finalize_packet(struct net_context *context,
 	}
 }
 
+#if defined(CONFIG_NET_LOOPBACK_SOCKET_SHORTCUT)
+/* Hand a datagram sent to a local address directly to the receiving
+ * socket. The packet was just built by us, so the IP and UDP input checks
+ * are skipped and the headers are only used to find the receiver. Returns
+ * false if the packet must be sent through the stack.
+ */
+static bool context_deliver_local(struct net_context *context,
+				  struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(udp_access, struct net_udp_hdr);
+	union net_proto_header proto_hdr;
+	union net_ip_header ip_hdr;
+	size_t hdr_len;
+
+	net_pkt_cursor_init(pkt);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && net_pkt_family(pkt) == AF_INET) {
+		struct in_addr *dst;
+
+		ip_hdr.ipv4 = NET_IPV4_HDR(pkt);
+		dst = (struct in_addr *)ip_hdr.ipv4->dst;
+
+		if (!net_ipv4_is_addr_loopback(dst) &&
+		    (net_ipv4_is_addr_bcast(net_pkt_iface(pkt), dst) ||
+		     !net_ipv4_is_my_addr(dst))) {
+			return false;
+		}
+
+		hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv4_opts_len(pkt);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) &&
+		   net_pkt_family(pkt) == AF_INET6) {
+		struct in6_addr *dst;
+
+		ip_hdr.ipv6 = NET_IPV6_HDR(pkt);
+		dst = (struct in6_addr *)ip_hdr.ipv6->dst;
+
+		if (!net_ipv6_is_addr_loopback(dst) &&
+		    !net_ipv6_is_my_addr(dst)) {
+			return false;
+		}
+
+		hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ipv6_ext_len(pkt);
+	} else {
+		return false;
+	}
+
+	/* Leave the cursor at the payload, as the IP stack would */
+	net_pkt_set_overwrite(pkt, true);
+
+	if (net_pkt_skip(pkt, hdr_len)) {
+		goto send;
+	}
+
+	proto_hdr.udp = (struct net_udp_hdr *)net_pkt_get_data(pkt,
+							       &udp_access);
+	if (!proto_hdr.udp || net_pkt_acknowledge_data(pkt, &udp_access)) {
+		goto send;
+	}
+
+	NET_DBG("Local pkt %p passed to the receiving socket", pkt);
+
+	if (net_conn_input(pkt, &ip_hdr, net_context_get_ip_proto(context),
+			   &proto_hdr) == NET_DROP) {
+		net_pkt_unref(pkt);
+	}
+
+	return true;
+
+send:
+	net_pkt_set_overwrite(pkt, false);
+
+	return false;
+}
+#else
+#define context_deliver_local(context, pkt) false
+#endif /* CONFIG_NET_LOOPBACK_SOCKET_SHORTCUT */
+
 static struct net_pkt *context_alloc_pkt(struct net_context *context,
 					 size_t len, k_timeout_t timeout)
 {
@@ -1719,7 +1812,11 @@ static int context_sendto(struct net_context *context,
 
 		context_finalize_packet(context, pkt);
 
-		ret = net_send_data(pkt);
+		if (context_deliver_local(context, pkt)) {
+			ret = 0;
+		} else {
+			ret = net_send_data(pkt);
+		}
 	} else if (IS_ENABLED(CONFIG_NET_TCP) &&
 		   net_context_get_ip_proto(context) == IPPROTO_TCP) {
 
@@ -2292,6 +2389,28 @@ static int set_context_sndbuf(struct net_context *context,
 #endif
 }
 
+static int set_context_busy_poll(struct net_context *context,
+				 const void *value, size_t len)
+{
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+	int busy_poll_value = *((int *)value);
+
+	if (len != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	if (busy_poll_value < 0) {
+		return -EINVAL;
+	}
+
+	context->options.busy_poll = (uint32_t)busy_poll_value;
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 int net_context_set_option(struct net_context *context,
 			   enum net_context_option option,
 			   const void *value, size_t len)
@@ -2328,6 +2447,9 @@ int net_context_set_option(struct net_context *context,
 	case NET_OPT_SNDBUF:
 		ret = set_context_sndbuf(context, value, len);
 		break;
+	case NET_OPT_BUSY_POLL:
+		ret = set_context_busy_poll(context, value, len);
+		break;
 	}
 
 	k_mutex_unlock(&context->lock);
@@ -2371,6 +2493,9 @@ int net_context_get_option(struct net_context *context,
 	case NET_OPT_SNDBUF:
 		ret = get_context_sndbuf(context, value, len);
 		break;
+	case NET_OPT_BUSY_POLL:
+		ret = get_context_busy_poll(context, value, len);
+		break;
 	}
 
 	k_mutex_unlock(&context->lock);
@@ -57,6 +57,9 @@ LOG_MODULE_REGISTER(net_core, CONFIG_NET_CORE_LOG_LEVEL);
 
 #include "net_stats.h"
 
+static inline enum net_verdict process_l3_data(struct net_pkt *pkt,
+					       bool is_loopback);
+
 static inline enum net_verdict process_data(struct net_pkt *pkt,
 					    bool is_loopback)
 {
@@ -71,12 +74,12 @@ static inline enum net_verdict process_data(struct net_pkt *pkt,
 		return ret;
 	}
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#if defined(CONFIG_NET_REASSEMBLY)
 	/* If the packet is routed back to us when we have reassembled
-	 * an IPv6 packet, then do not pass it to L2 as the packet does
+	 * an IP packet, then do not pass it to L2 as the packet does
 	 * not have link layer headers in it.
 	 */
-	if (net_pkt_ipv6_fragment_start(pkt)) {
+	if (net_pkt_is_ip_reassembled(pkt)) {
 		locally_routed = true;
 	}
 #endif
@@ -130,6 +133,20 @@ static inline enum net_verdict process_data(struct net_pkt *pkt,
 		return ret;
 	}
 
+	/* GRO may hold the packet in order to merge it with following
+	 * segments of the same TCP flow. It will be fed back to the IP
+	 * layer via net_process_l3_packet().
+	 */
+	if (!is_loopback && !locally_routed && net_gro_receive(pkt)) {
+		return NET_OK;
+	}
+
+	return process_l3_data(pkt, is_loopback);
+}
+
+static inline enum net_verdict process_l3_data(struct net_pkt *pkt,
+					       bool is_loopback)
+{
 	/* IP version and header length. */
 	switch (NET_IPV6_HDR(pkt)->vtc & 0xf0) {
 #if defined(CONFIG_NET_IPV6)
@@ -176,6 +193,18 @@ again:
 	}
 }
 
+#if defined(CONFIG_NET_GRO)
+void net_process_l3_packet(struct net_pkt *pkt)
+{
+	net_pkt_cursor_init(pkt);
+
+	if (process_l3_data(pkt, false) != NET_OK) {
+		NET_DBG("Dropping pkt %p", pkt);
+		net_pkt_unref(pkt);
+	}
+}
+#endif /* CONFIG_NET_GRO */
+
 /* Things to setup after we are able to RX and TX */
 static void net_post_init(void)
 {
@@ -204,9 +233,11 @@ static void init_rx_queues(void)
 }
 
 /* If loopback driver is enabled, then direct packets to it so the address
- * check is not needed.
+ * check is not needed, unless the loopback fast path is enabled in which
+ * case locally addressed packets bypass the driver.
  */
-#if defined(CONFIG_NET_IP_ADDR_CHECK) && !defined(CONFIG_NET_LOOPBACK)
+#if (defined(CONFIG_NET_IP_ADDR_CHECK) && !defined(CONFIG_NET_LOOPBACK)) || \
+	defined(CONFIG_NET_LOOPBACK_FAST_PATH)
 /* Check if the IPv{4|6} addresses are proper. As this can be expensive,
  * make this optional.
  */
@@ -347,6 +378,14 @@ int net_send_data(struct net_pkt *pkt)
 		 * to RX processing.
 		 */
 		NET_DBG("Loopback pkt %p back to us", pkt);
+
+		if (IS_ENABLED(CONFIG_NET_LOOPBACK_FAST_PATH)) {
+			/* The packet was built by us and never left the
+			 * device, there is no need to verify its checksum.
+			 */
+			net_pkt_set_chksum_done(pkt, true);
+		}
+
 		processing_data(pkt, true);
 		return 0;
 	}
@@ -407,7 +446,10 @@ static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
 	NET_DBG("TC %d with prio %d pkt %p", tc, prio, pkt);
 #endif
 
-	if (NET_TC_RX_COUNT == 0) {
+	/* A thread busy polling the driver processes the packets of its own
+	 * socket itself, it is about to consume them anyway.
+	 */
+	if (NET_TC_RX_COUNT == 0 || net_if_busy_poll_owns(pkt)) {
 		net_process_rx_packet(pkt);
 	} else {
 		net_tc_submit_to_rx_queue(tc, pkt);
@@ -469,6 +511,7 @@ static inline void l3_init(void)
 	net_tcp_init();
 
 	net_route_init();
+	net_route_ipv4_init();
 
 	NET_DBG("Network L3 init done");
 }
@@ -0,0 +1,493 @@
+/** @file
+ * @brief TCP receive side coalescing (GRO)
+ *
+ * Consecutive in-order TCP segments of the same flow that are received
+ * within one RX queue batch are merged into a single network packet
+ * before they are passed to the TCP layer.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_gro, CONFIG_NET_GRO_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_ip.h>
+
+#include "net_private.h"
+#include "net_stats.h"
+
+#define GRO_TCP_PSH 0x08
+#define GRO_TCP_ACK 0x10
+
+#define GRO_IPV4_MAX_LEN 0xffff
+#define GRO_IPV6_MAX_PAYLOAD 0xffff
+
+struct gro_info {
+	struct net_tcp_hdr *tcp_hdr;
+	uint8_t *ip_hdr;
+	uint16_t ip_len;
+	uint16_t payload_len;
+	uint8_t ip_hdr_len;
+	uint8_t tcp_hdr_len;
+	sa_family_t family;
+	bool mergeable;
+};
+
+struct gro_flow {
+	/** Head packet where the following segments are appended */
+	struct net_pkt *pkt;
+
+	/** Time when the head packet was taken over */
+	uint32_t start;
+
+	/** Sequence number that the next mergeable segment must have */
+	uint32_t next_seq;
+
+	/** Current IP level length of the coalesced packet */
+	uint32_t ip_len;
+
+	uint8_t ip_hdr_len;
+	uint8_t tcp_hdr_len;
+	uint8_t segs;
+};
+
+struct gro_ctx {
+	struct gro_flow flows[CONFIG_NET_GRO_MAX_FLOWS];
+	int held;
+};
+
+static struct gro_ctx gro_ctx[NET_TC_RX_QUEUE_COUNT];
+
+static bool gro_parse(struct net_pkt *pkt, struct gro_info *info)
+{
+	struct net_buf *buf = pkt->buffer;
+	size_t real_len = net_pkt_get_len(pkt);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && buf->len >= sizeof(struct net_ipv4_hdr) &&
+	    (buf->data[0] & 0xf0) == 0x40) {
+		struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)buf->data;
+
+		/* IPv4 options and fragments are left to the IP layer */
+		if (hdr->vhl != 0x45 || hdr->proto != IPPROTO_TCP ||
+		    (hdr->offset[0] & 0x3f) || hdr->offset[1]) {
+			return false;
+		}
+
+		info->family = AF_INET;
+		info->ip_hdr_len = sizeof(struct net_ipv4_hdr);
+		info->ip_len = ntohs(hdr->len);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) &&
+		   buf->len >= sizeof(struct net_ipv6_hdr) &&
+		   (buf->data[0] & 0xf0) == 0x60) {
+		struct net_ipv6_hdr *hdr = (struct net_ipv6_hdr *)buf->data;
+
+		/* Extension headers are left to the IP layer */
+		if (hdr->nexthdr != IPPROTO_TCP) {
+			return false;
+		}
+
+		info->family = AF_INET6;
+		info->ip_hdr_len = sizeof(struct net_ipv6_hdr);
+		info->ip_len = ntohs(hdr->len) + sizeof(struct net_ipv6_hdr);
+	} else {
+		return false;
+	}
+
+	/* Both the IP and TCP headers must be found in the first fragment
+	 * so that they can be updated in place.
+	 */
+	if (buf->len < info->ip_hdr_len + sizeof(struct net_tcp_hdr) ||
+	    real_len < info->ip_len) {
+		return false;
+	}
+
+	info->ip_hdr = buf->data;
+	info->tcp_hdr = (struct net_tcp_hdr *)(buf->data + info->ip_hdr_len);
+	info->tcp_hdr_len = (info->tcp_hdr->offset >> 4) * 4U;
+
+	if (info->tcp_hdr_len < sizeof(struct net_tcp_hdr) ||
+	    buf->len < info->ip_hdr_len + info->tcp_hdr_len ||
+	    info->ip_len < info->ip_hdr_len + info->tcp_hdr_len) {
+		return false;
+	}
+
+	info->payload_len = info->ip_len - info->ip_hdr_len -
+			    info->tcp_hdr_len;
+
+	/* Only plain data segments can be merged, SYN, FIN, RST and URG
+	 * segments and pure ACKs are passed through as is.
+	 */
+	info->mergeable = info->payload_len > 0 &&
+		(info->tcp_hdr->flags & ~GRO_TCP_PSH) == GRO_TCP_ACK;
+
+	if (real_len > info->ip_len) {
+		net_pkt_update_length(pkt, info->ip_len);
+	}
+
+	/* The IP layer sets these again, they are needed here for the
+	 * checksum calculation and flow matching.
+	 */
+	net_pkt_set_family(pkt, info->family);
+	net_pkt_set_ip_hdr_len(pkt, info->ip_hdr_len);
+
+	if (info->family == AF_INET) {
+		net_pkt_set_ipv4_opts_len(pkt, 0);
+	} else {
+		net_pkt_set_ipv6_ext_len(pkt, 0);
+	}
+
+	return true;
+}
+
+static bool gro_flow_match(struct gro_flow *flow, struct net_pkt *pkt,
+			   struct gro_info *info)
+{
+	uint8_t *ip_hdr = flow->pkt->buffer->data;
+	struct net_tcp_hdr *tcp_hdr;
+	size_t addr_len;
+
+	if (net_pkt_iface(flow->pkt) != net_pkt_iface(pkt) ||
+	    net_pkt_family(flow->pkt) != info->family) {
+		return false;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)(ip_hdr + flow->ip_hdr_len);
+
+	/* Ports are compared together */
+	if (memcmp(tcp_hdr, info->tcp_hdr, 2 * sizeof(uint16_t))) {
+		return false;
+	}
+
+	if (info->family == AF_INET) {
+		addr_len = 2 * sizeof(struct in_addr);
+
+		return !memcmp(((struct net_ipv4_hdr *)ip_hdr)->src,
+			       ((struct net_ipv4_hdr *)info->ip_hdr)->src,
+			       addr_len);
+	}
+
+	addr_len = 2 * sizeof(struct in6_addr);
+
+	return !memcmp(((struct net_ipv6_hdr *)ip_hdr)->src,
+		       ((struct net_ipv6_hdr *)info->ip_hdr)->src, addr_len);
+}
+
+static struct gro_flow *gro_flow_find(struct gro_ctx *ctx,
+				      struct net_pkt *pkt,
+				      struct gro_info *info)
+{
+	int i;
+
+	if (ctx->held == 0) {
+		return NULL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ctx->flows); i++) {
+		if (ctx->flows[i].pkt &&
+		    gro_flow_match(&ctx->flows[i], pkt, info)) {
+			return &ctx->flows[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void gro_flow_flush(struct gro_ctx *ctx, struct gro_flow *flow)
+{
+	struct net_pkt *pkt = flow->pkt;
+	struct net_if *iface = net_pkt_iface(pkt);
+
+	flow->pkt = NULL;
+	ctx->held--;
+
+	if (flow->segs > 1) {
+#if defined(CONFIG_NET_IPV4)
+		if (net_pkt_family(pkt) == AF_INET) {
+			struct net_ipv4_hdr *hdr =
+				(struct net_ipv4_hdr *)pkt->buffer->data;
+
+			hdr->chksum = 0U;
+			hdr->chksum = net_calc_chksum_ipv4(pkt);
+		}
+#endif
+
+		net_stats_update_gro_merged(iface, flow->segs - 1);
+	}
+
+	NET_DBG("Flush pkt %p segs %u len %u", pkt, flow->segs, flow->ip_len);
+
+	net_stats_update_gro_flushed(iface);
+
+	net_process_l3_packet(pkt);
+}
+
+static struct gro_flow *gro_flow_alloc(struct gro_ctx *ctx)
+{
+	struct gro_flow *oldest = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ctx->flows); i++) {
+		if (!ctx->flows[i].pkt) {
+			return &ctx->flows[i];
+		}
+
+		if (!oldest || (int32_t)(ctx->flows[i].start - oldest->start) < 0) {
+			oldest = &ctx->flows[i];
+		}
+	}
+
+	gro_flow_flush(ctx, oldest);
+
+	return oldest;
+}
+
+static void gro_flow_hold(struct gro_ctx *ctx, struct gro_flow *flow,
+			  struct net_pkt *pkt, struct gro_info *info)
+{
+	flow->pkt = pkt;
+	flow->start = k_uptime_get_32();
+	flow->next_seq = sys_get_be32(info->tcp_hdr->seq) + info->payload_len;
+	flow->ip_len = info->ip_len;
+	flow->ip_hdr_len = info->ip_hdr_len;
+	flow->tcp_hdr_len = info->tcp_hdr_len;
+	flow->segs = 1U;
+
+	ctx->held++;
+}
+
+/* The IP fields which TCP or ECN look at must be the same in all the
+ * merged segments.
+ */
+static bool gro_ip_hdr_match(struct gro_flow *flow, struct gro_info *info)
+{
+	uint8_t *ip_hdr = flow->pkt->buffer->data;
+
+	if (info->family == AF_INET) {
+		struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)ip_hdr;
+		struct net_ipv4_hdr *new_hdr =
+			(struct net_ipv4_hdr *)info->ip_hdr;
+
+		return hdr->tos == new_hdr->tos && hdr->ttl == new_hdr->ttl;
+	} else {
+		struct net_ipv6_hdr *hdr = (struct net_ipv6_hdr *)ip_hdr;
+		struct net_ipv6_hdr *new_hdr =
+			(struct net_ipv6_hdr *)info->ip_hdr;
+
+		/* Version, traffic class and flow label together */
+		return !memcmp(hdr, new_hdr,
+			       offsetof(struct net_ipv6_hdr, len)) &&
+		       hdr->hop_limit == new_hdr->hop_limit;
+	}
+}
+
+static bool gro_flow_can_merge(struct gro_flow *flow, struct gro_info *info)
+{
+	struct net_tcp_hdr *tcp_hdr;
+	uint32_t max_len;
+
+	if (sys_get_be32(info->tcp_hdr->seq) != flow->next_seq ||
+	    info->tcp_hdr_len != flow->tcp_hdr_len ||
+	    !gro_ip_hdr_match(flow, info)) {
+		return false;
+	}
+
+	max_len = info->family == AF_INET ? GRO_IPV4_MAX_LEN :
+		GRO_IPV6_MAX_PAYLOAD + sizeof(struct net_ipv6_hdr);
+	if (flow->ip_len + info->payload_len > max_len) {
+		return false;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)(flow->pkt->buffer->data +
+					 flow->ip_hdr_len);
+
+	/* An ACK advance would be lost in the merged packet. The flags,
+	 * but PSH, must be the same.
+	 */
+	if (memcmp(tcp_hdr->ack, info->tcp_hdr->ack, sizeof(tcp_hdr->ack)) ||
+	    (tcp_hdr->flags ^ info->tcp_hdr->flags) & ~GRO_TCP_PSH) {
+		return false;
+	}
+
+	/* TCP options must be identical, otherwise TCP would see different
+	 * information than what the sender put into the segments.
+	 */
+	return !memcmp(tcp_hdr->optdata, info->tcp_hdr->optdata,
+		       info->tcp_hdr_len - sizeof(struct net_tcp_hdr));
+}
+
+static void gro_flow_merge(struct gro_flow *flow, struct net_pkt *pkt,
+			   struct gro_info *info)
+{
+	uint8_t *ip_hdr = flow->pkt->buffer->data;
+	struct net_tcp_hdr *tcp_hdr;
+	struct net_buf *payload;
+
+	tcp_hdr = (struct net_tcp_hdr *)(ip_hdr + flow->ip_hdr_len);
+
+	/* The latest segment carries the most recent window */
+	memcpy(tcp_hdr->wnd, info->tcp_hdr->wnd, sizeof(tcp_hdr->wnd));
+	tcp_hdr->flags |= info->tcp_hdr->flags & GRO_TCP_PSH;
+
+	flow->ip_len += info->payload_len;
+	flow->next_seq += info->payload_len;
+	flow->segs++;
+
+	if (info->family == AF_INET) {
+		((struct net_ipv4_hdr *)ip_hdr)->len = htons(flow->ip_len);
+	} else {
+		((struct net_ipv6_hdr *)ip_hdr)->len =
+			htons(flow->ip_len - sizeof(struct net_ipv6_hdr));
+	}
+
+	/* Chain the payload buffers to the head packet, no data is copied */
+	net_buf_pull(pkt->buffer, info->ip_hdr_len + info->tcp_hdr_len);
+
+	payload = pkt->buffer;
+	pkt->buffer = NULL;
+
+	if (payload->len == 0U) {
+		payload = net_buf_frag_del(NULL, payload);
+	}
+
+	if (payload) {
+		net_pkt_append_buffer(flow->pkt, payload);
+	}
+
+	net_pkt_unref(pkt);
+}
+
+static void gro_flush_expired(struct gro_ctx *ctx)
+{
+	uint32_t now = k_uptime_get_32();
+	int i;
+
+	for (i = 0; ctx->held && i < ARRAY_SIZE(ctx->flows); i++) {
+		if (ctx->flows[i].pkt &&
+		    now - ctx->flows[i].start >= CONFIG_NET_GRO_TIMEOUT) {
+			gro_flow_flush(ctx, &ctx->flows[i]);
+		}
+	}
+}
+
+static bool gro_chksum_ok(struct net_pkt *pkt, struct gro_info *info)
+{
+	if (!IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) ||
+	    !net_if_need_calc_rx_checksum(net_pkt_iface(pkt))) {
+		return true;
+	}
+
+	if (net_calc_chksum_tcp(pkt) != 0U) {
+		return false;
+	}
+
+	/* Merged segments cannot be verified by TCP any more, so remember
+	 * that the check was already done.
+	 */
+	net_pkt_set_chksum_done(pkt, true);
+
+	return true;
+}
+
+bool net_gro_receive(struct net_pkt *pkt)
+{
+	struct gro_info info;
+	struct gro_flow *flow;
+	struct gro_ctx *ctx;
+	int queue;
+
+	if (!net_if_flag_is_set(net_pkt_iface(pkt), NET_IF_GRO)) {
+		return false;
+	}
+
+	/* Packets processed outside of the RX queue threads, like the ones
+	 * looped back in the TX path, are never held.
+	 */
+	queue = net_tc_rx_current();
+	if (queue < 0) {
+		return false;
+	}
+
+	ctx = &gro_ctx[queue];
+
+	if (CONFIG_NET_GRO_TIMEOUT > 0) {
+		gro_flush_expired(ctx);
+	}
+
+	if (!gro_parse(pkt, &info)) {
+		return false;
+	}
+
+	flow = gro_flow_find(ctx, pkt, &info);
+
+	if (!info.mergeable || !gro_chksum_ok(pkt, &info)) {
+		/* Keep the segment order of the flow */
+		if (flow) {
+			gro_flow_flush(ctx, flow);
+		}
+
+		return false;
+	}
+
+	net_stats_update_gro_recv(net_pkt_iface(pkt));
+
+	if (flow) {
+		if (gro_flow_can_merge(flow, &info)) {
+			bool push = info.tcp_hdr->flags & GRO_TCP_PSH;
+
+			gro_flow_merge(flow, pkt, &info);
+
+			if (push || flow->segs >= CONFIG_NET_GRO_MAX_SEGS) {
+				gro_flow_flush(ctx, flow);
+			}
+
+			return true;
+		}
+
+		gro_flow_flush(ctx, flow);
+	}
+
+	if (info.tcp_hdr->flags & GRO_TCP_PSH) {
+		/* Nothing can follow a pushed segment, so pass it as is */
+		net_stats_update_gro_flushed(net_pkt_iface(pkt));
+
+		return false;
+	}
+
+	if (!flow) {
+		flow = gro_flow_alloc(ctx);
+	}
+
+	gro_flow_hold(ctx, flow, pkt, &info);
+
+	return true;
+}
+
+void net_gro_flush(int queue)
+{
+	struct gro_ctx *ctx;
+	int i;
+
+	if (queue < 0 || queue >= NET_TC_RX_QUEUE_COUNT) {
+		return;
+	}
+
+	ctx = &gro_ctx[queue];
+
+	for (i = 0; ctx->held && i < ARRAY_SIZE(ctx->flows); i++) {
+		if (ctx->flows[i].pkt) {
+			gro_flow_flush(ctx, &ctx->flows[i]);
+		}
+	}
+}
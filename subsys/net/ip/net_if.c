@@ -24,6 +24,7 @@ LOG_MODULE_REGISTER(net_if, CONFIG_NET_IF_LOG_LEVEL);
 
 #include "net_private.h"
 #include "ipv6.h"
+#include "ipv4.h"
 #include "ipv4_autoconf_internal.h"
 
 #include "net_stats.h"
@@ -421,6 +422,9 @@ static inline void init_iface(struct net_if *iface)
 #endif
 #if defined(CONFIG_NET_NATIVE_IPV6)
 	net_if_flag_set(iface, NET_IF_IPV6);
+#endif
+#if defined(CONFIG_NET_GRO)
+	net_if_flag_set(iface, NET_IF_GRO);
 #endif
 	net_virtual_init(iface);
 
@@ -484,6 +488,11 @@ enum net_verdict net_if_send_data(struct net_if *iface, struct net_pkt *pkt)
 		verdict = net_ipv6_prepare_for_send(pkt);
 	}
 
+	/* Packets larger than the MTU are split into fragments. */
+	if (IS_ENABLED(CONFIG_NET_IPV4) && net_pkt_family(pkt) == AF_INET) {
+		verdict = net_ipv4_prepare_for_send(pkt);
+	}
+
 done:
 	/*   NET_OK in which case packet has checked successfully. In this case
 	 *   the net_context callback is called after successful delivery in
@@ -3975,6 +3984,15 @@ void net_if_call_link_cb(struct net_if *iface, struct net_linkaddr *lladdr,
 
 static bool need_calc_checksum(struct net_if *iface, enum ethernet_hw_caps caps)
 {
+#if defined(CONFIG_NET_LOOPBACK_FAST_PATH)
+	/* Packets of the loopback interface never leave the device. Other
+	 * interfaces using the dummy L2, like SLIP, still need checksums.
+	 */
+	if (net_if_flag_is_set(iface, NET_IF_LOOPBACK)) {
+		return false;
+	}
+#endif
+
 #if defined(CONFIG_NET_L2_ETHERNET)
 	if (net_if_l2(iface) != &NET_L2_GET_NAME(ETHERNET)) {
 		return true;
@@ -3999,6 +4017,140 @@ bool net_if_need_calc_rx_checksum(struct net_if *iface)
 	return need_calc_checksum(iface, ETHERNET_HW_RX_CHKSUM_OFFLOAD);
 }
 
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+/* Thread which currently polls a driver, and the context it waits data
+ * for. Only the packets of that context skip the RX queues.
+ */
+static atomic_ptr_t busy_poll_thread;
+static struct net_context *busy_poll_context;
+
+/* Only the headers in the first buffer of an Ethernet frame are looked
+ * at. Anything else, like IPv6 extension headers or IPv4 fragments, is
+ * not matched and goes through the RX queues.
+ */
+static bool busy_poll_pkt_match(struct net_context *context,
+				struct net_pkt *pkt)
+{
+	struct net_buf *buf = pkt->buffer;
+	size_t hdr_len = sizeof(struct net_eth_hdr);
+	uint16_t type;
+	uint16_t port;
+	uint8_t proto;
+
+	if (!buf || buf->len < sizeof(struct net_eth_vlan_hdr)) {
+		return false;
+	}
+
+	type = ntohs(((struct net_eth_hdr *)buf->data)->type);
+	if (type == NET_ETH_PTYPE_VLAN) {
+		hdr_len = sizeof(struct net_eth_vlan_hdr);
+		type = ntohs(((struct net_eth_vlan_hdr *)buf->data)->type);
+	}
+
+	if (type == NET_ETH_PTYPE_IP &&
+	    net_context_get_family(context) == AF_INET) {
+		struct net_ipv4_hdr *hdr;
+
+		if (buf->len < hdr_len + sizeof(*hdr)) {
+			return false;
+		}
+
+		hdr = (struct net_ipv4_hdr *)(buf->data + hdr_len);
+		if (sys_get_be16(hdr->offset) & (NET_IPV4_MORE_FRAG_MASK |
+						  NET_IPV4_FRAGH_OFFSET_MASK)) {
+			return false;
+		}
+
+		proto = hdr->proto;
+		hdr_len += (hdr->vhl & NET_IPV4_IHL_MASK) * 4U;
+	} else if (type == NET_ETH_PTYPE_IPV6 &&
+		   net_context_get_family(context) == AF_INET6) {
+		struct net_ipv6_hdr *hdr;
+
+		if (buf->len < hdr_len + sizeof(*hdr)) {
+			return false;
+		}
+
+		hdr = (struct net_ipv6_hdr *)(buf->data + hdr_len);
+		proto = hdr->nexthdr;
+		hdr_len += sizeof(*hdr);
+	} else {
+		return false;
+	}
+
+	/* The destination port is at the same offset in TCP and UDP */
+	if (proto != net_context_get_ip_proto(context) ||
+	    buf->len < hdr_len + 2 * sizeof(uint16_t)) {
+		return false;
+	}
+
+	port = UNALIGNED_GET((uint16_t *)(buf->data + hdr_len +
+					  sizeof(uint16_t)));
+
+	return port == net_sin_ptr(&context->local)->sin_port;
+}
+
+bool net_if_busy_poll_owns(struct net_pkt *pkt)
+{
+	if (atomic_ptr_get(&busy_poll_thread) != (void *)k_current_get()) {
+		return false;
+	}
+
+	return busy_poll_context && busy_poll_pkt_match(busy_poll_context, pkt);
+}
+
+int net_if_busy_poll(struct net_if *iface, struct net_context *context,
+		     int budget)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	const struct device *dev;
+	const struct ethernet_api *api;
+	int ret;
+
+	if (!iface || budget <= 0) {
+		return -EINVAL;
+	}
+
+	if (net_if_l2(iface) != &NET_L2_GET_NAME(ETHERNET)) {
+		return -ENOTSUP;
+	}
+
+	dev = net_if_get_device(iface);
+	api = dev->api;
+
+	if (!api->poll) {
+		return -ENOTSUP;
+	}
+
+	if (!net_if_is_up(iface)) {
+		return -ENETDOWN;
+	}
+
+	/* Only one thread at a time, the others wait for their data as
+	 * usual.
+	 */
+	if (!atomic_ptr_cas(&busy_poll_thread, NULL, k_current_get())) {
+		return -EBUSY;
+	}
+
+	busy_poll_context = context;
+
+	ret = api->poll(dev, budget);
+
+	busy_poll_context = NULL;
+	atomic_ptr_clear(&busy_poll_thread);
+
+	return ret;
+#else
+	ARG_UNUSED(iface);
+	ARG_UNUSED(context);
+	ARG_UNUSED(budget);
+
+	return -ENOTSUP;
+#endif
+}
+#endif /* CONFIG_NET_CONTEXT_BUSY_POLL */
+
 int net_if_get_by_iface(struct net_if *iface)
 {
 	if (!(iface >= _net_if_list_start && iface < _net_if_list_end)) {
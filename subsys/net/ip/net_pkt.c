@@ -38,6 +38,13 @@ LOG_MODULE_REGISTER(net_pkt, CONFIG_NET_PKT_LOG_LEVEL);
 #include <zephyr/net/ethernet.h>
 #include <zephyr/net/udp.h>
 
+#include <zephyr/net/net_mgmt.h>
+#include <zephyr/net/net_event.h>
+
+#if defined(CONFIG_NET_PKT_CPU_CACHE)
+#include <zephyr/kernel_structs.h>
+#endif
+
 #include "net_private.h"
 #include "tcp_internal.h"
 
@@ -132,6 +139,366 @@ NET_BUF_POOL_VAR_DEFINE(tx_bufs, CONFIG_NET_BUF_TX_COUNT,
 
 #endif /* CONFIG_NET_BUF_FIXED_DATA_SIZE */
 
+#if defined(CONFIG_NET_PKT_CPU_CACHE)
+/* Free packets of the RX and TX slabs are kept in a small cache per CPU,
+ * which is refilled from and flushed to the slab half a cache at a time.
+ * A cache lock is only contended when a thread migrates to another CPU in
+ * the middle of an operation, or when the slab is empty and a CPU takes
+ * a packet from the cache of another CPU.
+ */
+#define PKT_CACHE_BATCH (CONFIG_NET_PKT_CPU_CACHE_SIZE / 2)
+
+struct pkt_cpu_cache {
+	struct k_spinlock lock;
+	uint8_t count;
+	void *pkts[CONFIG_NET_PKT_CPU_CACHE_SIZE];
+};
+
+struct pkt_cache {
+	struct pkt_cpu_cache cpu[CONFIG_MP_NUM_CPUS];
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+	/* Number of packets in all the CPU caches */
+	atomic_t count;
+#endif
+};
+
+static struct pkt_cache rx_pkt_cache;
+static struct pkt_cache tx_pkt_cache;
+
+static inline struct pkt_cache *pkt_cache_get(struct k_mem_slab *slab)
+{
+	if (slab == &rx_pkts) {
+		return &rx_pkt_cache;
+	} else if (slab == &tx_pkts) {
+		return &tx_pkt_cache;
+	}
+
+	return NULL;
+}
+
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+static inline void pkt_cache_count_add(struct pkt_cache *cache, int count)
+{
+	atomic_add(&cache->count, count);
+}
+
+static inline uint32_t pkt_cache_count(struct k_mem_slab *slab)
+{
+	return atomic_get(&pkt_cache_get(slab)->count);
+}
+#else
+static inline void pkt_cache_count_add(struct pkt_cache *cache, int count)
+{
+	ARG_UNUSED(cache);
+	ARG_UNUSED(count);
+}
+#endif /* CONFIG_NET_PKT_POOL_MONITOR */
+
+static inline struct pkt_cpu_cache *pkt_cpu_cache_get(struct pkt_cache *cache)
+{
+	/* If the thread migrates right after this, the cache of the
+	 * previous CPU is used. That is fine as the cache has a lock.
+	 */
+	return &cache->cpu[_current_cpu->id];
+}
+
+static void *pkt_cache_steal(struct pkt_cache *cache)
+{
+	k_spinlock_key_t key;
+	void *pkt = NULL;
+	int i;
+
+	for (i = 0; i < CONFIG_MP_NUM_CPUS && !pkt; i++) {
+		struct pkt_cpu_cache *cpu = &cache->cpu[i];
+
+		key = k_spin_lock(&cpu->lock);
+
+		if (cpu->count > 0) {
+			pkt = cpu->pkts[--cpu->count];
+			pkt_cache_count_add(cache, -1);
+		}
+
+		k_spin_unlock(&cpu->lock, key);
+	}
+
+	return pkt;
+}
+
+static void *pkt_cache_alloc(struct k_mem_slab *slab)
+{
+	struct pkt_cache *cache = pkt_cache_get(slab);
+	struct pkt_cpu_cache *cpu;
+	k_spinlock_key_t key;
+	void *pkt = NULL;
+	int count = 0;
+
+	if (!cache) {
+		return NULL;
+	}
+
+	cpu = pkt_cpu_cache_get(cache);
+	key = k_spin_lock(&cpu->lock);
+
+	while (cpu->count < PKT_CACHE_BATCH &&
+	       k_mem_slab_alloc(slab, &cpu->pkts[cpu->count], K_NO_WAIT) == 0) {
+		cpu->count++;
+		count++;
+	}
+
+	if (cpu->count > 0) {
+		pkt = cpu->pkts[--cpu->count];
+		count--;
+	}
+
+	k_spin_unlock(&cpu->lock, key);
+
+	pkt_cache_count_add(cache, count);
+
+	if (!pkt) {
+		/* The slab is empty, take a packet cached by another CPU
+		 * before waiting for one.
+		 */
+		pkt = pkt_cache_steal(cache);
+	}
+
+	return pkt;
+}
+
+static bool pkt_cache_free(struct k_mem_slab *slab, void *pkt)
+{
+	struct pkt_cache *cache = pkt_cache_get(slab);
+	struct pkt_cpu_cache *cpu;
+	void *flush[PKT_CACHE_BATCH];
+	k_spinlock_key_t key;
+	int i, flushed = 0;
+
+	/* Someone might be waiting for a packet if the slab is empty, so
+	 * the packet is given back to the slab directly in that case.
+	 */
+	if (!cache || k_mem_slab_num_free_get(slab) == 0U) {
+		return false;
+	}
+
+	cpu = pkt_cpu_cache_get(cache);
+	key = k_spin_lock(&cpu->lock);
+
+	if (cpu->count == CONFIG_NET_PKT_CPU_CACHE_SIZE) {
+		flushed = PKT_CACHE_BATCH;
+		cpu->count -= flushed;
+		memcpy(flush, &cpu->pkts[cpu->count], flushed * sizeof(void *));
+	}
+
+	cpu->pkts[cpu->count++] = pkt;
+
+	k_spin_unlock(&cpu->lock, key);
+
+	/* Freeing a block can wake up a thread waiting for one, so the
+	 * flushed packets are given back without holding the cache lock.
+	 */
+	for (i = 0; i < flushed; i++) {
+		k_mem_slab_free(slab, &flush[i]);
+	}
+
+	pkt_cache_count_add(cache, 1 - flushed);
+
+	return true;
+}
+#else
+#define pkt_cache_alloc(slab) NULL
+#define pkt_cache_free(slab, pkt) false
+#define pkt_cache_count(slab) 0U
+#endif /* CONFIG_NET_PKT_CPU_CACHE */
+
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+BUILD_ASSERT(CONFIG_NET_PKT_POOL_HIGH_WATERMARK >
+	     CONFIG_NET_PKT_POOL_LOW_WATERMARK,
+	     "High watermark must be larger than the low watermark");
+
+struct pool_monitor {
+	atomic_t hist[NET_PKT_POOL_HIST_BUCKETS];
+	atomic_t max_used;
+};
+
+static struct pool_monitor pool_monitors[NET_PKT_POOL_TYPE_COUNT];
+
+/* A bit per pool, set when the pool is below the low watermark */
+static atomic_t pool_low;
+
+/* The pool state last reported to the applications */
+static atomic_t pool_low_reported;
+
+static void pool_get_counts(enum net_pkt_pool_type type,
+			    uint32_t *total, uint32_t *free)
+{
+	switch (type) {
+	case NET_PKT_POOL_RX:
+		*total = rx_pkts.num_blocks;
+		*free = k_mem_slab_num_free_get(&rx_pkts) +
+			pkt_cache_count(&rx_pkts);
+		break;
+	case NET_PKT_POOL_TX:
+		*total = tx_pkts.num_blocks;
+		*free = k_mem_slab_num_free_get(&tx_pkts) +
+			pkt_cache_count(&tx_pkts);
+		break;
+	case NET_PKT_POOL_RX_DATA:
+		*total = rx_bufs.buf_count;
+		*free = atomic_get(&rx_bufs.avail_count);
+		break;
+	case NET_PKT_POOL_TX_DATA:
+	default:
+		*total = tx_bufs.buf_count;
+		*free = atomic_get(&tx_bufs.avail_count);
+		break;
+	}
+}
+
+/* The events are sent from a work item as the pool state can change in
+ * an ISR.
+ */
+static void pool_event_handler(struct k_work *work)
+{
+#if defined(CONFIG_NET_MGMT_EVENT_INFO)
+	struct net_event_pkt_pool info;
+#endif
+	int type;
+
+	ARG_UNUSED(work);
+
+	for (type = 0; type < NET_PKT_POOL_TYPE_COUNT; type++) {
+		bool low = atomic_test_bit(&pool_low, type);
+		uint32_t event = low ? NET_EVENT_PKT_POOL_LOW :
+				       NET_EVENT_PKT_POOL_OK;
+		uint32_t total, free;
+
+		if (low == atomic_test_bit(&pool_low_reported, type)) {
+			continue;
+		}
+
+		atomic_set_bit_to(&pool_low_reported, type, low);
+
+		pool_get_counts(type, &total, &free);
+
+		NET_DBG("Pool %d %s, free %u/%u", type, low ? "low" : "ok",
+			free, total);
+
+#if defined(CONFIG_NET_MGMT_EVENT_INFO)
+		info.pool = type;
+		info.free = free;
+		info.total = total;
+
+		net_mgmt_event_notify_with_info(event, NULL, &info,
+						sizeof(info));
+#else
+		net_mgmt_event_notify(event, NULL);
+#endif
+	}
+}
+
+static K_WORK_DEFINE(pool_event_work, pool_event_handler);
+
+static void pool_monitor_update(enum net_pkt_pool_type type, bool alloc)
+{
+	struct pool_monitor *mon = &pool_monitors[type];
+	uint32_t total, free, used;
+	bool changed = false;
+
+	pool_get_counts(type, &total, &free);
+	used = total > free ? total - free : 0U;
+
+	if (alloc) {
+		atomic_val_t max;
+
+		atomic_inc(&mon->hist[(MAX(used, 1U) *
+				       NET_PKT_POOL_HIST_BUCKETS - 1U) / total]);
+
+		do {
+			max = atomic_get(&mon->max_used);
+			if ((atomic_val_t)used <= max) {
+				break;
+			}
+		} while (!atomic_cas(&mon->max_used, max, used));
+	}
+
+	if (free * 100U < total * CONFIG_NET_PKT_POOL_LOW_WATERMARK) {
+		changed = !atomic_test_and_set_bit(&pool_low, type);
+	} else if (free * 100U >= total * CONFIG_NET_PKT_POOL_HIGH_WATERMARK) {
+		changed = atomic_test_and_clear_bit(&pool_low, type);
+	}
+
+	if (changed) {
+		k_work_submit(&pool_event_work);
+	}
+}
+
+static void pool_monitor_slab(struct k_mem_slab *slab, bool alloc)
+{
+	if (slab == &rx_pkts) {
+		pool_monitor_update(NET_PKT_POOL_RX, alloc);
+	} else if (slab == &tx_pkts) {
+		pool_monitor_update(NET_PKT_POOL_TX, alloc);
+	}
+}
+
+static void pool_monitor_data(struct net_buf_pool *pool, bool alloc)
+{
+	if (pool == &rx_bufs) {
+		pool_monitor_update(NET_PKT_POOL_RX_DATA, alloc);
+	} else if (pool == &tx_bufs) {
+		pool_monitor_update(NET_PKT_POOL_TX_DATA, alloc);
+	}
+}
+
+bool net_pkt_rx_pool_is_low(void)
+{
+	pool_monitor_update(NET_PKT_POOL_RX, false);
+	pool_monitor_update(NET_PKT_POOL_RX_DATA, false);
+
+	return atomic_test_bit(&pool_low, NET_PKT_POOL_RX) ||
+		atomic_test_bit(&pool_low, NET_PKT_POOL_RX_DATA);
+}
+
+bool net_pkt_tx_pool_is_low(void)
+{
+	pool_monitor_update(NET_PKT_POOL_TX, false);
+	pool_monitor_update(NET_PKT_POOL_TX_DATA, false);
+
+	return atomic_test_bit(&pool_low, NET_PKT_POOL_TX) ||
+		atomic_test_bit(&pool_low, NET_PKT_POOL_TX_DATA);
+}
+
+int net_pkt_pool_usage_get(enum net_pkt_pool_type type,
+			   struct net_pkt_pool_usage *usage)
+{
+	struct pool_monitor *mon;
+	uint32_t total, free;
+	int i;
+
+	if ((unsigned int)type >= NET_PKT_POOL_TYPE_COUNT || !usage) {
+		return -EINVAL;
+	}
+
+	mon = &pool_monitors[type];
+
+	pool_monitor_update(type, false);
+	pool_get_counts(type, &total, &free);
+
+	for (i = 0; i < NET_PKT_POOL_HIST_BUCKETS; i++) {
+		usage->hist[i] = atomic_get(&mon->hist[i]);
+	}
+
+	usage->total = total;
+	usage->used = total > free ? total - free : 0U;
+	usage->max_used = atomic_get(&mon->max_used);
+	usage->low = atomic_test_bit(&pool_low, type);
+
+	return 0;
+}
+#else
+#define pool_monitor_slab(slab, alloc)
+#define pool_monitor_data(pool, alloc)
+#endif /* CONFIG_NET_PKT_POOL_MONITOR */
+
 /* Allocation tracking is only available if separately enabled */
 #if defined(CONFIG_NET_DEBUG_NET_PKT_ALLOC)
 struct net_pkt_alloc {
@@ -506,6 +873,7 @@ void net_pkt_unref_debug(struct net_pkt *pkt, const char *caller, int line)
 void net_pkt_unref(struct net_pkt *pkt)
 {
 #endif /* NET_LOG_LEVEL >= LOG_LEVEL_DBG */
+	struct k_mem_slab *slab;
 	atomic_val_t ref;
 
 	if (!pkt) {
@@ -595,7 +963,14 @@ done:
 		net_pkt_cursor_init(pkt);
 	}
 
-	k_mem_slab_free(pkt->slab, (void **)&pkt);
+	slab = pkt->slab;
+
+	if (!pkt_cache_free(slab, pkt)) {
+		k_mem_slab_free(slab, (void **)&pkt);
+	}
+
+	pool_monitor_slab(slab, false);
+	pool_monitor_data(slab == &tx_pkts ? &tx_bufs : &rx_bufs, false);
 }
 
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
@@ -972,6 +1347,13 @@ static size_t pkt_buffer_length(struct net_pkt *pkt,
 
 		max_len = MAX(max_len, NET_IPV6_MTU);
 	} else if (IS_ENABLED(CONFIG_NET_IPV4) && family == AF_INET) {
+		if (IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT) && (size > max_len)) {
+			/* We support larger packets if IPv4 fragmentation is
+			 * enabled.
+			 */
+			max_len = size;
+		}
+
 		max_len = MAX(max_len, NET_IPV4_MTU);
 	} else { /* family == AF_UNSPEC */
 #if defined (CONFIG_NET_L2_ETHERNET)
@@ -1193,6 +1575,8 @@ int net_pkt_alloc_buffer(struct net_pkt *pkt,
 	buf = pkt_alloc_buffer(pool, alloc_len, timeout);
 #endif
 
+	pool_monitor_data(pool, buf != NULL);
+
 	if (!buf) {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
 		NET_ERR("Data buffer (%zd) allocation failed (%s:%d)",
@@ -1230,11 +1614,17 @@ static struct net_pkt *pkt_alloc(struct k_mem_slab *slab, k_timeout_t timeout)
 		ARG_UNUSED(create_time);
 	}
 
-	ret = k_mem_slab_alloc(slab, (void **)&pkt, timeout);
-	if (ret) {
-		return NULL;
+	pkt = pkt_cache_alloc(slab);
+	if (!pkt) {
+		ret = k_mem_slab_alloc(slab, (void **)&pkt, timeout);
+		if (ret) {
+			pool_monitor_slab(slab, false);
+			return NULL;
+		}
 	}
 
+	pool_monitor_slab(slab, true);
+
 	memset(pkt, 0, sizeof(struct net_pkt));
 
 	pkt->atomic_ref = ATOMIC_INIT(1);
@@ -1775,6 +2165,8 @@ static void clone_pkt_attributes(struct net_pkt *pkt, struct net_pkt *clone_pkt)
 	net_pkt_set_captured(clone_pkt, net_pkt_is_captured(pkt));
 	net_pkt_set_l2_bridged(clone_pkt, net_pkt_is_l2_bridged(pkt));
 	net_pkt_set_l2_processed(clone_pkt, net_pkt_is_l2_processed(pkt));
+	net_pkt_set_chksum_done(clone_pkt, net_pkt_is_chksum_done(pkt));
+	net_pkt_set_flow_hash(clone_pkt, net_pkt_flow_hash(pkt));
 	net_pkt_set_ll_proto_type(clone_pkt, net_pkt_ll_proto_type(pkt));
 
 	if (IS_ENABLED(CONFIG_NET_IPV4) && net_pkt_family(pkt) == AF_INET) {
@@ -50,6 +50,35 @@ extern void net_if_stats_reset_all(void);
 extern void net_process_rx_packet(struct net_pkt *pkt);
 extern void net_process_tx_packet(struct net_pkt *pkt);
 
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+extern bool net_if_busy_poll_owns(struct net_pkt *pkt);
+#else
+static inline bool net_if_busy_poll_owns(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return false;
+}
+#endif
+
+#if defined(CONFIG_NET_GRO)
+extern bool net_gro_receive(struct net_pkt *pkt);
+extern void net_gro_flush(int queue);
+extern void net_process_l3_packet(struct net_pkt *pkt);
+#else
+static inline bool net_gro_receive(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return false;
+}
+
+static inline void net_gro_flush(int queue)
+{
+	ARG_UNUSED(queue);
+}
+#endif
+
 #if defined(CONFIG_NET_NATIVE) || defined(CONFIG_NET_OFFLOAD)
 extern void net_context_init(void);
 extern const char *net_context_state(struct net_context *context);
@@ -90,6 +119,7 @@ static inline enum net_verdict net_ipv6_input(struct net_pkt *pkt,
 #endif
 extern bool net_tc_submit_to_tx_queue(uint8_t tc, struct net_pkt *pkt);
 extern void net_tc_submit_to_rx_queue(uint8_t tc, struct net_pkt *pkt);
+extern int net_tc_rx_current(void);
 extern enum net_verdict net_promisc_mode_input(struct net_pkt *pkt);
 
 char *net_sprint_addr(sa_family_t af, const void *addr);
@@ -40,6 +40,10 @@ LOG_MODULE_REGISTER(net_shell, LOG_LEVEL_DBG);
 
 #include "ipv6.h"
 
+#if defined(CONFIG_NET_REASSEMBLY)
+#include "reassembly.h"
+#endif
+
 #if defined(CONFIG_NET_ARP)
 #include "ethernet/arp.h"
 #endif
@@ -265,6 +269,7 @@ static struct ethernet_capabilities eth_hw_caps[] = {
 	EC(ETHERNET_HW_FILTERING,         "MAC address filtering"),
 	EC(ETHERNET_DSA_SLAVE_PORT,       "DSA slave port"),
 	EC(ETHERNET_DSA_MASTER_PORT,      "DSA master port"),
+	EC(ETHERNET_HW_FLOW_HASH,         "Flow hashing (RSS)"),
 };
 
 static void print_supported_ethernet_capabilities(
@@ -1278,9 +1283,34 @@ static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 	PR("TCP conn drop  %d\tconnrst\t%d\n",
 	   GET_STAT(iface, tcp.conndrop),
 	   GET_STAT(iface, tcp.connrst));
+	PR("TCP keepalive  %d\ttimeout\t%d\n",
+	   GET_STAT(iface, tcp.keepalive),
+	   GET_STAT(iface, tcp.conntimeout));
 	PR("TCP pkt drop   %d\n", GET_STAT(iface, tcp.drop));
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_GRO)
+	PR("GRO segs recv  %d\tmerged\t%d\tflushed\t%d\n",
+	   GET_STAT(iface, gro.recv),
+	   GET_STAT(iface, gro.merged),
+	   GET_STAT(iface, gro.flushed));
+#endif
+
+#if defined(CONFIG_NET_STATISTICS_NBR_CACHE)
+#if defined(CONFIG_NET_ARP)
+	PR("ARP cache hit  %d\tmiss\t%d\tevicted\t%d\n",
+	   GET_STAT(iface, arp.hit),
+	   GET_STAT(iface, arp.miss),
+	   GET_STAT(iface, arp.evicted));
+#endif
+#if defined(CONFIG_NET_IPV6_NBR_CACHE)
+	PR("IPv6 nbr hit   %d\tmiss\t%d\tevicted\t%d\n",
+	   GET_STAT(iface, ipv6_nbr.hit),
+	   GET_STAT(iface, ipv6_nbr.miss),
+	   GET_STAT(iface, ipv6_nbr.evicted));
+#endif
+#endif
+
 	PR("Bytes received %u\n", GET_STAT(iface, bytes.received));
 	PR("Bytes sent     %u\n", GET_STAT(iface, bytes.sent));
 	PR("Processing err %d\n", GET_STAT(iface, processing_error));
@@ -1556,9 +1586,9 @@ static void tcp_sent_list_cb(struct tcp *conn, void *user_data)
 #endif /* CONFIG_NET_TCP_LOG_LEVEL >= LOG_LEVEL_DBG */
 #endif /* TCP */
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
-static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
-			 void *user_data)
+#if defined(CONFIG_NET_REASSEMBLY)
+static void reassembly_cb(const struct net_reassembly *reass,
+			  uint32_t remaining, void *user_data)
 {
 	struct net_shell_user_data *data = user_data;
 	const struct shell *shell = data->shell;
@@ -1567,21 +1597,32 @@ static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
 	int i;
 
 	if (!*count) {
-		PR("\nIPv6 reassembly Id         Remain "
+		PR("\nIP reassembly    Family Id         Remain "
 		   "Src             \tDst\n");
 	}
 
-	snprintk(src, ADDR_LEN, "%s", net_sprint_ipv6_addr(&reass->src));
+	if (reass->key.src.family == AF_INET) {
+		snprintk(src, ADDR_LEN, "%s",
+			 net_sprint_ipv4_addr(&reass->key.src.in_addr));
+
+		PR("%p      IPv4   0x%08x  %5u %16s\t%16s\n", reass,
+		   reass->key.id, remaining, src,
+		   net_sprint_ipv4_addr(&reass->key.dst.in_addr));
+	} else {
+		snprintk(src, ADDR_LEN, "%s",
+			 net_sprint_ipv6_addr(&reass->key.src.in6_addr));
 
-	PR("%p      0x%08x  %5d %16s\t%16s\n", reass, reass->id,
-	   k_ticks_to_ms_ceil32(k_work_delayable_remaining_get(&reass->timer)),
-	   src, net_sprint_ipv6_addr(&reass->dst));
+		PR("%p      IPv6   0x%08x  %5u %16s\t%16s\n", reass,
+		   reass->key.id, remaining, src,
+		   net_sprint_ipv6_addr(&reass->key.dst.in6_addr));
+	}
 
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_PKT; i++) {
+	for (i = 0; i < NET_REASSEMBLY_MAX_PKT; i++) {
 		if (reass->pkt[i]) {
 			struct net_buf *frag = reass->pkt[i]->frags;
 
-			PR("[%d] pkt %p->", i, reass->pkt[i]);
+			PR("[%d] pkt %p offset %u->", i, reass->pkt[i],
+			   reass->offset[i]);
 
 			while (frag) {
 				PR("%p", frag);
@@ -1598,7 +1639,7 @@ static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
 
 	(*count)++;
 }
-#endif /* CONFIG_NET_IPV6_FRAGMENT */
+#endif /* CONFIG_NET_REASSEMBLY */
 
 #if defined(CONFIG_NET_DEBUG_NET_PKT_ALLOC)
 static void allocs_cb(struct net_pkt *pkt,
@@ -1836,7 +1877,21 @@ static int cmd_net_capture(const struct shell *shell, size_t argc,
 
 		net_capture_foreach(capture_cb, &user_data);
 	}
-#else
+#endif
+
+#if defined(CONFIG_NET_CAPTURE_RING)
+	struct net_capture_ring_stats stats;
+
+	net_capture_ring_stats_get(&stats);
+
+	PR_INFO("Local capture ring %s\n",
+		net_capture_ring_is_enabled() ? "enabled" : "disabled");
+	PR("Captured %u pkts (%u bytes), dropped %u, filtered %u\n",
+	   stats.captured, stats.bytes, stats.dropped, stats.filtered);
+	PR("Ring usage %u/%u bytes\n", stats.used, stats.size);
+#endif
+
+#if !defined(CONFIG_NET_CAPTURE) && !defined(CONFIG_NET_CAPTURE_RING)
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
@@ -1995,6 +2050,159 @@ static int cmd_net_capture_disable(const struct shell *shell, size_t argc,
 	return 0;
 }
 
+#if defined(CONFIG_NET_CAPTURE_RING)
+static int capture_dump_cb(const void *data, size_t len, void *user_data)
+{
+	const struct shell *shell = user_data;
+	const uint8_t *ptr = data;
+	char line[2 * 32 + 1];
+	size_t chunk;
+
+	while (len > 0) {
+		chunk = MIN(len, 32);
+
+		bin2hex(ptr, chunk, line, sizeof(line));
+		PR("%s\n", line);
+
+		ptr += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+#endif
+
+static int cmd_net_capture_ring_start(const struct shell *shell, size_t argc,
+				      char *argv[])
+{
+#if defined(CONFIG_NET_CAPTURE_RING)
+	struct net_if *iface = NULL;
+	int if_index = 0, snaplen = 0;
+	int ret;
+
+	if (argc > 1) {
+		if_index = atoi(argv[1]);
+	}
+
+	if (if_index > 0) {
+		iface = net_if_get_by_index(if_index);
+		if (iface == NULL) {
+			PR_WARNING("No such interface with index %d\n",
+				   if_index);
+			return -ENOEXEC;
+		}
+	}
+
+	if (argc > 2) {
+		snaplen = atoi(argv[2]);
+		if (snaplen <= 0 || snaplen > UINT16_MAX) {
+			PR_WARNING("Invalid snaplen %s\n", argv[2]);
+			return -ENOEXEC;
+		}
+	}
+
+	ret = net_capture_ring_start(iface, snaplen, NULL, NULL);
+	if (ret < 0) {
+		PR_WARNING("Capture %s failed (%d)\n", "start", ret);
+		return -ENOEXEC;
+	}
+#else
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	PR_INFO("Set %s to enable %s support.\n",
+		"CONFIG_NET_CAPTURE_RING", "local packet capture");
+#endif
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_stop(const struct shell *shell, size_t argc,
+				     char *argv[])
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+#if defined(CONFIG_NET_CAPTURE_RING)
+	(void)net_capture_ring_stop();
+#else
+	PR_INFO("Set %s to enable %s support.\n",
+		"CONFIG_NET_CAPTURE_RING", "local packet capture");
+#endif
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_dump(const struct shell *shell, size_t argc,
+				     char *argv[])
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+#if defined(CONFIG_NET_CAPTURE_RING)
+	int ret;
+
+	ret = net_capture_ring_export(capture_dump_cb, (void *)shell);
+	if (ret < 0) {
+		PR_WARNING("Capture %s failed (%d)\n", "dump", ret);
+		return -ENOEXEC;
+	}
+
+	PR_INFO("Exported %d packets\n", ret);
+#else
+	PR_INFO("Set %s to enable %s support.\n",
+		"CONFIG_NET_CAPTURE_RING", "local packet capture");
+#endif
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_save(const struct shell *shell, size_t argc,
+				     char *argv[])
+{
+#if defined(CONFIG_NET_CAPTURE_RING) && defined(CONFIG_FILE_SYSTEM)
+	int ret;
+
+	if (argc < 2) {
+		PR_WARNING("File name is missing.\n");
+		return -ENOEXEC;
+	}
+
+	ret = net_capture_ring_export_file(argv[1]);
+	if (ret < 0) {
+		PR_WARNING("Capture %s failed (%d)\n", "save", ret);
+		return -ENOEXEC;
+	}
+
+	PR_INFO("Saved %d packets to %s\n", ret, argv[1]);
+#else
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	PR_INFO("Set %s and %s to enable %s support.\n",
+		"CONFIG_NET_CAPTURE_RING", "CONFIG_FILE_SYSTEM",
+		"capture file");
+#endif
+
+	return 0;
+}
+
+static int cmd_net_capture_ring_clear(const struct shell *shell, size_t argc,
+				      char *argv[])
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+#if defined(CONFIG_NET_CAPTURE_RING)
+	net_capture_ring_clear();
+#else
+	PR_INFO("Set %s to enable %s support.\n",
+		"CONFIG_NET_CAPTURE_RING", "local packet capture");
+#endif
+
+	return 0;
+}
+
 static int cmd_net_conn(const struct shell *shell, size_t argc, char *argv[])
 {
 	ARG_UNUSED(argc);
@@ -2059,6 +2267,27 @@ static int cmd_net_conn(const struct shell *shell, size_t argc, char *argv[])
 #endif /* CONFIG_NET_TCP_LOG_LEVEL >= LOG_LEVEL_DBG */
 	}
 
+#if defined(CONFIG_NET_NATIVE_TCP)
+	{
+		struct net_tcp_footprint footprint;
+
+		net_tcp_footprint_get(&footprint);
+
+		PR("\nTCP memory: %zu bytes per connection "
+		   "(connection %zu, context %zu, handler %zu), %d in use\n",
+		   footprint.conn_size + footprint.context_size +
+		   footprint.handler_size, footprint.conn_size,
+		   footprint.context_size, footprint.handler_size,
+		   footprint.conn_count);
+
+		if (footprint.time_wait_size > 0) {
+			PR("TIME_WAIT: %zu bytes per connection, %d in use\n",
+			   footprint.time_wait_size,
+			   footprint.time_wait_count);
+		}
+	}
+#endif
+
 #if CONFIG_NET_TCP_LOG_LEVEL < LOG_LEVEL_DBG
 	PR_INFO("Set %s to enable %s support.\n",
 		"CONFIG_NET_TCP_LOG_LEVEL_DBG", "TCP debugging");
@@ -2066,10 +2295,10 @@ static int cmd_net_conn(const struct shell *shell, size_t argc, char *argv[])
 
 #endif
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#if defined(CONFIG_NET_REASSEMBLY)
 	count = 0;
 
-	net_ipv6_frag_foreach(ipv6_frag_cb, &user_data);
+	net_reassembly_foreach(reassembly_cb, &user_data);
 
 	/* Do not print anything if no fragments are pending atm */
 #endif
@@ -2123,7 +2352,7 @@ static void dns_result_cb(enum dns_resolve_status status,
 		return;
 	}
 
-	if (status == DNS_EAI_FAIL) {
+	if (status == DNS_EAI_FAIL || status == DNS_EAI_NODATA) {
 		PR_WARNING("dns: No such name found.\n");
 		return;
 	}
@@ -2134,6 +2363,9 @@ static void dns_result_cb(enum dns_resolve_status status,
 static void print_dns_info(const struct shell *shell,
 			   struct dns_resolve_context *ctx)
 {
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct dns_resolve_cache_stats stats;
+#endif
 	int i;
 
 	PR("DNS servers:\n");
@@ -2181,6 +2413,15 @@ static void print_dns_info(const struct shell *shell,
 			   remaining);
 		}
 	}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	dns_resolve_cache_stats_get(&stats);
+
+	PR("Cache entries %u/%u\n", stats.entries, stats.size);
+	PR("\thits %u negative hits %u misses %u\n", stats.hits,
+	   stats.negative_hits, stats.misses);
+	PR("\tcoalesced %u evictions %u\n", stats.coalesced, stats.evictions);
+#endif
 }
 #endif
 
@@ -2225,6 +2466,24 @@ static int cmd_net_dns_cancel(const struct shell *shell, size_t argc,
 	return 0;
 }
 
+static int cmd_net_dns_flush(const struct shell *shell, size_t argc,
+			     char *argv[])
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	dns_resolve_cache_flush();
+
+	PR("DNS cache flushed.\n");
+#else
+	PR_INFO("Set %s to enable %s support.\n", "CONFIG_DNS_RESOLVER_CACHE",
+		"DNS cache");
+#endif
+
+	return 0;
+}
+
 static int cmd_net_dns_query(const struct shell *shell, size_t argc,
 			     char *argv[])
 {
@@ -3646,6 +3905,40 @@ static void context_info(struct net_context *context, void *user_data)
 }
 #endif /* CONFIG_NET_OFFLOAD || CONFIG_NET_NATIVE */
 
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+static void print_pkt_pool_usage(const struct shell *shell)
+{
+	static const char * const names[] = {
+		[NET_PKT_POOL_RX] = "RX",
+		[NET_PKT_POOL_TX] = "TX",
+		[NET_PKT_POOL_RX_DATA] = "RX DATA",
+		[NET_PKT_POOL_TX_DATA] = "TX DATA",
+	};
+	struct net_pkt_pool_usage usage;
+	int i, j;
+
+	PR("\nPool usage at allocation time (%d%% steps), low watermark "
+	   "%d%% high %d%% free:\n", 100 / NET_PKT_POOL_HIST_BUCKETS,
+	   CONFIG_NET_PKT_POOL_LOW_WATERMARK,
+	   CONFIG_NET_PKT_POOL_HIGH_WATERMARK);
+
+	for (i = 0; i < NET_PKT_POOL_TYPE_COUNT; i++) {
+		if (net_pkt_pool_usage_get(i, &usage) < 0) {
+			continue;
+		}
+
+		PR("%-8s used %u/%u max %u%s\n", names[i], usage.used,
+		   usage.total, usage.max_used, usage.low ? " (low)" : "");
+
+		for (j = 0; j < NET_PKT_POOL_HIST_BUCKETS; j++) {
+			PR("%s%u", j ? " " : "\t", usage.hist[j]);
+		}
+
+		PR("\n");
+	}
+}
+#endif /* CONFIG_NET_PKT_POOL_MONITOR */
+
 static int cmd_net_mem(const struct shell *shell, size_t argc, char *argv[])
 {
 	ARG_UNUSED(argc);
@@ -3686,6 +3979,10 @@ static int cmd_net_mem(const struct shell *shell, size_t argc, char *argv[])
 		"CONFIG_NET_BUF_POOL_USAGE", "net_buf allocation");
 #endif /* CONFIG_NET_BUF_POOL_USAGE */
 
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+	print_pkt_pool_usage(shell);
+#endif
+
 	if (IS_ENABLED(CONFIG_NET_CONTEXT_NET_PKT_POOL)) {
 		struct net_shell_user_data user_data;
 		struct ctx_info info;
@@ -5669,6 +5966,26 @@ SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_arp,
 	SHELL_SUBCMD_SET_END
 );
 
+SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_capture_ring,
+	SHELL_CMD(start, NULL, "Start capturing packets into the ring.\n"
+		  "'net capture ring start [<interface index>] [<snaplen>]'\n"
+		  "Interface index 0 or no index captures all interfaces.",
+		  cmd_net_capture_ring_start),
+	SHELL_CMD(stop, NULL, "Stop capturing packets into the ring.",
+		  cmd_net_capture_ring_stop),
+	SHELL_CMD(dump, NULL, "Print the captured packets as pcapng in hex "
+		  "and remove them from the ring.\n"
+		  "Convert the output with 'xxd -r -p > capture.pcapng'",
+		  cmd_net_capture_ring_dump),
+	SHELL_CMD(save, NULL, "Save the captured packets to a pcapng file "
+		  "and remove them from the ring.\n"
+		  "'net capture ring save <file>'",
+		  cmd_net_capture_ring_save),
+	SHELL_CMD(clear, NULL, "Drop the captured packets and clear the "
+		  "counters.", cmd_net_capture_ring_clear),
+	SHELL_SUBCMD_SET_END
+);
+
 SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_capture,
 	SHELL_CMD(setup, NULL, "Setup network packet capture.\n"
 		  "'net capture setup <remote-ip-addr> <local-addr> <peer-addr>'\n"
@@ -5686,12 +6003,16 @@ SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_capture,
 		  cmd_net_capture_enable),
 	SHELL_CMD(disable, NULL, "Disable network packet capture.",
 		  cmd_net_capture_disable),
+	SHELL_CMD(ring, &net_cmd_capture_ring,
+		  "Capture network packets locally into a RAM ring.", NULL),
 	SHELL_SUBCMD_SET_END
 );
 
 SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_dns,
 	SHELL_CMD(cancel, NULL, "Cancel all pending requests.",
 		  cmd_net_dns_cancel),
+	SHELL_CMD(flush, NULL, "Remove all the entries from the DNS cache.",
+		  cmd_net_dns_flush),
 	SHELL_CMD(query, NULL,
 		  "'net dns <hostname> [A or AAAA]' queries IPv4 address "
 		  "(default) or IPv6 address for a host name.",
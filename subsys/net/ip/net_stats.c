@@ -152,6 +152,9 @@ static inline void stats(struct net_if *iface)
 		NET_INFO("TCP conn drop  %d\tconnrst\t%d",
 			 GET_STAT(iface, tcp.conndrop),
 			 GET_STAT(iface, tcp.connrst));
+		NET_INFO("TCP keepalive  %d\ttimeout\t%d",
+			 GET_STAT(iface, tcp.keepalive),
+			 GET_STAT(iface, tcp.conntimeout));
 #endif
 
 		NET_INFO("Bytes received %u", GET_STAT(iface, bytes.received));
@@ -239,6 +239,16 @@ static inline void net_stats_update_tcp_seg_connrst(struct net_if *iface)
 	UPDATE_STAT(iface, stats.tcp.connrst++);
 }
 
+static inline void net_stats_update_tcp_seg_keepalive(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.tcp.keepalive++);
+}
+
+static inline void net_stats_update_tcp_conntimeout(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.tcp.conntimeout++);
+}
+
 static inline void net_stats_update_tcp_seg_chkerr(struct net_if *iface)
 {
 	UPDATE_STAT(iface, stats.tcp.chkerr++);
@@ -269,12 +279,75 @@ static inline void net_stats_update_tcp_seg_rexmit(struct net_if *iface)
 #define net_stats_update_tcp_seg_rst(iface)
 #define net_stats_update_tcp_seg_conndrop(iface)
 #define net_stats_update_tcp_seg_connrst(iface)
+#define net_stats_update_tcp_seg_keepalive(iface)
+#define net_stats_update_tcp_conntimeout(iface)
 #define net_stats_update_tcp_seg_chkerr(iface)
 #define net_stats_update_tcp_seg_ackerr(iface)
 #define net_stats_update_tcp_seg_rsterr(iface)
 #define net_stats_update_tcp_seg_rexmit(iface)
 #endif /* CONFIG_NET_STATISTICS_TCP */
 
+#if defined(CONFIG_NET_STATISTICS_GRO)
+static inline void net_stats_update_gro_recv(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.gro.recv++);
+}
+
+static inline void net_stats_update_gro_merged(struct net_if *iface,
+					       uint32_t segs)
+{
+	UPDATE_STAT(iface, stats.gro.merged += segs);
+}
+
+static inline void net_stats_update_gro_flushed(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.gro.flushed++);
+}
+#else
+#define net_stats_update_gro_recv(iface)
+#define net_stats_update_gro_merged(iface, segs)
+#define net_stats_update_gro_flushed(iface)
+#endif /* CONFIG_NET_STATISTICS_GRO */
+
+#if defined(CONFIG_NET_STATISTICS_NBR_CACHE)
+static inline void net_stats_update_arp_hit(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.hit++);
+}
+
+static inline void net_stats_update_arp_miss(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.miss++);
+}
+
+static inline void net_stats_update_arp_evicted(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.evicted++);
+}
+
+static inline void net_stats_update_ipv6_nbr_hit(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.hit++);
+}
+
+static inline void net_stats_update_ipv6_nbr_miss(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.miss++);
+}
+
+static inline void net_stats_update_ipv6_nbr_evicted(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.evicted++);
+}
+#else
+#define net_stats_update_arp_hit(iface)
+#define net_stats_update_arp_miss(iface)
+#define net_stats_update_arp_evicted(iface)
+#define net_stats_update_ipv6_nbr_hit(iface)
+#define net_stats_update_ipv6_nbr_miss(iface)
+#define net_stats_update_ipv6_nbr_evicted(iface)
+#endif /* CONFIG_NET_STATISTICS_NBR_CACHE */
+
 static inline void net_stats_update_per_proto_recv(struct net_if *iface,
 						   enum net_ip_protocol proto)
 {
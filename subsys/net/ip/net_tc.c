@@ -13,6 +13,7 @@ LOG_MODULE_REGISTER(net_tc, CONFIG_NET_TC_LOG_LEVEL);
 #include <zephyr/net/net_core.h>
 #include <zephyr/net/net_pkt.h>
 #include <zephyr/net/net_stats.h>
+#include <zephyr/net/ethernet.h>
 
 #include "net_private.h"
 #include "net_stats.h"
@@ -20,24 +21,200 @@ LOG_MODULE_REGISTER(net_tc, CONFIG_NET_TC_LOG_LEVEL);
 
 /* Template for thread name. The "xx" is either "TX" denoting transmit thread,
  * or "RX" denoting receive thread. The "q[y]" denotes the traffic class queue
- * where y indicates the traffic class id. The value of y can be from 0 to 7.
+ * where y indicates the queue id. Without flow steering the queue id is the
+ * traffic class id and the value of y can be from 0 to 7. With flow steering
+ * each traffic class has NET_TC_FLOW_QUEUES queues.
  */
-#define MAX_NAME_LEN sizeof("xx_q[y]")
+#define MAX_NAME_LEN sizeof("xx_q[yy]")
 
 /* Stacks for TX work queue */
-K_KERNEL_STACK_ARRAY_DEFINE(tx_stack, NET_TC_TX_COUNT,
+K_KERNEL_STACK_ARRAY_DEFINE(tx_stack, NET_TC_TX_QUEUE_COUNT,
 			    CONFIG_NET_TX_STACK_SIZE);
 
 /* Stacks for RX work queue */
-K_KERNEL_STACK_ARRAY_DEFINE(rx_stack, NET_TC_RX_COUNT,
+K_KERNEL_STACK_ARRAY_DEFINE(rx_stack, NET_TC_RX_QUEUE_COUNT,
 			    CONFIG_NET_RX_STACK_SIZE);
 
 #if NET_TC_TX_COUNT > 0
-static struct net_traffic_class tx_classes[NET_TC_TX_COUNT];
+static struct net_traffic_class tx_classes[NET_TC_TX_QUEUE_COUNT];
 #endif
 
 #if NET_TC_RX_COUNT > 0
-static struct net_traffic_class rx_classes[NET_TC_RX_COUNT];
+static struct net_traffic_class rx_classes[NET_TC_RX_QUEUE_COUNT];
+#endif
+
+#if defined(CONFIG_NET_TC_FLOW_STEERING)
+#define FLOW_HASH_BASIS 2166136261U
+#define FLOW_HASH_PRIME 16777619U
+
+/* FNV-1a */
+static uint32_t flow_hash_add(uint32_t hash, const uint8_t *data, size_t len)
+{
+	while (len--) {
+		hash ^= *data++;
+		hash *= FLOW_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+/* Calculate the flow hash of a received packet from its IP addresses and
+ * transport ports. The link layer header is still in the packet at this
+ * point. Only the addresses are used for IP fragments so that all the
+ * fragments of a datagram end up into the same queue.
+ */
+static uint32_t rx_flow_hash(struct net_pkt *pkt)
+{
+	uint32_t hash = FLOW_HASH_BASIS;
+	uint8_t *data = pkt->buffer->data;
+	size_t len = pkt->buffer->len;
+	size_t hdr_len = 0;
+	uint8_t proto;
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (net_if_l2(net_pkt_iface(pkt)) == &NET_L2_GET_NAME(ETHERNET)) {
+		size_t eth_len = sizeof(struct net_eth_hdr);
+		uint16_t type;
+
+		if (len < eth_len) {
+			return 0;
+		}
+
+		type = ntohs(((struct net_eth_hdr *)data)->type);
+		if (type == NET_ETH_PTYPE_VLAN) {
+			eth_len = sizeof(struct net_eth_vlan_hdr);
+			if (len < eth_len) {
+				return 0;
+			}
+
+			type = ntohs(((struct net_eth_vlan_hdr *)data)->type);
+		}
+
+		if (type != NET_ETH_PTYPE_IP && type != NET_ETH_PTYPE_IPV6) {
+			return 0;
+		}
+
+		data += eth_len;
+		len -= eth_len;
+	}
+#endif /* CONFIG_NET_L2_ETHERNET */
+
+	if (len >= sizeof(struct net_ipv4_hdr) && (data[0] & 0xf0) == 0x40) {
+		struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)data;
+
+		hash = flow_hash_add(hash, hdr->src, 2 * sizeof(struct in_addr));
+		proto = hdr->proto;
+
+		if (!(hdr->offset[0] & 0x3f) && !hdr->offset[1]) {
+			hdr_len = (hdr->vhl & 0x0f) * 4U;
+		}
+	} else if (len >= sizeof(struct net_ipv6_hdr) &&
+		   (data[0] & 0xf0) == 0x60) {
+		struct net_ipv6_hdr *hdr = (struct net_ipv6_hdr *)data;
+
+		hash = flow_hash_add(hash, hdr->src,
+				     2 * sizeof(struct in6_addr));
+		proto = hdr->nexthdr;
+		hdr_len = sizeof(struct net_ipv6_hdr);
+	} else {
+		return 0;
+	}
+
+	if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP) && hdr_len > 0 &&
+	    len >= hdr_len + 2 * sizeof(uint16_t)) {
+		hash = flow_hash_add(hash, data + hdr_len,
+				     2 * sizeof(uint16_t));
+		hash = flow_hash_add(hash, &proto, sizeof(proto));
+	}
+
+	return hash;
+}
+
+/* Ask the driver for the hash calculated by the hardware, if it can */
+static uint32_t rx_hw_flow_hash(struct net_pkt *pkt)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	struct net_if *iface = net_pkt_iface(pkt);
+	const struct ethernet_api *api;
+
+	if (net_if_l2(iface) != &NET_L2_GET_NAME(ETHERNET)) {
+		return 0;
+	}
+
+	api = net_if_get_device(iface)->api;
+
+	if (!api->get_flow_hash ||
+	    !(net_eth_get_hw_capabilities(iface) & ETHERNET_HW_FLOW_HASH)) {
+		return 0;
+	}
+
+	return api->get_flow_hash(net_if_get_device(iface), pkt);
+#else
+	ARG_UNUSED(pkt);
+
+	return 0;
+#endif /* CONFIG_NET_L2_ETHERNET */
+}
+
+/* All the packets sent via one network context belong to the same flow */
+static uint32_t tx_flow_hash(struct net_pkt *pkt)
+{
+	struct net_context *context = net_pkt_context(pkt);
+
+	if (!context) {
+		return 0;
+	}
+
+	return flow_hash_add(FLOW_HASH_BASIS, (const uint8_t *)&context,
+			     sizeof(context));
+}
+#endif /* CONFIG_NET_TC_FLOW_STEERING */
+
+#if NET_TC_RX_COUNT > 0
+static int rx_queue_get(uint8_t tc, struct net_pkt *pkt)
+{
+#if defined(CONFIG_NET_TC_FLOW_STEERING)
+	uint32_t hash = net_pkt_flow_hash(pkt);
+
+	/* Use the hash from the driver if there is one, the software hash
+	 * otherwise.
+	 */
+	if (hash == 0U) {
+		hash = rx_hw_flow_hash(pkt);
+		if (hash == 0U) {
+			hash = rx_flow_hash(pkt);
+		}
+
+		net_pkt_set_flow_hash(pkt, hash);
+	}
+
+	return tc * NET_TC_FLOW_QUEUES + hash % NET_TC_FLOW_QUEUES;
+#else
+	ARG_UNUSED(pkt);
+
+	return tc;
+#endif
+}
+#endif
+
+#if NET_TC_TX_COUNT > 0
+static int tx_queue_get(uint8_t tc, struct net_pkt *pkt)
+{
+#if defined(CONFIG_NET_TC_FLOW_STEERING)
+	uint32_t hash = net_pkt_flow_hash(pkt);
+
+	if (hash == 0U) {
+		hash = tx_flow_hash(pkt);
+		net_pkt_set_flow_hash(pkt, hash);
+	}
+
+	return tc * NET_TC_FLOW_QUEUES + hash % NET_TC_FLOW_QUEUES;
+#else
+	ARG_UNUSED(pkt);
+
+	return tc;
+#endif
+}
 #endif
 
 #if NET_TC_RX_COUNT > 0 || NET_TC_TX_COUNT > 0
@@ -52,7 +229,7 @@ bool net_tc_submit_to_tx_queue(uint8_t tc, struct net_pkt *pkt)
 #if NET_TC_TX_COUNT > 0
 	net_pkt_set_tx_stats_tick(pkt, k_cycle_get_32());
 
-	submit_to_queue(&tx_classes[tc].fifo, pkt);
+	submit_to_queue(&tx_classes[tx_queue_get(tc, pkt)].fifo, pkt);
 #else
 	ARG_UNUSED(tc);
 	ARG_UNUSED(pkt);
@@ -65,13 +242,31 @@ void net_tc_submit_to_rx_queue(uint8_t tc, struct net_pkt *pkt)
 #if NET_TC_RX_COUNT > 0
 	net_pkt_set_rx_stats_tick(pkt, k_cycle_get_32());
 
-	submit_to_queue(&rx_classes[tc].fifo, pkt);
+	submit_to_queue(&rx_classes[rx_queue_get(tc, pkt)].fifo, pkt);
 #else
 	ARG_UNUSED(tc);
 	ARG_UNUSED(pkt);
 #endif
 }
 
+/* Return the RX queue served by the calling thread, or a negative value
+ * if the caller is not one of the RX queue threads.
+ */
+int net_tc_rx_current(void)
+{
+#if NET_TC_RX_COUNT > 0
+	k_tid_t tid = k_current_get();
+	int i;
+
+	for (i = 0; i < NET_TC_RX_QUEUE_COUNT; i++) {
+		if (tid == &rx_classes[i].handler) {
+			return i;
+		}
+	}
+#endif
+	return -ENOENT;
+}
+
 int net_tx_priority2tc(enum net_priority prio)
 {
 #if NET_TC_TX_COUNT > 0
@@ -236,13 +431,44 @@ static void net_tc_rx_stats_priority_setup(struct net_if *iface,
 #endif
 #endif
 
+#if NET_TC_RX_COUNT > 0 || NET_TC_TX_COUNT > 0
+/* Spread the flow queues of a traffic class to different CPUs */
+static void queue_cpu_pin(k_tid_t tid, int queue)
+{
+#if defined(CONFIG_NET_TC_FLOW_STEERING) && defined(CONFIG_SCHED_CPU_MASK)
+	int ret;
+
+	ret = k_thread_cpu_pin(tid, (queue % NET_TC_FLOW_QUEUES) %
+			       CONFIG_MP_NUM_CPUS);
+	if (ret < 0) {
+		NET_DBG("Cannot pin queue %d thread (%d)", queue, ret);
+	}
+#else
+	ARG_UNUSED(tid);
+	ARG_UNUSED(queue);
+#endif
+}
+#endif
+
 #if NET_TC_RX_COUNT > 0
-static void tc_rx_handler(struct k_fifo *fifo)
+static void tc_rx_handler(struct k_fifo *fifo, void *queue)
 {
 	struct net_pkt *pkt;
 
 	while (1) {
-		pkt = k_fifo_get(fifo, K_FOREVER);
+		if (IS_ENABLED(CONFIG_NET_GRO)) {
+			/* Release the coalesced TCP segments when the queue
+			 * drains so that GRO only merges within one batch.
+			 */
+			pkt = k_fifo_get(fifo, K_NO_WAIT);
+			if (pkt == NULL) {
+				net_gro_flush(POINTER_TO_INT(queue));
+				pkt = k_fifo_get(fifo, K_FOREVER);
+			}
+		} else {
+			pkt = k_fifo_get(fifo, K_FOREVER);
+		}
+
 		if (pkt == NULL) {
 			continue;
 		}
@@ -285,12 +511,12 @@ void net_tc_tx_init(void)
 	net_if_foreach(net_tc_tx_stats_priority_setup, NULL);
 #endif
 
-	for (i = 0; i < NET_TC_TX_COUNT; i++) {
+	for (i = 0; i < NET_TC_TX_QUEUE_COUNT; i++) {
 		uint8_t thread_priority;
 		int priority;
 		k_tid_t tid;
 
-		thread_priority = tx_tc2thread(i);
+		thread_priority = tx_tc2thread(i / NET_TC_FLOW_QUEUES);
 
 		priority = IS_ENABLED(CONFIG_NET_TC_THREAD_COOPERATIVE) ?
 			K_PRIO_COOP(thread_priority) :
@@ -324,6 +550,8 @@ void net_tc_tx_init(void)
 			k_thread_name_set(tid, name);
 		}
 
+		queue_cpu_pin(tid, i);
+
 		k_thread_start(tid);
 	}
 #endif
@@ -343,12 +571,12 @@ void net_tc_rx_init(void)
 	net_if_foreach(net_tc_rx_stats_priority_setup, NULL);
 #endif
 
-	for (i = 0; i < NET_TC_RX_COUNT; i++) {
+	for (i = 0; i < NET_TC_RX_QUEUE_COUNT; i++) {
 		uint8_t thread_priority;
 		int priority;
 		k_tid_t tid;
 
-		thread_priority = rx_tc2thread(i);
+		thread_priority = rx_tc2thread(i / NET_TC_FLOW_QUEUES);
 
 		priority = IS_ENABLED(CONFIG_NET_TC_THREAD_COOPERATIVE) ?
 			K_PRIO_COOP(thread_priority) :
@@ -368,7 +596,8 @@ void net_tc_rx_init(void)
 		tid = k_thread_create(&rx_classes[i].handler, rx_stack[i],
 				      K_KERNEL_STACK_SIZEOF(rx_stack[i]),
 				      (k_thread_entry_t)tc_rx_handler,
-				      &rx_classes[i].fifo, NULL, NULL,
+				      &rx_classes[i].fifo, INT_TO_POINTER(i),
+				      NULL,
 				      priority, 0, K_FOREVER);
 		if (!tid) {
 			NET_ERR("Cannot create TC handler thread %d", i);
@@ -382,6 +611,8 @@ void net_tc_rx_init(void)
 			k_thread_name_set(tid, name);
 		}
 
+		queue_cpu_pin(tid, i);
+
 		k_thread_start(tid);
 	}
 #endif
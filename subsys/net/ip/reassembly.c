@@ -0,0 +1,558 @@
+/** @file
+ * @brief IP reassembly table
+ *
+ * Fragments of the IPv4 and IPv6 packets waiting reassembly are kept in
+ * a hash table. The reassembly timeouts are driven by a timer wheel with
+ * a resolution of one second, so a single delayed work item serves all
+ * the pending packets.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_reassembly, CONFIG_NET_REASSEMBLY_LOG_LEVEL);
+
+#include <errno.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_pkt.h>
+#include "net_private.h"
+#include "icmpv4.h"
+#include "icmpv6.h"
+#include "reassembly.h"
+
+/* The wheel must be longer than the longest reassembly timeout (60 s) so
+ * that a pending reassembly is never found in its slot too early.
+ */
+#define WHEEL_SLOTS 64
+
+#if defined(CONFIG_NET_IPV4_FRAGMENT)
+#define IPV4_TIMEOUT CONFIG_NET_IPV4_FRAGMENT_TIMEOUT
+#else
+#define IPV4_TIMEOUT 0
+#endif
+
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#define IPV6_TIMEOUT CONFIG_NET_IPV6_FRAGMENT_TIMEOUT
+#else
+#define IPV6_TIMEOUT 0
+#endif
+
+BUILD_ASSERT(IPV4_TIMEOUT + 1 < WHEEL_SLOTS && IPV6_TIMEOUT + 1 < WHEEL_SLOTS);
+
+static void reassembly_timeout(struct k_work *work);
+
+static struct net_reassembly reassembly[NET_REASSEMBLY_COUNT];
+static sys_slist_t reassembly_free;
+static sys_slist_t reassembly_table[CONFIG_NET_REASSEMBLY_HASH_SIZE];
+static sys_dlist_t reassembly_wheel[WHEEL_SLOTS];
+static uint32_t reassembly_tick;
+static uint8_t reassembly_count[2]; /* Pending packets, IPv4 and IPv6 */
+static bool reassembly_init_done;
+
+static K_MUTEX_DEFINE(reassembly_lock);
+static K_WORK_DELAYABLE_DEFINE(reassembly_timer, reassembly_timeout);
+
+static void reassembly_init(void)
+{
+	int i;
+
+	for (i = 0; i < NET_REASSEMBLY_COUNT; i++) {
+		sys_slist_append(&reassembly_free, &reassembly[i].node);
+	}
+
+	for (i = 0; i < WHEEL_SLOTS; i++) {
+		sys_dlist_init(&reassembly_wheel[i]);
+	}
+
+	reassembly_init_done = true;
+}
+
+static inline uint32_t reassembly_now(void)
+{
+	return (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
+}
+
+static inline int family_idx(sa_family_t family)
+{
+	return family == AF_INET ? 0 : 1;
+}
+
+static inline int max_count(sa_family_t family)
+{
+	return family == AF_INET ? NET_REASSEMBLY_IPV4_COUNT :
+				   NET_REASSEMBLY_IPV6_COUNT;
+}
+
+static inline int max_pkt(sa_family_t family)
+{
+	return family == AF_INET ? NET_REASSEMBLY_IPV4_MAX_PKT :
+				   NET_REASSEMBLY_IPV6_MAX_PKT;
+}
+
+static inline uint32_t timeout(sa_family_t family)
+{
+	return family == AF_INET ? IPV4_TIMEOUT : IPV6_TIMEOUT;
+}
+
+static inline size_t addr_len(sa_family_t family)
+{
+	return family == AF_INET ? sizeof(struct in_addr) :
+				   sizeof(struct in6_addr);
+}
+
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *ptr = data;
+
+	while (len--) {
+		hash ^= *ptr++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static uint32_t key_hash(const struct net_reassembly_key *key)
+{
+	size_t len = addr_len(key->src.family);
+	uint32_t hash = 2166136261U;
+
+	hash = fnv1a(hash, &key->src.in6_addr, len);
+	hash = fnv1a(hash, &key->dst.in6_addr, len);
+	hash = fnv1a(hash, &key->id, sizeof(key->id));
+	hash = fnv1a(hash, &key->proto, sizeof(key->proto));
+
+	return fnv1a(hash, &key->src.family, sizeof(key->src.family));
+}
+
+static bool key_equal(const struct net_reassembly_key *a,
+		      const struct net_reassembly_key *b)
+{
+	size_t len = addr_len(a->src.family);
+
+	return a->src.family == b->src.family && a->id == b->id &&
+	       a->proto == b->proto &&
+	       !memcmp(&a->src.in6_addr, &b->src.in6_addr, len) &&
+	       !memcmp(&a->dst.in6_addr, &b->dst.in6_addr, len);
+}
+
+static inline sys_slist_t *bucket(uint32_t hash)
+{
+	return &reassembly_table[hash % CONFIG_NET_REASSEMBLY_HASH_SIZE];
+}
+
+static inline uint16_t frag_len(struct net_reassembly *reass, int i)
+{
+	return net_pkt_get_len(reass->pkt[i]) - reass->hdr_len[i];
+}
+
+static struct net_reassembly *reassembly_find(
+				const struct net_reassembly_key *key,
+				uint32_t hash)
+{
+	struct net_reassembly *reass;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(bucket(hash), reass, node) {
+		if (reass->hash == hash && key_equal(&reass->key, key)) {
+			return reass;
+		}
+	}
+
+	return NULL;
+}
+
+static struct net_reassembly *reassembly_alloc(
+				const struct net_reassembly_key *key,
+				uint32_t hash)
+{
+	int idx = family_idx(key->src.family);
+	struct net_reassembly *reass;
+	uint32_t now = reassembly_now();
+	sys_snode_t *node;
+
+	if (reassembly_count[idx] >= max_count(key->src.family)) {
+		return NULL;
+	}
+
+	node = sys_slist_get(&reassembly_free);
+	if (!node) {
+		return NULL;
+	}
+
+	reass = CONTAINER_OF(node, struct net_reassembly, node);
+
+	memset(reass->pkt, 0, sizeof(reass->pkt));
+	memcpy(&reass->key, key, sizeof(reass->key));
+	reass->hash = hash;
+	reass->size = 0U;
+	reass->total = 0U;
+
+	if (!reassembly_count[0] && !reassembly_count[1]) {
+		/* The wheel is idle, restart it from the current time */
+		reassembly_tick = now;
+		k_work_reschedule(&reassembly_timer, K_SECONDS(1));
+	}
+
+	/* The current second has partly elapsed already, round the expiry up
+	 * so that the reassembly never times out early.
+	 */
+	reass->expiry = now + timeout(key->src.family) + 1U;
+
+	sys_dlist_append(&reassembly_wheel[reass->expiry % WHEEL_SLOTS],
+			 &reass->wheel_node);
+	sys_slist_prepend(bucket(hash), &reass->node);
+	reassembly_count[idx]++;
+
+	return reass;
+}
+
+/* Remove from the table, the entry can then be handled without the lock */
+static void reassembly_detach(struct net_reassembly *reass)
+{
+	sys_slist_find_and_remove(bucket(reass->hash), &reass->node);
+	sys_dlist_remove(&reass->wheel_node);
+	reassembly_count[family_idx(reass->key.src.family)]--;
+}
+
+static void reassembly_release(struct net_reassembly *reass)
+{
+	int i;
+
+	for (i = 0; i < NET_REASSEMBLY_MAX_PKT; i++) {
+		if (!reass->pkt[i]) {
+			continue;
+		}
+
+		NET_DBG("[%d] reassembly pkt %p %zd bytes data",
+			i, reass->pkt[i], net_pkt_get_len(reass->pkt[i]));
+
+		net_pkt_unref(reass->pkt[i]);
+		reass->pkt[i] = NULL;
+	}
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+	sys_slist_append(&reassembly_free, &reass->node);
+	k_mutex_unlock(&reassembly_lock);
+}
+
+static void reassembly_expired(struct net_reassembly *reass)
+{
+	struct net_pkt *first = reass->pkt[0];
+
+	NET_DBG("Reassembly cancelled id 0x%x", reass->key.id);
+
+	/* Send a Time Exceeded error only if we received the first fragment
+	 * (RFC 792 and RFC 8200 Sec. 4.5).
+	 */
+	if (first && reass->offset[0] == 0U) {
+		if (IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT) &&
+		    reass->key.src.family == AF_INET) {
+			net_icmpv4_send_error(first, NET_ICMPV4_TIME_EXCEEDED,
+					      NET_ICMPV4_TIME_EXCEEDED_FRAGMENT_REASSEMBLY);
+		} else if (IS_ENABLED(CONFIG_NET_IPV6_FRAGMENT) &&
+			   reass->key.src.family == AF_INET6) {
+			net_icmpv6_send_error(first, NET_ICMPV6_TIME_EXCEEDED,
+					      1, 0);
+		}
+	}
+
+	reassembly_release(reass);
+}
+
+static void reassembly_timeout(struct k_work *work)
+{
+	struct net_reassembly *reass, *next;
+	sys_dlist_t expired;
+	uint32_t now;
+
+	ARG_UNUSED(work);
+
+	sys_dlist_init(&expired);
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	now = reassembly_now();
+
+	while ((int32_t)(now - reassembly_tick) > 0) {
+		sys_dlist_t *slot;
+
+		reassembly_tick++;
+		slot = &reassembly_wheel[reassembly_tick % WHEEL_SLOTS];
+
+		SYS_DLIST_FOR_EACH_CONTAINER_SAFE(slot, reass, next,
+						  wheel_node) {
+			if ((int32_t)(reass->expiry - reassembly_tick) > 0) {
+				continue;
+			}
+
+			reassembly_detach(reass);
+			sys_dlist_append(&expired, &reass->wheel_node);
+		}
+	}
+
+	if (reassembly_count[0] || reassembly_count[1]) {
+		k_work_reschedule(&reassembly_timer, K_SECONDS(1));
+	}
+
+	k_mutex_unlock(&reassembly_lock);
+
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&expired, reass, next, wheel_node) {
+		sys_dlist_remove(&reass->wheel_node);
+		reassembly_expired(reass);
+	}
+}
+
+/* Store the fragment, the fragments are kept sorted by offset. */
+static int fragment_insert(struct net_reassembly *reass, struct net_pkt *pkt,
+			   uint16_t offset, uint16_t hdr_len)
+{
+	int count = max_pkt(reass->key.src.family);
+	int pos, last;
+
+	for (last = 0; last < count && reass->pkt[last]; last++) {
+	}
+
+	if (last == count) {
+		/* We do not have free space left in the array */
+		return -ENOMEM;
+	}
+
+	for (pos = last; pos > 0 && reass->offset[pos - 1] > offset; pos--) {
+		reass->pkt[pos] = reass->pkt[pos - 1];
+		reass->offset[pos] = reass->offset[pos - 1];
+		reass->hdr_len[pos] = reass->hdr_len[pos - 1];
+	}
+
+	NET_DBG("Storing pkt %p to slot %d offset %d", pkt, pos, offset);
+
+	reass->pkt[pos] = pkt;
+	reass->offset[pos] = offset;
+	reass->hdr_len[pos] = hdr_len;
+
+	return 0;
+}
+
+/* Verify that we have all the fragments received and in correct order.
+ * Return:
+ * - a negative value if the fragments are erroneous and must be dropped
+ * - zero if we are expecting more fragments
+ * - a positive value if we can proceed with the reassembly
+ */
+static int fragments_are_ready(struct net_reassembly *reass)
+{
+	uint32_t expected_offset = 0U;
+	int i;
+
+	for (i = 0; i < NET_REASSEMBLY_MAX_PKT && reass->pkt[i]; i++) {
+		if (reass->offset[i] < expected_offset) {
+			/* Overlapping or duplicated, RFC 8200 and RFC 5722
+			 * tell to drop the whole packet. The same is done
+			 * for IPv4 as overlaps are only seen in attacks.
+			 */
+			return -EBADMSG;
+		} else if (reass->offset[i] != expected_offset) {
+			/* Not contiguous, let's wait for fragments */
+			return 0;
+		}
+
+		expected_offset += frag_len(reass, i);
+	}
+
+	/* The total length is known once the fragment without the More
+	 * flag has been received.
+	 */
+	if (!reass->total || expected_offset != reass->total) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Drop the headers by moving the data pointer of the buffers, so that the
+ * payload is not moved.
+ */
+static void strip_headers(struct net_pkt *pkt, size_t len)
+{
+	while (len) {
+		struct net_buf *buf = pkt->buffer;
+
+		if (len < buf->len) {
+			net_buf_pull(buf, len);
+			break;
+		}
+
+		len -= buf->len;
+		pkt->buffer = buf->frags;
+		buf->frags = NULL;
+		net_buf_unref(buf);
+	}
+
+	net_pkt_cursor_init(pkt);
+}
+
+/* Chain the payload of all the fragments to the first one */
+static struct net_pkt *reassemble_packet(struct net_reassembly *reass)
+{
+	struct net_pkt *first = reass->pkt[0];
+	struct net_buf *last;
+	int i;
+
+	last = net_buf_frag_last(first->buffer);
+
+	for (i = 1; i < NET_REASSEMBLY_MAX_PKT && reass->pkt[i]; i++) {
+		struct net_pkt *pkt = reass->pkt[i];
+
+		strip_headers(pkt, reass->hdr_len[i]);
+
+		if (!pkt->buffer) {
+			/* Fragment without payload */
+			goto next;
+		}
+
+		last->frags = pkt->buffer;
+		last = net_buf_frag_last(pkt->buffer);
+		pkt->buffer = NULL;
+next:
+		reass->pkt[i] = NULL;
+		net_pkt_unref(pkt);
+	}
+
+	reass->pkt[0] = NULL;
+
+	net_pkt_cursor_init(first);
+
+	return first;
+}
+
+int net_reassembly_input(const struct net_reassembly_key *key,
+			 struct net_pkt *pkt, uint16_t offset,
+			 uint16_t hdr_len, bool more,
+			 struct net_pkt **complete)
+{
+	uint32_t hash = key_hash(key);
+	struct net_reassembly *reass;
+	size_t len;
+	int ret;
+	int i;
+
+	*complete = NULL;
+
+	len = net_pkt_get_len(pkt);
+	if (len < hdr_len) {
+		return -EINVAL;
+	}
+
+	len -= hdr_len;
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	if (!reassembly_init_done) {
+		reassembly_init();
+	}
+
+	reass = reassembly_find(key, hash);
+	if (!reass) {
+		reass = reassembly_alloc(key, hash);
+		if (!reass) {
+			NET_DBG("Cannot get reassembly slot, dropping pkt %p",
+				pkt);
+			k_mutex_unlock(&reassembly_lock);
+			return -ENOMEM;
+		}
+	}
+
+	if (offset + len > CONFIG_NET_REASSEMBLY_MAX_SIZE) {
+		NET_DBG("Packet id 0x%x too large (%zd bytes)", key->id,
+			offset + len);
+		ret = -EMSGSIZE;
+		goto drop;
+	}
+
+	if (!more) {
+		if (reass->total && reass->total != offset + len) {
+			ret = -EBADMSG;
+			goto drop;
+		}
+
+		reass->total = offset + len;
+	}
+
+	if (reass->total && offset + len > reass->total) {
+		ret = -EBADMSG;
+		goto drop;
+	}
+
+	ret = fragment_insert(reass, pkt, offset, hdr_len);
+	if (ret < 0) {
+		NET_DBG("No slots available for 0x%x", key->id);
+		goto drop;
+	}
+
+	reass->size += len;
+
+	ret = fragments_are_ready(reass);
+	if (ret < 0) {
+		NET_DBG("Reassembly verify failed, dropping id 0x%x", key->id);
+		goto drop;
+	} else if (ret == 0) {
+		NET_DBG("More fragments to be received for id 0x%x (%u bytes)",
+			key->id, reass->size);
+		k_mutex_unlock(&reassembly_lock);
+		return 0;
+	}
+
+	reassembly_detach(reass);
+	k_mutex_unlock(&reassembly_lock);
+
+	NET_DBG("Reassembly last pkt id 0x%x (%u bytes)", key->id,
+		reass->size);
+
+	*complete = reassemble_packet(reass);
+	reassembly_release(reass);
+
+	return 0;
+
+drop:
+	reassembly_detach(reass);
+	k_mutex_unlock(&reassembly_lock);
+
+	/* Let the caller release the packet */
+	for (i = 0; i < NET_REASSEMBLY_MAX_PKT; i++) {
+		if (reass->pkt[i] == pkt) {
+			reass->pkt[i] = NULL;
+		}
+	}
+
+	reassembly_release(reass);
+
+	return ret;
+}
+
+void net_reassembly_foreach(net_reassembly_cb_t cb, void *user_data)
+{
+	struct net_reassembly *reass;
+	int64_t now;
+	int i;
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	now = k_uptime_get();
+
+	for (i = 0; reassembly_init_done &&
+		     i < CONFIG_NET_REASSEMBLY_HASH_SIZE; i++) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&reassembly_table[i], reass,
+					     node) {
+			int64_t remaining;
+
+			remaining = (int64_t)reass->expiry * MSEC_PER_SEC - now;
+
+			cb(reass, MAX(remaining, 0), user_data);
+		}
+	}
+
+	k_mutex_unlock(&reassembly_lock);
+}
@@ -0,0 +1,153 @@
+/** @file
+ * @brief IP reassembly table
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __REASSEMBLY_H
+#define __REASSEMBLY_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/dlist.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_pkt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_NET_IPV4_FRAGMENT)
+#define NET_REASSEMBLY_IPV4_COUNT CONFIG_NET_IPV4_FRAGMENT_MAX_COUNT
+#define NET_REASSEMBLY_IPV4_MAX_PKT CONFIG_NET_IPV4_FRAGMENT_MAX_PKT
+#else
+#define NET_REASSEMBLY_IPV4_COUNT 0
+#define NET_REASSEMBLY_IPV4_MAX_PKT 0
+#endif
+
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#define NET_REASSEMBLY_IPV6_COUNT CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT
+#define NET_REASSEMBLY_IPV6_MAX_PKT CONFIG_NET_IPV6_FRAGMENT_MAX_PKT
+#else
+#define NET_REASSEMBLY_IPV6_COUNT 0
+#define NET_REASSEMBLY_IPV6_MAX_PKT 0
+#endif
+
+/** Number of packets that can be waiting reassembly */
+#define NET_REASSEMBLY_COUNT (NET_REASSEMBLY_IPV4_COUNT + \
+			      NET_REASSEMBLY_IPV6_COUNT)
+
+/** Max number of fragments of one packet */
+#define NET_REASSEMBLY_MAX_PKT MAX(NET_REASSEMBLY_IPV4_MAX_PKT, \
+				   NET_REASSEMBLY_IPV6_MAX_PKT)
+
+/** Fields identifying the fragments of one packet */
+struct net_reassembly_key {
+	/** Source address, its family is the family of the packet */
+	struct net_addr src;
+
+	/** Destination address */
+	struct net_addr dst;
+
+	/** Fragment identification */
+	uint32_t id;
+
+	/** Upper layer protocol, only used by IPv4 */
+	uint8_t proto;
+};
+
+/** Packet waiting reassembly */
+struct net_reassembly {
+	/** Hash bucket list node */
+	sys_snode_t node;
+
+	/** Timer wheel list node */
+	sys_dnode_t wheel_node;
+
+	/** Addresses and identification of the fragments */
+	struct net_reassembly_key key;
+
+	/** Pending fragments, sorted by offset */
+	struct net_pkt *pkt[NET_REASSEMBLY_MAX_PKT];
+
+	/** Payload offset of each pending fragment */
+	uint16_t offset[NET_REASSEMBLY_MAX_PKT];
+
+	/** Length of the headers before the payload in each fragment */
+	uint16_t hdr_len[NET_REASSEMBLY_MAX_PKT];
+
+	/** Bytes of fragment payload held */
+	uint32_t size;
+
+	/** Length of the reassembled payload, 0 until the last fragment has
+	 * been received.
+	 */
+	uint32_t total;
+
+	/** Timer wheel tick (in seconds) when the reassembly times out */
+	uint32_t expiry;
+
+	/** Hash of the key */
+	uint32_t hash;
+};
+
+/**
+ * @typedef net_reassembly_cb_t
+ * @brief Callback used while iterating over the pending reassemblies.
+ *
+ * @param reass Pending reassembly, must not be modified.
+ * @param remaining Time until the reassembly times out (in ms).
+ * @param user_data A valid pointer on some user data or NULL
+ */
+typedef void (*net_reassembly_cb_t)(const struct net_reassembly *reass,
+				    uint32_t remaining, void *user_data);
+
+/**
+ * @brief Store a received fragment in the reassembly table.
+ *
+ * The fragments are kept in the table until all of them have been
+ * received, or until the reassembly times out. When the last missing
+ * fragment is received, the payload of the other fragments is chained
+ * to the first fragment without copying it, and the first fragment
+ * (which still holds its own headers) is returned to the caller. The
+ * caller must then fix the headers of the packet.
+ *
+ * When the reassembly times out and the first fragment has been received,
+ * an ICMP Time Exceeded error is sent.
+ *
+ * @param key Addresses and identification of the fragment.
+ * @param pkt Received fragment.
+ * @param offset Offset of the fragment payload in the reassembled payload.
+ * @param hdr_len Length of the headers before the fragment payload.
+ * @param more True if this is not the last fragment.
+ * @param complete Set to the reassembled packet when this was the last
+ *        missing fragment, or to NULL.
+ *
+ * @return 0 if the fragment was stored or the packet was reassembled,
+ *         a negative errno otherwise. In that case the packet is not
+ *         consumed and all the fragments received for it are dropped.
+ */
+int net_reassembly_input(const struct net_reassembly_key *key,
+			 struct net_pkt *pkt, uint16_t offset,
+			 uint16_t hdr_len, bool more,
+			 struct net_pkt **complete);
+
+/**
+ * @brief Go through all the pending reassemblies.
+ *
+ * @param cb Callback to call for each pending reassembly.
+ * @param user_data User specified data or NULL.
+ */
+void net_reassembly_foreach(net_reassembly_cb_t cb, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __REASSEMBLY_H */
@@ -28,6 +28,7 @@ LOG_MODULE_REGISTER(net_route, CONFIG_NET_ROUTE_LOG_LEVEL);
 #include "icmpv6.h"
 #include "nbr.h"
 #include "route.h"
+#include "route_lpm.h"
 
 #if !defined(NET_ROUTE_EXTRA_DATA_SIZE)
 #define NET_ROUTE_EXTRA_DATA_SIZE 0
@@ -46,6 +47,10 @@ static struct k_work_delayable route_lifetime_timer;
 
 static K_MUTEX_DEFINE(lock);
 
+#if defined(CONFIG_NET_ROUTE_LPM)
+NET_ROUTE_LPM_DEFINE(route_lpm, CONFIG_NET_MAX_ROUTES, 128);
+#endif
+
 static void net_route_nexthop_remove(struct net_nbr *nbr)
 {
 	NET_DBG("Nexthop %p removed", nbr);
@@ -191,6 +196,46 @@ void net_routes_print(void)
 	k_mutex_unlock(&lock);
 }
 
+#if defined(CONFIG_NET_ROUTE_LPM)
+static void route_lpm_del(struct net_route_entry *route)
+{
+	struct net_route_entry *other;
+	int i;
+
+	if (net_route_lpm_get(&route_lpm, route->addr.s6_addr,
+			      route->prefix_len) != route) {
+		/* Same prefix via some other interface is in the trie */
+		return;
+	}
+
+	(void)net_route_lpm_del(&route_lpm, route->addr.s6_addr,
+				route->prefix_len);
+
+	/* If there is another route with the same prefix, it takes over */
+	for (i = 0; i < CONFIG_NET_MAX_ROUTES; i++) {
+		struct net_nbr *nbr = get_nbr(i);
+
+		if (!nbr->ref) {
+			continue;
+		}
+
+		other = net_route_data(nbr);
+		if (other == route || other->prefix_len != route->prefix_len ||
+		    !net_ipv6_is_prefix(other->addr.s6_addr,
+					route->addr.s6_addr,
+					route->prefix_len)) {
+			continue;
+		}
+
+		(void)net_route_lpm_add(&route_lpm, other->addr.s6_addr,
+					other->prefix_len, other);
+		break;
+	}
+}
+#else
+#define route_lpm_del(...)
+#endif
+
 static inline void nbr_free(struct net_nbr *nbr)
 {
 	NET_DBG("nbr %p", nbr);
@@ -287,6 +332,20 @@ struct net_route_entry *net_route_lookup(struct net_if *iface,
 	uint8_t longest_match = 0U;
 	int i;
 
+#if defined(CONFIG_NET_ROUTE_LPM)
+	/* The trie only holds one route per prefix, so if the caller is
+	 * interested in a specific interface and the best route goes via
+	 * some other interface, we need to scan the whole table.
+	 */
+	found = net_route_lpm_lookup(&route_lpm, dst->s6_addr);
+	if (found && (!iface || found->iface == iface)) {
+		net_route_info("Found", found, dst);
+		return found;
+	}
+
+	found = NULL;
+#endif
+
 	k_mutex_lock(&lock, K_FOREVER);
 
 	for (i = 0; i < CONFIG_NET_MAX_ROUTES && longest_match < 128; i++) {
@@ -314,7 +373,9 @@ struct net_route_entry *net_route_lookup(struct net_if *iface,
 	if (found) {
 		net_route_info("Found", found, dst);
 
-		update_route_access(found);
+		if (!IS_ENABLED(CONFIG_NET_ROUTE_LPM)) {
+			update_route_access(found);
+		}
 	}
 
 	k_mutex_unlock(&lock);
@@ -470,6 +531,15 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	sys_slist_init(&route->nexthop);
 	sys_slist_prepend(&route->nexthop, &nexthop_route->node);
 
+	/* Only now the route is complete and can be seen by the lookups */
+#if defined(CONFIG_NET_ROUTE_LPM)
+	if (net_route_lpm_add(&route_lpm, addr->s6_addr, prefix_len,
+			      route) < 0) {
+		NET_DBG("Cannot add route %s/%d to the lookup table",
+			net_sprint_ipv6_addr(addr), prefix_len);
+	}
+#endif
+
 	net_route_info("Added", route, addr);
 
 #if defined(CONFIG_NET_MGMT_EVENT_INFO)
@@ -611,6 +681,8 @@ int net_route_del(struct net_route_entry *route)
 
 	net_route_info("Deleted", route, &route->addr);
 
+	route_lpm_del(route);
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&route->nexthop, nexthop_route, node) {
 		if (!nexthop_route->nbr) {
 			continue;
@@ -1109,4 +1181,8 @@ void net_route_init(void)
 		CONFIG_NET_MAX_NEXTHOPS, sizeof(net_route_nexthop_pool));
 
 	k_work_init_delayable(&route_lifetime_timer, route_lifetime_timeout);
+
+#if defined(CONFIG_NET_ROUTE_LPM)
+	net_route_lpm_init(&route_lpm);
+#endif
 }
@@ -319,6 +319,170 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop);
  */
 int net_route_packet_if(struct net_pkt *pkt, struct net_if *iface);
 
+/**
+ * @brief IPv4 route entry.
+ */
+struct net_route_entry_ipv4 {
+	/** Network interface for the route. */
+	struct net_if *iface;
+
+	/** IPv4 address/prefix of the route. */
+	struct in_addr addr;
+
+	/** Next hop router, unspecified address if the network is directly
+	 * connected to the interface.
+	 */
+	struct in_addr nexthop;
+
+	/** IPv4 address/prefix length. */
+	uint8_t prefix_len;
+
+	/** Is this entry in use or not */
+	bool is_used;
+};
+
+typedef void (*net_route_ipv4_cb_t)(struct net_route_entry_ipv4 *entry,
+				    void *user_data);
+
+#if defined(CONFIG_NET_ROUTE_IPV4)
+/**
+ * @brief Add an IPv4 route to routing table. If there already is a route
+ * to the same prefix, it is updated.
+ *
+ * @param iface Network interface that this route is tied to.
+ * @param addr IPv4 address/prefix.
+ * @param prefix_len Length of the IPv4 prefix.
+ * @param nexthop IPv4 address of the next hop router, NULL if the network
+ * is directly connected to the interface.
+ *
+ * @return Return created route entry, NULL if could not be created.
+ */
+struct net_route_entry_ipv4 *net_route_ipv4_add(struct net_if *iface,
+						struct in_addr *addr,
+						uint8_t prefix_len,
+						struct in_addr *nexthop);
+
+/**
+ * @brief Delete an IPv4 route from routing table.
+ *
+ * Waits until the readers that might have found the entry are done with
+ * it, so this must not be called inside a read section.
+ *
+ * @param route Existing route entry.
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_route_ipv4_del(struct net_route_entry_ipv4 *route);
+
+/**
+ * @brief Delete all IPv4 routes that go via a network interface.
+ *
+ * @param iface Network interface.
+ *
+ * @return Number of routes deleted.
+ */
+int net_route_ipv4_del_by_iface(struct net_if *iface);
+
+/**
+ * @brief Lookup IPv4 route to a given destination. This does not take
+ * any lock so it can be used in the packet forwarding path.
+ *
+ * The entry can be updated or deleted at any time, so the caller must
+ * hold a read section, see net_route_ipv4_read_begin(), while using it.
+ *
+ * @param dst Destination IPv4 address.
+ *
+ * @return Route entry with the longest prefix matching the destination,
+ * NULL if not found.
+ */
+struct net_route_entry_ipv4 *net_route_ipv4_lookup(struct in_addr *dst);
+
+/**
+ * @brief Lookup IPv4 route to a given destination and copy the entry.
+ * This does not take any lock and the copy is consistent even if the
+ * route is updated at the same time.
+ *
+ * @param dst Destination IPv4 address.
+ * @param route Copy of the route entry with the longest prefix matching
+ * the destination.
+ *
+ * @return True if a route was found, false otherwise.
+ */
+bool net_route_ipv4_lookup_copy(struct in_addr *dst,
+				struct net_route_entry_ipv4 *route);
+
+/**
+ * @brief Start using the route entries returned by net_route_ipv4_lookup().
+ * The entries are not reused by the route table until the section ends.
+ *
+ * @return Key for net_route_ipv4_read_end().
+ */
+int net_route_ipv4_read_begin(void);
+
+/**
+ * @brief Stop using the route entries returned by net_route_ipv4_lookup().
+ *
+ * @param key Value returned by net_route_ipv4_read_begin().
+ */
+void net_route_ipv4_read_end(int key);
+
+/**
+ * @brief Return the address that the packets to a destination are sent
+ * to when using a route.
+ *
+ * @param route Route entry.
+ * @param dst Destination IPv4 address.
+ *
+ * @return Next hop router address, or dst if the network is directly
+ * connected.
+ */
+struct in_addr *net_route_ipv4_get_nexthop(struct net_route_entry_ipv4 *route,
+					   struct in_addr *dst);
+
+/**
+ * @brief Go through all the IPv4 routing entries and call callback
+ * for each entry that is in use.
+ *
+ * @param cb User supplied callback function to call.
+ * @param user_data User specified data.
+ *
+ * @return Total number of routing entries found.
+ */
+int net_route_ipv4_foreach(net_route_ipv4_cb_t cb, void *user_data);
+
+/**
+ * @brief Forward the IPv4 network packet using a route.
+ *
+ * @param pkt Network packet to send.
+ * @param route Route entry for the packet destination.
+ *
+ * @return 0 if there was no error, <0 if the packet could not be sent.
+ */
+int net_route_ipv4_packet(struct net_pkt *pkt,
+			  struct net_route_entry_ipv4 *route);
+
+void net_route_ipv4_init(void);
+#else
+static inline struct net_route_entry_ipv4 *
+net_route_ipv4_lookup(struct in_addr *dst)
+{
+	ARG_UNUSED(dst);
+
+	return NULL;
+}
+
+static inline bool net_route_ipv4_lookup_copy(struct in_addr *dst,
+					      struct net_route_entry_ipv4 *route)
+{
+	ARG_UNUSED(dst);
+	ARG_UNUSED(route);
+
+	return false;
+}
+
+#define net_route_ipv4_init(...)
+#endif /* CONFIG_NET_ROUTE_IPV4 */
+
 #if defined(CONFIG_NET_ROUTE) && defined(CONFIG_NET_NATIVE)
 void net_route_init(void);
 #else
@@ -0,0 +1,249 @@
+/** @file
+ * @brief IPv4 route handling.
+ *
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_route_ipv4, CONFIG_NET_ROUTE_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+
+#include "net_private.h"
+#include "ipv4.h"
+#include "route.h"
+#include "route_lpm.h"
+
+static struct net_route_entry_ipv4 routes_ipv4[CONFIG_NET_MAX_ROUTES_IPV4];
+
+NET_ROUTE_LPM_DEFINE(route_ipv4_lpm, CONFIG_NET_MAX_ROUTES_IPV4, 32);
+
+/* Serializes the route table updates, lookups do not use this */
+static K_MUTEX_DEFINE(lock);
+
+static struct net_route_entry_ipv4 *route_ipv4_find(struct in_addr *addr,
+						    uint8_t prefix_len)
+{
+	return net_route_lpm_get(&route_ipv4_lpm, (const uint8_t *)addr,
+				 prefix_len);
+}
+
+struct net_route_entry_ipv4 *net_route_ipv4_add(struct net_if *iface,
+						struct in_addr *addr,
+						uint8_t prefix_len,
+						struct in_addr *nexthop)
+{
+	struct net_route_entry_ipv4 *route = NULL;
+	int i, ret;
+
+	NET_ASSERT(iface);
+	NET_ASSERT(addr);
+
+	if (prefix_len > 32) {
+		return NULL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	/* The lookups can see an entry any time, so all the entry changes
+	 * are done in a write section of the table.
+	 */
+	net_route_lpm_write_begin(&route_ipv4_lpm);
+
+	route = route_ipv4_find(addr, prefix_len);
+	if (route) {
+		route->iface = iface;
+		net_ipaddr_copy(&route->nexthop,
+				nexthop ? nexthop : net_ipv4_unspecified_address());
+
+		NET_DBG("Updated route %s/%d iface %p",
+			net_sprint_ipv4_addr(addr), prefix_len, iface);
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(routes_ipv4); i++) {
+		if (!routes_ipv4[i].is_used) {
+			route = &routes_ipv4[i];
+			break;
+		}
+	}
+
+	if (!route) {
+		NET_DBG("No free IPv4 route entries");
+		goto out;
+	}
+
+	route->iface = iface;
+	route->prefix_len = prefix_len;
+	net_ipaddr_copy(&route->addr, addr);
+	net_ipaddr_copy(&route->nexthop,
+			nexthop ? nexthop : net_ipv4_unspecified_address());
+
+	ret = net_route_lpm_add(&route_ipv4_lpm, (const uint8_t *)addr,
+				prefix_len, route);
+	if (ret < 0) {
+		NET_DBG("Cannot add route %s/%d (%d)",
+			net_sprint_ipv4_addr(addr), prefix_len, ret);
+		route = NULL;
+		goto out;
+	}
+
+	route->is_used = true;
+
+	NET_DBG("Added route %s/%d iface %p",
+		net_sprint_ipv4_addr(addr), prefix_len, iface);
+
+out:
+	net_route_lpm_write_end(&route_ipv4_lpm);
+	k_mutex_unlock(&lock);
+
+	return route;
+}
+
+int net_route_ipv4_del(struct net_route_entry_ipv4 *route)
+{
+	int ret;
+
+	if (!route || !route->is_used) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	ret = net_route_lpm_del(&route_ipv4_lpm, (const uint8_t *)&route->addr,
+				route->prefix_len);
+	if (ret == 0) {
+		NET_DBG("Deleted route %s/%d",
+			net_sprint_ipv4_addr(&route->addr), route->prefix_len);
+
+		/* A reader that found the entry just before the removal
+		 * might still use it, wait for it before the entry can be
+		 * reused by later adds.
+		 */
+		net_route_lpm_synchronize(&route_ipv4_lpm);
+
+		route->is_used = false;
+	}
+
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+int net_route_ipv4_del_by_iface(struct net_if *iface)
+{
+	int i, count = 0;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(routes_ipv4); i++) {
+		if (!routes_ipv4[i].is_used || routes_ipv4[i].iface != iface) {
+			continue;
+		}
+
+		if (net_route_ipv4_del(&routes_ipv4[i]) == 0) {
+			count++;
+		}
+	}
+
+	k_mutex_unlock(&lock);
+
+	return count;
+}
+
+struct net_route_entry_ipv4 *net_route_ipv4_lookup(struct in_addr *dst)
+{
+	return net_route_lpm_lookup(&route_ipv4_lpm, (const uint8_t *)dst);
+}
+
+bool net_route_ipv4_lookup_copy(struct in_addr *dst,
+				struct net_route_entry_ipv4 *route)
+{
+	return net_route_lpm_lookup_copy(&route_ipv4_lpm, (const uint8_t *)dst,
+					 route, sizeof(*route)) != NULL;
+}
+
+int net_route_ipv4_read_begin(void)
+{
+	return net_route_lpm_read_begin(&route_ipv4_lpm);
+}
+
+void net_route_ipv4_read_end(int key)
+{
+	net_route_lpm_read_end(&route_ipv4_lpm, key);
+}
+
+struct in_addr *net_route_ipv4_get_nexthop(struct net_route_entry_ipv4 *route,
+					   struct in_addr *dst)
+{
+	if (net_ipv4_is_addr_unspecified(&route->nexthop)) {
+		/* Directly connected network */
+		return dst;
+	}
+
+	return &route->nexthop;
+}
+
+int net_route_ipv4_foreach(net_route_ipv4_cb_t cb, void *user_data)
+{
+	int i, ret = 0;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(routes_ipv4); i++) {
+		if (!routes_ipv4[i].is_used) {
+			continue;
+		}
+
+		cb(&routes_ipv4[i], user_data);
+
+		ret++;
+	}
+
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+int net_route_ipv4_packet(struct net_pkt *pkt,
+			  struct net_route_entry_ipv4 *route)
+{
+	if (!net_if_is_up(route->iface)) {
+		return -ENETDOWN;
+	}
+
+	/* Used when detecting if the original link
+	 * layer address length is changed or not.
+	 */
+	net_pkt_set_orig_iface(pkt, net_pkt_iface(pkt));
+	net_pkt_set_iface(pkt, route->iface);
+
+	net_pkt_set_forwarding(pkt, true);
+	net_pkt_set_family(pkt, AF_INET);
+
+	net_pkt_lladdr_src(pkt)->addr = net_if_get_link_addr(route->iface)->addr;
+	net_pkt_lladdr_src(pkt)->type = net_if_get_link_addr(route->iface)->type;
+	net_pkt_lladdr_src(pkt)->len = net_if_get_link_addr(route->iface)->len;
+
+	return net_send_data(pkt);
+}
+
+void net_route_ipv4_init(void)
+{
+	NET_DBG("Allocated %d IPv4 routing entries (%zu bytes)",
+		CONFIG_NET_MAX_ROUTES_IPV4,
+		sizeof(routes_ipv4) + sizeof(route_ipv4_lpm_nodes));
+
+	net_route_lpm_init(&route_ipv4_lpm);
+}
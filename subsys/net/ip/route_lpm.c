@@ -0,0 +1,419 @@
+/** @file
+ * @brief Longest prefix match table for routes
+ *
+ * Path compressed binary trie used by the IPv4 and IPv6 route tables.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_route_lpm, CONFIG_NET_ROUTE_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <errno.h>
+
+#include "route_lpm.h"
+
+static inline int key_bit(const uint8_t *key, uint8_t bit)
+{
+	return (key[bit / 8] >> (7 - (bit % 8))) & 0x01;
+}
+
+/* Number of leading bits that are the same in a and b, max len bits */
+static uint8_t common_bits(const uint8_t *a, const uint8_t *b, uint8_t len)
+{
+	uint8_t bits = 0U;
+	uint8_t diff;
+	int i;
+
+	for (i = 0; bits < len; i++, bits += 8U) {
+		diff = a[i] ^ b[i];
+		if (diff) {
+			while (!(diff & 0x80)) {
+				diff <<= 1;
+				bits++;
+			}
+
+			break;
+		}
+	}
+
+	return MIN(bits, len);
+}
+
+static bool prefix_match(const uint8_t *prefix, const uint8_t *addr,
+			 uint8_t len)
+{
+	uint8_t bytes = len / 8U;
+	uint8_t mask;
+
+	if (memcmp(prefix, addr, bytes)) {
+		return false;
+	}
+
+	if (len % 8U == 0U) {
+		return true;
+	}
+
+	mask = 0xff << (8U - (len % 8U));
+
+	return ((prefix[bytes] ^ addr[bytes]) & mask) == 0U;
+}
+
+static struct net_route_lpm_node *node_alloc(struct net_route_lpm *lpm,
+					     const uint8_t *prefix,
+					     uint8_t prefix_len, void *data)
+{
+	struct net_route_lpm_node *node = lpm->free_list;
+	uint8_t bytes = (prefix_len + 7U) / 8U;
+
+	if (!node) {
+		return NULL;
+	}
+
+	lpm->free_list = node->child[0];
+
+	node->child[0] = NULL;
+	node->child[1] = NULL;
+	node->data = data;
+	node->prefix_len = prefix_len;
+
+	/* Keep the bits after the prefix zero so that the nodes can be
+	 * compared bytewise.
+	 */
+	memset(node->prefix, 0, sizeof(node->prefix));
+	memcpy(node->prefix, prefix, bytes);
+
+	if (prefix_len % 8U) {
+		node->prefix[bytes - 1] &= 0xff << (8U - (prefix_len % 8U));
+	}
+
+	return node;
+}
+
+static void node_free(struct net_route_lpm *lpm,
+		      struct net_route_lpm_node *node)
+{
+	node->data = NULL;
+	node->child[1] = NULL;
+	node->child[0] = lpm->free_list;
+	lpm->free_list = node;
+}
+
+void net_route_lpm_write_begin(struct net_route_lpm *lpm)
+{
+	k_mutex_lock(&lpm->lock, K_FOREVER);
+
+	/* Only the outermost section bumps the counter so that it stays
+	 * odd while the table owner updates an entry and the trie.
+	 */
+	if (lpm->write_depth++ == 0U) {
+		atomic_inc(&lpm->seq);
+	}
+}
+
+void net_route_lpm_write_end(struct net_route_lpm *lpm)
+{
+	if (--lpm->write_depth == 0U) {
+		atomic_inc(&lpm->seq);
+	}
+
+	k_mutex_unlock(&lpm->lock);
+}
+
+void net_route_lpm_init(struct net_route_lpm *lpm)
+{
+	int i;
+
+	k_mutex_init(&lpm->lock);
+	lpm->write_depth = 0U;
+
+	net_route_lpm_write_begin(lpm);
+
+	lpm->root = NULL;
+	lpm->free_list = NULL;
+	lpm->count = 0U;
+
+	for (i = lpm->pool_size - 1; i >= 0; i--) {
+		node_free(lpm, &lpm->pool[i]);
+	}
+
+	net_route_lpm_write_end(lpm);
+}
+
+int net_route_lpm_add(struct net_route_lpm *lpm, const uint8_t *prefix,
+		      uint8_t prefix_len, void *data)
+{
+	struct net_route_lpm_node **slot, *node, *new, *glue;
+	uint8_t common = 0U;
+	int ret = 0;
+
+	if (!data || prefix_len > lpm->max_bits) {
+		return -EINVAL;
+	}
+
+	net_route_lpm_write_begin(lpm);
+
+	slot = &lpm->root;
+
+	while (*slot) {
+		node = *slot;
+
+		common = common_bits(node->prefix, prefix,
+				     MIN(node->prefix_len, prefix_len));
+		if (common < node->prefix_len) {
+			break;
+		}
+
+		if (node->prefix_len == prefix_len) {
+			if (!node->data) {
+				lpm->count++;
+			}
+
+			node->data = data;
+			goto out;
+		}
+
+		slot = &node->child[key_bit(prefix, node->prefix_len)];
+	}
+
+	/* The worst case needs two nodes: the new one and a glue node */
+	new = node_alloc(lpm, prefix, prefix_len, data);
+	if (!new) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	node = *slot;
+
+	if (!node) {
+		*slot = new;
+	} else if (common == prefix_len) {
+		/* The new prefix is a parent of the current node */
+		new->child[key_bit(node->prefix, prefix_len)] = node;
+		*slot = new;
+	} else {
+		glue = node_alloc(lpm, prefix, common, NULL);
+		if (!glue) {
+			node_free(lpm, new);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		glue->child[key_bit(prefix, common)] = new;
+		glue->child[key_bit(node->prefix, common)] = node;
+		*slot = glue;
+	}
+
+	lpm->count++;
+
+out:
+	net_route_lpm_write_end(lpm);
+
+	return ret;
+}
+
+int net_route_lpm_del(struct net_route_lpm *lpm, const uint8_t *prefix,
+		      uint8_t prefix_len)
+{
+	struct net_route_lpm_node **slot, **parent_slot = NULL;
+	struct net_route_lpm_node *node, *parent = NULL, *child;
+	int ret = -ENOENT;
+
+	if (prefix_len > lpm->max_bits) {
+		return -EINVAL;
+	}
+
+	net_route_lpm_write_begin(lpm);
+
+	slot = &lpm->root;
+
+	while ((node = *slot) != NULL) {
+		if (node->prefix_len > prefix_len ||
+		    !prefix_match(node->prefix, prefix, node->prefix_len)) {
+			goto out;
+		}
+
+		if (node->prefix_len == prefix_len) {
+			break;
+		}
+
+		parent_slot = slot;
+		parent = node;
+		slot = &node->child[key_bit(prefix, node->prefix_len)];
+	}
+
+	if (!node || !node->data) {
+		goto out;
+	}
+
+	node->data = NULL;
+	lpm->count--;
+	ret = 0;
+
+	if (node->child[0] && node->child[1]) {
+		/* Still needed for branching */
+		goto out;
+	}
+
+	child = node->child[0] ? node->child[0] : node->child[1];
+	*slot = child;
+	node_free(lpm, node);
+
+	/* A glue node with only one child left is not needed any more */
+	if (!child && parent && !parent->data) {
+		*parent_slot = parent->child[0] ? parent->child[0] :
+			parent->child[1];
+		node_free(lpm, parent);
+	}
+
+out:
+	net_route_lpm_write_end(lpm);
+
+	return ret;
+}
+
+void *net_route_lpm_get(struct net_route_lpm *lpm, const uint8_t *prefix,
+			uint8_t prefix_len)
+{
+	struct net_route_lpm_node *node;
+	void *found = NULL;
+
+	if (prefix_len > lpm->max_bits) {
+		return NULL;
+	}
+
+	k_mutex_lock(&lpm->lock, K_FOREVER);
+
+	node = lpm->root;
+
+	while (node && node->prefix_len <= prefix_len &&
+	       prefix_match(node->prefix, prefix, node->prefix_len)) {
+		if (node->prefix_len == prefix_len) {
+			found = node->data;
+			break;
+		}
+
+		node = node->child[key_bit(prefix, node->prefix_len)];
+	}
+
+	k_mutex_unlock(&lpm->lock);
+
+	return found;
+}
+
+static void *lpm_lookup(struct net_route_lpm *lpm, const uint8_t *addr)
+{
+	struct net_route_lpm_node *node = lpm->root;
+	void *found = NULL;
+	int prev_len = -1;
+
+	/* The prefix length must grow on every step. This also guarantees
+	 * that a lookup racing with an update always terminates.
+	 */
+	while (node && (int)node->prefix_len > prev_len &&
+	       node->prefix_len <= lpm->max_bits) {
+		if (!prefix_match(node->prefix, addr, node->prefix_len)) {
+			break;
+		}
+
+		if (node->data) {
+			found = node->data;
+		}
+
+		if (node->prefix_len == lpm->max_bits) {
+			break;
+		}
+
+		prev_len = node->prefix_len;
+		node = node->child[key_bit(addr, node->prefix_len)];
+	}
+
+	return found;
+}
+
+void *net_route_lpm_lookup(struct net_route_lpm *lpm, const uint8_t *addr)
+{
+	atomic_val_t seq;
+	void *found;
+
+	seq = atomic_get(&lpm->seq);
+	if (!(seq & 1)) {
+		found = lpm_lookup(lpm, addr);
+		if (atomic_get(&lpm->seq) == seq) {
+			return found;
+		}
+	}
+
+	/* An update is in progress. Wait for it instead of spinning, the
+	 * writer might have been preempted by us.
+	 */
+	k_mutex_lock(&lpm->lock, K_FOREVER);
+	found = lpm_lookup(lpm, addr);
+	k_mutex_unlock(&lpm->lock);
+
+	return found;
+}
+
+void *net_route_lpm_lookup_copy(struct net_route_lpm *lpm, const uint8_t *addr,
+				void *copy, size_t len)
+{
+	atomic_val_t seq;
+	void *found;
+
+	seq = atomic_get(&lpm->seq);
+	if (!(seq & 1)) {
+		found = lpm_lookup(lpm, addr);
+		if (found) {
+			memcpy(copy, found, len);
+		}
+
+		if (atomic_get(&lpm->seq) == seq) {
+			return found;
+		}
+	}
+
+	k_mutex_lock(&lpm->lock, K_FOREVER);
+
+	found = lpm_lookup(lpm, addr);
+	if (found) {
+		memcpy(copy, found, len);
+	}
+
+	k_mutex_unlock(&lpm->lock);
+
+	return found;
+}
+
+static void wait_readers(atomic_t *readers)
+{
+	while (atomic_get(readers) > 0) {
+		k_msleep(1);
+	}
+}
+
+void net_route_lpm_synchronize(struct net_route_lpm *lpm)
+{
+	int idx;
+
+	k_mutex_lock(&lpm->lock, K_FOREVER);
+
+	/* A reader that sampled the previous epoch just before the last
+	 * flip might have registered itself after that wait was over.
+	 */
+	idx = atomic_get(&lpm->epoch) & 1;
+	wait_readers(&lpm->readers[idx ^ 1]);
+
+	/* New readers start after the caller unlinked its data, so only
+	 * the ones already in the current epoch can still see it.
+	 */
+	atomic_inc(&lpm->epoch);
+	wait_readers(&lpm->readers[idx]);
+
+	k_mutex_unlock(&lpm->lock);
+}
@@ -0,0 +1,230 @@
+/** @file
+ * @brief Longest prefix match table for routes
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ROUTE_LPM_H
+#define __ROUTE_LPM_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Max key length in bits (IPv6 address) */
+#define NET_ROUTE_LPM_MAX_BITS 128
+
+/**
+ * @brief Node of a path compressed binary (Patricia) trie.
+ *
+ * Nodes with a NULL data pointer are glue nodes that only exist to branch
+ * the trie. The prefix bits after prefix_len are always zero.
+ */
+struct net_route_lpm_node {
+	struct net_route_lpm_node *child[2];
+	void *data;
+	uint8_t prefix[NET_ROUTE_LPM_MAX_BITS / 8];
+	uint8_t prefix_len;
+};
+
+/**
+ * @brief Longest prefix match table.
+ *
+ * Lookups do not take any lock. Writers are serialized by the table mutex
+ * and bump the sequence counter before and after each update, a lookup
+ * that overlaps with an update is retried. The nodes are allocated from
+ * a static pool and never returned to the system, so a reader can never
+ * access freed memory even if it races with a writer.
+ *
+ * The data that the table points to is owned by the caller. It must only
+ * be modified inside a write section, and a reader that keeps using it
+ * after the lookup registers itself in the current epoch so that the
+ * owner can wait for it before reusing the data, see
+ * net_route_lpm_synchronize().
+ */
+struct net_route_lpm {
+	struct net_route_lpm_node *root;
+	struct net_route_lpm_node *free_list;
+	struct net_route_lpm_node *pool;
+	struct k_mutex lock;
+	atomic_t seq;
+	atomic_t epoch;
+	atomic_t readers[2];
+	uint16_t pool_size;
+	uint16_t count;
+	uint8_t max_bits;
+	uint8_t write_depth;
+};
+
+/**
+ * @brief Statically define a longest prefix match table.
+ *
+ * @param _name Name of the table variable.
+ * @param _entries Max number of prefixes stored in the table.
+ * @param _bits Key length in bits, 32 for IPv4 and 128 for IPv6.
+ */
+#define NET_ROUTE_LPM_DEFINE(_name, _entries, _bits)			\
+	static struct net_route_lpm_node _name##_nodes[2 * (_entries)];	\
+	static struct net_route_lpm _name = {				\
+		.pool = _name##_nodes,					\
+		.pool_size = 2 * (_entries),				\
+		.max_bits = (_bits),					\
+	}
+
+/**
+ * @brief Initialize the table, all entries are removed.
+ *
+ * @param lpm Longest prefix match table
+ */
+void net_route_lpm_init(struct net_route_lpm *lpm);
+
+/**
+ * @brief Add a prefix to the table or replace the data of an existing one.
+ *
+ * @param lpm Longest prefix match table
+ * @param prefix Prefix bytes in network byte order
+ * @param prefix_len Prefix length in bits
+ * @param data User data, must not be NULL
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_route_lpm_add(struct net_route_lpm *lpm, const uint8_t *prefix,
+		      uint8_t prefix_len, void *data);
+
+/**
+ * @brief Remove a prefix from the table.
+ *
+ * @param lpm Longest prefix match table
+ * @param prefix Prefix bytes in network byte order
+ * @param prefix_len Prefix length in bits
+ *
+ * @return 0 if ok, -ENOENT if the prefix was not found
+ */
+int net_route_lpm_del(struct net_route_lpm *lpm, const uint8_t *prefix,
+		      uint8_t prefix_len);
+
+/**
+ * @brief Get the data of an exact prefix.
+ *
+ * @param lpm Longest prefix match table
+ * @param prefix Prefix bytes in network byte order
+ * @param prefix_len Prefix length in bits
+ *
+ * @return Data of the prefix, NULL if the prefix is not in the table
+ */
+void *net_route_lpm_get(struct net_route_lpm *lpm, const uint8_t *prefix,
+			uint8_t prefix_len);
+
+/**
+ * @brief Find the data of the longest prefix that matches the address.
+ *
+ * This can be called without holding any lock.
+ *
+ * @param lpm Longest prefix match table
+ * @param addr Address bytes in network byte order, max_bits long
+ *
+ * @return Data of the longest matching prefix, NULL if none matches
+ */
+void *net_route_lpm_lookup(struct net_route_lpm *lpm, const uint8_t *addr);
+
+/**
+ * @brief Find the longest matching prefix and copy its data.
+ *
+ * The copy is consistent with respect to the updates done inside a write
+ * section, so the caller does not need to hold a read section.
+ *
+ * @param lpm Longest prefix match table
+ * @param addr Address bytes in network byte order, max_bits long
+ * @param copy Buffer where the data is copied to
+ * @param len Number of bytes to copy
+ *
+ * @return Data of the longest matching prefix, NULL if none matches
+ */
+void *net_route_lpm_lookup_copy(struct net_route_lpm *lpm, const uint8_t *addr,
+				void *copy, size_t len);
+
+/**
+ * @brief Start a write section.
+ *
+ * The lookups that overlap with the section are retried. The sections
+ * can be nested, the table updates use one internally.
+ *
+ * @param lpm Longest prefix match table
+ */
+void net_route_lpm_write_begin(struct net_route_lpm *lpm);
+
+/**
+ * @brief End a write section.
+ *
+ * @param lpm Longest prefix match table
+ */
+void net_route_lpm_write_end(struct net_route_lpm *lpm);
+
+/**
+ * @brief Start a read section.
+ *
+ * The data found by a lookup inside the section is not reused until the
+ * section ends. The section must not sleep for long as it blocks the
+ * removals.
+ *
+ * @param lpm Longest prefix match table
+ *
+ * @return Epoch that must be given to net_route_lpm_read_end()
+ */
+static inline int net_route_lpm_read_begin(struct net_route_lpm *lpm)
+{
+	int idx = atomic_get(&lpm->epoch) & 1;
+
+	atomic_inc(&lpm->readers[idx]);
+
+	return idx;
+}
+
+/**
+ * @brief End a read section.
+ *
+ * @param lpm Longest prefix match table
+ * @param idx Epoch returned by net_route_lpm_read_begin()
+ */
+static inline void net_route_lpm_read_end(struct net_route_lpm *lpm, int idx)
+{
+	atomic_dec(&lpm->readers[idx]);
+}
+
+/**
+ * @brief Wait until the readers that could have found removed data are
+ * done with it.
+ *
+ * Call this after net_route_lpm_del() and before the data is reused.
+ * Must not be called inside a read section.
+ *
+ * @param lpm Longest prefix match table
+ */
+void net_route_lpm_synchronize(struct net_route_lpm *lpm);
+
+/**
+ * @brief Return number of prefixes in the table.
+ *
+ * @param lpm Longest prefix match table
+ *
+ * @return Number of prefixes
+ */
+static inline int net_route_lpm_count(struct net_route_lpm *lpm)
+{
+	return lpm->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ROUTE_LPM_H */
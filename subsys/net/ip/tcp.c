@@ -26,6 +26,11 @@ LOG_MODULE_REGISTER(net_tcp, CONFIG_NET_TCP_LOG_LEVEL);
 #include "net_private.h"
 #include "tcp_internal.h"
 
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+#include <zephyr/net/socket.h>
+#include "sockets_internal.h"
+#endif
+
 #define ACK_TIMEOUT_MS CONFIG_NET_TCP_ACK_TIMEOUT
 #define ACK_TIMEOUT K_MSEC(ACK_TIMEOUT_MS)
 #define FIN_TIMEOUT K_MSEC(tcp_fin_timeout_ms)
@@ -54,9 +59,42 @@ static K_MUTEX_DEFINE(tcp_lock);
 K_MEM_SLAB_DEFINE_STATIC(tcp_conns_slab, sizeof(struct tcp),
 				CONFIG_NET_MAX_CONTEXTS, 4);
 
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+/* Connections in TIME_WAIT state, in expiry order */
+static sys_slist_t tcp_time_wait_list =
+	SYS_SLIST_STATIC_INIT(&tcp_time_wait_list);
+
+static K_MUTEX_DEFINE(tcp_time_wait_lock);
+
+K_MEM_SLAB_DEFINE_STATIC(tcp_time_wait_slab, sizeof(struct tcp_time_wait),
+			 CONFIG_NET_TCP_TIME_WAIT_COUNT, 4);
+
+static struct k_work_delayable tcp_time_wait_timer;
+#endif
+
 static struct k_work_q tcp_work_q;
 static K_KERNEL_STACK_DEFINE(work_q_stack, CONFIG_NET_TCP_WORKQ_STACK_SIZE);
 
+/* Protects the timer state of all the connections and of the sweep */
+static struct k_spinlock tcp_timer_lock;
+
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+/* The keep-alive and user timeout deadlines of all the connections are
+ * checked by a single work. The connections with a deadline are kept in
+ * tcp_sweep_list, earliest first, so that the work only looks at the due
+ * ones. The deadlines are rounded up to SWEEP_GRANULARITY_MS so that close
+ * ones are handled by the same run.
+ */
+#define SWEEP_GRANULARITY_MS 128U
+#define KEEPALIVE_MAX 32767
+#define KEEPCNT_MAX 127
+
+static struct k_work_delayable tcp_sweep_timer;
+static sys_slist_t tcp_sweep_list; /* Protected by the timer spinlock */
+static uint32_t tcp_sweep_next;
+static bool tcp_sweep_scheduled;
+#endif
+
 static enum net_verdict tcp_in(struct tcp *conn, struct net_pkt *pkt);
 static bool is_destination_local(struct net_pkt *pkt);
 static void tcp_out(struct tcp *conn, uint8_t flags);
@@ -354,6 +392,18 @@ out:
 	tcp_pkt_unref(pkt);
 }
 
+/* Signal that data can be sent again, also to the sockets watched with
+ * epoll as they do not wait on the semaphore.
+ */
+static void tcp_tx_sem_give(struct tcp *conn)
+{
+	k_sem_give(&conn->tx_sem);
+
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+	zsock_epoll_notify(conn->context);
+#endif
+}
+
 static void tcp_derive_rto(struct tcp *conn)
 {
 #ifdef CONFIG_NET_TCP_RANDOMIZED_RTO
@@ -376,11 +426,136 @@ static void tcp_derive_rto(struct tcp *conn)
 #endif
 }
 
+BUILD_ASSERT(TCP_TIMER_COUNT <= 8 * sizeof(((struct tcp *)0)->timer_pending),
+	     "Too many timers for the timer_pending bit mask");
+
+/* Arm the connection work for the earliest pending timer. Called with
+ * tcp_timer_lock held. A timer which is canceled or moved later does not
+ * re-arm the work, the expiry handler does that when the work runs.
+ */
+static void tcp_timer_update(struct tcp *conn, uint32_t now)
+{
+	int32_t delta = INT32_MAX;
+	uint32_t next;
+
+	if (conn->timer_pending == 0U) {
+		if (conn->timer_scheduled) {
+			(void)k_work_cancel_delayable(&conn->timer);
+			conn->timer_scheduled = false;
+		}
+
+		return;
+	}
+
+	for (int i = 0; i < TCP_TIMER_COUNT; i++) {
+		if (conn->timer_pending & BIT(i)) {
+			delta = MIN(delta,
+				    (int32_t)(conn->timer_expiry[i] - now));
+		}
+	}
+
+	delta = MAX(delta, 0);
+	next = now + delta;
+
+	if (conn->timer_scheduled &&
+	    (int32_t)(next - conn->timer_next) >= 0) {
+		return;
+	}
+
+	(void)k_work_reschedule_for_queue(&tcp_work_q, &conn->timer,
+					  K_TICKS(delta));
+	conn->timer_next = next;
+	conn->timer_scheduled = true;
+}
+
+/* Called with tcp_timer_lock held */
+static void tcp_timer_start_locked(struct tcp *conn, enum tcp_timer timer,
+				   k_timeout_t timeout, bool reschedule)
+{
+	uint32_t now = (uint32_t)k_uptime_ticks();
+
+	if (reschedule || !(conn->timer_pending & BIT(timer))) {
+		conn->timer_expiry[timer] = now + (uint32_t)timeout.ticks;
+		conn->timer_pending |= BIT(timer);
+		tcp_timer_update(conn, now);
+	}
+}
+
+static void tcp_timer_start(struct tcp *conn, enum tcp_timer timer,
+			    k_timeout_t timeout, bool reschedule)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tcp_timer_lock);
+	tcp_timer_start_locked(conn, timer, timeout, reschedule);
+	k_spin_unlock(&tcp_timer_lock, key);
+}
+
+/* Start the timer, or restart it if it is already pending */
+static inline void tcp_timer_reschedule(struct tcp *conn,
+					enum tcp_timer timer,
+					k_timeout_t timeout)
+{
+	tcp_timer_start(conn, timer, timeout, true);
+}
+
+/* Start the timer, unless it is already pending */
+static inline void tcp_timer_schedule(struct tcp *conn, enum tcp_timer timer,
+				      k_timeout_t timeout)
+{
+	tcp_timer_start(conn, timer, timeout, false);
+}
+
+static void tcp_timer_cancel(struct tcp *conn, enum tcp_timer timer)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tcp_timer_lock);
+	conn->timer_pending &= ~BIT(timer);
+	tcp_timer_update(conn, (uint32_t)k_uptime_ticks());
+	k_spin_unlock(&tcp_timer_lock, key);
+}
+
+static void tcp_timer_cancel_all(struct tcp *conn)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tcp_timer_lock);
+	conn->timer_pending = 0U;
+	tcp_timer_update(conn, 0U);
+	k_spin_unlock(&tcp_timer_lock, key);
+}
+
+/* The sweep must not see a released connection */
+static void tcp_sweep_disarm(struct tcp *conn)
+{
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tcp_timer_lock);
+
+	if (conn->sweep_armed) {
+		(void)sys_slist_find_and_remove(&tcp_sweep_list,
+						&conn->sweep_node);
+		conn->sweep_armed = false;
+	}
+
+	k_spin_unlock(&tcp_timer_lock, key);
+#else
+	ARG_UNUSED(conn);
+#endif
+}
+
+static bool tcp_timer_is_pending(struct tcp *conn, enum tcp_timer timer)
+{
+	return (conn->timer_pending & BIT(timer)) != 0U;
+}
+
 static void tcp_send_queue_flush(struct tcp *conn)
 {
 	struct net_pkt *pkt;
 
-	k_work_cancel_delayable(&conn->send_timer);
+	tcp_timer_cancel(conn, TCP_TIMER_SEND);
 
 	while ((pkt = tcp_slist(conn, &conn->send_queue, get,
 				struct net_pkt, next))) {
@@ -450,18 +625,14 @@ static int tcp_conn_unref(struct tcp *conn, int status)
 
 	tcp_send_queue_flush(conn);
 
-	k_work_cancel_delayable(&conn->send_data_timer);
+	tcp_sweep_disarm(conn);
+	tcp_timer_cancel_all(conn);
 	tcp_pkt_unref(conn->send_data);
 
 	if (CONFIG_NET_TCP_RECV_QUEUE_TIMEOUT) {
 		tcp_pkt_unref(conn->queue_recv_data);
 	}
 
-	(void)k_work_cancel_delayable(&conn->timewait_timer);
-	(void)k_work_cancel_delayable(&conn->fin_timer);
-	(void)k_work_cancel_delayable(&conn->persist_timer);
-	(void)k_work_cancel_delayable(&conn->ack_timer);
-
 	sys_slist_find_and_remove(&tcp_conns, &conn->next);
 
 	memset(conn, 0, sizeof(*conn));
@@ -533,28 +704,25 @@ static bool tcp_send_process_no_lock(struct tcp *conn)
 		tcp_send(pkt);
 
 		if (forget == false &&
-		    !k_work_delayable_remaining_get(&conn->send_timer)) {
+		    !tcp_timer_is_pending(conn, TCP_TIMER_SEND)) {
 			conn->send_retries = tcp_retries;
 			conn->in_retransmission = true;
 		}
 	}
 
 	if (conn->in_retransmission) {
-		k_work_reschedule_for_queue(&tcp_work_q, &conn->send_timer,
-					    K_MSEC(TCP_RTO_MS));
+		tcp_timer_reschedule(conn, TCP_TIMER_SEND,
+				     K_MSEC(TCP_RTO_MS));
 	} else if (local && !sys_slist_is_empty(&conn->send_queue)) {
-		k_work_reschedule_for_queue(&tcp_work_q, &conn->send_timer,
-					    K_NO_WAIT);
+		tcp_timer_reschedule(conn, TCP_TIMER_SEND, K_NO_WAIT);
 	}
 
 out:
 	return unref;
 }
 
-static void tcp_send_process(struct k_work *work)
+static void tcp_send_process(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, send_timer);
 	bool unref;
 
 	k_mutex_lock(&conn->lock, K_FOREVER);
@@ -574,7 +742,7 @@ static void tcp_send_timer_cancel(struct tcp *conn)
 		return;
 	}
 
-	k_work_cancel_delayable(&conn->send_timer);
+	tcp_timer_cancel(conn, TCP_TIMER_SEND);
 
 	{
 		struct net_pkt *pkt = tcp_slist(conn, &conn->send_queue, get,
@@ -589,8 +757,7 @@ static void tcp_send_timer_cancel(struct tcp *conn)
 		conn->in_retransmission = false;
 	} else {
 		conn->send_retries = tcp_retries;
-		k_work_reschedule_for_queue(&tcp_work_q, &conn->send_timer,
-					    K_MSEC(TCP_RTO_MS));
+		tcp_timer_reschedule(conn, TCP_TIMER_SEND, K_MSEC(TCP_RTO_MS));
 	}
 }
 
@@ -733,6 +900,28 @@ static bool tcp_short_window(struct tcp *conn)
 	return true;
 }
 
+/* When the RX packet pool is about to run out, do not move the right edge
+ * of the offered window further, so that the peer slows down before
+ * packets need to be dropped. The window is never shrunk (RFC 1122,
+ * 4.2.2.16), it only opens by one segment once the peer has filled it.
+ * Data within the real receive window is still accepted.
+ */
+static uint16_t tcp_adv_win(struct tcp *conn)
+{
+	uint16_t win = conn->recv_win;
+
+	if (net_pkt_rx_pool_is_low()) {
+		int32_t offered = net_tcp_seq_cmp(conn->adv_edge, conn->ack);
+
+		offered = MAX(offered, (int32_t)conn_mss(conn));
+		win = MIN(win, offered);
+	}
+
+	conn->adv_edge = conn->ack + win;
+
+	return win;
+}
+
 /**
  * @brief Update TCP receive window
  *
@@ -761,7 +950,7 @@ static int tcp_update_recv_wnd(struct tcp *conn, int32_t delta)
 
 	if (short_win_before && !short_win_after &&
 	    conn->state == TCP_ESTABLISHED) {
-		k_work_cancel_delayable(&conn->ack_timer);
+		tcp_timer_cancel(conn, TCP_TIMER_ACK);
 		tcp_out(conn, ACK);
 	}
 
@@ -789,7 +978,7 @@ static size_t tcp_check_pending_data(struct tcp *conn, struct net_pkt *pkt,
 					 conn->queue_recv_data->buffer);
 			conn->queue_recv_data->buffer = NULL;
 
-			k_work_cancel_delayable(&conn->recv_queue_timer);
+			tcp_timer_cancel(conn, TCP_TIMER_RECV_QUEUE);
 		}
 	}
 
@@ -869,7 +1058,7 @@ static int tcp_header_add(struct tcp *conn, struct net_pkt *pkt, uint8_t flags,
 	}
 
 	UNALIGNED_PUT(flags, &th->th_flags);
-	UNALIGNED_PUT(htons(conn->recv_win), &th->th_win);
+	UNALIGNED_PUT(htons(tcp_adv_win(conn)), &th->th_win);
 	UNALIGNED_PUT(htonl(seq), &th->th_seq);
 
 	if (ACK & flags) {
@@ -1032,8 +1221,7 @@ static int tcp_out_ext(struct tcp *conn, uint8_t flags, struct net_pkt *data,
 		 * thread to finish with any state-machine changes before
 		 * sending the packet, or it might lead to state inconsistencies
 		 */
-		k_work_schedule_for_queue(&tcp_work_q,
-					  &conn->send_timer, K_NO_WAIT);
+		tcp_timer_schedule(conn, TCP_TIMER_SEND, K_NO_WAIT);
 	} else if (tcp_send_process_no_lock(conn)) {
 		tcp_conn_unref(conn, -ETIMEDOUT);
 	}
@@ -1087,6 +1275,14 @@ static bool tcp_window_full(struct tcp *conn)
 	return window_full;
 }
 
+/* Do not queue more data while the TX pool is under pressure, the data
+ * in flight is still sent so the queue drains when it gets acknowledged.
+ */
+static bool tcp_tx_pool_pressure(struct tcp *conn)
+{
+	return conn->unacked_len > 0 && net_pkt_tx_pool_is_low();
+}
+
 static int tcp_unsent_len(struct tcp *conn)
 {
 	int unsent_len;
@@ -1110,6 +1306,21 @@ static int tcp_unsent_len(struct tcp *conn)
 	return unsent_len;
 }
 
+/* Largest amount of data sent in one segment */
+static int tcp_seg_max(struct tcp *conn)
+{
+#if defined(CONFIG_NET_LOOPBACK_TCP_NO_SEGMENTATION)
+	/* The data never leaves the device, only the IP length field limits
+	 * the segment size.
+	 */
+	if (conn->iface && net_if_flag_is_set(conn->iface, NET_IF_LOOPBACK)) {
+		return UINT16_MAX - NET_IPV6TCPH_LEN;
+	}
+#endif
+
+	return conn_mss(conn);
+}
+
 static int tcp_send_data(struct tcp *conn)
 {
 	int ret = 0;
@@ -1118,7 +1329,7 @@ static int tcp_send_data(struct tcp *conn)
 
 	len = MIN3(conn->send_data_total - conn->unacked_len,
 		   conn->send_win - conn->unacked_len,
-		   conn_mss(conn));
+		   tcp_seg_max(conn));
 	if (len == 0) {
 		NET_DBG("conn: %p no data to send", conn);
 		ret = -ENODATA;
@@ -1199,24 +1410,21 @@ static int tcp_send_queued_data(struct tcp *conn)
 		subscribe = true;
 	}
 
-	if (k_work_delayable_remaining_get(&conn->send_data_timer)) {
+	if (tcp_timer_is_pending(conn, TCP_TIMER_SEND_DATA)) {
 		subscribe = false;
 	}
 
 	if (subscribe) {
 		conn->send_data_retries = 0;
-		k_work_reschedule_for_queue(&tcp_work_q, &conn->send_data_timer,
-					    K_MSEC(TCP_RTO_MS));
+		tcp_timer_reschedule(conn, TCP_TIMER_SEND_DATA,
+				     K_MSEC(TCP_RTO_MS));
 	}
  out:
 	return ret;
 }
 
-static void tcp_cleanup_recv_queue(struct k_work *work)
+static void tcp_cleanup_recv_queue(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, recv_queue_timer);
-
 	k_mutex_lock(&conn->lock, K_FOREVER);
 
 	NET_DBG("Cleanup recv queue conn %p len %zd seq %u", conn,
@@ -1229,10 +1437,8 @@ static void tcp_cleanup_recv_queue(struct k_work *work)
 	k_mutex_unlock(&conn->lock);
 }
 
-static void tcp_resend_data(struct k_work *work)
+static void tcp_resend_data(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, send_data_timer);
 	bool conn_unref = false;
 	int ret;
 	int exp_tcp_rto;
@@ -1257,9 +1463,7 @@ static void tcp_resend_data(struct k_work *work)
 			NET_DBG("TCP connection in active close, "
 				"not disposing yet (waiting %dms)",
 				tcp_fin_timeout_ms);
-			k_work_reschedule_for_queue(&tcp_work_q,
-						    &conn->fin_timer,
-						    FIN_TIMEOUT);
+			tcp_timer_reschedule(conn, TCP_TIMER_FIN, FIN_TIMEOUT);
 
 			conn_state(conn, TCP_FIN_WAIT_1);
 
@@ -1288,8 +1492,7 @@ static void tcp_resend_data(struct k_work *work)
 		}
 	}
 
-	k_work_reschedule_for_queue(&tcp_work_q, &conn->send_data_timer,
-				    K_MSEC(exp_tcp_rto));
+	tcp_timer_reschedule(conn, TCP_TIMER_SEND_DATA, K_MSEC(exp_tcp_rto));
 
  out:
 	k_mutex_unlock(&conn->lock);
@@ -1299,11 +1502,8 @@ static void tcp_resend_data(struct k_work *work)
 	}
 }
 
-static void tcp_timewait_timeout(struct k_work *work)
+static void tcp_timewait_timeout(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, timewait_timer);
-
 	NET_DBG("conn: %p %s", conn, tcp_conn_state(conn, NULL));
 
 	/* Extra unref from net_tcp_put() */
@@ -1318,11 +1518,8 @@ static void tcp_establish_timeout(struct tcp *conn)
 	(void)tcp_conn_unref(conn, -ETIMEDOUT);
 }
 
-static void tcp_fin_timeout(struct k_work *work)
+static void tcp_fin_timeout(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, fin_timer);
-
 	if (conn->state == TCP_SYN_RECEIVED) {
 		tcp_establish_timeout(conn);
 		return;
@@ -1335,11 +1532,8 @@ static void tcp_fin_timeout(struct k_work *work)
 	net_context_unref(conn->context);
 }
 
-static void tcp_send_zwp(struct k_work *work)
+static void tcp_send_zwp(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, persist_timer);
-
 	k_mutex_lock(&conn->lock, K_FOREVER);
 
 	(void)tcp_out_ext(conn, ACK, NULL, conn->seq - 1);
@@ -1359,18 +1553,14 @@ static void tcp_send_zwp(struct k_work *work)
 			timeout = ZWP_MAX_DELAY_MS;
 		}
 
-		(void)k_work_reschedule_for_queue(
-			&tcp_work_q, &conn->persist_timer, K_MSEC(timeout));
+		tcp_timer_reschedule(conn, TCP_TIMER_PERSIST, K_MSEC(timeout));
 	}
 
 	k_mutex_unlock(&conn->lock);
 }
 
-static void tcp_send_ack(struct k_work *work)
+static void tcp_send_ack(struct tcp *conn)
 {
-	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
-	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, ack_timer);
-
 	k_mutex_lock(&conn->lock, K_FOREVER);
 
 	tcp_out(conn, ACK);
@@ -1378,6 +1568,397 @@ static void tcp_send_ack(struct k_work *work)
 	k_mutex_unlock(&conn->lock);
 }
 
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+/* Called with tcp_timer_lock held */
+static void tcp_sweep_schedule(uint32_t deadline)
+{
+	int32_t delay;
+
+	deadline = (deadline + SWEEP_GRANULARITY_MS - 1U) &
+		   ~(SWEEP_GRANULARITY_MS - 1U);
+
+	if (tcp_sweep_scheduled &&
+	    (int32_t)(deadline - tcp_sweep_next) >= 0) {
+		return;
+	}
+
+	delay = MAX((int32_t)(deadline - k_uptime_get_32()), 0);
+
+	(void)k_work_reschedule_for_queue(&tcp_work_q, &tcp_sweep_timer,
+					  K_MSEC(delay));
+	tcp_sweep_next = deadline;
+	tcp_sweep_scheduled = true;
+}
+
+/* Called with tcp_timer_lock held */
+static void tcp_sweep_insert(struct tcp *conn)
+{
+	struct tcp *prev = NULL;
+	struct tcp *iter;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&tcp_sweep_list, iter, sweep_node) {
+		if ((int32_t)(conn->sweep_deadline -
+			      iter->sweep_deadline) < 0) {
+			break;
+		}
+
+		prev = iter;
+	}
+
+	sys_slist_insert(&tcp_sweep_list, prev ? &prev->sweep_node : NULL,
+			 &conn->sweep_node);
+}
+
+/* Make the sweep look at the connection at the deadline, unless it is
+ * already going to do so earlier.
+ */
+static void tcp_sweep_arm(struct tcp *conn, uint32_t deadline)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tcp_timer_lock);
+
+	if (!conn->sweep_armed ||
+	    (int32_t)(deadline - conn->sweep_deadline) < 0) {
+		if (conn->sweep_armed) {
+			(void)sys_slist_find_and_remove(&tcp_sweep_list,
+							&conn->sweep_node);
+		}
+
+		conn->sweep_deadline = deadline;
+		conn->sweep_armed = true;
+		tcp_sweep_insert(conn);
+	}
+
+	tcp_sweep_schedule(deadline);
+
+	k_spin_unlock(&tcp_timer_lock, key);
+}
+
+/* Next time the connection needs to be looked at, called with conn->lock
+ * held. Returns false if there is nothing to watch.
+ */
+static bool tcp_keepalive_deadline(struct tcp *conn, uint32_t now,
+				   uint32_t *deadline)
+{
+	bool found = false;
+
+	if (conn->keep_alive && (conn->state == TCP_ESTABLISHED ||
+				 conn->state == TCP_CLOSE_WAIT)) {
+		if (conn->keep_probes == 0U) {
+			*deadline = conn->last_recv +
+				    conn->keep_idle * MSEC_PER_SEC;
+		} else {
+			*deadline = now + conn->keep_intvl * MSEC_PER_SEC;
+		}
+
+		found = true;
+	}
+
+	if (conn->user_timeout > 0U && conn->send_data_total > 0U) {
+		uint32_t expiry = conn->ack_progress + conn->user_timeout;
+
+		if (!found || (int32_t)(expiry - *deadline) < 0) {
+			*deadline = expiry;
+		}
+
+		found = true;
+	}
+
+	return found;
+}
+
+static void tcp_keepalive_watch(struct tcp *conn)
+{
+	uint32_t deadline;
+
+	/* Reading the flag without the lock at worst leads to an extra
+	 * sweep run.
+	 */
+	if (conn->sweep_armed) {
+		return;
+	}
+
+	if (tcp_keepalive_deadline(conn, k_uptime_get_32(), &deadline)) {
+		tcp_sweep_arm(conn, deadline);
+	}
+}
+
+static void tcp_keepalive_recv(struct tcp *conn)
+{
+	conn->last_recv = k_uptime_get_32();
+	conn->keep_probes = 0U;
+}
+
+static void tcp_keepalive_ack(struct tcp *conn)
+{
+	conn->ack_progress = k_uptime_get_32();
+}
+
+/* The user timeout, when set, replaces the probe count to decide when an
+ * unanswered peer is given up (like on other systems).
+ */
+static bool tcp_keepalive_exhausted(struct tcp *conn, uint32_t probing)
+{
+	if (conn->user_timeout > 0U) {
+		return conn->keep_probes > 0U && probing >= conn->user_timeout;
+	}
+
+	return conn->keep_probes >= conn->keep_cnt;
+}
+
+static void tcp_keepalive_timeout(struct tcp *conn)
+{
+	uint32_t now = k_uptime_get_32();
+	bool timeout = false;
+	uint32_t deadline;
+
+	k_mutex_lock(&conn->lock, K_FOREVER);
+
+	if (conn->user_timeout > 0U && conn->send_data_total > 0U &&
+	    now - conn->ack_progress >= conn->user_timeout) {
+		NET_DBG("conn: %p data not acknowledged in %ums", conn,
+			conn->user_timeout);
+		timeout = true;
+		goto out;
+	}
+
+	if (conn->keep_alive && (conn->state == TCP_ESTABLISHED ||
+				 conn->state == TCP_CLOSE_WAIT)) {
+		uint32_t idle = now - conn->last_recv;
+		uint32_t keep_idle = conn->keep_idle * MSEC_PER_SEC;
+
+		if (idle < keep_idle) {
+			conn->keep_probes = 0U;
+		} else if (tcp_keepalive_exhausted(conn, idle - keep_idle)) {
+			NET_DBG("conn: %p no answer to %u keep-alive probes",
+				conn, conn->keep_probes);
+			timeout = true;
+			goto out;
+		} else {
+			/* Segment with an already acknowledged sequence
+			 * number, so that the peer answers with an ACK
+			 * (RFC 1122, 4.2.3.6).
+			 */
+			(void)tcp_out_ext(conn, ACK, NULL, conn->seq - 1);
+			net_stats_update_tcp_seg_keepalive(conn->iface);
+
+			conn->keep_probes++;
+		}
+	}
+
+	if (tcp_keepalive_deadline(conn, now, &deadline)) {
+		tcp_sweep_arm(conn, deadline);
+	}
+
+out:
+	if (timeout) {
+		net_stats_update_tcp_conntimeout(conn->iface);
+		tcp_out(conn, RST);
+	}
+
+	k_mutex_unlock(&conn->lock);
+
+	if (timeout) {
+		tcp_conn_unref(conn, -ETIMEDOUT);
+	}
+}
+
+/* Only the due connections are taken from the head of the list, a
+ * connection is removed from it before being released.
+ */
+static void tcp_sweep(struct k_work *work)
+{
+	uint32_t now = k_uptime_get_32();
+	k_spinlock_key_t key;
+	struct tcp *conn;
+
+	ARG_UNUSED(work);
+
+	key = k_spin_lock(&tcp_timer_lock);
+
+	tcp_sweep_scheduled = false;
+
+	while ((conn = SYS_SLIST_PEEK_HEAD_CONTAINER(&tcp_sweep_list, conn,
+						     sweep_node)) != NULL) {
+		if ((int32_t)(conn->sweep_deadline - now) > 0) {
+			tcp_sweep_schedule(conn->sweep_deadline);
+			break;
+		}
+
+		(void)sys_slist_get(&tcp_sweep_list);
+		conn->sweep_armed = false;
+
+		/* The connection does the work in its own context */
+		tcp_timer_start_locked(conn, TCP_TIMER_KEEPALIVE, K_NO_WAIT,
+				       true);
+	}
+
+	k_spin_unlock(&tcp_timer_lock, key);
+}
+
+static int set_tcp_keepalive(struct tcp *conn, enum tcp_conn_option option,
+			     const void *value, size_t len)
+{
+	uint32_t deadline;
+	int val;
+
+	if (len != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	val = *(int *)value;
+
+	switch (option) {
+	case TCP_OPT_KEEPALIVE:
+		conn->keep_alive = (val != 0);
+		break;
+	case TCP_OPT_KEEPIDLE:
+		if (val < 1 || val > KEEPALIVE_MAX) {
+			return -EINVAL;
+		}
+
+		conn->keep_idle = val;
+		break;
+	case TCP_OPT_KEEPINTVL:
+		if (val < 1 || val > KEEPALIVE_MAX) {
+			return -EINVAL;
+		}
+
+		conn->keep_intvl = val;
+		break;
+	case TCP_OPT_KEEPCNT:
+		if (val < 1 || val > KEEPCNT_MAX) {
+			return -EINVAL;
+		}
+
+		conn->keep_cnt = val;
+		break;
+	case TCP_OPT_USER_TIMEOUT:
+		if (val < 0) {
+			return -EINVAL;
+		}
+
+		conn->user_timeout = val;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* A shorter time must be taken into account now, a longer one is
+	 * when the sweep looks at the connection.
+	 */
+	if (tcp_keepalive_deadline(conn, k_uptime_get_32(), &deadline)) {
+		tcp_sweep_arm(conn, deadline);
+	}
+
+	return 0;
+}
+
+static int get_tcp_keepalive(struct tcp *conn, enum tcp_conn_option option,
+			     void *value, size_t *len)
+{
+	int val;
+
+	switch (option) {
+	case TCP_OPT_KEEPALIVE:
+		val = (int)conn->keep_alive;
+		break;
+	case TCP_OPT_KEEPIDLE:
+		val = conn->keep_idle;
+		break;
+	case TCP_OPT_KEEPINTVL:
+		val = conn->keep_intvl;
+		break;
+	case TCP_OPT_KEEPCNT:
+		val = conn->keep_cnt;
+		break;
+	case TCP_OPT_USER_TIMEOUT:
+		val = conn->user_timeout;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	*((int *)value) = val;
+
+	if (len) {
+		*len = sizeof(int);
+	}
+
+	return 0;
+}
+#else
+static inline void tcp_keepalive_watch(struct tcp *conn)
+{
+	ARG_UNUSED(conn);
+}
+
+static inline void tcp_keepalive_recv(struct tcp *conn)
+{
+	ARG_UNUSED(conn);
+}
+
+static inline void tcp_keepalive_ack(struct tcp *conn)
+{
+	ARG_UNUSED(conn);
+}
+#endif /* CONFIG_NET_TCP_KEEPALIVE */
+
+typedef void (*tcp_timer_handler_t)(struct tcp *conn);
+
+static const tcp_timer_handler_t tcp_timer_handlers[TCP_TIMER_COUNT] = {
+	[TCP_TIMER_SEND] = tcp_send_process,
+	[TCP_TIMER_SEND_DATA] = tcp_resend_data,
+	[TCP_TIMER_RECV_QUEUE] = tcp_cleanup_recv_queue,
+	[TCP_TIMER_ACK] = tcp_send_ack,
+	[TCP_TIMER_PERSIST] = tcp_send_zwp,
+	[TCP_TIMER_FIN] = tcp_fin_timeout,
+	[TCP_TIMER_TIMEWAIT] = tcp_timewait_timeout,
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+	[TCP_TIMER_KEEPALIVE] = tcp_keepalive_timeout,
+#endif
+};
+
+/* Run the handler of the earliest expired timer of the connection. If
+ * more timers are expired, the work is resubmitted right away so that
+ * each handler runs on its own, as they can release the connection.
+ */
+static void tcp_timer_expired(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct tcp *conn = CONTAINER_OF(dwork, struct tcp, timer);
+	uint32_t now = (uint32_t)k_uptime_ticks();
+	int32_t earliest = 1;
+	int expired = -1;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&tcp_timer_lock);
+
+	conn->timer_scheduled = false;
+
+	for (int i = 0; i < TCP_TIMER_COUNT; i++) {
+		int32_t delta = (int32_t)(conn->timer_expiry[i] - now);
+
+		if ((conn->timer_pending & BIT(i)) && delta < earliest) {
+			earliest = delta;
+			expired = i;
+		}
+	}
+
+	if (expired >= 0) {
+		conn->timer_pending &= ~BIT(expired);
+	}
+
+	tcp_timer_update(conn, now);
+
+	k_spin_unlock(&tcp_timer_lock, key);
+
+	if (expired >= 0) {
+		tcp_timer_handlers[expired](conn);
+	}
+}
+
 static void tcp_conn_ref(struct tcp *conn)
 {
 	int ref_count = atomic_inc(&conn->ref_count) + 1;
@@ -1425,6 +2006,13 @@ static struct tcp *tcp_conn_alloc(struct net_context *context)
 	conn->recv_win_max = tcp_window;
 	conn->tcp_nodelay = false;
 
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+	conn->keep_idle = CONFIG_NET_TCP_KEEPIDLE_DEFAULT;
+	conn->keep_intvl = CONFIG_NET_TCP_KEEPINTVL_DEFAULT;
+	conn->keep_cnt = CONFIG_NET_TCP_KEEPCNT_DEFAULT;
+	conn->last_recv = k_uptime_get_32();
+#endif
+
 	/* Set the recv_win with the rcvbuf configured for the socket. */
 	if (IS_ENABLED(CONFIG_NET_CONTEXT_RCVBUF) &&
 		net_context_get_option(context, NET_OPT_RCVBUF, &recv_window, &len) == 0) {
@@ -1442,13 +2030,7 @@ static struct tcp *tcp_conn_alloc(struct net_context *context)
 
 	sys_slist_init(&conn->send_queue);
 
-	k_work_init_delayable(&conn->send_timer, tcp_send_process);
-	k_work_init_delayable(&conn->timewait_timer, tcp_timewait_timeout);
-	k_work_init_delayable(&conn->fin_timer, tcp_fin_timeout);
-	k_work_init_delayable(&conn->send_data_timer, tcp_resend_data);
-	k_work_init_delayable(&conn->recv_queue_timer, tcp_cleanup_recv_queue);
-	k_work_init_delayable(&conn->persist_timer, tcp_send_zwp);
-	k_work_init_delayable(&conn->ack_timer, tcp_send_ack);
+	k_work_init_delayable(&conn->timer, tcp_timer_expired);
 
 	tcp_conn_ref(conn);
 
@@ -1524,6 +2106,208 @@ static struct tcp *tcp_conn_search(struct net_pkt *pkt)
 	return found ? conn : NULL;
 }
 
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+static void tcp_time_wait_expired(struct k_work *work)
+{
+	uint32_t now = (uint32_t)k_uptime_ticks();
+	struct tcp_time_wait *tw;
+
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&tcp_time_wait_lock, K_FOREVER);
+
+	while ((tw = SYS_SLIST_PEEK_HEAD_CONTAINER(&tcp_time_wait_list, tw,
+						   next)) != NULL) {
+		int32_t remaining = (int32_t)(tw->expiry - now);
+
+		if (remaining > 0) {
+			k_work_reschedule_for_queue(&tcp_work_q,
+						    &tcp_time_wait_timer,
+						    K_TICKS(remaining));
+			break;
+		}
+
+		NET_DBG("TIME_WAIT %p expired", tw);
+
+		(void)sys_slist_get(&tcp_time_wait_list);
+		k_mem_slab_free(&tcp_time_wait_slab, (void **)&tw);
+	}
+
+	k_mutex_unlock(&tcp_time_wait_lock);
+}
+
+/* Append the entry to the list with a fresh expiry, called with
+ * tcp_time_wait_lock held.
+ */
+static void tcp_time_wait_queue(struct tcp_time_wait *tw)
+{
+	if (sys_slist_is_empty(&tcp_time_wait_list)) {
+		k_work_reschedule_for_queue(
+			&tcp_work_q, &tcp_time_wait_timer,
+			K_MSEC(CONFIG_NET_TCP_TIME_WAIT_DELAY));
+	}
+
+	tw->expiry = (uint32_t)k_uptime_ticks() +
+		     k_ms_to_ticks_ceil32(CONFIG_NET_TCP_TIME_WAIT_DELAY);
+
+	sys_slist_append(&tcp_time_wait_list, &tw->next);
+}
+
+/* Keep what is needed to handle the TIME_WAIT state of the connection,
+ * so that the connection can be released right away.
+ */
+static bool tcp_time_wait_add(struct tcp *conn)
+{
+	struct tcp_time_wait *tw;
+
+	if (k_mem_slab_alloc(&tcp_time_wait_slab, (void **)&tw,
+			     K_NO_WAIT) < 0) {
+		NET_DBG("conn: %p no free TIME_WAIT entry", conn);
+		return false;
+	}
+
+	tw->iface = conn->iface;
+	tw->src = conn->src;
+	tw->dst = conn->dst;
+	tw->seq = conn->seq;
+	tw->ack = conn->ack;
+	tw->win = tcp_adv_win(conn);
+
+	k_mutex_lock(&tcp_time_wait_lock, K_FOREVER);
+	tcp_time_wait_queue(tw);
+	k_mutex_unlock(&tcp_time_wait_lock);
+
+	NET_DBG("conn: %p TIME_WAIT %p", conn, tw);
+
+	return true;
+}
+
+static void tcp_time_wait_ack(const struct tcp_time_wait *tw)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(tcp_access, struct tcphdr);
+	sa_family_t family = tw->src.sa.sa_family;
+	struct net_pkt *pkt;
+	struct tcphdr *th;
+	int ret = -EINVAL;
+
+	pkt = net_pkt_alloc_with_buffer(tw->iface, sizeof(struct tcphdr),
+					family, IPPROTO_TCP,
+					TCP_PKT_ALLOC_TIMEOUT);
+	if (!pkt) {
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && family == AF_INET) {
+		ret = net_ipv4_create(pkt, &tw->src.sin.sin_addr,
+				      &tw->dst.sin.sin_addr);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) && family == AF_INET6) {
+		ret = net_ipv6_create(pkt, &tw->src.sin6.sin6_addr,
+				      &tw->dst.sin6.sin6_addr);
+	}
+
+	if (ret < 0) {
+		goto fail;
+	}
+
+	th = (struct tcphdr *)net_pkt_get_data(pkt, &tcp_access);
+	if (!th) {
+		goto fail;
+	}
+
+	memset(th, 0, sizeof(struct tcphdr));
+
+	UNALIGNED_PUT(tw->src.sin.sin_port, &th->th_sport);
+	UNALIGNED_PUT(tw->dst.sin.sin_port, &th->th_dport);
+	th->th_off = 5;
+	UNALIGNED_PUT(ACK, &th->th_flags);
+	UNALIGNED_PUT(htons(tw->win), &th->th_win);
+	UNALIGNED_PUT(htonl(tw->seq), &th->th_seq);
+	UNALIGNED_PUT(htonl(tw->ack), &th->th_ack);
+
+	if (net_pkt_set_data(pkt, &tcp_access) < 0 ||
+	    tcp_finalize_pkt(pkt) < 0) {
+		goto fail;
+	}
+
+	tcp_send(pkt);
+
+	return;
+fail:
+	tcp_pkt_unref(pkt);
+}
+
+bool net_tcp_time_wait_input(struct net_pkt *pkt)
+{
+	struct tcp_time_wait *tw;
+	sys_snode_t *prev = NULL;
+	union tcp_endpoint src, dst;
+	struct tcp_time_wait ack;
+	bool found = false;
+	bool send_ack = false;
+	struct tcphdr *th;
+	size_t len;
+
+	if (sys_slist_is_empty(&tcp_time_wait_list)) {
+		return false;
+	}
+
+	th = th_get(pkt);
+	if (!th || tcp_endpoint_set(&src, pkt, TCP_EP_DST) < 0 ||
+	    tcp_endpoint_set(&dst, pkt, TCP_EP_SRC) < 0) {
+		return false;
+	}
+
+	len = tcp_endpoint_len(src.sa.sa_family);
+
+	k_mutex_lock(&tcp_time_wait_lock, K_FOREVER);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&tcp_time_wait_list, tw, next) {
+		if (!memcmp(&tw->src, &src, len) &&
+		    !memcmp(&tw->dst, &dst, len)) {
+			found = true;
+			break;
+		}
+
+		prev = &tw->next;
+	}
+
+	if (!found) {
+		goto out;
+	}
+
+	if ((th_flags(th) & (SYN | ACK)) == SYN &&
+	    net_tcp_seq_cmp(th_seq(th), tw->ack) > 0) {
+		/* A new connection can reuse the addresses and ports if its
+		 * sequence numbers do not overlap the old ones (RFC 1122,
+		 * 4.2.2.13).
+		 */
+		sys_slist_remove(&tcp_time_wait_list, prev, &tw->next);
+		k_mem_slab_free(&tcp_time_wait_slab, (void **)&tw);
+		found = false;
+		goto out;
+	}
+
+	if ((th_flags(th) & FIN) && th_seq(th) + 1 == tw->ack) {
+		/* Acknowledge the retransmitted FIN and restart the
+		 * TIME_WAIT timeout. RST segments are ignored (RFC 1337).
+		 */
+		sys_slist_remove(&tcp_time_wait_list, prev, &tw->next);
+		tcp_time_wait_queue(tw);
+
+		ack = *tw;
+		send_ack = true;
+	}
+out:
+	k_mutex_unlock(&tcp_time_wait_lock);
+
+	if (send_ack) {
+		tcp_time_wait_ack(&ack);
+	}
+
+	return found;
+}
+#endif /* CONFIG_NET_TCP_TIME_WAIT_COMPACT */
+
 static struct tcp *tcp_conn_new(struct net_pkt *pkt);
 
 static enum net_verdict tcp_recv(struct net_conn *net_conn,
@@ -1544,6 +2328,11 @@ static enum net_verdict tcp_recv(struct net_conn *net_conn,
 		goto in;
 	}
 
+	/* The connection of the segment might be in compact TIME_WAIT */
+	if (net_tcp_time_wait_input(pkt)) {
+		return NET_DROP;
+	}
+
 	th = th_get(pkt);
 
 	if (th_flags(th) & SYN && !(th_flags(th) & ACK)) {
@@ -1557,6 +2346,17 @@ static enum net_verdict tcp_recv(struct net_conn *net_conn,
 
 		net_ipaddr_copy(&conn_old->context->remote, &conn->dst.sa);
 
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+		/* The accepted connection inherits the options of the
+		 * listening one.
+		 */
+		conn->keep_alive = conn_old->keep_alive;
+		conn->keep_idle = conn_old->keep_idle;
+		conn->keep_intvl = conn_old->keep_intvl;
+		conn->keep_cnt = conn_old->keep_cnt;
+		conn->user_timeout = conn_old->user_timeout;
+#endif
+
 		conn->accepted_conn = conn_old;
 	}
  in:
@@ -1855,11 +2655,8 @@ static void tcp_queue_recv_data(struct tcp *conn, struct net_pkt *pkt,
 		/* We need to keep the received data but free the pkt */
 		pkt->buffer = NULL;
 
-		if (!k_work_delayable_is_pending(&conn->recv_queue_timer)) {
-			k_work_reschedule_for_queue(
-				&tcp_work_q, &conn->recv_queue_timer,
-				K_MSEC(CONFIG_NET_TCP_RECV_QUEUE_TIMEOUT));
-		}
+		tcp_timer_schedule(conn, TCP_TIMER_RECV_QUEUE,
+				   K_MSEC(CONFIG_NET_TCP_RECV_QUEUE_TIMEOUT));
 	}
 }
 
@@ -1881,10 +2678,9 @@ static enum net_verdict tcp_data_received(struct tcp *conn, struct net_pkt *pkt,
 	 * as described in RFC 813.
 	 */
 	if (tcp_short_window(conn)) {
-		k_work_schedule_for_queue(&tcp_work_q, &conn->ack_timer,
-					  ACK_DELAY);
+		tcp_timer_schedule(conn, TCP_TIMER_ACK, ACK_DELAY);
 	} else {
-		k_work_cancel_delayable(&conn->ack_timer);
+		tcp_timer_cancel(conn, TCP_TIMER_ACK);
 		tcp_out(conn, ACK);
 	}
 
@@ -1918,6 +2714,7 @@ static enum net_verdict tcp_in(struct tcp *conn, struct net_pkt *pkt)
 	struct tcphdr *th = pkt ? th_get(pkt) : NULL;
 	uint8_t next = 0, fl = 0;
 	bool do_close = false;
+	bool time_wait_release = false;
 	bool connection_ok = false;
 	size_t tcp_options_len = th ? (th_off(th) - 5) * 4 : 0;
 	struct net_conn *conn_handler = NULL;
@@ -1945,6 +2742,10 @@ static enum net_verdict tcp_in(struct tcp *conn, struct net_pkt *pkt)
 
 	NET_DBG("%s", tcp_conn_state(conn, pkt));
 
+	if (th) {
+		tcp_keepalive_recv(conn);
+	}
+
 	if (th && th_off(th) < 5) {
 		tcp_out(conn, RST);
 		conn_state(conn, TCP_CLOSED);
@@ -2021,20 +2822,19 @@ static enum net_verdict tcp_in(struct tcp *conn, struct net_pkt *pkt)
 		}
 
 		if (conn->send_win == 0) {
-			if (!k_work_delayable_is_pending(&conn->persist_timer)) {
+			if (!tcp_timer_is_pending(conn, TCP_TIMER_PERSIST)) {
 				conn->zwp_retries = 0;
-				(void)k_work_reschedule_for_queue(
-					&tcp_work_q, &conn->persist_timer,
-					K_MSEC(TCP_RTO_MS));
+				tcp_timer_reschedule(conn, TCP_TIMER_PERSIST,
+						     K_MSEC(TCP_RTO_MS));
 			}
 		} else {
-			(void)k_work_cancel_delayable(&conn->persist_timer);
+			tcp_timer_cancel(conn, TCP_TIMER_PERSIST);
 		}
 
 		if (tcp_window_full(conn)) {
 			(void)k_sem_take(&conn->tx_sem, K_NO_WAIT);
 		} else {
-			k_sem_give(&conn->tx_sem);
+			tcp_tx_sem_give(conn);
 		}
 	}
 
@@ -2054,9 +2854,7 @@ next_state:
 
 			/* Close the connection if we do not receive ACK on time.
 			 */
-			k_work_reschedule_for_queue(&tcp_work_q,
-						    &conn->establish_timer,
-						    ACK_TIMEOUT);
+			tcp_timer_reschedule(conn, TCP_TIMER_FIN, ACK_TIMEOUT);
 		} else {
 			conn->send_options.mss_found = true;
 			tcp_out(conn, SYN);
@@ -2068,7 +2866,7 @@ next_state:
 	case TCP_SYN_RECEIVED:
 		if (FL(&fl, &, ACK, th_ack(th) == conn->seq &&
 				th_seq(th) == conn->ack)) {
-			k_work_cancel_delayable(&conn->establish_timer);
+			tcp_timer_cancel(conn, TCP_TIMER_FIN);
 			tcp_send_timer_cancel(conn);
 			next = TCP_ESTABLISHED;
 			net_context_set_state(conn->context,
@@ -2180,22 +2978,22 @@ next_state:
 			}
 
 			if (!tcp_window_full(conn)) {
-				k_sem_give(&conn->tx_sem);
+				tcp_tx_sem_give(conn);
 			}
 
 			conn_seq(conn, + len_acked);
 			net_stats_update_tcp_seg_recv(conn->iface);
+			tcp_keepalive_ack(conn);
 
 			conn_send_data_dump(conn);
 
-			if (!k_work_delayable_remaining_get(
-				    &conn->send_data_timer)) {
+			if (!tcp_timer_is_pending(conn, TCP_TIMER_SEND_DATA)) {
 				NET_DBG("conn: %p, Missing a subscription "
 					"of the send_data queue timer", conn);
 				break;
 			}
 			conn->send_data_retries = 0;
-			k_work_cancel_delayable(&conn->send_data_timer);
+			tcp_timer_cancel(conn, TCP_TIMER_SEND_DATA);
 			if (conn->data_mode == TCP_DATA_MODE_RESEND) {
 				conn->unacked_len = 0;
 				tcp_derive_rto(conn);
@@ -2277,7 +3075,7 @@ next_state:
 			   FL(&fl, ==, FIN | PSH | ACK,
 			      th_seq(th) == conn->ack))) {
 			/* Received FIN on FIN_WAIT_2, so cancel the timer */
-			k_work_cancel_delayable(&conn->fin_timer);
+			tcp_timer_cancel(conn, TCP_TIMER_FIN);
 
 			conn_ack(conn, + 1);
 			tcp_out(conn, ACK);
@@ -2299,9 +3097,19 @@ next_state:
 			tcp_out(conn, ACK);
 		}
 
-		k_work_reschedule_for_queue(
-			&tcp_work_q, &conn->timewait_timer,
-			K_MSEC(CONFIG_NET_TCP_TIME_WAIT_DELAY));
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+		if (!th && tcp_time_wait_add(conn)) {
+			/* The TIME_WAIT entry takes over, the connection can
+			 * be released.
+			 */
+			tcp_timer_cancel_all(conn);
+			time_wait_release = true;
+			break;
+		}
+#endif
+
+		tcp_timer_reschedule(conn, TCP_TIMER_TIMEWAIT,
+				     K_MSEC(CONFIG_NET_TCP_TIME_WAIT_DELAY));
 		break;
 	default:
 		NET_ASSERT(false, "%s is unimplemented",
@@ -2331,6 +3139,8 @@ next_state:
 	recv_user_data = conn->recv_user_data;
 	recv_data_fifo = &conn->recv_data;
 
+	tcp_keepalive_watch(conn);
+
 	k_mutex_unlock(&conn->lock);
 
 	/* Pass all the received data stored in recv fifo to the application.
@@ -2354,6 +3164,9 @@ next_state:
 	 */
 	if (do_close) {
 		tcp_conn_unref(conn, close_status);
+	} else if (time_wait_release) {
+		/* Extra unref from net_tcp_put() */
+		net_context_unref(conn->context);
 	}
 
 	return verdict;
@@ -2384,17 +3197,14 @@ int net_tcp_put(struct net_context *context)
 
 			/* How long to wait until all the data has been sent?
 			 */
-			k_work_reschedule_for_queue(&tcp_work_q,
-						    &conn->send_data_timer,
-						    K_MSEC(TCP_RTO_MS));
+			tcp_timer_reschedule(conn, TCP_TIMER_SEND_DATA,
+					     K_MSEC(TCP_RTO_MS));
 		} else {
 			int ret;
 
 			NET_DBG("TCP connection in active close, not "
 				"disposing yet (waiting %dms)", tcp_fin_timeout_ms);
-			k_work_reschedule_for_queue(&tcp_work_q,
-						    &conn->fin_timer,
-						    FIN_TIMEOUT);
+			tcp_timer_reschedule(conn, TCP_TIMER_FIN, FIN_TIMEOUT);
 
 			ret = tcp_out_ext(conn, FIN | ACK, NULL,
 					  conn->seq + conn->unacked_len);
@@ -2469,31 +3279,14 @@ int net_tcp_queue_data(struct net_context *context, struct net_pkt *pkt)
 		}
 
 		/* Trigger resend if the timer is not active */
-		/* TODO: use k_work_delayable for send_data_timer so we don't
-		 * have to directly access the internals of the legacy object.
-		 *
-		 * NOTE: It is not permitted to access any fields of k_work or
-		 * k_work_delayable directly.  This replacement does so, but
-		 * only as a temporary workaround until the legacy
-		 * k_delayed_work structure is replaced with k_work_delayable;
-		 * at that point k_work_schedule() can be invoked to cause the
-		 * work to be scheduled if it is not already scheduled.
-		 *
-		 * This solution diverges from the original, which would
-		 * invoke the retransmit function directly here.  Because that
-		 * function is given a k_work pointer, again this cannot be
-		 * done without accessing the internal data of the
-		 * k_work_delayable structure.
-		 *
-		 * The original inline retransmission could be supported by
-		 * refactoring the work_handler to delegate to a function that
-		 * takes conn directly, rather than the work item in which
-		 * conn is embedded, and calling that function directly here
-		 * and in the work handler.
-		 */
-		(void)k_work_schedule_for_queue(&tcp_work_q,
-						&conn->send_data_timer,
-						K_NO_WAIT);
+		tcp_timer_schedule(conn, TCP_TIMER_SEND_DATA, K_NO_WAIT);
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	if (tcp_tx_pool_pressure(conn)) {
+		/* The sender is woken up when data in flight gets acked */
+		(void)k_sem_take(&conn->tx_sem, K_NO_WAIT);
 		ret = -EAGAIN;
 		goto out;
 	}
@@ -2504,6 +3297,10 @@ int net_tcp_queue_data(struct net_context *context, struct net_pkt *pkt)
 		orig_buf = net_buf_frag_last(conn->send_data->buffer);
 	}
 
+	if (conn->send_data_total == 0) {
+		tcp_keepalive_ack(conn);
+	}
+
 	net_pkt_append_buffer(conn->send_data, pkt->buffer);
 	conn->send_data_total += len;
 	NET_DBG("conn: %p Queued %zu bytes (total %zu)", conn, len,
@@ -2552,10 +3349,10 @@ int net_tcp_queue_data(struct net_context *context, struct net_pkt *pkt)
 		 */
 		if (conn->send_data_total == 0) {
 			NET_DBG("No bufs, cancelling retransmit timer");
-			k_work_cancel_delayable(&conn->send_data_timer);
+			tcp_timer_cancel(conn, TCP_TIMER_SEND_DATA);
 		}
 	} else {
-		if (tcp_window_full(conn)) {
+		if (tcp_window_full(conn) || tcp_tx_pool_pressure(conn)) {
 			(void)k_sem_take(&conn->tx_sem, K_NO_WAIT);
 		}
 
@@ -2564,6 +3361,8 @@ int net_tcp_queue_data(struct net_context *context, struct net_pkt *pkt)
 		 */
 		tcp_pkt_unref(pkt);
 	}
+
+	tcp_keepalive_watch(conn);
 out:
 	k_mutex_unlock(&conn->lock);
 
@@ -2833,6 +3632,7 @@ struct net_tcp_hdr *net_tcp_input(struct net_pkt *pkt,
 
 	if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
 	    net_if_need_calc_rx_checksum(net_pkt_iface(pkt)) &&
+	    !net_pkt_is_chksum_done(pkt) &&
 	    net_calc_chksum_tcp(pkt) != 0U) {
 		NET_DBG("DROP: checksum mismatch");
 		goto drop;
@@ -3119,6 +3919,22 @@ void net_tcp_foreach(net_tcp_cb_t cb, void *user_data)
 	k_mutex_unlock(&tcp_lock);
 }
 
+void net_tcp_footprint_get(struct net_tcp_footprint *footprint)
+{
+	memset(footprint, 0, sizeof(*footprint));
+
+	footprint->conn_size = sizeof(struct tcp);
+	footprint->context_size = sizeof(struct net_context);
+	footprint->handler_size = sizeof(struct net_conn);
+	footprint->conn_count = k_mem_slab_num_used_get(&tcp_conns_slab);
+
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+	footprint->time_wait_size = sizeof(struct tcp_time_wait);
+	footprint->time_wait_count =
+		k_mem_slab_num_used_get(&tcp_time_wait_slab);
+#endif
+}
+
 uint16_t net_tcp_get_supported_mss(const struct tcp *conn)
 {
 	sa_family_t family = net_context_get_family(conn->context);
@@ -3178,6 +3994,18 @@ int net_tcp_set_option(struct net_context *context,
 	case TCP_OPT_NODELAY:
 		ret = set_tcp_nodelay(conn, value, len);
 		break;
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+	case TCP_OPT_KEEPALIVE:
+	case TCP_OPT_KEEPIDLE:
+	case TCP_OPT_KEEPINTVL:
+	case TCP_OPT_KEEPCNT:
+	case TCP_OPT_USER_TIMEOUT:
+		ret = set_tcp_keepalive(conn, option, value, len);
+		break;
+#endif
+	default:
+		ret = -EINVAL;
+		break;
 	}
 
 	k_mutex_unlock(&conn->lock);
@@ -3203,6 +4031,18 @@ int net_tcp_get_option(struct net_context *context,
 	case TCP_OPT_NODELAY:
 		ret = get_tcp_nodelay(conn, value, len);
 		break;
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+	case TCP_OPT_KEEPALIVE:
+	case TCP_OPT_KEEPIDLE:
+	case TCP_OPT_KEEPINTVL:
+	case TCP_OPT_KEEPCNT:
+	case TCP_OPT_USER_TIMEOUT:
+		ret = get_tcp_keepalive(conn, option, value, len);
+		break;
+#endif
+	default:
+		ret = -EINVAL;
+		break;
 	}
 
 	k_mutex_unlock(&conn->lock);
@@ -3248,6 +4088,14 @@ void net_tcp_init(void)
 			   K_KERNEL_STACK_SIZEOF(work_q_stack), THREAD_PRIORITY,
 			   NULL);
 
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+	k_work_init_delayable(&tcp_time_wait_timer, tcp_time_wait_expired);
+#endif
+
+#if defined(CONFIG_NET_TCP_KEEPALIVE)
+	k_work_init_delayable(&tcp_sweep_timer, tcp_sweep);
+#endif
+
 	/* Compute the largest possible retransmission timeout */
 	tcp_fin_timeout_ms = 0;
 	rto = tcp_rto;
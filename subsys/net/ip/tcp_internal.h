@@ -32,6 +32,11 @@ extern "C" {
 
 enum tcp_conn_option {
 	TCP_OPT_NODELAY	= 1,
+	TCP_OPT_KEEPALIVE = 2,
+	TCP_OPT_KEEPIDLE = 3,
+	TCP_OPT_KEEPINTVL = 4,
+	TCP_OPT_KEEPCNT = 5,
+	TCP_OPT_USER_TIMEOUT = 6,
 };
 
 /**
@@ -432,6 +437,61 @@ static inline int net_tcp_get_option(struct net_context *context,
  */
 struct k_sem *net_tcp_tx_sem_get(struct net_context *context);
 
+/**
+ * @brief Handle a segment of a connection in TIME_WAIT state
+ *
+ * With CONFIG_NET_TCP_TIME_WAIT_COMPACT, a connection and its context are
+ * released when entering TIME_WAIT state, only its addresses and sequence
+ * numbers are kept until the state times out.
+ *
+ * @param pkt Network packet
+ *
+ * @return true if the segment belongs to a connection in TIME_WAIT state,
+ *         the caller should then drop it.
+ */
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+bool net_tcp_time_wait_input(struct net_pkt *pkt);
+#else
+static inline bool net_tcp_time_wait_input(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return false;
+}
+#endif
+
+/** Memory used by the TCP connections */
+struct net_tcp_footprint {
+	/** Size of a TCP connection */
+	size_t conn_size;
+	/** Size of the network context of a connection */
+	size_t context_size;
+	/** Size of the connection handler of a connection */
+	size_t handler_size;
+	/** Size of a compact TIME_WAIT entry, 0 if they are not used */
+	size_t time_wait_size;
+	/** Number of TCP connections */
+	int conn_count;
+	/** Number of compact TIME_WAIT entries */
+	int time_wait_count;
+};
+
+/**
+ * @brief Get the memory used by the TCP connections
+ *
+ * An idle connection takes conn_size + context_size + handler_size bytes.
+ *
+ * @param footprint Filled with the sizes and counts
+ */
+#if defined(CONFIG_NET_NATIVE_TCP)
+void net_tcp_footprint_get(struct net_tcp_footprint *footprint);
+#else
+static inline void net_tcp_footprint_get(struct net_tcp_footprint *footprint)
+{
+	memset(footprint, 0, sizeof(*footprint));
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
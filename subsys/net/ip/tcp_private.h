@@ -134,9 +134,7 @@
 			(uint16_t)conn_mss((_conn)));                          \
 		NET_DBG("conn: %p send_data_timer=%hu, send_data_retries=%hu", \
 			(_conn),                                               \
-			(bool)k_ticks_to_ms_ceil32(                            \
-				k_work_delayable_remaining_get(                \
-					&(_conn)->send_data_timer)),           \
+			tcp_timer_is_pending((_conn), TCP_TIMER_SEND_DATA),    \
 			(_conn)->send_data_retries);                           \
 	})
 
@@ -223,6 +221,24 @@ struct tcp_options {
 	bool wnd_found : 1;
 };
 
+/* Timeouts of a connection, all of them are multiplexed on the single
+ * delayable work of the connection.
+ */
+enum tcp_timer {
+	TCP_TIMER_SEND,		/* Retransmission of the send queue */
+	TCP_TIMER_SEND_DATA,	/* Retransmission of data */
+	TCP_TIMER_RECV_QUEUE,	/* Drop of the out of order data */
+	TCP_TIMER_ACK,		/* Delayed ACK */
+	TCP_TIMER_PERSIST,	/* Zero window probe */
+	/* Because FIN and establish timeouts are never happening at the
+	 * same time, they share the same timer.
+	 */
+	TCP_TIMER_FIN,
+	TCP_TIMER_TIMEWAIT,
+	TCP_TIMER_KEEPALIVE,	/* Keep-alive or user timeout deadline */
+	TCP_TIMER_COUNT
+};
+
 struct tcp { /* TCP connection */
 	sys_snode_t next;
 	struct net_context *context;
@@ -241,21 +257,12 @@ struct tcp { /* TCP connection */
 	struct k_fifo recv_data;  /* temp queue before passing data to app */
 	struct tcp_options recv_options;
 	struct tcp_options send_options;
-	struct k_work_delayable send_timer;
-	struct k_work_delayable recv_queue_timer;
-	struct k_work_delayable send_data_timer;
-	struct k_work_delayable timewait_timer;
-	struct k_work_delayable persist_timer;
-	struct k_work_delayable ack_timer;
-
-	union {
-		/* Because FIN and establish timers are never happening
-		 * at the same time, share the timer between them to
-		 * save memory.
-		 */
-		struct k_work_delayable fin_timer;
-		struct k_work_delayable establish_timer;
-	};
+	struct k_work_delayable timer;
+	/* Expiry of the pending timers, in the low 32 bits of the uptime
+	 * ticks. Protected by the timer spinlock as is timer_pending.
+	 */
+	uint32_t timer_expiry[TCP_TIMER_COUNT];
+	uint32_t timer_next;
 	union tcp_endpoint src;
 	union tcp_endpoint dst;
 	size_t send_data_total;
@@ -266,20 +273,52 @@ struct tcp { /* TCP connection */
 	enum tcp_data_mode data_mode;
 	uint32_t seq;
 	uint32_t ack;
+	uint32_t adv_edge; /* Right edge of the last offered window */
 	uint16_t recv_win_max;
 	uint16_t recv_win;
 	uint16_t send_win;
 #ifdef CONFIG_NET_TCP_RANDOMIZED_RTO
 	uint16_t rto;
+#endif
+#ifdef CONFIG_NET_TCP_KEEPALIVE
+	/* Times below are in the low 32 bits of the uptime in milliseconds */
+	uint32_t last_recv; /* Last segment received */
+	uint32_t ack_progress; /* Last progress of the acknowledged data */
+	sys_snode_t sweep_node; /* In the sweep list when sweep_armed */
+	uint32_t sweep_deadline; /* Protected by the timer spinlock */
+	uint32_t user_timeout; /* In milliseconds, 0 if not used */
+	uint16_t keep_idle; /* In seconds */
+	uint16_t keep_intvl; /* In seconds */
+	uint8_t keep_cnt;
+	uint8_t keep_probes; /* Unanswered keep-alive probes */
+	bool keep_alive;
+	bool sweep_armed; /* Protected by the timer spinlock */
 #endif
 	uint8_t send_data_retries;
 	uint8_t zwp_retries;
+	uint8_t timer_pending; /* Bit mask of enum tcp_timer */
+	bool timer_scheduled;
 	bool in_retransmission : 1;
 	bool in_connect : 1;
 	bool in_close : 1;
 	bool tcp_nodelay : 1;
 };
 
+/* What is kept of a connection in TIME_WAIT state when
+ * CONFIG_NET_TCP_TIME_WAIT_COMPACT is set, the connection and its context
+ * are released as soon as they enter that state.
+ */
+struct tcp_time_wait {
+	sys_snode_t next;
+	struct net_if *iface;
+	union tcp_endpoint src;
+	union tcp_endpoint dst;
+	uint32_t seq;
+	uint32_t ack;
+	uint32_t expiry; /* Low 32 bits of the uptime ticks */
+	uint16_t win;
+};
+
 #define _flags(_fl, _op, _mask, _cond)					\
 ({									\
 	bool result = false;						\
@@ -19,6 +19,7 @@ LOG_MODULE_REGISTER(net_arp, CONFIG_NET_ARP_LOG_LEVEL);
 
 #include "arp.h"
 #include "net_private.h"
+#include "net_stats.h"
 
 #define NET_BUF_TIMEOUT K_MSEC(100)
 #define ARP_REQUEST_TIMEOUT (2 * MSEC_PER_SEC)
@@ -30,6 +31,16 @@ static sys_slist_t arp_free_entries;
 static sys_slist_t arp_pending_entries;
 static sys_slist_t arp_table;
 
+/* The entries in arp_table are also linked to a hash bucket by IPv4
+ * address. The hash is read without locking in the TX path; the writers
+ * hold arp_mutex and bump arp_hash_seq before and after each change so a
+ * reader can tell if it raced with one.
+ */
+static sys_slist_t arp_hash[CONFIG_NET_ARP_HASH_SIZE];
+static atomic_t arp_hash_seq;
+
+static K_MUTEX_DEFINE(arp_mutex);
+
 struct k_work_delayable arp_request_timer;
 
 static void arp_entry_cleanup(struct arp_entry *entry, bool pending)
@@ -50,6 +61,84 @@ static void arp_entry_cleanup(struct arp_entry *entry, bool pending)
 	(void)memset(&entry->eth, 0, sizeof(struct net_eth_addr));
 }
 
+static inline uint32_t arp_hash_index(const struct in_addr *addr)
+{
+	return ((UNALIGNED_GET(&addr->s_addr) * 0x9e3779b1U) >> 16) %
+		CONFIG_NET_ARP_HASH_SIZE;
+}
+
+static struct arp_entry *arp_hash_find(struct net_if *iface,
+				       struct in_addr *dst)
+{
+	struct arp_entry *entry;
+	int count = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&arp_hash[arp_hash_index(dst)],
+				     entry, hash_node) {
+		if (entry->iface == iface &&
+		    net_ipv4_addr_cmp(&entry->ip, dst)) {
+			return entry;
+		}
+
+		/* A reader racing with an update can end up in the wrong
+		 * bucket, make sure it still stops.
+		 */
+		if (++count >= CONFIG_NET_ARP_TABLE_SIZE) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* Lookup that can be done without holding arp_mutex. NULL is returned
+ * also if the table was modified during the lookup, so the caller needs
+ * to check again with the mutex held before assuming a cache miss.
+ */
+static struct arp_entry *arp_entry_lookup(struct net_if *iface,
+					  struct in_addr *dst)
+{
+	struct arp_entry *entry;
+	atomic_val_t seq;
+
+	seq = atomic_get(&arp_hash_seq);
+	if (seq & 1) {
+		return NULL;
+	}
+
+	entry = arp_hash_find(iface, dst);
+
+	if (atomic_get(&arp_hash_seq) != seq) {
+		return NULL;
+	}
+
+	return entry;
+}
+
+static void arp_table_add(struct arp_entry *entry)
+{
+	entry->last_used = k_uptime_get_32();
+
+	atomic_inc(&arp_hash_seq);
+
+	sys_slist_prepend(&arp_table, &entry->node);
+	sys_slist_prepend(&arp_hash[arp_hash_index(&entry->ip)],
+			  &entry->hash_node);
+
+	atomic_inc(&arp_hash_seq);
+}
+
+static void arp_table_remove(struct arp_entry *entry, sys_snode_t *prev)
+{
+	atomic_inc(&arp_hash_seq);
+
+	sys_slist_remove(&arp_table, prev, &entry->node);
+	sys_slist_find_and_remove(&arp_hash[arp_hash_index(&entry->ip)],
+				  &entry->hash_node);
+
+	atomic_inc(&arp_hash_seq);
+}
+
 static struct arp_entry *arp_entry_find(sys_slist_t *list,
 					struct net_if *iface,
 					struct in_addr *dst,
@@ -74,30 +163,6 @@ static struct arp_entry *arp_entry_find(sys_slist_t *list,
 	return NULL;
 }
 
-static inline struct arp_entry *arp_entry_find_move_first(struct net_if *iface,
-							  struct in_addr *dst)
-{
-	sys_snode_t *prev = NULL;
-	struct arp_entry *entry;
-
-	NET_DBG("dst %s", net_sprint_ipv4_addr(dst));
-
-	entry = arp_entry_find(&arp_table, iface, dst, &prev);
-	if (entry) {
-		/* Let's assume the target is going to be accessed
-		 * more than once here in a short time frame. So we
-		 * place the entry first in position into the table
-		 * in order to reduce subsequent find.
-		 */
-		if (&entry->node != sys_slist_peek_head(&arp_table)) {
-			sys_slist_remove(&arp_table, prev, &entry->node);
-			sys_slist_prepend(&arp_table, &entry->node);
-		}
-	}
-
-	return entry;
-}
-
 static inline
 struct arp_entry *arp_entry_find_pending(struct net_if *iface,
 					 struct in_addr *dst)
@@ -145,20 +210,35 @@ static struct arp_entry *arp_entry_get_free(void)
 
 static struct arp_entry *arp_entry_get_last_from_table(void)
 {
-	sys_snode_t *node;
+	struct arp_entry *entry, *oldest = NULL;
+	sys_snode_t *prev = NULL, *oldest_prev = NULL;
+	uint32_t now = k_uptime_get_32();
 
-	/* We assume last entry is the oldest one,
-	 * so is the preferred one to be taken out.
+	/* Take out the least recently used entry. This is only done when
+	 * the table is full, so the lookups do not need to keep the table
+	 * in LRU order.
 	 */
+	SYS_SLIST_FOR_EACH_CONTAINER(&arp_table, entry, node) {
+		if (!oldest ||
+		    now - entry->last_used > now - oldest->last_used) {
+			oldest = entry;
+			oldest_prev = prev;
+		}
 
-	node = sys_slist_peek_tail(&arp_table);
-	if (!node) {
+		prev = &entry->node;
+	}
+
+	if (!oldest) {
 		return NULL;
 	}
 
-	sys_slist_find_and_remove(&arp_table, node);
+	NET_DBG("Evicting %s", net_sprint_ipv4_addr(&oldest->ip));
 
-	return CONTAINER_OF(node, struct arp_entry, node);
+	net_stats_update_arp_evicted(oldest->iface);
+
+	arp_table_remove(oldest, oldest_prev);
+
+	return oldest;
 }
 
 
@@ -184,6 +264,8 @@ static void arp_request_timeout(struct k_work *work)
 
 	ARG_UNUSED(work);
 
+	k_mutex_lock(&arp_mutex, K_FOREVER);
+
 	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&arp_pending_entries,
 					  entry, next, node) {
 		if ((int32_t)(entry->req_start +
@@ -204,6 +286,8 @@ static void arp_request_timeout(struct k_work *work)
 				  K_MSEC(entry->req_start +
 					 ARP_REQUEST_TIMEOUT - current));
 	}
+
+	k_mutex_unlock(&arp_mutex);
 }
 
 static inline struct in_addr *if_get_addr(struct net_if *iface,
@@ -230,35 +314,46 @@ static inline struct in_addr *if_get_addr(struct net_if *iface,
 	return NULL;
 }
 
-static inline struct net_pkt *arp_prepare(struct net_if *iface,
-					  struct in_addr *next_addr,
-					  struct arp_entry *entry,
-					  struct net_pkt *pending,
-					  struct in_addr *current_ip)
+/* The request is allocated before arp_mutex is taken, as the allocation
+ * can block.
+ */
+static struct net_pkt *arp_request_alloc(struct net_if *iface,
+					 struct net_pkt *pending,
+					 struct in_addr *current_ip)
 {
-	struct net_arp_hdr *hdr;
-	struct in_addr *my_addr;
 	struct net_pkt *pkt;
 
 	if (current_ip) {
 		/* This is the IPv4 autoconf case where we have already
 		 * things setup so no need to allocate new net_pkt
 		 */
-		pkt = pending;
-	} else {
-		pkt = net_pkt_alloc_with_buffer(iface,
-						sizeof(struct net_arp_hdr),
-						AF_UNSPEC, 0, NET_BUF_TIMEOUT);
-		if (!pkt) {
-			return NULL;
-		}
+		return pending;
+	}
 
-		/* Avoid recursive loop with network packet capturing */
-		if (IS_ENABLED(CONFIG_NET_CAPTURE) && pending) {
-			net_pkt_set_captured(pkt, net_pkt_is_captured(pending));
-		}
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(struct net_arp_hdr),
+					AF_UNSPEC, 0, NET_BUF_TIMEOUT);
+	if (!pkt) {
+		return NULL;
+	}
+
+	/* Avoid recursive loop with network packet capturing */
+	if (IS_ENABLED(CONFIG_NET_CAPTURE) && pending) {
+		net_pkt_set_captured(pkt, net_pkt_is_captured(pending));
 	}
 
+	return pkt;
+}
+
+static inline struct net_pkt *arp_prepare(struct net_pkt *pkt,
+					  struct net_if *iface,
+					  struct in_addr *next_addr,
+					  struct arp_entry *entry,
+					  struct net_pkt *pending,
+					  struct in_addr *current_ip)
+{
+	struct net_arp_hdr *hdr;
+	struct in_addr *my_addr;
+
 	net_pkt_set_vlan_tag(pkt, net_eth_get_vlan_tag(iface));
 
 	net_buf_add(pkt->buffer, sizeof(struct net_arp_hdr));
@@ -356,10 +451,33 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 	/* If the destination address is already known, we do not need
 	 * to send any ARP packet.
 	 */
-	entry = arp_entry_find_move_first(net_pkt_iface(pkt), addr);
+	entry = arp_entry_lookup(net_pkt_iface(pkt), addr);
 	if (!entry) {
 		struct net_pkt *req;
 
+		req = arp_request_alloc(net_pkt_iface(pkt), pkt, current_ip);
+		if (!req) {
+			return NULL;
+		}
+
+		k_mutex_lock(&arp_mutex, K_FOREVER);
+
+		/* The entry might have been added or we might have raced
+		 * with an update, check again with the table locked.
+		 */
+		entry = arp_hash_find(net_pkt_iface(pkt), addr);
+		if (entry) {
+			k_mutex_unlock(&arp_mutex);
+
+			if (req != pkt) {
+				net_pkt_unref(req);
+			}
+
+			goto found;
+		}
+
+		net_stats_update_arp_miss(net_pkt_iface(pkt));
+
 		entry = arp_entry_find_pending(net_pkt_iface(pkt), addr);
 		if (!entry) {
 			/* No pending, let's try to get a new entry */
@@ -373,7 +491,7 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 			entry = NULL;
 		}
 
-		req = arp_prepare(net_pkt_iface(pkt), addr, entry, pkt,
+		req = arp_prepare(req, net_pkt_iface(pkt), addr, entry, pkt,
 				  current_ip);
 
 		if (!entry) {
@@ -384,9 +502,19 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 			NET_DBG("Resending ARP %p", req);
 		}
 
+		k_mutex_unlock(&arp_mutex);
+
 		return req;
 	}
 
+found:
+	/* This is racy, but the worst that can happen is that a wrong
+	 * entry is taken out when the table is full.
+	 */
+	entry->last_used = k_uptime_get_32();
+
+	net_stats_update_arp_hit(net_pkt_iface(pkt));
+
 	net_pkt_lladdr_src(pkt)->addr =
 		(uint8_t *)net_if_get_link_addr(entry->iface)->addr;
 	net_pkt_lladdr_src(pkt)->len = sizeof(struct net_eth_addr);
@@ -406,10 +534,9 @@ static void arp_gratuitous(struct net_if *iface,
 			   struct in_addr *src,
 			   struct net_eth_addr *hwaddr)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry;
 
-	entry = arp_entry_find(&arp_table, iface, src, &prev);
+	entry = arp_hash_find(iface, src);
 	if (entry) {
 		NET_DBG("Gratuitous ARP hwaddr %s -> %s",
 			net_sprint_ll_addr((const uint8_t *)&entry->eth,
@@ -432,6 +559,8 @@ static void arp_update(struct net_if *iface,
 
 	NET_DBG("src %s", net_sprint_ipv4_addr(src));
 
+	k_mutex_lock(&arp_mutex, K_FOREVER);
+
 	entry = arp_entry_get_pending(iface, src);
 	if (!entry) {
 		if (IS_ENABLED(CONFIG_NET_ARP_GRATUITOUS) && gratuitous) {
@@ -439,10 +568,9 @@ static void arp_update(struct net_if *iface,
 		}
 
 		if (force) {
-			sys_snode_t *prev = NULL;
 			struct arp_entry *entry;
 
-			entry = arp_entry_find(&arp_table, iface, src, &prev);
+			entry = arp_hash_find(iface, src);
 			if (entry) {
 				memcpy(&entry->eth, hwaddr,
 				       sizeof(struct net_eth_addr));
@@ -461,11 +589,13 @@ static void arp_update(struct net_if *iface,
 					entry->iface = iface;
 					net_ipaddr_copy(&entry->ip, src);
 					memcpy(&entry->eth, hwaddr, sizeof(entry->eth));
-					sys_slist_prepend(&arp_table, &entry->node);
+					arp_table_add(entry);
 				}
 			}
 		}
 
+		k_mutex_unlock(&arp_mutex);
+
 		return;
 	}
 
@@ -484,7 +614,9 @@ static void arp_update(struct net_if *iface,
 	memcpy(&entry->eth, hwaddr, sizeof(struct net_eth_addr));
 
 	/* Inserting entry into the table */
-	sys_slist_prepend(&arp_table, &entry->node);
+	arp_table_add(entry);
+
+	k_mutex_unlock(&arp_mutex);
 
 	net_if_queue_tx(iface, pkt);
 }
@@ -676,15 +808,17 @@ void net_arp_clear_cache(struct net_if *iface)
 
 	NET_DBG("Flushing ARP table");
 
+	k_mutex_lock(&arp_mutex, K_FOREVER);
+
 	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&arp_table, entry, next, node) {
 		if (iface && iface != entry->iface) {
 			prev = &entry->node;
 			continue;
 		}
 
+		arp_table_remove(entry, prev);
 		arp_entry_cleanup(entry, false);
 
-		sys_slist_remove(&arp_table, prev, &entry->node);
 		sys_slist_prepend(&arp_free_entries, &entry->node);
 	}
 
@@ -708,6 +842,8 @@ void net_arp_clear_cache(struct net_if *iface)
 	if (sys_slist_is_empty(&arp_pending_entries)) {
 		k_work_cancel_delayable(&arp_request_timer);
 	}
+
+	k_mutex_unlock(&arp_mutex);
 }
 
 int net_arp_foreach(net_arp_cb_t cb, void *user_data)
@@ -715,11 +851,15 @@ int net_arp_foreach(net_arp_cb_t cb, void *user_data)
 	int ret = 0;
 	struct arp_entry *entry;
 
+	k_mutex_lock(&arp_mutex, K_FOREVER);
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&arp_table, entry, node) {
 		ret++;
 		cb(entry, user_data);
 	}
 
+	k_mutex_unlock(&arp_mutex);
+
 	return ret;
 }
 
@@ -735,6 +875,10 @@ void net_arp_init(void)
 	sys_slist_init(&arp_pending_entries);
 	sys_slist_init(&arp_table);
 
+	for (i = 0; i < CONFIG_NET_ARP_HASH_SIZE; i++) {
+		sys_slist_init(&arp_hash[i]);
+	}
+
 	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
 		/* Inserting entry as free */
 		sys_slist_prepend(&arp_free_entries, &arp_entries[i].node);
@@ -28,6 +28,7 @@ LOG_MODULE_REGISTER(net_ethernet, CONFIG_NET_L2_ETHERNET_LOG_LEVEL);
 #include "ipv6.h"
 #include "ipv4_autoconf_internal.h"
 #include "bridge.h"
+#include "route.h"
 
 #define NET_BUF_TIMEOUT K_MSEC(100)
 
@@ -383,9 +384,22 @@ static struct net_pkt *ethernet_ll_prepare_on_ipv4(struct net_if *iface,
 	}
 
 	if (IS_ENABLED(CONFIG_NET_ARP)) {
+		struct in_addr *dst = (struct in_addr *)NET_IPV4_HDR(pkt)->dst;
+		struct net_route_entry_ipv4 route;
 		struct net_pkt *arp_pkt;
 
-		arp_pkt = net_arp_prepare(pkt, (struct in_addr *)NET_IPV4_HDR(pkt)->dst, NULL);
+		/* Resolve the next hop router of the route instead of the
+		 * default gateway of the interface. The route is copied as
+		 * it can change while the packet is being sent.
+		 */
+		if (IS_ENABLED(CONFIG_NET_ROUTE_IPV4) &&
+		    net_route_ipv4_lookup_copy(dst, &route) &&
+		    route.iface == iface &&
+		    !net_ipv4_is_addr_unspecified(&route.nexthop)) {
+			dst = &route.nexthop;
+		}
+
+		arp_pkt = net_arp_prepare(pkt, dst, NULL);
 		if (!arp_pkt) {
 			return NULL;
 		}
@@ -309,6 +309,20 @@ static int ethernet_get_config(uint32_t mgmt_request,
 
 		params->ports_num = config.ports_num;
 
+	} else if (mgmt_request == NET_REQUEST_ETHERNET_GET_HW_QUEUES_NUM) {
+		if (!is_hw_caps_supported(dev, ETHERNET_HW_FLOW_HASH)) {
+			return -ENOTSUP;
+		}
+
+		type = ETHERNET_CONFIG_TYPE_HW_QUEUES_NUM;
+
+		ret = api->get_config(dev, type, &config);
+		if (ret) {
+			return ret;
+		}
+
+		params->hw_queues_num = config.hw_queues_num;
+
 	} else if (mgmt_request == NET_REQUEST_ETHERNET_GET_QBV_PARAM) {
 		if (!is_hw_caps_supported(dev, ETHERNET_QBV)) {
 			return -ENOTSUP;
@@ -444,6 +458,9 @@ NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_ETHERNET_GET_QBU_PARAM,
 NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_ETHERNET_GET_TXTIME_PARAM,
 				  ethernet_get_config);
 
+NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_ETHERNET_GET_HW_QUEUES_NUM,
+				  ethernet_get_config);
+
 void ethernet_mgmt_raise_carrier_on_event(struct net_if *iface)
 {
 	net_mgmt_event_notify(NET_EVENT_ETHERNET_CARRIER_ON, iface);
@@ -36,11 +36,17 @@ LOG_MODULE_REGISTER(net_ieee802154, CONFIG_NET_L2_IEEE802154_LOG_LEVEL);
 #include "ieee802154_security.h"
 #include "ieee802154_utils.h"
 
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+#include "ieee802154_tx_queue.h"
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
+
 #include <zephyr/net/ieee802154_radio.h>
 
 #define BUF_TIMEOUT K_MSEC(50)
 
+#ifndef CONFIG_NET_L2_IEEE802154_TX_QUEUE
 NET_BUF_POOL_DEFINE(frame_buf_pool, 1, IEEE802154_MTU - 2, 8, NULL);
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
 
 #define PKT_TITLE    "IEEE 802.15.4 packet content:"
 #define TX_PKT_TITLE "> " PKT_TITLE
@@ -237,12 +243,34 @@ static enum net_verdict ieee802154_recv(struct net_if *iface, struct net_pkt *pk
 #endif /* CONFIG_NET_6LO */
 }
 
+static int ieee802154_send_frame(struct net_if *iface, struct net_pkt *pkt,
+				 struct net_buf *frame_buf, struct net_linkaddr *ll_addr_dst)
+{
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+	ieee802154_tx_queue_push(iface, pkt, frame_buf, ll_addr_dst);
+	return 0;
+#else
+	if (IS_ENABLED(CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA) &&
+	    ieee802154_get_hw_capabilities(iface) & IEEE802154_HW_CSMA) {
+		/* CSMA in hardware */
+		return ieee802154_tx(iface, IEEE802154_TX_MODE_CSMA_CA, pkt, frame_buf);
+	}
+
+	/* Media access (direct, CSMA, ALOHA, ...) in software */
+	return ieee802154_radio_send(iface, pkt, frame_buf);
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
+}
+
 static int ieee802154_send(struct net_if *iface, struct net_pkt *pkt)
 {
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+	struct net_buf *frame_buf;
+#else
 	static struct net_buf *frame_buf;
 	if (frame_buf == NULL) {
 		frame_buf = net_buf_alloc(&frame_buf_pool, K_FOREVER);
 	}
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
 
 	struct net_linkaddr *ll_addr_dst = net_pkt_lladdr_dst(pkt);
 	uint8_t ll_hdr_len = ieee802154_compute_header_and_authtag_size(iface, ll_addr_dst);
@@ -262,8 +290,14 @@ static int ieee802154_send(struct net_if *iface, struct net_pkt *pkt)
 	struct ieee802154_context *ctx = net_if_l2_data(iface);
 	struct net_buf *buf = pkt->buffer;
 	while (buf) {
+		int frame_len;
 		int ret;
 
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+		/* Every queued frame has its own buffer */
+		frame_buf = ieee802154_tx_queue_frame_alloc();
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
+
 		/* Reinitializing frame_buf */
 		net_buf_reset(frame_buf);
 		net_buf_add(frame_buf, ll_hdr_len);
@@ -281,23 +315,21 @@ static int ieee802154_send(struct net_if *iface, struct net_pkt *pkt)
 #endif /* CONFIG_NET_L2_IEEE802154_FRAGMENT */
 
 		if (!ieee802154_create_data_frame(ctx, ll_addr_dst, frame_buf, ll_hdr_len)) {
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+			net_buf_unref(frame_buf);
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
 			return -EINVAL;
 		}
 
-		if (IS_ENABLED(CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA) &&
-		    ieee802154_get_hw_capabilities(iface) & IEEE802154_HW_CSMA) {
-			/* CSMA in hardware */
-			ret = ieee802154_tx(iface, IEEE802154_TX_MODE_CSMA_CA, pkt, frame_buf);
-		} else {
-			/* Media access (direct, CSMA, ALOHA, ...) in software */
-			ret = ieee802154_radio_send(iface, pkt, frame_buf);
-		}
+		/* A queued frame_buf is not ours anymore once sent */
+		frame_len = frame_buf->len;
 
+		ret = ieee802154_send_frame(iface, pkt, frame_buf, ll_addr_dst);
 		if (ret) {
 			return ret;
 		}
 
-		len += frame_buf->len;
+		len += frame_len;
 	}
 
 	net_pkt_unref(pkt);
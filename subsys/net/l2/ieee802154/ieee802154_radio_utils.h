@@ -9,6 +9,10 @@
 
 #include "ieee802154_utils.h"
 
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+#include "ieee802154_tx_queue.h"
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
+
 /**
  * @brief Radio driver sending function that radio drivers should implement
  *
@@ -79,6 +83,10 @@ static inline int handle_ack(struct ieee802154_context *ctx,
 		ctx->ack_received = true;
 		k_sem_give(&ctx->ack_lock);
 
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+		ieee802154_tx_queue_ack(ctx);
+#endif /* CONFIG_NET_L2_IEEE802154_TX_QUEUE */
+
 		return NET_OK;
 	}
 
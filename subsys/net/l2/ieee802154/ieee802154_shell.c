@@ -21,6 +21,9 @@ LOG_MODULE_REGISTER(net_ieee802154_shell, CONFIG_NET_L2_IEEE802154_LOG_LEVEL);
 #include <zephyr/net/ieee802154_mgmt.h>
 
 #include "ieee802154_frame.h"
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+#include "ieee802154_tx_queue.h"
+#endif
 
 #define MAX_EXT_ADDR_STR_LEN sizeof("xx:xx:xx:xx:xx:xx:xx:xx")
 
@@ -590,6 +593,28 @@ static int cmd_ieee802154_get_tx_power(const struct shell *shell,
 	return 0;
 }
 
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+static int cmd_ieee802154_tx_stats(const struct shell *shell,
+				   size_t argc, char *argv[])
+{
+	struct ieee802154_tx_stats stats;
+
+	ieee802154_tx_queue_stats_get(&stats);
+
+	shell_fprintf(shell, SHELL_NORMAL,
+		      "Frames sent    : %u\n"
+		      "Frames failed  : %u\n"
+		      "Retries        : %u\n"
+		      "CCA failures   : %u\n"
+		      "Backoff (us)   : %llu\n",
+		      stats.sent, stats.failed, stats.retries,
+		      stats.cca_failures,
+		      (unsigned long long)stats.backoff_us);
+
+	return 0;
+}
+#endif
+
 SHELL_STATIC_SUBCMD_SET_CREATE(ieee802154_commands,
 	SHELL_CMD(ack, NULL,
 		  "<set/1 | unset/0> Set auto-ack flag",
@@ -634,6 +659,11 @@ SHELL_STATIC_SUBCMD_SET_CREATE(ieee802154_commands,
 	SHELL_CMD(set_tx_power,	NULL,
 		  "<-18/-7/-4/-2/0/1/2/3/5> Set TX power",
 		  cmd_ieee802154_set_tx_power),
+#ifdef CONFIG_NET_L2_IEEE802154_TX_QUEUE
+	SHELL_CMD(tx_stats, NULL,
+		  "Show the TX queue statistics",
+		  cmd_ieee802154_tx_stats),
+#endif
 	SHELL_SUBCMD_SET_END
 );
 
@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief 802.15.4 MAC TX queue implementation
+ *
+ * The frames are queued per destination and sent from work items of a
+ * dedicated work queue, driven by the radio events:
+ *
+ * - The TX work gives the head frame of the next ready queue one media
+ *   access (CSMA-CA or Aloha) attempt. When the channel is busy, the queue
+ *   backs off and the work moves on to the queues of the other
+ *   destinations instead of waiting.
+ * - Once the radio is done transmitting a frame requesting an ACK, the
+ *   frame stays in flight and the TX work returns. The reception of the
+ *   ACK, or the end of the ACK wait, runs the ACK work which completes
+ *   the frame and sends the next one right away.
+ * - The backoff of the frame following the one in flight, in the same
+ *   queue, runs during the ACK wait, so that it can go on air as soon as
+ *   the current one is acknowledged.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_ieee802154_tx_queue, CONFIG_NET_L2_IEEE802154_LOG_LEVEL);
+
+#include <zephyr/init.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_if.h>
+
+#include <zephyr/sys/util.h>
+#include <zephyr/random/rand32.h>
+
+#include <errno.h>
+
+#include "ieee802154_frame.h"
+#include "ieee802154_utils.h"
+#include "ieee802154_radio_utils.h"
+#include "ieee802154_tx_queue.h"
+
+#if defined(CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA)
+#define MIN_BE CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA_MIN_BE
+#define MAX_BE CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA_MAX_BE
+#define MAX_BO CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA_MAX_BO
+#else
+/* Aloha: no channel assessment and no backoff */
+#define MIN_BE 0
+#define MAX_BE 0
+#define MAX_BO 0
+#endif
+
+/* Same backoff period as the CSMA-CA radio protocol */
+#define BACKOFF_PERIOD_US 20U
+
+/* Same ACK wait as the radio protocols */
+#define ACK_WAIT K_MSEC(10)
+
+#define TX_QUEUES CONFIG_NET_L2_IEEE802154_TX_QUEUE_DESTS
+
+#if IS_ENABLED(CONFIG_NET_TC_THREAD_COOPERATIVE)
+/* Lowest priority cooperative thread */
+#define THREAD_PRIORITY K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1)
+#else
+#define THREAD_PRIORITY K_PRIO_PREEMPT(CONFIG_NUM_PREEMPT_PRIORITIES - 1)
+#endif
+
+/* Frame buffer user data */
+struct tx_frame {
+	struct net_if *iface;
+	struct net_pkt *pkt;
+};
+
+NET_BUF_POOL_DEFINE(tx_frame_pool, CONFIG_NET_L2_IEEE802154_TX_QUEUE_FRAMES,
+		    IEEE802154_MTU - 2, sizeof(struct tx_frame), NULL);
+
+struct tx_queue {
+	sys_slist_t frames;
+	int64_t not_before;	/* Uptime, in ticks, to try the head frame */
+	int64_t next_not_before; /* Same, for the frame after the one in flight */
+	uint8_t be;		/* Backoff exponent */
+	uint8_t nb;		/* Busy channel assessments of this attempt */
+	uint8_t attempts;	/* Failed attempts of the head frame */
+};
+
+/* The frame on air or waiting for its ACK, at most one at a time as the
+ * radio is half-duplex.
+ */
+struct tx_inflight {
+	struct tx_queue *queue;
+	struct net_buf *frame;
+	bool sent;		/* The radio is done, the ACK wait is running */
+	bool acked;
+};
+
+static struct tx_queue queues[TX_QUEUES];
+static struct tx_inflight inflight;
+static uint8_t next_queue;
+static struct ieee802154_tx_stats tx_stats;
+static struct k_spinlock lock;
+
+static struct k_work_q tx_work_q;
+static K_KERNEL_STACK_DEFINE(tx_work_q_stack,
+			     CONFIG_NET_L2_IEEE802154_TX_QUEUE_STACK_SIZE);
+
+static void tx_work_handler(struct k_work *work);
+static void ack_work_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(tx_work, tx_work_handler);
+static K_WORK_DELAYABLE_DEFINE(ack_work, ack_work_handler);
+
+static inline struct tx_frame *tx_frame_get(struct net_buf *frame)
+{
+	return net_buf_user_data(frame);
+}
+
+static inline struct net_buf *queue_head(struct tx_queue *queue)
+{
+	return CONTAINER_OF(sys_slist_peek_head(&queue->frames),
+			    struct net_buf, node);
+}
+
+/* Must be called with the lock held */
+static int64_t backoff_deadline(uint8_t be)
+{
+	uint32_t us = 0U;
+
+	if (be) {
+		us = (sys_rand32_get() & BIT_MASK(be)) * BACKOFF_PERIOD_US;
+	}
+
+	tx_stats.backoff_us += us;
+
+	return k_uptime_ticks() + k_us_to_ticks_ceil64(us);
+}
+
+/* Must be called with the lock held */
+static void backoff(struct tx_queue *queue)
+{
+	queue->not_before = backoff_deadline(queue->be);
+}
+
+/* Must be called with the lock held */
+static void start_head(struct tx_queue *queue, bool prepared)
+{
+	queue->be = MIN_BE;
+	queue->nb = 0U;
+	queue->attempts = 0U;
+
+	if (prepared) {
+		queue->not_before = queue->next_not_before;
+	} else {
+		backoff(queue);
+	}
+}
+
+static void frame_release(struct net_buf *frame)
+{
+	net_pkt_unref(tx_frame_get(frame)->pkt);
+
+	/* The list node shares its place with the fragment pointer */
+	frame->frags = NULL;
+	net_buf_unref(frame);
+}
+
+/* Dequeue the head frame. When it failed, the other frames of the same
+ * packet are dropped too as the packet could not be reassembled anyway.
+ */
+static void frame_done(struct tx_queue *queue, struct net_buf *frame,
+		       bool failed)
+{
+	struct net_pkt *pkt = tx_frame_get(frame)->pkt;
+	struct net_buf *next, *tmp;
+	sys_snode_t *prev = NULL;
+	k_spinlock_key_t key;
+	sys_slist_t dropped;
+	bool prepared;
+
+	sys_slist_init(&dropped);
+
+	key = k_spin_lock(&lock);
+
+	(void)sys_slist_get_not_empty(&queue->frames);
+
+	/* The backoff of the next frame ran while this one was in flight */
+	prepared = !failed && queue->next_not_before != 0;
+	queue->next_not_before = 0;
+
+	if (failed) {
+		tx_stats.failed++;
+
+		SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&queue->frames, next, tmp,
+						  node) {
+			if (tx_frame_get(next)->pkt != pkt) {
+				prev = &next->node;
+				continue;
+			}
+
+			sys_slist_remove(&queue->frames, prev, &next->node);
+			sys_slist_append(&dropped, &next->node);
+			tx_stats.failed++;
+		}
+	} else {
+		tx_stats.sent++;
+	}
+
+	if (!sys_slist_is_empty(&queue->frames)) {
+		start_head(queue, prepared);
+	}
+
+	k_spin_unlock(&lock, key);
+
+	frame_release(frame);
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&dropped, next, tmp, node) {
+		frame_release(next);
+	}
+}
+
+/* Retry the head frame after a backoff, or give up on it */
+static void frame_failed(struct tx_queue *queue, struct net_buf *frame)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	queue->next_not_before = 0;
+
+	if (++queue->attempts < CONFIG_NET_L2_IEEE802154_RADIO_TX_RETRIES) {
+		tx_stats.retries++;
+		queue->be = MIN_BE;
+		queue->nb = 0U;
+		backoff(queue);
+
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	frame_done(queue, frame, true);
+}
+
+/* One media access attempt for the head frame of the queue. Returns true
+ * when the frame is left in flight, waiting for its ACK.
+ */
+static bool tx_attempt(struct tx_queue *queue, struct net_buf *frame)
+{
+	struct net_if *iface = tx_frame_get(frame)->iface;
+	struct net_pkt *pkt = tx_frame_get(frame)->pkt;
+	struct ieee802154_context *ctx = net_if_l2_data(iface);
+	bool hw_csma = IS_ENABLED(CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA) &&
+		       (ieee802154_get_hw_capabilities(iface) &
+			IEEE802154_HW_CSMA);
+	k_spinlock_key_t key;
+	bool wait_ack;
+	int ret;
+
+	if (IS_ENABLED(CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA) && !hw_csma &&
+	    ieee802154_cca(iface)) {
+		key = k_spin_lock(&lock);
+
+		tx_stats.cca_failures++;
+		queue->be = MIN(queue->be + 1, MAX_BE);
+		queue->nb++;
+
+		if (queue->nb <= MAX_BO) {
+			backoff(queue);
+			k_spin_unlock(&lock, key);
+			return false;
+		}
+
+		k_spin_unlock(&lock, key);
+
+		NET_DBG("frame %p channel access failure", frame);
+		frame_failed(queue, frame);
+		return false;
+	}
+
+	/* Radios acknowledging in hardware return from tx() with the ACK
+	 * handled, the others report it with ieee802154_radio_handle_ack().
+	 */
+	wait_ack = prepare_for_ack(ctx, pkt, frame) &&
+		   !(ieee802154_get_hw_capabilities(iface) &
+		     IEEE802154_HW_TX_RX_ACK);
+
+	key = k_spin_lock(&lock);
+
+	if (wait_ack) {
+		/* Set before transmitting, the ACK may come in early */
+		inflight.queue = queue;
+		inflight.frame = frame;
+		inflight.sent = false;
+		inflight.acked = false;
+	}
+
+	/* The next frame of the queue backs off while this one is on air */
+	if (sys_slist_peek_next(&frame->node)) {
+		queue->next_not_before = backoff_deadline(MIN_BE);
+	}
+
+	k_spin_unlock(&lock, key);
+
+	ret = ieee802154_tx(iface, hw_csma ? IEEE802154_TX_MODE_CSMA_CA :
+				    IEEE802154_TX_MODE_DIRECT,
+			    pkt, frame);
+	if (ret) {
+		NET_DBG("frame %p not sent (%d)", frame, ret);
+
+		if (wait_ack) {
+			key = k_spin_lock(&lock);
+			inflight.frame = NULL;
+			k_spin_unlock(&lock, key);
+
+			ctx->ack_seq = 0U;
+		}
+
+		frame_failed(queue, frame);
+		return false;
+	}
+
+	if (!wait_ack) {
+		frame_done(queue, frame, false);
+		return false;
+	}
+
+	key = k_spin_lock(&lock);
+
+	inflight.sent = true;
+	k_work_reschedule_for_queue(&tx_work_q, &ack_work,
+				    inflight.acked ? K_NO_WAIT : ACK_WAIT);
+
+	k_spin_unlock(&lock, key);
+
+	return true;
+}
+
+/* Next queue, in a round robin way, whose head frame is ready. Otherwise
+ * wait is set to the time until the earliest one gets ready.
+ * Must be called with the lock held.
+ */
+static struct tx_queue *next_ready_queue(k_timeout_t *wait)
+{
+	int64_t now = k_uptime_ticks();
+	int64_t earliest = INT64_MAX;
+	uint8_t i;
+
+	for (i = 0U; i < TX_QUEUES; i++) {
+		uint8_t n = (next_queue + i) % TX_QUEUES;
+		struct tx_queue *queue = &queues[n];
+
+		if (sys_slist_is_empty(&queue->frames)) {
+			continue;
+		}
+
+		if (queue->not_before <= now) {
+			next_queue = (n + 1) % TX_QUEUES;
+			return queue;
+		}
+
+		earliest = MIN(earliest, queue->not_before);
+	}
+
+	*wait = earliest == INT64_MAX ? K_FOREVER : K_TICKS(earliest - now);
+
+	return NULL;
+}
+
+/* Send the ready frames until one is left in flight or none is ready */
+static void tx_next(void)
+{
+	while (true) {
+		k_timeout_t wait = K_FOREVER;
+		struct net_buf *frame;
+		struct tx_queue *queue;
+		k_spinlock_key_t key;
+
+		key = k_spin_lock(&lock);
+
+		if (inflight.frame) {
+			/* The ACK work sends the next one */
+			k_spin_unlock(&lock, key);
+			return;
+		}
+
+		queue = next_ready_queue(&wait);
+		if (!queue) {
+			if (!K_TIMEOUT_EQ(wait, K_FOREVER)) {
+				k_work_reschedule_for_queue(&tx_work_q,
+							    &tx_work, wait);
+			}
+
+			k_spin_unlock(&lock, key);
+			return;
+		}
+
+		/* Only the work queue removes frames */
+		frame = queue_head(queue);
+
+		k_spin_unlock(&lock, key);
+
+		if (tx_attempt(queue, frame)) {
+			return;
+		}
+	}
+}
+
+static void tx_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	tx_next();
+}
+
+static void ack_work_handler(struct k_work *work)
+{
+	struct ieee802154_context *ctx;
+	struct tx_queue *queue;
+	struct net_buf *frame;
+	k_spinlock_key_t key;
+	bool acked;
+
+	ARG_UNUSED(work);
+
+	key = k_spin_lock(&lock);
+
+	if (!inflight.frame || !inflight.sent) {
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	queue = inflight.queue;
+	frame = inflight.frame;
+	acked = inflight.acked;
+	inflight.frame = NULL;
+
+	k_spin_unlock(&lock, key);
+
+	ctx = net_if_l2_data(tx_frame_get(frame)->iface);
+	ctx->ack_seq = 0U;
+
+	if (acked) {
+		frame_done(queue, frame, false);
+	} else {
+		NET_DBG("frame %p not acknowledged", frame);
+		frame_failed(queue, frame);
+	}
+
+	tx_next();
+}
+
+void ieee802154_tx_queue_ack(struct ieee802154_context *ctx)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	if (inflight.frame &&
+	    net_if_l2_data(tx_frame_get(inflight.frame)->iface) == ctx) {
+		inflight.acked = true;
+
+		if (inflight.sent) {
+			k_work_reschedule_for_queue(&tx_work_q, &ack_work,
+						    K_NO_WAIT);
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+static struct tx_queue *dst_queue(struct net_if *iface,
+				  const struct net_linkaddr *dst)
+{
+	uint32_t hash = POINTER_TO_UINT(iface);
+	uint8_t i;
+
+	if (dst->addr) {
+		for (i = 0U; i < dst->len; i++) {
+			hash = hash * 31U + dst->addr[i];
+		}
+	}
+
+	return &queues[hash % TX_QUEUES];
+}
+
+struct net_buf *ieee802154_tx_queue_frame_alloc(void)
+{
+	return net_buf_alloc(&tx_frame_pool, K_FOREVER);
+}
+
+void ieee802154_tx_queue_push(struct net_if *iface, struct net_pkt *pkt,
+			      struct net_buf *frame,
+			      const struct net_linkaddr *dst)
+{
+	struct tx_queue *queue = dst_queue(iface, dst);
+	k_spinlock_key_t key;
+
+	tx_frame_get(frame)->iface = iface;
+	tx_frame_get(frame)->pkt = net_pkt_ref(pkt);
+
+	NET_DBG("frame %p queue %d", frame, (int)(queue - queues));
+
+	key = k_spin_lock(&lock);
+
+	if (sys_slist_is_empty(&queue->frames)) {
+		start_head(queue, false);
+	}
+
+	sys_slist_append(&queue->frames, &frame->node);
+
+	if (!inflight.frame) {
+		k_work_reschedule_for_queue(&tx_work_q, &tx_work, K_NO_WAIT);
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void ieee802154_tx_queue_stats_get(struct ieee802154_tx_stats *stats)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+	*stats = tx_stats;
+	k_spin_unlock(&lock, key);
+}
+
+static int ieee802154_tx_queue_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	k_work_queue_start(&tx_work_q, tx_work_q_stack,
+			   K_KERNEL_STACK_SIZEOF(tx_work_q_stack),
+			   THREAD_PRIORITY, NULL);
+	k_thread_name_set(&tx_work_q.thread, "ieee802154_tx");
+
+	return 0;
+}
+
+SYS_INIT(ieee802154_tx_queue_init, POST_KERNEL,
+	 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
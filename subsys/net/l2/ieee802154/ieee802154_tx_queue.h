@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief 802.15.4 MAC TX queue
+ *
+ * This is not to be included by the application.
+ */
+
+#ifndef __NET_IEEE802154_TX_QUEUE_H__
+#define __NET_IEEE802154_TX_QUEUE_H__
+
+#include <zephyr/net/ieee802154.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/types.h>
+
+/** TX queue statistics, since boot */
+struct ieee802154_tx_stats {
+	/** Frames sent, and acknowledged when requested */
+	uint32_t sent;
+	/** Frames dropped after the last attempt */
+	uint32_t failed;
+	/** Transmission attempts after a failed one */
+	uint32_t retries;
+	/** Clear channel assessments which found the channel busy */
+	uint32_t cca_failures;
+	/** Total time spent backing off, in microseconds */
+	uint64_t backoff_us;
+};
+
+/**
+ *  @brief Get a buffer for a frame to queue
+ *
+ *  @details Waits until a queued frame is done when all the buffers
+ *  are in use.
+ *
+ *  @return Pointer to an empty frame buffer
+ */
+struct net_buf *ieee802154_tx_queue_frame_alloc(void);
+
+/**
+ *  @brief Queue a frame for transmission
+ *
+ *  @details The frame is sent from the TX work queue, after the frames
+ *  queued before for the same destination. The queue takes a reference on
+ *  the packet until the frame is done and owns the frame buffer.
+ *
+ *  @param iface Pointer to the interface to send from
+ *  @param pkt Pointer to the packet the frame belongs to
+ *  @param frame Pointer to a frame buffer from
+ *         ieee802154_tx_queue_frame_alloc(), holding the whole frame
+ *  @param dst Pointer to the link layer destination address, its address
+ *         is NULL for a broadcast
+ */
+void ieee802154_tx_queue_push(struct net_if *iface, struct net_pkt *pkt,
+			      struct net_buf *frame,
+			      const struct net_linkaddr *dst);
+
+/**
+ *  @brief Report the ACK of the frame in flight
+ *
+ *  @details Called when an ACK matching the sequence number of the last
+ *  frame sent is received, completes that frame and sends the next one.
+ *
+ *  @param ctx Pointer to the context of the interface receiving the ACK
+ */
+void ieee802154_tx_queue_ack(struct ieee802154_context *ctx);
+
+/**
+ *  @brief Get the TX queue statistics
+ *
+ *  @param stats Pointer to the statistics to fill
+ */
+void ieee802154_tx_queue_stats_get(struct ieee802154_tx_stats *stats);
+
+#endif /* __NET_IEEE802154_TX_QUEUE_H__ */
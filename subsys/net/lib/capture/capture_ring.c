@@ -0,0 +1,536 @@
+/** @file
+ * @brief Local network packet capture ring
+ *
+ * Captured packets are copied into a ring buffer in RAM and exported
+ * later in pcapng format.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_capture_ring, CONFIG_NET_CAPTURE_RING_LOG_LEVEL);
+
+#include <zephyr/zephyr.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/capture.h>
+
+#if defined(CONFIG_FILE_SYSTEM)
+#include <zephyr/fs/fs.h>
+#endif
+
+#define RING_SIZE CONFIG_NET_CAPTURE_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+/* Keeps the record header word naturally aligned for the atomic ops */
+#define REC_ALIGN 8
+
+#define REC_READY BIT(31)
+#define REC_PAD BIT(30)
+#define REC_LEN_MASK BIT_MASK(24)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0,
+	     "Capture ring size must be a power of two");
+
+/* pcapng block types and link types */
+#define PCAPNG_SHB_TYPE 0x0A0D0D0AU
+#define PCAPNG_IDB_TYPE 0x00000001U
+#define PCAPNG_EPB_TYPE 0x00000006U
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4DU
+
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_IEEE802_15_4_NOFCS 230
+
+struct pcapng_shb {
+	uint32_t type;
+	uint32_t total_len;
+	uint32_t magic;
+	uint16_t major;
+	uint16_t minor;
+	int64_t section_len;
+	uint32_t total_len2;
+} __packed;
+
+struct pcapng_idb {
+	uint32_t type;
+	uint32_t total_len;
+	uint16_t linktype;
+	uint16_t reserved;
+	uint32_t snaplen;
+	uint32_t total_len2;
+} __packed;
+
+struct pcapng_epb {
+	uint32_t type;
+	uint32_t total_len;
+	uint32_t iface_id;
+	uint32_t ts_high;
+	uint32_t ts_low;
+	uint32_t cap_len;
+	uint32_t orig_len;
+} __packed;
+
+/*
+ * Record in the ring. The header word is written last by the producer,
+ * the exporter stops at the first record that is not ready yet.
+ */
+struct ring_rec {
+	atomic_t hdr;
+	uint32_t orig_len;
+	uint32_t ts_high;
+	uint32_t ts_low;
+	uint16_t ifindex;
+	uint16_t cap_len;
+	uint8_t data[];
+};
+
+static uint8_t ring_buf[RING_SIZE] __aligned(REC_ALIGN);
+
+static struct {
+	/* Free running byte positions, the producers reserve space by
+	 * moving the head and the exporter frees it by moving the tail.
+	 */
+	atomic_t head;
+	atomic_t tail;
+	atomic_t enabled;
+
+	/* Producers currently using the capture settings below */
+	atomic_t active;
+
+	struct net_if *iface;
+	net_capture_filter_cb_t cb;
+	void *user_data;
+	uint16_t snaplen;
+
+	atomic_t captured;
+	atomic_t dropped;
+	atomic_t filtered;
+	atomic_t bytes;
+} ring;
+
+/* Serializes the consumers and the capture settings, the packet path
+ * does not use this.
+ */
+static K_MUTEX_DEFINE(ring_lock);
+
+static int ring_reserve(uint32_t len, uint32_t *pos)
+{
+	atomic_val_t head, tail;
+	struct ring_rec *rec;
+	uint32_t off, pad;
+
+	do {
+		head = atomic_get(&ring.head);
+		tail = atomic_get(&ring.tail);
+
+		/* A record is never split, the end of the ring is skipped
+		 * with a pad record if needed.
+		 */
+		off = (uint32_t)head & RING_MASK;
+		pad = (off + len > RING_SIZE) ? RING_SIZE - off : 0U;
+
+		if ((uint32_t)(head - tail) + pad + len > RING_SIZE) {
+			return -ENOSPC;
+		}
+	} while (!atomic_cas(&ring.head, head, head + pad + len));
+
+	if (pad) {
+		rec = (struct ring_rec *)&ring_buf[off];
+		atomic_set(&rec->hdr, pad | REC_PAD | REC_READY);
+	}
+
+	*pos = (uint32_t)(head + pad) & RING_MASK;
+
+	return 0;
+}
+
+static uint16_t copy_pkt_data(struct net_pkt *pkt, uint8_t *dst, uint16_t max)
+{
+	struct net_buf *frag;
+	uint16_t copied = 0U;
+	uint16_t len;
+
+	/* Walk the fragments directly, the packet cursor may be in use */
+	for (frag = pkt->buffer; frag && copied < max; frag = frag->frags) {
+		len = MIN(frag->len, max - copied);
+		memcpy(dst + copied, frag->data, len);
+		copied += len;
+	}
+
+	return copied;
+}
+
+void net_capture_ring_pkt(struct net_if *iface, struct net_pkt *pkt)
+{
+	struct ring_rec *rec;
+	uint32_t orig_len;
+	uint16_t cap_len;
+	uint32_t pos;
+	uint32_t len;
+	uint64_t ts;
+
+	/* Announce the producer before looking at the settings, see
+	 * ring_quiesce().
+	 */
+	atomic_inc(&ring.active);
+
+	if (!atomic_get(&ring.enabled)) {
+		goto out;
+	}
+
+	if (ring.iface && ring.iface != iface) {
+		goto out;
+	}
+
+	if (ring.cb && !ring.cb(iface, pkt, ring.user_data)) {
+		atomic_inc(&ring.filtered);
+		goto out;
+	}
+
+	orig_len = net_pkt_get_len(pkt);
+	cap_len = MIN(orig_len, ring.snaplen);
+	len = ROUND_UP(sizeof(*rec) + cap_len, REC_ALIGN);
+
+	if (ring_reserve(len, &pos) < 0) {
+		atomic_inc(&ring.dropped);
+		goto out;
+	}
+
+	ts = k_ticks_to_us_floor64(k_uptime_ticks());
+
+	rec = (struct ring_rec *)&ring_buf[pos];
+	rec->orig_len = orig_len;
+	rec->ts_high = (uint32_t)(ts >> 32);
+	rec->ts_low = (uint32_t)ts;
+	rec->ifindex = net_if_get_by_iface(iface);
+	rec->cap_len = copy_pkt_data(pkt, rec->data, cap_len);
+
+	atomic_inc(&ring.captured);
+	atomic_add(&ring.bytes, rec->cap_len);
+
+	atomic_set(&rec->hdr, len | REC_READY);
+
+out:
+	atomic_dec(&ring.active);
+}
+
+#if !defined(CONFIG_NET_CAPTURE)
+/* Without the tunnel capture the ring is the only user of the hook */
+void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt)
+{
+	if (net_pkt_is_captured(pkt)) {
+		return;
+	}
+
+	net_capture_ring_pkt(iface, pkt);
+}
+#endif
+
+/*
+ * Wait until the producers that may have seen the previous settings are
+ * done. A producer announces itself before it checks the enabled flag, so
+ * once the flag is cleared and no producer is active, none can use the
+ * old settings any more.
+ */
+static void ring_quiesce(void)
+{
+	while (atomic_get(&ring.active) != 0) {
+		k_msleep(1);
+	}
+}
+
+int net_capture_ring_start(struct net_if *iface, uint16_t snaplen,
+			   net_capture_filter_cb_t cb, void *user_data)
+{
+	if (snaplen == 0U) {
+		snaplen = CONFIG_NET_CAPTURE_RING_SNAPLEN;
+	}
+
+	/* Leave room for a few packets even with a small ring */
+	if (snaplen > RING_SIZE / 4) {
+		snaplen = RING_SIZE / 4;
+	}
+
+	k_mutex_lock(&ring_lock, K_FOREVER);
+
+	atomic_clear(&ring.enabled);
+	ring_quiesce();
+
+	ring.iface = iface;
+	ring.cb = cb;
+	ring.user_data = user_data;
+	ring.snaplen = snaplen;
+
+	atomic_set(&ring.enabled, 1);
+
+	k_mutex_unlock(&ring_lock);
+
+	NET_DBG("Capturing %s%d to ring, snaplen %u",
+		iface ? "iface " : "all", iface ? net_if_get_by_iface(iface) : 0,
+		snaplen);
+
+	return 0;
+}
+
+int net_capture_ring_stop(void)
+{
+	int ret = 0;
+
+	k_mutex_lock(&ring_lock, K_FOREVER);
+
+	if (!atomic_cas(&ring.enabled, 1, 0)) {
+		ret = -EALREADY;
+	} else {
+		ring_quiesce();
+	}
+
+	k_mutex_unlock(&ring_lock);
+
+	return ret;
+}
+
+bool net_capture_ring_is_enabled(void)
+{
+	return atomic_get(&ring.enabled) != 0;
+}
+
+void net_capture_ring_stats_get(struct net_capture_ring_stats *stats)
+{
+	stats->captured = atomic_get(&ring.captured);
+	stats->dropped = atomic_get(&ring.dropped);
+	stats->filtered = atomic_get(&ring.filtered);
+	stats->bytes = atomic_get(&ring.bytes);
+	stats->used = (uint32_t)(atomic_get(&ring.head) - atomic_get(&ring.tail));
+	stats->size = RING_SIZE;
+}
+
+/*
+ * Consume the ready records, cb is called for each packet. Stops at the
+ * first record that is still being written or if cb fails.
+ */
+static int ring_drain(int (*cb)(struct ring_rec *rec, void *user_data),
+		      void *user_data)
+{
+	atomic_val_t head = atomic_get(&ring.head);
+	atomic_val_t tail = atomic_get(&ring.tail);
+	struct ring_rec *rec;
+	atomic_val_t hdr;
+	uint32_t len;
+	int count = 0;
+	int ret;
+
+	while (tail != head) {
+		rec = (struct ring_rec *)&ring_buf[(uint32_t)tail & RING_MASK];
+
+		hdr = atomic_get(&rec->hdr);
+		if (!(hdr & REC_READY)) {
+			break;
+		}
+
+		len = hdr & REC_LEN_MASK;
+
+		if (!(hdr & REC_PAD) && cb) {
+			ret = cb(rec, user_data);
+			if (ret < 0) {
+				return ret;
+			}
+
+			count++;
+		}
+
+		/* The producers expect to find zeroed memory, a stale header
+		 * inside old data must never look like a ready record.
+		 */
+		memset(rec, 0, len);
+
+		tail += len;
+		atomic_set(&ring.tail, tail);
+	}
+
+	return count;
+}
+
+static uint16_t iface_linktype(struct net_if *iface)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET)) {
+		return LINKTYPE_ETHERNET;
+	}
+#endif
+
+#if defined(CONFIG_NET_L2_IEEE802154)
+	if (net_if_l2(iface) == &NET_L2_GET_NAME(IEEE802154)) {
+		return LINKTYPE_IEEE802_15_4_NOFCS;
+	}
+#endif
+
+	return LINKTYPE_RAW;
+}
+
+struct export_ctx {
+	net_capture_write_cb_t cb;
+	void *user_data;
+};
+
+static int export_rec(struct ring_rec *rec, void *user_data)
+{
+	static const uint8_t padding[3];
+	struct export_ctx *ctx = user_data;
+	struct pcapng_epb epb;
+	uint32_t total_len;
+	int ret;
+
+	total_len = sizeof(epb) + ROUND_UP(rec->cap_len, 4) + sizeof(uint32_t);
+
+	epb.type = PCAPNG_EPB_TYPE;
+	epb.total_len = total_len;
+	epb.iface_id = rec->ifindex - 1;
+	epb.ts_high = rec->ts_high;
+	epb.ts_low = rec->ts_low;
+	epb.cap_len = rec->cap_len;
+	epb.orig_len = rec->orig_len;
+
+	ret = ctx->cb(&epb, sizeof(epb), ctx->user_data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = ctx->cb(rec->data, rec->cap_len, ctx->user_data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (rec->cap_len % 4) {
+		ret = ctx->cb(padding, 4 - rec->cap_len % 4, ctx->user_data);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return ctx->cb(&total_len, sizeof(total_len), ctx->user_data);
+}
+
+static int export_header(struct export_ctx *ctx)
+{
+	struct pcapng_shb shb = {
+		.type = PCAPNG_SHB_TYPE,
+		.total_len = sizeof(shb),
+		.magic = PCAPNG_BYTE_ORDER_MAGIC,
+		.major = 1,
+		.minor = 0,
+		.section_len = -1,
+		.total_len2 = sizeof(shb),
+	};
+	struct pcapng_idb idb = {
+		.type = PCAPNG_IDB_TYPE,
+		.total_len = sizeof(idb),
+		.snaplen = ring.snaplen,
+		.total_len2 = sizeof(idb),
+	};
+	struct net_if *iface;
+	int ret;
+	int i;
+
+	ret = ctx->cb(&shb, sizeof(shb), ctx->user_data);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* One description per interface so that the packet blocks can
+	 * refer to them by interface index.
+	 */
+	for (i = 1; (iface = net_if_get_by_index(i)) != NULL; i++) {
+		idb.linktype = iface_linktype(iface);
+
+		ret = ctx->cb(&idb, sizeof(idb), ctx->user_data);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int net_capture_ring_export(net_capture_write_cb_t cb, void *user_data)
+{
+	struct export_ctx ctx = {
+		.cb = cb,
+		.user_data = user_data,
+	};
+	int ret;
+
+	if (cb == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&ring_lock, K_FOREVER);
+
+	ret = export_header(&ctx);
+	if (ret == 0) {
+		ret = ring_drain(export_rec, &ctx);
+	}
+
+	k_mutex_unlock(&ring_lock);
+
+	return ret;
+}
+
+#if defined(CONFIG_FILE_SYSTEM)
+static int file_write(const void *data, size_t len, void *user_data)
+{
+	ssize_t ret;
+
+	ret = fs_write(user_data, data, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return ret == len ? 0 : -ENOSPC;
+}
+
+int net_capture_ring_export_file(const char *path)
+{
+	struct fs_file_t file;
+	int ret;
+
+	fs_file_t_init(&file);
+
+	ret = fs_open(&file, path, FS_O_CREATE | FS_O_WRITE);
+	if (ret < 0) {
+		NET_DBG("Cannot open %s (%d)", path, ret);
+		return ret;
+	}
+
+	ret = fs_truncate(&file, 0);
+	if (ret == 0) {
+		ret = net_capture_ring_export(file_write, &file);
+	}
+
+	(void)fs_close(&file);
+
+	return ret;
+}
+#endif /* CONFIG_FILE_SYSTEM */
+
+void net_capture_ring_clear(void)
+{
+	k_mutex_lock(&ring_lock, K_FOREVER);
+
+	(void)ring_drain(NULL, NULL);
+
+	atomic_clear(&ring.captured);
+	atomic_clear(&ring.dropped);
+	atomic_clear(&ring.filtered);
+	atomic_clear(&ring.bytes);
+
+	k_mutex_unlock(&ring_lock);
+}
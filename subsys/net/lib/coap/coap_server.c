@@ -0,0 +1,1493 @@
+/** @file
+ * @brief CoAP server engine
+ *
+ * Resources, observers and pending messages are kept in hash tables, so
+ * that handling a message never walks all of them. Retransmissions are
+ * driven by a timer wheel: a pending message is linked to the slot of the
+ * tick in which it expires, and only the slots of the elapsed ticks are
+ * looked at.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_coap, CONFIG_COAP_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/math_extras.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/coap_server.h>
+
+#if IS_ENABLED(CONFIG_NET_TC_THREAD_COOPERATIVE)
+/* Lowest priority cooperative thread */
+#define THREAD_PRIORITY K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1)
+#else
+#define THREAD_PRIORITY K_PRIO_PREEMPT(CONFIG_NUM_PREEMPT_PRIORITIES - 1)
+#endif
+
+/* Longest time to wait in poll, so that a stop request is noticed. */
+#define SERVER_POLL_INTERVAL_MS 500
+
+/* Length of a tick of the timer wheel, 128 ms. The wheel covers about
+ * 4 seconds, pending messages expiring later stay in their slot until their
+ * turn comes.
+ */
+#define WHEEL_TICK_SHIFT 7
+
+/* Values as per RFC 7252, section 4.8.2 */
+#define EXCHANGE_LIFETIME_MS 247000
+#define NON_LIFETIME_MS 145000
+
+/* Observe option values are 24 bits long, RFC 7641 section 4.4 */
+#define OBSERVE_MAX 0xFFFFFF
+
+#define BASIC_HEADER_SIZE 4
+#define MAX_PATH_SEGMENTS 8
+
+#define HASH_MASK (CONFIG_COAP_SERVER_HASH_SIZE - 1)
+#define HASH_INIT 2166136261U
+#define HASH_PRIME 16777619U
+
+BUILD_ASSERT((CONFIG_COAP_SERVER_HASH_SIZE & HASH_MASK) == 0,
+	     "CONFIG_COAP_SERVER_HASH_SIZE must be a power of two");
+BUILD_ASSERT((CONFIG_COAP_SERVER_BLOCK_SIZE &
+	      (CONFIG_COAP_SERVER_BLOCK_SIZE - 1)) == 0,
+	     "CONFIG_COAP_SERVER_BLOCK_SIZE must be a power of two");
+BUILD_ASSERT(CONFIG_COAP_SERVER_MESSAGE_SIZE > CONFIG_COAP_SERVER_BLOCK_SIZE,
+	     "No room for the header and options of a block");
+
+static uint8_t block_szx(void)
+{
+	return u32_count_trailing_zeros(CONFIG_COAP_SERVER_BLOCK_SIZE) - 4;
+}
+
+/* FNV-1a */
+static uint32_t hash_add(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *ptr = data;
+
+	while (len-- > 0) {
+		hash ^= *ptr++;
+		hash *= HASH_PRIME;
+	}
+
+	return hash;
+}
+
+static uint32_t path_hash_add(uint32_t hash, const void *segment, size_t len)
+{
+	hash = hash_add(hash, segment, len);
+
+	return hash_add(hash, "/", 1);
+}
+
+static uint32_t addr_hash_add(uint32_t hash, const struct sockaddr *addr)
+{
+	if (addr->sa_family == AF_INET6) {
+		hash = hash_add(hash, &net_sin6(addr)->sin6_addr,
+				sizeof(struct in6_addr));
+
+		return hash_add(hash, &net_sin6(addr)->sin6_port,
+				sizeof(uint16_t));
+	}
+
+	hash = hash_add(hash, &net_sin(addr)->sin_addr, sizeof(struct in_addr));
+
+	return hash_add(hash, &net_sin(addr)->sin_port, sizeof(uint16_t));
+}
+
+static bool addr_equal(const struct sockaddr *a, const struct sockaddr *b)
+{
+	if (a->sa_family != b->sa_family) {
+		return false;
+	}
+
+	if (a->sa_family == AF_INET6) {
+		return net_sin6(a)->sin6_port == net_sin6(b)->sin6_port &&
+		       net_ipv6_addr_cmp(&net_sin6(a)->sin6_addr,
+					 &net_sin6(b)->sin6_addr);
+	}
+
+	return net_sin(a)->sin_port == net_sin(b)->sin_port &&
+	       net_ipv4_addr_cmp(&net_sin(a)->sin_addr,
+				 &net_sin(b)->sin_addr);
+}
+
+static socklen_t addr_len(const struct sockaddr *addr)
+{
+	return addr->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6) :
+					     sizeof(struct sockaddr_in);
+}
+
+static int server_send(struct coap_server *server, const uint8_t *data,
+		       size_t len, const struct sockaddr *addr)
+{
+	ssize_t ret;
+
+	ret = zsock_sendto(server->sock, data, len, 0, addr, addr_len(addr));
+	if (ret < 0) {
+		NET_DBG("Cannot send (%d)", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int send_empty(struct coap_server *server, uint8_t type, uint16_t id,
+		      const struct sockaddr *addr)
+{
+	uint8_t data[BASIC_HEADER_SIZE];
+	struct coap_packet cpkt;
+	int ret;
+
+	ret = coap_packet_init(&cpkt, data, sizeof(data), COAP_VERSION_1, type,
+			       0, NULL, COAP_CODE_EMPTY, id);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return server_send(server, cpkt.data, cpkt.offset, addr);
+}
+
+static void resource_add(struct coap_server *server,
+			 struct coap_server_resource *resource)
+{
+	const char * const *segment;
+	uint32_t hash = HASH_INIT;
+
+	for (segment = resource->path; *segment; segment++) {
+		hash = path_hash_add(hash, *segment, strlen(*segment));
+	}
+
+	resource->hash = hash;
+	resource->age = 2;
+	sys_slist_init(&resource->observers);
+
+	sys_slist_prepend(&server->resources[hash & HASH_MASK],
+			  &resource->node);
+}
+
+static bool resource_path_eq(const struct coap_server_resource *resource,
+			     const struct coap_option *options, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (resource->path[i] == NULL ||
+		    strlen(resource->path[i]) != options[i].len ||
+		    memcmp(resource->path[i], options[i].value,
+			   options[i].len) != 0) {
+			return false;
+		}
+	}
+
+	return resource->path[count] == NULL;
+}
+
+static struct coap_server_resource *resource_find(struct coap_server *server,
+						  const struct coap_packet *request)
+{
+	struct coap_option options[MAX_PATH_SEGMENTS];
+	struct coap_server_resource *resource;
+	uint32_t hash = HASH_INIT;
+	int count;
+	int i;
+
+	count = coap_find_options(request, COAP_OPTION_URI_PATH, options,
+				  ARRAY_SIZE(options));
+	if (count < 0) {
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++) {
+		hash = path_hash_add(hash, options[i].value, options[i].len);
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&server->resources[hash & HASH_MASK],
+				     resource, node) {
+		if (resource->hash == hash &&
+		    resource_path_eq(resource, options, count)) {
+			return resource;
+		}
+	}
+
+	return NULL;
+}
+
+/* Read one block of the representation of a resource to the block buffer */
+static int resource_read(struct coap_server *server,
+			 struct coap_server_resource *resource,
+			 const struct coap_packet *request,
+			 uint32_t num, uint8_t szx, bool *more)
+{
+	size_t size = coap_block_size_to_bytes(szx);
+	int ret;
+
+	*more = false;
+
+	ret = resource->get(resource, request, num * size, server->block, size,
+			    more);
+	if (ret > (int)size) {
+		return -EMSGSIZE;
+	}
+
+	return ret;
+}
+
+static int append_representation(struct coap_server *server,
+				 struct coap_packet *cpkt,
+				 const struct coap_server_resource *resource,
+				 int observe, uint32_t num, uint8_t szx,
+				 bool more, int len)
+{
+	int ret;
+
+	if (observe >= 0) {
+		ret = coap_append_option_int(cpkt, COAP_OPTION_OBSERVE,
+					     observe);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	ret = coap_append_option_int(cpkt, COAP_OPTION_CONTENT_FORMAT,
+				     resource->content_format);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (more || num > 0) {
+		ret = coap_append_option_int(cpkt, COAP_OPTION_BLOCK2,
+					     (num << 4) | (more << 3) | szx);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	if (len == 0) {
+		return 0;
+	}
+
+	ret = coap_packet_append_payload_marker(cpkt);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return coap_packet_append_payload(cpkt, server->block, len);
+}
+
+/* Timer wheel */
+
+static inline uint32_t pending_expiry(const struct coap_server_pending *p)
+{
+	return p->pending.t0 + p->pending.timeout;
+}
+
+static void wheel_add(struct coap_server *server, struct coap_server_pending *p)
+{
+	uint32_t tick = pending_expiry(p) >> WHEEL_TICK_SHIFT;
+
+	/* wheel_tick is the next tick to be handled */
+	if ((int32_t)(tick - server->wheel_tick) < 0) {
+		tick = server->wheel_tick;
+	}
+
+	sys_dlist_append(&server->wheel[tick % COAP_SERVER_WHEEL_SLOTS],
+			 &p->wheel_node);
+	server->wheel_count++;
+}
+
+static void wheel_remove(struct coap_server *server,
+			 struct coap_server_pending *p)
+{
+	if (sys_dnode_is_linked(&p->wheel_node)) {
+		sys_dlist_remove(&p->wheel_node);
+		server->wheel_count--;
+	}
+}
+
+/* Pending messages */
+
+static struct coap_server_pending *pending_alloc(struct coap_server *server)
+{
+	struct coap_server_pending *p;
+	sys_snode_t *node;
+
+	node = sys_slist_get(&server->free_pendings);
+	if (node == NULL) {
+		return NULL;
+	}
+
+	p = CONTAINER_OF(node, struct coap_server_pending, id_node);
+	memset(p, 0, sizeof(*p));
+
+	return p;
+}
+
+static uint32_t token_hash(const uint8_t *token, uint8_t tkl)
+{
+	return hash_add(HASH_INIT, token, tkl);
+}
+
+static void pending_start(struct coap_server *server,
+			  struct coap_server_pending *p, uint16_t id,
+			  const struct sockaddr *addr, bool confirmable)
+{
+	p->pending.id = id;
+	memcpy(&p->pending.addr, addr, addr_len(addr));
+	p->pending.t0 = k_uptime_get_32();
+
+	if (confirmable) {
+		p->pending.retries = CONFIG_COAP_MAX_RETRANSMIT;
+		(void)coap_pending_cycle(&p->pending);
+	} else {
+		p->acked = true;
+		p->pending.timeout = NON_LIFETIME_MS;
+	}
+
+	sys_slist_prepend(&server->pending_ids[id & HASH_MASK], &p->id_node);
+
+	if (p->reply) {
+		sys_slist_prepend(&server->pending_tokens[
+					  token_hash(p->token, p->tkl) &
+					  HASH_MASK],
+				  &p->token_node);
+	}
+
+	wheel_add(server, p);
+}
+
+static void pending_free(struct coap_server *server,
+			 struct coap_server_pending *p)
+{
+	wheel_remove(server, p);
+
+	(void)sys_slist_find_and_remove(
+		&server->pending_ids[p->pending.id & HASH_MASK], &p->id_node);
+
+	if (p->reply) {
+		(void)sys_slist_find_and_remove(
+			&server->pending_tokens[token_hash(p->token, p->tkl) &
+						HASH_MASK],
+			&p->token_node);
+		p->reply = NULL;
+	}
+
+	if (p->observer) {
+		p->observer->pending = NULL;
+		p->observer = NULL;
+	}
+
+	sys_slist_prepend(&server->free_pendings, &p->id_node);
+}
+
+static struct coap_server_pending *pending_find_by_id(struct coap_server *server,
+						      uint16_t id,
+						      const struct sockaddr *addr)
+{
+	struct coap_server_pending *p;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&server->pending_ids[id & HASH_MASK], p,
+				     id_node) {
+		if (p->pending.id == id && addr_equal(&p->pending.addr, addr)) {
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+static struct coap_server_pending *pending_find_by_token(
+	struct coap_server *server, const uint8_t *token, uint8_t tkl,
+	const struct sockaddr *addr)
+{
+	struct coap_server_pending *p;
+	uint32_t hash = token_hash(token, tkl);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&server->pending_tokens[hash & HASH_MASK],
+				     p, token_node) {
+		if (p->tkl == tkl && memcmp(p->token, token, tkl) == 0 &&
+		    addr_equal(&p->pending.addr, addr)) {
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+static void reply_done(struct coap_server *server,
+		       struct coap_server_pending *p,
+		       const struct coap_packet *response)
+{
+	coap_server_reply_t reply = p->reply;
+	void *user_data = p->user_data;
+	struct sockaddr from;
+
+	memcpy(&from, &p->pending.addr, sizeof(from));
+
+	/* Free the slot first, the callback can send a new request */
+	pending_free(server, p);
+
+	reply(response, &from, user_data);
+}
+
+/* Observers */
+
+static uint32_t observer_hash(const struct sockaddr *addr,
+			      const struct coap_server_resource *resource)
+{
+	uint32_t hash = hash_add(HASH_INIT, &resource, sizeof(resource));
+
+	return addr_hash_add(hash, addr);
+}
+
+static struct coap_server_observer *observer_find(
+	struct coap_server *server, const struct sockaddr *addr,
+	const struct coap_server_resource *resource)
+{
+	struct coap_server_observer *o;
+	uint32_t hash = observer_hash(addr, resource);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&server->observers[hash & HASH_MASK], o,
+				     hash_node) {
+		if (o->resource == resource && addr_equal(&o->addr, addr)) {
+			return o;
+		}
+	}
+
+	return NULL;
+}
+
+/* A new registration of the same endpoint replaces the previous one, as
+ * told in RFC 7641 section 4.1.
+ */
+static struct coap_server_observer *observer_add(
+	struct coap_server *server, struct coap_server_resource *resource,
+	const struct coap_packet *request, const struct sockaddr *addr)
+{
+	struct coap_server_observer *o;
+	sys_snode_t *node;
+
+	o = observer_find(server, addr, resource);
+	if (o == NULL) {
+		node = sys_slist_get(&server->free_observers);
+		if (node == NULL) {
+			return NULL;
+		}
+
+		o = CONTAINER_OF(node, struct coap_server_observer, hash_node);
+		memset(o, 0, sizeof(*o));
+
+		o->resource = resource;
+		memcpy(&o->addr, addr, addr_len(addr));
+
+		sys_slist_prepend(&server->observers[
+					  observer_hash(addr, resource) &
+					  HASH_MASK],
+				  &o->hash_node);
+		sys_slist_append(&resource->observers, &o->node);
+	}
+
+	o->tkl = coap_header_get_token(request, o->token);
+
+	return o;
+}
+
+static void observer_remove(struct coap_server *server,
+			    struct coap_server_observer *o)
+{
+	NET_DBG("Removing observer %p", o);
+
+	if (o->pending) {
+		pending_free(server, o->pending);
+	}
+
+	(void)sys_slist_find_and_remove(&o->resource->observers, &o->node);
+	(void)sys_slist_find_and_remove(
+		&server->observers[observer_hash(&o->addr, o->resource) &
+				   HASH_MASK],
+		&o->hash_node);
+
+	o->resource = NULL;
+
+	sys_slist_prepend(&server->free_observers, &o->hash_node);
+}
+
+/* Build the part of a notification following the token in the send
+ * buffer. It is the same for all the observers of the resource, only the
+ * header and the token are sent separately for each of them.
+ */
+static int notification_build(struct coap_server *server,
+			      struct coap_server_resource *resource,
+			      size_t *len)
+{
+	struct coap_packet cpkt;
+	bool more;
+	int ret;
+
+	ret = resource_read(server, resource, NULL, 0, block_szx(), &more);
+	if (ret < 0) {
+		return ret;
+	}
+
+	*len = ret;
+
+	ret = coap_packet_init(&cpkt, server->tx_buf, sizeof(server->tx_buf),
+			       COAP_VERSION_1, COAP_TYPE_NON_CON, 0, NULL,
+			       COAP_RESPONSE_CODE_CONTENT, 0);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = append_representation(server, &cpkt, resource, resource->age, 0,
+				    block_szx(), more, *len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	*len = cpkt.offset;
+
+	return 0;
+}
+
+static int notification_send(struct coap_server *server,
+			     struct coap_server_observer *o, uint8_t type,
+			     size_t len)
+{
+	uint8_t header[BASIC_HEADER_SIZE + COAP_TOKEN_MAX_LEN];
+	struct iovec iov[2];
+	struct msghdr msg;
+	ssize_t ret;
+
+	/* Same layout as written by coap_packet_init() */
+	header[0] = (COAP_VERSION_1 << 6) | (type << 4) | o->tkl;
+	header[1] = COAP_RESPONSE_CODE_CONTENT;
+	sys_put_be16(o->id, &header[2]);
+	memcpy(&header[BASIC_HEADER_SIZE], o->token, o->tkl);
+
+	iov[0].iov_base = header;
+	iov[0].iov_len = BASIC_HEADER_SIZE + o->tkl;
+	iov[1].iov_base = &server->tx_buf[BASIC_HEADER_SIZE];
+	iov[1].iov_len = len - BASIC_HEADER_SIZE;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = &o->addr;
+	msg.msg_namelen = addr_len(&o->addr);
+	msg.msg_iov = iov;
+	msg.msg_iovlen = ARRAY_SIZE(iov);
+
+	ret = zsock_sendmsg(server->sock, &msg, 0);
+	if (ret < 0) {
+		NET_DBG("Cannot send notification (%d)", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int observer_notify(struct coap_server *server,
+			   struct coap_server_observer *o, size_t len)
+{
+	struct coap_server_pending *p = NULL;
+	uint8_t type = COAP_TYPE_NON_CON;
+	int ret;
+
+	o->id = coap_next_id();
+	o->stale = false;
+
+	if (++o->non_count >= CONFIG_COAP_SERVER_OBSERVE_CON_INTERVAL) {
+		/* Without a free slot the check is left to a later
+		 * notification.
+		 */
+		p = pending_alloc(server);
+		if (p) {
+			type = COAP_TYPE_CON;
+			o->non_count = 0;
+		}
+	}
+
+	ret = notification_send(server, o, type, len);
+	if (ret < 0) {
+		if (p) {
+			sys_slist_prepend(&server->free_pendings, &p->id_node);
+		}
+
+		return ret;
+	}
+
+	if (p) {
+		p->observer = o;
+		o->pending = p;
+		pending_start(server, p, o->id, &o->addr, true);
+	}
+
+	return 0;
+}
+
+/* A non-confirmable notification is not tracked, so finding the observer
+ * rejecting one takes a walk over all of them. This only happens when a
+ * client has lost interest without deregistering.
+ */
+static void observer_reset(struct coap_server *server, uint16_t id,
+			   const struct sockaddr *addr)
+{
+	struct coap_server_observer *o;
+	size_t i;
+
+	for (i = 0; i < server->config->observer_count; i++) {
+		o = &server->config->observers[i];
+
+		if (o->resource && o->id == id && addr_equal(&o->addr, addr)) {
+			observer_remove(server, o);
+			return;
+		}
+	}
+}
+
+static void pending_expired(struct coap_server *server,
+			    struct coap_server_pending *p)
+{
+	struct coap_server_observer *o = p->observer;
+	size_t len;
+	int ret;
+
+	/* Count the next timeout from now even if the wheel was late */
+	p->pending.t0 = k_uptime_get_32() - p->pending.timeout;
+
+	if (p->acked || !coap_pending_cycle(&p->pending)) {
+		if (o) {
+			NET_DBG("Observer %p not responding", o);
+			observer_remove(server, o);
+		} else {
+			reply_done(server, p, NULL);
+		}
+
+		return;
+	}
+
+	if (o) {
+		/* Retransmit the current state of the resource, as allowed
+		 * by RFC 7641 section 4.5.2.
+		 */
+		ret = notification_build(server, o->resource, &len);
+		if (ret == 0) {
+			o->stale = false;
+			(void)notification_send(server, o, COAP_TYPE_CON, len);
+		}
+	} else {
+		(void)server_send(server, p->pending.data, p->pending.len,
+				  &p->pending.addr);
+	}
+
+	wheel_add(server, p);
+}
+
+static void wheel_expire(struct coap_server *server)
+{
+	uint32_t now = k_uptime_get_32();
+	uint32_t tick = now >> WHEEL_TICK_SHIFT;
+	struct coap_server_pending *p, *next;
+	sys_dlist_t *slot;
+
+	if ((int32_t)(tick - server->wheel_tick) > COAP_SERVER_WHEEL_SLOTS) {
+		server->wheel_tick = tick - COAP_SERVER_WHEEL_SLOTS;
+	}
+
+	/* Only the ticks that are over are handled, so that all the entries
+	 * of their slots due in this round have expired.
+	 */
+	while ((int32_t)(server->wheel_tick - tick) < 0) {
+		slot = &server->wheel[server->wheel_tick %
+				      COAP_SERVER_WHEEL_SLOTS];
+
+		SYS_DLIST_FOR_EACH_CONTAINER_SAFE(slot, p, next, wheel_node) {
+			if ((int32_t)(now - pending_expiry(p)) < 0) {
+				continue;
+			}
+
+			wheel_remove(server, p);
+			pending_expired(server, p);
+		}
+
+		server->wheel_tick++;
+	}
+}
+
+static int server_poll_timeout(struct coap_server *server)
+{
+	uint32_t now = k_uptime_get_32();
+	uint32_t tick;
+	int i;
+
+	if (server->wheel_count == 0) {
+		return SERVER_POLL_INTERVAL_MS;
+	}
+
+	for (i = 0; i < COAP_SERVER_WHEEL_SLOTS - 1; i++) {
+		tick = server->wheel_tick + i;
+
+		if (!sys_dlist_is_empty(
+			    &server->wheel[tick % COAP_SERVER_WHEEL_SLOTS])) {
+			break;
+		}
+	}
+
+	tick = server->wheel_tick + i + 1;
+
+	return CLAMP((int32_t)((tick << WHEEL_TICK_SHIFT) - now), 0,
+		     SERVER_POLL_INTERVAL_MS);
+}
+
+/* Requests */
+
+static int response_init(struct coap_server *server, struct coap_packet *cpkt,
+			 const struct coap_packet *request, uint8_t code)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+
+	if (coap_header_get_type(request) == COAP_TYPE_CON) {
+		return coap_ack_init(cpkt, request, server->tx_buf,
+				     sizeof(server->tx_buf), code);
+	}
+
+	tkl = coap_header_get_token(request, token);
+
+	return coap_packet_init(cpkt, server->tx_buf, sizeof(server->tx_buf),
+				COAP_VERSION_1, COAP_TYPE_NON_CON, tkl, token,
+				code, coap_next_id());
+}
+
+static int respond(struct coap_server *server,
+		   const struct coap_packet *request,
+		   const struct sockaddr *addr, uint8_t code)
+{
+	struct coap_packet response;
+	int ret;
+
+	ret = response_init(server, &response, request, code);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return server_send(server, response.data, response.offset, addr);
+}
+
+static int respond_block1(struct coap_server *server,
+			  const struct coap_packet *request,
+			  const struct sockaddr *addr, uint8_t code,
+			  unsigned int block1)
+{
+	struct coap_packet response;
+	int ret;
+
+	ret = response_init(server, &response, request, code);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = coap_append_option_int(&response, COAP_OPTION_BLOCK1, block1);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return server_send(server, response.data, response.offset, addr);
+}
+
+static int handle_get(struct coap_server *server,
+		      struct coap_server_resource *resource,
+		      const struct coap_packet *request,
+		      const struct sockaddr *addr)
+{
+	struct coap_server_observer *o = NULL;
+	struct coap_packet response;
+	uint8_t szx = block_szx();
+	uint32_t num = 0U;
+	int block2, observe;
+	bool more;
+	int len;
+	int ret;
+
+	block2 = coap_get_option_int(request, COAP_OPTION_BLOCK2);
+	if (block2 >= 0) {
+		if (GET_BLOCK_SIZE(block2) == 7) {
+			return respond(server, request, addr,
+				       COAP_RESPONSE_CODE_BAD_OPTION);
+		}
+
+		/* Use the block size asked by the client if it is smaller,
+		 * otherwise keep the asked offset with our block size.
+		 */
+		if (GET_BLOCK_SIZE(block2) <= szx) {
+			szx = GET_BLOCK_SIZE(block2);
+			num = GET_BLOCK_NUM(block2);
+		} else {
+			num = GET_BLOCK_NUM(block2) <<
+				(GET_BLOCK_SIZE(block2) - szx);
+		}
+	}
+
+	len = resource_read(server, resource, request, num, szx, &more);
+	if (len < 0) {
+		NET_DBG("Cannot read resource (%d)", len);
+		return respond(server, request, addr,
+			       COAP_RESPONSE_CODE_INTERNAL_ERROR);
+	}
+
+	observe = coap_get_option_int(request, COAP_OPTION_OBSERVE);
+	if (observe == 0 && resource->observable && num == 0U) {
+		o = observer_add(server, resource, request, addr);
+		if (o == NULL) {
+			NET_DBG("No free observer slot");
+		}
+	} else if (observe == 1) {
+		o = observer_find(server, addr, resource);
+		if (o) {
+			observer_remove(server, o);
+			o = NULL;
+		}
+	}
+
+	ret = response_init(server, &response, request,
+			    COAP_RESPONSE_CODE_CONTENT);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = append_representation(server, &response, resource,
+				    o ? resource->age : -1, num, szx, more,
+				    len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return server_send(server, response.data, response.offset, addr);
+}
+
+static struct coap_server_block1 *block1_find(struct coap_server *server,
+					      const struct sockaddr *addr,
+					      const struct coap_server_resource *resource)
+{
+	struct coap_server_block1 *transfer;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(server->transfers); i++) {
+		transfer = &server->transfers[i];
+
+		if (transfer->resource == resource &&
+		    addr_equal(&transfer->addr, addr)) {
+			return transfer;
+		}
+	}
+
+	return NULL;
+}
+
+static struct coap_server_block1 *block1_get(struct coap_server *server,
+					     const struct sockaddr *addr,
+					     struct coap_server_resource *resource)
+{
+	struct coap_server_block1 *transfer, *oldest;
+	int i;
+
+	transfer = block1_find(server, addr, resource);
+	if (transfer) {
+		return transfer;
+	}
+
+	oldest = &server->transfers[0];
+
+	for (i = 0; i < ARRAY_SIZE(server->transfers); i++) {
+		transfer = &server->transfers[i];
+
+		if (transfer->resource == NULL) {
+			oldest = transfer;
+			break;
+		}
+
+		if ((int32_t)(transfer->last_used - oldest->last_used) < 0) {
+			oldest = transfer;
+		}
+	}
+
+	oldest->resource = resource;
+	memcpy(&oldest->addr, addr, addr_len(addr));
+
+	return oldest;
+}
+
+static uint8_t write_code(int ret, uint8_t default_code)
+{
+	if (ret < 0) {
+		return COAP_RESPONSE_CODE_INTERNAL_ERROR;
+	}
+
+	return ret > 0 ? ret : default_code;
+}
+
+static int handle_write(struct coap_server *server,
+			struct coap_server_resource *resource,
+			coap_server_write_t write,
+			const struct coap_packet *request,
+			const struct sockaddr *addr)
+{
+	struct coap_server_block1 *transfer;
+	const uint8_t *payload;
+	uint16_t len;
+	uint16_t id = coap_header_get_id(request);
+	uint32_t num;
+	size_t offset;
+	uint8_t szx;
+	bool more;
+	int block1;
+	int ret;
+
+	payload = coap_packet_get_payload(request, &len);
+
+	block1 = coap_get_option_int(request, COAP_OPTION_BLOCK1);
+	if (block1 < 0) {
+		ret = write(resource, request, 0, payload, len, true);
+
+		return respond(server, request, addr,
+			       write_code(ret, COAP_RESPONSE_CODE_CHANGED));
+	}
+
+	szx = GET_BLOCK_SIZE(block1);
+	num = GET_BLOCK_NUM(block1);
+	more = GET_MORE(block1);
+
+	if (szx > block_szx()) {
+		/* Ask for smaller blocks, RFC 7959 section 2.9.3 */
+		return respond_block1(server, request, addr,
+				      COAP_RESPONSE_CODE_REQUEST_TOO_LARGE,
+				      block_szx());
+	}
+
+	offset = num << (szx + 4);
+	transfer = block1_find(server, addr, resource);
+
+	if (num == 0U) {
+		transfer = block1_get(server, addr, resource);
+		transfer->offset = 0;
+	} else if (transfer && transfer->id == id) {
+		/* Our acknowledgment was lost, the block was written
+		 * already.
+		 */
+		return respond_block1(server, request, addr,
+				      COAP_RESPONSE_CODE_CONTINUE, block1);
+	} else if (transfer == NULL || transfer->offset != offset) {
+		NET_DBG("Block %u out of order", num);
+		return respond(server, request, addr,
+			       COAP_RESPONSE_CODE_INCOMPLETE);
+	}
+
+	ret = write(resource, request, offset, payload, len, !more);
+	if (ret < 0 || !more) {
+		transfer->resource = NULL;
+
+		if (ret < 0) {
+			return respond(server, request, addr,
+				       COAP_RESPONSE_CODE_INTERNAL_ERROR);
+		}
+
+		return respond_block1(server, request, addr,
+				      write_code(ret,
+						 COAP_RESPONSE_CODE_CHANGED),
+				      block1);
+	}
+
+	transfer->offset = offset + len;
+	transfer->id = id;
+	transfer->last_used = k_uptime_get_32();
+
+	return respond_block1(server, request, addr,
+			      COAP_RESPONSE_CODE_CONTINUE, block1);
+}
+
+static int handle_delete(struct coap_server *server,
+			 struct coap_server_resource *resource,
+			 const struct coap_packet *request,
+			 const struct sockaddr *addr)
+{
+	int ret;
+
+	ret = resource->del(resource, request);
+
+	return respond(server, request, addr,
+		       write_code(ret, COAP_RESPONSE_CODE_DELETED));
+}
+
+static int handle_request(struct coap_server *server,
+			  const struct coap_packet *request,
+			  const struct sockaddr *addr)
+{
+	struct coap_server_resource *resource;
+
+	resource = resource_find(server, request);
+	if (resource == NULL) {
+		return respond(server, request, addr,
+			       COAP_RESPONSE_CODE_NOT_FOUND);
+	}
+
+	switch (coap_header_get_code(request)) {
+	case COAP_METHOD_GET:
+		if (resource->get) {
+			return handle_get(server, resource, request, addr);
+		}
+
+		break;
+	case COAP_METHOD_PUT:
+		if (resource->put) {
+			return handle_write(server, resource, resource->put,
+					    request, addr);
+		}
+
+		break;
+	case COAP_METHOD_POST:
+		if (resource->post) {
+			return handle_write(server, resource, resource->post,
+					    request, addr);
+		}
+
+		break;
+	case COAP_METHOD_DELETE:
+		if (resource->del) {
+			return handle_delete(server, resource, request, addr);
+		}
+
+		break;
+	default:
+		break;
+	}
+
+	return respond(server, request, addr, COAP_RESPONSE_CODE_NOT_ALLOWED);
+}
+
+/* Acknowledgments and resets */
+static void handle_ack(struct coap_server *server,
+		       const struct coap_packet *cpkt,
+		       const struct sockaddr *addr)
+{
+	uint8_t type = coap_header_get_type(cpkt);
+	struct coap_server_observer *o;
+	struct coap_server_pending *p;
+	size_t len;
+
+	p = pending_find_by_id(server, coap_header_get_id(cpkt), addr);
+	if (p == NULL) {
+		if (type == COAP_TYPE_RESET) {
+			observer_reset(server, coap_header_get_id(cpkt), addr);
+		}
+
+		return;
+	}
+
+	o = p->observer;
+	if (o) {
+		if (type == COAP_TYPE_RESET) {
+			observer_remove(server, o);
+			return;
+		}
+
+		pending_free(server, p);
+
+		/* Send the changes made while the notification was not
+		 * acknowledged.
+		 */
+		if (o->stale && notification_build(server, o->resource,
+						   &len) == 0) {
+			(void)observer_notify(server, o, len);
+		}
+
+		return;
+	}
+
+	if (type == COAP_TYPE_RESET) {
+		reply_done(server, p, NULL);
+		return;
+	}
+
+	if (coap_header_get_code(cpkt) == COAP_CODE_EMPTY) {
+		if (!p->acked) {
+			/* The response comes separately */
+			wheel_remove(server, p);
+			p->acked = true;
+			p->pending.t0 = k_uptime_get_32();
+			p->pending.timeout = EXCHANGE_LIFETIME_MS;
+			wheel_add(server, p);
+		}
+
+		return;
+	}
+
+	reply_done(server, p, cpkt);
+}
+
+/* Responses sent separately from the acknowledgment */
+static void handle_response(struct coap_server *server,
+			    const struct coap_packet *cpkt,
+			    const struct sockaddr *addr)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	struct coap_server_pending *p;
+	uint8_t tkl;
+
+	tkl = coap_header_get_token(cpkt, token);
+	p = pending_find_by_token(server, token, tkl, addr);
+
+	if (coap_header_get_type(cpkt) == COAP_TYPE_CON) {
+		(void)send_empty(server,
+				 p ? COAP_TYPE_ACK : COAP_TYPE_RESET,
+				 coap_header_get_id(cpkt), addr);
+	}
+
+	if (p) {
+		reply_done(server, p, cpkt);
+	}
+}
+
+static void handle_message(struct coap_server *server, size_t len,
+			   const struct sockaddr *addr)
+{
+	struct coap_packet cpkt;
+	uint8_t type, code;
+	int ret;
+
+	ret = coap_packet_parse(&cpkt, server->rx_buf, len, NULL, 0);
+	if (ret < 0) {
+		NET_DBG("Invalid message (%d)", ret);
+		return;
+	}
+
+	if (coap_header_get_version(&cpkt) != COAP_VERSION_1) {
+		return;
+	}
+
+	type = coap_header_get_type(&cpkt);
+	code = coap_header_get_code(&cpkt);
+
+	if (type == COAP_TYPE_ACK || type == COAP_TYPE_RESET) {
+		handle_ack(server, &cpkt, addr);
+	} else if (code == COAP_CODE_EMPTY) {
+		/* CoAP ping */
+		if (type == COAP_TYPE_CON) {
+			(void)send_empty(server, COAP_TYPE_RESET,
+					 coap_header_get_id(&cpkt), addr);
+		}
+	} else if (!(code & ~COAP_REQUEST_MASK)) {
+		(void)handle_request(server, &cpkt, addr);
+	} else {
+		handle_response(server, &cpkt, addr);
+	}
+}
+
+static void server_recv(struct coap_server *server)
+{
+	struct sockaddr addr;
+	socklen_t addrlen;
+	ssize_t len;
+
+	while (true) {
+		addrlen = sizeof(addr);
+
+		len = zsock_recvfrom(server->sock, server->rx_buf,
+				     sizeof(server->rx_buf), ZSOCK_MSG_DONTWAIT,
+				     &addr, &addrlen);
+		if (len < 0) {
+			if (errno != EAGAIN) {
+				NET_DBG("Cannot receive (%d)", errno);
+			}
+
+			return;
+		}
+
+		k_mutex_lock(&server->lock, K_FOREVER);
+		handle_message(server, len, &addr);
+		k_mutex_unlock(&server->lock);
+	}
+}
+
+static void server_loop(void *p1, void *p2, void *p3)
+{
+	struct coap_server *server = p1;
+	struct zsock_pollfd fds;
+	int timeout;
+	int ret;
+
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (server->running) {
+		fds.fd = server->sock;
+		fds.events = ZSOCK_POLLIN;
+		fds.revents = 0;
+
+		k_mutex_lock(&server->lock, K_FOREVER);
+		timeout = server_poll_timeout(server);
+		k_mutex_unlock(&server->lock);
+
+		ret = zsock_poll(&fds, 1, timeout);
+		if (ret < 0) {
+			NET_ERR("Poll failed (%d)", errno);
+			break;
+		}
+
+		if (fds.revents & ZSOCK_POLLIN) {
+			server_recv(server);
+		}
+
+		k_mutex_lock(&server->lock, K_FOREVER);
+		wheel_expire(server);
+		k_mutex_unlock(&server->lock);
+	}
+}
+
+static void server_init_tables(struct coap_server *server,
+			       const struct coap_server_config *config)
+{
+	size_t i;
+
+	for (i = 0; i < CONFIG_COAP_SERVER_HASH_SIZE; i++) {
+		sys_slist_init(&server->resources[i]);
+		sys_slist_init(&server->observers[i]);
+		sys_slist_init(&server->pending_ids[i]);
+		sys_slist_init(&server->pending_tokens[i]);
+	}
+
+	for (i = 0; i < COAP_SERVER_WHEEL_SLOTS; i++) {
+		sys_dlist_init(&server->wheel[i]);
+	}
+
+	server->wheel_tick = k_uptime_get_32() >> WHEEL_TICK_SHIFT;
+	server->wheel_count = 0;
+
+	for (i = 0; i < config->resource_count; i++) {
+		resource_add(server, &config->resources[i]);
+	}
+
+	sys_slist_init(&server->free_observers);
+
+	for (i = 0; i < config->observer_count; i++) {
+		memset(&config->observers[i], 0, sizeof(config->observers[i]));
+		sys_slist_append(&server->free_observers,
+				 &config->observers[i].hash_node);
+	}
+
+	sys_slist_init(&server->free_pendings);
+
+	for (i = 0; i < config->pending_count; i++) {
+		memset(&config->pendings[i], 0, sizeof(config->pendings[i]));
+		sys_slist_append(&server->free_pendings,
+				 &config->pendings[i].id_node);
+	}
+
+	memset(server->transfers, 0, sizeof(server->transfers));
+}
+
+int coap_server_start(struct coap_server *server,
+		      const struct coap_server_config *config)
+{
+	struct sockaddr addr;
+	socklen_t addrlen;
+	int ret;
+
+	if (server == NULL || config == NULL ||
+	    (config->resource_count > 0 && config->resources == NULL) ||
+	    (config->observer_count > 0 && config->observers == NULL) ||
+	    (config->pending_count > 0 && config->pendings == NULL)) {
+		return -EINVAL;
+	}
+
+	if (server->running) {
+		return -EALREADY;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && config->family == AF_INET6) {
+		net_sin6(&addr)->sin6_family = AF_INET6;
+		net_sin6(&addr)->sin6_port = htons(config->port);
+		addrlen = sizeof(struct sockaddr_in6);
+	} else if (IS_ENABLED(CONFIG_NET_IPV4) && config->family == AF_INET) {
+		net_sin(&addr)->sin_family = AF_INET;
+		net_sin(&addr)->sin_port = htons(config->port);
+		addrlen = sizeof(struct sockaddr_in);
+	} else {
+		return -EAFNOSUPPORT;
+	}
+
+	server->sock = zsock_socket(config->family, SOCK_DGRAM, IPPROTO_UDP);
+	if (server->sock < 0) {
+		return -errno;
+	}
+
+	ret = zsock_bind(server->sock, &addr, addrlen);
+	if (ret < 0) {
+		ret = -errno;
+		(void)zsock_close(server->sock);
+		server->sock = -1;
+
+		return ret;
+	}
+
+	server->config = config;
+	k_mutex_init(&server->lock);
+	server_init_tables(server, config);
+
+	server->running = true;
+
+	k_thread_create(&server->thread, server->stack,
+			K_KERNEL_STACK_SIZEOF(server->stack), server_loop,
+			server, NULL, NULL, THREAD_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&server->thread, "coap_server");
+
+	NET_DBG("Serving %zu resources on port %u", config->resource_count,
+		config->port);
+
+	return 0;
+}
+
+int coap_server_stop(struct coap_server *server)
+{
+	struct coap_server_pending *p;
+	size_t i;
+
+	if (server == NULL) {
+		return -EINVAL;
+	}
+
+	if (!server->running) {
+		return -EALREADY;
+	}
+
+	server->running = false;
+
+	(void)k_thread_join(&server->thread, K_FOREVER);
+
+	k_mutex_lock(&server->lock, K_FOREVER);
+
+	for (i = 0; i < server->config->pending_count; i++) {
+		p = &server->config->pendings[i];
+
+		if (p->reply) {
+			reply_done(server, p, NULL);
+		}
+	}
+
+	(void)zsock_close(server->sock);
+	server->sock = -1;
+
+	k_mutex_unlock(&server->lock);
+
+	return 0;
+}
+
+int coap_server_notify(struct coap_server *server,
+		       struct coap_server_resource *resource)
+{
+	struct coap_server_observer *o, *next;
+	size_t len;
+	int count = 0;
+	int ret;
+
+	if (server == NULL || resource == NULL || resource->get == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&server->lock, K_FOREVER);
+
+	if (!server->running) {
+		ret = -ENOTCONN;
+		goto out;
+	}
+
+	if (sys_slist_is_empty(&resource->observers)) {
+		ret = 0;
+		goto out;
+	}
+
+	resource->age = (resource->age + 1) & OBSERVE_MAX;
+
+	ret = notification_build(server, resource, &len);
+	if (ret < 0) {
+		NET_DBG("Cannot read resource (%d)", ret);
+		goto out;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&resource->observers, o, next,
+					  node) {
+		if (o->pending) {
+			/* Sent once the confirmable notification in flight
+			 * is acknowledged.
+			 */
+			o->stale = true;
+			continue;
+		}
+
+		if (observer_notify(server, o, len) == 0) {
+			count++;
+		}
+	}
+
+	ret = count;
+
+out:
+	k_mutex_unlock(&server->lock);
+
+	return ret;
+}
+
+int coap_server_request(struct coap_server *server,
+			const struct coap_packet *request,
+			const struct sockaddr *addr, socklen_t addr_len,
+			coap_server_reply_t reply, void *user_data)
+{
+	struct coap_server_pending *p;
+	int ret;
+
+	if (server == NULL || request == NULL || addr == NULL ||
+	    reply == NULL || addr_len > sizeof(struct sockaddr)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&server->lock, K_FOREVER);
+
+	if (!server->running) {
+		ret = -ENOTCONN;
+		goto out;
+	}
+
+	p = pending_alloc(server);
+	if (p == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	p->reply = reply;
+	p->user_data = user_data;
+	p->tkl = coap_header_get_token(request, p->token);
+	p->pending.data = request->data;
+	p->pending.len = request->offset;
+
+	pending_start(server, p, coap_header_get_id(request), addr,
+		      coap_header_get_type(request) == COAP_TYPE_CON);
+
+	ret = server_send(server, request->data, request->offset, addr);
+	if (ret < 0) {
+		pending_free(server, p);
+	}
+
+out:
+	k_mutex_unlock(&server->lock);
+
+	return ret;
+}
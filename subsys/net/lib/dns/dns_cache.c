@@ -0,0 +1,272 @@
+/** @file
+ * @brief DNS resolver answer cache
+ *
+ * Keeps the addresses and the negative answers received by the resolver
+ * for the time given in the DNS response.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_dns_resolve, CONFIG_DNS_RESOLVER_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/dns_resolve.h>
+#include "dns_internal.h"
+
+struct dns_cache_entry {
+	/** Resolved address, not used by negative entries */
+	struct dns_addrinfo info;
+
+	/** Uptime in ms when the entry expires */
+	int64_t expiry;
+
+	/** Query type */
+	enum dns_query_type type;
+
+	/** 0 for an address, DNS_EAI_* status for a negative answer */
+	int status;
+
+	/** Resolved name, empty if the entry is not in use */
+	char query[CONFIG_DNS_RESOLVER_CACHE_NAME_LEN + 1];
+};
+
+static struct dns_cache_entry cache[CONFIG_DNS_RESOLVER_CACHE_MAX_ENTRIES];
+static struct dns_resolve_cache_stats cache_stats;
+
+/* The resolver calls the cache with its context lock held, so this lock
+ * must never be held while calling back to the resolver.
+ */
+static K_MUTEX_DEFINE(lock);
+
+static inline bool entry_in_use(const struct dns_cache_entry *entry)
+{
+	return entry->query[0] != '\0';
+}
+
+static bool entry_match(const struct dns_cache_entry *entry,
+			const char *query, enum dns_query_type type)
+{
+	/* Names are case insensitive, RFC 1035 ch. 2.3.3 */
+	return entry_in_use(entry) && entry->type == type &&
+		strncasecmp(entry->query, query, sizeof(entry->query)) == 0;
+}
+
+static bool entry_addr_match(const struct dns_cache_entry *entry,
+			     const struct dns_addrinfo *info)
+{
+	return entry->info.ai_family == info->ai_family &&
+		entry->info.ai_addrlen == info->ai_addrlen &&
+		memcmp(&entry->info.ai_addr, &info->ai_addr,
+		       info->ai_addrlen) == 0;
+}
+
+/* Must be invoked with the lock held */
+static void cache_expire(int64_t now)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (entry_in_use(&cache[i]) && cache[i].expiry <= now) {
+			cache[i].query[0] = '\0';
+		}
+	}
+}
+
+/* Returns a free entry, or the one that expires first if the cache is full.
+ *
+ * Must be invoked with the lock held.
+ */
+static struct dns_cache_entry *cache_get_free(void)
+{
+	struct dns_cache_entry *oldest = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!entry_in_use(&cache[i])) {
+			return &cache[i];
+		}
+
+		if (!oldest || cache[i].expiry < oldest->expiry) {
+			oldest = &cache[i];
+		}
+	}
+
+	NET_DBG("Evicting %s type %d", oldest->query, oldest->type);
+
+	cache_stats.evictions++;
+
+	return oldest;
+}
+
+static int cache_insert(const char *query, enum dns_query_type type,
+			int status, const struct dns_addrinfo *info,
+			uint32_t ttl)
+{
+	struct dns_cache_entry *entry = NULL;
+	size_t len;
+	int64_t now;
+	int i;
+
+	/* Zero TTL means that the answer is only good for the transaction
+	 * in progress, RFC 1035 ch. 3.2.1.
+	 */
+	if (ttl == 0U) {
+		return 0;
+	}
+
+	len = strlen(query);
+	if (len > CONFIG_DNS_RESOLVER_CACHE_NAME_LEN) {
+		return -ENAMETOOLONG;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	now = k_uptime_get();
+	cache_expire(now);
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!entry_match(&cache[i], query, type)) {
+			continue;
+		}
+
+		/* A positive answer replaces a negative one and vice versa */
+		if ((cache[i].status == 0) != (status == 0)) {
+			cache[i].query[0] = '\0';
+			continue;
+		}
+
+		if (status != 0 || entry_addr_match(&cache[i], info)) {
+			entry = &cache[i];
+		}
+	}
+
+	if (!entry) {
+		entry = cache_get_free();
+
+		memcpy(entry->query, query, len + 1);
+		entry->type = type;
+		entry->status = status;
+
+		if (info) {
+			memcpy(&entry->info, info, sizeof(entry->info));
+		} else {
+			(void)memset(&entry->info, 0, sizeof(entry->info));
+		}
+	}
+
+	ttl = MIN(ttl, CONFIG_DNS_RESOLVER_CACHE_MAX_TTL);
+	entry->expiry = now + (int64_t)ttl * MSEC_PER_SEC;
+
+	NET_DBG("Cached %s type %d status %d ttl %u", query, type, status, ttl);
+
+	k_mutex_unlock(&lock);
+
+	return 0;
+}
+
+int dns_cache_add(const char *query, enum dns_query_type type,
+		  const struct dns_addrinfo *info, uint32_t ttl)
+{
+	return cache_insert(query, type, 0, info, ttl);
+}
+
+int dns_cache_add_negative(const char *query, enum dns_query_type type,
+			   int status, uint32_t ttl)
+{
+	if (status >= 0) {
+		return -EINVAL;
+	}
+
+	return cache_insert(query, type, status, NULL, ttl);
+}
+
+int dns_cache_find(const char *query, enum dns_query_type type,
+		   struct dns_addrinfo *info, size_t count)
+{
+	int found = 0;
+	int i;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	cache_expire(k_uptime_get());
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!entry_match(&cache[i], query, type)) {
+			continue;
+		}
+
+		if (cache[i].status != 0) {
+			found = cache[i].status;
+			break;
+		}
+
+		if (found < count) {
+			memcpy(&info[found], &cache[i].info, sizeof(*info));
+			found++;
+		}
+	}
+
+	if (found > 0) {
+		cache_stats.hits++;
+	} else if (found < 0) {
+		cache_stats.negative_hits++;
+	} else {
+		cache_stats.misses++;
+	}
+
+	k_mutex_unlock(&lock);
+
+	return found;
+}
+
+void dns_cache_coalesced(void)
+{
+	k_mutex_lock(&lock, K_FOREVER);
+	cache_stats.coalesced++;
+	k_mutex_unlock(&lock);
+}
+
+void dns_resolve_cache_stats_get(struct dns_resolve_cache_stats *stats)
+{
+	int i;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	cache_expire(k_uptime_get());
+
+	cache_stats.entries = 0U;
+	cache_stats.size = ARRAY_SIZE(cache);
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (entry_in_use(&cache[i])) {
+			cache_stats.entries++;
+		}
+	}
+
+	memcpy(stats, &cache_stats, sizeof(*stats));
+
+	k_mutex_unlock(&lock);
+}
+
+void dns_resolve_cache_flush(void)
+{
+	int i;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		cache[i].query[0] = '\0';
+	}
+
+	k_mutex_unlock(&lock);
+}
@@ -18,3 +18,24 @@ int dns_validate_msg(struct dns_resolve_context *ctx,
 		     struct net_buf *dns_cname,
 		     uint16_t *query_hash);
 #endif
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/* Add an address to the answer cache, ttl is in seconds */
+int dns_cache_add(const char *query, enum dns_query_type type,
+		  const struct dns_addrinfo *info, uint32_t ttl);
+
+/* Add a negative answer, status is the DNS_EAI_* value given to the
+ * lookups that find it.
+ */
+int dns_cache_add_negative(const char *query, enum dns_query_type type,
+			   int status, uint32_t ttl);
+
+/* Returns the number of addresses copied to info, the status of a negative
+ * answer (< 0) or 0 if the name is not in the cache.
+ */
+int dns_cache_find(const char *query, enum dns_query_type type,
+		   struct dns_addrinfo *info, size_t count);
+
+/* Account a lookup that shares an in-flight query */
+void dns_cache_coalesced(void);
+#endif
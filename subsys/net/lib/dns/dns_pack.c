@@ -177,6 +177,60 @@ int dns_unpack_answer(struct dns_msg_t *dns_msg, int dname_ptr, uint32_t *ttl,
 	return 0;
 }
 
+int dns_unpack_soa_ttl(struct dns_msg_t *dns_msg, uint32_t *ttl)
+{
+	int count = dns_header_nscount(dns_msg->msg);
+	uint16_t offset = dns_msg->answer_offset;
+	uint32_t minimum;
+	uint16_t rdlength;
+	uint8_t *record;
+	int dname_len;
+	int rr_len;
+
+	while (count-- > 0) {
+		if (offset >= dns_msg->msg_size) {
+			return -EINVAL;
+		}
+
+		record = dns_msg->msg + offset;
+
+		dname_len = skip_fqdn(record, dns_msg->msg_size - offset);
+		if (dname_len < 0) {
+			return dname_len;
+		}
+
+		/* type + class + ttl + rdlength, see RFC 1035 ch. 4.1.3 */
+		rr_len = dname_len + DNS_COMMON_UINT_SIZE + DNS_COMMON_UINT_SIZE +
+			 DNS_TTL_LEN + DNS_RDLENGTH_LEN;
+		if (offset + rr_len > dns_msg->msg_size) {
+			return -EINVAL;
+		}
+
+		rdlength = dns_answer_rdlength(dname_len, record);
+		if (offset + rr_len + rdlength > dns_msg->msg_size) {
+			return -EINVAL;
+		}
+
+		/* MNAME and RNAME are followed by five 32 bit fields, the
+		 * last one of them is the MINIMUM, RFC 1035 ch. 3.3.13.
+		 */
+		if (dns_answer_type(dname_len, record) == DNS_RR_TYPE_SOA &&
+		    dns_answer_class(dname_len, record) == DNS_CLASS_IN &&
+		    rdlength >= 5 * sizeof(uint32_t)) {
+			minimum = ntohl(UNALIGNED_GET((uint32_t *)(record +
+							rr_len + rdlength -
+							sizeof(uint32_t))));
+			*ttl = MIN((uint32_t)dns_answer_ttl(dname_len, record),
+				   minimum);
+			return 0;
+		}
+
+		offset += rr_len + rdlength;
+	}
+
+	return -ENOENT;
+}
+
 int dns_unpack_response_header(struct dns_msg_t *msg, int src_id)
 {
 	uint8_t *dns_header;
@@ -336,9 +390,11 @@ int dns_unpack_response_query(struct dns_msg_t *dns_msg)
 	/* header already parsed + qname size */
 	offset = dns_msg->query_offset + qname_size;
 
-	/* 4 bytes more due to qtype and qclass */
+	/* 4 bytes more due to qtype and qclass. A negative response can
+	 * end right after the question.
+	 */
 	offset += DNS_QTYPE_LEN + DNS_QCLASS_LEN;
-	if (offset >= dns_msg->msg_size) {
+	if (offset > dns_msg->msg_size) {
 		return -ENOMEM;
 	}
 
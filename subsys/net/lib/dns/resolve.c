@@ -418,6 +418,70 @@ static inline void invoke_query_callback(int status,
 	}
 }
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/* Callback of a query whose own lookup was cancelled while other lookups
+ * were still waiting for its answer.
+ */
+static void orphan_query_cb(enum dns_resolve_status status,
+			    struct dns_addrinfo *info,
+			    void *user_data)
+{
+	ARG_UNUSED(status);
+	ARG_UNUSED(info);
+	ARG_UNUSED(user_data);
+}
+
+static inline bool query_is_orphan(struct dns_pending_query *pending_query)
+{
+	return pending_query->cb == orphan_query_cb &&
+		pending_query->query != NULL;
+}
+
+/* Must be invoked with context lock held */
+static bool query_has_followers(struct dns_resolve_context *ctx,
+				struct dns_pending_query *leader)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (ctx->queries[i].leader == leader) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Find a query in flight for the same name and type.
+ *
+ * Must be invoked with context lock held.
+ */
+static struct dns_pending_query *get_leader(struct dns_resolve_context *ctx,
+					    const char *query,
+					    enum dns_query_type type)
+{
+	struct dns_pending_query *pending_query;
+	int i;
+
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		pending_query = &ctx->queries[i];
+
+		if (!check_query_active(pending_query, false) ||
+		    pending_query->query == NULL ||
+		    pending_query->leader != NULL ||
+		    pending_query->query_type != type) {
+			continue;
+		}
+
+		if (strcmp(pending_query->query, query) == 0) {
+			return pending_query;
+		}
+	}
+
+	return NULL;
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
 /* Release a query slot reserved by get_cb_slot().
  *
  * Must be invoked with context lock held.
@@ -426,6 +490,9 @@ static inline void invoke_query_callback(int status,
  */
 static void release_query(struct dns_pending_query *pending_query)
 {
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct dns_pending_query *leader = pending_query->leader;
+#endif
 	int busy = k_work_cancel_delayable(&pending_query->timer);
 
 	/* If the work item is no longer pending we're done. */
@@ -439,7 +506,148 @@ static void release_query(struct dns_pending_query *pending_query)
 		 */
 		pending_query->query = NULL;
 	}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	pending_query->leader = NULL;
+
+	/* An orphan query is only kept for the lookups waiting for it */
+	if (leader && query_is_orphan(leader) &&
+	    !query_has_followers(pending_query->ctx, leader)) {
+		release_query(leader);
+	}
+#endif
+}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/* Give the final status to the lookups waiting for the answer of a query
+ * and release them.
+ *
+ * Must be invoked with context lock held.
+ */
+static void release_followers(struct dns_resolve_context *ctx,
+			      struct dns_pending_query *leader,
+			      int status)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (ctx->queries[i].leader != leader) {
+			continue;
+		}
+
+		invoke_query_callback(status, NULL, &ctx->queries[i]);
+		release_query(&ctx->queries[i]);
+	}
+}
+#endif
+
+/* Pass a result of a query to its callback and to the lookups waiting for
+ * the same answer.
+ *
+ * Must be invoked with context lock held.
+ */
+static void notify_query(struct dns_resolve_context *ctx, int status,
+			 struct dns_addrinfo *info,
+			 struct dns_pending_query *pending_query)
+{
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	int i;
+#endif
+
+	invoke_query_callback(status, info, pending_query);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	for (i = 0; i < CONFIG_DNS_NUM_CONCUR_QUERIES; i++) {
+		if (ctx->queries[i].leader == pending_query) {
+			invoke_query_callback(status, info, &ctx->queries[i]);
+		}
+	}
+#else
+	ARG_UNUSED(ctx);
+#endif
+}
+
+/* Give the final status to a query and release it.
+ *
+ * Must be invoked with context lock held.
+ */
+static void finish_query(struct dns_resolve_context *ctx, int status,
+			 struct dns_pending_query *pending_query)
+{
+	invoke_query_callback(status, NULL, pending_query);
+	release_query(pending_query);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	release_followers(ctx, pending_query, status);
+#else
+	ARG_UNUSED(ctx);
+#endif
+}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+static void cache_answer(struct dns_pending_query *pending_query,
+			 struct dns_addrinfo *info, uint32_t ttl)
+{
+	/* The name is not known any more if the query was cancelled */
+	if (pending_query->query == NULL) {
+		return;
+	}
+
+	(void)dns_cache_add(pending_query->query, pending_query->query_type,
+			    info, MIN(ttl, pending_query->cname_ttl));
+}
+
+static void cache_negative_answer(struct dns_pending_query *pending_query,
+				  struct dns_msg_t *dns_msg, uint32_t ttl)
+{
+	int rcode = dns_header_rcode(dns_msg->msg);
+	uint32_t soa_ttl;
+
+	/* Only the "no such name" and "no data" answers are cached, not the
+	 * server failures.
+	 */
+	if (pending_query->query == NULL ||
+	    (rcode != DNS_HEADER_NOERROR && rcode != DNS_HEADER_NAMEERROR)) {
+		return;
+	}
+
+	if (dns_unpack_soa_ttl(dns_msg, &soa_ttl) < 0) {
+		soa_ttl = CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL;
+	}
+
+	(void)dns_cache_add_negative(pending_query->query,
+				     pending_query->query_type,
+				     DNS_EAI_NODATA,
+				     MIN(MIN(soa_ttl, ttl),
+					 pending_query->cname_ttl));
+}
+
+/* Answer the lookup from the cache if possible */
+static bool dns_resolve_cached(const char *query, enum dns_query_type type,
+			       dns_resolve_cb_t cb, void *user_data)
+{
+	struct dns_addrinfo info[CONFIG_DNS_RESOLVER_AI_MAX_ENTRIES];
+	int ret, i;
+
+	ret = dns_cache_find(query, type, info, ARRAY_SIZE(info));
+	if (ret == 0) {
+		return false;
+	}
+
+	if (ret < 0) {
+		cb(ret, NULL, user_data);
+		return true;
+	}
+
+	for (i = 0; i < ret; i++) {
+		cb(DNS_EAI_INPROGRESS, &info[i], user_data);
+	}
+
+	cb(DNS_EAI_ALLDONE, NULL, user_data);
+
+	return true;
 }
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
 
 /* Must be invoked with context lock held */
 static inline int get_slot_by_id(struct dns_resolve_context *ctx,
@@ -460,6 +668,36 @@ static inline int get_slot_by_id(struct dns_resolve_context *ctx,
 	return -ENOENT;
 }
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/* Id of a lookup that is not sent to the network. It is never 0, which is
+ * the id of the mDNS queries, nor the id of an active query, so that
+ * cancelling with it cannot hit another query.
+ *
+ * Must be invoked with context lock held.
+ */
+static uint16_t get_local_id(struct dns_resolve_context *ctx)
+{
+	uint16_t id;
+
+	do {
+		id = sys_rand32_get();
+	} while (id == 0U || get_slot_by_id(ctx, id, 0) >= 0);
+
+	return id;
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
+/* A response without answers to a unicast query is a NODATA response,
+ * RFC 2308 ch. 2.2.
+ */
+static bool is_nodata_response(struct dns_msg_t *dns_msg, uint16_t dns_id)
+{
+	return dns_id > 0 && dns_msg->msg_size >= DNS_MSG_HEADER_SIZE &&
+		dns_header_opcode(dns_msg->msg) == DNS_QUERY &&
+		dns_header_rcode(dns_msg->msg) == DNS_HEADER_NOERROR &&
+		dns_header_ancount(dns_msg->msg) == 0;
+}
+
 /* Unit test needs to be able to call this function */
 #if !defined(CONFIG_NET_TEST)
 static
@@ -472,7 +710,10 @@ int dns_validate_msg(struct dns_resolve_context *ctx,
 		     uint16_t *query_hash)
 {
 	struct dns_addrinfo info = { 0 };
-	uint32_t ttl; /* RR ttl, so far it is not passed to caller */
+	uint32_t ttl; /* RR ttl, only used by the answer cache */
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	uint32_t cname_ttl = UINT32_MAX;
+#endif
 	uint8_t *src, *addr;
 	const char *query_name;
 	int address_size;
@@ -510,7 +751,7 @@ int dns_validate_msg(struct dns_resolve_context *ctx,
 	}
 
 	ret = dns_unpack_response_header(dns_msg, *dns_id);
-	if (ret < 0) {
+	if (ret < 0 && !is_nodata_response(dns_msg, *dns_id)) {
 		ret = DNS_EAI_FAIL;
 		goto quit;
 	}
@@ -548,6 +789,8 @@ int dns_validate_msg(struct dns_resolve_context *ctx,
 	server_idx = 0;
 	enum dns_rr_type answer_type = DNS_RR_TYPE_INVALID;
 
+	dns_msg->response_type = DNS_RESPONSE_INVALID;
+
 	while (server_idx < dns_header_ancount(dns_msg->msg)) {
 		ret = dns_unpack_answer(dns_msg, answer_ptr, &ttl,
 					&answer_type);
@@ -633,9 +876,14 @@ query_known:
 			src = dns_msg->msg + dns_msg->response_position;
 			memcpy(addr, src, address_size);
 
-			invoke_query_callback(DNS_EAI_INPROGRESS, &info,
-					      &ctx->queries[*query_idx]);
+			notify_query(ctx, DNS_EAI_INPROGRESS, &info,
+				     &ctx->queries[*query_idx]);
 			items++;
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+			cache_answer(&ctx->queries[*query_idx], &info,
+				     MIN(ttl, cname_ttl));
+#endif
 			break;
 
 		case DNS_RESPONSE_CNAME_NO_IP:
@@ -643,6 +891,13 @@ query_known:
 			 * we will use this CNAME
 			 */
 			answer_ptr = dns_msg->response_position;
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+			/* The addresses cannot be cached longer than the
+			 * aliases leading to them.
+			 */
+			cname_ttl = MIN(cname_ttl, ttl);
+#endif
 			break;
 
 		default:
@@ -695,6 +950,12 @@ query_known:
 				}
 			}
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+			ctx->queries[*query_idx].cname_ttl =
+				MIN(ctx->queries[*query_idx].cname_ttl,
+				    cname_ttl);
+#endif
+
 			ret = DNS_EAI_AGAIN;
 			goto quit;
 		}
@@ -702,6 +963,11 @@ query_known:
 
 	if (items == 0) {
 		ret = DNS_EAI_NODATA;
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		cache_negative_answer(&ctx->queries[*query_idx], dns_msg,
+				      cname_ttl);
+#endif
 	} else {
 		ret = DNS_EAI_ALLDONE;
 	}
@@ -748,10 +1014,8 @@ static int dns_read(struct dns_resolve_context *ctx,
 		goto quit;
 	}
 
-	invoke_query_callback(ret, NULL, &ctx->queries[query_idx]);
-
 	/* Marks the end of the results */
-	release_query(&ctx->queries[query_idx]);
+	finish_query(ctx, ret, &ctx->queries[query_idx]);
 
 	net_pkt_unref(pkt);
 
@@ -853,10 +1117,8 @@ quit:
 		goto free_buf;
 	}
 
-	invoke_query_callback(ret, NULL, &ctx->queries[i]);
-
 	/* Marks the end of the results */
-	release_query(&ctx->queries[i]);
+	finish_query(ctx, ret, &ctx->queries[i]);
 
 free_buf:
 	if (dns_data) {
@@ -953,6 +1215,18 @@ static void dns_resolve_cancel_slot(struct dns_resolve_context *ctx, int slot)
 {
 	invoke_query_callback(DNS_EAI_CANCELED, NULL, &ctx->queries[slot]);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	if (query_has_followers(ctx, &ctx->queries[slot])) {
+		/* Keep the query going for the lookups waiting for it, it is
+		 * released when the answer arrives or the last of them is
+		 * gone.
+		 */
+		ctx->queries[slot].cb = orphan_query_cb;
+		ctx->queries[slot].user_data = NULL;
+		return;
+	}
+#endif
+
 	release_query(&ctx->queries[slot]);
 }
 
@@ -1092,6 +1366,11 @@ static void query_timeout(struct k_work *work)
 	NET_DBG("Query timeout DNS req %u type %d hash %u", pending_query->id,
 		pending_query->query_type, pending_query->query_hash);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	/* The lookups waiting for this query time out with it */
+	release_followers(pending_query->ctx, pending_query, DNS_EAI_CANCELED);
+#endif
+
 	/* The resolve cancel will invoke release_query(), but release will
 	 * not be completed because the work item is still pending.  Instead
 	 * the release will be completed when check_query_active() confirms
@@ -1182,6 +1461,19 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 	}
 
 try_resolve:
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	if (dns_resolve_cached(query, type, cb, user_data)) {
+		/* Already done, cancelling with this id returns -ENOENT */
+		if (dns_id) {
+			k_mutex_lock(&ctx->lock, K_FOREVER);
+			*dns_id = get_local_id(ctx);
+			k_mutex_unlock(&ctx->lock);
+		}
+
+		return 0;
+	}
+#endif
+
 	k_mutex_lock(&ctx->lock, K_FOREVER);
 
 	if (ctx->state != DNS_RESOLVE_CONTEXT_ACTIVE) {
@@ -1195,6 +1487,11 @@ try_resolve:
 		goto fail;
 	}
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	ctx->queries[i].leader = get_leader(ctx, query, type);
+	ctx->queries[i].cname_ttl = UINT32_MAX;
+#endif
+
 	ctx->queries[i].cb = cb;
 	ctx->queries[i].timeout = tout;
 	ctx->queries[i].query = query;
@@ -1205,6 +1502,30 @@ try_resolve:
 
 	k_work_init_delayable(&ctx->queries[i].timer, query_timeout);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	if (ctx->queries[i].leader) {
+		/* Wait for the answer to the same query that is already in
+		 * flight. The id is only needed for cancelling the lookup.
+		 */
+		ctx->queries[i].id = get_local_id(ctx);
+		if (dns_id) {
+			*dns_id = ctx->queries[i].id;
+		}
+
+		ret = k_work_reschedule(&ctx->queries[i].timer, tout);
+		if (ret < 0) {
+			goto quit;
+		}
+
+		NET_DBG("[%u] waiting for the answer to DNS req %u", i,
+			ctx->queries[i].leader->id);
+
+		dns_cache_coalesced();
+		ret = 0;
+		goto quit;
+	}
+#endif
+
 	dns_data = net_buf_alloc(&dns_msg_pool, ctx->buf_timeout);
 	if (!dns_data) {
 		ret = -ENOMEM;
@@ -1414,6 +1735,11 @@ int dns_resolve_reconfigure(struct dns_resolve_context *ctx,
 
 	err = dns_resolve_init_locked(ctx, servers, servers_sa);
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	/* The answers of the old servers might not be valid any more */
+	dns_resolve_cache_flush();
+#endif
+
 unlock:
 	k_mutex_unlock(&ctx->lock);
 
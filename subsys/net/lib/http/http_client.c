@@ -27,6 +27,7 @@ LOG_MODULE_REGISTER(net_http, CONFIG_NET_HTTP_LOG_LEVEL);
 #include "net_private.h"
 
 #define HTTP_CONTENT_LEN_SIZE 11
+#define HTTP_CHUNK_HEADER_SIZE 11
 #define MAX_SEND_BUF_LEN 192
 
 static int sendall(int sock, const void *buf, size_t len)
@@ -119,6 +120,70 @@ err:
 	return ret;
 }
 
+static int sendmsg_all(int sock, struct iovec *iov, int iovcnt)
+{
+	struct msghdr msg;
+
+	memset(&msg, 0, sizeof(msg));
+
+	while (iovcnt > 0) {
+		ssize_t out_len;
+
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+
+		out_len = zsock_sendmsg(sock, &msg, 0);
+		if (out_len < 0) {
+			return -errno;
+		}
+
+		while (iovcnt > 0 && out_len >= iov->iov_len) {
+			out_len -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + out_len;
+			iov->iov_len -= out_len;
+		}
+	}
+
+	return 0;
+}
+
+/* Send one chunk of a chunked transfer, zero length ends the body */
+static int http_send_chunk(int sock, const uint8_t *data, size_t len)
+{
+	char chunk_header[HTTP_CHUNK_HEADER_SIZE];
+	struct iovec iov[3];
+	int ret;
+
+	ret = snprintk(chunk_header, sizeof(chunk_header), "%zx" HTTP_CRLF,
+		       len);
+	if (ret <= 0 || ret >= sizeof(chunk_header)) {
+		return -EMSGSIZE;
+	}
+
+	iov[0].iov_base = chunk_header;
+	iov[0].iov_len = ret;
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = len;
+
+	/* Ends the chunk data, or the empty trailer after the last chunk */
+	iov[2].iov_base = HTTP_CRLF;
+	iov[2].iov_len = sizeof(HTTP_CRLF) - 1;
+
+	len += iov[0].iov_len + iov[2].iov_len;
+
+	ret = sendmsg_all(sock, iov, ARRAY_SIZE(iov));
+	if (ret < 0) {
+		return ret;
+	}
+
+	return len;
+}
+
 static int http_flush_data(int sock, const char *send_buf, size_t send_buf_len)
 {
 	int ret;
@@ -344,6 +409,17 @@ static int on_message_complete(struct http_parser *parser)
 
 	req->internal.response.message_complete = 1;
 
+	/* The body of a 5xx response is skipped by the parser, so the
+	 * connection cannot be used after it.
+	 */
+	req->internal.response.keep_alive = http_should_keep_alive(parser) &&
+		!(parser->status_code >= 500 && parser->status_code < 600);
+
+	/* Stop at the end of the response, any data after it belongs to
+	 * the response of the next pipelined request.
+	 */
+	http_parser_pause(parser, 1);
+
 	return 0;
 }
 
@@ -392,39 +468,51 @@ static void http_client_init_parser(struct http_parser *parser,
 	settings->on_url = on_url;
 }
 
-static int http_wait_data(int sock, struct http_request *req)
+/* On entry, pending is the amount of data at the start of recv_buf that was
+ * received before the response begun. On return, it is the amount of data
+ * received after the end of the response, moved to the start of recv_buf.
+ */
+static int http_wait_data(int sock, struct http_request *req, size_t *pending)
 {
+	struct http_response *rsp = &req->internal.response;
 	int total_received = 0;
+	uint8_t *next_rsp = NULL;
 	size_t offset = 0;
+	size_t extra = 0;
+	size_t parsed;
 	int received, ret;
 
 	do {
-		received = zsock_recv(sock, req->internal.response.recv_buf + offset,
-				      req->internal.response.recv_buf_len - offset,
-				      0);
+		if (*pending > 0) {
+			received = *pending;
+			*pending = 0;
+		} else {
+			received = zsock_recv(sock, rsp->recv_buf + offset,
+					      rsp->recv_buf_len - offset, 0);
+		}
+
 		if (received == 0) {
 			/* Connection closed */
 			LOG_DBG("Connection closed");
 			ret = total_received;
 
-			if (req->internal.response.cb) {
+			if (rsp->cb) {
 				NET_DBG("Calling callback for closed connection "
 					"(NULL HTTP response)");
 
 				/* Status code 0 representing a null response */
-				req->internal.response.http_status_code = 0;
+				rsp->http_status_code = 0;
 
 				/* Zero out related response metrics */
-				req->internal.response.processed = 0;
-				req->internal.response.data_len = 0;
-				req->internal.response.content_length = 0;
-				req->internal.response.body_frag_start = NULL;
-				memset(req->internal.response.http_status, 0,
+				rsp->processed = 0;
+				rsp->data_len = 0;
+				rsp->content_length = 0;
+				rsp->body_frag_start = NULL;
+				memset(rsp->http_status, 0,
 				       HTTP_STATUS_STR_SIZE);
 
-				req->internal.response.cb(&req->internal.response,
-							  HTTP_DATA_FINAL,
-							  req->internal.user_data);
+				rsp->cb(rsp, HTTP_DATA_FINAL,
+					req->internal.user_data);
 			}
 
 			break;
@@ -434,53 +522,73 @@ static int http_wait_data(int sock, struct http_request *req)
 			ret = -errno;
 			break;
 		} else {
-			req->internal.response.data_len += received;
+			rsp->data_len += received;
 
-			(void)http_parser_execute(
+			parsed = http_parser_execute(
 				&req->internal.parser,
 				&req->internal.parser_settings,
-				req->internal.response.recv_buf + offset,
+				rsp->recv_buf + offset,
 				received);
+
+			if (rsp->message_complete && parsed < received) {
+				/* Leave out the start of the next response */
+				next_rsp = rsp->recv_buf + offset + parsed;
+				extra = received - parsed;
+				rsp->data_len -= extra;
+
+				if (rsp->body_frag_start) {
+					rsp->body_frag_len = rsp->data_len -
+						(rsp->body_frag_start - rsp->recv_buf);
+				}
+			}
 		}
 
-		total_received += received;
+		total_received += received - extra;
 		offset += received;
 
-		if (offset >= req->internal.response.recv_buf_len) {
+		if (offset >= rsp->recv_buf_len) {
 			offset = 0;
 		}
 
-		if (req->internal.response.cb) {
+		if (rsp->cb) {
 			bool notify = false;
 			enum http_final_call event;
 
-			if (req->internal.response.message_complete) {
+			if (rsp->message_complete) {
 				NET_DBG("Calling callback for %zd len data",
-					req->internal.response.data_len);
+					rsp->data_len);
 
 				notify = true;
 				event = HTTP_DATA_FINAL;
-			} else if (offset == 0) {
+			} else if (offset == 0 ||
+				   (req->stream_response && rsp->body_frag_start)) {
 				NET_DBG("Calling callback for partitioned %zd len data",
-					req->internal.response.data_len);
+					rsp->data_len);
 
 				notify = true;
 				event = HTTP_DATA_MORE;
 			}
 
 			if (notify) {
-				req->internal.response.cb(&req->internal.response,
-							  event,
-							  req->internal.user_data);
+				rsp->cb(rsp, event, req->internal.user_data);
 
 				/* Re-use the result buffer and start to fill it again */
-				req->internal.response.data_len = 0;
-				req->internal.response.body_frag_start = NULL;
-				req->internal.response.body_frag_len = 0;
+				rsp->data_len = 0;
+				rsp->body_frag_start = NULL;
+				rsp->body_frag_len = 0;
+
+				if (!rsp->message_complete) {
+					offset = 0;
+				}
 			}
 		}
 
-		if (req->internal.response.message_complete) {
+		if (rsp->message_complete) {
+			if (extra > 0) {
+				memmove(rsp->recv_buf, next_rsp, extra);
+				*pending = extra;
+			}
+
 			ret = total_received;
 			break;
 		}
@@ -499,22 +607,9 @@ static void http_timeout(struct k_work *work)
 	(void)zsock_shutdown(data->sock, ZSOCK_SHUT_RD);
 }
 
-int http_client_req(int sock, struct http_request *req,
-		    int32_t timeout, void *user_data)
+static void http_client_init_req(int sock, struct http_request *req,
+				 int32_t timeout, void *user_data)
 {
-	/* Utilize the network usage by sending data in bigger blocks */
-	char send_buf[MAX_SEND_BUF_LEN];
-	const size_t send_buf_max_len = sizeof(send_buf);
-	size_t send_buf_pos = 0;
-	int total_sent = 0;
-	int ret, total_recv, i;
-	const char *method;
-
-	if (sock < 0 || req == NULL || req->response == NULL ||
-	    req->recv_buf == NULL || req->recv_buf_len == 0) {
-		return -EINVAL;
-	}
-
 	memset(&req->internal.response, 0, sizeof(req->internal.response));
 
 	req->internal.response.http_cb = req->http_cb;
@@ -524,6 +619,23 @@ int http_client_req(int sock, struct http_request *req,
 	req->internal.user_data = user_data;
 	req->internal.sock = sock;
 	req->internal.timeout = SYS_TIMEOUT_MS(timeout);
+}
+
+static bool http_client_req_valid(int sock, const struct http_request *req)
+{
+	return sock >= 0 && req != NULL && req->response != NULL &&
+		req->recv_buf != NULL && req->recv_buf_len > 0;
+}
+
+static int http_send_req(int sock, struct http_request *req, void *user_data)
+{
+	/* Utilize the network usage by sending data in bigger blocks */
+	char send_buf[MAX_SEND_BUF_LEN];
+	const size_t send_buf_max_len = sizeof(send_buf);
+	size_t send_buf_pos = 0;
+	int total_sent = 0;
+	const char *method;
+	int ret, i;
 
 	method = http_method_str(req->method);
 
@@ -609,7 +721,52 @@ int http_client_req(int sock, struct http_request *req,
 		total_sent += ret;
 	}
 
-	if (req->payload || req->payload_cb) {
+	if (req->body_cb) {
+		const uint8_t *data;
+		int len;
+
+		ret = http_send_data(sock, send_buf, send_buf_max_len,
+				     &send_buf_pos, "Transfer-Encoding", ": ",
+				     "chunked", HTTP_CRLF, HTTP_CRLF, NULL);
+		if (ret < 0) {
+			goto out;
+		}
+
+		total_sent += ret;
+
+		ret = http_flush_data(sock, send_buf, send_buf_pos);
+		if (ret < 0) {
+			goto out;
+		}
+
+		send_buf_pos = 0;
+		total_sent += ret;
+
+		/* The body callback returns 0 once the whole body is given,
+		 * which is sent as the last chunk.
+		 */
+		do {
+			data = NULL;
+
+			len = req->body_cb(req, &data, user_data);
+			if (len < 0) {
+				ret = len;
+				goto out;
+			}
+
+			if (len > 0 && data == NULL) {
+				ret = -EINVAL;
+				goto out;
+			}
+
+			ret = http_send_chunk(sock, data, len);
+			if (ret < 0) {
+				goto out;
+			}
+
+			total_sent += ret;
+		} while (len > 0);
+	} else if (req->payload || req->payload_cb) {
 		if (req->payload_len) {
 			char content_len_str[HTTP_CONTENT_LEN_SIZE];
 
@@ -687,31 +844,129 @@ int http_client_req(int sock, struct http_request *req,
 
 	NET_DBG("Sent %d bytes", total_sent);
 
-	http_client_init_parser(&req->internal.parser,
-				&req->internal.parser_settings);
+	return total_sent;
 
-	if (!K_TIMEOUT_EQ(req->internal.timeout, K_FOREVER) &&
-	    !K_TIMEOUT_EQ(req->internal.timeout, K_NO_WAIT)) {
+out:
+	return ret;
+}
+
+static bool http_timeout_used(struct http_request *req)
+{
+	return !K_TIMEOUT_EQ(req->internal.timeout, K_FOREVER) &&
+		!K_TIMEOUT_EQ(req->internal.timeout, K_NO_WAIT);
+}
+
+static void http_timeout_start(struct http_request *req)
+{
+	if (http_timeout_used(req)) {
 		k_work_init_delayable(&req->internal.work, http_timeout);
 		(void)k_work_reschedule(&req->internal.work,
 					req->internal.timeout);
 	}
+}
+
+static void http_timeout_stop(struct http_request *req)
+{
+	if (http_timeout_used(req)) {
+		(void)k_work_cancel_delayable(&req->internal.work);
+	}
+}
+
+int http_client_req(int sock, struct http_request *req,
+		    int32_t timeout, void *user_data)
+{
+	size_t pending = 0;
+	int total_sent;
+	int total_recv;
+
+	if (!http_client_req_valid(sock, req)) {
+		return -EINVAL;
+	}
+
+	http_client_init_req(sock, req, timeout, user_data);
+
+	total_sent = http_send_req(sock, req, user_data);
+	if (total_sent < 0) {
+		return total_sent;
+	}
+
+	http_client_init_parser(&req->internal.parser,
+				&req->internal.parser_settings);
+
+	http_timeout_start(req);
 
 	/* Request is sent, now wait data to be received */
-	total_recv = http_wait_data(sock, req);
+	total_recv = http_wait_data(sock, req, &pending);
 	if (total_recv < 0) {
 		NET_DBG("Wait data failure (%d)", total_recv);
 	} else {
 		NET_DBG("Received %d bytes", total_recv);
 	}
 
-	if (!K_TIMEOUT_EQ(req->internal.timeout, K_FOREVER) &&
-	    !K_TIMEOUT_EQ(req->internal.timeout, K_NO_WAIT)) {
-		(void)k_work_cancel_delayable(&req->internal.work);
+	if (pending > 0) {
+		/* Nothing was asked for, the connection is out of sync */
+		NET_DBG("Unexpected %zd bytes after response", pending);
+		req->internal.response.keep_alive = 0;
 	}
 
+	http_timeout_stop(req);
+
 	return total_sent;
+}
 
-out:
-	return ret;
+int http_client_req_pipeline(int sock, struct http_request **reqs,
+			     size_t count, int32_t timeout, void *user_data)
+{
+	struct http_request *first;
+	size_t pending = 0;
+	int total_sent = 0;
+	int completed = 0;
+	int ret, i;
+
+	if (reqs == NULL || count == 0) {
+		return -EINVAL;
+	}
+
+	first = reqs[0];
+
+	for (i = 0; i < count; i++) {
+		if (!http_client_req_valid(sock, reqs[i])) {
+			return -EINVAL;
+		}
+
+		http_client_init_req(sock, reqs[i], timeout, user_data);
+
+		reqs[i]->internal.response.recv_buf = first->recv_buf;
+		reqs[i]->internal.response.recv_buf_len = first->recv_buf_len;
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = http_send_req(sock, reqs[i], user_data);
+		if (ret < 0) {
+			return ret;
+		}
+
+		total_sent += ret;
+	}
+
+	NET_DBG("Sent %d requests, %d bytes", count, total_sent);
+
+	http_timeout_start(first);
+
+	for (i = 0; i < count; i++) {
+		http_client_init_parser(&reqs[i]->internal.parser,
+					&reqs[i]->internal.parser_settings);
+
+		ret = http_wait_data(sock, reqs[i], &pending);
+		if (ret < 0 || !reqs[i]->internal.response.message_complete) {
+			NET_DBG("No response to request %d (%d)", i, ret);
+			break;
+		}
+
+		completed++;
+	}
+
+	http_timeout_stop(first);
+
+	return completed;
 }
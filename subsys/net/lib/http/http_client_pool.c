@@ -0,0 +1,314 @@
+/** @file
+ * @brief HTTP client keep-alive connection pool
+ *
+ * Keeps the connections to the servers open between the requests, so that
+ * the TCP and TLS handshakes are done once per server instead of once per
+ * request.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_http, CONFIG_NET_HTTP_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/http_client.h>
+
+#define POOL_HOST_LEN 64
+#define POOL_MAX_SEC_TAGS 4
+
+struct pool_conn {
+	/** Server address */
+	struct sockaddr addr;
+
+	/** Uptime in ms when the connection was given back to the pool */
+	int64_t idle_since;
+
+	/** Socket of the connection, -1 if the slot is not used */
+	int sock;
+
+	/** Length of the server address */
+	socklen_t addrlen;
+
+	/** TLS security tags, none for a plain TCP connection */
+	sec_tag_t sec_tags[POOL_MAX_SEC_TAGS];
+	size_t sec_tag_count;
+
+	/** Host name of the server */
+	char host[POOL_HOST_LEN];
+
+	/** Connection is given to the application */
+	bool in_use;
+};
+
+static struct pool_conn pool[CONFIG_HTTP_CLIENT_POOL_SIZE] = {
+	[0 ... (CONFIG_HTTP_CLIENT_POOL_SIZE - 1)] = { .sock = -1 },
+};
+
+static K_MUTEX_DEFINE(lock);
+
+static inline bool conn_idle(const struct pool_conn *conn)
+{
+	return conn->sock >= 0 && !conn->in_use;
+}
+
+static bool conn_match(const struct pool_conn *conn,
+		       const struct http_client_endpoint *ep)
+{
+	return conn->addrlen == ep->addrlen &&
+		memcmp(&conn->addr, ep->addr, ep->addrlen) == 0 &&
+		strcmp(conn->host, ep->host) == 0 &&
+		conn->sec_tag_count == ep->sec_tag_count &&
+		(ep->sec_tag_count == 0 ||
+		 memcmp(conn->sec_tags, ep->sec_tag_list,
+			ep->sec_tag_count * sizeof(sec_tag_t)) == 0);
+}
+
+/* Must be invoked with the lock held */
+static void conn_close(struct pool_conn *conn)
+{
+	NET_DBG("Closing connection %d to %s", conn->sock, conn->host);
+
+	(void)zsock_close(conn->sock);
+
+	conn->sock = -1;
+	conn->in_use = false;
+}
+
+/* An idle connection has nothing to read unless the server closed it, or
+ * sent something that was not asked for. Either way it cannot be used.
+ */
+static bool conn_stale(const struct pool_conn *conn)
+{
+	struct zsock_pollfd fds = {
+		.fd = conn->sock,
+		.events = ZSOCK_POLLIN,
+	};
+
+	return zsock_poll(&fds, 1, 0) != 0;
+}
+
+/* Must be invoked with the lock held */
+static void pool_expire(int64_t now)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pool); i++) {
+		if (conn_idle(&pool[i]) &&
+		    now - pool[i].idle_since >=
+		    CONFIG_HTTP_CLIENT_POOL_IDLE_TIMEOUT) {
+			conn_close(&pool[i]);
+		}
+	}
+}
+
+/* Returns a free slot, or the one that has been idle the longest if all the
+ * slots are used. Must be invoked with the lock held.
+ */
+static struct pool_conn *pool_get_free(void)
+{
+	struct pool_conn *oldest = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pool); i++) {
+		if (pool[i].sock < 0 && !pool[i].in_use) {
+			return &pool[i];
+		}
+
+		if (conn_idle(&pool[i]) &&
+		    (!oldest || pool[i].idle_since < oldest->idle_since)) {
+			oldest = &pool[i];
+		}
+	}
+
+	if (oldest) {
+		conn_close(oldest);
+	}
+
+	return oldest;
+}
+
+static int conn_connect(const struct http_client_endpoint *ep)
+{
+	int proto = IPPROTO_TCP;
+	int sock;
+	int ret;
+
+	if (ep->sec_tag_count > 0) {
+		if (!IS_ENABLED(CONFIG_NET_SOCKETS_SOCKOPT_TLS)) {
+			return -EPROTONOSUPPORT;
+		}
+
+		proto = IPPROTO_TLS_1_2;
+	}
+
+	sock = zsock_socket(ep->addr->sa_family, SOCK_STREAM, proto);
+	if (sock < 0) {
+		return -errno;
+	}
+
+#if defined(CONFIG_NET_SOCKETS_SOCKOPT_TLS)
+	if (ep->sec_tag_count > 0) {
+		ret = zsock_setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST,
+				       ep->sec_tag_list,
+				       ep->sec_tag_count * sizeof(sec_tag_t));
+		if (ret < 0) {
+			goto fail;
+		}
+
+		ret = zsock_setsockopt(sock, SOL_TLS, TLS_HOSTNAME, ep->host,
+				       strlen(ep->host) + 1);
+		if (ret < 0) {
+			goto fail;
+		}
+	}
+#endif
+
+	ret = zsock_connect(sock, ep->addr, ep->addrlen);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	return sock;
+
+fail:
+	ret = -errno;
+	(void)zsock_close(sock);
+
+	return ret;
+}
+
+int http_client_pool_get(const struct http_client_endpoint *ep)
+{
+	struct pool_conn *conn = NULL;
+	int sock;
+	int i;
+
+	if (ep == NULL || ep->addr == NULL || ep->host == NULL ||
+	    ep->addrlen > sizeof(conn->addr) ||
+	    (ep->sec_tag_count > 0 && ep->sec_tag_list == NULL)) {
+		return -EINVAL;
+	}
+
+	if (strlen(ep->host) >= POOL_HOST_LEN ||
+	    ep->sec_tag_count > POOL_MAX_SEC_TAGS) {
+		return -ENAMETOOLONG;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	pool_expire(k_uptime_get());
+
+	for (i = 0; i < ARRAY_SIZE(pool); i++) {
+		if (!conn_idle(&pool[i]) || !conn_match(&pool[i], ep)) {
+			continue;
+		}
+
+		if (conn_stale(&pool[i])) {
+			conn_close(&pool[i]);
+			continue;
+		}
+
+		pool[i].in_use = true;
+		sock = pool[i].sock;
+
+		k_mutex_unlock(&lock);
+
+		NET_DBG("Reusing connection %d to %s", sock, ep->host);
+
+		return sock;
+	}
+
+	conn = pool_get_free();
+	if (!conn) {
+		k_mutex_unlock(&lock);
+		return -ENOMEM;
+	}
+
+	/* Reserve the slot, the connection is made without the lock */
+	conn->in_use = true;
+
+	k_mutex_unlock(&lock);
+
+	sock = conn_connect(ep);
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (sock < 0) {
+		conn->in_use = false;
+	} else {
+		memcpy(&conn->addr, ep->addr, ep->addrlen);
+		conn->addrlen = ep->addrlen;
+		strcpy(conn->host, ep->host);
+
+		if (ep->sec_tag_count > 0) {
+			memcpy(conn->sec_tags, ep->sec_tag_list,
+			       ep->sec_tag_count * sizeof(sec_tag_t));
+		}
+
+		conn->sec_tag_count = ep->sec_tag_count;
+		conn->sock = sock;
+
+		NET_DBG("New connection %d to %s", sock, ep->host);
+	}
+
+	k_mutex_unlock(&lock);
+
+	return sock;
+}
+
+void http_client_pool_put(int sock, const struct http_request *req)
+{
+	bool keep = req != NULL && req->internal.response.message_complete &&
+		req->internal.response.keep_alive;
+	int i;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(pool); i++) {
+		if (pool[i].sock != sock || !pool[i].in_use) {
+			continue;
+		}
+
+		if (keep) {
+			pool[i].in_use = false;
+			pool[i].idle_since = k_uptime_get();
+		} else {
+			conn_close(&pool[i]);
+		}
+
+		k_mutex_unlock(&lock);
+
+		return;
+	}
+
+	k_mutex_unlock(&lock);
+
+	NET_DBG("Connection %d not in the pool", sock);
+
+	(void)zsock_close(sock);
+}
+
+void http_client_pool_flush(void)
+{
+	int i;
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(pool); i++) {
+		if (conn_idle(&pool[i])) {
+			conn_close(&pool[i]);
+		}
+	}
+
+	k_mutex_unlock(&lock);
+}
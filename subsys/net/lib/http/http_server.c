@@ -0,0 +1,1135 @@
+/** @file
+ * @brief HTTP server
+ *
+ * All the connections of a server are served by one thread polling their
+ * sockets. The content of static resources is sent from where it is stored,
+ * without copying it.
+ */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_http_server, CONFIG_NET_HTTP_SERVER_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/http_server.h>
+
+#if IS_ENABLED(CONFIG_NET_TC_THREAD_COOPERATIVE)
+/* Lowest priority cooperative thread */
+#define THREAD_PRIORITY K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1)
+#else
+#define THREAD_PRIORITY K_PRIO_PREEMPT(CONFIG_NUM_PREEMPT_PRIORITIES - 1)
+#endif
+
+/* Longest time to wait in poll, so that a stop request is noticed. */
+#define SERVER_POLL_INTERVAL_MS 500
+
+#define CRLF "\r\n"
+
+#define HEADER_NO_MATCH SIZE_MAX
+
+static const char accept_encoding[] = "accept-encoding";
+
+struct content_type {
+	const char *extension;
+	const char *type;
+};
+
+static const struct content_type content_types[] = {
+	{ "html", "text/html" },
+	{ "htm", "text/html" },
+	{ "css", "text/css" },
+	{ "js", "application/javascript" },
+	{ "json", "application/json" },
+	{ "txt", "text/plain" },
+	{ "svg", "image/svg+xml" },
+	{ "png", "image/png" },
+	{ "jpg", "image/jpeg" },
+	{ "ico", "image/x-icon" },
+};
+
+static const char *status_str(uint16_t status)
+{
+	switch (status) {
+	case 200:
+		return "OK";
+	case 201:
+		return "Created";
+	case 204:
+		return "No Content";
+	case 400:
+		return "Bad Request";
+	case 404:
+		return "Not Found";
+	case 405:
+		return "Method Not Allowed";
+	case 413:
+		return "Payload Too Large";
+	case 414:
+		return "URI Too Long";
+	case 500:
+		return "Internal Server Error";
+	case 503:
+		return "Service Unavailable";
+	default:
+		return "";
+	}
+}
+
+static inline struct http_server_client *parser_client(struct http_parser *p)
+{
+	return CONTAINER_OF(p, struct http_server_client, parser);
+}
+
+static void header_value_check(struct http_server_client *client)
+{
+	if (client->header_field_match != sizeof(accept_encoding) - 1) {
+		return;
+	}
+
+	client->header_value[client->header_value_len] = '\0';
+
+	if (strstr(client->header_value, "gzip") != NULL) {
+		client->accept_gzip = 1;
+	}
+}
+
+static int on_message_begin(struct http_parser *parser)
+{
+	struct http_server_client *client = parser_client(parser);
+
+	client->path_len = 0;
+	client->body_len = 0;
+	client->error_status = 0;
+	client->accept_gzip = 0;
+	client->header_field_match = 0;
+	client->header_field_done = 0;
+	client->header_value_len = 0;
+
+	return 0;
+}
+
+static int on_url(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_server_client *client = parser_client(parser);
+
+	if (client->path_len + length >= sizeof(client->path)) {
+		client->error_status = 414;
+		return 0;
+	}
+
+	memcpy(client->path + client->path_len, at, length);
+	client->path_len += length;
+
+	return 0;
+}
+
+/* Header names can be split over several callbacks, so they are matched
+ * incrementally. Only Accept-Encoding is of interest.
+ */
+static int on_header_field(struct http_parser *parser, const char *at,
+			   size_t length)
+{
+	struct http_server_client *client = parser_client(parser);
+	size_t i;
+
+	if (client->header_field_done) {
+		header_value_check(client);
+
+		client->header_field_match = 0;
+		client->header_field_done = 0;
+		client->header_value_len = 0;
+	}
+
+	for (i = 0; i < length; i++) {
+		if (client->header_field_match >= sizeof(accept_encoding) - 1 ||
+		    tolower((unsigned char)at[i]) !=
+		    accept_encoding[client->header_field_match]) {
+			client->header_field_match = HEADER_NO_MATCH;
+			break;
+		}
+
+		client->header_field_match++;
+	}
+
+	return 0;
+}
+
+static int on_header_value(struct http_parser *parser, const char *at,
+			   size_t length)
+{
+	struct http_server_client *client = parser_client(parser);
+
+	client->header_field_done = 1;
+
+	if (client->header_field_match != sizeof(accept_encoding) - 1) {
+		return 0;
+	}
+
+	length = MIN(length, sizeof(client->header_value) - 1 -
+		     client->header_value_len);
+
+	memcpy(client->header_value + client->header_value_len, at, length);
+	client->header_value_len += length;
+
+	return 0;
+}
+
+static int on_headers_complete(struct http_parser *parser)
+{
+	header_value_check(parser_client(parser));
+
+	return 0;
+}
+
+static int on_body(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_server_client *client = parser_client(parser);
+
+	if (client->body_len + length > sizeof(client->body)) {
+		client->error_status = 413;
+		return 0;
+	}
+
+	memcpy(client->body + client->body_len, at, length);
+	client->body_len += length;
+
+	return 0;
+}
+
+static int on_message_complete(struct http_parser *parser)
+{
+	struct http_server_client *client = parser_client(parser);
+
+	client->message_complete = 1;
+	client->keep_alive = http_should_keep_alive(parser);
+
+	/* Any data after the request belongs to the next pipelined request,
+	 * which is parsed once this one has been answered.
+	 */
+	http_parser_pause(parser, 1);
+
+	return 0;
+}
+
+static void server_init_parser(struct http_server *server)
+{
+	struct http_parser_settings *settings = &server->parser_settings;
+
+	memset(settings, 0, sizeof(*settings));
+
+	settings->on_message_begin = on_message_begin;
+	settings->on_url = on_url;
+	settings->on_header_field = on_header_field;
+	settings->on_header_value = on_header_value;
+	settings->on_headers_complete = on_headers_complete;
+	settings->on_body = on_body;
+	settings->on_message_complete = on_message_complete;
+}
+
+static void client_next_request(struct http_server_client *client)
+{
+	http_parser_init(&client->parser, HTTP_REQUEST);
+
+	client->message_complete = 0;
+	client->responding = 0;
+	client->chunked = 0;
+	client->chunk_open = 0;
+	client->header_len = 0;
+	client->header_sent = 0;
+	client->tx_len = 0;
+	client->resource = NULL;
+}
+
+static void client_close(struct http_server_client *client)
+{
+	NET_DBG("Closing connection %d", client->sock);
+
+#if defined(CONFIG_FILE_SYSTEM)
+	if (client->file_open) {
+		(void)fs_close(&client->file);
+		client->file_open = 0;
+	}
+#endif
+
+	(void)zsock_close(client->sock);
+	client->sock = -1;
+}
+
+static int header_append(struct http_server_client *client,
+			 const char *fmt, ...)
+{
+	size_t size = sizeof(client->header) - client->header_len;
+	va_list args;
+	int ret;
+
+	va_start(args, fmt);
+	ret = vsnprintk(client->header + client->header_len, size, fmt, args);
+	va_end(args);
+
+	if (ret < 0 || ret >= size) {
+		return -ENOMEM;
+	}
+
+	client->header_len += ret;
+
+	return 0;
+}
+
+/* A negative content_len is for a body of unknown length, sent with chunked
+ * encoding or ended by closing the connection.
+ */
+static int client_header(struct http_server_client *client, uint16_t status,
+			 const char *content_type, const char *encoding,
+			 const char *extra, ssize_t content_len)
+{
+	int ret;
+
+	client->header_len = 0;
+	client->header_sent = 0;
+
+	ret = header_append(client, "HTTP/1.1 %u %s" CRLF, status,
+			    status_str(status));
+
+	if (ret == 0 && content_type != NULL) {
+		ret = header_append(client, "Content-Type: %s" CRLF,
+				    content_type);
+	}
+
+	if (ret == 0 && encoding != NULL) {
+		ret = header_append(client, "Content-Encoding: %s" CRLF,
+				    encoding);
+	}
+
+	if (ret == 0 && extra != NULL) {
+		ret = header_append(client, "%s", extra);
+	}
+
+	if (ret == 0 && content_len >= 0) {
+		ret = header_append(client, "Content-Length: %zd" CRLF,
+				    content_len);
+	} else if (ret == 0 && client->chunked) {
+		ret = header_append(client, "Transfer-Encoding: chunked" CRLF);
+	}
+
+	if (ret == 0) {
+		ret = header_append(client, "Connection: %s" CRLF CRLF,
+				    client->keep_alive ? "keep-alive" : "close");
+	}
+
+	if (ret < 0) {
+		NET_ERR("Response header does not fit");
+		client->header_len = 0;
+	}
+
+	return ret;
+}
+
+static int client_respond_empty(struct http_server_client *client,
+				uint16_t status, const char *extra)
+{
+	NET_DBG("Status %u for %s", status, client->path);
+
+	return client_header(client, status, NULL, NULL, extra, 0);
+}
+
+#if defined(CONFIG_FILE_SYSTEM)
+/* The file is read to the free end of the receive buffer, or to the request
+ * body buffer if pipelined requests fill the receive buffer.
+ */
+static uint8_t *client_file_buf(struct http_server_client *client,
+				size_t *len)
+{
+	*len = sizeof(client->buf) - client->data_len;
+	if (*len >= sizeof(client->body)) {
+		return client->buf + client->data_len;
+	}
+
+	*len = sizeof(client->body);
+
+	return client->body;
+}
+
+static int client_file_read(struct http_server_client *client)
+{
+	uint8_t *buf;
+	size_t len;
+	ssize_t ret;
+
+	buf = client_file_buf(client, &len);
+	len = MIN(len, client->file_left);
+
+	ret = fs_read(&client->file, buf, len);
+	if (ret <= 0) {
+		(void)fs_close(&client->file);
+		client->file_open = 0;
+
+		/* The Content-Length was sent, the response cannot be
+		 * completed if the file got shorter.
+		 */
+		return ret < 0 ? ret : -EIO;
+	}
+
+	client->tx_data = buf;
+	client->tx_len = ret;
+	client->file_left -= ret;
+
+	if (client->file_left == 0) {
+		(void)fs_close(&client->file);
+		client->file_open = 0;
+	}
+
+	return 0;
+}
+#endif
+
+/* Send as much of the response as the socket takes.
+ *
+ * Returns 0 when the whole response is sent, -EAGAIN if the socket is full.
+ */
+static int client_send_pending(struct http_server_client *client)
+{
+	struct iovec iov[2];
+	struct msghdr msg;
+	ssize_t sent;
+	size_t len;
+	int ret;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+
+	while (true) {
+#if defined(CONFIG_FILE_SYSTEM)
+		if (client->tx_len == 0 && client->file_open) {
+			ret = client_file_read(client);
+			if (ret < 0) {
+				return ret;
+			}
+		}
+#endif
+
+		msg.msg_iovlen = 0;
+
+		if (client->header_sent < client->header_len) {
+			iov[msg.msg_iovlen].iov_base =
+				client->header + client->header_sent;
+			iov[msg.msg_iovlen].iov_len =
+				client->header_len - client->header_sent;
+			msg.msg_iovlen++;
+		}
+
+		if (client->tx_len > 0) {
+			iov[msg.msg_iovlen].iov_base = (void *)client->tx_data;
+			iov[msg.msg_iovlen].iov_len = client->tx_len;
+			msg.msg_iovlen++;
+		}
+
+		if (msg.msg_iovlen == 0) {
+			return 0;
+		}
+
+		sent = zsock_sendmsg(client->sock, &msg, ZSOCK_MSG_DONTWAIT);
+		if (sent < 0) {
+			ret = -errno;
+			return ret == -EWOULDBLOCK ? -EAGAIN : ret;
+		}
+
+		client->last_activity = k_uptime_get();
+
+		len = MIN(sent, client->header_len - client->header_sent);
+		client->header_sent += len;
+		sent -= len;
+
+		client->tx_data += sent;
+		client->tx_len -= sent;
+	}
+}
+
+/* Used by dynamic resources, which send their response from the callback */
+static int client_send_blocking(struct http_server_client *client)
+{
+	struct zsock_pollfd fds = {
+		.fd = client->sock,
+		.events = ZSOCK_POLLOUT,
+	};
+	int ret;
+
+	while ((ret = client_send_pending(client)) == -EAGAIN) {
+		ret = zsock_poll(&fds, 1, CONFIG_HTTP_SERVER_IDLE_TIMEOUT);
+		if (ret == 0) {
+			return -ETIMEDOUT;
+		}
+
+		if (ret < 0) {
+			return -errno;
+		}
+	}
+
+	return ret;
+}
+
+static int serve_static(struct http_server_client *client,
+			const struct http_resource *res)
+{
+	const char *encoding = NULL;
+	const uint8_t *data = res->static_data.data;
+	size_t len = res->static_data.len;
+	int ret;
+
+	if (client->accept_gzip && res->static_data.gzip_data != NULL) {
+		data = res->static_data.gzip_data;
+		len = res->static_data.gzip_len;
+		encoding = "gzip";
+	}
+
+	ret = client_header(client, 200, res->content_type, encoding, NULL,
+			    len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (client->parser.method != HTTP_HEAD) {
+		client->tx_data = data;
+		client->tx_len = len;
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_FILE_SYSTEM)
+static const char *content_type_guess(const char *name)
+{
+	const char *extension = strrchr(name, '.');
+	int i;
+
+	if (extension != NULL && strchr(extension, '/') == NULL) {
+		extension++;
+
+		for (i = 0; i < ARRAY_SIZE(content_types); i++) {
+			if (strcasecmp(extension, content_types[i].extension) ==
+			    0) {
+				return content_types[i].type;
+			}
+		}
+	}
+
+	return "application/octet-stream";
+}
+
+static int serve_fs(struct http_server_client *client,
+		    const struct http_resource *res)
+{
+	char file_path[MAX_FILE_NAME + 1];
+	const char *content_type = res->content_type;
+	const char *encoding = NULL;
+	size_t prefix_len = strlen(res->path);
+	struct fs_dirent entry;
+	size_t len;
+	int ret;
+
+	if (prefix_len > 0 && res->path[prefix_len - 1] == '*') {
+		const char *name = client->path + prefix_len - 1;
+
+		if (strstr(name, "..") != NULL) {
+			return client_respond_empty(client, 404, NULL);
+		}
+
+		ret = snprintk(file_path, sizeof(file_path), "%s%s%s",
+			       res->fs.path, name[0] == '/' ? "" : "/", name);
+	} else {
+		ret = snprintk(file_path, sizeof(file_path), "%s",
+			       res->fs.path);
+	}
+
+	if (ret < 0 || ret >= sizeof(file_path)) {
+		return client_respond_empty(client, 404, NULL);
+	}
+
+	len = ret;
+
+	if (content_type == NULL) {
+		content_type = content_type_guess(file_path);
+	}
+
+	if (client->accept_gzip && len + 3 < sizeof(file_path)) {
+		strcpy(file_path + len, ".gz");
+
+		if (fs_stat(file_path, &entry) == 0 &&
+		    entry.type == FS_DIR_ENTRY_FILE) {
+			encoding = "gzip";
+		} else {
+			file_path[len] = '\0';
+		}
+	}
+
+	if (encoding == NULL &&
+	    (fs_stat(file_path, &entry) < 0 ||
+	     entry.type != FS_DIR_ENTRY_FILE)) {
+		return client_respond_empty(client, 404, NULL);
+	}
+
+	if (client->parser.method != HTTP_HEAD) {
+		fs_file_t_init(&client->file);
+
+		ret = fs_open(&client->file, file_path, FS_O_READ);
+		if (ret < 0) {
+			NET_DBG("Cannot open %s (%d)", file_path, ret);
+			return client_respond_empty(client, 500, NULL);
+		}
+
+		client->file_open = entry.size > 0;
+		client->file_left = entry.size;
+
+		if (!client->file_open) {
+			(void)fs_close(&client->file);
+		}
+	}
+
+	return client_header(client, 200, content_type, encoding, NULL,
+			     entry.size);
+}
+#endif
+
+static int serve_dynamic(struct http_server_client *client,
+			 const struct http_resource *res)
+{
+	struct http_server_request req = {
+		.method = client->parser.method,
+		.path = client->path,
+		.body = client->body,
+		.body_len = client->body_len,
+	};
+	char *query;
+	int ret;
+
+	query = strchr(client->path, '?');
+	if (query != NULL) {
+		*query = '\0';
+		req.query = query + 1;
+	}
+
+	ret = res->dynamic.cb(client, &req, res->dynamic.user_data);
+
+	if (client->header_len == 0) {
+		/* Nothing was sent by the callback */
+		return client_respond_empty(client, ret < 0 ? 500 : 204, NULL);
+	}
+
+	if (client->chunked) {
+		ret = http_server_respond_chunk(client, NULL, 0);
+	}
+
+	return ret;
+}
+
+static const struct http_resource *resource_find(struct http_server *server,
+						 const char *path)
+{
+	const struct http_resource *res;
+	size_t len;
+	int i;
+
+	for (i = 0; i < server->config->resource_count; i++) {
+		res = &server->config->resources[i];
+		len = strlen(res->path);
+
+		if (len > 0 && res->path[len - 1] == '*') {
+			if (strncmp(res->path, path, len - 1) == 0) {
+				return res;
+			}
+		} else if (strcmp(res->path, path) == 0) {
+			return res;
+		}
+	}
+
+	return NULL;
+}
+
+static int client_dispatch(struct http_server_client *client)
+{
+	const struct http_resource *res;
+	size_t path_len;
+
+	client->responding = 1;
+	client->path[client->path_len] = '\0';
+
+	if (client->error_status != 0) {
+		/* Part of the request was dropped, start from scratch */
+		client->keep_alive = 0;
+		return client_respond_empty(client, client->error_status, NULL);
+	}
+
+	/* Routes are matched without the query */
+	path_len = strcspn(client->path, "?");
+	if (client->path[path_len] == '?') {
+		client->path[path_len] = '\0';
+		res = resource_find(client->server, client->path);
+		client->path[path_len] = '?';
+	} else {
+		res = resource_find(client->server, client->path);
+	}
+
+	if (res == NULL) {
+		return client_respond_empty(client, 404, NULL);
+	}
+
+	NET_DBG("%s %s", http_method_str(client->parser.method),
+		client->path);
+
+	client->resource = res;
+
+	if (res->type == HTTP_RESOURCE_TYPE_DYNAMIC) {
+		return serve_dynamic(client, res);
+	}
+
+	if (client->parser.method != HTTP_GET &&
+	    client->parser.method != HTTP_HEAD) {
+		return client_respond_empty(client, 405,
+					    "Allow: GET, HEAD" CRLF);
+	}
+
+	client->path[path_len] = '\0';
+
+	switch (res->type) {
+	case HTTP_RESOURCE_TYPE_STATIC:
+		return serve_static(client, res);
+#if defined(CONFIG_FILE_SYSTEM)
+	case HTTP_RESOURCE_TYPE_FS:
+		return serve_fs(client, res);
+#endif
+	default:
+		return client_respond_empty(client, 404, NULL);
+	}
+}
+
+static int client_parse(struct http_server_client *client)
+{
+	enum http_errno err;
+	size_t parsed;
+
+	parsed = http_parser_execute(&client->parser,
+				     &client->server->parser_settings,
+				     (const char *)client->buf,
+				     client->data_len);
+
+	client->data_len -= parsed;
+	memmove(client->buf, client->buf + parsed, client->data_len);
+
+	err = HTTP_PARSER_ERRNO(&client->parser);
+	if (err != HPE_OK && err != HPE_PAUSED) {
+		NET_DBG("Parse error %s", http_errno_name(err));
+
+		client->responding = 1;
+		client->keep_alive = 0;
+		client->data_len = 0;
+
+		return client_respond_empty(client, 400, NULL);
+	}
+
+	if (client->message_complete) {
+		return client_dispatch(client);
+	}
+
+	return 0;
+}
+
+/* Do everything that can be done without waiting for the socket.
+ *
+ * Returns -EAGAIN if waiting to send, 0 if waiting to receive, and any other
+ * error if the connection must be closed.
+ */
+static int client_process(struct http_server_client *client)
+{
+	int ret;
+
+	while (true) {
+		if (client->responding) {
+			ret = client_send_pending(client);
+			if (ret < 0) {
+				return ret;
+			}
+
+			if (!client->keep_alive) {
+				return -ECONNRESET;
+			}
+
+			client_next_request(client);
+			continue;
+		}
+
+		if (client->data_len == 0) {
+			return 0;
+		}
+
+		ret = client_parse(client);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (!client->responding) {
+			/* The request is not complete yet */
+			return 0;
+		}
+	}
+}
+
+static int client_recv(struct http_server_client *client)
+{
+	ssize_t received;
+
+	received = zsock_recv(client->sock, client->buf + client->data_len,
+			      sizeof(client->buf) - client->data_len,
+			      ZSOCK_MSG_DONTWAIT);
+	if (received == 0) {
+		return -ENOTCONN;
+	}
+
+	if (received < 0) {
+		return errno == EAGAIN ? 0 : -errno;
+	}
+
+	client->data_len += received;
+	client->last_activity = k_uptime_get();
+
+	return 0;
+}
+
+static void server_accept(struct http_server *server)
+{
+	struct http_server_client *client = NULL;
+	int sock;
+	int i;
+
+	sock = zsock_accept(server->sock, NULL, NULL);
+	if (sock < 0) {
+		NET_DBG("Accept failed (%d)", errno);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+		if (server->clients[i].sock < 0) {
+			client = &server->clients[i];
+			break;
+		}
+	}
+
+	if (client == NULL) {
+		/* Not polled for new connections when full */
+		(void)zsock_close(sock);
+		return;
+	}
+
+	NET_DBG("New connection %d", sock);
+
+	client->server = server;
+	client->sock = sock;
+	client->data_len = 0;
+	client->file_open = 0;
+	client->last_activity = k_uptime_get();
+
+	client_next_request(client);
+}
+
+static int server_poll_timeout(struct http_server *server, int64_t now)
+{
+	int64_t timeout = SERVER_POLL_INTERVAL_MS;
+	int64_t left;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+		if (server->clients[i].sock < 0) {
+			continue;
+		}
+
+		left = server->clients[i].last_activity +
+			CONFIG_HTTP_SERVER_IDLE_TIMEOUT - now;
+		timeout = CLAMP(left, 0, timeout);
+	}
+
+	return timeout;
+}
+
+static void server_loop(void *p1, void *p2, void *p3)
+{
+	struct http_server *server = p1;
+	struct zsock_pollfd fds[CONFIG_HTTP_SERVER_MAX_CLIENTS + 1];
+	struct http_server_client *client;
+	bool full;
+	int64_t now;
+	int ret;
+	int i;
+
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (server->running) {
+		full = true;
+
+		for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+			client = &server->clients[i];
+
+			fds[i + 1].fd = client->sock;
+			fds[i + 1].events = client->responding ?
+				ZSOCK_POLLOUT : ZSOCK_POLLIN;
+			fds[i + 1].revents = 0;
+
+			if (client->sock < 0) {
+				full = false;
+			}
+		}
+
+		/* Leave the new connections in the backlog while full */
+		fds[0].fd = full ? -1 : server->sock;
+		fds[0].events = ZSOCK_POLLIN;
+		fds[0].revents = 0;
+
+		ret = zsock_poll(fds, ARRAY_SIZE(fds),
+				 server_poll_timeout(server, k_uptime_get()));
+		if (ret < 0) {
+			NET_ERR("Poll failed (%d)", errno);
+			break;
+		}
+
+		for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+			client = &server->clients[i];
+
+			if (client->sock < 0 || fds[i + 1].revents == 0) {
+				continue;
+			}
+
+			ret = 0;
+
+			if (fds[i + 1].revents & ZSOCK_POLLIN) {
+				ret = client_recv(client);
+			} else if (fds[i + 1].revents & ZSOCK_POLLNVAL) {
+				ret = -EBADF;
+			} else if (!(fds[i + 1].revents & ZSOCK_POLLOUT)) {
+				ret = -ECONNRESET;
+			}
+
+			if (ret == 0) {
+				ret = client_process(client);
+			}
+
+			if (ret < 0 && ret != -EAGAIN) {
+				client_close(client);
+			}
+		}
+
+		if (fds[0].revents & ZSOCK_POLLIN) {
+			server_accept(server);
+		}
+
+		now = k_uptime_get();
+
+		for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+			client = &server->clients[i];
+
+			if (client->sock >= 0 &&
+			    now - client->last_activity >=
+			    CONFIG_HTTP_SERVER_IDLE_TIMEOUT) {
+				NET_DBG("Connection %d idle", client->sock);
+				client_close(client);
+			}
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+		if (server->clients[i].sock >= 0) {
+			client_close(&server->clients[i]);
+		}
+	}
+}
+
+int http_server_start(struct http_server *server,
+		      const struct http_server_config *config)
+{
+	struct sockaddr addr;
+	socklen_t addrlen;
+	int optval = 1;
+	int ret;
+	int i;
+
+	if (server == NULL || config == NULL ||
+	    (config->resource_count > 0 && config->resources == NULL)) {
+		return -EINVAL;
+	}
+
+	if (server->running) {
+		return -EALREADY;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && config->family == AF_INET6) {
+		net_sin6(&addr)->sin6_family = AF_INET6;
+		net_sin6(&addr)->sin6_port = htons(config->port);
+		addrlen = sizeof(struct sockaddr_in6);
+	} else if (IS_ENABLED(CONFIG_NET_IPV4) && config->family == AF_INET) {
+		net_sin(&addr)->sin_family = AF_INET;
+		net_sin(&addr)->sin_port = htons(config->port);
+		addrlen = sizeof(struct sockaddr_in);
+	} else {
+		return -EAFNOSUPPORT;
+	}
+
+	server->sock = zsock_socket(config->family, SOCK_STREAM, IPPROTO_TCP);
+	if (server->sock < 0) {
+		return -errno;
+	}
+
+	(void)zsock_setsockopt(server->sock, SOL_SOCKET, SO_REUSEADDR,
+			       &optval, sizeof(optval));
+
+	ret = zsock_bind(server->sock, &addr, addrlen);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	ret = zsock_listen(server->sock, CONFIG_HTTP_SERVER_MAX_CLIENTS);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	server->config = config;
+	server_init_parser(server);
+
+	for (i = 0; i < ARRAY_SIZE(server->clients); i++) {
+		server->clients[i].sock = -1;
+	}
+
+	server->running = true;
+
+	k_thread_create(&server->thread, server->stack,
+			K_KERNEL_STACK_SIZEOF(server->stack), server_loop,
+			server, NULL, NULL, THREAD_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&server->thread, "http_server");
+
+	NET_DBG("Listening on port %u", config->port);
+
+	return 0;
+
+fail:
+	ret = -errno;
+	(void)zsock_close(server->sock);
+	server->sock = -1;
+
+	return ret;
+}
+
+int http_server_stop(struct http_server *server)
+{
+	if (server == NULL) {
+		return -EINVAL;
+	}
+
+	if (!server->running) {
+		return -EALREADY;
+	}
+
+	server->running = false;
+
+	(void)k_thread_join(&server->thread, K_FOREVER);
+
+	(void)zsock_close(server->sock);
+	server->sock = -1;
+
+	return 0;
+}
+
+int http_server_respond(struct http_server_client *client, uint16_t status,
+			const char *content_type, const void *body, size_t len)
+{
+	int ret;
+
+	if (client == NULL || client->header_len > 0) {
+		return -EINVAL;
+	}
+
+	ret = client_header(client, status, content_type, NULL, NULL, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (client->parser.method != HTTP_HEAD) {
+		client->tx_data = body;
+		client->tx_len = len;
+	}
+
+	return client_send_blocking(client);
+}
+
+int http_server_respond_begin(struct http_server_client *client,
+			      uint16_t status, const char *content_type)
+{
+	if (client == NULL || client->header_len > 0) {
+		return -EINVAL;
+	}
+
+	if (client->parser.http_major == 1 && client->parser.http_minor == 0) {
+		/* No chunked encoding, the body ends with the connection */
+		client->keep_alive = 0;
+	} else {
+		client->chunked = 1;
+	}
+
+	return client_header(client, status, content_type, NULL, NULL, -1);
+}
+
+int http_server_respond_chunk(struct http_server_client *client,
+			      const void *data, size_t len)
+{
+	int ret;
+
+	if (client == NULL || client->header_len == 0) {
+		return -EINVAL;
+	}
+
+	if (!client->chunked) {
+		if (len == 0) {
+			return 0;
+		}
+
+		client->tx_data = data;
+		client->tx_len = len;
+
+		return client_send_blocking(client);
+	}
+
+	if (client->header_sent == client->header_len) {
+		/* Response header already sent, reuse its buffer */
+		client->header_len = 0;
+		client->header_sent = 0;
+	}
+
+	/* The end of the previous chunk is sent with this one */
+	ret = header_append(client, "%s%zx" CRLF "%s",
+			    client->chunk_open ? CRLF : "", len,
+			    len == 0 ? CRLF : "");
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (len == 0) {
+		client->chunked = 0;
+		client->chunk_open = 0;
+	} else {
+		client->chunk_open = 1;
+		client->tx_data = data;
+		client->tx_len = len;
+	}
+
+	return client_send_blocking(client);
+}
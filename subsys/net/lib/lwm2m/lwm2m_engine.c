@@ -96,10 +96,21 @@ static sys_slist_t engine_service_list;
 static K_KERNEL_STACK_DEFINE(engine_thread_stack, CONFIG_LWM2M_ENGINE_STACK_SIZE);
 static struct k_thread engine_thread_data;
 
+#if defined(CONFIG_LWM2M_ENGINE_EVENT_DRIVEN)
+/* The last poll entry is used by the wake up socket */
+#define MAX_POLL_FD (CONFIG_NET_SOCKETS_POLL_MAX - 1)
+
+/* Longest sleep, when no timer is running */
+#define ENGINE_MAX_SLEEP_MS INT32_MAX
+
+/* The engine thread polls wake_fds[1], wake_fds[0] is written to wake it up */
+static int wake_fds[2] = { -1, -1 };
+#else
 #define MAX_POLL_FD CONFIG_NET_SOCKETS_POLL_MAX
+#endif
 
 /* Resources */
-static struct pollfd sock_fds[MAX_POLL_FD];
+static struct pollfd sock_fds[MAX_POLL_FD + 1];
 
 static struct lwm2m_ctx *sock_ctx[MAX_POLL_FD];
 static int sock_nfds;
@@ -272,6 +283,8 @@ int lwm2m_push_queued_buffers(struct lwm2m_ctx *client_ctx)
 		msg = SYS_SLIST_CONTAINER(msg_node, msg, node);
 		sys_slist_append(&msg->ctx->pending_sends, &msg->node);
 	}
+
+	lwm2m_engine_wake_up();
 #endif
 	return 0;
 }
@@ -496,6 +509,29 @@ int lwm2m_engine_update_service_period(k_work_handler_t service, uint32_t period
 	return -ENOENT;
 }
 
+void lwm2m_engine_wake_up(void)
+{
+#if defined(CONFIG_LWM2M_ENGINE_EVENT_DRIVEN)
+	static const uint8_t event;
+
+	if (wake_fds[0] >= 0) {
+		/* EAGAIN means a wake up is pending already */
+		(void)send(wake_fds[0], &event, sizeof(event), 0);
+	}
+#endif
+}
+
+static int32_t engine_max_sleep_ms(void)
+{
+#if defined(CONFIG_LWM2M_ENGINE_EVENT_DRIVEN)
+	if (wake_fds[1] >= 0) {
+		return ENGINE_MAX_SLEEP_MS;
+	}
+#endif
+
+	return ENGINE_UPDATE_INTERVAL_MS;
+}
+
 static int32_t lwm2m_engine_service(const int64_t timestamp)
 {
 	struct service_node *srv;
@@ -511,7 +547,7 @@ static int32_t lwm2m_engine_service(const int64_t timestamp)
 	}
 
 	/* calculate how long to sleep till the next service */
-	return engine_next_service_timeout_ms(ENGINE_UPDATE_INTERVAL_MS, timestamp);
+	return engine_next_service_timeout_ms(engine_max_sleep_ms(), timestamp);
 }
 
 /* LwM2M Socket Integration */
@@ -527,6 +563,8 @@ int lwm2m_socket_add(struct lwm2m_ctx *ctx)
 	sock_fds[sock_nfds].events = POLLIN;
 	sock_nfds++;
 
+	lwm2m_engine_wake_up();
+
 	return 0;
 }
 
@@ -537,6 +575,7 @@ static void lwm2m_socket_update(struct lwm2m_ctx *ctx)
 			continue;
 		}
 		sock_fds[i].fd = ctx->sock_fd;
+		lwm2m_engine_wake_up();
 		return;
 	}
 }
@@ -560,37 +599,50 @@ void lwm2m_socket_del(struct lwm2m_ctx *ctx)
 		/* Remove the last entry. */
 		sock_ctx[sock_nfds] = NULL;
 		sock_fds[sock_nfds].fd = -1;
+		lwm2m_engine_wake_up();
 		break;
 	}
 }
 
-static void check_notifications(struct lwm2m_ctx *ctx, const int64_t timestamp)
+/* Returns the time of the next notification, INT64_MAX if there is none */
+int64_t lwm2m_engine_check_notifications(struct lwm2m_ctx *ctx, const int64_t timestamp)
 {
 	struct observe_node *obs;
+	int64_t next = INT64_MAX;
+	bool created = false;
 	int rc;
 
 	SYS_SLIST_FOR_EACH_CONTAINER(&ctx->observer, obs, node) {
-		if (!obs->event_timestamp || timestamp < obs->event_timestamp) {
+		/* Check That There is not pending process */
+		if (!obs->event_timestamp || obs->active_tx_operation) {
 			continue;
 		}
-		/* Check That There is not pending process*/
-		if (obs->active_tx_operation) {
+
+		/* Create at most one notification, the other ones due are
+		 * created once it has been sent.
+		 */
+		if (timestamp < obs->event_timestamp || created) {
+			next = MIN(next, obs->event_timestamp);
 			continue;
 		}
 
 		rc = generate_notify_message(ctx, obs, NULL);
 		if (rc == -ENOMEM) {
 			/* no memory/messages available, retry later */
-			return;
+			return timestamp + ENGINE_UPDATE_INTERVAL_MS;
 		}
 		obs->event_timestamp =
 			engine_observe_shedule_next_event(obs, ctx->srv_obj_inst, timestamp);
 		obs->last_timestamp = timestamp;
 		if (!rc) {
-			/* create at most one notification */
-			return;
+			/* The next event of this one counts once it is acked */
+			created = true;
+		} else if (obs->event_timestamp) {
+			next = MIN(next, obs->event_timestamp);
 		}
 	}
+
+	return next;
 }
 
 static int socket_recv_message(struct lwm2m_ctx *client_ctx)
@@ -648,11 +700,50 @@ static void socket_reset_pollfd_events(void)
 	}
 }
 
+#if defined(CONFIG_LWM2M_ENGINE_EVENT_DRIVEN)
+/* Add the wake up socket after the others, return the number of entries */
+static int socket_poll_nfds(void)
+{
+	if (wake_fds[1] < 0) {
+		return sock_nfds;
+	}
+
+	sock_fds[sock_nfds].fd = wake_fds[1];
+	sock_fds[sock_nfds].events = POLLIN;
+	sock_fds[sock_nfds].revents = 0;
+
+	return sock_nfds + 1;
+}
+
+static void socket_wake_up_clear(int nfds)
+{
+	uint8_t events[8];
+
+	if (nfds < 1 || sock_fds[nfds - 1].fd != wake_fds[1] ||
+	    !(sock_fds[nfds - 1].revents & POLLIN)) {
+		return;
+	}
+
+	while (recv(wake_fds[1], events, sizeof(events), 0) > 0) {
+	}
+}
+#else
+static int socket_poll_nfds(void)
+{
+	return sock_nfds;
+}
+
+static void socket_wake_up_clear(int nfds)
+{
+	ARG_UNUSED(nfds);
+}
+#endif
+
 /* LwM2M main work loop */
 static void socket_loop(void)
 {
-	int i, rc;
-	int64_t timestamp;
+	int i, rc, nfds;
+	int64_t timestamp, next_notify;
 	int32_t timeout, next_retransmit;
 
 	while (1) {
@@ -672,7 +763,7 @@ static void socket_loop(void)
 		timeout = lwm2m_engine_service(timestamp);
 
 		/* wait for sockets */
-		if (sock_nfds < 1) {
+		if (sock_nfds < 1 && socket_poll_nfds() < 1) {
 			k_msleep(timeout);
 			continue;
 		}
@@ -686,17 +777,22 @@ static void socket_loop(void)
 			}
 			if (sys_slist_is_empty(&sock_ctx[i]->pending_sends) &&
 			    lwm2m_rd_client_is_registred(sock_ctx[i])) {
-				check_notifications(sock_ctx[i], timestamp);
+				next_notify = lwm2m_engine_check_notifications(sock_ctx[i],
+										 timestamp);
+				if (next_notify - timestamp < timeout) {
+					timeout = MAX(next_notify - timestamp, 0);
+				}
 			}
 		}
 
 		socket_reset_pollfd_events();
+		nfds = socket_poll_nfds();
 
 		/*
-		 * FIXME: Currently we timeout and restart poll in case fds
-		 *        were modified.
+		 * Without the wake up socket, we timeout and restart poll in
+		 * case fds were modified.
 		 */
-		rc = poll(sock_fds, sock_nfds, timeout);
+		rc = poll(sock_fds, nfds, timeout);
 		if (rc < 0) {
 			LOG_ERR("Error in poll:%d", errno);
 			errno = 0;
@@ -704,6 +800,8 @@ static void socket_loop(void)
 			continue;
 		}
 
+		socket_wake_up_clear(nfds);
+
 		for (i = 0; i < sock_nfds; i++) {
 
 			if (sock_ctx[i]->sock_fd < 0) {
@@ -951,6 +1049,7 @@ int lwm2m_engine_pause(void)
 	}
 
 	suspend_engine_thread = true;
+	lwm2m_engine_wake_up();
 
 	while (strcmp(str, "suspended")) {
 		k_msleep(10);
@@ -987,6 +1086,18 @@ static int lwm2m_engine_init(const struct device *dev)
 
 	(void)memset(block1_contexts, 0, sizeof(block1_contexts));
 
+#if defined(CONFIG_LWM2M_ENGINE_EVENT_DRIVEN)
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, wake_fds) < 0) {
+		/* Fall back to waking up periodically */
+		LOG_ERR("Cannot create wake up socketpair (%d)", errno);
+		wake_fds[0] = -1;
+		wake_fds[1] = -1;
+	} else {
+		(void)fcntl(wake_fds[0], F_SETFL, O_NONBLOCK);
+		(void)fcntl(wake_fds[1], F_SETFL, O_NONBLOCK);
+	}
+#endif
+
 	/* start sock receive thread */
 	engine_thread_id = k_thread_create(&engine_thread_data, &engine_thread_stack[0],
 			K_KERNEL_STACK_SIZEOF(engine_thread_stack), (k_thread_entry_t)socket_loop,
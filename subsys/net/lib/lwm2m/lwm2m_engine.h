@@ -40,6 +40,8 @@ int lwm2m_engine_validate_write_access(struct lwm2m_message *msg,
 /* LwM2M context functions */
 void lwm2m_engine_context_close(struct lwm2m_ctx *client_ctx);
 void lwm2m_engine_context_init(struct lwm2m_ctx *client_ctx);
+/* Create the notifications due, returns the time of the next one */
+int64_t lwm2m_engine_check_notifications(struct lwm2m_ctx *ctx, const int64_t timestamp);
 
 /* Message buffer functions */
 uint8_t *lwm2m_get_message_buf(void);
@@ -56,6 +58,9 @@ int bootstrap_delete(struct lwm2m_message *msg);
 
 int lwm2m_engine_add_service(k_work_handler_t service, uint32_t period_ms);
 
+/* Make the engine thread check its sockets, messages and timers again */
+void lwm2m_engine_wake_up(void);
+
 int lwm2m_security_inst_id_to_index(uint16_t obj_inst_id);
 int lwm2m_security_index_to_inst_id(int index);
 
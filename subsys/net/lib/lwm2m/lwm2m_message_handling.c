@@ -207,6 +207,8 @@ void lwm2m_engine_context_init(struct lwm2m_ctx *client_ctx)
 	sys_slist_init(&client_ctx->pending_sends);
 	sys_slist_init(&client_ctx->observer);
 	client_ctx->connection_suspended = false;
+	client_ctx->notify_messages = 0U;
+	client_ctx->notify_paths = 0U;
 #if defined(CONFIG_LWM2M_QUEUE_MODE_ENABLED)
 	client_ctx->buffer_client_messages = true;
 	sys_slist_init(&client_ctx->queued_messages);
@@ -401,6 +403,7 @@ int lwm2m_send_message_async(struct lwm2m_message *msg)
 	}
 #endif
 	sys_slist_append(&msg->ctx->pending_sends, &msg->node);
+	lwm2m_engine_wake_up();
 
 	if (IS_ENABLED(CONFIG_LWM2M_RD_CLIENT_SUPPORT) &&
 	    IS_ENABLED(CONFIG_LWM2M_QUEUE_MODE_ENABLED)) {
@@ -426,6 +429,7 @@ int lwm2m_information_interface_send(struct lwm2m_message *msg)
 	}
 #endif
 	sys_slist_append(&msg->ctx->pending_sends, &msg->node);
+	lwm2m_engine_wake_up();
 
 	if (IS_ENABLED(CONFIG_LWM2M_RD_CLIENT_SUPPORT) &&
 	    IS_ENABLED(CONFIG_LWM2M_QUEUE_MODE_ENABLED)) {
@@ -2452,9 +2456,20 @@ int generate_notify_message(struct lwm2m_ctx *ctx, struct observe_node *obs, voi
 		goto cleanup;
 	}
 
+	/* The message is released by this on failure, and the resource
+	 * update stays pending for the next notification.
+	 */
+	ret = lwm2m_information_interface_send(msg);
+	if (ret < 0) {
+		LOG_ERR("Unable to send notification (err:%d)", ret);
+		return ret;
+	}
+
 	obs->active_tx_operation = true;
 	obs->resource_update = false;
-	lwm2m_information_interface_send(msg);
+
+	ctx->notify_messages++;
+	ctx->notify_paths += engine_path_list_size(&obs->path_list);
 
 	LOG_DBG("NOTIFY MSG: SENT");
 	return 0;
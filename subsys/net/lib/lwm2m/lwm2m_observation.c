@@ -371,6 +371,12 @@ int lwm2m_notify_observer_path(struct lwm2m_obj_path *path)
 					timestamp = k_uptime_get();
 				}
 
+				/* Give the other resources changed at the same time a
+				 * chance to be reported with this one.
+				 */
+				timestamp = MAX(timestamp, k_uptime_get() +
+							   CONFIG_LWM2M_ENGINE_NOTIFY_WINDOW_MS);
+
 				if (!obs->event_timestamp || obs->event_timestamp > timestamp) {
 					obs->resource_update = true;
 					obs->event_timestamp = timestamp;
@@ -383,6 +389,10 @@ int lwm2m_notify_observer_path(struct lwm2m_obj_path *path)
 		}
 	}
 
+	if (ret > 0) {
+		lwm2m_engine_wake_up();
+	}
+
 	return ret;
 }
 
@@ -517,7 +527,7 @@ static bool engine_compare_obs_path_list(sys_slist_t *obs_path_list, sys_slist_t
 	return true;
 }
 
-static int engine_path_list_size(sys_slist_t *lwm2m_path_list)
+int engine_path_list_size(sys_slist_t *lwm2m_path_list)
 {
 	int list_size = 0;
 	struct lwm2m_obj_path_list *entry;
@@ -45,6 +45,8 @@ struct observe_node *engine_observe_node_discover(sys_slist_t *observe_node_list
 
 int engine_remove_observer_by_token(struct lwm2m_ctx *ctx, const uint8_t *token, uint8_t tkl);
 
+int engine_path_list_size(sys_slist_t *lwm2m_path_list);
+
 int lwm2m_write_attr_handler(struct lwm2m_engine_obj *obj, struct lwm2m_message *msg);
 
 int lwm2m_engine_observation_handler(struct lwm2m_message *msg, int observe, uint16_t accept,
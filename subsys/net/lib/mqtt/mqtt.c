@@ -167,6 +167,22 @@ static int client_write_msg(struct mqtt_client *client,
 	return 0;
 }
 
+#if defined(CONFIG_MQTT_SESSION)
+static int client_session_flush(struct mqtt_client *client)
+{
+	int err_code;
+
+	err_code = mqtt_session_flush(client);
+	if (err_code < 0) {
+		NET_ERR("Transport write failed, err_code = %d, "
+			 "closing connection", err_code);
+		client_disconnect(client, err_code, true);
+	}
+
+	return err_code;
+}
+#endif
+
 void mqtt_client_init(struct mqtt_client *client)
 {
 	NULL_PARAM_CHECK_VOID(client);
@@ -261,6 +277,19 @@ int mqtt_publish(struct mqtt_client *client,
 		goto error;
 	}
 
+#if defined(CONFIG_MQTT_SESSION)
+	if (mqtt_session_enabled(client) &&
+	    param->message.topic.qos > MQTT_QOS_0_AT_MOST_ONCE) {
+		err_code = mqtt_session_store(client, param);
+		if (err_code < 0) {
+			goto error;
+		}
+
+		err_code = client_session_flush(client);
+		goto error;
+	}
+#endif
+
 	err_code = publish_encode(param, &packet);
 	if (err_code < 0) {
 		goto error;
@@ -382,6 +411,14 @@ int mqtt_publish_qos2_release(struct mqtt_client *client,
 		goto error;
 	}
 
+#if defined(CONFIG_MQTT_SESSION)
+	/* The session sends the PUBREL of its messages itself. */
+	if (mqtt_session_enabled(client) &&
+	    mqtt_session_has_msg(client, param->message_id)) {
+		goto error;
+	}
+#endif
+
 	err_code = publish_release_encode(param, &packet);
 	if (err_code < 0) {
 		goto error;
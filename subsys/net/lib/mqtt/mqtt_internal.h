@@ -393,6 +393,69 @@ int subscribe_ack_decode(struct buf_ctx *buf,
 int unsubscribe_ack_decode(struct buf_ctx *buf,
 			   struct mqtt_unsuback_param *param);
 
+#if defined(CONFIG_MQTT_SESSION)
+/**@brief Check if the outbound session is used by the client.
+ *
+ * @param[in] client Identifies the client.
+ *
+ * @return true if the client has a session buffer.
+ */
+static inline bool mqtt_session_enabled(const struct mqtt_client *client)
+{
+	return client->session_buf != NULL;
+}
+
+/**@brief Store a QoS 1 or QoS 2 publish message in the session.
+ *
+ * @param[in] client Identifies the client.
+ * @param[in] param Publish message to store, payload included.
+ *
+ * @return 0 if the message was stored, -EAGAIN if the session is full,
+ *         -EBUSY if the message id is in use or another error code.
+ */
+int mqtt_session_store(struct mqtt_client *client,
+		       const struct mqtt_publish_param *param);
+
+/**@brief Send the queued messages allowed by the in-flight window.
+ *
+ * @param[in] client Identifies the client.
+ *
+ * @return 0 if the procedure is successful, transport error code otherwise.
+ */
+int mqtt_session_flush(struct mqtt_client *client);
+
+/**@brief Handle an acknowledgement received from the broker.
+ *
+ * @param[in] client Identifies the client.
+ * @param[in] type MQTT_PKT_TYPE_PUBACK, MQTT_PKT_TYPE_PUBREC or
+ *                 MQTT_PKT_TYPE_PUBCOMP.
+ * @param[in] message_id Message id of the acknowledgement.
+ *
+ * @details Sends the PUBREL of a QoS 2 message, and the queued messages once
+ *          enough of the in-flight window is free. Acknowledgements for
+ *          messages not in the session are ignored.
+ *
+ * @return 0 if the procedure is successful, transport error code otherwise.
+ */
+int mqtt_session_ack(struct mqtt_client *client, uint8_t type,
+		     uint16_t message_id);
+
+/**@brief Check if the library takes care of releasing a QoS 2 message.
+ *
+ * @param[in] client Identifies the client.
+ * @param[in] message_id Message id of the message.
+ *
+ * @return true if the message is in the session.
+ */
+bool mqtt_session_has_msg(struct mqtt_client *client, uint16_t message_id);
+
+/**@brief Prepare the messages in flight to be sent again after reconnect.
+ *
+ * @param[in] client Identifies the client.
+ */
+void mqtt_session_reconnected(struct mqtt_client *client);
+#endif /* CONFIG_MQTT_SESSION */
+
 #ifdef __cplusplus
 }
 #endif
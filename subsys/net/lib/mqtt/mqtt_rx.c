@@ -16,6 +16,18 @@ LOG_MODULE_REGISTER(net_mqtt_rx, CONFIG_MQTT_LOG_LEVEL);
  * @brief MQTT Received data handling.
  */
 
+static int session_ack(struct mqtt_client *client, uint8_t type,
+		       uint16_t message_id)
+{
+#if defined(CONFIG_MQTT_SESSION)
+	if (mqtt_session_enabled(client)) {
+		return mqtt_session_ack(client, type, message_id);
+	}
+#endif
+
+	return 0;
+}
+
 static int mqtt_handle_packet(struct mqtt_client *client,
 			      uint8_t type_and_flags,
 			      uint32_t var_length,
@@ -42,6 +54,13 @@ static int mqtt_handle_packet(struct mqtt_client *client,
 						MQTT_CONNECTION_ACCEPTED) {
 				/* Set state. */
 				MQTT_SET_STATE(client, MQTT_STATE_CONNECTED);
+
+#if defined(CONFIG_MQTT_SESSION)
+				if (mqtt_session_enabled(client)) {
+					mqtt_session_reconnected(client);
+					err_code = mqtt_session_flush(client);
+				}
+#endif
 			} else {
 				err_code = -ECONNREFUSED;
 			}
@@ -77,6 +96,12 @@ static int mqtt_handle_packet(struct mqtt_client *client,
 		evt.type = MQTT_EVT_PUBACK;
 		err_code = publish_ack_decode(buf, &evt.param.puback);
 		evt.result = err_code;
+
+		if (err_code == 0) {
+			err_code = session_ack(client, MQTT_PKT_TYPE_PUBACK,
+					       evt.param.puback.message_id);
+		}
+
 		break;
 
 	case MQTT_PKT_TYPE_PUBREC:
@@ -85,6 +110,12 @@ static int mqtt_handle_packet(struct mqtt_client *client,
 		evt.type = MQTT_EVT_PUBREC;
 		err_code = publish_receive_decode(buf, &evt.param.pubrec);
 		evt.result = err_code;
+
+		if (err_code == 0) {
+			err_code = session_ack(client, MQTT_PKT_TYPE_PUBREC,
+					       evt.param.pubrec.message_id);
+		}
+
 		break;
 
 	case MQTT_PKT_TYPE_PUBREL:
@@ -101,6 +132,12 @@ static int mqtt_handle_packet(struct mqtt_client *client,
 		evt.type = MQTT_EVT_PUBCOMP;
 		err_code = publish_complete_decode(buf, &evt.param.pubcomp);
 		evt.result = err_code;
+
+		if (err_code == 0) {
+			err_code = session_ack(client, MQTT_PKT_TYPE_PUBCOMP,
+					       evt.param.pubcomp.message_id);
+		}
+
 		break;
 
 	case MQTT_PKT_TYPE_SUBACK:
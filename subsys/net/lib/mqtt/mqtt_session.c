@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/** @file mqtt_session.c
+ *
+ * @brief Outbound session keeping the QoS 1 and QoS 2 publish messages until
+ *        the broker has acknowledged them.
+ *
+ * The encoded messages are stored in the session buffer in the order they
+ * were published. The buffer is used as a ring in which a packet never wraps
+ * around the end, the space of a message is reclaimed once it and all the
+ * older messages have been acknowledged.
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_mqtt_session, CONFIG_MQTT_LOG_LEVEL);
+
+#include "mqtt_transport.h"
+#include "mqtt_internal.h"
+#include "mqtt_os.h"
+
+enum session_msg_state {
+	/** PUBLISH waiting to be sent. */
+	SESSION_MSG_QUEUED,
+
+	/** PUBLISH sent, waiting for PUBACK or PUBREC. */
+	SESSION_MSG_SENT,
+
+	/** PUBREC received, the packet was replaced by a PUBREL waiting to be
+	 *  sent.
+	 */
+	SESSION_MSG_RELEASE,
+
+	/** PUBREL sent, waiting for PUBCOMP. */
+	SESSION_MSG_RELEASED,
+
+	/** Acknowledged, waiting for the older messages to be acknowledged. */
+	SESSION_MSG_DONE,
+};
+
+/* Acknowledgements do not send more messages before the window is this
+ * empty, so that the queued messages are written in batches.
+ */
+#define SESSION_LOW_WATERMARK (CONFIG_MQTT_SESSION_INFLIGHT / 2)
+
+static inline struct mqtt_session *get_session(struct mqtt_client *client)
+{
+	return &client->internal.session;
+}
+
+static inline struct mqtt_session_msg *session_msg(struct mqtt_session *session,
+						   int idx)
+{
+	return &session->msgs[(session->head + idx) % ARRAY_SIZE(session->msgs)];
+}
+
+static struct mqtt_session_msg *session_find(struct mqtt_session *session,
+					     uint16_t message_id)
+{
+	struct mqtt_session_msg *msg;
+	int i;
+
+	for (i = 0; i < session->count; i++) {
+		msg = session_msg(session, i);
+
+		if (msg->state != SESSION_MSG_DONE &&
+		    msg->message_id == message_id) {
+			return msg;
+		}
+	}
+
+	return NULL;
+}
+
+/**@brief Free the acknowledged messages at the head of the session. */
+static void session_reclaim(struct mqtt_session *session)
+{
+	while (session->count > 0U &&
+	       session_msg(session, 0)->state == SESSION_MSG_DONE) {
+		session->head = (session->head + 1) % ARRAY_SIZE(session->msgs);
+		session->count--;
+	}
+
+	if (session->count == 0U) {
+		session->tail = 0U;
+	}
+}
+
+/**@brief Find len contiguous bytes after the newest message. */
+static bool session_alloc(struct mqtt_client *client, uint32_t len,
+			  uint32_t *offset)
+{
+	struct mqtt_session *session = get_session(client);
+	uint32_t head;
+
+	if (session->count == 0U) {
+		*offset = 0U;
+		return true;
+	}
+
+	head = session_msg(session, 0)->offset;
+
+	if (session->tail > head) {
+		/* Used space does not wrap, try the end and then the start */
+		if (len <= client->session_buf_size - session->tail) {
+			*offset = session->tail;
+			return true;
+		}
+
+		if (len <= head) {
+			*offset = 0U;
+			return true;
+		}
+
+		return false;
+	}
+
+	/* Used space wraps, the free space is between tail and head */
+	if (len <= head - session->tail) {
+		*offset = session->tail;
+		return true;
+	}
+
+	return false;
+}
+
+int mqtt_session_store(struct mqtt_client *client,
+		       const struct mqtt_publish_param *param)
+{
+	struct mqtt_session *session = get_session(client);
+	struct mqtt_session_msg *msg;
+	struct buf_ctx packet;
+	uint32_t offset, len, header_len;
+	uint8_t *start;
+	int err_code;
+
+	if (param->message_id == 0U) {
+		return -EINVAL;
+	}
+
+	if (param->message.payload.len > MQTT_MAX_PAYLOAD_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	if (session_find(session, param->message_id) != NULL) {
+		return -EBUSY;
+	}
+
+	/* The fixed header may end up shorter than this. */
+	len = MQTT_FIXED_HEADER_MAX_SIZE +
+	      GET_UT8STR_BUFFER_SIZE(&param->message.topic.topic) +
+	      sizeof(uint16_t) + param->message.payload.len;
+	if (len > client->session_buf_size) {
+		return -EMSGSIZE;
+	}
+
+	if (session->count >= ARRAY_SIZE(session->msgs) ||
+	    !session_alloc(client, len, &offset)) {
+		return -EAGAIN;
+	}
+
+	start = client->session_buf + offset;
+	packet.cur = start;
+	packet.end = start + len;
+
+	err_code = publish_encode(param, &packet);
+	if (err_code < 0) {
+		return err_code;
+	}
+
+	/* Keep the packets back to back so that they can be written with a
+	 * single I/O vector.
+	 */
+	header_len = packet.end - packet.cur;
+	memmove(start, packet.cur, header_len);
+
+	if (param->message.payload.len > 0U) {
+		memcpy(start + header_len, param->message.payload.data,
+		       param->message.payload.len);
+	}
+
+	msg = session_msg(session, session->count);
+	msg->offset = offset;
+	msg->len = header_len + param->message.payload.len;
+	msg->message_id = param->message_id;
+	msg->qos = param->message.topic.qos;
+	msg->state = SESSION_MSG_QUEUED;
+
+	session->tail = offset + msg->len;
+	session->count++;
+
+	NET_DBG("[CID %p]: Stored message id 0x%04x, %u messages", client,
+		msg->message_id, session->count);
+
+	return 0;
+}
+
+static int session_write(struct mqtt_client *client, struct iovec *io_vector,
+			 int count)
+{
+	struct msghdr message;
+	int err_code;
+
+	memset(&message, 0, sizeof(message));
+
+	message.msg_iov = io_vector;
+	message.msg_iovlen = count;
+
+	NET_DBG("[CID %p]: Writing %d vectors", client, count);
+
+	err_code = mqtt_transport_write_msg(client, &message);
+	if (err_code < 0) {
+		return err_code;
+	}
+
+	client->internal.last_activity = mqtt_sys_tick_in_ms_get();
+
+	return 0;
+}
+
+int mqtt_session_flush(struct mqtt_client *client)
+{
+	struct mqtt_session *session = get_session(client);
+	struct iovec io_vector[CONFIG_MQTT_SESSION_MAX_BATCH];
+	struct mqtt_session_msg *msg;
+	int count = 0;
+	uint8_t *data;
+	int err_code;
+	int i;
+
+	if (!MQTT_HAS_STATE(client, MQTT_STATE_CONNECTED)) {
+		return 0;
+	}
+
+	for (i = 0; i < session->count; i++) {
+		msg = session_msg(session, i);
+
+		if (msg->state == SESSION_MSG_QUEUED &&
+		    session->inflight < CONFIG_MQTT_SESSION_INFLIGHT) {
+			msg->state = SESSION_MSG_SENT;
+			session->inflight++;
+		} else if (msg->state == SESSION_MSG_RELEASE) {
+			msg->state = SESSION_MSG_RELEASED;
+		} else {
+			continue;
+		}
+
+		data = client->session_buf + msg->offset;
+
+		if (count > 0 &&
+		    (uint8_t *)io_vector[count - 1].iov_base +
+		    io_vector[count - 1].iov_len == data) {
+			io_vector[count - 1].iov_len += msg->len;
+			continue;
+		}
+
+		if (count == ARRAY_SIZE(io_vector)) {
+			err_code = session_write(client, io_vector, count);
+			if (err_code < 0) {
+				return err_code;
+			}
+
+			count = 0;
+		}
+
+		io_vector[count].iov_base = data;
+		io_vector[count].iov_len = msg->len;
+		count++;
+	}
+
+	if (count > 0) {
+		return session_write(client, io_vector, count);
+	}
+
+	return 0;
+}
+
+/**@brief Replace the stored PUBLISH with the PUBREL that follows it. */
+static void session_msg_release(struct mqtt_client *client,
+				struct mqtt_session_msg *msg)
+{
+	const struct mqtt_pubrel_param param = {
+		.message_id = msg->message_id,
+	};
+	uint8_t pubrel[MQTT_FIXED_HEADER_MAX_SIZE + sizeof(uint16_t)];
+	struct buf_ctx packet = {
+		.cur = pubrel,
+		.end = pubrel + sizeof(pubrel),
+	};
+
+	(void)publish_release_encode(&param, &packet);
+
+	/* A stored PUBLISH is always longer than a PUBREL. */
+	msg->len = packet.end - packet.cur;
+	memcpy(client->session_buf + msg->offset, packet.cur, msg->len);
+}
+
+int mqtt_session_ack(struct mqtt_client *client, uint8_t type,
+		     uint16_t message_id)
+{
+	struct mqtt_session *session = get_session(client);
+	struct mqtt_session_msg *msg;
+
+	msg = session_find(session, message_id);
+	if (msg == NULL) {
+		/* Not published through the session. */
+		return 0;
+	}
+
+	switch (type) {
+	case MQTT_PKT_TYPE_PUBACK:
+		if (msg->qos != MQTT_QOS_1_AT_LEAST_ONCE ||
+		    msg->state != SESSION_MSG_SENT) {
+			return 0;
+		}
+
+		break;
+
+	case MQTT_PKT_TYPE_PUBREC:
+		if (msg->qos != MQTT_QOS_2_EXACTLY_ONCE) {
+			return 0;
+		}
+
+		if (msg->state == SESSION_MSG_SENT) {
+			session_msg_release(client, msg);
+		} else if (msg->state != SESSION_MSG_RELEASED) {
+			return 0;
+		}
+
+		/* Send the PUBREL now, or again on a duplicate PUBREC. */
+		msg->state = SESSION_MSG_RELEASE;
+
+		return mqtt_session_flush(client);
+
+	case MQTT_PKT_TYPE_PUBCOMP:
+		if (msg->state != SESSION_MSG_RELEASED) {
+			return 0;
+		}
+
+		break;
+
+	default:
+		return 0;
+	}
+
+	msg->state = SESSION_MSG_DONE;
+	session->inflight--;
+
+	session_reclaim(session);
+
+	NET_DBG("[CID %p]: Message id 0x%04x done, %u in flight", client,
+		message_id, session->inflight);
+
+	if (session->inflight > SESSION_LOW_WATERMARK) {
+		return 0;
+	}
+
+	return mqtt_session_flush(client);
+}
+
+bool mqtt_session_has_msg(struct mqtt_client *client, uint16_t message_id)
+{
+	return session_find(get_session(client), message_id) != NULL;
+}
+
+void mqtt_session_reconnected(struct mqtt_client *client)
+{
+	struct mqtt_session *session = get_session(client);
+	struct mqtt_session_msg *msg;
+	int i;
+
+	session->inflight = 0U;
+
+	for (i = 0; i < session->count; i++) {
+		msg = session_msg(session, i);
+
+		switch (msg->state) {
+		case SESSION_MSG_SENT:
+			/* MQTT 3.1.1 ch. 4.4, PUBLISH is sent again with the
+			 * DUP flag set.
+			 */
+			client->session_buf[msg->offset] |= MQTT_HEADER_DUP_MASK;
+			msg->state = SESSION_MSG_QUEUED;
+			break;
+
+		case SESSION_MSG_RELEASE:
+		case SESSION_MSG_RELEASED:
+			if (client->clean_session) {
+				/* The broker has no state for the message. */
+				msg->state = SESSION_MSG_DONE;
+				break;
+			}
+
+			msg->state = SESSION_MSG_RELEASE;
+			session->inflight++;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	session_reclaim(session);
+
+	NET_DBG("[CID %p]: %u messages to send again", client, session->count);
+}
+
+int mqtt_session_pending(struct mqtt_client *client)
+{
+	struct mqtt_session *session;
+	int pending = 0;
+	int i;
+
+	NULL_PARAM_CHECK(client);
+
+	mqtt_mutex_lock(client);
+
+	session = get_session(client);
+
+	for (i = 0; i < session->count; i++) {
+		if (session_msg(session, i)->state != SESSION_MSG_DONE) {
+			pending++;
+		}
+	}
+
+	mqtt_mutex_unlock(client);
+
+	return pending;
+}
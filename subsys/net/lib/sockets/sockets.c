@@ -248,6 +248,8 @@ static inline int z_vrfy_zsock_socket(int family, int type, int proto)
 
 int zsock_close_ctx(struct net_context *ctx)
 {
+	zsock_epoll_ctx_closed(ctx);
+
 	/* Reset callbacks to avoid any race conditions while
 	 * flushing queues. No need to check return values here,
 	 * as these are fail-free operations and we're closing
@@ -352,6 +354,7 @@ static void zsock_accepted_cb(struct net_context *new_ctx,
 		k_condvar_init(&new_ctx->cond.recv);
 
 		k_fifo_put(&parent->accept_q, new_ctx);
+		zsock_epoll_notify(parent);
 
 		/* TCP context is effectively owned by both application
 		 * and the stack: stack may detect that peer closed/aborted
@@ -417,6 +420,8 @@ unlock:
 
 	/* Let reader to wake if it was sleeping */
 	(void)k_condvar_signal(&ctx->cond.recv);
+
+	zsock_epoll_notify(ctx);
 }
 
 int zsock_shutdown_ctx(struct net_context *ctx, int how)
@@ -434,6 +439,8 @@ int zsock_shutdown_ctx(struct net_context *ctx, int how)
 
 		/* Let reader to wake if it was sleeping */
 		(void)k_condvar_signal(&ctx->cond.recv);
+
+		zsock_epoll_notify(ctx);
 	} else if (how == ZSOCK_SHUT_WR || how == ZSOCK_SHUT_RDWR) {
 		SET_ERRNO(-ENOTSUP);
 	} else {
@@ -1087,6 +1094,43 @@ void net_socket_update_tc_rx_time(struct net_pkt *pkt, uint32_t end_tick)
 	}
 }
 
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+/* Poll the interface in the calling thread until data is received or the
+ * busy poll time of the socket expires. Called without the socket lock, the
+ * received packets are processed up to this socket while polling.
+ */
+static void zsock_busy_poll(struct net_context *ctx)
+{
+	struct net_if *iface;
+	uint32_t start, poll_cycles;
+	int ret;
+
+	iface = net_context_get_iface(ctx);
+	if (iface == NULL) {
+		iface = net_if_get_default();
+	}
+
+	poll_cycles = k_us_to_cyc_ceil32(ctx->options.busy_poll);
+	start = k_cycle_get_32();
+
+	while (k_fifo_is_empty(&ctx->recv_q)) {
+		ret = net_if_busy_poll(iface, ctx,
+				       CONFIG_NET_CONTEXT_BUSY_POLL_BUDGET);
+		if (ret < 0) {
+			break;
+		}
+
+		if (sock_is_eof(ctx) || sock_is_error(ctx)) {
+			break;
+		}
+
+		if (k_cycle_get_32() - start >= poll_cycles) {
+			break;
+		}
+	}
+}
+#endif /* CONFIG_NET_CONTEXT_BUSY_POLL */
+
 int zsock_wait_data(struct net_context *ctx, k_timeout_t *timeout)
 {
 	if (ctx->cond.lock == NULL) {
@@ -1099,6 +1143,15 @@ int zsock_wait_data(struct net_context *ctx, k_timeout_t *timeout)
 		return -EINVAL;
 	}
 
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+	if (ctx->options.busy_poll > 0U && !K_TIMEOUT_EQ(*timeout, K_NO_WAIT)) {
+		/* Do not keep the RX path of the socket waiting while polling */
+		(void)k_mutex_unlock(ctx->cond.lock);
+		zsock_busy_poll(ctx);
+		(void)k_mutex_lock(ctx->cond.lock, K_FOREVER);
+	}
+#endif
+
 	if (k_fifo_is_empty(&ctx->recv_q)) {
 		/* Wait for the data to arrive but without holding a lock */
 		return k_condvar_wait(&ctx->cond.recv, ctx->cond.lock,
@@ -1797,6 +1850,20 @@ static inline int z_vrfy_zsock_inet_pton(sa_family_t family,
 #include <syscalls/zsock_inet_pton_mrsh.c>
 #endif
 
+static enum tcp_conn_option tcp_keepalive_option(int optname)
+{
+	switch (optname) {
+	case TCP_KEEPIDLE:
+		return TCP_OPT_KEEPIDLE;
+	case TCP_KEEPINTVL:
+		return TCP_OPT_KEEPINTVL;
+	case TCP_KEEPCNT:
+		return TCP_OPT_KEEPCNT;
+	default:
+		return TCP_OPT_USER_TIMEOUT;
+	}
+}
+
 int zsock_getsockopt_ctx(struct net_context *ctx, int level, int optname,
 			 void *optval, socklen_t *optlen)
 {
@@ -1873,12 +1940,57 @@ int zsock_getsockopt_ctx(struct net_context *ctx, int level, int optname,
 				return 0;
 			}
 			break;
+
+		case SO_BUSY_POLL:
+			if (IS_ENABLED(CONFIG_NET_CONTEXT_BUSY_POLL)) {
+				ret = net_context_get_option(ctx,
+							     NET_OPT_BUSY_POLL,
+							     optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+			break;
+
+		case SO_KEEPALIVE:
+			if (IS_ENABLED(CONFIG_NET_TCP_KEEPALIVE) &&
+			    net_context_get_ip_proto(ctx) == IPPROTO_TCP) {
+				ret = net_tcp_get_option(ctx, TCP_OPT_KEEPALIVE,
+							 optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+			break;
 		}
 	case IPPROTO_TCP:
 		switch (optname) {
 		case TCP_NODELAY:
 			ret = net_tcp_get_option(ctx, TCP_OPT_NODELAY, optval, optlen);
 			return ret;
+
+		case TCP_KEEPIDLE:
+		case TCP_KEEPINTVL:
+		case TCP_KEEPCNT:
+		case TCP_USER_TIMEOUT:
+			if (IS_ENABLED(CONFIG_NET_TCP_KEEPALIVE)) {
+				ret = net_tcp_get_option(ctx,
+							 tcp_keepalive_option(optname),
+							 optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+			break;
 		}
 	}
 
@@ -1961,6 +2073,36 @@ int zsock_setsockopt_ctx(struct net_context *ctx, int level, int optname,
 
 			break;
 
+		case SO_BUSY_POLL:
+			if (IS_ENABLED(CONFIG_NET_CONTEXT_BUSY_POLL)) {
+				ret = net_context_set_option(ctx,
+							     NET_OPT_BUSY_POLL,
+							     optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+
+			break;
+
+		case SO_KEEPALIVE:
+			if (IS_ENABLED(CONFIG_NET_TCP_KEEPALIVE) &&
+			    net_context_get_ip_proto(ctx) == IPPROTO_TCP) {
+				ret = net_tcp_set_option(ctx, TCP_OPT_KEEPALIVE,
+							 optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+
+			break;
+
 		case SO_REUSEADDR:
 			/* Ignore for now. Provided to let port
 			 * existing apps.
@@ -2130,6 +2272,23 @@ int zsock_setsockopt_ctx(struct net_context *ctx, int level, int optname,
 			ret = net_tcp_set_option(ctx,
 						 TCP_OPT_NODELAY, optval, optlen);
 			return ret;
+
+		case TCP_KEEPIDLE:
+		case TCP_KEEPINTVL:
+		case TCP_KEEPCNT:
+		case TCP_USER_TIMEOUT:
+			if (IS_ENABLED(CONFIG_NET_TCP_KEEPALIVE)) {
+				ret = net_tcp_set_option(ctx,
+							 tcp_keepalive_option(optname),
+							 optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+			break;
 		}
 		break;
 
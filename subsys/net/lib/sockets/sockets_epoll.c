@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_sock, CONFIG_NET_SOCKETS_LOG_LEVEL);
+
+#include <zephyr/kernel.h>
+#include <zephyr/syscall_handler.h>
+#include <zephyr/sys/fdtable.h>
+#include <zephyr/sys/dlist.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/net/net_context.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/socket_epoll.h>
+
+#include "sockets_internal.h"
+#include "../../ip/tcp_internal.h"
+
+extern const struct socket_op_vtable sock_fd_op_vtable;
+
+/* Events which can be watched for */
+#define EPOLL_EVENTS (ZSOCK_EPOLLIN | ZSOCK_EPOLLPRI | ZSOCK_EPOLLOUT | \
+		      ZSOCK_EPOLLERR | ZSOCK_EPOLLHUP)
+
+/* Events which are reported even if they were not asked for */
+#define EPOLL_ALWAYS (ZSOCK_EPOLLERR | ZSOCK_EPOLLHUP)
+
+struct epoll;
+
+/* A socket in the interest list of an epoll instance. The item is linked
+ * to the net_context so that the socket layer can queue it to the ready
+ * list of the epoll instance when the socket state changes.
+ */
+struct epoll_item {
+	/* Ready list node */
+	sys_dnode_t ready_node;
+
+	/* Node in the list of the items watching the socket */
+	sys_snode_t ctx_node;
+
+	/* Interest list node */
+	sys_snode_t ep_node;
+
+	struct epoll *ep;
+	struct net_context *ctx;
+	struct zsock_epoll_event event;
+	int fd;
+
+	/* In the ready list, or being checked by epoll_wait() */
+	bool ready;
+
+	/* One shot event already reported */
+	bool disabled;
+};
+
+struct epoll {
+	/* Watched sockets */
+	sys_slist_t items;
+
+	/* Sockets whose state has changed since they were last checked */
+	sys_dlist_t ready;
+
+	/* Raised when an item is added to the ready list */
+	struct k_poll_signal signal;
+
+	bool in_use;
+};
+
+static struct epoll epolls[CONFIG_NET_SOCKETS_EPOLL_MAX];
+static struct epoll_item epoll_items[CONFIG_NET_SOCKETS_EPOLL_ITEMS];
+
+BUILD_ASSERT(CONFIG_NET_SOCKETS_EPOLL_MAX <= 32);
+
+/* Protects the interest lists and the epoll instances */
+static K_MUTEX_DEFINE(epoll_lock);
+
+/* Protects the ready lists and the item lists of the sockets, which are
+ * modified from the network stack threads.
+ */
+static struct k_spinlock ready_lock;
+
+static const struct fd_op_vtable epoll_fd_op_vtable;
+
+/* Same conditions as zsock_poll_update_ctx() */
+static uint32_t epoll_ctx_events(struct net_context *ctx)
+{
+	uint32_t events = 0U;
+
+	if (!k_fifo_is_empty(&ctx->recv_q) || sock_is_eof(ctx)) {
+		events |= ZSOCK_EPOLLIN;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_NATIVE_TCP) &&
+	    net_context_get_type(ctx) == SOCK_STREAM) {
+		if (k_sem_count_get(net_tcp_tx_sem_get(ctx)) > 0 &&
+		    !sock_is_eof(ctx)) {
+			events |= ZSOCK_EPOLLOUT;
+		}
+	} else {
+		events |= ZSOCK_EPOLLOUT;
+	}
+
+	if (sock_is_error(ctx)) {
+		events |= ZSOCK_EPOLLERR;
+	}
+
+	if (sock_is_eof(ctx)) {
+		events |= ZSOCK_EPOLLHUP;
+	}
+
+	return events;
+}
+
+/* Must be called with ready_lock held. Returns true if the epoll instance
+ * needs to be woken up.
+ */
+static bool epoll_item_queue(struct epoll_item *item)
+{
+	if (item->ready || item->disabled) {
+		return false;
+	}
+
+	item->ready = true;
+	sys_dlist_append(&item->ep->ready, &item->ready_node);
+
+	return true;
+}
+
+void zsock_epoll_notify(struct net_context *ctx)
+{
+	struct epoll_item *item;
+	k_spinlock_key_t key;
+	uint32_t wake = 0U;
+
+	if (ctx == NULL || sys_slist_is_empty(&ctx->epoll_items)) {
+		return;
+	}
+
+	key = k_spin_lock(&ready_lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&ctx->epoll_items, item, ctx_node) {
+		if (epoll_item_queue(item)) {
+			wake |= BIT(item->ep - epolls);
+		}
+	}
+
+	k_spin_unlock(&ready_lock, key);
+
+	while (wake) {
+		int i = find_lsb_set(wake) - 1;
+
+		wake &= ~BIT(i);
+		k_poll_signal_raise(&epolls[i].signal, 0);
+	}
+}
+
+/* Must be called with epoll_lock held */
+static void epoll_item_free(struct epoll_item *item)
+{
+	struct epoll *ep = item->ep;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&ready_lock);
+
+	sys_slist_find_and_remove(&item->ctx->epoll_items, &item->ctx_node);
+
+	if (item->ready) {
+		sys_dlist_remove(&item->ready_node);
+	}
+
+	k_spin_unlock(&ready_lock, key);
+
+	sys_slist_find_and_remove(&ep->items, &item->ep_node);
+
+	item->ep = NULL;
+	item->ctx = NULL;
+}
+
+void zsock_epoll_ctx_closed(struct net_context *ctx)
+{
+	sys_snode_t *node;
+
+	(void)k_mutex_lock(&epoll_lock, K_FOREVER);
+
+	while ((node = sys_slist_peek_head(&ctx->epoll_items)) != NULL) {
+		epoll_item_free(CONTAINER_OF(node, struct epoll_item,
+					     ctx_node));
+	}
+
+	k_mutex_unlock(&epoll_lock);
+}
+
+/* Must be called with epoll_lock held */
+static struct epoll_item *epoll_item_find(struct epoll *ep, int fd)
+{
+	struct epoll_item *item;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&ep->items, item, ep_node) {
+		if (item->fd == fd) {
+			return item;
+		}
+	}
+
+	return NULL;
+}
+
+/* Must be called with epoll_lock held */
+static struct epoll_item *epoll_item_alloc(struct epoll *ep,
+					   struct net_context *ctx, int fd)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(epoll_items); i++) {
+		struct epoll_item *item = &epoll_items[i];
+
+		if (item->ep != NULL) {
+			continue;
+		}
+
+		memset(item, 0, sizeof(*item));
+
+		item->ep = ep;
+		item->ctx = ctx;
+		item->fd = fd;
+
+		sys_slist_append(&ep->items, &item->ep_node);
+
+		return item;
+	}
+
+	return NULL;
+}
+
+/* Report the events of the sockets in the ready list. The sockets which
+ * are not ready any more are dropped from the list, the level triggered
+ * ones which are still ready are moved to its tail. Must be called with
+ * epoll_lock held.
+ */
+static int epoll_collect(struct epoll *ep, struct zsock_epoll_event *events,
+			 int maxevents)
+{
+	sys_dlist_t pending;
+	sys_dnode_t *node;
+	k_spinlock_key_t key;
+	int count = 0;
+
+	sys_dlist_init(&pending);
+
+	key = k_spin_lock(&ready_lock);
+
+	while ((node = sys_dlist_get(&ep->ready)) != NULL) {
+		sys_dlist_append(&pending, node);
+	}
+
+	k_spin_unlock(&ready_lock, key);
+
+	while (count < maxevents &&
+	       (node = sys_dlist_get(&pending)) != NULL) {
+		struct epoll_item *item;
+		uint32_t revents;
+
+		item = CONTAINER_OF(node, struct epoll_item, ready_node);
+
+		/* A notification received while the socket is checked
+		 * queues it again.
+		 */
+		key = k_spin_lock(&ready_lock);
+		item->ready = false;
+		k_spin_unlock(&ready_lock, key);
+
+		if (item->disabled) {
+			continue;
+		}
+
+		revents = epoll_ctx_events(item->ctx) &
+			  (item->event.events | EPOLL_ALWAYS);
+		if (revents == 0U) {
+			continue;
+		}
+
+		events[count].events = revents;
+		events[count].data = item->event.data;
+		count++;
+
+		key = k_spin_lock(&ready_lock);
+
+		if (item->event.events & ZSOCK_EPOLLONESHOT) {
+			item->disabled = true;
+		} else if (!(item->event.events & ZSOCK_EPOLLET)) {
+			(void)epoll_item_queue(item);
+		}
+
+		k_spin_unlock(&ready_lock, key);
+	}
+
+	/* The sockets not checked yet are put back first in the ready list
+	 * so that they are reported by the next call.
+	 */
+	key = k_spin_lock(&ready_lock);
+
+	while ((node = sys_dlist_peek_tail(&pending)) != NULL) {
+		sys_dlist_remove(node);
+		sys_dlist_prepend(&ep->ready, node);
+	}
+
+	k_spin_unlock(&ready_lock, key);
+
+	return count;
+}
+
+static int epoll_close_op(void *obj)
+{
+	struct epoll *ep = obj;
+	sys_snode_t *node;
+
+	(void)k_mutex_lock(&epoll_lock, K_FOREVER);
+
+	while ((node = sys_slist_peek_head(&ep->items)) != NULL) {
+		epoll_item_free(CONTAINER_OF(node, struct epoll_item,
+					     ep_node));
+	}
+
+	ep->in_use = false;
+
+	k_mutex_unlock(&epoll_lock);
+
+	/* Wake up the threads still waiting on the instance */
+	k_poll_signal_raise(&ep->signal, 0);
+
+	return 0;
+}
+
+static ssize_t epoll_read_op(void *obj, void *buf, size_t sz)
+{
+	ARG_UNUSED(obj);
+	ARG_UNUSED(buf);
+	ARG_UNUSED(sz);
+
+	errno = EINVAL;
+	return -1;
+}
+
+static ssize_t epoll_write_op(void *obj, const void *buf, size_t sz)
+{
+	ARG_UNUSED(obj);
+	ARG_UNUSED(buf);
+	ARG_UNUSED(sz);
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int epoll_ioctl_op(void *obj, unsigned int request, va_list args)
+{
+	ARG_UNUSED(obj);
+	ARG_UNUSED(request);
+	ARG_UNUSED(args);
+
+	errno = EOPNOTSUPP;
+	return -1;
+}
+
+static const struct fd_op_vtable epoll_fd_op_vtable = {
+	.read = epoll_read_op,
+	.write = epoll_write_op,
+	.close = epoll_close_op,
+	.ioctl = epoll_ioctl_op,
+};
+
+int z_impl_zsock_epoll_create(int size)
+{
+	struct epoll *ep = NULL;
+	int fd = -1;
+	int i;
+
+	if (size <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	(void)k_mutex_lock(&epoll_lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(epolls); i++) {
+		if (!epolls[i].in_use) {
+			ep = &epolls[i];
+			break;
+		}
+	}
+
+	if (ep == NULL) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	fd = z_reserve_fd();
+	if (fd < 0) {
+		goto out;
+	}
+
+	ep->in_use = true;
+	sys_slist_init(&ep->items);
+	sys_dlist_init(&ep->ready);
+	k_poll_signal_init(&ep->signal);
+
+	z_finalize_fd(fd, ep, &epoll_fd_op_vtable);
+
+out:
+	k_mutex_unlock(&epoll_lock);
+
+	return fd;
+}
+
+#ifdef CONFIG_USERSPACE
+static inline int z_vrfy_zsock_epoll_create(int size)
+{
+	return z_impl_zsock_epoll_create(size);
+}
+#include <syscalls/zsock_epoll_create_mrsh.c>
+#endif /* CONFIG_USERSPACE */
+
+int z_impl_zsock_epoll_ctl(int epfd, int op, int fd,
+			   struct zsock_epoll_event *event)
+{
+	struct net_context *ctx;
+	struct epoll_item *item;
+	k_spinlock_key_t key;
+	struct epoll *ep;
+	int ret = 0;
+
+	ep = z_get_fd_obj(epfd, &epoll_fd_op_vtable, EINVAL);
+	if (ep == NULL) {
+		return -1;
+	}
+
+	if (fd == epfd) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (op != ZSOCK_EPOLL_CTL_DEL && event == NULL) {
+		errno = EFAULT;
+		return -1;
+	}
+
+	/* Only the native sockets tell when their state changes */
+	ctx = z_get_fd_obj(fd, (const struct fd_op_vtable *)&sock_fd_op_vtable,
+			   EPERM);
+	if (ctx == NULL) {
+		return -1;
+	}
+
+	(void)k_mutex_lock(&epoll_lock, K_FOREVER);
+
+	item = epoll_item_find(ep, fd);
+
+	switch (op) {
+	case ZSOCK_EPOLL_CTL_ADD:
+		if (item != NULL) {
+			ret = -EEXIST;
+			break;
+		}
+
+		item = epoll_item_alloc(ep, ctx, fd);
+		if (item == NULL) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		item->event = *event;
+		item->event.events &= EPOLL_EVENTS | ZSOCK_EPOLLET |
+				      ZSOCK_EPOLLONESHOT;
+
+		key = k_spin_lock(&ready_lock);
+		sys_slist_append(&ctx->epoll_items, &item->ctx_node);
+		k_spin_unlock(&ready_lock, key);
+
+		/* Let epoll_wait() check the current state of the socket */
+		zsock_epoll_notify(ctx);
+		break;
+
+	case ZSOCK_EPOLL_CTL_MOD:
+		if (item == NULL) {
+			ret = -ENOENT;
+			break;
+		}
+
+		key = k_spin_lock(&ready_lock);
+		item->event = *event;
+		item->event.events &= EPOLL_EVENTS | ZSOCK_EPOLLET |
+				      ZSOCK_EPOLLONESHOT;
+		item->disabled = false;
+		k_spin_unlock(&ready_lock, key);
+
+		zsock_epoll_notify(ctx);
+		break;
+
+	case ZSOCK_EPOLL_CTL_DEL:
+		if (item == NULL) {
+			ret = -ENOENT;
+			break;
+		}
+
+		epoll_item_free(item);
+		break;
+
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	k_mutex_unlock(&epoll_lock);
+
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_USERSPACE
+static inline int z_vrfy_zsock_epoll_ctl(int epfd, int op, int fd,
+					 struct zsock_epoll_event *event)
+{
+	struct zsock_epoll_event event_copy;
+
+	if (event == NULL) {
+		return z_impl_zsock_epoll_ctl(epfd, op, fd, NULL);
+	}
+
+	Z_OOPS(z_user_from_copy(&event_copy, (void *)event,
+				sizeof(event_copy)));
+
+	return z_impl_zsock_epoll_ctl(epfd, op, fd, &event_copy);
+}
+#include <syscalls/zsock_epoll_ctl_mrsh.c>
+#endif /* CONFIG_USERSPACE */
+
+int z_impl_zsock_epoll_wait(int epfd, struct zsock_epoll_event *events,
+			    int maxevents, int timeout)
+{
+	struct k_poll_event event;
+	k_timeout_t k_timeout;
+	struct epoll *ep;
+	uint64_t end;
+	int ret;
+
+	ep = z_get_fd_obj(epfd, &epoll_fd_op_vtable, EINVAL);
+	if (ep == NULL) {
+		return -1;
+	}
+
+	if (maxevents <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (timeout < 0) {
+		k_timeout = K_FOREVER;
+	} else {
+		k_timeout = K_MSEC(timeout);
+	}
+
+	end = sys_clock_timeout_end_calc(k_timeout);
+
+	k_poll_event_init(&event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY,
+			  &ep->signal);
+
+	while (true) {
+		/* Reset the signal before checking the ready list so that
+		 * no notification is lost in between.
+		 */
+		k_poll_signal_reset(&ep->signal);
+
+		(void)k_mutex_lock(&epoll_lock, K_FOREVER);
+
+		if (!ep->in_use) {
+			k_mutex_unlock(&epoll_lock);
+			errno = EBADF;
+			return -1;
+		}
+
+		ret = epoll_collect(ep, events, maxevents);
+
+		k_mutex_unlock(&epoll_lock);
+
+		if (ret > 0 || K_TIMEOUT_EQ(k_timeout, K_NO_WAIT)) {
+			return ret;
+		}
+
+		if (!K_TIMEOUT_EQ(k_timeout, K_FOREVER)) {
+			int64_t remaining = end - sys_clock_tick_get();
+
+			if (remaining <= 0) {
+				return 0;
+			}
+
+			k_timeout = Z_TIMEOUT_TICKS(remaining);
+		}
+
+		event.state = K_POLL_STATE_NOT_READY;
+
+		ret = k_poll(&event, 1, k_timeout);
+		if (ret == -EAGAIN) {
+			return 0;
+		}
+	}
+}
+
+#ifdef CONFIG_USERSPACE
+static inline int z_vrfy_zsock_epoll_wait(int epfd,
+					  struct zsock_epoll_event *events,
+					  int maxevents, int timeout)
+{
+	if (maxevents > 0) {
+		Z_OOPS(Z_SYSCALL_MEMORY_ARRAY_WRITE(
+				       events, maxevents,
+				       sizeof(struct zsock_epoll_event)));
+	}
+
+	return z_impl_zsock_epoll_wait(epfd, events, maxevents, timeout);
+}
+#include <syscalls/zsock_epoll_wait_mrsh.c>
+#endif /* CONFIG_USERSPACE */
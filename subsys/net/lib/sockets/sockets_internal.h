@@ -76,4 +76,19 @@ struct socket_op_vtable {
 
 size_t msghdr_non_empty_iov_count(const struct msghdr *msg);
 
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+void zsock_epoll_notify(struct net_context *ctx);
+void zsock_epoll_ctx_closed(struct net_context *ctx);
+#else
+static inline void zsock_epoll_notify(struct net_context *ctx)
+{
+	ARG_UNUSED(ctx);
+}
+
+static inline void zsock_epoll_ctx_closed(struct net_context *ctx)
+{
+	ARG_UNUSED(ctx);
+}
+#endif
+
 #endif /* _SOCKETS_INTERNAL_H_ */
@@ -389,6 +389,7 @@ int websocket_connect(int sock, struct websocket_request *wreq,
 	 * in order that to work the amount of data in buffer must be set to 0
 	 */
 	ctx->tmp_buf_pos = 0;
+	ctx->tmp_buf_start = 0;
 
 	return fd;
 
@@ -563,9 +564,50 @@ static int sendmsg_all(int sock, const struct msghdr *message, int flags)
 }
 #endif /* !defined(CONFIG_NET_TEST) */
 
+void websocket_mask(uint8_t *dst, const uint8_t *src, size_t len,
+		    uint32_t mask, size_t offset)
+{
+	const uintptr_t align = sizeof(uintptr_t) - 1;
+	uint8_t key[sizeof(uintptr_t)];
+	uintptr_t key_word;
+	int i;
+
+	/* Do byte-sized masking until the destination is word-aligned */
+	while (len > 0 && ((uintptr_t)dst & align)) {
+		*(dst++) = *(src++) ^ (uint8_t)(mask >> (8 * (3 - offset % 4)));
+		offset++;
+		len--;
+	}
+
+	if (len >= sizeof(uintptr_t)) {
+		/* The word size is a multiple of the key length so the same
+		 * key word applies to every word of the data.
+		 */
+		for (i = 0; i < sizeof(key); i++) {
+			key[i] = mask >> (8 * (3 - (offset + i) % 4));
+		}
+
+		memcpy(&key_word, key, sizeof(key_word));
+
+		while (len >= sizeof(uintptr_t)) {
+			*(uintptr_t *)dst =
+				UNALIGNED_GET((const uintptr_t *)src) ^ key_word;
+			dst += sizeof(uintptr_t);
+			src += sizeof(uintptr_t);
+			len -= sizeof(uintptr_t);
+		}
+	}
+
+	while (len > 0) {
+		*(dst++) = *(src++) ^ (uint8_t)(mask >> (8 * (3 - offset % 4)));
+		offset++;
+		len--;
+	}
+}
+
 static int websocket_prepare_and_send(struct websocket_context *ctx,
 				      uint8_t *header, size_t header_len,
-				      uint8_t *payload, size_t payload_len,
+				      const uint8_t *payload, size_t payload_len,
 				      int32_t timeout)
 {
 	struct iovec io_vector[2];
@@ -573,7 +615,7 @@ static int websocket_prepare_and_send(struct websocket_context *ctx,
 
 	io_vector[0].iov_base = header;
 	io_vector[0].iov_len = header_len;
-	io_vector[1].iov_base = payload;
+	io_vector[1].iov_base = (void *)payload;
 	io_vector[1].iov_len = payload_len;
 
 	memset(&msg, 0, sizeof(msg));
@@ -603,13 +645,47 @@ static int websocket_prepare_and_send(struct websocket_context *ctx,
 #endif /* CONFIG_NET_TEST */
 }
 
+/* The payload cannot be masked in place as it belongs to the caller, so it
+ * is masked piece by piece into a buffer from where it is sent. The header
+ * is sent together with the first piece.
+ */
+static int websocket_send_masked(struct websocket_context *ctx,
+				 uint8_t *header, size_t header_len,
+				 const uint8_t *payload, size_t payload_len,
+				 int32_t timeout)
+{
+	uint8_t buf[CONFIG_WEBSOCKET_MASK_BUF_SIZE];
+	size_t offset = 0;
+	size_t len;
+	int total = 0;
+	int ret;
+
+	do {
+		len = MIN(payload_len - offset, sizeof(buf));
+
+		websocket_mask(buf, payload + offset, len, ctx->masking_value,
+			       offset);
+
+		ret = websocket_prepare_and_send(ctx, header, header_len,
+						 buf, len, timeout);
+		if (ret < 0) {
+			return ret;
+		}
+
+		total += ret;
+		offset += len;
+		header_len = 0;
+	} while (offset < payload_len);
+
+	return total;
+}
+
 int websocket_send_msg(int ws_sock, const uint8_t *payload, size_t payload_len,
 		       enum websocket_opcode opcode, bool mask, bool final,
 		       int32_t timeout)
 {
 	struct websocket_context *ctx;
 	uint8_t header[MAX_HEADER_LEN], hdr_len = 2;
-	uint8_t *data_to_send = (uint8_t *)payload;
 	int ret;
 
 	if (opcode != WEBSOCKET_OPCODE_DATA_TEXT &&
@@ -673,8 +749,6 @@ int websocket_send_msg(int ws_sock, const uint8_t *payload, size_t payload_len,
 
 	/* Add masking value if needed */
 	if (mask) {
-		int i;
-
 		ctx->masking_value = sys_rand32_get();
 
 		header[hdr_len++] |= ctx->masking_value >> 24;
@@ -682,29 +756,16 @@ int websocket_send_msg(int ws_sock, const uint8_t *payload, size_t payload_len,
 		header[hdr_len++] |= ctx->masking_value >> 8;
 		header[hdr_len++] |= ctx->masking_value;
 
-		data_to_send = k_malloc(payload_len);
-		if (!data_to_send) {
-			return -ENOMEM;
-		}
-
-		memcpy(data_to_send, payload, payload_len);
-
-		for (i = 0; i < payload_len; i++) {
-			data_to_send[i] ^=
-				ctx->masking_value >> (8 * (3 - i % 4));
-		}
+		ret = websocket_send_masked(ctx, header, hdr_len, payload,
+					    payload_len, timeout);
+	} else {
+		ret = websocket_prepare_and_send(ctx, header, hdr_len,
+						 payload, payload_len, timeout);
 	}
 
-	ret = websocket_prepare_and_send(ctx, header, hdr_len,
-					 data_to_send, payload_len, timeout);
 	if (ret < 0) {
-		NET_DBG("Cannot send ws msg (%d)", -errno);
-		goto quit;
-	}
-
-quit:
-	if (data_to_send != payload) {
-		k_free(data_to_send);
+		NET_DBG("Cannot send ws msg (%d)", ret);
+		return ret;
 	}
 
 	return ret - hdr_len;
@@ -745,33 +806,110 @@ static bool websocket_parse_header(uint8_t *buf, size_t buf_len, bool *masked,
 	len = value & 0x007f;
 	if (len < 126) {
 		len_len = 0;
-		*message_length = len;
 	} else if (len == 126) {
 		len_len = 2;
-		*message_length = sys_get_be16(&buf[2]);
 	} else {
 		len_len = 8;
-		*message_length = sys_get_be64(&buf[2]);
 	}
 
 	/* Minimum websocket header is 2 bytes, header length might be
-	 * bigger depending on length field len.
+	 * bigger depending on length field len and on the masking key.
 	 */
 	*header_len = MIN_HEADER_LEN + len_len;
+	if (value & 0x0080) {
+		*header_len += 4;
+	}
 
-	if (buf_len >= *header_len) {
-		if (value & 0x0080) {
-			*masked = true;
-			*mask_value = sys_get_be32(&buf[2 + len_len]);
-			*header_len += 4;
-		} else {
-			*masked = false;
-		}
+	if (buf_len < *header_len) {
+		return false;
+	}
+
+	if (len_len == 0) {
+		*message_length = len;
+	} else if (len_len == 2) {
+		*message_length = sys_get_be16(&buf[2]);
+	} else {
+		*message_length = sys_get_be64(&buf[2]);
+	}
+
+	if (value & 0x0080) {
+		*masked = true;
+		*mask_value = sys_get_be32(&buf[2 + len_len]);
+	} else {
+		*masked = false;
+	}
+
+	return true;
+}
+
+#if defined(CONFIG_NET_TEST)
+/* Websocket unit test does not use socket layer but feeds
+ * the data directly here when testing this function.
+ */
+struct test_data {
+	uint8_t *input_buf;
+	size_t input_len;
+	struct websocket_context *ctx;
+};
+#endif /* CONFIG_NET_TEST */
+
+static int websocket_read(int ws_sock, struct websocket_context *ctx,
+			  uint8_t *buf, size_t len, k_timeout_t tout)
+{
+#if defined(CONFIG_NET_TEST)
+	struct test_data *test_data =
+	    UINT_TO_POINTER((unsigned int) ws_sock);
+
+	ARG_UNUSED(ctx);
+	ARG_UNUSED(tout);
+
+	len = MIN(len, test_data->input_len);
+
+	memcpy(buf, test_data->input_buf, len);
+	test_data->input_buf += len;
+	test_data->input_len -= len;
+
+	return len;
+#else
+	int ret;
+
+	ARG_UNUSED(ws_sock);
+
+	ret = recv(ctx->real_sock, buf, len,
+		   K_TIMEOUT_EQ(tout, K_NO_WAIT) ? MSG_DONTWAIT : 0);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return ret;
+#endif /* CONFIG_NET_TEST */
+}
+
+static bool websocket_header_complete(struct websocket_context *ctx,
+				      uint32_t *message_type,
+				      size_t *header_len)
+{
+	bool masked;
+
+	if (ctx->tmp_buf_pos - ctx->tmp_buf_start < MIN_HEADER_LEN) {
+		return false;
+	}
 
-		return true;
+	if (!websocket_parse_header(&ctx->tmp_buf[ctx->tmp_buf_start],
+				    ctx->tmp_buf_pos - ctx->tmp_buf_start,
+				    &masked, &ctx->masking_value,
+				    &ctx->message_len, &ctx->message_type,
+				    header_len)) {
+		return false;
 	}
 
-	return false;
+	ctx->masked = masked;
+
+	if (message_type) {
+		*message_type = ctx->message_type;
+	}
+
+	return true;
 }
 
 int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
@@ -780,7 +918,6 @@ int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 	struct websocket_context *ctx;
 	size_t header_len = 0;
 	int recv_len = 0;
-	size_t can_copy, left;
 	int ret;
 	k_timeout_t tout = K_FOREVER;
 
@@ -789,15 +926,6 @@ int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 	}
 
 #if defined(CONFIG_NET_TEST)
-	/* Websocket unit test does not use socket layer but feeds
-	 * the data directly here when testing this function.
-	 */
-	struct test_data {
-		uint8_t *input_buf;
-		size_t input_len;
-		struct websocket_context *ctx;
-	};
-
 	struct test_data *test_data =
 	    UINT_TO_POINTER((unsigned int) ws_sock);
 
@@ -813,60 +941,43 @@ int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 	}
 #endif /* CONFIG_NET_TEST */
 
-	/* If we have not received the websocket header yet, read it first */
+	/* If we have not received the websocket header yet, read it first.
+	 * The header is parsed where it was received, and it might already
+	 * be there if the previous read got more than one frame.
+	 */
 	if (!ctx->header_received) {
-#if defined(CONFIG_NET_TEST)
-		size_t input_len = MIN(ctx->tmp_buf_len - ctx->tmp_buf_pos,
-				       test_data->input_len);
-
-		memcpy(&ctx->tmp_buf[ctx->tmp_buf_pos], test_data->input_buf,
-		       input_len);
-		test_data->input_buf += input_len;
-		ret = input_len;
-#else
-		ret = recv(ctx->real_sock, &ctx->tmp_buf[ctx->tmp_buf_pos],
-			   ctx->tmp_buf_len - ctx->tmp_buf_pos,
-			   K_TIMEOUT_EQ(tout, K_NO_WAIT) ? MSG_DONTWAIT : 0);
-#endif /* CONFIG_NET_TEST */
-
-		if (ret < 0) {
-			return -errno;
-		}
+		if (!websocket_header_complete(ctx, message_type,
+					       &header_len)) {
+			/* Move the partial header to the start of the buffer
+			 * so that there is room for the rest of it.
+			 */
+			if (ctx->tmp_buf_start > 0) {
+				memmove(ctx->tmp_buf,
+					&ctx->tmp_buf[ctx->tmp_buf_start],
+					ctx->tmp_buf_pos - ctx->tmp_buf_start);
+				ctx->tmp_buf_pos -= ctx->tmp_buf_start;
+				ctx->tmp_buf_start = 0;
+			}
 
-		if (ret == 0) {
-			/* Socket closed */
-			return 0;
-		}
+			ret = websocket_read(ws_sock, ctx,
+					     &ctx->tmp_buf[ctx->tmp_buf_pos],
+					     ctx->tmp_buf_len - ctx->tmp_buf_pos,
+					     tout);
+			if (ret < 0) {
+				return ret;
+			}
 
-		ctx->tmp_buf_pos += ret;
+			if (ret == 0) {
+				/* Socket closed */
+				return 0;
+			}
 
-		if (ctx->tmp_buf_pos >= MIN_HEADER_LEN) {
-			bool masked;
+			ctx->tmp_buf_pos += ret;
 
-			/* Now we will be able to figure out what is the
-			 * actual size of the header.
-			 */
-			if (websocket_parse_header(&ctx->tmp_buf[0],
-						   ctx->tmp_buf_pos,
-						   &masked,
-						   &ctx->masking_value,
-						   &ctx->message_len,
-						   &ctx->message_type,
-						   &header_len)) {
-				ctx->masked = masked;
-
-				if (message_type) {
-					*message_type = ctx->message_type;
-				}
-			} else {
+			if (!websocket_header_complete(ctx, message_type,
+						       &header_len)) {
 				return -EAGAIN;
 			}
-		} else {
-			return -EAGAIN;
-		}
-
-		if (ctx->tmp_buf_pos < header_len) {
-			return -EAGAIN;
 		}
 
 		/* All of the header is now received, we can read the payload
@@ -875,8 +986,8 @@ int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 		ctx->header_received = true;
 
 		if (HEXDUMP_RECV_PACKETS) {
-			LOG_HEXDUMP_DBG(&ctx->tmp_buf[0], header_len,
-					"Header");
+			LOG_HEXDUMP_DBG(&ctx->tmp_buf[ctx->tmp_buf_start],
+					header_len, "Header");
 			NET_DBG("[%p] masked %d mask 0x%04x hdr %zd msg %zd",
 				ctx, ctx->masked,
 				ctx->masked ? ctx->masking_value : 0,
@@ -884,90 +995,75 @@ int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 		}
 
 		ctx->total_read = 0;
+		ctx->tmp_buf_start += header_len;
 
-		memmove(ctx->tmp_buf, &ctx->tmp_buf[header_len],
-			ctx->tmp_buf_len - header_len);
-		ctx->tmp_buf_pos -= header_len;
+		if (ctx->tmp_buf_start == ctx->tmp_buf_pos) {
+			ctx->tmp_buf_start = 0;
+			ctx->tmp_buf_pos = 0;
 
-		if (ctx->tmp_buf_pos == 0) {
-			/* No data after the header, let the caller call
-			 * this function again to get the payload.
-			 */
-			return -EAGAIN;
+			if (ctx->message_len > 0) {
+				/* No data after the header, let the caller
+				 * call this function again to get the payload.
+				 */
+				return -EAGAIN;
+			}
 		}
 
-		NET_DBG("There is %zd bytes of data", ctx->tmp_buf_pos);
+		NET_DBG("There is %zd bytes of data",
+			ctx->tmp_buf_pos - ctx->tmp_buf_start);
 	}
 
 	/* Now read the whole payload or parts of it */
 
-	if (ctx->tmp_buf_pos == 0) {
-		/* Read more data into temp buffer */
-#if defined(CONFIG_NET_TEST)
-		size_t input_len = MIN(ctx->tmp_buf_len, test_data->input_len);
-
-		memcpy(ctx->tmp_buf, test_data->input_buf, input_len);
-		test_data->input_buf += input_len;
-
-		ret = input_len;
-#else
-		ret = recv(ctx->real_sock, ctx->tmp_buf, ctx->tmp_buf_len,
-			   K_TIMEOUT_EQ(tout, K_NO_WAIT) ? MSG_DONTWAIT : 0);
-#endif /* CONFIG_NET_TEST */
+	if (ctx->tmp_buf_pos > ctx->tmp_buf_start) {
+		/* Give first the data that was received together with the
+		 * header or with the previous frame.
+		 */
+		recv_len = MIN(ctx->message_len - ctx->total_read,
+			       MIN(ctx->tmp_buf_pos - ctx->tmp_buf_start,
+				   buf_len));
+
+		if (ctx->masked) {
+			websocket_mask(buf, &ctx->tmp_buf[ctx->tmp_buf_start],
+				       recv_len, ctx->masking_value,
+				       ctx->total_read);
+		} else {
+			memcpy(buf, &ctx->tmp_buf[ctx->tmp_buf_start],
+			       recv_len);
+		}
 
+		ctx->tmp_buf_start += recv_len;
+		if (ctx->tmp_buf_start == ctx->tmp_buf_pos) {
+			ctx->tmp_buf_start = 0;
+			ctx->tmp_buf_pos = 0;
+		}
+	} else if (ctx->message_len > ctx->total_read) {
+		/* Nothing buffered, so receive the payload directly to the
+		 * caller's buffer. Only the data of this frame is read so
+		 * nothing needs to be kept for the next call.
+		 */
+		ret = websocket_read(ws_sock, ctx, buf,
+				     MIN(ctx->message_len - ctx->total_read,
+					 buf_len),
+				     tout);
 		if (ret < 0) {
-			return -errno;
+			return ret;
 		}
 
 		if (ret == 0) {
 			return 0;
 		}
 
-		ctx->tmp_buf_pos = ret;
-	}
-
-	if (ctx->tmp_buf_pos <= buf_len) {
-		/* Is there already any data in the temp buffer? If yes,
-		 * just return it to the caller.
-		 */
-		can_copy = MIN(ctx->message_len - ctx->total_read,
-			       ctx->tmp_buf_pos);
-	} else {
-		/* We have more data in tmp buffer that will fit into
-		 * user buffer.
-		 */
-		can_copy = MIN(ctx->message_len - ctx->total_read, buf_len);
-	}
-
-	left = ctx->tmp_buf_pos - can_copy;
-
-	NET_ASSERT(ctx->tmp_buf_pos >= can_copy);
-
-	memmove(buf, ctx->tmp_buf, can_copy);
-	recv_len = can_copy;
+		recv_len = ret;
 
-	if (left > 0) {
-		memmove(ctx->tmp_buf, &ctx->tmp_buf[can_copy], left);
+		if (ctx->masked) {
+			websocket_mask(buf, buf, recv_len, ctx->masking_value,
+				       ctx->total_read);
+		}
 	}
 
-	ctx->tmp_buf_pos = left;
 	ctx->total_read += recv_len;
 
-	/* Unmask the data */
-	if (ctx->masked) {
-		/* As we might have less than 4 received bytes, we must select
-		 * which byte from masking value to take. The mask_shift will
-		 * tell that.
-		 */
-		int mask_shift = (ctx->total_read - recv_len) % sizeof(uint32_t);
-		int i;
-
-		for (i = 0; i < recv_len; i++) {
-			buf[i] ^= ctx->masking_value >>
-				(8 * (3 - (i + mask_shift) % 4));
-		}
-	}
-
 #if HEXDUMP_RECV_PACKETS
 	LOG_HEXDUMP_DBG(buf, recv_len, "Payload");
 #endif
@@ -978,6 +1074,13 @@ int websocket_recv_msg(int ws_sock, uint8_t *buf, size_t buf_len,
 
 	/* Start to read the header again if all the data has been received */
 	if (ctx->message_len == ctx->total_read) {
+		/* A frame without payload must not look like a closed
+		 * connection, the caller sees it from the message type.
+		 */
+		if (ctx->message_len == 0) {
+			recv_len = -EAGAIN;
+		}
+
 		ctx->header_received = false;
 		ctx->message_len = 0;
 		ctx->message_type = 0;
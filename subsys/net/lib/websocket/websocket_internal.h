@@ -73,6 +73,11 @@ __net_socket struct websocket_context {
 	 */
 	size_t tmp_buf_pos;
 
+	/** Start of the received data in the tmp_buf that has not been
+	 * parsed yet.
+	 */
+	size_t tmp_buf_start;
+
 	/** The real TCP socket to use when sending Websocket data to peer.
 	 */
 	int real_sock;
@@ -114,6 +119,18 @@ __net_socket struct websocket_context {
  */
 int websocket_disconnect(int sock);
 
+/**
+ * @brief Mask or unmask Websocket payload data.
+ *
+ * @param dst Where the result is stored, can be the same as src.
+ * @param src Data to mask or unmask.
+ * @param len Length of the data.
+ * @param mask Masking key of the frame.
+ * @param offset Position of the data in the frame payload.
+ */
+void websocket_mask(uint8_t *dst, const uint8_t *src, size_t len,
+		    uint32_t mask, size_t offset);
+
 /**
  * @typedef websocket_context_cb_t
  * @brief Callback used while iterating over websocket contexts
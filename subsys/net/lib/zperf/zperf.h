@@ -19,6 +19,23 @@ struct zperf_results {
 	uint32_t client_time_in_us;
 	uint32_t packet_size;
 	uint32_t nb_packets_errors;
+
+	/* Traffic returned by the server in bidirectional and
+	 * request/response modes.
+	 */
+	uint32_t nb_packets_echoed;
+	uint32_t nb_bytes_echoed;
+
+	/* Round trip times of a request/response test */
+	uint32_t latency_min_us;
+	uint32_t latency_avg_us;
+	uint32_t latency_p50_us;
+	uint32_t latency_p90_us;
+	uint32_t latency_p99_us;
+	uint32_t latency_max_us;
+
+	/* Share of one CPU used by the stream thread, in percent */
+	uint32_t cpu_load;
 };
 
 typedef void (*zperf_callback)(int status, struct zperf_results *);
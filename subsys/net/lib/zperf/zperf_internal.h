@@ -37,6 +37,11 @@
 
 #define PACKET_SIZE_MAX      1024
 
+/* Zephyr specific flag of zperf_client_hdr_v1, asks the server to send
+ * back every packet of the session on the socket it was received on.
+ */
+#define ZPERF_FLAG_ECHO      0x00100000
+
 struct zperf_udp_datagram {
 	int32_t id;
 	uint32_t tv_sec;
@@ -65,6 +70,24 @@ struct zperf_server_hdr {
 	int32_t jitter2;
 };
 
+enum zperf_upload_mode {
+	ZPERF_MODE_STREAM,  /* Throughput, client to server */
+	ZPERF_MODE_BIDIR,   /* Throughput, server echoes the traffic */
+	ZPERF_MODE_RR,      /* Request/response round trip latency */
+};
+
+struct zperf_upload_params {
+	enum zperf_upload_mode mode;
+	unsigned int duration_ms;
+	unsigned int packet_size;
+	unsigned int rate_kbps;
+	int port;
+	int stream;
+	int num_streams;
+	/* Receive busy poll time in usec for the RR mode, 0 if disabled */
+	unsigned int busy_poll_us;
+};
+
 static inline uint32_t time_delta(uint32_t ts, uint32_t t)
 {
 	return (t >= ts) ? (t - ts) : (ULONG_MAX - ts + t);
@@ -80,10 +103,7 @@ struct sockaddr_in *zperf_get_sin(void);
 
 extern void zperf_udp_upload(const struct shell *sh,
 			     int sock,
-			     int port,
-			     unsigned int duration_in_ms,
-			     unsigned int packet_size,
-			     unsigned int rate_in_kbps,
+			     const struct zperf_upload_params *param,
 			     struct zperf_results *results);
 
 extern void zperf_udp_receiver_init(const struct shell *sh, int port);
@@ -92,10 +112,25 @@ extern void zperf_tcp_receiver_init(const struct shell *sh, int port);
 extern void zperf_tcp_uploader_init(struct k_fifo *tx_queue);
 extern void zperf_tcp_upload(const struct shell *sh,
 			     int sock,
-			     unsigned int duration_in_ms,
-			     unsigned int packet_size,
+			     const struct zperf_upload_params *param,
 			     struct zperf_results *results);
 
+extern void zperf_rr_upload(const struct shell *sh,
+			    int sock,
+			    bool is_udp,
+			    const struct zperf_upload_params *param,
+			    struct zperf_results *results);
+extern void zperf_rr_merge(const struct zperf_results *results,
+			   int num_streams,
+			   struct zperf_results *total);
+
+extern int zperf_streams_run(const struct shell *sh,
+			     const int *socks,
+			     bool is_udp,
+			     const struct zperf_upload_params *param,
+			     struct zperf_results *results,
+			     uint32_t *cpu_load);
+
 extern void connect_ap(char *ssid);
 
 const struct in_addr *zperf_get_default_if_in4_addr(void);
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_zperf, CONFIG_NET_ZPERF_LOG_LEVEL);
+
+#include <stdlib.h>
+
+#include <zephyr/zephyr.h>
+#include <zephyr/random/rand32.h>
+
+#include <zephyr/net/socket.h>
+
+#include "zperf.h"
+#include "zperf_internal.h"
+
+#define RR_PACKET_SIZE (sizeof(struct zperf_udp_datagram) +	\
+			sizeof(struct zperf_client_hdr_v1) +	\
+			PACKET_SIZE_MAX)
+
+/* Smallest request able to carry the flags asking for the echo */
+#define RR_UDP_SIZE_MIN (sizeof(struct zperf_udp_datagram) +	\
+			 sizeof(struct zperf_client_hdr_v1))
+#define RR_TCP_SIZE_MIN sizeof(uint32_t)
+
+/* A request not answered in time is counted as lost (UDP) or ends the
+ * test (TCP).
+ */
+#define RR_TIMEOUT_SEC 1
+
+/* The request buffer also receives the response */
+static uint8_t rr_packets[CONFIG_NET_ZPERF_MAX_STREAMS][RR_PACKET_SIZE];
+
+/* Round trip times, in microseconds */
+static uint32_t rr_samples[CONFIG_NET_ZPERF_MAX_STREAMS]
+			  [CONFIG_NET_ZPERF_RR_SAMPLES];
+static uint32_t rr_sample_count[CONFIG_NET_ZPERF_MAX_STREAMS];
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of sorted samples */
+static uint32_t percentile(const uint32_t *samples, uint32_t count,
+			   uint32_t pct)
+{
+	uint32_t rank;
+
+	if (count == 0U) {
+		return 0U;
+	}
+
+	rank = (uint32_t)(((uint64_t)count * pct + 99U) / 100U);
+
+	return samples[MAX(rank, 1U) - 1U];
+}
+
+static void fill_percentiles(uint32_t *samples, uint32_t count,
+			     struct zperf_results *results)
+{
+	qsort(samples, count, sizeof(samples[0]), compare_u32);
+
+	results->latency_p50_us = percentile(samples, count, 50U);
+	results->latency_p90_us = percentile(samples, count, 90U);
+	results->latency_p99_us = percentile(samples, count, 99U);
+}
+
+/* Keep a uniform random subset of the samples when there are more
+ * transactions than slots (reservoir sampling).
+ */
+static void add_sample(int stream, uint32_t seen, uint32_t rtt)
+{
+	uint32_t slot;
+
+	if (seen <= CONFIG_NET_ZPERF_RR_SAMPLES) {
+		slot = seen - 1U;
+		rr_sample_count[stream] = seen;
+	} else {
+		slot = sys_rand32_get() % seen;
+		if (slot >= CONFIG_NET_ZPERF_RR_SAMPLES) {
+			return;
+		}
+	}
+
+	rr_samples[stream][slot] = rtt;
+}
+
+static void fill_request(uint8_t *packet, bool is_udp, int32_t id,
+			 const struct zperf_upload_params *param)
+{
+	struct zperf_udp_datagram *datagram;
+	struct zperf_client_hdr_v1 *hdr;
+	int64_t now;
+	uint32_t secs;
+
+	if (!is_udp) {
+		/* Only the start of the stream is looked at by the server */
+		UNALIGNED_PUT(htonl(ZPERF_FLAG_ECHO), (uint32_t *)packet);
+		return;
+	}
+
+	now = k_uptime_ticks();
+	secs = k_ticks_to_ms_ceil32(now) / 1000U;
+
+	datagram = (struct zperf_udp_datagram *)packet;
+	datagram->id = htonl(id);
+	datagram->tv_sec = htonl(secs);
+	datagram->tv_usec = htonl(k_ticks_to_us_ceil32(now) -
+				  secs * USEC_PER_SEC);
+
+	hdr = (struct zperf_client_hdr_v1 *)(packet + sizeof(*datagram));
+	hdr->flags = htonl(ZPERF_FLAG_ECHO);
+	hdr->num_of_threads = htonl(param->num_streams);
+	hdr->port = htonl(param->port);
+	hdr->buffer_len = 0;
+	hdr->bandwidth = 0;
+	hdr->num_of_bytes = htonl(param->packet_size);
+}
+
+/* Wait for the response to the request with the given id. Late
+ * responses to the requests which timed out before are skipped.
+ */
+static int recv_response(int sock, bool is_udp, uint8_t *packet,
+			 size_t size, int32_t id)
+{
+	struct zperf_udp_datagram *datagram;
+	int ret;
+
+	if (!is_udp) {
+		ret = zsock_recv(sock, packet, size, ZSOCK_MSG_WAITALL);
+		if (ret == 0) {
+			errno = ECONNRESET;
+			return -1;
+		}
+
+		if (ret > 0 && (size_t)ret < size) {
+			errno = EAGAIN;
+			return -1;
+		}
+
+		return ret;
+	}
+
+	datagram = (struct zperf_udp_datagram *)packet;
+
+	do {
+		ret = zsock_recv(sock, packet, RR_PACKET_SIZE, 0);
+	} while (ret >= (int)sizeof(*datagram) &&
+		 (int32_t)ntohl(UNALIGNED_GET(&datagram->id)) != id);
+
+	return ret;
+}
+
+/* Let the server close the UDP session, and skip its statistics */
+static void udp_rr_fin(int sock, uint8_t *packet, size_t size, int32_t id,
+		       const struct zperf_upload_params *param)
+{
+	fill_request(packet, true, -id, param);
+
+	if (zsock_send(sock, packet, size, 0) < 0) {
+		return;
+	}
+
+	(void)recv_response(sock, true, packet, size, -id);
+}
+
+void zperf_rr_upload(const struct shell *sh,
+		     int sock,
+		     bool is_udp,
+		     const struct zperf_upload_params *param,
+		     struct zperf_results *results)
+{
+	int64_t end = sys_clock_timeout_end_calc(K_MSEC(param->duration_ms));
+	uint8_t *packet = rr_packets[param->stream];
+	size_t size = param->packet_size;
+	struct timeval rcvtimeo = {
+		.tv_sec = RR_TIMEOUT_SEC,
+		.tv_usec = 0,
+	};
+	uint32_t nb_transactions = 0U, nb_lost = 0U, nb_errors = 0U;
+	uint32_t min = UINT32_MAX, max = 0U;
+	uint64_t total = 0U;
+	int64_t start_time;
+	int ret;
+
+	if (size > PACKET_SIZE_MAX) {
+		shell_fprintf(sh, SHELL_WARNING,
+			      "Packet size too large! max size: %u\n",
+			      PACKET_SIZE_MAX);
+		size = PACKET_SIZE_MAX;
+	} else if (is_udp && size < RR_UDP_SIZE_MIN) {
+		size = RR_UDP_SIZE_MIN;
+	} else if (!is_udp && size < RR_TCP_SIZE_MIN) {
+		size = RR_TCP_SIZE_MIN;
+	}
+
+	ret = zsock_setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &rcvtimeo,
+			       sizeof(rcvtimeo));
+	if (ret < 0) {
+		shell_fprintf(sh, SHELL_WARNING, "setsockopt error (%d)\n",
+			      errno);
+		return;
+	}
+
+	if (param->busy_poll_us > 0U) {
+		int busy_poll = param->busy_poll_us;
+
+		ret = zsock_setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL,
+				       &busy_poll, sizeof(busy_poll));
+		if (ret < 0) {
+			shell_fprintf(sh, SHELL_WARNING,
+				      "Cannot enable busy polling (%d)\n",
+				      errno);
+			return;
+		}
+	}
+
+	rr_sample_count[param->stream] = 0U;
+	(void)memset(packet, 'z', RR_PACKET_SIZE);
+
+	start_time = k_uptime_ticks();
+
+	do {
+		int32_t id = nb_transactions + nb_lost;
+		uint32_t cycles, rtt;
+
+		fill_request(packet, is_udp, id, param);
+
+		cycles = k_cycle_get_32();
+
+		ret = zsock_send(sock, packet, size, 0);
+		if (ret < 0) {
+			shell_fprintf(sh, SHELL_WARNING,
+				      "Failed to send the request (%d)\n",
+				      errno);
+			nb_errors++;
+			break;
+		}
+
+		ret = recv_response(sock, is_udp, packet, size, id);
+		if (ret < 0) {
+			if (is_udp && errno == EAGAIN) {
+				nb_lost++;
+				continue;
+			}
+
+			shell_fprintf(sh, SHELL_WARNING,
+				      "Failed to receive the response (%d)\n",
+				      errno);
+			nb_errors++;
+			break;
+		}
+
+		rtt = k_cyc_to_us_floor32(k_cycle_get_32() - cycles);
+
+		nb_transactions++;
+		total += rtt;
+		min = MIN(min, rtt);
+		max = MAX(max, rtt);
+
+		add_sample(param->stream, nb_transactions, rtt);
+	} while (end - k_uptime_ticks() > 0);
+
+	results->client_time_in_us =
+		k_ticks_to_us_ceil32(k_uptime_ticks() - start_time);
+
+	if (is_udp) {
+		udp_rr_fin(sock, packet, size, nb_transactions + nb_lost,
+			   param);
+	}
+
+	results->nb_packets_sent = nb_transactions;
+	results->nb_packets_lost = nb_lost;
+	results->nb_packets_errors = nb_errors;
+	results->nb_packets_echoed = nb_transactions;
+	results->nb_bytes_echoed = nb_transactions * size;
+	results->packet_size = size;
+
+	if (nb_transactions == 0U) {
+		return;
+	}
+
+	results->latency_min_us = min;
+	results->latency_max_us = max;
+	results->latency_avg_us = (uint32_t)(total / nb_transactions);
+
+	fill_percentiles(rr_samples[param->stream],
+			 rr_sample_count[param->stream], results);
+}
+
+void zperf_rr_merge(const struct zperf_results *results, int num_streams,
+		    struct zperf_results *total)
+{
+	uint32_t *samples = rr_samples[0];
+	uint32_t nb_transactions = 0U;
+	uint32_t count = 0U;
+	uint64_t sum = 0U;
+
+	total->latency_min_us = UINT32_MAX;
+	total->latency_max_us = 0U;
+
+	for (int i = 0; i < num_streams; i++) {
+		if (results[i].nb_packets_sent == 0U) {
+			continue;
+		}
+
+		nb_transactions += results[i].nb_packets_sent;
+		sum += (uint64_t)results[i].latency_avg_us *
+		       results[i].nb_packets_sent;
+		total->latency_min_us = MIN(total->latency_min_us,
+					    results[i].latency_min_us);
+		total->latency_max_us = MAX(total->latency_max_us,
+					    results[i].latency_max_us);
+
+		/* Put the samples of all the streams one after the other,
+		 * each row starts after the samples already moved.
+		 */
+		memmove(&samples[count], rr_samples[i],
+			rr_sample_count[i] * sizeof(samples[0]));
+		count += rr_sample_count[i];
+	}
+
+	if (nb_transactions == 0U) {
+		total->latency_min_us = 0U;
+		return;
+	}
+
+	total->latency_avg_us = (uint32_t)(sum / nb_transactions);
+
+	fill_percentiles(samples, count, total);
+}
@@ -14,7 +14,8 @@ LOG_MODULE_DECLARE(net_zperf, CONFIG_NET_ZPERF_LOG_LEVEL);
 
 #include "zperf_session.h"
 
-#define SESSION_MAX 4
+/* Every stream of a parallel upload has a session of its own */
+#define SESSION_MAX MAX(4, CONFIG_NET_ZPERF_MAX_STREAMS)
 
 static struct session sessions[SESSION_PROTO_END][SESSION_MAX];
 
@@ -104,11 +105,13 @@ struct session *get_tcp_session(int sock)
 			return ptr;
 		}
 
-		if (ptr->state == STATE_NULL ||
-		    ptr->state == STATE_COMPLETED) {
+		/* Keep looking for the socket, the sessions of the other
+		 * parallel streams may end in any order.
+		 */
+		if (!free && (ptr->state == STATE_NULL ||
+			      ptr->state == STATE_COMPLETED)) {
 			/* We found a free slot - just in case */
 			free = ptr;
-			break;
 		}
 
 		i++;
@@ -135,6 +138,7 @@ void zperf_reset_session_stats(struct session *session)
 	session->error = 0U;
 	session->jitter = 0;
 	session->last_transit_time = 0;
+	session->echo = false;
 }
 
 void zperf_session_init(void)
@@ -54,6 +54,11 @@ struct session {
 	int32_t jitter;
 	int32_t last_transit_time;
 
+	/* Send back the received data (bidirectional and request/response
+	 * modes).
+	 */
+	bool echo;
+
 	/* Stats packet*/
 	struct zperf_server_hdr stat;
 };
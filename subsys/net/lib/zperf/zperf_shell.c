@@ -450,82 +450,311 @@ static void shell_tcp_upload_print_stats(const struct shell *sh,
 	}
 }
 
+static uint32_t calc_rate_kbps(uint64_t bytes, uint32_t time_in_us)
+{
+	if (time_in_us == 0U) {
+		return 0U;
+	}
+
+	return (uint32_t)((bytes * 8ULL * (uint64_t)USEC_PER_SEC) /
+			  ((uint64_t)time_in_us * 1024ULL));
+}
+
+/* Rate seen by the client, from the packets it sent */
+static uint32_t client_rate_kbps(const struct zperf_results *results)
+{
+	return calc_rate_kbps((uint64_t)results->nb_packets_sent *
+			      results->packet_size,
+			      results->client_time_in_us);
+}
+
+static void sum_results(const struct zperf_results *results,
+			int num_streams, struct zperf_results *total)
+{
+	memset(total, 0, sizeof(*total));
+
+	for (int i = 0; i < num_streams; i++) {
+		total->nb_packets_sent += results[i].nb_packets_sent;
+		total->nb_packets_rcvd += results[i].nb_packets_rcvd;
+		total->nb_packets_lost += results[i].nb_packets_lost;
+		total->nb_packets_outorder += results[i].nb_packets_outorder;
+		total->nb_packets_errors += results[i].nb_packets_errors;
+		total->nb_packets_echoed += results[i].nb_packets_echoed;
+		total->nb_bytes_sent += results[i].nb_bytes_sent;
+		total->nb_bytes_echoed += results[i].nb_bytes_echoed;
+		total->time_in_us = MAX(total->time_in_us,
+					results[i].time_in_us);
+		total->client_time_in_us = MAX(total->client_time_in_us,
+					       results[i].client_time_in_us);
+		total->jitter_in_us = MAX(total->jitter_in_us,
+					  results[i].jitter_in_us);
+		total->packet_size = results[i].packet_size;
+	}
+}
+
+static void shell_streams_print_stats(const struct shell *sh,
+				      const struct zperf_results *results,
+				      int num_streams)
+{
+	for (int i = 0; i < num_streams; i++) {
+		shell_fprintf(sh, SHELL_NORMAL, "Stream %d:\t", i);
+		print_number(sh, client_rate_kbps(&results[i]), KBPS,
+			     KBPS_UNIT);
+		shell_fprintf(sh, SHELL_NORMAL, "\t(%u packets",
+			      results[i].nb_packets_sent);
+
+		if (IS_ENABLED(CONFIG_SCHED_THREAD_USAGE_ALL)) {
+			shell_fprintf(sh, SHELL_NORMAL, ", CPU %u%%",
+				      results[i].cpu_load);
+		}
+
+		shell_fprintf(sh, SHELL_NORMAL, ")\n");
+	}
+}
+
+static void shell_bidir_print_stats(const struct shell *sh,
+				    struct zperf_results *results)
+{
+	shell_fprintf(sh, SHELL_NORMAL, "Echoed:\t\t");
+	print_number(sh, calc_rate_kbps(results->nb_bytes_echoed,
+				      results->client_time_in_us),
+		     KBPS, KBPS_UNIT);
+	shell_fprintf(sh, SHELL_NORMAL, "\t(%u bytes)\n",
+		      results->nb_bytes_echoed);
+}
+
+static void shell_rr_print_stats(const struct shell *sh,
+				 struct zperf_results *results)
+{
+	uint32_t tps = 0U;
+
+	if (results->client_time_in_us != 0U) {
+		tps = (uint32_t)(((uint64_t)results->nb_packets_sent *
+				  USEC_PER_SEC) / results->client_time_in_us);
+	}
+
+	shell_fprintf(sh, SHELL_NORMAL, "-\nRequest/response completed!\n");
+
+	shell_fprintf(sh, SHELL_NORMAL, "Duration:\t");
+	print_number(sh, results->client_time_in_us, TIME_US, TIME_US_UNIT);
+	shell_fprintf(sh, SHELL_NORMAL, "\n");
+	shell_fprintf(sh, SHELL_NORMAL, "Transactions:\t%u\n",
+		      results->nb_packets_sent);
+	shell_fprintf(sh, SHELL_NORMAL, "Num lost:\t%u\n",
+		      results->nb_packets_lost);
+	shell_fprintf(sh, SHELL_NORMAL, "Rate:\t\t%u trans/s\n", tps);
+	shell_fprintf(sh, SHELL_NORMAL,
+		      "Latency (us):\tmin %u avg %u p50 %u p90 %u p99 %u "
+		      "max %u\n",
+		      results->latency_min_us, results->latency_avg_us,
+		      results->latency_p50_us, results->latency_p90_us,
+		      results->latency_p99_us, results->latency_max_us);
+}
+
+static const char *mode_str(enum zperf_upload_mode mode)
+{
+	switch (mode) {
+	case ZPERF_MODE_BIDIR:
+		return "bidir";
+	case ZPERF_MODE_RR:
+		return "rr";
+	default:
+		return "stream";
+	}
+}
+
+/* Print the results as a single line JSON object, for the scripts
+ * collecting them.
+ */
+static void shell_print_json(const struct shell *sh, bool is_udp,
+			     const struct zperf_upload_params *param,
+			     const struct zperf_results *results,
+			     struct zperf_results *total,
+			     uint32_t cpu_load)
+{
+	shell_fprintf(sh, SHELL_NORMAL,
+		      "{\"protocol\":\"%s\",\"mode\":\"%s\",\"streams\":%d,"
+		      "\"duration_us\":%u,\"packet_size\":%u,"
+		      "\"packets_sent\":%u,\"errors\":%u,\"rate_kbps\":%u",
+		      is_udp ? "udp" : "tcp", mode_str(param->mode),
+		      param->num_streams, total->client_time_in_us,
+		      total->packet_size, total->nb_packets_sent,
+		      total->nb_packets_errors, client_rate_kbps(total));
+
+	if (is_udp && param->mode != ZPERF_MODE_RR) {
+		shell_fprintf(sh, SHELL_NORMAL,
+			      ",\"server\":{\"packets\":%u,\"lost\":%u,"
+			      "\"outorder\":%u,\"jitter_us\":%u,"
+			      "\"rate_kbps\":%u}",
+			      total->nb_packets_rcvd, total->nb_packets_lost,
+			      total->nb_packets_outorder,
+			      total->jitter_in_us,
+			      calc_rate_kbps(total->nb_bytes_sent,
+					   total->time_in_us));
+	}
+
+	if (param->mode == ZPERF_MODE_BIDIR) {
+		shell_fprintf(sh, SHELL_NORMAL,
+			      ",\"echoed_bytes\":%u,\"echoed_rate_kbps\":%u",
+			      total->nb_bytes_echoed,
+			      calc_rate_kbps(total->nb_bytes_echoed,
+					   total->client_time_in_us));
+	}
+
+	if (param->mode == ZPERF_MODE_RR) {
+		shell_fprintf(sh, SHELL_NORMAL,
+			      ",\"transactions\":%u,\"lost\":%u,"
+			      "\"busy_poll_us\":%u,"
+			      "\"latency_us\":{\"min\":%u,\"avg\":%u,"
+			      "\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+			      total->nb_packets_sent, total->nb_packets_lost,
+			      param->busy_poll_us,
+			      total->latency_min_us, total->latency_avg_us,
+			      total->latency_p50_us, total->latency_p90_us,
+			      total->latency_p99_us, total->latency_max_us);
+	}
+
+	if (IS_ENABLED(CONFIG_SCHED_THREAD_USAGE_ALL)) {
+		shell_fprintf(sh, SHELL_NORMAL, ",\"cpu_load\":%u", cpu_load);
+	}
+
+	shell_fprintf(sh, SHELL_NORMAL, ",\"per_stream\":[");
+
+	for (int i = 0; i < param->num_streams; i++) {
+		shell_fprintf(sh, SHELL_NORMAL,
+			      "%s{\"packets_sent\":%u,\"rate_kbps\":%u",
+			      i ? "," : "", results[i].nb_packets_sent,
+			      client_rate_kbps(&results[i]));
+
+		if (param->mode == ZPERF_MODE_RR) {
+			shell_fprintf(sh, SHELL_NORMAL, ",\"p99_us\":%u",
+				      results[i].latency_p99_us);
+		}
+
+		if (IS_ENABLED(CONFIG_SCHED_THREAD_USAGE_ALL)) {
+			shell_fprintf(sh, SHELL_NORMAL, ",\"cpu_load\":%u",
+				      results[i].cpu_load);
+		}
+
+		shell_fprintf(sh, SHELL_NORMAL, "}");
+	}
+
+	shell_fprintf(sh, SHELL_NORMAL, "]}\n");
+}
+
+static void shell_print_stats(const struct shell *sh, bool is_udp,
+			      const struct zperf_upload_params *param,
+			      struct zperf_results *results,
+			      bool json, uint32_t cpu_load)
+{
+	struct zperf_results total;
+
+	sum_results(results, param->num_streams, &total);
+
+	if (param->mode == ZPERF_MODE_RR) {
+		zperf_rr_merge(results, param->num_streams, &total);
+	}
+
+	if (json) {
+		shell_print_json(sh, is_udp, param, results, &total, cpu_load);
+		return;
+	}
+
+	if (param->num_streams > 1) {
+		shell_streams_print_stats(sh, results, param->num_streams);
+	}
+
+	if (param->mode == ZPERF_MODE_RR) {
+		shell_rr_print_stats(sh, &total);
+	} else if (is_udp) {
+		shell_udp_upload_print_stats(sh, &total);
+	} else {
+		shell_tcp_upload_print_stats(sh, &total);
+	}
+
+	if (param->mode == ZPERF_MODE_BIDIR) {
+		shell_bidir_print_stats(sh, &total);
+	}
+
+	if (IS_ENABLED(CONFIG_SCHED_THREAD_USAGE_ALL)) {
+		shell_fprintf(sh, SHELL_NORMAL, "CPU load:\t%u%%\n", cpu_load);
+	}
+}
+
 static int setup_upload_sockets(const struct shell *sh,
-				int *sock6,
-				int *sock4,
+				int *socks,
+				int num_streams,
 				sa_family_t family,
-				struct sockaddr_in6 *ipv6,
-				struct sockaddr_in *ipv4,
-				int port,
-				bool is_udp,
-				char *argv0)
+				const struct sockaddr *addr,
+				socklen_t addrlen,
+				bool is_udp)
 {
-	if (IS_ENABLED(CONFIG_NET_IPV6)) {
-		*sock6 = zsock_socket(AF_INET6,
-				      is_udp ? SOCK_DGRAM : SOCK_STREAM,
-				      is_udp ? IPPROTO_UDP : IPPROTO_TCP);
-		if (*sock6 < 0) {
+	int ret;
+
+	for (int i = 0; i < num_streams; i++) {
+		socks[i] = zsock_socket(family,
+					is_udp ? SOCK_DGRAM : SOCK_STREAM,
+					is_udp ? IPPROTO_UDP : IPPROTO_TCP);
+		if (socks[i] < 0) {
 			shell_fprintf(sh, SHELL_WARNING,
-				      "Cannot create IPv6 network socket (%d)\n",
-				      errno);
+				      "Cannot create IPv%d network socket (%d)\n",
+				      family == AF_INET6 ? 6 : 4, errno);
 			return -ENOEXEC;
 		}
 
-		ipv6->sin6_port = htons(port);
-		ipv6->sin6_family = AF_INET6;
-	}
-
-	if (IS_ENABLED(CONFIG_NET_IPV4)) {
-		*sock4 = zsock_socket(AF_INET,
-				      is_udp ? SOCK_DGRAM : SOCK_STREAM,
-				      is_udp ? IPPROTO_UDP : IPPROTO_TCP);
-		if (*sock4 < 0) {
+		ret = zsock_connect(socks[i], addr, addrlen);
+		if (ret < 0) {
 			shell_fprintf(sh, SHELL_WARNING,
-				      "Cannot create IPv4 network socket (%d)\n",
-				      errno);
+				      "IPv%d connect failed (%d)\n",
+				      family == AF_INET6 ? 6 : 4, errno);
 			return -ENOEXEC;
 		}
-
-		ipv4->sin_port = htons(port);
-		ipv4->sin_family = AF_INET;
-	}
-
-	if ((*sock6 < 0) && (*sock4 < 0)) {
-		shell_fprintf(sh, SHELL_WARNING,
-			      "Fail to create network socket(s)\n");
-		return -ENOEXEC;
 	}
 
 	return 0;
 }
 
 static int execute_upload(const struct shell *sh,
-			  int sock6,
-			  int sock4,
 			  sa_family_t family,
 			  struct sockaddr_in6 *ipv6,
 			  struct sockaddr_in *ipv4,
 			  bool is_udp,
-			  int port,
-			  char *argv0,
-			  unsigned int duration_in_ms,
-			  unsigned int packet_size,
-			  unsigned int rate_in_kbps)
+			  struct zperf_upload_params *param,
+			  bool json)
 {
-	struct zperf_results results = { };
+	static struct zperf_results results[CONFIG_NET_ZPERF_MAX_STREAMS];
+	int socks[CONFIG_NET_ZPERF_MAX_STREAMS];
+	const struct sockaddr *addr;
+	socklen_t addrlen;
+	uint32_t cpu_load;
 	int ret;
 
-	shell_fprintf(sh, SHELL_NORMAL, "Duration:\t");
-	print_number(sh, duration_in_ms * USEC_PER_MSEC, TIME_US,
-		     TIME_US_UNIT);
-	shell_fprintf(sh, SHELL_NORMAL, "\n");
-	shell_fprintf(sh, SHELL_NORMAL, "Packet size:\t%u bytes\n",
-		      packet_size);
-	shell_fprintf(sh, SHELL_NORMAL, "Rate:\t\t%u kbps\n",
-		      rate_in_kbps);
-	shell_fprintf(sh, SHELL_NORMAL, "Starting...\n");
+	if ((is_udp && !IS_ENABLED(CONFIG_NET_UDP)) ||
+	    (!is_udp && !IS_ENABLED(CONFIG_NET_TCP))) {
+		shell_fprintf(sh, SHELL_INFO, "%s not supported\n",
+			      is_udp ? "UDP" : "TCP");
+		return 0;
+	}
+
+	if (!json) {
+		shell_fprintf(sh, SHELL_NORMAL, "Duration:\t");
+		print_number(sh, param->duration_ms * USEC_PER_MSEC, TIME_US,
+			     TIME_US_UNIT);
+		shell_fprintf(sh, SHELL_NORMAL, "\n");
+		shell_fprintf(sh, SHELL_NORMAL, "Packet size:\t%u bytes\n",
+			      param->packet_size);
+		shell_fprintf(sh, SHELL_NORMAL, "Rate:\t\t%u kbps\n",
+			      param->rate_kbps);
+
+		if (param->num_streams > 1) {
+			shell_fprintf(sh, SHELL_NORMAL, "Streams:\t%d\n",
+				      param->num_streams);
+		}
 
-	if (IS_ENABLED(CONFIG_NET_IPV6) && family == AF_INET6 && sock6 >= 0) {
+		shell_fprintf(sh, SHELL_NORMAL, "Starting...\n");
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && family == AF_INET6) {
 		/* For IPv6, we should make sure that neighbor discovery
 		 * has been done for the peer. So send ping here, wait
 		 * some time and start the test after that.
@@ -536,115 +765,101 @@ static int execute_upload(const struct shell *sh,
 		k_sleep(K_SECONDS(1));
 	}
 
-	if (is_udp && IS_ENABLED(CONFIG_NET_UDP)) {
+	if (is_udp && param->mode != ZPERF_MODE_RR && !json) {
 		shell_fprintf(sh, SHELL_NORMAL, "Rate:\t\t");
-		print_number(sh, rate_in_kbps, KBPS, KBPS_UNIT);
+		print_number(sh, param->rate_kbps, KBPS, KBPS_UNIT);
 		shell_fprintf(sh, SHELL_NORMAL, "\n");
+	}
 
-		if (family == AF_INET6 && sock6 >= 0) {
-			ret = zsock_connect(sock6,
-					    (struct sockaddr *)ipv6,
-					    sizeof(*ipv6));
-			if (ret < 0) {
-				shell_fprintf(sh, SHELL_WARNING,
-					      "IPv6 connect failed (%d)\n",
-					      errno);
-				goto out;
-			}
+	if (family == AF_INET6) {
+		addr = (struct sockaddr *)ipv6;
+		addrlen = sizeof(*ipv6);
+	} else {
+		addr = (struct sockaddr *)ipv4;
+		addrlen = sizeof(*ipv4);
+	}
 
-			zperf_udp_upload(sh, sock6, port, duration_in_ms,
-					 packet_size, rate_in_kbps, &results);
-			shell_udp_upload_print_stats(sh, &results);
-		}
+	for (int i = 0; i < ARRAY_SIZE(socks); i++) {
+		socks[i] = -1;
+	}
 
-		if (family == AF_INET && sock4 >= 0) {
-			ret = zsock_connect(sock4,
-					    (struct sockaddr *)ipv4,
-					    sizeof(*ipv4));
-			if (ret < 0) {
-				shell_fprintf(sh, SHELL_NORMAL,
-					      "IPv4 connect failed (%d)\n",
-					      errno);
-				goto out;
-			}
+	ret = setup_upload_sockets(sh, socks, param->num_streams, family,
+				   addr, addrlen, is_udp);
+	if (ret < 0) {
+		goto out;
+	}
 
-			zperf_udp_upload(sh, sock4, port, duration_in_ms,
-					 packet_size, rate_in_kbps, &results);
-			shell_udp_upload_print_stats(sh, &results);
-		}
-	} else {
-		if (!IS_ENABLED(CONFIG_NET_UDP)) {
-			shell_fprintf(sh, SHELL_INFO,
-				      "UDP not supported\n");
-		}
+	ret = zperf_streams_run(sh, socks, is_udp, param, results, &cpu_load);
+	if (ret < 0) {
+		goto out;
 	}
 
-	if (!is_udp && IS_ENABLED(CONFIG_NET_TCP)) {
-		if (family == AF_INET6 && sock6 >= 0) {
-			ret = zsock_connect(sock6,
-					    (struct sockaddr *)ipv6,
-					    sizeof(*ipv6));
-			if (ret < 0) {
-				shell_fprintf(sh, SHELL_WARNING,
-					      "IPv6 connect failed (%d)\n",
-					      errno);
-				goto out;
-			}
+	shell_print_stats(sh, is_udp, param, results, json, cpu_load);
 
-			/* We either upload using IPv4 or IPv6, not both at
-			 * the same time.
-			 */
-			if (IS_ENABLED(CONFIG_NET_IPV4) && sock4 >= 0) {
-				(void)zsock_close(sock4);
-				sock4 = -1;
-			}
+out:
+	for (int i = 0; i < ARRAY_SIZE(socks); i++) {
+		if (socks[i] >= 0) {
+			(void)zsock_close(socks[i]);
+		}
+	}
 
-			zperf_tcp_upload(sh, sock6, duration_in_ms,
-					 packet_size, &results);
+	return 0;
+}
 
-			shell_tcp_upload_print_stats(sh, &results);
-		}
+/* Parse the options given in front of the positional arguments of the
+ * upload commands. Returns the number of arguments consumed.
+ */
+static int parse_upload_opts(const struct shell *sh, size_t argc,
+			     char *argv[], struct zperf_upload_params *param,
+			     bool *json)
+{
+	int i;
+
+	param->mode = ZPERF_MODE_STREAM;
+	param->num_streams = 1;
+	param->stream = 0;
+	param->busy_poll_us = 0U;
+	*json = false;
 
-		if (family == AF_INET && sock4 >= 0) {
-			ret = zsock_connect(sock4,
-					    (struct sockaddr *)ipv4,
-					    sizeof(*ipv4));
-			if (ret < 0) {
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "-P")) {
+			if (++i == argc) {
 				shell_fprintf(sh, SHELL_WARNING,
-					      "IPv4 connect failed (%d)\n",
-					      errno);
-				goto out;
+					      "Missing number of streams\n");
+				return -ENOEXEC;
 			}
 
-			if (IS_ENABLED(CONFIG_NET_IPV6) && sock6 >= 0) {
-				(void)zsock_close(sock6);
-				sock6 = -1;
+			param->num_streams = strtoul(argv[i], NULL, 10);
+			if (param->num_streams < 1 ||
+			    param->num_streams > CONFIG_NET_ZPERF_MAX_STREAMS) {
+				shell_fprintf(sh, SHELL_WARNING,
+					      "Number of streams must be "
+					      "between 1 and %d\n",
+					      CONFIG_NET_ZPERF_MAX_STREAMS);
+				return -ENOEXEC;
+			}
+		} else if (!strcmp(argv[i], "-d")) {
+			param->mode = ZPERF_MODE_BIDIR;
+		} else if (!strcmp(argv[i], "-r")) {
+			param->mode = ZPERF_MODE_RR;
+		} else if (!strcmp(argv[i], "-b")) {
+			if (++i == argc) {
+				shell_fprintf(sh, SHELL_WARNING,
+					      "Missing busy poll time\n");
+				return -ENOEXEC;
 			}
 
-			zperf_tcp_upload(sh, sock4, duration_in_ms,
-					 packet_size, &results);
-
-			shell_tcp_upload_print_stats(sh, &results);
-		}
-	} else {
-		if (!IS_ENABLED(CONFIG_NET_TCP)) {
-			shell_fprintf(sh, SHELL_INFO,
-				      "TCP not supported\n");
+			param->busy_poll_us = strtoul(argv[i], NULL, 10);
+		} else if (!strcmp(argv[i], "-j")) {
+			*json = true;
+		} else {
+			shell_fprintf(sh, SHELL_WARNING,
+				      "Unknown option %s\n", argv[i]);
+			return -ENOEXEC;
 		}
 	}
 
-out:
-	if (IS_ENABLED(CONFIG_NET_IPV6) && sock6 >= 0) {
-		(void)zsock_close(sock6);
-		sock6 = -1;
-	}
-
-	if (IS_ENABLED(CONFIG_NET_IPV4) && sock4 >= 0) {
-		(void)zsock_close(sock4);
-		sock4 = -1;
-	}
-
-	return 0;
+	return i - 1;
 }
 
 static int shell_cmd_upload(const struct shell *sh, size_t argc,
@@ -652,16 +867,23 @@ static int shell_cmd_upload(const struct shell *sh, size_t argc,
 {
 	struct sockaddr_in6 ipv6 = { .sin6_family = AF_INET6 };
 	struct sockaddr_in ipv4 = { .sin_family = AF_INET };
-	int sock6 = -1, sock4 = -1;
 	sa_family_t family = AF_UNSPEC;
-	unsigned int duration_in_ms, packet_size, rate_in_kbps;
+	struct zperf_upload_params param;
 	char *port_str;
 	uint16_t port;
 	bool is_udp;
-	int start = 0;
+	bool json;
+	int start;
 
 	is_udp = proto == IPPROTO_UDP;
 
+	start = parse_upload_opts(sh, argc, argv, &param, &json);
+	if (start < 0) {
+		return start;
+	}
+
+	argc -= start;
+
 	if (argc < 2) {
 		shell_fprintf(sh, SHELL_WARNING,
 			      "Not enough parameters.\n");
@@ -746,35 +968,31 @@ static int shell_cmd_upload(const struct shell *sh, size_t argc,
 		}
 	}
 
-	if (setup_upload_sockets(sh, &sock6, &sock4, family, &in6_addr_my,
-				 &in4_addr_my, port, is_udp, argv[start]) < 0) {
-		return -ENOEXEC;
-	}
+	param.port = port;
 
 	if (argc > 3) {
-		duration_in_ms = MSEC_PER_SEC * strtoul(argv[start + 3],
-							NULL, 10);
+		param.duration_ms = MSEC_PER_SEC * strtoul(argv[start + 3],
+							   NULL, 10);
 	} else {
-		duration_in_ms = MSEC_PER_SEC * 1;
+		param.duration_ms = MSEC_PER_SEC * 1;
 	}
 
 	if (argc > 4) {
-		packet_size = parse_number(argv[start + 4], K, K_UNIT);
+		param.packet_size = parse_number(argv[start + 4], K, K_UNIT);
 	} else {
-		packet_size = 256U;
+		param.packet_size = 256U;
 	}
 
 	if (argc > 5) {
-		rate_in_kbps =
+		param.rate_kbps =
 			(parse_number(argv[start + 5], K, K_UNIT) +
 			 1023) / 1024;
 	} else {
-		rate_in_kbps = 10U;
+		param.rate_kbps = 10U;
 	}
 
-	return execute_upload(sh, sock6, sock4, family, &ipv6, &ipv4,
-			      is_udp, port, argv[start], duration_in_ms,
-			      packet_size, rate_in_kbps);
+	return execute_upload(sh, family, &ipv6, &ipv4, is_udp, &param,
+			      json);
 }
 
 static int cmd_tcp_upload(const struct shell *sh, size_t argc, char *argv[])
@@ -794,15 +1012,22 @@ static int cmd_udp_upload(const struct shell *sh, size_t argc, char *argv[])
 static int shell_cmd_upload2(const struct shell *sh, size_t argc,
 			     char *argv[], enum net_ip_protocol proto)
 {
-	int sock6 = -1, sock4 = -1;
 	uint16_t port = DEF_PORT;
-	unsigned int duration_in_ms, packet_size, rate_in_kbps;
+	struct zperf_upload_params param;
 	sa_family_t family;
 	uint8_t is_udp;
-	int start = 0;
+	bool json;
+	int start;
 
 	is_udp = proto == IPPROTO_UDP;
 
+	start = parse_upload_opts(sh, argc, argv, &param, &json);
+	if (start < 0) {
+		return start;
+	}
+
+	argc -= start;
+
 	if (argc < 2) {
 		shell_fprintf(sh, SHELL_WARNING,
 			      "Not enough parameters.\n");
@@ -866,35 +1091,31 @@ static int shell_cmd_upload2(const struct shell *sh, size_t argc,
 			      net_sprint_ipv4_addr(&in4_addr_dst.sin_addr));
 	}
 
-	if (setup_upload_sockets(sh, &sock6, &sock4, family, &in6_addr_my,
-				 &in4_addr_my, port, is_udp, argv[start]) < 0) {
-		return -ENOEXEC;
-	}
+	param.port = port;
 
 	if (argc > 2) {
-		duration_in_ms = MSEC_PER_SEC * strtoul(argv[start + 2],
-							NULL, 10);
+		param.duration_ms = MSEC_PER_SEC * strtoul(argv[start + 2],
+							   NULL, 10);
 	} else {
-		duration_in_ms = MSEC_PER_SEC * 1;
+		param.duration_ms = MSEC_PER_SEC * 1;
 	}
 
 	if (argc > 3) {
-		packet_size = parse_number(argv[start + 3], K, K_UNIT);
+		param.packet_size = parse_number(argv[start + 3], K, K_UNIT);
 	} else {
-		packet_size = 256U;
+		param.packet_size = 256U;
 	}
 
 	if (argc > 4) {
-		rate_in_kbps =
+		param.rate_kbps =
 			(parse_number(argv[start + 4], K, K_UNIT) + 1023) /
 			1024;
 	} else {
-		rate_in_kbps = 10U;
+		param.rate_kbps = 10U;
 	}
 
-	return execute_upload(sh, sock6, sock4, family, &in6_addr_dst,
-			      &in4_addr_dst, is_udp, port, argv[start],
-			      duration_in_ms, packet_size, rate_in_kbps);
+	return execute_upload(sh, family, &in6_addr_dst, &in4_addr_dst,
+			      is_udp, &param, json);
 }
 
 static int cmd_tcp_upload2(const struct shell *sh, size_t argc,
@@ -1066,25 +1287,42 @@ static void zperf_init(const struct shell *sh)
 	zperf_session_init();
 }
 
+#define UPLOAD_OPTS_HELP							\
+	"Options, given before the other parameters:\n"			\
+	"-P <streams>  Number of parallel streams (max "			\
+				STRINGIFY(CONFIG_NET_ZPERF_MAX_STREAMS) ")\n"	\
+	"-d            Bidirectional, the server echoes the data back\n"	\
+	"-r            Request/response, measures the round trip "		\
+							"latency of\n"		\
+	"              <packet size> requests\n"				\
+	"-b <usec>     With -r, busy poll the interface for <usec> "	\
+							"before\n"		\
+	"              sleeping while waiting for a response\n"		\
+	"-j            Print the results as JSON\n"
+
 SHELL_STATIC_SUBCMD_SET_CREATE(zperf_cmd_tcp,
 	SHELL_CMD(upload, NULL,
-		  "<dest ip> <dest port> <duration> <packet size>[K]\n"
+		  "[<options>] <dest ip> <dest port> <duration> "
+							"<packet size>[K]\n"
 		  "<dest ip>     IP destination\n"
 		  "<dest port>   port destination\n"
 		  "<duration>    of the test in seconds\n"
 		  "<packet size> Size of the packet in byte or kilobyte "
 							"(with suffix K)\n"
+		  UPLOAD_OPTS_HELP
 		  "Example: tcp upload 192.0.2.2 1111 1 1K\n"
-		  "Example: tcp upload 2001:db8::2\n",
+		  "Example: tcp upload -P 4 -j 2001:db8::2\n",
 		  cmd_tcp_upload),
 	SHELL_CMD(upload2, NULL,
-		  "v6|v4 <duration> <packet size>[K] <baud rate>[K|M]\n"
+		  "[<options>] v6|v4 <duration> <packet size>[K] "
+							"<baud rate>[K|M]\n"
 		  "<v6|v4>:      Use either IPv6 or IPv4\n"
 		  "<duration>    Duration of the test in seconds\n"
 		  "<packet size> Size of the packet in byte or kilobyte "
 							"(with suffix K)\n"
+		  UPLOAD_OPTS_HELP
 		  "Example: tcp upload2 v6 1 1K\n"
-		  "Example: tcp upload2 v4\n"
+		  "Example: tcp upload2 -r v4 10 1\n"
 #if defined(CONFIG_NET_IPV6) && defined(MY_IP6ADDR_SET)
 		  "Default IPv6 address is " MY_IP6ADDR
 		  ", destination [" DST_IP6ADDR "]:" DEF_PORT_STR "\n"
@@ -1104,26 +1342,29 @@ SHELL_STATIC_SUBCMD_SET_CREATE(zperf_cmd_tcp,
 
 SHELL_STATIC_SUBCMD_SET_CREATE(zperf_cmd_udp,
 	SHELL_CMD(upload, NULL,
-		  "<dest ip> [<dest port> <duration> <packet size>[K] "
-							"<baud rate>[K|M]]\n"
+		  "[<options>] <dest ip> [<dest port> <duration> "
+					"<packet size>[K] <baud rate>[K|M]]\n"
 		  "<dest ip>     IP destination\n"
 		  "<dest port>   port destination\n"
 		  "<duration>    of the test in seconds\n"
 		  "<packet size> Size of the packet in byte or kilobyte "
 							"(with suffix K)\n"
 		  "<baud rate>   Baudrate in kilobyte or megabyte\n"
+		  UPLOAD_OPTS_HELP
 		  "Example: udp upload 192.0.2.2 1111 1 1K 1M\n"
-		  "Example: udp upload 2001:db8::2\n",
+		  "Example: udp upload -d 2001:db8::2\n",
 		  cmd_udp_upload),
 	SHELL_CMD(upload2, NULL,
-		  "v6|v4 [<duration> <packet size>[K] <baud rate>[K|M]]\n"
+		  "[<options>] v6|v4 [<duration> <packet size>[K] "
+							"<baud rate>[K|M]]\n"
 		  "<v6|v4>:      Use either IPv6 or IPv4\n"
 		  "<duration>    Duration of the test in seconds\n"
 		  "<packet size> Size of the packet in byte or kilobyte "
 							"(with suffix K)\n"
 		  "<baud rate>   Baudrate in kilobyte or megabyte\n"
+		  UPLOAD_OPTS_HELP
 		  "Example: udp upload2 v4 1 1K 1M\n"
-		  "Example: udp upload2 v6\n"
+		  "Example: udp upload2 -r -P 2 -j v6 10 64\n"
 #if defined(CONFIG_NET_IPV6) && defined(MY_IP6ADDR_SET)
 		  "Default IPv6 address is " MY_IP6ADDR
 		  ", destination [" DST_IP6ADDR "]:" DEF_PORT_STR "\n"
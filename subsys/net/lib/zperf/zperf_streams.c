@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(net_zperf, CONFIG_NET_ZPERF_LOG_LEVEL);
+
+#include <string.h>
+
+#include <zephyr/zephyr.h>
+
+#include "zperf.h"
+#include "zperf_internal.h"
+
+#if IS_ENABLED(CONFIG_NET_TC_THREAD_COOPERATIVE)
+#define STREAM_THREAD_PRIORITY K_PRIO_COOP(8)
+#else
+#define STREAM_THREAD_PRIORITY K_PRIO_PREEMPT(8)
+#endif
+
+struct zperf_stream {
+	const struct shell *sh;
+	int sock;
+	bool is_udp;
+	struct zperf_upload_params param;
+	struct zperf_results *results;
+};
+
+static struct zperf_stream streams[CONFIG_NET_ZPERF_MAX_STREAMS];
+
+#if CONFIG_NET_ZPERF_MAX_STREAMS > 1
+/* The first stream runs in the thread calling zperf_streams_run() */
+K_THREAD_STACK_ARRAY_DEFINE(stream_stacks, CONFIG_NET_ZPERF_MAX_STREAMS - 1,
+			    CONFIG_NET_ZPERF_STREAM_STACK_SIZE);
+static struct k_thread stream_threads[CONFIG_NET_ZPERF_MAX_STREAMS - 1];
+#endif
+
+static void stream_run(struct zperf_stream *stream)
+{
+	if (stream->param.mode == ZPERF_MODE_RR) {
+		zperf_rr_upload(stream->sh, stream->sock, stream->is_udp,
+				&stream->param, stream->results);
+	} else if (stream->is_udp) {
+		zperf_udp_upload(stream->sh, stream->sock, &stream->param,
+				 stream->results);
+	} else {
+		zperf_tcp_upload(stream->sh, stream->sock, &stream->param,
+				 stream->results);
+	}
+}
+
+#if CONFIG_NET_ZPERF_MAX_STREAMS > 1
+static void stream_thread(void *ptr1, void *ptr2, void *ptr3)
+{
+	ARG_UNUSED(ptr2);
+	ARG_UNUSED(ptr3);
+
+	stream_run(ptr1);
+}
+#endif
+
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+static uint64_t thread_cycles(k_tid_t thread)
+{
+	k_thread_runtime_stats_t stats;
+
+	if (k_thread_runtime_stats_get(thread, &stats) < 0) {
+		return 0;
+	}
+
+	return stats.execution_cycles;
+}
+
+/* Load in percent of the given number of cycles over the run */
+static uint32_t load_pct(uint64_t cycles, uint64_t elapsed)
+{
+	return elapsed ? (uint32_t)((cycles * 100U) / elapsed) : 0U;
+}
+#endif
+
+/* Run the streams of an upload in parallel and wait until all of them are
+ * done. The results of stream i are stored in results[i], the system load
+ * sampled through the thread runtime statistics in cpu_load (percent of
+ * all the CPUs, 0 if the statistics are not enabled).
+ */
+int zperf_streams_run(const struct shell *sh,
+		      const int *socks,
+		      bool is_udp,
+		      const struct zperf_upload_params *param,
+		      struct zperf_results *results,
+		      uint32_t *cpu_load)
+{
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+	k_thread_runtime_stats_t cpu_start, cpu_end;
+	uint64_t main_start, elapsed;
+#endif
+
+	if (param->num_streams < 1 ||
+	    param->num_streams > CONFIG_NET_ZPERF_MAX_STREAMS) {
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < param->num_streams; i++) {
+		streams[i].sh = sh;
+		streams[i].sock = socks[i];
+		streams[i].is_udp = is_udp;
+		streams[i].param = *param;
+		streams[i].param.stream = i;
+		streams[i].results = &results[i];
+
+		memset(&results[i], 0, sizeof(results[i]));
+	}
+
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+	(void)k_thread_runtime_stats_all_get(&cpu_start);
+	main_start = thread_cycles(k_current_get());
+#endif
+
+#if CONFIG_NET_ZPERF_MAX_STREAMS > 1
+	for (int i = 1; i < param->num_streams; i++) {
+		k_thread_create(&stream_threads[i - 1], stream_stacks[i - 1],
+				K_THREAD_STACK_SIZEOF(stream_stacks[i - 1]),
+				stream_thread, &streams[i], NULL, NULL,
+				STREAM_THREAD_PRIORITY,
+				IS_ENABLED(CONFIG_USERSPACE) ? K_USER |
+							       K_INHERIT_PERMS : 0,
+				K_NO_WAIT);
+	}
+#endif
+
+	stream_run(&streams[0]);
+
+#if CONFIG_NET_ZPERF_MAX_STREAMS > 1
+	for (int i = 1; i < param->num_streams; i++) {
+		(void)k_thread_join(&stream_threads[i - 1], K_FOREVER);
+	}
+#endif
+
+	*cpu_load = 0U;
+
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+	(void)k_thread_runtime_stats_all_get(&cpu_end);
+
+	/* For the CPUs, execution_cycles counts the idle time too */
+	elapsed = cpu_end.execution_cycles - cpu_start.execution_cycles;
+
+	*cpu_load = load_pct(cpu_end.total_cycles - cpu_start.total_cycles,
+			     elapsed);
+
+	/* Per stream load relative to a single CPU */
+	elapsed /= CONFIG_MP_NUM_CPUS;
+
+	results[0].cpu_load = load_pct(thread_cycles(k_current_get()) -
+				       main_start, elapsed);
+
+#if CONFIG_NET_ZPERF_MAX_STREAMS > 1
+	for (int i = 1; i < param->num_streams; i++) {
+		results[i].cpu_load =
+			load_pct(thread_cycles(&stream_threads[i - 1]),
+				 elapsed);
+	}
+#endif
+#endif /* CONFIG_SCHED_THREAD_USAGE_ALL */
+
+	return 0;
+}
@@ -37,17 +37,48 @@ static bool init_done;
 #define TCP_RECEIVER_STACK_SIZE 2048
 
 #define SOCK_ID_IPV4_LISTEN 0
-#define SOCK_ID_IPV4_DATA 1
-#define SOCK_ID_IPV6_LISTEN 2
-#define SOCK_ID_IPV6_DATA 3
-#define SOCK_ID_MAX 4
+#define SOCK_ID_IPV6_LISTEN 1
+#define SOCK_ID_DATA 2
+/* One connection per parallel stream, and at least one per IP family */
+#define SOCK_ID_DATA_COUNT MAX(2, CONFIG_NET_ZPERF_MAX_STREAMS)
+#define SOCK_ID_MAX (SOCK_ID_DATA + SOCK_ID_DATA_COUNT)
 
 #define TCP_RECEIVER_BUF_SIZE 1500
 
 K_THREAD_STACK_DEFINE(tcp_receiver_stack_area, TCP_RECEIVER_STACK_SIZE);
 struct k_thread tcp_receiver_thread_data;
 
-static void tcp_received(const struct shell *sh, int sock, size_t datalen)
+static bool tcp_echo_requested(const uint8_t *data, size_t datalen)
+{
+	if (datalen < sizeof(uint32_t)) {
+		return false;
+	}
+
+	return (ntohl(UNALIGNED_GET((uint32_t *)data)) & ZPERF_FLAG_ECHO) != 0;
+}
+
+/* Return the data to the client in bidirectional and request/response
+ * modes. The client keeps reading while it sends, so blocking here does
+ * not stall the connection.
+ */
+static void tcp_echo(int sock, const uint8_t *data, size_t datalen)
+{
+	int ret;
+
+	while (datalen > 0) {
+		ret = zsock_send(sock, data, datalen, 0);
+		if (ret < 0) {
+			NET_DBG("Cannot echo data to peer (%d)", errno);
+			return;
+		}
+
+		data += ret;
+		datalen -= ret;
+	}
+}
+
+static void tcp_received(const struct shell *sh, int sock,
+			 const uint8_t *data, size_t datalen)
 {
 	struct session *session;
 	int64_t time;
@@ -69,11 +100,16 @@ static void tcp_received(const struct shell *sh, int sock, size_t datalen)
 		zperf_reset_session_stats(session);
 		session->start_time = k_uptime_ticks();
 		session->state = STATE_ONGOING;
+		session->echo = tcp_echo_requested(data, datalen);
 		__fallthrough;
 	case STATE_ONGOING:
 		session->counter++;
 		session->length += datalen;
 
+		if (session->echo) {
+			tcp_echo(sock, data, datalen);
+		}
+
 		if (datalen == 0) { /* EOF */
 			uint32_t rate_in_kbps;
 			uint32_t duration;
@@ -119,6 +155,20 @@ static void tcp_received(const struct shell *sh, int sock, size_t datalen)
 	}
 }
 
+/* Close a connection lost in the middle of a session */
+static void tcp_abort(struct zsock_pollfd *pfd)
+{
+	struct session *session;
+
+	session = get_tcp_session(pfd->fd);
+	if (session) {
+		session->state = STATE_NULL;
+	}
+
+	zsock_close(pfd->fd);
+	pfd->fd = -1;
+}
+
 void tcp_receiver_thread(void *ptr1, void *ptr2, void *ptr3)
 {
 	ARG_UNUSED(ptr3);
@@ -184,7 +234,8 @@ void tcp_receiver_thread(void *ptr1, void *ptr2, void *ptr3)
 			goto cleanup;
 		}
 
-		ret = zsock_listen(fds[SOCK_ID_IPV4_LISTEN].fd, 1);
+		ret = zsock_listen(fds[SOCK_ID_IPV4_LISTEN].fd,
+				   SOCK_ID_DATA_COUNT);
 		if (ret < 0) {
 			shell_fprintf(sh, SHELL_WARNING,
 				      "Cannot listen IPv4 TCP (%d)", errno);
@@ -246,7 +297,8 @@ void tcp_receiver_thread(void *ptr1, void *ptr2, void *ptr3)
 			goto cleanup;
 		}
 
-		ret = zsock_listen(fds[SOCK_ID_IPV6_LISTEN].fd, 1);
+		ret = zsock_listen(fds[SOCK_ID_IPV6_LISTEN].fd,
+				   SOCK_ID_DATA_COUNT);
 		if (ret < 0) {
 			shell_fprintf(sh, SHELL_WARNING,
 				      "Cannot listen IPv6 TCP (%d)", errno);
@@ -278,10 +330,19 @@ void tcp_receiver_thread(void *ptr1, void *ptr2, void *ptr3)
 
 			if ((fds[i].revents & ZSOCK_POLLERR) ||
 			    (fds[i].revents & ZSOCK_POLLNVAL)) {
+				if (i >= SOCK_ID_DATA) {
+					/* Only this connection is lost */
+					shell_fprintf(sh, SHELL_WARNING,
+						      "TCP receiver data socket "
+						      "error\n");
+					tcp_abort(&fds[i]);
+					continue;
+				}
+
 				shell_fprintf(
 					sh, SHELL_WARNING,
 					"TCP receiver IPv%d socket error\n",
-					(i <= SOCK_ID_IPV4_DATA) ? 4 : 6);
+					(i == SOCK_ID_IPV4_LISTEN) ? 4 : 6);
 				goto cleanup;
 			}
 
@@ -289,57 +350,52 @@ void tcp_receiver_thread(void *ptr1, void *ptr2, void *ptr3)
 				continue;
 			}
 
-			switch (i) {
-			case SOCK_ID_IPV4_LISTEN:
-			case SOCK_ID_IPV6_LISTEN:{
+			if (i < SOCK_ID_DATA) {
 				int sock = zsock_accept(fds[i].fd, &addr,
 							&addrlen);
+				int j;
 
 				if (sock < 0) {
 					shell_fprintf(
 						sh, SHELL_WARNING,
 						"TCP receiver IPv%d accept error\n",
-						(i <= SOCK_ID_IPV4_DATA) ? 4 : 6);
+						(i == SOCK_ID_IPV4_LISTEN) ? 4 : 6);
 					goto cleanup;
 				}
 
-				if (i == SOCK_ID_IPV4_LISTEN &&
-				    fds[SOCK_ID_IPV4_DATA].fd < 0) {
-					fds[SOCK_ID_IPV4_DATA].fd = sock;
-					fds[SOCK_ID_IPV4_DATA].events = ZSOCK_POLLIN;
-				} else if (i == SOCK_ID_IPV6_LISTEN &&
-					   fds[SOCK_ID_IPV6_DATA].fd < 0) {
-					fds[SOCK_ID_IPV6_DATA].fd = sock;
-					fds[SOCK_ID_IPV6_DATA].events = ZSOCK_POLLIN;
-				} else {
+				for (j = SOCK_ID_DATA; j < SOCK_ID_MAX; j++) {
+					if (fds[j].fd < 0) {
+						break;
+					}
+				}
+
+				if (j == SOCK_ID_MAX) {
 					/* Too many connections. */
 					zsock_close(sock);
-					break;
+					continue;
 				}
 
-				break;
-			}
+				fds[j].fd = sock;
+				fds[j].events = ZSOCK_POLLIN;
+				fds[j].revents = 0;
 
-			case SOCK_ID_IPV4_DATA:
-			case SOCK_ID_IPV6_DATA:
-				ret = zsock_recv(fds[i].fd, buf, sizeof(buf), 0);
-				if (ret < 0) {
-					shell_fprintf(
-						sh, SHELL_WARNING,
-						"recv failed on IPv%d socket (%d)\n",
-						(i <= SOCK_ID_IPV4_DATA) ? 4 : 6,
-						errno);
-					goto cleanup;
-				}
+				continue;
+			}
 
-				tcp_received(sh, fds[i].fd, ret);
+			ret = zsock_recv(fds[i].fd, buf, sizeof(buf), 0);
+			if (ret < 0) {
+				shell_fprintf(sh, SHELL_WARNING,
+					      "recv failed on TCP socket (%d)\n",
+					      errno);
+				tcp_abort(&fds[i]);
+				continue;
+			}
 
-				if (ret == 0) {
-					zsock_close(fds[i].fd);
-					fds[i].fd = -1;
-				}
+			tcp_received(sh, fds[i].fd, buf, ret);
 
-				break;
+			if (ret == 0) {
+				zsock_close(fds[i].fd);
+				fds[i].fd = -1;
 			}
 		}
 	}
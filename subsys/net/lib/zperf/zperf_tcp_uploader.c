@@ -18,14 +18,58 @@ LOG_MODULE_DECLARE(net_zperf, CONFIG_NET_ZPERF_LOG_LEVEL);
 
 static char sample_packet[PACKET_SIZE_MAX];
 
+#define TCP_DRAIN_BUF_SIZE 256
+
+/* Read back the data echoed by the server in bidirectional mode. The
+ * server blocks once our receive window is full, so this is done
+ * between every send.
+ */
+static int tcp_drain(int sock, struct zperf_results *results)
+{
+	uint8_t buf[TCP_DRAIN_BUF_SIZE];
+	int ret;
+
+	while (true) {
+		ret = zsock_recv(sock, buf, sizeof(buf), ZSOCK_MSG_DONTWAIT);
+		if (ret <= 0) {
+			break;
+		}
+
+		results->nb_bytes_echoed += ret;
+	}
+
+	if (ret == 0) {
+		/* Server closed the connection */
+		return -ECONNRESET;
+	}
+
+	return (errno == EAGAIN) ? 0 : -errno;
+}
+
+/* Wait until the socket can be written, or the echoed data read */
+static void tcp_wait(int sock, int64_t remaining)
+{
+	struct zsock_pollfd fds = {
+		.fd = sock,
+		.events = ZSOCK_POLLIN | ZSOCK_POLLOUT,
+	};
+
+	if (remaining <= 0) {
+		return;
+	}
+
+	(void)zsock_poll(&fds, 1, k_ticks_to_ms_ceil32(remaining));
+}
+
 void zperf_tcp_upload(const struct shell *sh,
 		      int sock,
-		      unsigned int duration_in_ms,
-		      unsigned int packet_size,
+		      const struct zperf_upload_params *param,
 		      struct zperf_results *results)
 {
-	int64_t duration = sys_clock_timeout_end_calc(K_MSEC(duration_in_ms));
+	int64_t duration = sys_clock_timeout_end_calc(K_MSEC(param->duration_ms));
 	int64_t start_time, last_print_time, end_time, remaining;
+	bool bidir = param->mode == ZPERF_MODE_BIDIR;
+	unsigned int packet_size = param->packet_size;
 	uint32_t nb_packets = 0U, nb_errors = 0U;
 	uint32_t alloc_errors = 0U;
 
@@ -34,29 +78,56 @@ void zperf_tcp_upload(const struct shell *sh,
 			      "Packet size too large! max size: %u\n",
 			      PACKET_SIZE_MAX);
 		packet_size = PACKET_SIZE_MAX;
+	} else if (packet_size < sizeof(uint32_t)) {
+		packet_size = sizeof(uint32_t);
 	}
 
 	/* Start the loop */
 	start_time = k_uptime_ticks();
 	last_print_time = start_time;
 
-	shell_fprintf(sh, SHELL_NORMAL,
-		      "New session started\n");
+	if (param->stream == 0) {
+		shell_fprintf(sh, SHELL_NORMAL,
+			      "New session started\n");
+	}
 
-	(void)memset(sample_packet, 'z', sizeof(sample_packet));
+	/* The parallel streams of an upload share the packet, the flags
+	 * are written with a single store so that another stream never
+	 * sends a partially updated one.
+	 */
+	(void)memset(sample_packet + sizeof(uint32_t), 'z',
+		     sizeof(sample_packet) - sizeof(uint32_t));
 
-	/* Set the "flags" field in start of the packet to be 0.
+	/* Set the "flags" field in start of the packet to be 0, or ask the
+	 * server to echo the data back in bidirectional mode.
 	 * As the protocol is not properly described anywhere, it is
 	 * not certain if this is a proper thing to do.
 	 */
-	(void)memset(sample_packet, 0, sizeof(uint32_t));
+	UNALIGNED_PUT(bidir ? htonl(ZPERF_FLAG_ECHO) : 0U,
+		      (uint32_t *)sample_packet);
 
 	do {
 		int ret = 0;
 
+		if (bidir) {
+			ret = tcp_drain(sock, results);
+			if (ret < 0) {
+				shell_fprintf(sh, SHELL_WARNING,
+					      "Failed to receive echoed data "
+					      "(%d)\n", ret);
+				break;
+			}
+		}
+
 		/* Send the packet */
-		ret = zsock_send(sock, sample_packet, packet_size, 0);
+		ret = zsock_send(sock, sample_packet, packet_size,
+				 bidir ? ZSOCK_MSG_DONTWAIT : 0);
 		if (ret < 0) {
+			if (bidir && errno == EAGAIN) {
+				tcp_wait(sock, duration - k_uptime_ticks());
+				goto next;
+			}
+
 			if (nb_errors == 0 && ret != -ENOMEM) {
 				shell_fprintf(sh, SHELL_WARNING,
 					      "Failed to send the packet (%d)\n",
@@ -85,11 +156,23 @@ void zperf_tcp_upload(const struct shell *sh,
 		k_yield();
 #endif
 
+next:
 		remaining = duration - k_uptime_ticks();
 	} while (remaining > 0);
 
 	end_time = k_uptime_ticks();
 
+	if (bidir) {
+		/* Collect what is still in flight from the server */
+		(void)zsock_shutdown(sock, ZSOCK_SHUT_WR);
+
+		while (tcp_drain(sock, results) == 0 &&
+		       k_uptime_ticks() - end_time <
+		       k_ms_to_ticks_ceil64(MSEC_PER_SEC)) {
+			tcp_wait(sock, k_ms_to_ticks_ceil64(10));
+		}
+	}
+
 	/* Add result coming from the client */
 	results->nb_packets_sent = nb_packets;
 	results->client_time_in_us =
@@ -93,6 +93,38 @@ static int zperf_receiver_send_stat(const struct shell *sh,
 	return ret;
 }
 
+static bool udp_echo_requested(const uint8_t *data, size_t datalen)
+{
+	struct zperf_client_hdr_v1 *hdr;
+
+	if (datalen < sizeof(struct zperf_udp_datagram) +
+		      sizeof(struct zperf_client_hdr_v1)) {
+		return false;
+	}
+
+	hdr = (struct zperf_client_hdr_v1 *)
+		(data + sizeof(struct zperf_udp_datagram));
+
+	return (ntohl(UNALIGNED_GET(&hdr->flags)) & ZPERF_FLAG_ECHO) != 0;
+}
+
+/* Return the datagram to the client in bidirectional and request/response
+ * modes.
+ */
+static void udp_echo(int sock, const struct sockaddr *addr,
+		     const uint8_t *data, size_t datalen)
+{
+	int ret;
+
+	ret = zsock_sendto(sock, data, datalen, 0, addr,
+			   addr->sa_family == AF_INET6 ?
+			   sizeof(struct sockaddr_in6) :
+			   sizeof(struct sockaddr_in));
+	if (ret < 0) {
+		NET_DBG("Cannot echo data to peer (%d)", errno);
+	}
+}
+
 static void udp_received(const struct shell *sh, int sock,
 			 const struct sockaddr *addr, uint8_t *data,
 			 size_t datalen)
@@ -141,6 +173,7 @@ static void udp_received(const struct shell *sh, int sock,
 			zperf_reset_session_stats(session);
 			session->state = STATE_ONGOING;
 			session->start_time = time;
+			session->echo = udp_echo_requested(data, datalen);
 		}
 		break;
 	case STATE_ONGOING:
@@ -250,6 +283,10 @@ static void udp_received(const struct shell *sh, int sock,
 	default:
 		break;
 	}
+
+	if (session->echo && id >= 0) {
+		udp_echo(sock, addr, data, datalen);
+	}
 }
 
 void udp_receiver_thread(void *ptr1, void *ptr2, void *ptr3)
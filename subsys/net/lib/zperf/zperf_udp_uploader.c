@@ -14,9 +14,30 @@ LOG_MODULE_DECLARE(net_zperf, CONFIG_NET_ZPERF_LOG_LEVEL);
 #include "zperf.h"
 #include "zperf_internal.h"
 
-static uint8_t sample_packet[sizeof(struct zperf_udp_datagram) +
-			     sizeof(struct zperf_client_hdr_v1) +
-			     PACKET_SIZE_MAX];
+#define UDP_PACKET_SIZE (sizeof(struct zperf_udp_datagram) +	\
+			 sizeof(struct zperf_client_hdr_v1) +	\
+			 PACKET_SIZE_MAX)
+
+/* One packet per stream, as the header changes for every datagram */
+static uint8_t sample_packets[CONFIG_NET_ZPERF_MAX_STREAMS][UDP_PACKET_SIZE];
+
+/* Count the datagrams echoed by the server in bidirectional mode */
+static void zperf_upload_drain_echo(int sock, uint8_t *buf,
+				    struct zperf_results *results)
+{
+	int ret;
+
+	while (true) {
+		ret = zsock_recv(sock, buf, UDP_PACKET_SIZE,
+				 ZSOCK_MSG_DONTWAIT);
+		if (ret < 0) {
+			break;
+		}
+
+		results->nb_packets_echoed++;
+		results->nb_bytes_echoed += ret;
+	}
+}
 
 static inline void zperf_upload_decode_stat(const struct shell *sh,
 					    const uint8_t *data,
@@ -47,6 +68,7 @@ static inline void zperf_upload_decode_stat(const struct shell *sh,
 
 static inline void zperf_upload_fin(const struct shell *sh,
 				    int sock,
+				    uint8_t *sample_packet,
 				    uint32_t nb_packets,
 				    uint64_t end_time,
 				    uint32_t packet_size,
@@ -84,7 +106,7 @@ static inline void zperf_upload_fin(const struct shell *sh,
 		hdr->flags = 0;
 		hdr->num_of_threads = htonl(1);
 		hdr->port = 0;
-		hdr->buffer_len = sizeof(sample_packet) -
+		hdr->buffer_len = UDP_PACKET_SIZE -
 			sizeof(*datagram) - sizeof(*hdr);
 		hdr->bandwidth = 0;
 		hdr->num_of_bytes = htonl(packet_size);
@@ -108,15 +130,31 @@ static inline void zperf_upload_fin(const struct shell *sh,
 			continue;
 		}
 
-		ret = zsock_recv(sock, stats, sizeof(stats), 0);
-		if (ret == -EAGAIN) {
-			shell_fprintf(sh, SHELL_WARNING,
-					"Stats receive timeout\n");
-		} else if (ret < 0) {
-			shell_fprintf(sh, SHELL_WARNING,
-					"Failed to receive packet (%d)\n",
-					errno);
-		}
+		do {
+			ret = zsock_recv(sock, stats, sizeof(stats), 0);
+			if (ret == -EAGAIN) {
+				shell_fprintf(sh, SHELL_WARNING,
+						"Stats receive timeout\n");
+			} else if (ret < 0) {
+				shell_fprintf(sh, SHELL_WARNING,
+						"Failed to receive packet (%d)\n",
+						errno);
+			}
+
+			datagram = (struct zperf_udp_datagram *)stats;
+
+			/* Skip the datagrams still echoed by the server,
+			 * the statistics are sent with a negative id.
+			 */
+			if (ret >= (int)sizeof(*datagram) &&
+			    (int32_t)ntohl(UNALIGNED_GET(&datagram->id)) >= 0) {
+				results->nb_packets_echoed++;
+				results->nb_bytes_echoed += packet_size;
+				continue;
+			}
+
+			break;
+		} while (true);
 	}
 
 	/* Decode statistics */
@@ -138,12 +176,15 @@ static inline void zperf_upload_fin(const struct shell *sh,
 
 void zperf_udp_upload(const struct shell *sh,
 		      int sock,
-		      int port,
-		      unsigned int duration_in_ms,
-		      unsigned int packet_size,
-		      unsigned int rate_in_kbps,
+		      const struct zperf_upload_params *param,
 		      struct zperf_results *results)
 {
+	uint8_t *sample_packet = sample_packets[param->stream];
+	unsigned int duration_in_ms = param->duration_ms;
+	unsigned int packet_size = param->packet_size;
+	unsigned int rate_in_kbps = param->rate_kbps;
+	bool bidir = param->mode == ZPERF_MODE_BIDIR;
+	int port = param->port;
 	uint32_t packet_duration = ((uint64_t)packet_size * 8U * USEC_PER_SEC) /
 				   (rate_in_kbps * 1024U);
 	uint64_t duration = sys_clock_timeout_end_calc(K_MSEC(duration_in_ms));
@@ -166,7 +207,16 @@ void zperf_udp_upload(const struct shell *sh,
 		packet_size = sizeof(struct zperf_udp_datagram);
 	}
 
-	if (packet_duration > 1000U) {
+	if (bidir && packet_size < sizeof(struct zperf_udp_datagram) +
+				   sizeof(struct zperf_client_hdr_v1)) {
+		/* The server needs the flags of the client header */
+		packet_size = sizeof(struct zperf_udp_datagram) +
+			      sizeof(struct zperf_client_hdr_v1);
+	}
+
+	if (param->stream != 0) {
+		/* Same as the first stream, no need to repeat it */
+	} else if (packet_duration > 1000U) {
 		shell_fprintf(sh, SHELL_NORMAL,
 			      "Packet duration %u ms\n",
 			      (unsigned int)(packet_duration / 1000U));
@@ -181,7 +231,7 @@ void zperf_udp_upload(const struct shell *sh,
 	last_print_time = start_time;
 	last_loop_time = start_time;
 
-	(void)memset(sample_packet, 'z', sizeof(sample_packet));
+	(void)memset(sample_packet, 'z', UDP_PACKET_SIZE);
 
 	do {
 		struct zperf_udp_datagram *datagram;
@@ -227,10 +277,10 @@ void zperf_udp_upload(const struct shell *sh,
 
 		hdr = (struct zperf_client_hdr_v1 *)(sample_packet +
 						     sizeof(*datagram));
-		hdr->flags = 0;
-		hdr->num_of_threads = htonl(1);
+		hdr->flags = bidir ? htonl(ZPERF_FLAG_ECHO) : 0;
+		hdr->num_of_threads = htonl(param->num_streams);
 		hdr->port = htonl(port);
-		hdr->buffer_len = sizeof(sample_packet) -
+		hdr->buffer_len = UDP_PACKET_SIZE -
 			sizeof(*datagram) - sizeof(*hdr);
 		hdr->bandwidth = htonl(rate_in_kbps);
 		hdr->num_of_bytes = htonl(packet_size);
@@ -246,9 +296,13 @@ void zperf_udp_upload(const struct shell *sh,
 			nb_packets++;
 		}
 
+		if (bidir) {
+			zperf_upload_drain_echo(sock, sample_packet, results);
+		}
+
 		/* Print log every seconds */
 		print_info = print_interval - k_uptime_ticks();
-		if (print_info <= 0) {
+		if (print_info <= 0 && param->stream == 0) {
 			shell_fprintf(sh, SHELL_WARNING,
 				    "nb_packets=%u\tdelay=%u\tadjust=%d\n",
 				      nb_packets, (unsigned int)delay,
@@ -274,8 +328,8 @@ void zperf_udp_upload(const struct shell *sh,
 
 	end_time = k_uptime_ticks();
 
-	zperf_upload_fin(sh, sock, nb_packets, end_time, packet_size,
-			 results);
+	zperf_upload_fin(sh, sock, sample_packet, nb_packets, end_time,
+			 packet_size, results);
 
 	/* Add result coming from the client */
 	results->nb_packets_sent = nb_packets;
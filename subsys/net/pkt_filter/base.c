@@ -10,6 +10,78 @@ LOG_MODULE_REGISTER(npf_base, CONFIG_NET_PKT_FILTER_LOG_LEVEL);
 #include <zephyr/net/net_core.h>
 #include <zephyr/net/net_pkt_filter.h>
 #include <zephyr/spinlock.h>
+#include <zephyr/sys/math_extras.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+
+#define NPF_PROG_MAX_RULES CONFIG_NET_PKT_FILTER_COMPILED_MAX_RULES
+#define NPF_PROG_MAX_KEYS CONFIG_NET_PKT_FILTER_COMPILED_MAX_KEYS
+#define NPF_PROG_MAX_OPS (2 * NPF_PROG_MAX_RULES)
+#define NPF_PROG_WORDS DIV_ROUND_UP(NPF_PROG_MAX_RULES, 32)
+#define NPF_PROG_HASH_SIZE (2 * NPF_PROG_MAX_KEYS)
+
+/*
+ * Tests that are not resolved by the indexes. The well known tests are
+ * done inline, anything else calls the test function.
+ */
+enum npf_op_code {
+	NPF_OP_CALL,
+	NPF_OP_IFACE_NE,
+	NPF_OP_ORIG_IFACE_EQ,
+	NPF_OP_ORIG_IFACE_NE,
+	NPF_OP_SIZE,
+	NPF_OP_ETH_TYPE_NE,
+};
+
+struct npf_op {
+	struct npf_test *test;
+	uint8_t code;
+};
+
+struct npf_prog_rule {
+	struct npf_rule *rule;
+	uint16_t first_op;
+	uint16_t nb_ops;
+};
+
+/*
+ * Exact match index of a packet field. Every distinct value required by a
+ * rule has a bitmap of the rules that can match a packet with that value.
+ * The rules that do not test the field are set in all the bitmaps, bitmap
+ * 0 is used for the values that no rule asks for.
+ */
+struct npf_prog_index {
+	uintptr_t values[NPF_PROG_HASH_SIZE];
+	uint8_t slots[NPF_PROG_HASH_SIZE];
+	uint32_t rules[NPF_PROG_MAX_KEYS + 1][NPF_PROG_WORDS];
+	uint8_t nb_keys;
+};
+
+/*
+ * Rule list compiled for the packet path. The rules keep their order, the
+ * first candidate whose remaining tests pass gives the verdict, exactly as
+ * when walking the list.
+ */
+struct npf_prog {
+	atomic_t readers;
+	struct npf_prog_index iface;
+	struct npf_prog_index eth_type;
+	struct npf_prog_rule rules[NPF_PROG_MAX_RULES];
+	struct npf_op ops[NPF_PROG_MAX_OPS];
+	uint16_t nb_rules;
+	uint16_t nb_ops;
+	bool empty;
+};
+
+static struct npf_prog npf_send_progs[2];
+static struct npf_prog npf_recv_progs[2];
+
+/* Serializes the rule list updates and the compilation */
+static K_MUTEX_DEFINE(npf_prog_lock);
+
+#endif /* CONFIG_NET_PKT_FILTER_COMPILED */
 
 /*
  * Our actual rule lists for supported test points
@@ -18,11 +90,17 @@ LOG_MODULE_REGISTER(npf_base, CONFIG_NET_PKT_FILTER_LOG_LEVEL);
 struct npf_rule_list npf_send_rules = {
 	.rule_head = SYS_SLIST_STATIC_INIT(&send_rules.rule_head),
 	.lock = { },
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+	.progs = npf_send_progs,
+#endif
 };
 
 struct npf_rule_list npf_recv_rules = {
 	.rule_head = SYS_SLIST_STATIC_INIT(&recv_rules.rule_head),
 	.lock = { },
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+	.progs = npf_recv_progs,
+#endif
 };
 
 /*
@@ -67,6 +145,7 @@ static enum net_verdict evaluate(sys_slist_t *rule_head, struct net_pkt *pkt)
 
 	SYS_SLIST_FOR_EACH_CONTAINER(rule_head, rule, node) {
 		if (apply_tests(rule, pkt) == true) {
+			atomic_inc(&rule->hits);
 			return rule->result;
 		}
 	}
@@ -75,8 +154,419 @@ static enum net_verdict evaluate(sys_slist_t *rule_head, struct net_pkt *pkt)
 	return NET_DROP;
 }
 
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+
+/*
+ * Rule compilation
+ */
+
+static inline uint32_t prog_hash(uintptr_t value)
+{
+	uint32_t hash = (uint32_t)value;
+
+	/* Interface pointers are aligned and Ethernet types are small, mix
+	 * the bits so that both spread over the table.
+	 */
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3bU;
+	hash ^= hash >> 16;
+
+	return hash % NPF_PROG_HASH_SIZE;
+}
+
+static int prog_index_find(const struct npf_prog_index *idx, uintptr_t value)
+{
+	uint32_t slot = prog_hash(value);
+	int i;
+
+	for (i = 0; i < NPF_PROG_HASH_SIZE && idx->slots[slot]; i++) {
+		if (idx->values[slot] == value) {
+			return idx->slots[slot];
+		}
+
+		slot = (slot + 1) % NPF_PROG_HASH_SIZE;
+	}
+
+	return 0;
+}
+
+static int prog_index_add(struct npf_prog_index *idx, uintptr_t value)
+{
+	uint32_t slot = prog_hash(value);
+
+	while (idx->slots[slot]) {
+		if (idx->values[slot] == value) {
+			return idx->slots[slot];
+		}
+
+		slot = (slot + 1) % NPF_PROG_HASH_SIZE;
+	}
+
+	if (idx->nb_keys >= NPF_PROG_MAX_KEYS) {
+		return -ENOMEM;
+	}
+
+	/* The rules seen so far that do not test this field match the new
+	 * value too.
+	 */
+	idx->nb_keys++;
+	idx->values[slot] = value;
+	idx->slots[slot] = idx->nb_keys;
+	memcpy(idx->rules[idx->nb_keys], idx->rules[0], sizeof(idx->rules[0]));
+
+	return idx->nb_keys;
+}
+
+static int prog_index_set(struct npf_prog_index *idx, bool has_value,
+			  uintptr_t value, int bit)
+{
+	int key;
+
+	if (has_value) {
+		key = prog_index_add(idx, value);
+		if (key < 0) {
+			return key;
+		}
+
+		idx->rules[key][bit / 32] |= BIT(bit % 32);
+
+		return 0;
+	}
+
+	for (key = 0; key <= idx->nb_keys; key++) {
+		idx->rules[key][bit / 32] |= BIT(bit % 32);
+	}
+
+	return 0;
+}
+
+static uint8_t prog_op_code(npf_test_fn_t *fn)
+{
+	if (fn == npf_iface_unmatch) {
+		return NPF_OP_IFACE_NE;
+	} else if (fn == npf_orig_iface_match) {
+		return NPF_OP_ORIG_IFACE_EQ;
+	} else if (fn == npf_orig_iface_unmatch) {
+		return NPF_OP_ORIG_IFACE_NE;
+	} else if (fn == npf_size_inbounds) {
+		return NPF_OP_SIZE;
+	}
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (fn == npf_eth_type_unmatch) {
+		return NPF_OP_ETH_TYPE_NE;
+	}
+#endif
+
+	return NPF_OP_CALL;
+}
+
+static int prog_add_op(struct npf_prog *prog, uint8_t code,
+		       struct npf_test *test)
+{
+	if (prog->nb_ops >= NPF_PROG_MAX_OPS) {
+		return -ENOMEM;
+	}
+
+	prog->ops[prog->nb_ops].code = code;
+	prog->ops[prog->nb_ops].test = test;
+	prog->nb_ops++;
+
+	return 0;
+}
+
+/* Value of an index test, false if the rule can never match */
+static bool prog_key_set(bool *has_value, uintptr_t *value, uintptr_t new)
+{
+	if (*has_value && *value != new) {
+		return false;
+	}
+
+	*has_value = true;
+	*value = new;
+
+	return true;
+}
+
+static int prog_compile_rule(struct npf_prog *prog, struct npf_rule *rule)
+{
+	bool has_iface = false, has_type = false;
+	struct npf_prog_rule *prule;
+	uintptr_t iface = 0, type = 0;
+	struct npf_test *test;
+	bool possible = true;
+	unsigned int i;
+	int ret;
+
+	if (prog->nb_rules >= NPF_PROG_MAX_RULES) {
+		return -ENOMEM;
+	}
+
+	prule = &prog->rules[prog->nb_rules];
+	prule->rule = rule;
+	prule->first_op = prog->nb_ops;
+
+	for (i = 0; i < rule->nb_tests; i++) {
+		test = rule->tests[i];
+
+		if (test->fn == npf_iface_match) {
+			possible &= prog_key_set(&has_iface, &iface,
+				(uintptr_t)CONTAINER_OF(test, struct npf_test_iface,
+							test)->iface);
+			continue;
+		}
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+		if (test->fn == npf_eth_type_match) {
+			possible &= prog_key_set(&has_type, &type,
+				CONTAINER_OF(test, struct npf_test_eth_type,
+					     test)->type);
+			continue;
+		}
+#endif
+
+		ret = prog_add_op(prog, prog_op_code(test->fn), test);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	if (!possible) {
+		/* Conflicting exact matches, the rule is left out */
+		prog->nb_ops = prule->first_op;
+		return 0;
+	}
+
+	prule->nb_ops = prog->nb_ops - prule->first_op;
+
+	ret = prog_index_set(&prog->iface, has_iface, iface, prog->nb_rules);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = prog_index_set(&prog->eth_type, has_type, type, prog->nb_rules);
+	if (ret < 0) {
+		return ret;
+	}
+
+	prog->nb_rules++;
+
+	return 0;
+}
+
+static int prog_compile(struct npf_prog *prog, struct npf_rule_list *rules)
+{
+	struct npf_rule *rule;
+	int ret;
+
+	memset(&prog->iface, 0, sizeof(prog->iface));
+	memset(&prog->eth_type, 0, sizeof(prog->eth_type));
+	prog->nb_rules = 0U;
+	prog->nb_ops = 0U;
+	prog->empty = sys_slist_is_empty(&rules->rule_head);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&rules->rule_head, rule, node) {
+		ret = prog_compile_rule(prog, rule);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void prog_wait_readers(struct npf_prog *prog)
+{
+	/* Sleep rather than yield, the reader might have a lower priority */
+	while (atomic_get(&prog->readers) != 0) {
+		k_msleep(1);
+	}
+}
+
+/*
+ * Called with npf_prog_lock held after each change of the rule list. The
+ * new program is built in the spare storage and then swapped in, the
+ * packets being filtered keep using the old one until they are done.
+ */
+static void prog_update(struct npf_rule_list *rules)
+{
+	struct npf_prog *cur = atomic_ptr_get(&rules->prog);
+	struct npf_prog *next;
+	int ret;
+
+	next = (cur == &rules->progs[0]) ? &rules->progs[1] : &rules->progs[0];
+
+	prog_wait_readers(next);
+
+	ret = prog_compile(next, rules);
+	if (ret < 0) {
+		NET_DBG("cannot compile rules of %p (%d), using the list",
+			rules, ret);
+		next = NULL;
+	}
+
+	atomic_ptr_set(&rules->prog, next);
+
+	/* The caller may reuse a removed rule once we return */
+	if (cur) {
+		prog_wait_readers(cur);
+	}
+}
+
+/*
+ * Compiled rule application
+ */
+
+static bool prog_apply_ops(struct npf_prog *prog, struct npf_prog_rule *prule,
+			   struct net_pkt *pkt)
+{
+	struct npf_op *op = &prog->ops[prule->first_op];
+	struct npf_test_size_bounds *bounds;
+	struct npf_test_iface *test_iface;
+	size_t pkt_size;
+	bool result;
+	int i;
+
+	for (i = 0; i < prule->nb_ops; i++, op++) {
+		switch (op->code) {
+		case NPF_OP_IFACE_NE:
+			test_iface = CONTAINER_OF(op->test, struct npf_test_iface,
+						  test);
+			result = test_iface->iface != net_pkt_iface(pkt);
+			break;
+		case NPF_OP_ORIG_IFACE_EQ:
+			test_iface = CONTAINER_OF(op->test, struct npf_test_iface,
+						  test);
+			result = test_iface->iface == net_pkt_orig_iface(pkt);
+			break;
+		case NPF_OP_ORIG_IFACE_NE:
+			test_iface = CONTAINER_OF(op->test, struct npf_test_iface,
+						  test);
+			result = test_iface->iface != net_pkt_orig_iface(pkt);
+			break;
+		case NPF_OP_SIZE:
+			bounds = CONTAINER_OF(op->test,
+					      struct npf_test_size_bounds, test);
+			pkt_size = net_pkt_get_len(pkt);
+			result = pkt_size >= bounds->min &&
+				 pkt_size <= bounds->max;
+			break;
+#if defined(CONFIG_NET_L2_ETHERNET)
+		case NPF_OP_ETH_TYPE_NE:
+			result = NET_ETH_HDR(pkt)->type !=
+				CONTAINER_OF(op->test, struct npf_test_eth_type,
+					     test)->type;
+			break;
+#endif
+		default:
+			result = op->test->fn(op->test, pkt);
+			break;
+		}
+
+		if (!result) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static enum net_verdict prog_evaluate(struct npf_prog *prog,
+				      struct net_pkt *pkt)
+{
+	const uint32_t *iface_rules, *type_rules;
+	struct npf_prog_rule *prule;
+	uint32_t candidates;
+	int word, bit;
+
+	if (prog->empty) {
+		return NET_OK;
+	}
+
+	iface_rules = prog->iface.rules[prog_index_find(&prog->iface,
+					(uintptr_t)net_pkt_iface(pkt))];
+	type_rules = prog->eth_type.rules[0];
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+	/* Only look at the header if some rule needs it */
+	if (prog->eth_type.nb_keys && pkt->frags) {
+		type_rules = prog->eth_type.rules[prog_index_find(
+				&prog->eth_type, NET_ETH_HDR(pkt)->type)];
+	}
+#endif
+
+	for (word = 0; word < DIV_ROUND_UP(prog->nb_rules, 32); word++) {
+		candidates = iface_rules[word] & type_rules[word];
+
+		while (candidates) {
+			bit = u32_count_trailing_zeros(candidates);
+			candidates &= candidates - 1;
+
+			prule = &prog->rules[word * 32 + bit];
+			if (prog_apply_ops(prog, prule, pkt)) {
+				atomic_inc(&prule->rule->hits);
+				return prule->rule->result;
+			}
+		}
+	}
+
+	return NET_DROP;
+}
+
+/* Returns the current program with a reader reference, or NULL */
+static struct npf_prog *prog_get(struct npf_rule_list *rules)
+{
+	struct npf_prog *prog;
+
+	while (true) {
+		prog = atomic_ptr_get(&rules->prog);
+		if (!prog) {
+			return NULL;
+		}
+
+		atomic_inc(&prog->readers);
+
+		/* The writer waits for the readers only after the swap */
+		if (atomic_ptr_get(&rules->prog) == prog) {
+			return prog;
+		}
+
+		atomic_dec(&prog->readers);
+	}
+}
+
+#endif /* CONFIG_NET_PKT_FILTER_COMPILED */
+
+static inline void update_begin(void)
+{
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+	k_mutex_lock(&npf_prog_lock, K_FOREVER);
+#endif
+}
+
+static inline void update_end(struct npf_rule_list *rules)
+{
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+	prog_update(rules);
+	k_mutex_unlock(&npf_prog_lock);
+#else
+	ARG_UNUSED(rules);
+#endif
+}
+
 static enum net_verdict lock_evaluate(struct npf_rule_list *rules, struct net_pkt *pkt)
 {
+#if defined(CONFIG_NET_PKT_FILTER_COMPILED)
+	struct npf_prog *prog = prog_get(rules);
+
+	if (prog) {
+		enum net_verdict result = prog_evaluate(prog, pkt);
+
+		atomic_dec(&prog->readers);
+		return result;
+	}
+#endif
+
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
 	enum net_verdict result = evaluate(&rules->rule_head, pkt);
 
@@ -104,12 +594,16 @@ bool net_pkt_filter_recv_ok(struct net_pkt *pkt)
 
 void npf_insert_rule(struct npf_rule_list *rules, struct npf_rule *rule)
 {
+	update_begin();
+
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
 
 	NET_DBG("inserting rule %p into %p", rule, rules);
 	sys_slist_prepend(&rules->rule_head, &rule->node);
 
 	k_spin_unlock(&rules->lock, key);
+
+	update_end(rules);
 }
 
 void npf_append_rule(struct npf_rule_list *rules, struct npf_rule *rule)
@@ -117,26 +611,36 @@ void npf_append_rule(struct npf_rule_list *rules, struct npf_rule *rule)
 	__ASSERT(sys_slist_peek_tail(&rules->rule_head) != &npf_default_ok.node, "");
 	__ASSERT(sys_slist_peek_tail(&rules->rule_head) != &npf_default_drop.node, "");
 
+	update_begin();
+
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
 
 	NET_DBG("appending rule %p into %p", rule, rules);
 	sys_slist_append(&rules->rule_head, &rule->node);
 
 	k_spin_unlock(&rules->lock, key);
+
+	update_end(rules);
 }
 
 bool npf_remove_rule(struct npf_rule_list *rules, struct npf_rule *rule)
 {
+	update_begin();
+
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
 	bool result = sys_slist_find_and_remove(&rules->rule_head, &rule->node);
 
 	k_spin_unlock(&rules->lock, key);
 	NET_DBG("removing rule %p from %p: %d", rule, rules, result);
+
+	update_end(rules);
 	return result;
 }
 
 bool npf_remove_all_rules(struct npf_rule_list *rules)
 {
+	update_begin();
+
 	k_spinlock_key_t key = k_spin_lock(&rules->lock);
 	bool result = !sys_slist_is_empty(&rules->rule_head);
 
@@ -146,6 +650,8 @@ bool npf_remove_all_rules(struct npf_rule_list *rules)
 	}
 
 	k_spin_unlock(&rules->lock, key);
+
+	update_end(rules);
 	return result;
 }
 
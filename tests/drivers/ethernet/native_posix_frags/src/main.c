@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <zephyr/net/net_pkt.h>
+
+#include "eth_native_posix_frags.h"
+
+#define FRAG_LEN 50
+
+static uint8_t copy_buf[(ETH_MAX_TX_FRAGS + 2) * FRAG_LEN];
+static uint8_t expected[(ETH_MAX_TX_FRAGS + 2) * FRAG_LEN];
+
+/* Build a packet of count net_bufs of FRAG_LEN bytes. If empty is set,
+ * an empty net_buf is added after each of them.
+ */
+static struct net_pkt *build_pkt(int count, bool empty)
+{
+	struct net_pkt *pkt;
+	struct net_buf *buf;
+	int i;
+
+	pkt = net_pkt_alloc(K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	for (i = 0; i < count; i++) {
+		buf = net_pkt_get_reserve_tx_data(K_NO_WAIT);
+		zassert_not_null(buf, "Cannot allocate buf %d", i);
+
+		memset(&expected[i * FRAG_LEN], i + 1, FRAG_LEN);
+		net_buf_add_mem(buf, &expected[i * FRAG_LEN], FRAG_LEN);
+		net_pkt_frag_add(pkt, buf);
+
+		if (empty) {
+			buf = net_pkt_get_reserve_tx_data(K_NO_WAIT);
+			zassert_not_null(buf, "Cannot allocate empty buf");
+			net_pkt_frag_add(pkt, buf);
+		}
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static void check_frags(struct net_pkt *pkt, int count)
+{
+	struct eth_frag frags[ETH_MAX_TX_FRAGS];
+	struct net_buf *buf = pkt->buffer;
+	int nfrags;
+	int i;
+
+	nfrags = eth_native_posix_pkt_frags(pkt, frags, copy_buf,
+					    sizeof(copy_buf));
+	zassert_equal(nfrags, count, "Wrong number of fragments");
+
+	for (i = 0; i < nfrags; i++) {
+		while (buf->len == 0U) {
+			buf = buf->frags;
+		}
+
+		/* No copy, the fragments point to the packet data */
+		zassert_equal_ptr(frags[i].data, buf->data,
+				  "Fragment %d copied", i);
+		zassert_equal(frags[i].len, FRAG_LEN, "Wrong length");
+		zassert_mem_equal(frags[i].data, &expected[i * FRAG_LEN],
+				  FRAG_LEN, "Wrong data in fragment %d", i);
+
+		buf = buf->frags;
+	}
+}
+
+ZTEST(eth_native_posix_frags, test_single_frag)
+{
+	struct net_pkt *pkt = build_pkt(1, false);
+
+	check_frags(pkt, 1);
+	net_pkt_unref(pkt);
+}
+
+ZTEST(eth_native_posix_frags, test_max_frags)
+{
+	struct net_pkt *pkt = build_pkt(ETH_MAX_TX_FRAGS, false);
+
+	check_frags(pkt, ETH_MAX_TX_FRAGS);
+	net_pkt_unref(pkt);
+}
+
+ZTEST(eth_native_posix_frags, test_empty_frags_skipped)
+{
+	struct net_pkt *pkt = build_pkt(ETH_MAX_TX_FRAGS / 2, true);
+
+	check_frags(pkt, ETH_MAX_TX_FRAGS / 2);
+	net_pkt_unref(pkt);
+}
+
+ZTEST(eth_native_posix_frags, test_copy_fallback)
+{
+	struct eth_frag frags[ETH_MAX_TX_FRAGS];
+	struct net_pkt *pkt;
+	int len = (ETH_MAX_TX_FRAGS + 2) * FRAG_LEN;
+	int nfrags;
+
+	pkt = build_pkt(ETH_MAX_TX_FRAGS + 2, false);
+
+	memset(copy_buf, 0, sizeof(copy_buf));
+
+	nfrags = eth_native_posix_pkt_frags(pkt, frags, copy_buf,
+					    sizeof(copy_buf));
+	zassert_equal(nfrags, 1, "Packet not copied");
+	zassert_equal_ptr(frags[0].data, copy_buf, "Copy buffer not used");
+	zassert_equal(frags[0].len, len, "Wrong copied length");
+	zassert_mem_equal(copy_buf, expected, len, "Wrong copied data");
+
+	/* A copy buffer that is too small is an error, not a truncation */
+	nfrags = eth_native_posix_pkt_frags(pkt, frags, copy_buf, len - 1);
+	zassert_equal(nfrags, -EMSGSIZE, "Short copy buffer accepted");
+
+	net_pkt_unref(pkt);
+}
+
+ZTEST_SUITE(eth_native_posix_frags, NULL, NULL, NULL, NULL, NULL);
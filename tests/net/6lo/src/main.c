@@ -1142,6 +1142,87 @@ static const struct {
 #endif
 };
 
+/* The same flows again, compressed from the flow cache when enabled */
+static void test_6lo_repeat(void)
+{
+	int round, count;
+
+	for (round = 0; round < 2; round++) {
+		for (count = 0; count < ARRAY_SIZE(tests); count++) {
+			test_6lo(tests[count].data);
+		}
+	}
+}
+
+/* Typical traffic: mostly UDP between a few nodes, some multicast */
+static struct net_6lo_data *traffic_mix[] = {
+	&test_data_1, &test_data_2, &test_data_3, &test_data_3,
+	&test_data_6, &test_data_13, &test_data_13, &test_data_14,
+#if defined(CONFIG_NET_6LO_CONTEXT)
+	&test_data_15, &test_data_16, &test_data_16, &test_data_24,
+#endif
+};
+
+#define TRAFFIC_MIX_ROUNDS 64
+
+static void test_6lo_traffic_mix(void)
+{
+	uint64_t cycles = 0U;
+	uint32_t start;
+	int round, count;
+
+	for (round = 0; round < TRAFFIC_MIX_ROUNDS; round++) {
+		for (count = 0; count < ARRAY_SIZE(traffic_mix); count++) {
+			struct net_pkt *pkt;
+			int ret;
+
+			pkt = create_pkt(traffic_mix[count]);
+			zassert_not_null(pkt, "failed to create buffer");
+
+			net_pkt_cursor_init(pkt);
+
+			start = k_cycle_get_32();
+			ret = net_6lo_compress(pkt, true);
+			cycles += k_cycle_get_32() - start;
+
+			zassert_true(ret >= 0, "compression failed");
+			zassert_true(net_6lo_uncompress(pkt),
+				     "uncompression failed");
+			zassert_true(compare_pkt(pkt, traffic_mix[count]),
+				     NULL);
+
+			net_pkt_unref(pkt);
+		}
+	}
+
+	TC_PRINT("IPHC compression: %u cycles per packet (flow cache %s)\n",
+		 (uint32_t)(cycles / (TRAFFIC_MIX_ROUNDS *
+				      ARRAY_SIZE(traffic_mix))),
+		 IS_ENABLED(CONFIG_NET_6LO_COMPRESS_CACHE) ? "on" : "off");
+}
+
+#if defined(CONFIG_NET_6LO_CONTEXT)
+/* Changing a context must not leave stale compressed addresses behind */
+static void test_6lo_context_update(void)
+{
+	struct net_if *iface = net_if_get_first_by_type(&NET_L2_GET_NAME(DUMMY));
+	struct net_icmpv6_nd_opt_6co removed = ctx1;
+	struct net_6lo_data data = test_data_15;
+
+	test_6lo(&data);
+
+	removed.lifetime = 0U;
+	net_6lo_set_context(iface, &removed);
+
+	/* Both addresses are now inlined, without the CID extension */
+	data.hdr_diff = NET_IPV6UDPH_LEN - IPHC_SIZE - NHC_SIZE -
+			(TF_01 + NHC_1 + CID_0 + SAC0_SAM00 + M0_DAC0_DAM00) -
+			UDP_CHKSUM_0 - UDP_P10;
+
+	test_6lo(&data);
+}
+#endif
+
 ZTEST(t_6lo, test_loop)
 {
 	int count;
@@ -1165,6 +1246,15 @@ ZTEST(t_6lo, test_loop)
 
 		test_6lo(tests[count].data);
 	}
+
+	test_6lo_repeat();
+	test_6lo_traffic_mix();
+
+#if defined(CONFIG_NET_6LO_CONTEXT)
+	/* Last, as it removes a context */
+	test_6lo_context_update();
+#endif
+
 	net_pkt_print();
 }
 
@@ -647,4 +647,145 @@ ZTEST(arp_fn_tests, test_arp)
 	}
 }
 
+static void scaling_host(int i, struct in_addr *addr,
+			 struct net_eth_addr *lladdr)
+{
+	addr->s4_addr[0] = 192;
+	addr->s4_addr[1] = 168;
+	addr->s4_addr[2] = 1 + i / 250;
+	addr->s4_addr[3] = 1 + i % 250;
+
+	lladdr->addr[0] = 0x02;
+	lladdr->addr[1] = 0x00;
+	lladdr->addr[2] = 0x5e;
+	lladdr->addr[3] = 0x10;
+	lladdr->addr[4] = i >> 8;
+	lladdr->addr[5] = i & 0xff;
+}
+
+/* Let the host know about us, this creates an ARP cache entry for it */
+static void scaling_add_host(struct net_if *iface, struct in_addr *src, int i)
+{
+	struct net_eth_addr lladdr;
+	struct net_arp_hdr *arp_hdr;
+	struct net_eth_hdr *eth_hdr;
+	struct in_addr addr;
+	struct net_pkt *pkt;
+	enum net_verdict verdict;
+
+	scaling_host(i, &addr, &lladdr);
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(struct net_eth_hdr) +
+					sizeof(struct net_arp_hdr),
+					AF_UNSPEC, 0, K_SECONDS(1));
+	zassert_not_null(pkt, "out of mem request");
+
+	setup_eth_header(iface, pkt, net_eth_broadcast_addr(),
+			 NET_ETH_PTYPE_ARP);
+	eth_hdr = (struct net_eth_hdr *)net_pkt_data(pkt);
+	memcpy(&eth_hdr->src, &lladdr, sizeof(lladdr));
+
+	net_buf_add(pkt->buffer, sizeof(struct net_eth_hdr));
+	net_buf_pull(pkt->buffer, sizeof(struct net_eth_hdr));
+	arp_hdr = NET_ARP_HDR(pkt);
+
+	arp_hdr->hwtype = htons(NET_ARP_HTYPE_ETH);
+	arp_hdr->protocol = htons(NET_ETH_PTYPE_IP);
+	arp_hdr->hwlen = sizeof(struct net_eth_addr);
+	arp_hdr->protolen = sizeof(struct in_addr);
+	arp_hdr->opcode = htons(NET_ARP_REQUEST);
+	memcpy(&arp_hdr->src_hwaddr, &lladdr, sizeof(lladdr));
+	(void)memset(&arp_hdr->dst_hwaddr, 0, sizeof(struct net_eth_addr));
+	net_ipv4_addr_copy_raw(arp_hdr->src_ipaddr, (uint8_t *)&addr);
+	net_ipv4_addr_copy_raw(arp_hdr->dst_ipaddr, (uint8_t *)src);
+
+	net_buf_add(pkt->buffer, sizeof(struct net_arp_hdr));
+
+	verdict = net_arp_input(pkt, eth_hdr);
+	zassert_equal(verdict, NET_OK, "ARP request %d failed", i);
+
+	/* Let the reply go out so that we do not run out of packets */
+	k_msleep(1);
+}
+
+static void scaling_check_host(struct net_pkt *pkt, int i)
+{
+	struct net_eth_addr lladdr;
+	struct in_addr addr;
+	struct net_pkt *pkt2;
+
+	scaling_host(i, &addr, &lladdr);
+
+	pkt2 = net_arp_prepare(pkt, &addr, NULL);
+	zassert_equal_ptr(pkt2, pkt, "Host %d not found in ARP cache", i);
+	zassert_mem_equal(net_pkt_lladdr_dst(pkt)->addr, &lladdr,
+			  sizeof(lladdr), "Wrong hwaddr for host %d", i);
+}
+
+ZTEST(arp_fn_tests, test_arp_scaling)
+{
+	struct in_addr src = { { { 192, 168, 0, 1 } } };
+	struct in_addr netmask = { { { 255, 255, 0, 0 } } };
+	struct net_eth_addr lladdr;
+	struct net_if_addr *ifaddr;
+	struct in_addr addr;
+	struct net_if *iface;
+	struct net_pkt *pkt;
+	int i;
+
+	if (CONFIG_NET_ARP_TABLE_SIZE < 16) {
+		ztest_test_skip();
+	}
+
+	iface = net_if_lookup_by_dev(DEVICE_GET(net_arp_test));
+
+	net_arp_clear_cache(NULL);
+	net_if_ipv4_set_netmask(iface, &netmask);
+
+	ifaddr = net_if_ipv4_addr_add(iface, &src, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add address");
+	ifaddr->addr_state = NET_ADDR_PREFERRED;
+
+	req_test = true;
+
+	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		scaling_add_host(iface, &src, i);
+	}
+
+	zassert_equal(net_arp_foreach(arp_cb, &src),
+		      CONFIG_NET_ARP_TABLE_SIZE, "ARP cache not full");
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(struct net_ipv4_hdr),
+					AF_INET, 0, K_SECONDS(1));
+	zassert_not_null(pkt, "out of mem");
+
+	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		scaling_check_host(pkt, i);
+	}
+
+	/* Use every host except the first one, so it becomes the least
+	 * recently used entry that is replaced by a new host.
+	 */
+	k_msleep(2);
+
+	for (i = 1; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
+		scaling_check_host(pkt, i);
+	}
+
+	scaling_add_host(iface, &src, CONFIG_NET_ARP_TABLE_SIZE);
+	scaling_check_host(pkt, CONFIG_NET_ARP_TABLE_SIZE);
+	scaling_check_host(pkt, 1);
+
+	scaling_host(0, &addr, &lladdr);
+	entry_found = false;
+	expected_hwaddr = &lladdr;
+	net_arp_foreach(arp_cb, &addr);
+	zassert_false(entry_found, "Least recently used entry not evicted");
+
+	net_pkt_unref(pkt);
+	net_arp_clear_cache(NULL);
+
+	req_test = false;
+}
+
 ZTEST_SUITE(arp_fn_tests, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,323 @@
+/* main.c - Local packet capture ring tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_CAPTURE_RING_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <zephyr/ztest.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/net_pkt.h>
+#include <zephyr/net/capture.h>
+
+#define PKT_LEN 100
+#define SNAPLEN 32
+
+#define SHB_TYPE 0x0A0D0D0AU
+#define IDB_TYPE 0x00000001U
+#define EPB_TYPE 0x00000006U
+
+static uint8_t export_buf[8192];
+static size_t export_len;
+
+struct pcapng_result {
+	int idb_count;
+	int epb_count;
+	uint32_t cap_len;
+	uint32_t orig_len;
+	uint8_t first_byte;
+};
+
+static int export_cb(const void *data, size_t len, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	if (export_len + len > sizeof(export_buf)) {
+		return -ENOMEM;
+	}
+
+	memcpy(export_buf + export_len, data, len);
+	export_len += len;
+
+	return 0;
+}
+
+static uint32_t get_u32(size_t offset)
+{
+	uint32_t val;
+
+	memcpy(&val, export_buf + offset, sizeof(val));
+
+	return val;
+}
+
+static void parse_export(struct pcapng_result *res)
+{
+	size_t offset = 0;
+	uint32_t type, len;
+
+	memset(res, 0, sizeof(*res));
+
+	zassert_true(export_len >= 28, "Export too short");
+	zassert_equal(get_u32(0), SHB_TYPE, "No section header");
+	zassert_equal(get_u32(8), 0x1A2B3C4DU, "Wrong byte order magic");
+
+	while (offset < export_len) {
+		type = get_u32(offset);
+		len = get_u32(offset + 4);
+
+		zassert_true(len >= 12 && (len % 4) == 0, "Invalid block length");
+		zassert_true(offset + len <= export_len, "Truncated block");
+		zassert_equal(get_u32(offset + len - 4), len,
+			      "Block trailer mismatch");
+
+		if (type == IDB_TYPE) {
+			zassert_equal(res->epb_count, 0,
+				      "Interface after packets");
+			res->idb_count++;
+		} else if (type == EPB_TYPE) {
+			zassert_true(get_u32(offset + 8) < res->idb_count,
+				     "Unknown interface id");
+			res->cap_len = get_u32(offset + 20);
+			res->orig_len = get_u32(offset + 24);
+			res->first_byte = export_buf[offset + 28];
+			res->epb_count++;
+		}
+
+		offset += len;
+	}
+}
+
+static int export_ring(struct pcapng_result *res)
+{
+	int ret;
+
+	export_len = 0;
+
+	ret = net_capture_ring_export(export_cb, NULL);
+	zassert_true(ret >= 0, "Export failed (%d)", ret);
+
+	parse_export(res);
+	zassert_equal(res->epb_count, ret, "Packet count mismatch");
+
+	return ret;
+}
+
+static void capture_pkts(int count, uint8_t first)
+{
+	struct net_if *iface = net_if_get_default();
+	uint8_t data[PKT_LEN];
+	struct net_pkt *pkt;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		pkt = net_pkt_alloc_with_buffer(iface, sizeof(data), AF_UNSPEC,
+						0, K_NO_WAIT);
+		zassert_not_null(pkt, "Cannot allocate pkt");
+
+		memset(data, first + i, sizeof(data));
+		zassert_equal(net_pkt_write(pkt, data, sizeof(data)), 0,
+			      "Cannot write pkt");
+
+		net_capture_pkt(iface, pkt);
+		net_pkt_unref(pkt);
+	}
+}
+
+static bool reject_all(struct net_if *iface, struct net_pkt *pkt,
+		       void *user_data)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(user_data);
+
+	return false;
+}
+
+static void *capture_setup(void)
+{
+	net_capture_ring_clear();
+
+	return NULL;
+}
+
+static void capture_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	(void)net_capture_ring_stop();
+	net_capture_ring_clear();
+}
+
+ZTEST(net_capture_ring, test_export)
+{
+	struct net_capture_ring_stats stats;
+	struct pcapng_result res;
+
+	zassert_equal(net_capture_ring_start(NULL, SNAPLEN, NULL, NULL), 0,
+		      "Cannot start capture");
+	zassert_true(net_capture_ring_is_enabled(), "Capture not enabled");
+
+	capture_pkts(3, 0x10);
+
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.captured, 3, "Wrong captured count");
+	zassert_equal(stats.bytes, 3 * SNAPLEN, "Wrong captured bytes");
+	zassert_equal(stats.dropped, 0, "Unexpected drops");
+
+	zassert_equal(export_ring(&res), 3, "Wrong number of packets");
+	zassert_true(res.idb_count > 0, "No interfaces");
+	zassert_equal(res.cap_len, SNAPLEN, "Snaplen not applied");
+	zassert_equal(res.orig_len, PKT_LEN, "Wrong original length");
+	zassert_equal(res.first_byte, 0x12, "Wrong packet data");
+
+	/* Exported packets are removed from the ring */
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.used, 0, "Ring not drained");
+	zassert_equal(export_ring(&res), 0, "Packets exported twice");
+
+	/* Nothing is stored after stop */
+	zassert_equal(net_capture_ring_stop(), 0, "Cannot stop capture");
+	capture_pkts(1, 0x20);
+	zassert_equal(export_ring(&res), 0, "Packet captured after stop");
+}
+
+ZTEST(net_capture_ring, test_filter)
+{
+	struct net_capture_ring_stats stats;
+	struct pcapng_result res;
+
+	zassert_equal(net_capture_ring_start(NULL, 0, reject_all, NULL), 0,
+		      "Cannot start capture");
+
+	capture_pkts(2, 0);
+
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.filtered, 2, "Wrong filtered count");
+	zassert_equal(stats.captured, 0, "Filtered packet captured");
+	zassert_equal(export_ring(&res), 0, "Filtered packet exported");
+}
+
+ZTEST(net_capture_ring, test_full_and_wrap)
+{
+	struct net_capture_ring_stats stats;
+	struct pcapng_result res;
+	int count, round;
+
+	zassert_equal(net_capture_ring_start(NULL, 0, NULL, NULL), 0,
+		      "Cannot start capture");
+
+	/* Fill the ring a few times, the records wrap around the end */
+	for (round = 0; round < 3; round++) {
+		net_capture_ring_clear();
+
+		capture_pkts(CONFIG_NET_CAPTURE_RING_SIZE / 64, round);
+
+		net_capture_ring_stats_get(&stats);
+		zassert_true(stats.dropped > 0, "No drops when full");
+		zassert_true(stats.used <= stats.size, "Ring overflow");
+
+		count = export_ring(&res);
+		zassert_equal(count, stats.captured, "Lost packets");
+		zassert_equal(res.cap_len, CONFIG_NET_CAPTURE_RING_SNAPLEN,
+			      "Default snaplen not applied");
+
+		/* A few more packets right after the drain */
+		capture_pkts(2, 0x40);
+		zassert_equal(export_ring(&res), 2, "Packets lost after wrap");
+		zassert_equal(res.first_byte, 0x41, "Wrong packet data");
+	}
+}
+
+static K_SEM_DEFINE(in_filter, 0, 1);
+static K_SEM_DEFINE(filter_release, 0, 1);
+static K_THREAD_STACK_DEFINE(producer_stack, 1024);
+static K_THREAD_STACK_DEFINE(restart_stack, 1024);
+static struct k_thread producer_thread;
+static struct k_thread restart_thread;
+static bool restarted;
+
+static bool slow_filter(struct net_if *iface, struct net_pkt *pkt,
+			void *user_data)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(user_data);
+
+	k_sem_give(&in_filter);
+	k_sem_take(&filter_release, K_FOREVER);
+
+	return true;
+}
+
+static void producer(void *p1, void *p2, void *p3)
+{
+	capture_pkts(1, 0x50);
+}
+
+static void restart(void *p1, void *p2, void *p3)
+{
+	zassert_equal(net_capture_ring_start(NULL, 0, NULL, NULL), 0,
+		      "Cannot restart capture");
+	restarted = true;
+}
+
+ZTEST(net_capture_ring, test_restart_waits_producers)
+{
+	struct net_capture_ring_stats stats;
+	struct pcapng_result res;
+
+	zassert_equal(net_capture_ring_start(NULL, SNAPLEN, slow_filter, NULL),
+		      0, "Cannot start capture");
+
+	k_thread_create(&producer_thread, producer_stack,
+			K_THREAD_STACK_SIZEOF(producer_stack), producer,
+			NULL, NULL, NULL, K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+
+	zassert_equal(k_sem_take(&in_filter, K_SECONDS(1)), 0,
+		      "Producer not in the filter");
+
+	restarted = false;
+
+	k_thread_create(&restart_thread, restart_stack,
+			K_THREAD_STACK_SIZEOF(restart_stack), restart,
+			NULL, NULL, NULL, K_PRIO_PREEMPT(1), 0, K_NO_WAIT);
+
+	/* The new settings are not applied while a producer uses the old */
+	k_msleep(20);
+	zassert_false(restarted, "Capture restarted under a producer");
+
+	k_sem_give(&filter_release);
+
+	zassert_equal(k_thread_join(&restart_thread, K_SECONDS(1)), 0,
+		      "Restart did not finish");
+	zassert_equal(k_thread_join(&producer_thread, K_SECONDS(1)), 0,
+		      "Producer did not finish");
+	zassert_true(restarted, "Capture not restarted");
+
+	/* The packet in flight kept the old snaplen, the next one has the
+	 * new settings.
+	 */
+	net_capture_ring_stats_get(&stats);
+	zassert_equal(stats.captured, 1, "Packet in flight lost");
+
+	zassert_equal(export_ring(&res), 1, "Wrong number of packets");
+	zassert_equal(res.cap_len, SNAPLEN, "Settings changed under producer");
+
+	capture_pkts(1, 0x60);
+	zassert_equal(export_ring(&res), 1, "Wrong number of packets");
+	zassert_equal(res.cap_len, CONFIG_NET_CAPTURE_RING_SNAPLEN,
+		      "New settings not applied");
+}
+
+ZTEST_SUITE(net_capture_ring, NULL, capture_setup, NULL, capture_after, NULL);
@@ -0,0 +1,438 @@
+/* main.c - TCP receive coalescing (GRO) tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_GRO_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/random/rand32.h>
+
+#include <zephyr/ztest.h>
+
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+
+#include "net_private.h"
+#include "net_stats.h"
+#include "connection.h"
+#include "ipv4.h"
+#include "tcp_internal.h"
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+#define MY_PORT 4242
+#define PEER_PORT 4343
+
+#define SEG_LEN 10
+#define MAX_SEGS 8
+
+#define TH_FIN 0x01
+#define TH_PSH 0x08
+#define TH_ACK 0x10
+
+#define ALLOC_TIMEOUT K_MSEC(100)
+#define WAIT_TIME K_MSEC(500)
+
+/* A packet as seen by the TCP layer */
+struct delivered {
+	uint32_t seq;
+	uint16_t len;
+	uint8_t flags;
+};
+
+static struct net_if *iface1;
+static struct net_conn_handle *handle;
+
+static struct delivered delivered[MAX_SEGS];
+static int delivered_count;
+static bool data_ok;
+static struct k_sem recv_data;
+
+static uint8_t payload[MAX_SEGS * SEG_LEN];
+
+struct net_if_test {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_iface_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	struct net_if_test *data = net_if_get_device(iface)->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_ETHERNET);
+}
+
+static int sender_iface(const struct device *dev, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+struct net_if_test net_iface1_data;
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT_INSTANCE(net_iface1_test,
+			 "iface1",
+			 iface1,
+			 net_iface_dev_init,
+			 NULL,
+			 &net_iface1_data,
+			 NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_iface_api,
+			 DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2),
+			 NET_ETH_MTU);
+
+static enum net_verdict tcp_data_received(struct net_conn *conn,
+					  struct net_pkt *pkt,
+					  union net_ip_header *ip_hdr,
+					  union net_proto_header *proto_hdr,
+					  void *user_data)
+{
+	struct net_tcp_hdr *tcp_hdr = proto_hdr->tcp;
+	uint8_t buf[MAX_SEGS * SEG_LEN];
+	struct delivered *d;
+	size_t hdr_len;
+	uint32_t offset;
+
+	if (delivered_count >= MAX_SEGS) {
+		data_ok = false;
+		goto out;
+	}
+
+	d = &delivered[delivered_count++];
+	hdr_len = NET_IPV4H_LEN + (tcp_hdr->offset >> 4) * 4U;
+
+	d->seq = sys_get_be32(tcp_hdr->seq);
+	d->len = ntohs(ip_hdr->ipv4->len) - hdr_len;
+	d->flags = tcp_hdr->flags;
+
+	/* The merged payload must be found in the original order */
+	offset = d->seq;
+
+	if (net_pkt_get_len(pkt) != hdr_len + d->len ||
+	    offset + d->len > sizeof(payload)) {
+		data_ok = false;
+		goto out;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, hdr_len) || net_pkt_read(pkt, buf, d->len) ||
+	    memcmp(buf, &payload[offset], d->len)) {
+		data_ok = false;
+	}
+
+out:
+	net_pkt_unref(pkt);
+	k_sem_give(&recv_data);
+
+	return NET_OK;
+}
+
+struct segment {
+	uint32_t seq;
+	uint8_t flags;
+	/* The defaults below are used when these are 0 */
+	uint32_t ack;
+	uint8_t ttl;
+	uint8_t tos;
+};
+
+#define SEG_ACK 1U
+#define SEG_TTL 64U
+
+static struct net_pkt *prepare_segment(const struct segment *seg,
+				       size_t len)
+{
+	struct net_ipv4_hdr *ip_hdr;
+	struct net_tcp_hdr tcp_hdr = { 0 };
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface1, NET_IPV4H_LEN +
+					   sizeof(tcp_hdr) + len,
+					   AF_INET, IPPROTO_TCP,
+					   ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	net_pkt_set_ipv4_ttl(pkt, seg->ttl ? seg->ttl : SEG_TTL);
+
+	ret = net_ipv4_create(pkt, &peer_addr, &my_addr);
+	zassert_equal(ret, 0, "IPv4 header append failed");
+
+	tcp_hdr.src_port = htons(PEER_PORT);
+	tcp_hdr.dst_port = htons(MY_PORT);
+	sys_put_be32(seg->seq, tcp_hdr.seq);
+	sys_put_be32(seg->ack ? seg->ack : SEG_ACK, tcp_hdr.ack);
+	tcp_hdr.offset = (sizeof(tcp_hdr) / 4U) << 4;
+	tcp_hdr.flags = seg->flags;
+	sys_put_be16(1000U, tcp_hdr.wnd);
+
+	ret = net_pkt_write(pkt, &tcp_hdr, sizeof(tcp_hdr));
+	zassert_equal(ret, 0, "TCP header append failed");
+
+	ret = net_pkt_write(pkt, &payload[seg->seq], len);
+	zassert_equal(ret, 0, "Cannot append data");
+
+	net_pkt_cursor_init(pkt);
+	net_ipv4_finalize(pkt, IPPROTO_TCP);
+	net_pkt_cursor_init(pkt);
+
+	if (seg->tos) {
+		ip_hdr = (struct net_ipv4_hdr *)pkt->buffer->data;
+		ip_hdr->tos = seg->tos;
+		ip_hdr->chksum = 0U;
+		ip_hdr->chksum = net_calc_chksum_ipv4(pkt);
+	}
+
+	return pkt;
+}
+
+/* Queue all the segments before the RX thread runs, so that they are
+ * seen in the same RX batch.
+ */
+static void recv_segments(const struct segment *segs, int count,
+			  int expected)
+{
+	int i;
+
+	delivered_count = 0;
+	data_ok = true;
+	k_sem_reset(&recv_data);
+
+	k_sched_lock();
+
+	for (i = 0; i < count; i++) {
+		struct net_pkt *pkt = prepare_segment(&segs[i], SEG_LEN);
+
+		zassert_equal(net_recv_data(iface1, pkt), 0,
+			      "Cannot receive pkt");
+	}
+
+	k_sched_unlock();
+
+	for (i = 0; i < expected; i++) {
+		zassert_equal(k_sem_take(&recv_data, WAIT_TIME), 0,
+			      "Timeout while waiting pkt %d", i);
+	}
+
+	/* Nothing else must show up */
+	zassert_not_equal(k_sem_take(&recv_data, K_MSEC(50)), 0,
+			  "Unexpected pkt");
+	zassert_true(data_ok, "Invalid data received");
+	zassert_equal(delivered_count, expected, "Invalid pkt count");
+}
+
+static void check_delivered(int idx, uint32_t seq, uint16_t len)
+{
+	zassert_equal(delivered[idx].seq, seq, "Invalid seq %u for pkt %d",
+		      delivered[idx].seq, idx);
+	zassert_equal(delivered[idx].len, len, "Invalid len %u for pkt %d",
+		      delivered[idx].len, idx);
+}
+
+ZTEST(net_gro, test_gro_in_order)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK }, { 20, TH_ACK },
+	};
+	uint32_t merged = GET_STAT(iface1, gro.merged);
+	uint32_t flushed = GET_STAT(iface1, gro.flushed);
+	uint32_t recv = GET_STAT(iface1, gro.recv);
+
+	recv_segments(segs, ARRAY_SIZE(segs), 1);
+
+	check_delivered(0, 0, 3 * SEG_LEN);
+
+	zassert_equal(GET_STAT(iface1, gro.recv) - recv, 3,
+		      "Invalid recv stats");
+	zassert_equal(GET_STAT(iface1, gro.merged) - merged, 2,
+		      "Invalid merged stats");
+	zassert_equal(GET_STAT(iface1, gro.flushed) - flushed, 1,
+		      "Invalid flushed stats");
+}
+
+ZTEST(net_gro, test_gro_max_segs)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK }, { 20, TH_ACK },
+		{ 30, TH_ACK }, { 40, TH_ACK }, { 50, TH_ACK },
+	};
+
+	recv_segments(segs, ARRAY_SIZE(segs), 2);
+
+	check_delivered(0, 0, CONFIG_NET_GRO_MAX_SEGS * SEG_LEN);
+	check_delivered(1, CONFIG_NET_GRO_MAX_SEGS * SEG_LEN,
+			(ARRAY_SIZE(segs) - CONFIG_NET_GRO_MAX_SEGS) * SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_out_of_order)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 20, TH_ACK }, { 10, TH_ACK },
+	};
+	uint32_t merged = GET_STAT(iface1, gro.merged);
+
+	/* Every segment flushes the previous one, and the arrival order
+	 * is kept.
+	 */
+	recv_segments(segs, ARRAY_SIZE(segs), 3);
+
+	check_delivered(0, 0, SEG_LEN);
+	check_delivered(1, 20, SEG_LEN);
+	check_delivered(2, 10, SEG_LEN);
+
+	zassert_equal(GET_STAT(iface1, gro.merged), merged,
+		      "Out of order segments merged");
+}
+
+ZTEST(net_gro, test_gro_push)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK | TH_PSH }, { 20, TH_ACK },
+	};
+
+	recv_segments(segs, ARRAY_SIZE(segs), 2);
+
+	check_delivered(0, 0, 2 * SEG_LEN);
+	zassert_true(delivered[0].flags & TH_PSH, "PSH flag lost");
+	check_delivered(1, 20, SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_fin)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK }, { 20, TH_ACK | TH_FIN },
+	};
+
+	/* The FIN is passed as is after the data held before it */
+	recv_segments(segs, ARRAY_SIZE(segs), 2);
+
+	check_delivered(0, 0, 2 * SEG_LEN);
+	check_delivered(1, 20, SEG_LEN);
+	zassert_true(delivered[1].flags & TH_FIN, "FIN flag lost");
+}
+
+ZTEST(net_gro, test_gro_ack_change)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK }, { 20, TH_ACK, .ack = 2U },
+	};
+
+	/* The ACK advance is not hidden in the merged segment */
+	recv_segments(segs, ARRAY_SIZE(segs), 2);
+
+	check_delivered(0, 0, 2 * SEG_LEN);
+	check_delivered(1, 20, SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_ip_hdr_change)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK, .ttl = SEG_TTL - 1U },
+		{ 20, TH_ACK, .ttl = SEG_TTL - 1U },
+		{ 30, TH_ACK, .ttl = SEG_TTL - 1U, .tos = 0x03 },
+	};
+
+	/* An ECN mark or another path must not be merged away */
+	recv_segments(segs, ARRAY_SIZE(segs), 3);
+
+	check_delivered(0, 0, SEG_LEN);
+	check_delivered(1, 10, 2 * SEG_LEN);
+	check_delivered(2, 30, SEG_LEN);
+}
+
+ZTEST(net_gro, test_gro_iface_disabled)
+{
+	static const struct segment segs[] = {
+		{ 0, TH_ACK }, { 10, TH_ACK }, { 20, TH_ACK },
+	};
+	uint32_t recv = GET_STAT(iface1, gro.recv);
+
+	net_if_flag_clear(iface1, NET_IF_GRO);
+
+	recv_segments(segs, ARRAY_SIZE(segs), 3);
+
+	net_if_flag_set(iface1, NET_IF_GRO);
+
+	check_delivered(0, 0, SEG_LEN);
+	check_delivered(1, 10, SEG_LEN);
+	check_delivered(2, 20, SEG_LEN);
+
+	zassert_equal(GET_STAT(iface1, gro.recv), recv,
+		      "Segments taken over by GRO");
+}
+
+static void *test_setup(void)
+{
+	struct sockaddr remote_addr = { 0 };
+	struct sockaddr local_addr = { 0 };
+	struct net_if_addr *ifaddr;
+	int ret;
+	int i;
+
+	k_sem_init(&recv_data, 0, UINT_MAX);
+
+	for (i = 0; i < sizeof(payload); i++) {
+		payload[i] = i;
+	}
+
+	iface1 = net_if_get_first_by_type(&NET_L2_GET_NAME(DUMMY));
+	zassert_not_null(iface1, "Interface 1");
+
+	ifaddr = net_if_ipv4_addr_add(iface1, &my_addr, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "addr1");
+
+	net_if_up(iface1);
+
+	zassert_true(net_if_flag_is_set(iface1, NET_IF_GRO),
+		     "GRO not enabled by default");
+
+	net_ipaddr_copy(&net_sin(&local_addr)->sin_addr, &my_addr);
+	local_addr.sa_family = AF_INET;
+
+	net_ipaddr_copy(&net_sin(&remote_addr)->sin_addr, &peer_addr);
+	remote_addr.sa_family = AF_INET;
+
+	ret = net_conn_register(IPPROTO_TCP, AF_INET, &remote_addr,
+				&local_addr, PEER_PORT, MY_PORT, NULL,
+				tcp_data_received, NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register TCP handler");
+
+	return NULL;
+}
+
+ZTEST_SUITE(net_gro, NULL, test_setup, NULL, NULL, NULL);
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_ieee802154_fake_driver, LOG_LEVEL_DBG);
+
+#include <zephyr/zephyr.h>
+
+#include <zephyr/net/net_core.h>
+#include "net_private.h"
+
+#include <zephyr/net/net_pkt.h>
+
+/** FAKE ieee802.15.4 driver, with a scripted channel and peers **/
+#include <zephyr/net/ieee802154_radio.h>
+
+#include "ieee802154_frame.h"
+#include "tx_queue_test.h"
+
+struct fake_radio fake_radio;
+
+static struct net_if *fake_iface;
+static uint8_t fake_ack_seq;
+
+/* The peer ACK, received a bit after the frame was sent */
+static void fake_ack_recv(struct k_work *work)
+{
+	uint8_t ack[IEEE802154_ACK_PKT_LENGTH] = {
+		IEEE802154_FRAME_TYPE_ACK, 0x00, fake_ack_seq
+	};
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_rx_alloc_with_buffer(fake_iface, sizeof(ack), AF_UNSPEC,
+					   0, K_NO_WAIT);
+	if (!pkt) {
+		return;
+	}
+
+	if (!net_pkt_write(pkt, ack, sizeof(ack)) &&
+	    ieee802154_radio_handle_ack(fake_iface, pkt) == NET_OK) {
+		fake_radio.acks++;
+	}
+
+	net_pkt_unref(pkt);
+}
+
+static K_WORK_DELAYABLE_DEFINE(fake_ack_work, fake_ack_recv);
+
+static enum ieee802154_hw_caps fake_get_capabilities(const struct device *dev)
+{
+	if (fake_radio.sw_ack) {
+		return IEEE802154_HW_FCS | IEEE802154_HW_2_4_GHZ;
+	}
+
+	/* The ACK outcome is the return value of fake_tx() */
+	return IEEE802154_HW_FCS | IEEE802154_HW_2_4_GHZ |
+	       IEEE802154_HW_TX_RX_ACK;
+}
+
+static int fake_cca(const struct device *dev)
+{
+	if (atomic_get(&fake_radio.cca_busy) > 0) {
+		atomic_dec(&fake_radio.cca_busy);
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static int fake_set_channel(const struct device *dev, uint16_t channel)
+{
+	return 0;
+}
+
+static int fake_set_txpower(const struct device *dev, int16_t dbm)
+{
+	return 0;
+}
+
+static int fake_tx(const struct device *dev,
+		   enum ieee802154_tx_mode mode,
+		   struct net_pkt *pkt,
+		   struct net_buf *frag)
+{
+	uint16_t dst = sys_get_le16(frag->data + TEST_FRAME_DST_POS);
+	uint32_t n = fake_radio.tx_count;
+
+	if (n < ARRAY_SIZE(fake_radio.tx_log)) {
+		fake_radio.tx_log[n] = dst;
+	}
+
+	fake_radio.tx_count = n + 1U;
+
+	if (dst == fake_radio.unreachable) {
+		return fake_radio.sw_ack ? 0 : -ENOMSG;
+	}
+
+	if (fake_radio.sw_ack) {
+		fake_ack_seq = frag->data[2];
+		k_work_reschedule(&fake_ack_work, K_MSEC(1));
+	}
+
+	return 0;
+}
+
+static int fake_start(const struct device *dev)
+{
+	return 0;
+}
+
+static int fake_stop(const struct device *dev)
+{
+	return 0;
+}
+
+static void fake_iface_init(struct net_if *iface)
+{
+	struct ieee802154_context *ctx = net_if_l2_data(iface);
+	static uint8_t mac[8] = { 0x00, 0x12, 0x4b, 0x00,
+				  0x00, 0x9e, 0xa3, 0xc2 };
+
+	fake_iface = iface;
+
+	net_if_set_link_addr(iface, mac, 8, NET_LINK_IEEE802154);
+
+	ieee802154_init(iface);
+
+	ctx->pan_id = TEST_PAN_ID;
+	ctx->channel = 26U;
+	ctx->sequence = 62U;
+}
+
+static int fake_init(const struct device *dev)
+{
+	fake_stop(dev);
+
+	return 0;
+}
+
+static struct ieee802154_radio_api fake_radio_api = {
+	.iface_api.init	= fake_iface_init,
+
+	.get_capabilities	= fake_get_capabilities,
+	.cca			= fake_cca,
+	.set_channel		= fake_set_channel,
+	.set_txpower		= fake_set_txpower,
+	.start			= fake_start,
+	.stop			= fake_stop,
+	.tx			= fake_tx,
+};
+
+NET_DEVICE_INIT(fake, "fake_ieee802154",
+		fake_init, NULL, NULL, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&fake_radio_api, IEEE802154_L2,
+		NET_L2_GET_CTX_TYPE(IEEE802154_L2), 125);
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_ieee802154_tx_queue_test, LOG_LEVEL_DBG);
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_pkt.h>
+
+#include <ieee802154_tx_queue.h>
+
+#include "tx_queue_test.h"
+
+/* The destination queue is picked by hashing the link layer address,
+ * with 4 queues these two short addresses always get different ones.
+ */
+#define PEER_DEAD	0x0001
+#define PEER_ALIVE	0x0002
+#define OWN_ADDR	0x0003
+
+#define FRAME_AR_DATA	0x61 /* Data frame, ACK request, PAN id compression */
+#define FRAME_SHORT	0x88 /* Short destination and source addresses */
+
+static struct net_if *iface;
+static uint8_t sequence;
+
+static void queue_frame(struct net_pkt *pkt, uint16_t dst)
+{
+	uint8_t addr[2] = { dst & 0xff, dst >> 8 };
+	struct net_linkaddr ll_dst = {
+		.addr = addr,
+		.len = sizeof(addr),
+	};
+	struct net_buf *frame;
+	uint8_t *hdr;
+
+	frame = ieee802154_tx_queue_frame_alloc();
+	zassert_not_null(frame, "No frame buffer");
+
+	hdr = net_buf_add(frame, 9);
+	hdr[0] = FRAME_AR_DATA;
+	hdr[1] = FRAME_SHORT;
+	hdr[2] = sequence++;
+	sys_put_le16(TEST_PAN_ID, hdr + 3);
+	sys_put_le16(dst, hdr + TEST_FRAME_DST_POS);
+	sys_put_le16(OWN_ADDR, hdr + 7);
+
+	net_buf_add_mem(frame, "payload", 7);
+
+	ieee802154_tx_queue_push(iface, pkt, frame, &ll_dst);
+}
+
+static struct net_pkt *alloc_pkt(void)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_on_iface(iface, K_FOREVER);
+	zassert_not_null(pkt, "No packet");
+
+	return pkt;
+}
+
+/* Wait until the given number of frames got sent or dropped */
+static void wait_done(const struct ieee802154_tx_stats *before,
+		      uint32_t frames)
+{
+	struct ieee802154_tx_stats now;
+	int i;
+
+	for (i = 0; i < 100; i++) {
+		ieee802154_tx_queue_stats_get(&now);
+
+		if ((now.sent - before->sent) +
+		    (now.failed - before->failed) >= frames) {
+			return;
+		}
+
+		k_msleep(10);
+	}
+
+	zassert_unreachable("Frames not done in time");
+}
+
+static uint32_t count_tx(uint16_t dst)
+{
+	uint32_t count = 0U;
+	uint32_t i;
+
+	for (i = 0U; i < fake_radio.tx_count; i++) {
+		count += fake_radio.tx_log[i] == dst;
+	}
+
+	return count;
+}
+
+static void *test_setup(void)
+{
+	const struct device *dev;
+
+	dev = device_get_binding("fake_ieee802154");
+	zassert_not_null(dev, "Could not get fake device");
+
+	iface = net_if_lookup_by_dev(dev);
+	zassert_not_null(iface, "Could not get fake iface");
+
+	return NULL;
+}
+
+static void test_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	atomic_set(&fake_radio.cca_busy, 0);
+	fake_radio.unreachable = PEER_DEAD;
+	fake_radio.sw_ack = false;
+	fake_radio.acks = 0U;
+	fake_radio.tx_count = 0U;
+}
+
+ZTEST(ieee802154_tx_queue, test_retries_do_not_block_other_peers)
+{
+	const uint32_t retries = CONFIG_NET_L2_IEEE802154_RADIO_TX_RETRIES;
+	struct ieee802154_tx_stats before, after;
+	struct net_pkt *dead, *alive;
+	uint32_t i, last_dead = 0U;
+
+	ieee802154_tx_queue_stats_get(&before);
+
+	dead = alloc_pkt();
+	alive = alloc_pkt();
+
+	/* Queue everything before the TX work queue gets to run */
+	k_sched_lock();
+	queue_frame(dead, PEER_DEAD);
+	queue_frame(alive, PEER_ALIVE);
+	queue_frame(alive, PEER_ALIVE);
+	k_sched_unlock();
+
+	net_pkt_unref(dead);
+	net_pkt_unref(alive);
+
+	wait_done(&before, 3U);
+
+	ieee802154_tx_queue_stats_get(&after);
+
+	zassert_equal(after.sent - before.sent, 2U, "Alive peer frames lost");
+	zassert_equal(after.failed - before.failed, 1U, "Dead peer frame sent");
+	zassert_equal(after.retries - before.retries, retries - 1U,
+		      "Unexpected number of retries");
+
+	zassert_equal(count_tx(PEER_DEAD), retries, "Unexpected attempts");
+	zassert_equal(count_tx(PEER_ALIVE), 2U, "Unexpected frames");
+
+	if (!IS_ENABLED(CONFIG_NET_L2_IEEE802154_RADIO_ALOHA)) {
+		/* Random backoffs, no guaranteed order */
+		return;
+	}
+
+	for (i = 0U; i < fake_radio.tx_count; i++) {
+		if (fake_radio.tx_log[i] == PEER_DEAD) {
+			last_dead = i;
+		}
+	}
+
+	/* The queues are served in turn: the other peer got its frames
+	 * through while the dead one was being retried.
+	 */
+	for (i = 0U; i < last_dead; i++) {
+		if (fake_radio.tx_log[i] == PEER_ALIVE) {
+			return;
+		}
+	}
+
+	zassert_unreachable("Alive peer waited for the dead one");
+}
+
+ZTEST(ieee802154_tx_queue, test_failed_frame_drops_packet)
+{
+	const uint32_t retries = CONFIG_NET_L2_IEEE802154_RADIO_TX_RETRIES;
+	struct ieee802154_tx_stats before, after;
+	struct net_pkt *pkt;
+
+	ieee802154_tx_queue_stats_get(&before);
+
+	pkt = alloc_pkt();
+
+	/* Two fragments of the same packet */
+	k_sched_lock();
+	queue_frame(pkt, PEER_DEAD);
+	queue_frame(pkt, PEER_DEAD);
+	k_sched_unlock();
+
+	net_pkt_unref(pkt);
+
+	wait_done(&before, 2U);
+
+	ieee802154_tx_queue_stats_get(&after);
+
+	zassert_equal(after.failed - before.failed, 2U, "Fragment not dropped");
+	zassert_equal(count_tx(PEER_DEAD), retries,
+		      "The second fragment was sent");
+}
+
+ZTEST(ieee802154_tx_queue, test_busy_channel)
+{
+	struct ieee802154_tx_stats before, after;
+	struct net_pkt *pkt;
+
+	if (!IS_ENABLED(CONFIG_NET_L2_IEEE802154_RADIO_CSMA_CA)) {
+		ztest_test_skip();
+	}
+
+	ieee802154_tx_queue_stats_get(&before);
+
+	atomic_set(&fake_radio.cca_busy, 2);
+
+	pkt = alloc_pkt();
+	queue_frame(pkt, PEER_ALIVE);
+	net_pkt_unref(pkt);
+
+	wait_done(&before, 1U);
+
+	ieee802154_tx_queue_stats_get(&after);
+
+	zassert_equal(after.sent - before.sent, 1U, "Frame not sent");
+	zassert_equal(after.cca_failures - before.cca_failures, 2U,
+		      "Busy channel not counted");
+	zassert_equal(after.retries - before.retries, 0U,
+		      "Busy channel counted as a retry");
+	zassert_equal(count_tx(PEER_ALIVE), 1U, "Unexpected frames");
+}
+
+ZTEST(ieee802154_tx_queue, test_ack_completes_frames)
+{
+	const uint32_t retries = CONFIG_NET_L2_IEEE802154_RADIO_TX_RETRIES;
+	struct ieee802154_tx_stats before, after;
+	struct net_pkt *dead, *alive;
+
+	/* The radio only transmits, the ACKs come in as received frames */
+	fake_radio.sw_ack = true;
+
+	ieee802154_tx_queue_stats_get(&before);
+
+	dead = alloc_pkt();
+	alive = alloc_pkt();
+
+	k_sched_lock();
+	queue_frame(dead, PEER_DEAD);
+	queue_frame(alive, PEER_ALIVE);
+	queue_frame(alive, PEER_ALIVE);
+	k_sched_unlock();
+
+	net_pkt_unref(dead);
+	net_pkt_unref(alive);
+
+	wait_done(&before, 3U);
+
+	ieee802154_tx_queue_stats_get(&after);
+
+	zassert_equal(after.sent - before.sent, 2U, "Acknowledged frames lost");
+	zassert_equal(after.failed - before.failed, 1U,
+		      "Unacknowledged frame sent");
+	zassert_equal(after.retries - before.retries, retries - 1U,
+		      "Unexpected number of retries");
+	zassert_equal(fake_radio.acks, 2U, "ACKs not handled");
+
+	zassert_equal(count_tx(PEER_DEAD), retries, "Unexpected attempts");
+	zassert_equal(count_tx(PEER_ALIVE), 2U, "Unexpected frames");
+}
+
+ZTEST_SUITE(ieee802154_tx_queue, NULL, test_setup, test_before, NULL, NULL);
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 Intel Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __TX_QUEUE_TEST_H__
+#define __TX_QUEUE_TEST_H__
+
+#include <zephyr/sys/atomic.h>
+#include <zephyr/types.h>
+
+#define TEST_PAN_ID		0xabcd
+/* Data frame with short addresses: fcf, sequence, PAN id, then dst */
+#define TEST_FRAME_DST_POS	5
+
+struct fake_radio {
+	/* Number of coming CCA finding the channel busy */
+	atomic_t cca_busy;
+	/* Short address never acknowledging */
+	uint16_t unreachable;
+	/* ACK frames received from the peers, instead of handled by tx() */
+	bool sw_ack;
+	uint32_t acks;
+	/* Destinations of the transmitted frames, in order */
+	uint16_t tx_log[32];
+	uint32_t tx_count;
+};
+
+extern struct fake_radio fake_radio;
+
+#endif /* __TX_QUEUE_TEST_H__ */
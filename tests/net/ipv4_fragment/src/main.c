@@ -0,0 +1,497 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_IPV4_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/linker/sections.h>
+#include <zephyr/random/rand32.h>
+
+#include <zephyr/ztest.h>
+
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/buf.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+
+#include "ipv4.h"
+#include "icmpv4.h"
+#include "udp_internal.h"
+#include "reassembly.h"
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+#define MY_PORT 4242
+#define PEER_PORT 4343
+
+#define MAX_FRAGS CONFIG_NET_IPV4_FRAGMENT_MAX_PKT
+
+/* Largest UDP payload that fits in an IPv4 packet */
+#define MAX_DATAGRAM_LEN (UINT16_MAX - NET_IPV4UDPH_LEN)
+
+#define WAIT_TIME K_SECONDS(5)
+
+#define ALLOC_TIMEOUT K_MSEC(500)
+
+/* How the sent fragments are fed back to the stack */
+enum loop_mode {
+	LOOP_IN_ORDER,
+	LOOP_REVERSE,
+	LOOP_DROP_LAST,
+};
+
+static struct net_if *iface1;
+
+static bool test_failed;
+static bool test_started;
+static struct k_sem recv_data;
+static struct k_sem icmp_sent;
+
+static enum loop_mode loop_mode;
+static struct net_pkt *held[MAX_FRAGS];
+static int held_count;
+static size_t datagram_len;
+static size_t next_offset;
+static int frag_count;
+
+/* Payload is a repeating sequence whose period is not a multiple of 8, so
+ * that fragments reassembled in the wrong order are detected.
+ */
+#define PATTERN_PERIOD 251
+static uint8_t pattern[PATTERN_PERIOD * 4];
+
+struct net_if_test {
+	uint8_t idx;
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+	struct net_linkaddr ll_addr;
+};
+
+static int net_iface_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static uint8_t *net_iface_get_mac(const struct device *dev)
+{
+	struct net_if_test *data = dev->data;
+
+	if (data->mac_addr[2] == 0x00) {
+		/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+		data->mac_addr[0] = 0x00;
+		data->mac_addr[1] = 0x00;
+		data->mac_addr[2] = 0x5E;
+		data->mac_addr[3] = 0x00;
+		data->mac_addr[4] = 0x53;
+		data->mac_addr[5] = sys_rand32_get();
+	}
+
+	data->ll_addr.addr = data->mac_addr;
+	data->ll_addr.len = 6U;
+
+	return data->mac_addr;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	uint8_t *mac = net_iface_get_mac(net_if_get_device(iface));
+
+	net_if_set_link_addr(iface, mac, sizeof(struct net_eth_addr),
+			     NET_LINK_ETHERNET);
+}
+
+static int verify_fragment(struct net_pkt *pkt)
+{
+	struct net_ipv4_hdr *hdr = NET_IPV4_HDR(pkt);
+	uint16_t flags = (hdr->offset[0] << 8) | hdr->offset[1];
+	uint16_t len = ntohs(hdr->len);
+
+	frag_count++;
+
+	if (len != net_pkt_get_len(pkt) || len > NET_ETH_MTU) {
+		NET_DBG("Invalid fragment length %d", len);
+		return -EINVAL;
+	}
+
+	if (net_calc_chksum_ipv4(pkt) != 0U) {
+		NET_DBG("Invalid fragment header checksum");
+		return -EINVAL;
+	}
+
+	if ((flags & NET_IPV4_FRAGH_OFFSET_MASK) * 8U != next_offset) {
+		NET_DBG("Invalid fragment offset %d, expected %zd",
+			(flags & NET_IPV4_FRAGH_OFFSET_MASK) * 8U, next_offset);
+		return -EINVAL;
+	}
+
+	next_offset += len - NET_IPV4H_LEN;
+
+	if (flags & NET_IPV4_MORE_FRAG_MASK) {
+		if ((len - NET_IPV4H_LEN) % 8) {
+			NET_DBG("Fragment payload %d not multiple of 8",
+				len - NET_IPV4H_LEN);
+			return -EINVAL;
+		}
+	} else if (next_offset != datagram_len + NET_UDPH_LEN) {
+		NET_DBG("Last fragment ends at %zd, expected %zd",
+			next_offset, datagram_len + NET_UDPH_LEN);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Turn a sent fragment into a received one. Swapping the addresses keeps
+ * both the IPv4 header and the UDP checksums valid.
+ */
+static struct net_pkt *reflect(struct net_pkt *pkt)
+{
+	struct net_ipv4_hdr *hdr;
+	struct net_pkt *clone;
+	struct in_addr addr;
+
+	clone = net_pkt_rx_clone(pkt, ALLOC_TIMEOUT);
+	if (!clone) {
+		return NULL;
+	}
+
+	hdr = NET_IPV4_HDR(clone);
+
+	net_ipv4_addr_copy_raw((uint8_t *)&addr, hdr->src);
+	net_ipv4_addr_copy_raw(hdr->src, hdr->dst);
+	net_ipv4_addr_copy_raw(hdr->dst, (uint8_t *)&addr);
+
+	return clone;
+}
+
+static void loop_back(struct net_pkt *pkt, bool last)
+{
+	struct net_pkt *clone;
+
+	if (loop_mode == LOOP_DROP_LAST && last) {
+		return;
+	}
+
+	clone = reflect(pkt);
+	if (!clone) {
+		test_failed = true;
+		return;
+	}
+
+	if (loop_mode == LOOP_REVERSE) {
+		held[held_count++] = clone;
+
+		if (!last) {
+			return;
+		}
+
+		while (held_count) {
+			clone = held[--held_count];
+
+			if (net_recv_data(iface1, clone) < 0) {
+				net_pkt_unref(clone);
+				test_failed = true;
+			}
+		}
+
+		return;
+	}
+
+	if (net_recv_data(iface1, clone) < 0) {
+		net_pkt_unref(clone);
+		test_failed = true;
+	}
+}
+
+static int sender_iface(const struct device *dev, struct net_pkt *pkt)
+{
+	struct net_ipv4_hdr *hdr;
+
+	if (!pkt->buffer) {
+		NET_DBG("No data to send!");
+		return -ENODATA;
+	}
+
+	hdr = NET_IPV4_HDR(pkt);
+
+	if (test_started && hdr->proto == IPPROTO_ICMP) {
+		struct net_icmp_hdr *icmp_hdr;
+
+		icmp_hdr = (struct net_icmp_hdr *)((uint8_t *)hdr +
+						   NET_IPV4H_LEN);
+		if (icmp_hdr->type == NET_ICMPV4_TIME_EXCEEDED &&
+		    icmp_hdr->code ==
+				NET_ICMPV4_TIME_EXCEEDED_FRAGMENT_REASSEMBLY) {
+			k_sem_give(&icmp_sent);
+		}
+	} else if (test_started) {
+		if (verify_fragment(pkt) < 0) {
+			NET_DBG("Fragments cannot be verified");
+			test_failed = true;
+		} else {
+			loop_back(pkt, !(hdr->offset[0] & 0x20));
+		}
+	}
+
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+struct net_if_test net_iface1_data;
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT_INSTANCE(net_iface1_test,
+			 "iface1",
+			 iface1,
+			 net_iface_dev_init,
+			 NULL,
+			 &net_iface1_data,
+			 NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_iface_api,
+			 _ETH_L2_LAYER,
+			 _ETH_L2_CTX_TYPE,
+			 NET_ETH_MTU);
+
+static enum net_verdict udp_data_received(struct net_conn *conn,
+					  struct net_pkt *pkt,
+					  union net_ip_header *ip_hdr,
+					  union net_proto_header *proto_hdr,
+					  void *user_data)
+{
+	uint8_t buf[PATTERN_PERIOD];
+	size_t left = datagram_len;
+
+	NET_DBG("Data %p received", pkt);
+
+	if (net_pkt_get_len(pkt) != NET_IPV4UDPH_LEN + datagram_len) {
+		NET_DBG("Invalid datagram length %zd", net_pkt_get_len(pkt));
+		test_failed = true;
+		goto out;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, NET_IPV4UDPH_LEN)) {
+		test_failed = true;
+		goto out;
+	}
+
+	while (left) {
+		size_t len = MIN(left, sizeof(buf));
+
+		if (net_pkt_read(pkt, buf, len) ||
+		    memcmp(buf, pattern, len)) {
+			NET_DBG("Invalid data at offset %zd",
+				datagram_len - left);
+			test_failed = true;
+			goto out;
+		}
+
+		left -= len;
+	}
+
+out:
+	net_pkt_unref(pkt);
+	k_sem_give(&recv_data);
+
+	return NET_OK;
+}
+
+static void setup_udp_handler(void)
+{
+	static struct net_conn_handle *handle;
+	struct sockaddr remote_addr = { 0 };
+	struct sockaddr local_addr = { 0 };
+	int ret;
+
+	net_ipaddr_copy(&net_sin(&local_addr)->sin_addr, &my_addr);
+	local_addr.sa_family = AF_INET;
+
+	net_ipaddr_copy(&net_sin(&remote_addr)->sin_addr, &peer_addr);
+	remote_addr.sa_family = AF_INET;
+
+	/* The addresses of the looped back fragments are swapped but not
+	 * the ports.
+	 */
+	ret = net_udp_register(AF_INET, &remote_addr, &local_addr,
+			       MY_PORT, PEER_PORT, NULL, udp_data_received,
+			       NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register UDP handler");
+}
+
+static void send_datagram(size_t len, enum loop_mode mode)
+{
+	struct net_pkt *pkt;
+	size_t left = len;
+	int ret;
+
+	pkt = net_pkt_alloc_with_buffer(iface1, len, AF_INET, IPPROTO_UDP,
+					ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "packet");
+
+	ret = net_ipv4_create(pkt, &my_addr, &peer_addr);
+	zassert_equal(ret, 0, "IPv4 header append failed");
+
+	ret = net_udp_create(pkt, htons(MY_PORT), htons(PEER_PORT));
+	zassert_equal(ret, 0, "UDP header append failed");
+
+	while (left) {
+		size_t chunk = MIN(left, sizeof(pattern));
+
+		ret = net_pkt_write(pkt, pattern, chunk);
+		zassert_equal(ret, 0, "Cannot append data");
+
+		left -= chunk;
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_ipv4_finalize(pkt, IPPROTO_UDP);
+
+	datagram_len = len;
+	next_offset = 0;
+	frag_count = 0;
+	held_count = 0;
+	loop_mode = mode;
+	test_failed = false;
+
+	ret = net_send_data(pkt);
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+		zassert_equal(ret, 0, "Cannot send");
+	}
+}
+
+static void count_cb(const struct net_reassembly *reass, uint32_t remaining,
+		     void *user_data)
+{
+	int *count = user_data;
+
+	(*count)++;
+}
+
+static int pending_reassemblies(void)
+{
+	int count = 0;
+
+	net_reassembly_foreach(count_cb, &count);
+
+	return count;
+}
+
+ZTEST(net_ipv4_fragment, test_recv_ipv4_fragment_reverse)
+{
+	send_datagram(16384, LOOP_REVERSE);
+
+	zassert_equal(k_sem_take(&recv_data, WAIT_TIME), 0, "Timeout");
+	zassert_false(test_failed, "Reassembly failed");
+	zassert_equal(frag_count, 12, "Invalid number of fragments");
+	zassert_equal(pending_reassemblies(), 0, "Reassembly pending");
+}
+
+ZTEST(net_ipv4_fragment, test_recv_ipv4_fragment_timeout)
+{
+	k_sem_reset(&icmp_sent);
+
+	send_datagram(8192, LOOP_DROP_LAST);
+
+	zassert_not_equal(k_sem_take(&recv_data, K_MSEC(100)), 0,
+			  "Incomplete datagram received");
+	zassert_equal(pending_reassemblies(), 1, "Reassembly not pending");
+
+	/* The reassembly never times out early, and at most two wheel
+	 * ticks late.
+	 */
+	zassert_not_equal(k_sem_take(&icmp_sent,
+				     K_MSEC(CONFIG_NET_IPV4_FRAGMENT_TIMEOUT *
+					    MSEC_PER_SEC - 200)),
+			  0, "Reassembly timed out early");
+	zassert_equal(k_sem_take(&icmp_sent, K_SECONDS(3)), 0,
+		      "Time exceeded error not sent");
+	zassert_equal(pending_reassemblies(), 0, "Reassembly pending");
+}
+
+ZTEST(net_ipv4_fragment, test_ipv4_fragment_throughput)
+{
+	static const size_t sizes[] = { 8192, 16384, 32768, MAX_DATAGRAM_LEN };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		int64_t start = k_uptime_get();
+		int64_t elapsed;
+
+		send_datagram(sizes[i], LOOP_IN_ORDER);
+
+		zassert_equal(k_sem_take(&recv_data, WAIT_TIME), 0,
+			      "Timeout");
+
+		elapsed = k_uptime_get() - start;
+
+		zassert_false(test_failed, "Reassembly failed");
+		zassert_equal(frag_count,
+			      DIV_ROUND_UP(sizes[i] + NET_UDPH_LEN,
+					   (NET_ETH_MTU - NET_IPV4H_LEN) & ~7),
+			      "Invalid number of fragments");
+
+		TC_PRINT("%zu bytes in %d fragments, %lld ms (%lld kbit/s)\n",
+			 sizes[i], frag_count, elapsed,
+			 elapsed ? (int64_t)sizes[i] * 8 / elapsed : 0);
+	}
+
+	zassert_equal(pending_reassemblies(), 0, "Reassembly pending");
+}
+
+static void *test_setup(void)
+{
+	struct net_if_addr *ifaddr;
+	int i;
+
+	k_sem_init(&recv_data, 0, UINT_MAX);
+	k_sem_init(&icmp_sent, 0, UINT_MAX);
+
+	for (i = 0; i < sizeof(pattern); i++) {
+		pattern[i] = i % PATTERN_PERIOD;
+	}
+
+	iface1 = net_if_get_by_index(1);
+	zassert_not_null(iface1, "Interface 1");
+
+	((struct net_if_test *)net_if_get_device(iface1)->data)->idx =
+		net_if_get_by_iface(iface1);
+
+	ifaddr = net_if_ipv4_addr_add(iface1, &my_addr, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "addr1");
+
+	net_if_up(iface1);
+
+	setup_udp_handler();
+
+	test_started = true;
+
+	return NULL;
+}
+
+ZTEST_SUITE(net_ipv4_fragment, NULL, test_setup, NULL, NULL, NULL);
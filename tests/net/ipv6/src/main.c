@@ -1500,6 +1500,143 @@ static void test_dst_is_other_iface_mcast_recv(void)
 	net_context_put(ctx);
 }
 
+static struct in6_addr nbr_hash_addrs[CONFIG_NET_IPV6_MAX_NEIGHBORS];
+static int nbr_hash_count;
+
+static void nbr_hash_collect(struct net_nbr *nbr, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	net_ipaddr_copy(&nbr_hash_addrs[nbr_hash_count++],
+			&net_ipv6_nbr_data(nbr)->addr);
+}
+
+/* Neighbors differing only in the last bytes of the address, so that
+ * several of them share a hash bucket when there are less buckets than
+ * neighbors.
+ */
+static void nbr_hash_host(int i, struct in6_addr *addr,
+			  struct net_linkaddr_storage *llstorage,
+			  struct net_linkaddr *lladdr)
+{
+	static const struct in6_addr prefix = { { { 0x20, 0x01, 0x0d, 0xb8,
+						   0, 0x02, 0, 0, 0, 0, 0, 0,
+						   0, 0, 0, 0 } } };
+
+	net_ipaddr_copy(addr, &prefix);
+	addr->s6_addr[14] = i >> 8;
+	addr->s6_addr[15] = i & 0xff;
+
+	llstorage->addr[0] = 0x02;
+	llstorage->addr[1] = 0x00;
+	llstorage->addr[2] = 0x5e;
+	llstorage->addr[3] = 0x20;
+	llstorage->addr[4] = i >> 8;
+	llstorage->addr[5] = i & 0xff;
+
+	lladdr->len = 6U;
+	lladdr->addr = llstorage->addr;
+	lladdr->type = NET_LINK_ETHERNET;
+}
+
+static void nbr_hash_check(int i, bool present)
+{
+	struct net_linkaddr_storage llstorage, *ll;
+	struct net_linkaddr lladdr;
+	struct in6_addr addr;
+	struct net_nbr *nbr;
+
+	nbr_hash_host(i, &addr, &llstorage, &lladdr);
+
+	nbr = net_ipv6_nbr_lookup(TEST_NET_IF, &addr);
+	if (!present) {
+		zassert_is_null(nbr, "Neighbor %d found", i);
+		return;
+	}
+
+	zassert_not_null(nbr, "Neighbor %d not found", i);
+	zassert_true(net_ipv6_addr_cmp(&net_ipv6_nbr_data(nbr)->addr, &addr),
+		     "Wrong neighbor found for %d", i);
+
+	ll = net_nbr_get_lladdr(nbr->idx);
+	zassert_mem_equal(ll->addr, llstorage.addr, 6, "Wrong lladdr for %d",
+			  i);
+}
+
+static void nbr_hash_add(int i)
+{
+	struct net_linkaddr_storage llstorage;
+	struct net_linkaddr lladdr;
+	struct in6_addr addr;
+	struct net_nbr *nbr;
+
+	nbr_hash_host(i, &addr, &llstorage, &lladdr);
+
+	nbr = net_ipv6_nbr_add(TEST_NET_IF, &addr, &lladdr, false,
+			       NET_IPV6_NBR_STATE_STALE);
+	zassert_not_null(nbr, "Cannot add neighbor %d", i);
+}
+
+/**
+ * @brief IPv6 neighbor lookup, insert and evict with the hashed cache
+ */
+static void test_nbr_hash(void)
+{
+	struct net_linkaddr_storage llstorage;
+	struct net_linkaddr lladdr;
+	struct in6_addr addr;
+	int i;
+
+	/* Start from an empty cache */
+	nbr_hash_count = 0;
+	net_ipv6_nbr_foreach(nbr_hash_collect, NULL);
+
+	for (i = 0; i < nbr_hash_count; i++) {
+		net_ipv6_nbr_rm(TEST_NET_IF, &nbr_hash_addrs[i]);
+	}
+
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbr_hash_check(i, false);
+		nbr_hash_add(i);
+	}
+
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbr_hash_check(i, true);
+	}
+
+	/* Not added */
+	nbr_hash_check(CONFIG_NET_IPV6_MAX_NEIGHBORS + 1, false);
+
+	/* The cache is full, so the oldest stale neighbor is evicted */
+	nbr_hash_add(CONFIG_NET_IPV6_MAX_NEIGHBORS);
+
+	nbr_hash_check(0, false);
+
+	for (i = 1; i <= CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbr_hash_check(i, true);
+	}
+
+	/* Removing a neighbor in the middle of a chain keeps the others */
+	nbr_hash_host(CONFIG_NET_IPV6_MAX_NEIGHBORS / 2, &addr, &llstorage,
+		      &lladdr);
+	zassert_true(net_ipv6_nbr_rm(TEST_NET_IF, &addr),
+		     "Cannot remove neighbor");
+
+	for (i = 1; i <= CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbr_hash_check(i, i != CONFIG_NET_IPV6_MAX_NEIGHBORS / 2);
+	}
+
+	nbr_hash_add(0);
+	nbr_hash_check(0, true);
+
+	for (i = 0; i <= CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbr_hash_host(i, &addr, &llstorage, &lladdr);
+		(void)net_ipv6_nbr_rm(TEST_NET_IF, &addr);
+	}
+
+	nbr_hash_check(0, false);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(test_ipv6_fn,
@@ -1532,7 +1669,8 @@ void test_main(void)
 			 ztest_unit_test(test_dst_org_scope_mcast_recv),
 			 ztest_unit_test(test_dst_unknown_group_mcast_recv),
 			 ztest_unit_test(test_dst_unjoined_group_mcast_recv),
-			 ztest_unit_test(test_dst_is_other_iface_mcast_recv)
+			 ztest_unit_test(test_dst_is_other_iface_mcast_recv),
+			 ztest_unit_test(test_nbr_hash)
 			 );
 	ztest_run_test_suite(test_ipv6_fn);
 }
@@ -0,0 +1,636 @@
+/* main.c - CoAP server engine tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <string.h>
+
+#include <zephyr/net/socket.h>
+#include <zephyr/net/coap_server.h>
+
+#define SERVER_PORT	5683
+#define SERVER_HOST	"192.0.2.1"
+
+#define RECV_TIMEOUT_MS	500
+
+#define BIG_SIZE	300
+#define UPLOAD_SIZE	100
+
+#define FANOUT_CLIENTS	8
+
+static uint8_t big[BIG_SIZE];
+static uint8_t upload[UPLOAD_SIZE];
+static size_t upload_len;
+static bool upload_done;
+static int temperature = 21;
+
+static uint8_t recv_buf[CONFIG_COAP_SERVER_MESSAGE_SIZE];
+
+static int temp_get(struct coap_server_resource *resource,
+		    const struct coap_packet *request, size_t offset,
+		    uint8_t *buf, size_t len, bool *more)
+{
+	return snprintk(buf, len, "%d", temperature);
+}
+
+static int big_get(struct coap_server_resource *resource,
+		   const struct coap_packet *request, size_t offset,
+		   uint8_t *buf, size_t len, bool *more)
+{
+	if (offset >= sizeof(big)) {
+		return 0;
+	}
+
+	len = MIN(len, sizeof(big) - offset);
+	memcpy(buf, &big[offset], len);
+	*more = offset + len < sizeof(big);
+
+	return len;
+}
+
+static int upload_put(struct coap_server_resource *resource,
+		      const struct coap_packet *request, size_t offset,
+		      const uint8_t *data, size_t len, bool last)
+{
+	if (offset + len > sizeof(upload)) {
+		return COAP_RESPONSE_CODE_REQUEST_TOO_LARGE;
+	}
+
+	memcpy(&upload[offset], data, len);
+	upload_len = offset + len;
+	upload_done = last;
+
+	return 0;
+}
+
+static const char * const temp_path[] = { "sensors", "temp", NULL };
+static const char * const big_path[] = { "big", NULL };
+static const char * const upload_path[] = { "upload", NULL };
+
+static struct coap_server_resource resources[] = {
+	{
+		.path = temp_path,
+		.get = temp_get,
+		.content_format = COAP_CONTENT_FORMAT_TEXT_PLAIN,
+		.observable = true,
+	},
+	{
+		.path = big_path,
+		.get = big_get,
+		.content_format = COAP_CONTENT_FORMAT_APP_OCTET_STREAM,
+	},
+	{
+		.path = upload_path,
+		.put = upload_put,
+		.content_format = COAP_CONTENT_FORMAT_APP_OCTET_STREAM,
+	},
+};
+
+static struct coap_server_observer observers[FANOUT_CLIENTS + 2];
+static struct coap_server_pending pendings[FANOUT_CLIENTS + 2];
+
+static const struct coap_server_config config = {
+	.resources = resources,
+	.resource_count = ARRAY_SIZE(resources),
+	.observers = observers,
+	.observer_count = ARRAY_SIZE(observers),
+	.pendings = pendings,
+	.pending_count = ARRAY_SIZE(pendings),
+	.family = AF_INET,
+	.port = SERVER_PORT,
+};
+
+static struct coap_server server;
+
+static void server_addr(struct sockaddr_in *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(SERVER_PORT);
+	zsock_inet_pton(AF_INET, SERVER_HOST, &addr->sin_addr);
+}
+
+static int client_socket(void)
+{
+	struct sockaddr_in addr;
+	int sock;
+
+	server_addr(&addr);
+
+	sock = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sock >= 0, "Cannot create socket (%d)", errno);
+
+	zassert_equal(zsock_connect(sock, (struct sockaddr *)&addr,
+				    sizeof(addr)), 0,
+		      "Cannot connect (%d)", errno);
+
+	return sock;
+}
+
+static void send_packet(int sock, struct coap_packet *cpkt)
+{
+	zassert_equal(zsock_send(sock, cpkt->data, cpkt->offset, 0),
+		      cpkt->offset, "Cannot send (%d)", errno);
+}
+
+/* Receive a message, return false if none is received in time */
+static bool recv_packet(int sock, struct coap_packet *cpkt, int timeout)
+{
+	struct zsock_pollfd fds = {
+		.fd = sock,
+		.events = ZSOCK_POLLIN,
+	};
+	ssize_t len;
+
+	if (zsock_poll(&fds, 1, timeout) <= 0) {
+		return false;
+	}
+
+	len = zsock_recv(sock, recv_buf, sizeof(recv_buf), 0);
+	zassert_true(len > 0, "Cannot receive (%d)", errno);
+
+	zassert_equal(coap_packet_parse(cpkt, recv_buf, len, NULL, 0), 0,
+		      "Invalid message");
+
+	return true;
+}
+
+static void request_header_init(struct coap_packet *cpkt, uint8_t *buf,
+				size_t len, uint8_t type, uint8_t method)
+{
+	uint8_t *token = coap_next_token();
+
+	zassert_equal(coap_packet_init(cpkt, buf, len, COAP_VERSION_1, type,
+				       COAP_TOKEN_MAX_LEN, token, method,
+				       coap_next_id()), 0,
+		      "Cannot init request");
+}
+
+static void append_path(struct coap_packet *cpkt, const char * const *path)
+{
+	for (; *path; path++) {
+		zassert_equal(coap_packet_append_option(cpkt,
+							COAP_OPTION_URI_PATH,
+							*path, strlen(*path)),
+			      0, "Cannot append path");
+	}
+}
+
+static void request_init(struct coap_packet *cpkt, uint8_t *buf,
+			 size_t len, uint8_t type, uint8_t method,
+			 const char * const *path)
+{
+	request_header_init(cpkt, buf, len, type, method);
+	append_path(cpkt, path);
+}
+
+static void check_response(const struct coap_packet *request,
+			   const struct coap_packet *response, uint8_t type,
+			   uint8_t code)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t resp_token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+
+	zassert_equal(coap_header_get_type(response), type, "Wrong type");
+	zassert_equal(coap_header_get_code(response), code,
+		      "Wrong code %u", coap_header_get_code(response));
+
+	if (type == COAP_TYPE_ACK) {
+		zassert_equal(coap_header_get_id(response),
+			      coap_header_get_id(request), "Wrong id");
+	}
+
+	tkl = coap_header_get_token(request, token);
+	zassert_equal(coap_header_get_token(response, resp_token), tkl,
+		      "Wrong token length");
+	zassert_mem_equal(token, resp_token, tkl, "Wrong token");
+}
+
+static void exchange(int sock, struct coap_packet *request,
+		     struct coap_packet *response, uint8_t code)
+{
+	uint8_t type = coap_header_get_type(request) == COAP_TYPE_CON ?
+		       COAP_TYPE_ACK : COAP_TYPE_NON_CON;
+
+	send_packet(sock, request);
+	zassert_true(recv_packet(sock, response, RECV_TIMEOUT_MS),
+		     "No response");
+	check_response(request, response, type, code);
+}
+
+static void check_payload(const struct coap_packet *cpkt, const void *data,
+			  size_t len)
+{
+	const uint8_t *payload;
+	uint16_t payload_len;
+
+	payload = coap_packet_get_payload(cpkt, &payload_len);
+	zassert_equal(payload_len, len, "Wrong payload length %u",
+		      payload_len);
+	zassert_mem_equal(payload, data, len, "Wrong payload");
+}
+
+static void send_empty(int sock, uint8_t type, uint16_t id)
+{
+	struct coap_packet cpkt;
+	uint8_t buf[4];
+
+	zassert_equal(coap_packet_init(&cpkt, buf, sizeof(buf),
+				       COAP_VERSION_1, type, 0, NULL,
+				       COAP_CODE_EMPTY, id), 0,
+		      "Cannot init message");
+	send_packet(sock, &cpkt);
+}
+
+/* Register to the temperature resource, return the observe value */
+static int observe(int sock, int value)
+{
+	struct coap_packet request, response;
+	uint8_t buf[64];
+
+	/* Observe comes before Uri-Path in option order */
+	request_header_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+			    COAP_METHOD_GET);
+	zassert_equal(coap_append_option_int(&request, COAP_OPTION_OBSERVE,
+					     value), 0,
+		      "Cannot append observe");
+	append_path(&request, temp_path);
+
+	exchange(sock, &request, &response, COAP_RESPONSE_CODE_CONTENT);
+
+	return coap_get_option_int(&response, COAP_OPTION_OBSERVE);
+}
+
+ZTEST(coap_server, test_get)
+{
+	struct coap_packet request, response;
+	uint8_t buf[64];
+	int sock = client_socket();
+
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_GET, temp_path);
+	exchange(sock, &request, &response, COAP_RESPONSE_CODE_CONTENT);
+	check_payload(&response, "21", 2);
+	zassert_equal(coap_get_option_int(&response,
+					  COAP_OPTION_CONTENT_FORMAT),
+		      COAP_CONTENT_FORMAT_TEXT_PLAIN, "Wrong content format");
+
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_NON_CON,
+		     COAP_METHOD_GET, temp_path);
+	exchange(sock, &request, &response, COAP_RESPONSE_CODE_CONTENT);
+	check_payload(&response, "21", 2);
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(coap_server, test_errors)
+{
+	static const char * const unknown_path[] = { "sensors", NULL };
+	struct coap_packet request, response;
+	uint8_t buf[64];
+	int sock = client_socket();
+
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_GET, unknown_path);
+	exchange(sock, &request, &response, COAP_RESPONSE_CODE_NOT_FOUND);
+
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_POST, temp_path);
+	exchange(sock, &request, &response, COAP_RESPONSE_CODE_NOT_ALLOWED);
+
+	/* CoAP ping */
+	send_empty(sock, COAP_TYPE_CON, 0x1234);
+	zassert_true(recv_packet(sock, &response, RECV_TIMEOUT_MS),
+		     "No response");
+	zassert_equal(coap_header_get_type(&response), COAP_TYPE_RESET,
+		      "Wrong type");
+	zassert_equal(coap_header_get_id(&response), 0x1234, "Wrong id");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(coap_server, test_block2)
+{
+	struct coap_packet request, response;
+	uint8_t data[BIG_SIZE];
+	uint8_t buf[64];
+	const uint8_t *payload;
+	uint16_t payload_len;
+	size_t offset = 0;
+	uint32_t num = 0;
+	int block2;
+	int sock = client_socket();
+
+	do {
+		request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+			     COAP_METHOD_GET, big_path);
+
+		/* Blocks of 32 bytes */
+		zassert_equal(coap_append_option_int(&request,
+						     COAP_OPTION_BLOCK2,
+						     (num << 4) | 1), 0,
+			      "Cannot append block2");
+
+		exchange(sock, &request, &response,
+			 COAP_RESPONSE_CODE_CONTENT);
+
+		block2 = coap_get_option_int(&response, COAP_OPTION_BLOCK2);
+		zassert_true(block2 >= 0, "No block2 option");
+		zassert_equal(GET_BLOCK_NUM(block2), num, "Wrong block");
+		zassert_equal(GET_BLOCK_SIZE(block2), 1, "Wrong block size");
+
+		payload = coap_packet_get_payload(&response, &payload_len);
+		zassert_true(offset + payload_len <= sizeof(data),
+			     "Too much data");
+		memcpy(&data[offset], payload, payload_len);
+		offset += payload_len;
+		num++;
+	} while (GET_MORE(block2));
+
+	zassert_equal(offset, sizeof(big), "Wrong length %zu", offset);
+	zassert_mem_equal(data, big, sizeof(big), "Wrong data");
+
+	/* Without a Block2 option, the server picks its block size */
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_GET, big_path);
+	exchange(sock, &request, &response, COAP_RESPONSE_CODE_CONTENT);
+
+	block2 = coap_get_option_int(&response, COAP_OPTION_BLOCK2);
+	zassert_equal(GET_BLOCK_SIZE(block2), 2, "Wrong block size");
+	zassert_true(GET_MORE(block2), "Block is the last one");
+	check_payload(&response, big, CONFIG_COAP_SERVER_BLOCK_SIZE);
+
+	(void)zsock_close(sock);
+}
+
+static void put_block(int sock, uint32_t num, bool more, uint8_t code)
+{
+	struct coap_packet request, response;
+	uint8_t buf[96];
+	size_t offset = num * 32;
+
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_PUT, upload_path);
+	zassert_equal(coap_append_option_int(&request, COAP_OPTION_BLOCK1,
+					     (num << 4) | (more << 3) | 1), 0,
+		      "Cannot append block1");
+	zassert_equal(coap_packet_append_payload_marker(&request), 0,
+		      "Cannot append marker");
+	zassert_equal(coap_packet_append_payload(
+			      &request, &big[offset],
+			      more ? 32 : UPLOAD_SIZE - offset), 0,
+		      "Cannot append payload");
+
+	exchange(sock, &request, &response, code);
+}
+
+ZTEST(coap_server, test_block1)
+{
+	int sock = client_socket();
+
+	upload_len = 0;
+	upload_done = false;
+
+	put_block(sock, 0, true, COAP_RESPONSE_CODE_CONTINUE);
+
+	/* Block 1 is missing */
+	put_block(sock, 2, true, COAP_RESPONSE_CODE_INCOMPLETE);
+
+	put_block(sock, 1, true, COAP_RESPONSE_CODE_CONTINUE);
+	put_block(sock, 2, true, COAP_RESPONSE_CODE_CONTINUE);
+	zassert_false(upload_done, "Upload complete too early");
+
+	put_block(sock, 3, false, COAP_RESPONSE_CODE_CHANGED);
+	zassert_true(upload_done, "Upload not complete");
+	zassert_equal(upload_len, UPLOAD_SIZE, "Wrong length %zu",
+		      upload_len);
+	zassert_mem_equal(upload, big, UPLOAD_SIZE, "Wrong data");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(coap_server, test_observe)
+{
+	struct coap_packet response;
+	int age, value;
+	int i;
+	int sock = client_socket();
+
+	age = observe(sock, 0);
+	zassert_true(age >= 0, "Not registered");
+
+	for (i = 0; i < CONFIG_COAP_SERVER_OBSERVE_CON_INTERVAL; i++) {
+		temperature++;
+
+		zassert_equal(coap_server_notify(&server, &resources[0]), 1,
+			      "Wrong observer count");
+		zassert_true(recv_packet(sock, &response, RECV_TIMEOUT_MS),
+			     "No notification");
+
+		value = coap_get_option_int(&response, COAP_OPTION_OBSERVE);
+		zassert_true(value > age, "Observe value not increasing");
+		age = value;
+
+		zassert_equal(coap_header_get_code(&response),
+			      COAP_RESPONSE_CODE_CONTENT, "Wrong code");
+		zassert_equal(coap_header_get_type(&response),
+			      i == CONFIG_COAP_SERVER_OBSERVE_CON_INTERVAL - 1 ?
+			      COAP_TYPE_CON : COAP_TYPE_NON_CON,
+			      "Wrong type");
+
+		if (coap_header_get_type(&response) == COAP_TYPE_CON) {
+			send_empty(sock, COAP_TYPE_ACK,
+				   coap_header_get_id(&response));
+		}
+	}
+
+	/* Deregistration */
+	zassert_true(observe(sock, 1) < 0, "Still registered");
+	zassert_equal(coap_server_notify(&server, &resources[0]), 0,
+		      "Observer not removed");
+
+	/* Rejecting a notification ends the observation */
+	(void)observe(sock, 0);
+	zassert_equal(coap_server_notify(&server, &resources[0]), 1,
+		      "Wrong observer count");
+	zassert_true(recv_packet(sock, &response, RECV_TIMEOUT_MS),
+		     "No notification");
+	send_empty(sock, COAP_TYPE_RESET, coap_header_get_id(&response));
+	k_msleep(100);
+
+	zassert_equal(coap_server_notify(&server, &resources[0]), 0,
+		      "Observer not removed");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(coap_server, test_fan_out)
+{
+	struct coap_packet response;
+	int socks[FANOUT_CLIENTS];
+	uint32_t start, elapsed;
+	char value[8];
+	int len;
+	int i;
+
+	for (i = 0; i < FANOUT_CLIENTS; i++) {
+		socks[i] = client_socket();
+		zassert_true(observe(socks[i], 0) >= 0, "Not registered");
+	}
+
+	temperature++;
+	len = snprintk(value, sizeof(value), "%d", temperature);
+
+	start = k_uptime_get_32();
+	zassert_equal(coap_server_notify(&server, &resources[0]),
+		      FANOUT_CLIENTS, "Wrong observer count");
+	elapsed = k_uptime_get_32() - start;
+
+	for (i = 0; i < FANOUT_CLIENTS; i++) {
+		zassert_true(recv_packet(socks[i], &response, RECV_TIMEOUT_MS),
+			     "No notification for client %d", i);
+		check_payload(&response, value, len);
+
+		/* Deregister before the socket goes away */
+		(void)observe(socks[i], 1);
+		(void)zsock_close(socks[i]);
+	}
+
+	TC_PRINT("Notified %d observers in %u ms\n", FANOUT_CLIENTS, elapsed);
+}
+
+struct reply_result {
+	struct k_sem sem;
+	bool response;
+	uint8_t code;
+};
+
+static void reply_cb(const struct coap_packet *response,
+		     const struct sockaddr *from, void *user_data)
+{
+	struct reply_result *result = user_data;
+
+	result->response = response != NULL;
+	result->code = response ? coap_header_get_code(response) : 0;
+
+	k_sem_give(&result->sem);
+}
+
+/* The engine sends a request to a peer socket bound to the same address */
+static int peer_socket(struct sockaddr_in *addr)
+{
+	socklen_t addrlen = sizeof(*addr);
+	struct sockaddr_in server;
+	int sock;
+
+	sock = client_socket();
+
+	zassert_equal(zsock_getsockname(sock, (struct sockaddr *)addr,
+					&addrlen), 0,
+		      "Cannot get address (%d)", errno);
+
+	server_addr(&server);
+	addr->sin_addr = server.sin_addr;
+
+	return sock;
+}
+
+ZTEST(coap_server, test_request)
+{
+	static uint8_t buf[64];
+	struct coap_packet request, received, response;
+	struct reply_result result;
+	struct sockaddr_in addr;
+	uint8_t resp_buf[64];
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+	int sock = peer_socket(&addr);
+
+	k_sem_init(&result.sem, 0, 1);
+
+	/* Separate response */
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_GET, temp_path);
+	zassert_equal(coap_server_request(&server, &request,
+					  (struct sockaddr *)&addr,
+					  sizeof(addr), reply_cb, &result),
+		      0, "Cannot send request");
+
+	zassert_true(recv_packet(sock, &received, RECV_TIMEOUT_MS),
+		     "No request");
+	zassert_equal(coap_header_get_id(&received),
+		      coap_header_get_id(&request), "Wrong id");
+	send_empty(sock, COAP_TYPE_ACK, coap_header_get_id(&received));
+
+	tkl = coap_header_get_token(&received, token);
+	zassert_equal(coap_packet_init(&response, resp_buf, sizeof(resp_buf),
+				       COAP_VERSION_1, COAP_TYPE_CON, tkl,
+				       token, COAP_RESPONSE_CODE_CONTENT,
+				       coap_next_id()), 0,
+		      "Cannot init response");
+	send_packet(sock, &response);
+
+	zassert_true(recv_packet(sock, &received, RECV_TIMEOUT_MS),
+		     "Response not acknowledged");
+	zassert_equal(coap_header_get_type(&received), COAP_TYPE_ACK,
+		      "Wrong type");
+
+	zassert_equal(k_sem_take(&result.sem, K_MSEC(RECV_TIMEOUT_MS)), 0,
+		      "No reply");
+	zassert_true(result.response, "No response");
+	zassert_equal(result.code, COAP_RESPONSE_CODE_CONTENT, "Wrong code");
+
+	/* Retransmission and timeout */
+	request_init(&request, buf, sizeof(buf), COAP_TYPE_CON,
+		     COAP_METHOD_GET, temp_path);
+	zassert_equal(coap_server_request(&server, &request,
+					  (struct sockaddr *)&addr,
+					  sizeof(addr), reply_cb, &result),
+		      0, "Cannot send request");
+
+	zassert_true(recv_packet(sock, &received, RECV_TIMEOUT_MS),
+		     "No request");
+	zassert_true(recv_packet(sock, &received,
+				 CONFIG_COAP_INIT_ACK_TIMEOUT_MS + 500),
+		     "No retransmission");
+	zassert_equal(coap_header_get_id(&received),
+		      coap_header_get_id(&request), "Wrong id");
+
+	zassert_equal(k_sem_take(&result.sem,
+				 K_MSEC(2 * CONFIG_COAP_INIT_ACK_TIMEOUT_MS +
+					500)), 0,
+		      "No reply");
+	zassert_false(result.response, "Unexpected response");
+
+	(void)zsock_close(sock);
+}
+
+static void *coap_server_setup(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(big); i++) {
+		big[i] = i;
+	}
+
+	zassert_equal(coap_server_start(&server, &config), 0,
+		      "Cannot start server");
+
+	return NULL;
+}
+
+static void coap_server_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zassert_equal(coap_server_stop(&server), 0, "Cannot stop server");
+}
+
+ZTEST_SUITE(coap_server, NULL, coap_server_setup, NULL, NULL,
+	    coap_server_teardown);
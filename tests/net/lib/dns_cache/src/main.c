@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/dns_resolve.h>
+#include <dns_pack.h>
+#include <dns_internal.h>
+
+#define NAME		"www.zephyrproject.org"
+#define NAME_ALIAS	"docs.zephyrproject.org"
+#define NAME_NX		"nx.zephyrproject.org"
+
+#define DNS_ID		0x2a2a
+#define TTL_LONG	300
+#define TIMEOUT		1000 /* ms */
+
+/* Longer than the 1 second TTL used by some of the tests */
+#define EXPIRY_WAIT	K_MSEC(1100)
+
+struct lookup_result {
+	int status;
+	int count;
+	struct in_addr addr[CONFIG_DNS_RESOLVER_AI_MAX_ENTRIES];
+};
+
+static struct dns_resolve_context dns_ctx;
+static struct lookup_result validate_result;
+
+static uint8_t msg[512];
+static uint16_t msg_len;
+
+static struct in_addr addr1 = { { { 192, 0, 2, 1 } } };
+static struct in_addr addr2 = { { { 192, 0, 2, 2 } } };
+
+static void lookup_cb(enum dns_resolve_status status,
+		      struct dns_addrinfo *info,
+		      void *user_data)
+{
+	struct lookup_result *result = user_data;
+
+	if (status == DNS_EAI_INPROGRESS && info) {
+		zassert_equal(info->ai_family, AF_INET, "Wrong family");
+
+		if (result->count < ARRAY_SIZE(result->addr)) {
+			net_ipaddr_copy(&result->addr[result->count],
+					&net_sin(&info->ai_addr)->sin_addr);
+		}
+
+		result->count++;
+		return;
+	}
+
+	result->status = status;
+}
+
+static void make_addrinfo(struct dns_addrinfo *info, struct in_addr *addr)
+{
+	memset(info, 0, sizeof(*info));
+
+	info->ai_family = AF_INET;
+	info->ai_addr.sa_family = AF_INET;
+	info->ai_addrlen = sizeof(struct sockaddr_in);
+	net_ipaddr_copy(&net_sin(&info->ai_addr)->sin_addr, addr);
+}
+
+static void put_u16(uint16_t val)
+{
+	UNALIGNED_PUT(htons(val), (uint16_t *)(msg + msg_len));
+	msg_len += sizeof(val);
+}
+
+static void put_u32(uint32_t val)
+{
+	UNALIGNED_PUT(htonl(val), (uint32_t *)(msg + msg_len));
+	msg_len += sizeof(val);
+}
+
+static uint16_t put_name(const char *name)
+{
+	uint16_t len;
+	int ret;
+
+	ret = dns_msg_pack_qname(&len, msg + msg_len, sizeof(msg) - msg_len,
+				 name);
+	zassert_equal(ret, 0, "Cannot pack %s (%d)", name, ret);
+
+	msg_len += len;
+
+	return len;
+}
+
+/* Response header and question, returns the length of the packed name */
+static uint16_t build_response(const char *name, enum dns_query_type type,
+			       int rcode, uint16_t ancount, uint16_t nscount)
+{
+	uint16_t len;
+
+	msg_len = 0U;
+
+	put_u16(DNS_ID);
+	put_u16(0x8180 | rcode); /* QR, RD and RA set */
+	put_u16(1);
+	put_u16(ancount);
+	put_u16(nscount);
+	put_u16(0);
+
+	len = put_name(name);
+	put_u16(type);
+	put_u16(DNS_CLASS_IN);
+
+	return len;
+}
+
+static void add_record_header(uint16_t owner, enum dns_rr_type type,
+			      uint32_t ttl)
+{
+	/* Compressed owner name */
+	put_u16(0xc000 | owner);
+	put_u16(type);
+	put_u16(DNS_CLASS_IN);
+	put_u32(ttl);
+}
+
+static void add_a_record(uint16_t owner, struct in_addr *addr, uint32_t ttl)
+{
+	add_record_header(owner, DNS_RR_TYPE_A, ttl);
+	put_u16(sizeof(*addr));
+
+	memcpy(msg + msg_len, addr, sizeof(*addr));
+	msg_len += sizeof(*addr);
+}
+
+/* Returns the offset of the alias so that other records can refer to it */
+static uint16_t add_cname_record(uint16_t owner, const char *alias,
+				 uint32_t ttl)
+{
+	uint16_t rdlength_pos, pos;
+
+	add_record_header(owner, DNS_RR_TYPE_CNAME, ttl);
+
+	rdlength_pos = msg_len;
+	put_u16(0);
+
+	pos = msg_len;
+	UNALIGNED_PUT(htons(put_name(alias)),
+		      (uint16_t *)(msg + rdlength_pos));
+
+	return pos;
+}
+
+static void add_soa_record(uint16_t owner, uint32_t ttl, uint32_t minimum)
+{
+	add_record_header(owner, DNS_RR_TYPE_SOA, ttl);
+	put_u16(2 + 5 * sizeof(uint32_t));
+
+	/* Root MNAME and RNAME */
+	msg[msg_len++] = 0U;
+	msg[msg_len++] = 0U;
+
+	put_u32(1);	/* SERIAL */
+	put_u32(3600);	/* REFRESH */
+	put_u32(600);	/* RETRY */
+	put_u32(86400);	/* EXPIRE */
+	put_u32(minimum);
+}
+
+static int validate_response(const char *name, enum dns_query_type type,
+			     uint16_t qname_len)
+{
+	struct dns_msg_t dns_msg = { 0 };
+	uint16_t query_hash = 0U;
+	uint16_t dns_id = 0U;
+	int query_idx = -1;
+
+	memset(&validate_result, 0, sizeof(validate_result));
+
+	dns_ctx.queries[0].cb = lookup_cb;
+	dns_ctx.queries[0].user_data = &validate_result;
+	dns_ctx.queries[0].id = DNS_ID;
+	dns_ctx.queries[0].query = name;
+	dns_ctx.queries[0].query_type = type;
+	dns_ctx.queries[0].leader = NULL;
+	dns_ctx.queries[0].cname_ttl = UINT32_MAX;
+
+	/* Packed name and query type, like dns_write() does */
+	dns_ctx.queries[0].query_hash =
+		crc16_ansi(msg + DNS_MSG_HEADER_SIZE, qname_len + 2);
+	dns_ctx.state = DNS_RESOLVE_CONTEXT_ACTIVE;
+
+	dns_msg.msg = msg;
+	dns_msg.msg_size = msg_len;
+
+	return dns_validate_msg(&dns_ctx, &dns_msg, &dns_id, &query_idx, NULL,
+				&query_hash);
+}
+
+static int cache_find(const char *name, enum dns_query_type type)
+{
+	struct dns_addrinfo info[CONFIG_DNS_RESOLVER_AI_MAX_ENTRIES];
+
+	return dns_cache_find(name, type, info, ARRAY_SIZE(info));
+}
+
+static void cache_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	dns_resolve_cache_flush();
+}
+
+ZTEST(dns_cache, test_cache_entries)
+{
+	struct dns_addrinfo info1, info2;
+	char long_name[CONFIG_DNS_RESOLVER_CACHE_NAME_LEN + 2];
+	int ret;
+
+	make_addrinfo(&info1, &addr1);
+	make_addrinfo(&info2, &addr2);
+
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info1, TTL_LONG),
+		      0, "Cannot add entry");
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info2, TTL_LONG),
+		      0, "Cannot add entry");
+
+	/* The same address again only refreshes the entry */
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info1, TTL_LONG),
+		      0, "Cannot add entry");
+
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 2,
+		      "Wrong number of addresses");
+	zassert_equal(cache_find("WWW.ZephyrProject.org", DNS_QUERY_TYPE_A), 2,
+		      "Name compare is case sensitive");
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_AAAA), 0,
+		      "Found address of wrong type");
+
+	/* Negative answer replaces the addresses and vice versa */
+	ret = dns_cache_add_negative(NAME, DNS_QUERY_TYPE_A, DNS_EAI_NODATA,
+				     TTL_LONG);
+	zassert_equal(ret, 0, "Cannot add negative entry");
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), DNS_EAI_NODATA,
+		      "Negative answer not found");
+
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info2, TTL_LONG),
+		      0, "Cannot add entry");
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 1,
+		      "Negative answer not replaced");
+
+	/* Zero TTL answers are not cached */
+	zassert_equal(dns_cache_add(NAME_NX, DNS_QUERY_TYPE_A, &info1, 0), 0,
+		      "Zero TTL not accepted");
+	zassert_equal(cache_find(NAME_NX, DNS_QUERY_TYPE_A), 0,
+		      "Zero TTL answer cached");
+
+	memset(long_name, 'a', sizeof(long_name) - 1);
+	long_name[sizeof(long_name) - 1] = '\0';
+
+	zassert_equal(dns_cache_add(long_name, DNS_QUERY_TYPE_A, &info1,
+				    TTL_LONG), -ENAMETOOLONG,
+		      "Too long name accepted");
+}
+
+ZTEST(dns_cache, test_cache_expiry)
+{
+	struct dns_addrinfo info;
+
+	make_addrinfo(&info, &addr1);
+
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info, 1), 0,
+		      "Cannot add entry");
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 1,
+		      "Entry not found");
+
+	k_sleep(EXPIRY_WAIT);
+
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 0,
+		      "Entry did not expire");
+}
+
+ZTEST(dns_cache, test_cache_eviction)
+{
+	struct dns_resolve_cache_stats before, after;
+	struct dns_addrinfo info;
+	char name[16];
+	int i;
+
+	make_addrinfo(&info, &addr1);
+
+	dns_resolve_cache_stats_get(&before);
+	zassert_equal(before.entries, 0, "Cache not empty");
+
+	for (i = 0; i <= CONFIG_DNS_RESOLVER_CACHE_MAX_ENTRIES; i++) {
+		snprintk(name, sizeof(name), "host%d.test", i);
+
+		zassert_equal(dns_cache_add(name, DNS_QUERY_TYPE_A, &info,
+					    TTL_LONG + i), 0,
+			      "Cannot add entry %d", i);
+	}
+
+	dns_resolve_cache_stats_get(&after);
+	zassert_equal(after.entries, after.size, "Cache not full");
+	zassert_equal(after.evictions, before.evictions + 1,
+		      "Wrong number of evictions");
+
+	/* The entry expiring first was replaced */
+	zassert_equal(cache_find("host0.test", DNS_QUERY_TYPE_A), 0,
+		      "Wrong entry evicted");
+	zassert_equal(cache_find("host1.test", DNS_QUERY_TYPE_A), 1,
+		      "Wrong entry evicted");
+}
+
+ZTEST(dns_cache, test_cache_lookup)
+{
+	struct dns_resolve_cache_stats before, after;
+	struct lookup_result result = { 0 };
+	struct dns_addrinfo info;
+	uint16_t dns_id = 0U;
+	int ret;
+
+	dns_resolve_cache_stats_get(&before);
+
+	make_addrinfo(&info, &addr1);
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info, TTL_LONG),
+		      0, "Cannot add entry");
+	make_addrinfo(&info, &addr2);
+	zassert_equal(dns_cache_add(NAME, DNS_QUERY_TYPE_A, &info, TTL_LONG),
+		      0, "Cannot add entry");
+
+	/* Cached answers are given before dns_resolve_name() returns */
+	ret = dns_resolve_name(&dns_ctx, NAME, DNS_QUERY_TYPE_A, &dns_id,
+			       lookup_cb, &result, TIMEOUT);
+	zassert_equal(ret, 0, "Lookup failed (%d)", ret);
+	/* 0 is the id of the mDNS queries, and there is nothing to cancel */
+	zassert_not_equal(dns_id, 0, "Cached lookup has the mDNS id");
+	zassert_equal(dns_resolve_cancel(&dns_ctx, dns_id), -ENOENT,
+		      "Cancelled a cached lookup");
+	zassert_equal(result.status, DNS_EAI_ALLDONE, "Lookup not done");
+	zassert_equal(result.count, 2, "Wrong number of addresses");
+	zassert_true(net_ipv4_addr_cmp(&result.addr[0], &addr1) ||
+		     net_ipv4_addr_cmp(&result.addr[1], &addr1),
+		     "Address missing");
+
+	ret = dns_cache_add_negative(NAME_NX, DNS_QUERY_TYPE_A, DNS_EAI_NODATA,
+				     TTL_LONG);
+	zassert_equal(ret, 0, "Cannot add negative entry");
+
+	memset(&result, 0, sizeof(result));
+
+	ret = dns_resolve_name(&dns_ctx, NAME_NX, DNS_QUERY_TYPE_A, NULL,
+			       lookup_cb, &result, TIMEOUT);
+	zassert_equal(ret, 0, "Lookup failed (%d)", ret);
+	zassert_equal(result.status, DNS_EAI_NODATA, "Wrong negative status");
+	zassert_equal(result.count, 0, "Address for negative answer");
+
+	dns_resolve_cache_stats_get(&after);
+	zassert_equal(after.hits, before.hits + 1, "Wrong number of hits");
+	zassert_equal(after.negative_hits, before.negative_hits + 1,
+		      "Wrong number of negative hits");
+}
+
+ZTEST(dns_cache, test_cache_response)
+{
+	uint16_t len;
+	int ret;
+
+	len = build_response(NAME, DNS_QUERY_TYPE_A, DNS_HEADER_NOERROR, 2, 0);
+	add_a_record(DNS_MSG_HEADER_SIZE, &addr1, TTL_LONG);
+	add_a_record(DNS_MSG_HEADER_SIZE, &addr2, TTL_LONG);
+
+	ret = validate_response(NAME, DNS_QUERY_TYPE_A, len);
+	zassert_equal(ret, DNS_EAI_ALLDONE, "Invalid response (%d)", ret);
+	zassert_equal(validate_result.count, 2, "Wrong number of addresses");
+
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 2,
+		      "Answer not cached");
+}
+
+ZTEST(dns_cache, test_cache_cname_ttl)
+{
+	uint16_t len, alias;
+	int ret;
+
+	/* The address is valid longer than the alias leading to it */
+	len = build_response(NAME, DNS_QUERY_TYPE_A, DNS_HEADER_NOERROR, 2, 0);
+	alias = add_cname_record(DNS_MSG_HEADER_SIZE, NAME_ALIAS, 1);
+	add_a_record(alias, &addr1, TTL_LONG);
+
+	ret = validate_response(NAME, DNS_QUERY_TYPE_A, len);
+	zassert_equal(ret, DNS_EAI_ALLDONE, "Invalid response (%d)", ret);
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 1,
+		      "Answer not cached");
+
+	k_sleep(EXPIRY_WAIT);
+
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_A), 0,
+		      "Answer outlived the alias");
+}
+
+ZTEST(dns_cache, test_cache_negative_response)
+{
+	uint16_t len;
+	int ret;
+
+	/* Name error with SOA, cached for the SOA MINIMUM */
+	len = build_response(NAME_NX, DNS_QUERY_TYPE_A, DNS_HEADER_NAMEERROR,
+			     0, 1);
+	add_soa_record(DNS_MSG_HEADER_SIZE, 900, 1);
+
+	ret = validate_response(NAME_NX, DNS_QUERY_TYPE_A, len);
+	zassert_equal(ret, DNS_EAI_NODATA, "Invalid response (%d)", ret);
+	zassert_equal(cache_find(NAME_NX, DNS_QUERY_TYPE_A), DNS_EAI_NODATA,
+		      "Negative answer not cached");
+
+	k_sleep(EXPIRY_WAIT);
+
+	zassert_equal(cache_find(NAME_NX, DNS_QUERY_TYPE_A), 0,
+		      "SOA MINIMUM not used");
+
+	/* No data without SOA, cached for the default time */
+	len = build_response(NAME, DNS_QUERY_TYPE_AAAA, DNS_HEADER_NOERROR,
+			     0, 0);
+
+	ret = validate_response(NAME, DNS_QUERY_TYPE_AAAA, len);
+	zassert_equal(ret, DNS_EAI_NODATA, "Invalid response (%d)", ret);
+	zassert_equal(cache_find(NAME, DNS_QUERY_TYPE_AAAA), DNS_EAI_NODATA,
+		      "Negative answer not cached");
+
+	/* Server failures are not cached */
+	len = build_response(NAME_NX, DNS_QUERY_TYPE_AAAA,
+			     DNS_HEADER_SERVERFAILURE, 0, 0);
+
+	(void)validate_response(NAME_NX, DNS_QUERY_TYPE_AAAA, len);
+	zassert_equal(cache_find(NAME_NX, DNS_QUERY_TYPE_AAAA), 0,
+		      "Server failure cached");
+}
+
+ZTEST_SUITE(dns_cache, NULL, NULL, cache_before, NULL, NULL);
@@ -0,0 +1,563 @@
+/* main.c - HTTP client keep-alive, pipelining and chunked body tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/net/socket.h>
+#include <zephyr/net/http_client.h>
+
+#define SERVER_PORT	8080
+#define SERVER_HOST	"192.0.2.1"
+
+#define TIMEOUT		5000
+#define RECV_BUF_SIZE	256
+#define BIG_BODY_SIZE	1000
+#define PIPELINE_DEPTH	4
+
+#define BENCH_REQS	50
+
+/* Server stand-in, handles one connection at a time */
+struct server {
+	char buf[1024];
+	size_t len;
+
+	/* Decoded chunked request body */
+	char upload[128];
+	size_t upload_len;
+	int chunks;
+
+	int accepts;
+	int requests;
+};
+
+static struct server server;
+static int server_sock = -1;
+
+K_THREAD_STACK_DEFINE(server_stack, 2048);
+static struct k_thread server_thread;
+
+struct test_req {
+	struct http_request req;
+
+	char body[BIG_BODY_SIZE + 1];
+	size_t body_len;
+	int more;
+	int final;
+	uint16_t status;
+};
+
+static uint8_t recv_buf[RECV_BUF_SIZE];
+static struct test_req test_reqs[PIPELINE_DEPTH];
+
+static struct sockaddr_in server_addr;
+
+static const struct http_client_endpoint endpoint = {
+	.addr = (const struct sockaddr *)&server_addr,
+	.addrlen = sizeof(server_addr),
+	.host = SERVER_HOST,
+};
+
+static bool server_recv(int sock)
+{
+	int ret;
+
+	ret = zsock_recv(sock, server.buf + server.len,
+			 sizeof(server.buf) - server.len - 1, 0);
+	if (ret <= 0) {
+		return false;
+	}
+
+	server.len += ret;
+	server.buf[server.len] = '\0';
+
+	return true;
+}
+
+static char *server_line_end(size_t pos)
+{
+	return strstr(server.buf + pos, "\r\n");
+}
+
+/* Returns the length of the decoded chunked body, -1 if the connection was
+ * closed before the end of the body.
+ */
+static ssize_t server_recv_chunked(int sock, size_t pos)
+{
+	unsigned long size;
+	char *end;
+
+	while (true) {
+		while ((end = server_line_end(pos)) == NULL) {
+			if (!server_recv(sock)) {
+				return -1;
+			}
+		}
+
+		size = strtoul(server.buf + pos, NULL, 16);
+		pos = end - server.buf + 2;
+
+		while (server.len < pos + size + 2) {
+			if (!server_recv(sock)) {
+				return -1;
+			}
+		}
+
+		if (size == 0) {
+			/* Empty trailer */
+			return pos + 2;
+		}
+
+		zassert_true(server.upload_len + size <= sizeof(server.upload),
+			     "Upload too long");
+
+		memcpy(server.upload + server.upload_len, server.buf + pos,
+		       size);
+		server.upload_len += size;
+		server.chunks++;
+
+		pos += size + 2;
+	}
+}
+
+static void server_send(int sock, const char *path)
+{
+	static char body[BIG_BODY_SIZE];
+	char header[128];
+	const char *connection = "keep-alive";
+	size_t body_len;
+	int i;
+
+	if (strcmp(path, "/big") == 0) {
+		for (i = 0; i < BIG_BODY_SIZE; i++) {
+			body[i] = 'a' + i % 26;
+		}
+
+		body_len = BIG_BODY_SIZE;
+	} else {
+		body_len = snprintk(body, sizeof(body), "ok %s %d", path,
+				    server.requests);
+	}
+
+	if (strcmp(path, "/close") == 0) {
+		connection = "close";
+	}
+
+	snprintk(header, sizeof(header),
+		 "HTTP/1.1 200 OK\r\n"
+		 "Content-Length: %zu\r\n"
+		 "Connection: %s\r\n\r\n", body_len, connection);
+
+	zassert_true(zsock_send(sock, header, strlen(header), 0) > 0,
+		     "Cannot send header");
+	zassert_true(zsock_send(sock, body, body_len, 0) > 0,
+		     "Cannot send body");
+}
+
+static void server_handle(int sock)
+{
+	char path[32];
+	char *end, *start, *chunked;
+	ssize_t consumed;
+
+	server.len = 0;
+	server.buf[0] = '\0';
+
+	while (true) {
+		while ((end = strstr(server.buf, "\r\n\r\n")) == NULL) {
+			if (!server_recv(sock)) {
+				return;
+			}
+		}
+
+		consumed = end - server.buf + 4;
+
+		start = strchr(server.buf, ' ') + 1;
+		end = strchr(start, ' ');
+		zassert_true(end - start < sizeof(path), "Path too long");
+		memcpy(path, start, end - start);
+		path[end - start] = '\0';
+
+		chunked = strstr(server.buf, "Transfer-Encoding: chunked");
+		if (chunked != NULL && chunked < server.buf + consumed) {
+			consumed = server_recv_chunked(sock, consumed);
+			if (consumed < 0) {
+				return;
+			}
+		}
+
+		server.requests++;
+		server_send(sock, path);
+
+		memmove(server.buf, server.buf + consumed, server.len - consumed);
+		server.len -= consumed;
+		server.buf[server.len] = '\0';
+
+		if (strcmp(path, "/close") == 0 || strcmp(path, "/drop") == 0) {
+			return;
+		}
+	}
+}
+
+static void server_thread_fn(void *p1, void *p2, void *p3)
+{
+	int sock;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		sock = zsock_accept(server_sock, NULL, NULL);
+		if (sock < 0) {
+			continue;
+		}
+
+		server.accepts++;
+		server_handle(sock);
+
+		(void)zsock_close(sock);
+	}
+}
+
+static void response_cb(struct http_response *rsp,
+			enum http_final_call final_data,
+			void *user_data)
+{
+	struct test_req *t = CONTAINER_OF(rsp, struct test_req,
+					  req.internal.response);
+
+	if (rsp->body_frag_start && rsp->body_frag_len > 0) {
+		zassert_true(t->body_len + rsp->body_frag_len < sizeof(t->body),
+			     "Response too long");
+
+		memcpy(t->body + t->body_len, rsp->body_frag_start,
+		       rsp->body_frag_len);
+		t->body_len += rsp->body_frag_len;
+		t->body[t->body_len] = '\0';
+	}
+
+	if (final_data == HTTP_DATA_MORE) {
+		t->more++;
+	} else {
+		t->final++;
+		t->status = rsp->http_status_code;
+	}
+}
+
+static struct http_request *test_req_init(struct test_req *t, const char *url)
+{
+	memset(t, 0, sizeof(*t));
+
+	t->req.method = HTTP_GET;
+	t->req.url = url;
+	t->req.host = SERVER_HOST;
+	t->req.protocol = "HTTP/1.1";
+	t->req.response = response_cb;
+	t->req.recv_buf = recv_buf;
+	t->req.recv_buf_len = sizeof(recv_buf);
+
+	return &t->req;
+}
+
+static int request(int sock, struct test_req *t, const char *url)
+{
+	return http_client_req(sock, test_req_init(t, url), TIMEOUT, NULL);
+}
+
+static int connect_new(void)
+{
+	int sock;
+
+	sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(sock >= 0, "Cannot create socket (%d)", errno);
+
+	zassert_equal(zsock_connect(sock, (struct sockaddr *)&server_addr,
+				    sizeof(server_addr)), 0,
+		      "Cannot connect (%d)", errno);
+
+	return sock;
+}
+
+static int pooled_request(struct test_req *t, const char *url)
+{
+	int sock;
+	int ret;
+
+	sock = http_client_pool_get(&endpoint);
+	zassert_true(sock >= 0, "Cannot get connection (%d)", sock);
+
+	ret = request(sock, t, url);
+	http_client_pool_put(sock, &t->req);
+
+	return ret;
+}
+
+ZTEST(http_client, test_pool_reuse)
+{
+	struct test_req *t = &test_reqs[0];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		zassert_true(pooled_request(t, "/") > 0, "Request failed");
+		zassert_equal(t->status, 200, "Wrong status %d", t->status);
+		zassert_true(t->req.internal.response.keep_alive,
+			     "Connection not kept alive");
+	}
+
+	zassert_equal(server.accepts, 1, "Connection not reused (%d)",
+		      server.accepts);
+	zassert_equal(server.requests, 3, "Wrong request count");
+	zassert_equal(strcmp(t->body, "ok / 3"), 0, "Wrong body %s", t->body);
+}
+
+ZTEST(http_client, test_pool_close)
+{
+	struct test_req *t = &test_reqs[0];
+
+	/* The server closes the connection after the response */
+	zassert_true(pooled_request(t, "/close") > 0, "Request failed");
+	zassert_false(t->req.internal.response.keep_alive,
+		      "Connection: close not honoured");
+
+	zassert_true(pooled_request(t, "/") > 0, "Request failed");
+	zassert_equal(server.accepts, 2, "Closed connection reused");
+
+	/* The server closes the idle connection after the response */
+	zassert_true(pooled_request(t, "/drop") > 0, "Request failed");
+	zassert_true(t->req.internal.response.keep_alive, "No keep-alive");
+
+	k_msleep(100);
+
+	zassert_true(pooled_request(t, "/") > 0, "Request failed");
+	zassert_equal(t->status, 200, "Wrong status %d", t->status);
+	zassert_equal(server.accepts, 3, "Stale connection reused");
+}
+
+ZTEST(http_client, test_pipeline)
+{
+	static const char * const urls[PIPELINE_DEPTH] = {
+		"/a", "/b", "/big", "/c",
+	};
+	struct http_request *reqs[PIPELINE_DEPTH];
+	char expected[16];
+	int sock;
+	int i;
+
+	for (i = 0; i < PIPELINE_DEPTH; i++) {
+		reqs[i] = test_req_init(&test_reqs[i], urls[i]);
+	}
+
+	sock = http_client_pool_get(&endpoint);
+	zassert_true(sock >= 0, "Cannot get connection (%d)", sock);
+
+	zassert_equal(http_client_req_pipeline(sock, reqs, PIPELINE_DEPTH,
+					       TIMEOUT, NULL),
+		      PIPELINE_DEPTH, "Missing responses");
+
+	http_client_pool_put(sock, reqs[PIPELINE_DEPTH - 1]);
+
+	for (i = 0; i < PIPELINE_DEPTH; i++) {
+		zassert_equal(test_reqs[i].final, 1, "No final callback");
+		zassert_equal(test_reqs[i].status, 200, "Wrong status");
+
+		if (i == 2) {
+			zassert_equal(test_reqs[i].body_len, BIG_BODY_SIZE,
+				      "Wrong body length %zu",
+				      test_reqs[i].body_len);
+			continue;
+		}
+
+		snprintk(expected, sizeof(expected), "ok %s %d", urls[i],
+			 i + 1);
+		zassert_equal(strcmp(test_reqs[i].body, expected), 0,
+			      "Wrong body %s", test_reqs[i].body);
+	}
+
+	zassert_equal(server.accepts, 1, "Requests not pipelined");
+}
+
+static int upload_cb(struct http_request *req, const uint8_t **data,
+		     void *user_data)
+{
+	static const char * const parts[] = {
+		"first,", "second,", "third",
+	};
+	int *part = user_data;
+
+	if (*part == ARRAY_SIZE(parts)) {
+		return 0;
+	}
+
+	*data = (const uint8_t *)parts[*part];
+
+	return strlen(parts[(*part)++]);
+}
+
+ZTEST(http_client, test_chunked_upload)
+{
+	struct test_req *t = &test_reqs[0];
+	struct http_request *req;
+	int part = 0;
+	int sock;
+
+	req = test_req_init(t, "/upload");
+	req->method = HTTP_POST;
+	req->body_cb = upload_cb;
+
+	sock = http_client_pool_get(&endpoint);
+	zassert_true(sock >= 0, "Cannot get connection (%d)", sock);
+
+	zassert_true(http_client_req(sock, req, TIMEOUT, &part) > 0,
+		     "Request failed");
+	http_client_pool_put(sock, req);
+
+	zassert_equal(t->status, 200, "Wrong status %d", t->status);
+	zassert_equal(server.chunks, 3, "Wrong chunk count %d", server.chunks);
+	zassert_equal(server.upload_len, strlen("first,second,third"),
+		      "Wrong upload length");
+	zassert_mem_equal(server.upload, "first,second,third",
+			  server.upload_len, "Wrong upload");
+}
+
+ZTEST(http_client, test_stream_response)
+{
+	struct test_req *t = &test_reqs[0];
+	struct http_request *req;
+	int sock;
+	int i;
+
+	req = test_req_init(t, "/big");
+	req->stream_response = true;
+
+	sock = http_client_pool_get(&endpoint);
+	zassert_true(sock >= 0, "Cannot get connection (%d)", sock);
+
+	zassert_true(http_client_req(sock, req, TIMEOUT, NULL) > 0,
+		     "Request failed");
+	http_client_pool_put(sock, req);
+
+	zassert_equal(t->final, 1, "No final callback");
+	zassert_true(t->more > 0, "Body not streamed");
+	zassert_equal(t->body_len, BIG_BODY_SIZE, "Wrong body length %zu",
+		      t->body_len);
+
+	for (i = 0; i < BIG_BODY_SIZE; i++) {
+		zassert_equal(t->body[i], 'a' + i % 26, "Wrong body at %d", i);
+	}
+}
+
+static void bench_report(const char *mode, int64_t start)
+{
+	int64_t elapsed = MAX(k_uptime_get() - start, 1);
+
+	printk("%s: %d requests in %lld ms, %lld req/s, %d connections\n",
+	       mode, BENCH_REQS, elapsed, BENCH_REQS * MSEC_PER_SEC / elapsed,
+	       server.accepts);
+}
+
+ZTEST(http_client, test_rate)
+{
+	struct http_request *reqs[PIPELINE_DEPTH];
+	struct test_req *t = &test_reqs[0];
+	int64_t start;
+	int sock;
+	int i, j;
+
+	start = k_uptime_get();
+
+	for (i = 0; i < BENCH_REQS; i++) {
+		sock = connect_new();
+		zassert_true(request(sock, t, "/") > 0, "Request failed");
+		(void)zsock_close(sock);
+	}
+
+	bench_report("New connection", start);
+	zassert_equal(server.accepts, BENCH_REQS, "Connections reused");
+
+	server.accepts = 0;
+	start = k_uptime_get();
+
+	for (i = 0; i < BENCH_REQS; i++) {
+		zassert_true(pooled_request(t, "/") > 0, "Request failed");
+	}
+
+	bench_report("Pooled", start);
+	zassert_equal(server.accepts, 1, "Connections not reused");
+
+	server.accepts = 0;
+	start = k_uptime_get();
+
+	sock = http_client_pool_get(&endpoint);
+	zassert_true(sock >= 0, "Cannot get connection (%d)", sock);
+
+	for (i = 0; i < BENCH_REQS; i += PIPELINE_DEPTH) {
+		int count = MIN(PIPELINE_DEPTH, BENCH_REQS - i);
+
+		for (j = 0; j < count; j++) {
+			reqs[j] = test_req_init(&test_reqs[j], "/");
+		}
+
+		zassert_equal(http_client_req_pipeline(sock, reqs, count,
+						       TIMEOUT, NULL),
+			      count, "Missing responses");
+	}
+
+	http_client_pool_put(sock, reqs[0]);
+
+	bench_report("Pipelined", start);
+	zassert_equal(server.accepts, 0, "Connections not reused");
+}
+
+static void *http_client_setup(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(SERVER_PORT),
+	};
+	int ret;
+
+	zsock_inet_pton(AF_INET, SERVER_HOST, &addr.sin_addr);
+	memcpy(&server_addr, &addr, sizeof(server_addr));
+
+	server_sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(server_sock >= 0, "Cannot create socket (%d)", errno);
+
+	ret = zsock_bind(server_sock, (struct sockaddr *)&addr, sizeof(addr));
+	zassert_equal(ret, 0, "Cannot bind (%d)", errno);
+
+	ret = zsock_listen(server_sock, 2);
+	zassert_equal(ret, 0, "Cannot listen (%d)", errno);
+
+	(void)k_thread_create(&server_thread, server_stack,
+			      K_THREAD_STACK_SIZEOF(server_stack),
+			      server_thread_fn, NULL, NULL, NULL,
+			      K_PRIO_PREEMPT(8), 0, K_NO_WAIT);
+
+	return NULL;
+}
+
+static void http_client_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	/* Let the server see the end of the connections of the last test */
+	http_client_pool_flush();
+	k_msleep(50);
+
+	server.accepts = 0;
+	server.requests = 0;
+	server.upload_len = 0;
+	server.chunks = 0;
+}
+
+ZTEST_SUITE(http_client, NULL, http_client_setup, http_client_before, NULL,
+	    NULL);
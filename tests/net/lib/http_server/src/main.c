@@ -0,0 +1,414 @@
+/* main.c - HTTP server tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/net/socket.h>
+#include <zephyr/net/http_server.h>
+
+#define SERVER_PORT	8080
+#define SERVER_HOST	"192.0.2.1"
+
+/* Time without data after which a response is considered complete */
+#define RECV_QUIET_MS	200
+
+#define BIG_SIZE	4000
+
+#if !defined(LOAD_TEST_REQUESTS)
+#define LOAD_TEST_REQUESTS 500
+#endif
+
+#define LOAD_CLIENTS	CONFIG_HTTP_SERVER_MAX_CLIENTS
+
+static const uint8_t index_html[] = "<html>hello</html>";
+static const uint8_t index_html_gz[] = "compressed";
+static uint8_t big[BIG_SIZE];
+
+static char recv_buf[BIG_SIZE + 1024];
+
+static int api_cb(struct http_server_client *client,
+		  const struct http_server_request *req, void *user_data)
+{
+	char body[64];
+	int len;
+
+	len = snprintk(body, sizeof(body), "%s %s %zu",
+		       http_method_str(req->method),
+		       req->query ? req->query : "-", req->body_len);
+
+	return http_server_respond(client, 200, "text/plain", body, len);
+}
+
+static int stream_cb(struct http_server_client *client,
+		     const struct http_server_request *req, void *user_data)
+{
+	int ret;
+
+	ret = http_server_respond_begin(client, 200, "text/plain");
+	if (ret == 0) {
+		ret = http_server_respond_chunk(client, "abc", 3);
+	}
+
+	if (ret == 0) {
+		ret = http_server_respond_chunk(client, "defgh", 5);
+	}
+
+	/* The server ends the body */
+	return ret;
+}
+
+static int fail_cb(struct http_server_client *client,
+		   const struct http_server_request *req, void *user_data)
+{
+	return -EIO;
+}
+
+static const struct http_resource resources[] = {
+	HTTP_RESOURCE_STATIC_GZIP("/", "text/html", index_html,
+				  sizeof(index_html) - 1, index_html_gz,
+				  sizeof(index_html_gz) - 1),
+	HTTP_RESOURCE_STATIC("/big", "application/octet-stream", big,
+			     sizeof(big)),
+	HTTP_RESOURCE_DYNAMIC("/api", api_cb, NULL),
+	HTTP_RESOURCE_DYNAMIC("/stream", stream_cb, NULL),
+	HTTP_RESOURCE_DYNAMIC("/fail", fail_cb, NULL),
+	HTTP_RESOURCE_STATIC("/files/*", "text/plain", (const uint8_t *)"F",
+			     1),
+};
+
+static const struct http_server_config config = {
+	.resources = resources,
+	.resource_count = ARRAY_SIZE(resources),
+	.family = AF_INET,
+	.port = SERVER_PORT,
+};
+
+static struct http_server server;
+
+static int connect_server(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(SERVER_PORT),
+	};
+	int sock;
+
+	zsock_inet_pton(AF_INET, SERVER_HOST, &addr.sin_addr);
+
+	sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(sock >= 0, "Cannot create socket (%d)", errno);
+
+	zassert_equal(zsock_connect(sock, (struct sockaddr *)&addr,
+				    sizeof(addr)), 0,
+		      "Cannot connect (%d)", errno);
+
+	return sock;
+}
+
+static void send_str(int sock, const char *str)
+{
+	zassert_equal(zsock_send(sock, str, strlen(str), 0), strlen(str),
+		      "Cannot send (%d)", errno);
+}
+
+/* Receive until nothing more comes, or until the connection is closed */
+static size_t recv_all(int sock)
+{
+	struct zsock_pollfd fds = {
+		.fd = sock,
+		.events = ZSOCK_POLLIN,
+	};
+	size_t len = 0;
+	int ret;
+
+	while (len < sizeof(recv_buf) - 1 &&
+	       zsock_poll(&fds, 1, RECV_QUIET_MS) > 0) {
+		ret = zsock_recv(sock, recv_buf + len,
+				 sizeof(recv_buf) - 1 - len, 0);
+		if (ret <= 0) {
+			break;
+		}
+
+		len += ret;
+	}
+
+	recv_buf[len] = '\0';
+
+	return len;
+}
+
+static bool connection_closed(int sock)
+{
+	struct zsock_pollfd fds = {
+		.fd = sock,
+		.events = ZSOCK_POLLIN,
+	};
+	char c;
+
+	return zsock_poll(&fds, 1, RECV_QUIET_MS) > 0 &&
+		zsock_recv(sock, &c, 1, 0) == 0;
+}
+
+static const char *request(int sock, const char *req)
+{
+	send_str(sock, req);
+	recv_all(sock);
+
+	return recv_buf;
+}
+
+ZTEST(http_server, test_static)
+{
+	const char *rsp;
+	int sock;
+
+	sock = connect_server();
+
+	rsp = request(sock, "GET / HTTP/1.1\r\nHost: test\r\n\r\n");
+	zassert_not_null(strstr(rsp, "HTTP/1.1 200 OK\r\n"), "%s", rsp);
+	zassert_not_null(strstr(rsp, "Content-Length: 18\r\n"), "%s", rsp);
+	zassert_not_null(strstr(rsp, "Connection: keep-alive\r\n"), "%s", rsp);
+	zassert_not_null(strstr(rsp, "\r\n\r\n<html>hello</html>"), "%s", rsp);
+
+	/* The connection is kept for the next request */
+	rsp = request(sock, "GET /files/a.txt HTTP/1.1\r\n\r\n");
+	zassert_not_null(strstr(rsp, "\r\n\r\nF"), "%s", rsp);
+
+	rsp = request(sock, "HEAD / HTTP/1.1\r\n\r\n");
+	zassert_not_null(strstr(rsp, "Content-Length: 18\r\n"), "%s", rsp);
+	zassert_is_null(strstr(rsp, "<html>"), "Body sent for HEAD");
+
+	send_str(sock, "GET /big HTTP/1.1\r\n\r\n");
+	zassert_equal(recv_all(sock),
+		      strstr(recv_buf, "\r\n\r\n") - recv_buf + 4 + BIG_SIZE,
+		      "Wrong response length");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(http_server, test_gzip)
+{
+	const char *rsp;
+	int sock;
+
+	sock = connect_server();
+
+	/* Header split over several segments */
+	send_str(sock, "GET / HTTP/1.1\r\nAccept-");
+	k_msleep(20);
+	send_str(sock, "Encoding: deflate, gz");
+	k_msleep(20);
+	rsp = request(sock, "ip\r\n\r\n");
+
+	zassert_not_null(strstr(rsp, "Content-Encoding: gzip\r\n"), "%s", rsp);
+	zassert_not_null(strstr(rsp, "\r\n\r\ncompressed"), "%s", rsp);
+
+	rsp = request(sock, "GET / HTTP/1.1\r\nAccept-Encoding: br\r\n\r\n");
+	zassert_is_null(strstr(rsp, "Content-Encoding"), "%s", rsp);
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(http_server, test_dynamic)
+{
+	const char *rsp;
+	int sock;
+
+	sock = connect_server();
+
+	rsp = request(sock, "POST /api?id=3 HTTP/1.1\r\n"
+		      "Content-Length: 5\r\n\r\nhello");
+	zassert_not_null(strstr(rsp, "\r\n\r\nPOST id=3 5"), "%s", rsp);
+
+	rsp = request(sock, "GET /stream HTTP/1.1\r\n\r\n");
+	zassert_not_null(strstr(rsp, "Transfer-Encoding: chunked\r\n"), "%s",
+			 rsp);
+	zassert_not_null(strstr(rsp, "\r\n\r\n3\r\nabc\r\n5\r\ndefgh\r\n"
+				"0\r\n\r\n"), "%s", rsp);
+
+	rsp = request(sock, "GET /fail HTTP/1.1\r\n\r\n");
+	zassert_not_null(strstr(rsp, "HTTP/1.1 500 "), "%s", rsp);
+
+	/* No chunked encoding for HTTP/1.0, the body ends with the
+	 * connection.
+	 */
+	rsp = request(sock, "GET /stream HTTP/1.0\r\n\r\n");
+	zassert_not_null(strstr(rsp, "Connection: close\r\n"), "%s", rsp);
+	zassert_not_null(strstr(rsp, "\r\n\r\nabcdefgh"), "%s", rsp);
+	zassert_true(connection_closed(sock), "Connection not closed");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(http_server, test_pipeline)
+{
+	const char *rsp;
+	const char *a, *b, *c;
+	int sock;
+
+	sock = connect_server();
+
+	rsp = request(sock, "GET /api?n=1 HTTP/1.1\r\n\r\n"
+		      "GET /nothing HTTP/1.1\r\n\r\n"
+		      "GET /api?n=2 HTTP/1.1\r\n\r\n");
+
+	a = strstr(rsp, "GET n=1 0");
+	b = strstr(rsp, "HTTP/1.1 404 ");
+	c = strstr(rsp, "GET n=2 0");
+
+	zassert_true(a != NULL && b != NULL && c != NULL, "%s", rsp);
+	zassert_true(a < b && b < c, "Responses out of order");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(http_server, test_errors)
+{
+	char req[CONFIG_HTTP_SERVER_MAX_URL_LENGTH + 32];
+	const char *rsp;
+	int sock;
+
+	sock = connect_server();
+
+	rsp = request(sock, "DELETE / HTTP/1.1\r\n\r\n");
+	zassert_not_null(strstr(rsp, "HTTP/1.1 405 "), "%s", rsp);
+	zassert_not_null(strstr(rsp, "Allow: GET, HEAD\r\n"), "%s", rsp);
+
+	/* One character longer than the limit */
+	memset(req, 'a', sizeof(req));
+	memcpy(req, "GET /", 5);
+	strcpy(req + 5 + CONFIG_HTTP_SERVER_MAX_URL_LENGTH - 1,
+	       " HTTP/1.1\r\n\r\n");
+	rsp = request(sock, req);
+	zassert_not_null(strstr(rsp, "HTTP/1.1 414 "), "%s", rsp);
+	zassert_true(connection_closed(sock), "Connection not closed");
+
+	(void)zsock_close(sock);
+
+	sock = connect_server();
+
+	rsp = request(sock, "NOT HTTP\r\n\r\n");
+	zassert_not_null(strstr(rsp, "HTTP/1.1 400 "), "%s", rsp);
+	zassert_true(connection_closed(sock), "Connection not closed");
+
+	(void)zsock_close(sock);
+}
+
+ZTEST(http_server, test_idle_timeout)
+{
+	int sock;
+
+	sock = connect_server();
+
+	k_msleep(CONFIG_HTTP_SERVER_IDLE_TIMEOUT + 600);
+
+	zassert_true(connection_closed(sock), "Idle connection not closed");
+
+	(void)zsock_close(sock);
+}
+
+/* Keep every connection the server can serve busy with keep-alive requests,
+ * and report the request rate.
+ */
+ZTEST(http_server, test_load)
+{
+	static const char req[] = "GET / HTTP/1.1\r\n\r\n";
+	struct zsock_pollfd fds[LOAD_CLIENTS];
+	size_t received[LOAD_CLIENTS];
+	size_t rsp_len;
+	int64_t start, elapsed;
+	int sent = 0;
+	int done = 0;
+	int ret;
+	int i;
+
+	/* Length of one response */
+	fds[0].fd = connect_server();
+	request(fds[0].fd, req);
+	rsp_len = strlen(recv_buf);
+	zassert_true(rsp_len > 0, "No response");
+	(void)zsock_close(fds[0].fd);
+
+	for (i = 0; i < LOAD_CLIENTS; i++) {
+		fds[i].fd = connect_server();
+		fds[i].events = ZSOCK_POLLIN;
+		received[i] = 0;
+	}
+
+	start = k_uptime_get();
+
+	for (i = 0; i < LOAD_CLIENTS; i++) {
+		send_str(fds[i].fd, req);
+		sent++;
+	}
+
+	while (done < LOAD_TEST_REQUESTS) {
+		ret = zsock_poll(fds, LOAD_CLIENTS, 5000);
+		zassert_true(ret > 0, "Server stalled (%d)", ret);
+
+		for (i = 0; i < LOAD_CLIENTS; i++) {
+			if (!(fds[i].revents & ZSOCK_POLLIN)) {
+				continue;
+			}
+
+			ret = zsock_recv(fds[i].fd, recv_buf, sizeof(recv_buf),
+					 0);
+			zassert_true(ret > 0, "Connection closed (%d)", errno);
+
+			received[i] += ret;
+			if (received[i] < rsp_len) {
+				continue;
+			}
+
+			zassert_equal(received[i], rsp_len, "Wrong response");
+			received[i] = 0;
+			done++;
+
+			if (sent < LOAD_TEST_REQUESTS) {
+				send_str(fds[i].fd, req);
+				sent++;
+			}
+		}
+	}
+
+	elapsed = MAX(k_uptime_get() - start, 1);
+
+	printk("%d requests over %d connections in %lld ms, %lld req/s\n",
+	       done, LOAD_CLIENTS, elapsed, done * MSEC_PER_SEC / elapsed);
+
+	for (i = 0; i < LOAD_CLIENTS; i++) {
+		(void)zsock_close(fds[i].fd);
+	}
+}
+
+static void *http_server_setup(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(big); i++) {
+		big[i] = i;
+	}
+
+	zassert_equal(http_server_start(&server, &config), 0,
+		      "Cannot start server");
+
+	return NULL;
+}
+
+static void http_server_teardown(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zassert_equal(http_server_stop(&server), 0, "Cannot stop server");
+}
+
+ZTEST_SUITE(http_server, NULL, http_server_setup, NULL, NULL,
+	    http_server_teardown);
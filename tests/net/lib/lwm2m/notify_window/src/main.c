@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+
+#include "lwm2m_engine.h"
+#include "lwm2m_message_handling.h"
+#include "lwm2m_observation.h"
+
+#define TEST_OBJ_ID 0xFFFF
+#define TEST_OBJ_INST_ID 0
+
+#define TEST_RES_A 0
+#define TEST_RES_B 1
+#define TEST_RES_C 2
+
+#define TEST_OBJ_RES_MAX_ID 3
+
+#define NOTIFY_WINDOW CONFIG_LWM2M_ENGINE_NOTIFY_WINDOW_MS
+
+static struct lwm2m_engine_obj test_obj;
+
+static struct lwm2m_engine_obj_field test_fields[] = {
+	OBJ_FIELD_DATA(TEST_RES_A, RW, S32),
+	OBJ_FIELD_DATA(TEST_RES_B, RW, S32),
+	OBJ_FIELD_DATA(TEST_RES_C, RW, S32)
+};
+
+static struct lwm2m_engine_obj_inst test_inst;
+static struct lwm2m_engine_res test_res[TEST_OBJ_RES_MAX_ID];
+static struct lwm2m_engine_res_inst test_res_inst[TEST_OBJ_RES_MAX_ID];
+
+static int32_t test_a;
+static int32_t test_b;
+static int32_t test_c;
+
+/* One Observe-Composite of A and B, one single observation of C */
+static struct lwm2m_ctx test_ctx;
+static struct observe_node composite_obs;
+static struct observe_node single_obs;
+static struct lwm2m_obj_path_list composite_paths[2];
+static struct lwm2m_obj_path_list single_path;
+
+static struct lwm2m_engine_obj_inst *test_obj_create(uint16_t obj_inst_id)
+{
+	int i = 0, j = 0;
+
+	init_res_instance(test_res_inst, ARRAY_SIZE(test_res_inst));
+
+	INIT_OBJ_RES_DATA(TEST_RES_A, test_res, i, test_res_inst, j,
+			  &test_a, sizeof(test_a));
+	INIT_OBJ_RES_DATA(TEST_RES_B, test_res, i, test_res_inst, j,
+			  &test_b, sizeof(test_b));
+	INIT_OBJ_RES_DATA(TEST_RES_C, test_res, i, test_res_inst, j,
+			  &test_c, sizeof(test_c));
+
+	test_inst.resources = test_res;
+	test_inst.resource_count = i;
+
+	return &test_inst;
+}
+
+static void test_obj_init(void)
+{
+	struct lwm2m_engine_obj_inst *obj_inst = NULL;
+
+	test_obj.obj_id = TEST_OBJ_ID;
+	test_obj.version_major = 1;
+	test_obj.version_minor = 0;
+	test_obj.is_core = false;
+	test_obj.fields = test_fields;
+	test_obj.field_count = ARRAY_SIZE(test_fields);
+	test_obj.max_instance_count = 1U;
+	test_obj.create_cb = test_obj_create;
+
+	(void)lwm2m_register_obj(&test_obj);
+	(void)lwm2m_create_obj_inst(TEST_OBJ_ID, TEST_OBJ_INST_ID, &obj_inst);
+}
+
+static void path_init(struct lwm2m_obj_path *path, uint16_t res_id)
+{
+	memset(path, 0, sizeof(*path));
+
+	path->obj_id = TEST_OBJ_ID;
+	path->obj_inst_id = TEST_OBJ_INST_ID;
+	path->res_id = res_id;
+	path->level = LWM2M_PATH_LEVEL_RESOURCE;
+}
+
+static void observe_init(struct observe_node *obs, uint8_t token, uint16_t format,
+			 bool composite)
+{
+	memset(obs, 0, sizeof(*obs));
+
+	sys_slist_init(&obs->path_list);
+	obs->token[0] = token;
+	obs->tkl = 1U;
+	obs->format = format;
+	obs->composite = composite;
+
+	sys_slist_append(&test_ctx.observer, &obs->node);
+}
+
+static void test_prepare(void)
+{
+	lwm2m_engine_context_init(&test_ctx);
+	test_ctx.sock_fd = -1;
+
+	observe_init(&composite_obs, 1U, LWM2M_FORMAT_APP_SENML_CBOR, true);
+	path_init(&composite_paths[0].path, TEST_RES_A);
+	sys_slist_append(&composite_obs.path_list, &composite_paths[0].node);
+	path_init(&composite_paths[1].path, TEST_RES_B);
+	sys_slist_append(&composite_obs.path_list, &composite_paths[1].node);
+
+	observe_init(&single_obs, 2U, LWM2M_FORMAT_PLAIN_TEXT, false);
+	path_init(&single_path.path, TEST_RES_C);
+	sys_slist_append(&single_obs.path_list, &single_path.node);
+}
+
+static void test_cleanup(void)
+{
+	struct lwm2m_message *msg;
+
+	while (!sys_slist_is_empty(&test_ctx.pending_sends)) {
+		msg = SYS_SLIST_PEEK_HEAD_CONTAINER(&test_ctx.pending_sends, msg, node);
+		lwm2m_reset_message(msg, true);
+	}
+}
+
+static void notify(uint16_t res_id)
+{
+	struct lwm2m_obj_path path;
+
+	path_init(&path, res_id);
+
+	zassert_true(lwm2m_notify_observer_path(&path) > 0,
+		     "Resource %u not observed", res_id);
+}
+
+static void test_window_coalesces(void)
+{
+	int64_t now = k_uptime_get();
+	int64_t deadline;
+	int64_t next;
+
+	notify(TEST_RES_A);
+
+	deadline = composite_obs.event_timestamp;
+	zassert_true(deadline >= now + NOTIFY_WINDOW, "Notified before the window");
+	zassert_true(composite_obs.resource_update, "Update not pending");
+	zassert_equal(single_obs.event_timestamp, 0, "Wrong observation notified");
+
+	/* Another change in the window does not push the notification */
+	k_msleep(10);
+	notify(TEST_RES_B);
+	zassert_equal(composite_obs.event_timestamp, deadline, "Deadline moved");
+
+	next = lwm2m_engine_check_notifications(&test_ctx, deadline - 1);
+	zassert_equal(next, deadline, "Wrong next notification");
+	zassert_true(sys_slist_is_empty(&test_ctx.pending_sends),
+		     "Notified before the deadline");
+
+	/* Both changes are reported in one notification */
+	next = lwm2m_engine_check_notifications(&test_ctx, deadline);
+	zassert_equal(next, INT64_MAX, "No notification should be left");
+	zassert_false(sys_slist_is_empty(&test_ctx.pending_sends), "No notification");
+	zassert_equal(test_ctx.notify_messages, 1U, "Wrong notification count");
+	zassert_equal(test_ctx.notify_paths, 2U, "Wrong notified path count");
+	zassert_false(composite_obs.resource_update, "Update still pending");
+	zassert_true(composite_obs.active_tx_operation, "Notification not active");
+}
+
+static void test_next_deadline(void)
+{
+	int64_t first, second;
+	int64_t next;
+
+	notify(TEST_RES_A);
+	k_msleep(10);
+	notify(TEST_RES_C);
+
+	first = composite_obs.event_timestamp;
+	second = single_obs.event_timestamp;
+	zassert_true(first < second, "Wrong notification order");
+
+	/* The engine sleeps until the next notification, not polls */
+	next = lwm2m_engine_check_notifications(&test_ctx, first);
+	zassert_equal(next, second, "Wrong next notification");
+	zassert_equal(test_ctx.notify_messages, 1U, "Wrong notification count");
+
+	next = lwm2m_engine_check_notifications(&test_ctx, second);
+	zassert_equal(next, INT64_MAX, "No notification should be left");
+	zassert_equal(test_ctx.notify_messages, 2U, "Wrong notification count");
+	zassert_false(single_obs.resource_update, "Update still pending");
+}
+
+static void test_update_kept_without_message(void)
+{
+	struct lwm2m_message *msgs[CONFIG_LWM2M_ENGINE_MAX_MESSAGES];
+	int64_t deadline;
+	int64_t next;
+	int count = 0;
+	int i;
+
+	notify(TEST_RES_A);
+	deadline = composite_obs.event_timestamp;
+
+	while (count < ARRAY_SIZE(msgs)) {
+		msgs[count] = lwm2m_get_message(&test_ctx);
+		if (!msgs[count]) {
+			break;
+		}
+
+		count++;
+	}
+
+	/* The update stays pending and is retried later */
+	next = lwm2m_engine_check_notifications(&test_ctx, deadline);
+	zassert_true(next > deadline, "Retried without a delay");
+	zassert_true(composite_obs.resource_update, "Update lost");
+	zassert_equal(composite_obs.event_timestamp, deadline, "Deadline moved");
+	zassert_equal(test_ctx.notify_messages, 0U, "Wrong notification count");
+
+	for (i = 0; i < count; i++) {
+		lwm2m_reset_message(msgs[i], true);
+	}
+
+	(void)lwm2m_engine_check_notifications(&test_ctx, next);
+	zassert_false(composite_obs.resource_update, "Update still pending");
+	zassert_equal(test_ctx.notify_messages, 1U, "Wrong notification count");
+}
+
+void test_main(void)
+{
+	test_obj_init();
+
+	/* The notifications are checked by the tests, not the engine */
+	(void)lwm2m_engine_pause();
+	lwm2m_engine_context_init(&test_ctx);
+	test_ctx.sock_fd = -1;
+	zassert_ok(lwm2m_socket_add(&test_ctx), "Cannot add context");
+
+	ztest_test_suite(
+		lwm2m_notify_window,
+		ztest_unit_test_setup_teardown(test_window_coalesces, test_prepare,
+					       test_cleanup),
+		ztest_unit_test_setup_teardown(test_next_deadline, test_prepare,
+					       test_cleanup),
+		ztest_unit_test_setup_teardown(test_update_kept_without_message,
+					       test_prepare, test_cleanup)
+	);
+
+	ztest_run_test_suite(lwm2m_notify_window);
+}
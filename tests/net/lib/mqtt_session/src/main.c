@@ -0,0 +1,493 @@
+/* main.c - MQTT outbound session tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/zephyr.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/net/mqtt.h>
+
+#define CLIENTID	MQTT_UTF8_LITERAL("zephyr")
+#define TOPIC		MQTT_UTF8_LITERAL("sensors")
+
+#define BUFFER_SIZE	128
+#define SESSION_SIZE	256
+#define PAYLOAD_SIZE	16
+
+#define BENCH_MSGS	2000
+
+/* Broker stand-in, connected to the client through the custom transport.
+ * It answers everything the client writes, the answers are read by the
+ * client from resp_buf.
+ */
+struct broker {
+	uint8_t resp_buf[512];
+	size_t resp_len;
+	size_t resp_off;
+
+	/* Acknowledgements not sent yet when hold_acks is set */
+	uint8_t held_buf[256];
+	size_t held_len;
+	bool hold_acks;
+
+	int writes;
+	int publishes;
+	int duplicates;
+	int pubrels;
+	uint16_t last_id;
+	bool in_order;
+};
+
+static struct broker broker;
+
+static uint8_t rx_buffer[BUFFER_SIZE];
+static uint8_t tx_buffer[BUFFER_SIZE];
+static uint8_t session_buffer[SESSION_SIZE];
+static struct mqtt_client client;
+
+static uint8_t payload[PAYLOAD_SIZE];
+static int puback_count;
+static int pubcomp_count;
+static uint16_t next_id;
+
+static void broker_reply(uint8_t *buf, size_t *len, size_t size,
+			 uint8_t type, uint16_t message_id)
+{
+	zassert_true(*len + 4 <= size, "Broker buffer full");
+
+	buf[(*len)++] = type;
+	buf[(*len)++] = sizeof(uint16_t);
+	sys_put_be16(message_id, &buf[*len]);
+	*len += sizeof(uint16_t);
+}
+
+static void broker_ack(uint8_t type, uint16_t message_id)
+{
+	if (broker.hold_acks) {
+		broker_reply(broker.held_buf, &broker.held_len,
+			     sizeof(broker.held_buf), type, message_id);
+	} else {
+		broker_reply(broker.resp_buf, &broker.resp_len,
+			     sizeof(broker.resp_buf), type, message_id);
+	}
+}
+
+static void broker_release_acks(void)
+{
+	zassert_true(broker.resp_len + broker.held_len <=
+		     sizeof(broker.resp_buf), "Broker buffer full");
+
+	memcpy(broker.resp_buf + broker.resp_len, broker.held_buf,
+	       broker.held_len);
+	broker.resp_len += broker.held_len;
+	broker.held_len = 0;
+	broker.hold_acks = false;
+}
+
+static void broker_publish(uint8_t flags, const uint8_t *data)
+{
+	uint8_t qos = (flags >> 1) & 0x03;
+	uint16_t topic_len = sys_get_be16(data);
+	uint16_t message_id;
+
+	zassert_true(qos > 0, "QoS 0 message in the session");
+
+	message_id = sys_get_be16(data + sizeof(uint16_t) + topic_len);
+
+	broker.publishes++;
+
+	if (flags & 0x08) {
+		broker.duplicates++;
+	} else if (message_id != (uint16_t)(broker.last_id + 1)) {
+		broker.in_order = false;
+	}
+
+	broker.last_id = message_id;
+
+	broker_ack(qos == 1 ? 0x40 : 0x50, message_id);
+}
+
+/* Handles the complete packets written by the client */
+static void broker_input(const uint8_t *data, size_t len)
+{
+	uint32_t length;
+	uint8_t type;
+	int shift;
+
+	while (len > 0) {
+		type = *data++;
+		len--;
+
+		length = 0U;
+		shift = 0;
+
+		do {
+			zassert_true(len > 0, "Truncated length");
+			length |= (*data & 0x7f) << shift;
+			shift += 7;
+			len--;
+		} while (*data++ & 0x80);
+
+		zassert_true(length <= len, "Truncated packet");
+
+		switch (type & 0xf0) {
+		case 0x10:
+			/* CONNACK, no session present */
+			broker.resp_buf[broker.resp_len++] = 0x20;
+			broker.resp_buf[broker.resp_len++] = 2;
+			broker.resp_buf[broker.resp_len++] = 0;
+			broker.resp_buf[broker.resp_len++] = 0;
+			break;
+		case 0x30:
+			broker_publish(type & 0x0f, data);
+			break;
+		case 0x60:
+			broker.pubrels++;
+			broker_ack(0x70, sys_get_be16(data));
+			break;
+		default:
+			break;
+		}
+
+		data += length;
+		len -= length;
+	}
+}
+
+int mqtt_client_custom_transport_connect(struct mqtt_client *client)
+{
+	ARG_UNUSED(client);
+
+	broker.resp_len = 0;
+	broker.resp_off = 0;
+	broker.held_len = 0;
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_write(struct mqtt_client *client,
+				       const uint8_t *data, uint32_t datalen)
+{
+	ARG_UNUSED(client);
+
+	broker.writes++;
+	broker_input(data, datalen);
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_write_msg(struct mqtt_client *client,
+					   const struct msghdr *message)
+{
+	static uint8_t buf[SESSION_SIZE + BUFFER_SIZE];
+	size_t len = 0;
+	int i;
+
+	ARG_UNUSED(client);
+
+	for (i = 0; i < message->msg_iovlen; i++) {
+		zassert_true(len + message->msg_iov[i].iov_len <= sizeof(buf),
+			     "Write too big");
+
+		memcpy(buf + len, message->msg_iov[i].iov_base,
+		       message->msg_iov[i].iov_len);
+		len += message->msg_iov[i].iov_len;
+	}
+
+	broker.writes++;
+	broker_input(buf, len);
+
+	return 0;
+}
+
+int mqtt_client_custom_transport_read(struct mqtt_client *client,
+				      uint8_t *data, uint32_t buflen,
+				      bool shall_block)
+{
+	size_t len = MIN(buflen, broker.resp_len - broker.resp_off);
+
+	ARG_UNUSED(client);
+	ARG_UNUSED(shall_block);
+
+	if (len == 0) {
+		return -EAGAIN;
+	}
+
+	memcpy(data, broker.resp_buf + broker.resp_off, len);
+	broker.resp_off += len;
+
+	if (broker.resp_off == broker.resp_len) {
+		broker.resp_off = 0;
+		broker.resp_len = 0;
+	}
+
+	return len;
+}
+
+int mqtt_client_custom_transport_disconnect(struct mqtt_client *client)
+{
+	ARG_UNUSED(client);
+
+	return 0;
+}
+
+static void evt_handler(struct mqtt_client *const c,
+			const struct mqtt_evt *evt)
+{
+	struct mqtt_pubrel_param pubrel;
+
+	switch (evt->type) {
+	case MQTT_EVT_PUBACK:
+		puback_count++;
+		break;
+	case MQTT_EVT_PUBREC:
+		/* What applications do without the session, the library
+		 * has already released the message.
+		 */
+		pubrel.message_id = evt->param.pubrec.message_id;
+		zassert_equal(mqtt_publish_qos2_release(c, &pubrel), 0,
+			      "Cannot release");
+		break;
+	case MQTT_EVT_PUBCOMP:
+		pubcomp_count++;
+		break;
+	default:
+		break;
+	}
+}
+
+static void process_input(void)
+{
+	while (broker.resp_len > broker.resp_off) {
+		zassert_equal(mqtt_input(&client), 0, "Input failed");
+	}
+}
+
+static void client_connect(void)
+{
+	zassert_equal(mqtt_connect(&client), 0, "Cannot connect");
+
+	process_input();
+}
+
+static int publish(enum mqtt_qos qos)
+{
+	struct mqtt_publish_param param;
+	int ret;
+
+	memset(&param, 0, sizeof(param));
+
+	param.message.topic.topic = TOPIC;
+	param.message.topic.qos = qos;
+	param.message.payload.data = payload;
+	param.message.payload.len = sizeof(payload);
+	param.message_id = next_id + 1;
+
+	ret = mqtt_publish(&client, &param);
+	if (ret == 0) {
+		next_id++;
+	}
+
+	return ret;
+}
+
+static void *session_setup(void)
+{
+	memset(payload, 0xaa, sizeof(payload));
+
+	return NULL;
+}
+
+static void session_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(&broker, 0, sizeof(broker));
+	broker.in_order = true;
+
+	puback_count = 0;
+	pubcomp_count = 0;
+	next_id = 0U;
+
+	mqtt_client_init(&client);
+
+	client.client_id = CLIENTID;
+	client.evt_cb = evt_handler;
+	client.transport.type = MQTT_TRANSPORT_CUSTOM;
+	client.rx_buf = rx_buffer;
+	client.rx_buf_size = sizeof(rx_buffer);
+	client.tx_buf = tx_buffer;
+	client.tx_buf_size = sizeof(tx_buffer);
+	client.session_buf = session_buffer;
+	client.session_buf_size = sizeof(session_buffer);
+
+	client_connect();
+}
+
+static void session_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	(void)mqtt_abort(&client);
+}
+
+ZTEST(mqtt_session, test_window)
+{
+	int i, writes;
+
+	broker.hold_acks = true;
+
+	for (i = 0; i < CONFIG_MQTT_SESSION_MAX_MSGS; i++) {
+		zassert_equal(publish(MQTT_QOS_1_AT_LEAST_ONCE), 0,
+			      "Cannot publish %d", i);
+	}
+
+	/* Back-pressure once the session is full */
+	zassert_equal(publish(MQTT_QOS_1_AT_LEAST_ONCE), -EAGAIN,
+		      "Session not full");
+	zassert_equal(mqtt_session_pending(&client),
+		      CONFIG_MQTT_SESSION_MAX_MSGS, "Wrong pending count");
+
+	/* Only the window was sent */
+	zassert_equal(broker.publishes, CONFIG_MQTT_SESSION_INFLIGHT,
+		      "Window not respected");
+
+	writes = broker.writes;
+
+	broker_release_acks();
+	process_input();
+
+	/* The rest went out in batches as the acknowledgements came */
+	while (mqtt_session_pending(&client) > 0) {
+		zassert_true(broker.resp_len > 0, "Nothing to acknowledge");
+		process_input();
+	}
+
+	zassert_equal(broker.publishes, CONFIG_MQTT_SESSION_MAX_MSGS,
+		      "Messages lost");
+	zassert_true(broker.writes - writes <
+		     CONFIG_MQTT_SESSION_MAX_MSGS - CONFIG_MQTT_SESSION_INFLIGHT,
+		     "Messages not batched");
+	zassert_equal(puback_count, CONFIG_MQTT_SESSION_MAX_MSGS,
+		      "Acknowledgements lost");
+	zassert_true(broker.in_order, "Messages out of order");
+
+	/* QoS 0 does not use the session */
+	zassert_equal(publish(MQTT_QOS_0_AT_MOST_ONCE), 0, "Cannot publish");
+	zassert_equal(mqtt_session_pending(&client), 0, "QoS 0 in session");
+}
+
+ZTEST(mqtt_session, test_qos2)
+{
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		zassert_equal(publish(MQTT_QOS_2_EXACTLY_ONCE), 0,
+			      "Cannot publish %d", i);
+	}
+
+	process_input();
+
+	zassert_equal(mqtt_session_pending(&client), 0, "Messages pending");
+	zassert_equal(broker.publishes, 3, "Wrong number of messages");
+	zassert_equal(broker.pubrels, 3, "PUBREL missing or duplicated");
+	zassert_equal(pubcomp_count, 3, "PUBCOMP missing");
+}
+
+ZTEST(mqtt_session, test_reconnect)
+{
+	int i;
+
+	broker.hold_acks = true;
+
+	for (i = 0; i < 3; i++) {
+		zassert_equal(publish(MQTT_QOS_1_AT_LEAST_ONCE), 0,
+			      "Cannot publish %d", i);
+	}
+
+	zassert_equal(publish(MQTT_QOS_2_EXACTLY_ONCE), 0, "Cannot publish");
+	zassert_equal(broker.publishes, 4, "Messages not sent");
+	zassert_equal(broker.duplicates, 0, "Unexpected duplicates");
+
+	/* Connection lost before the acknowledgements */
+	zassert_equal(mqtt_abort(&client), 0, "Cannot abort");
+	zassert_equal(publish(MQTT_QOS_1_AT_LEAST_ONCE), -ENOTCONN,
+		      "Publish while disconnected");
+	zassert_equal(mqtt_session_pending(&client), 4, "Session lost");
+
+	broker.hold_acks = false;
+	client_connect();
+	process_input();
+
+	zassert_equal(broker.duplicates, 4, "Messages not sent again");
+	zassert_equal(mqtt_session_pending(&client), 0, "Messages pending");
+	zassert_equal(broker.pubrels, 1, "PUBREL not sent");
+}
+
+static uint32_t bench(bool session)
+{
+	uint32_t start, cycles;
+	int sent = 0;
+	int ret;
+
+	if (!session) {
+		client.session_buf = NULL;
+	}
+
+	start = k_cycle_get_32();
+
+	while (sent < BENCH_MSGS) {
+		ret = publish(MQTT_QOS_1_AT_LEAST_ONCE);
+		if (ret == -EAGAIN) {
+			process_input();
+			continue;
+		}
+
+		zassert_equal(ret, 0, "Cannot publish");
+		sent++;
+
+		/* Without the session each message waits for its PUBACK */
+		if (!session) {
+			process_input();
+		}
+	}
+
+	process_input();
+
+	cycles = k_cycle_get_32() - start;
+
+	zassert_equal(puback_count, BENCH_MSGS, "Acknowledgements lost");
+	zassert_equal(broker.publishes, BENCH_MSGS, "Messages lost");
+
+	TC_PRINT("%s: %d messages in %llu us, %d writes\n",
+		 session ? "session" : "stop-and-wait", BENCH_MSGS,
+		 k_cyc_to_us_floor64(cycles), broker.writes);
+
+	return broker.writes;
+}
+
+ZTEST(mqtt_session, test_rate)
+{
+	uint32_t writes, stop_and_wait_writes;
+
+	writes = bench(true);
+	zassert_true(writes < BENCH_MSGS, "Messages not batched");
+	zassert_true(broker.in_order, "Messages out of order");
+
+	session_after(NULL);
+	session_before(NULL);
+
+	/* Every message is a transport write of its own without the session */
+	stop_and_wait_writes = bench(false);
+	zassert_true(stop_and_wait_writes >= BENCH_MSGS,
+		     "Stop-and-wait messages batched");
+	zassert_true(writes < stop_and_wait_writes,
+		     "Session does not save transport writes");
+}
+
+ZTEST_SUITE(mqtt_session, NULL, session_setup, session_before, session_after,
+	    NULL);
@@ -0,0 +1,404 @@
+/* main.c - Loopback fast path tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_LOOPBACK_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zephyr/ztest.h>
+
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/socket.h>
+
+#include "net_private.h"
+#include "ipv4.h"
+#include "udp_internal.h"
+
+static struct in_addr loopback_addr = INADDR_LOOPBACK_INIT;
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+static struct in_addr netmask = { { { 255, 255, 255, 0 } } };
+
+#define UDP_PORT 4242
+#define TCP_PORT 4243
+#define DUMMY_PORT 4244
+#define TCP_LARGE_PORT 4245
+#define PEER_PORT 1000
+
+/* Larger than the MSS derived from the default loopback MTU */
+#define LARGE_DATA_LEN 2000
+
+#define WAIT_TIME K_MSEC(500)
+
+static const char test_data[] = "Data sent to ourselves";
+static uint8_t large_data[LARGE_DATA_LEN];
+static uint8_t large_buf[LARGE_DATA_LEN];
+
+static struct net_if *lo_iface;
+static struct net_if *dummy_iface;
+
+/* The last packet sent by the dummy interface */
+static struct net_pkt *sent_pkt;
+static K_SEM_DEFINE(pkt_sent, 0, 1);
+
+static int net_iface_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	static uint8_t mac_addr[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x01 };
+
+	net_if_set_link_addr(iface, mac_addr, sizeof(mac_addr),
+			     NET_LINK_DUMMY);
+}
+
+/* A dummy L2 interface which is not the loopback one, like SLIP */
+static int sender_iface(const struct device *dev, struct net_pkt *pkt)
+{
+	if (!sent_pkt) {
+		sent_pkt = net_pkt_ref(pkt);
+		k_sem_give(&pkt_sent);
+	}
+
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT(net_dummy_test, "dummy", net_iface_dev_init, NULL, NULL,
+		NULL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &net_iface_api,
+		DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), NET_IPV4_MTU);
+
+static void iface_cb(struct net_if *iface, void *user_data)
+{
+	if (net_if_l2(iface) != &NET_L2_GET_NAME(DUMMY)) {
+		return;
+	}
+
+	if (net_if_flag_is_set(iface, NET_IF_LOOPBACK)) {
+		lo_iface = iface;
+	} else {
+		dummy_iface = iface;
+	}
+}
+
+static void sockaddr_init(struct sockaddr_in *addr, struct in_addr *in_addr,
+			  uint16_t port)
+{
+	memset(addr, 0, sizeof(*addr));
+
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(port);
+	net_ipaddr_copy(&addr->sin_addr, in_addr);
+}
+
+static void recv_check(int sock)
+{
+	char buf[sizeof(test_data)];
+	ssize_t len;
+
+	len = recv(sock, buf, sizeof(buf), 0);
+	zassert_equal(len, sizeof(test_data), "Invalid recv len (%d)", errno);
+	zassert_mem_equal(buf, test_data, sizeof(test_data), "Invalid data");
+}
+
+static void set_rcvtimeo(int sock)
+{
+	struct timeval tv = {
+		.tv_usec = 500 * USEC_PER_MSEC,
+	};
+
+	zassert_ok(setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)),
+		   "setsockopt failed (%d)", errno);
+}
+
+ZTEST(net_loopback_fast_path, test_checksum_needed)
+{
+	bool skip = IS_ENABLED(CONFIG_NET_LOOPBACK_FAST_PATH);
+
+	zassert_equal(net_if_need_calc_tx_checksum(lo_iface), !skip,
+		      "Wrong loopback TX checksum");
+	zassert_equal(net_if_need_calc_rx_checksum(lo_iface), !skip,
+		      "Wrong loopback RX checksum");
+
+	/* Only the loopback interface skips the checksums */
+	zassert_true(net_if_need_calc_tx_checksum(dummy_iface),
+		     "No TX checksum on a dummy interface");
+	zassert_true(net_if_need_calc_rx_checksum(dummy_iface),
+		     "No RX checksum on a dummy interface");
+}
+
+ZTEST(net_loopback_fast_path, test_udp_loopback)
+{
+	struct sockaddr_in addr, client_addr, src_addr;
+	socklen_t addrlen;
+	char buf[sizeof(test_data)];
+	int server, client;
+	ssize_t len;
+
+	sockaddr_init(&addr, &loopback_addr, UDP_PORT);
+
+	server = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(server >= 0, "socket failed (%d)", errno);
+	client = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(client >= 0, "socket failed (%d)", errno);
+
+	set_rcvtimeo(server);
+
+	zassert_ok(bind(server, (struct sockaddr *)&addr, sizeof(addr)),
+		   "bind failed (%d)", errno);
+
+	len = sendto(client, test_data, sizeof(test_data), 0,
+		     (struct sockaddr *)&addr, sizeof(addr));
+	zassert_equal(len, sizeof(test_data), "sendto failed (%d)", errno);
+
+	addrlen = sizeof(src_addr);
+	len = recvfrom(server, buf, sizeof(buf), 0,
+		       (struct sockaddr *)&src_addr, &addrlen);
+	zassert_equal(len, sizeof(test_data), "Invalid recv len (%d)", errno);
+	zassert_mem_equal(buf, test_data, sizeof(test_data), "Invalid data");
+
+	/* The receiver sees where the datagram came from */
+	addrlen = sizeof(client_addr);
+	zassert_ok(getsockname(client, (struct sockaddr *)&client_addr,
+			       &addrlen), "getsockname failed (%d)", errno);
+	zassert_true(net_ipv4_addr_cmp(&src_addr.sin_addr, &loopback_addr),
+		     "Invalid source address");
+	zassert_equal(src_addr.sin_port, client_addr.sin_port,
+		      "Invalid source port");
+
+	close(client);
+	close(server);
+}
+
+ZTEST(net_loopback_fast_path, test_tcp_loopback)
+{
+	struct sockaddr_in addr;
+	int server, client, conn;
+	ssize_t len;
+
+	sockaddr_init(&addr, &loopback_addr, TCP_PORT);
+
+	server = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(server >= 0, "socket failed (%d)", errno);
+	client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(client >= 0, "socket failed (%d)", errno);
+
+	zassert_ok(bind(server, (struct sockaddr *)&addr, sizeof(addr)),
+		   "bind failed (%d)", errno);
+	zassert_ok(listen(server, 1), "listen failed (%d)", errno);
+
+	zassert_ok(connect(client, (struct sockaddr *)&addr, sizeof(addr)),
+		   "connect failed (%d)", errno);
+
+	conn = accept(server, NULL, NULL);
+	zassert_true(conn >= 0, "accept failed (%d)", errno);
+
+	set_rcvtimeo(conn);
+
+	len = send(client, test_data, sizeof(test_data), 0);
+	zassert_equal(len, sizeof(test_data), "send failed (%d)", errno);
+
+	recv_check(conn);
+
+	close(client);
+	close(conn);
+	close(server);
+
+	/* Let the connections finish closing */
+	k_msleep(100);
+}
+
+ZTEST(net_loopback_fast_path, test_tcp_loopback_large)
+{
+	struct sockaddr_in addr;
+	int server, client, conn;
+	size_t received;
+	ssize_t len;
+	int i;
+
+	for (i = 0; i < sizeof(large_data); i++) {
+		large_data[i] = i;
+	}
+
+	sockaddr_init(&addr, &loopback_addr, TCP_LARGE_PORT);
+
+	server = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(server >= 0, "socket failed (%d)", errno);
+	client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(client >= 0, "socket failed (%d)", errno);
+
+	zassert_ok(bind(server, (struct sockaddr *)&addr, sizeof(addr)),
+		   "bind failed (%d)", errno);
+	zassert_ok(listen(server, 1), "listen failed (%d)", errno);
+
+	zassert_ok(connect(client, (struct sockaddr *)&addr, sizeof(addr)),
+		   "connect failed (%d)", errno);
+
+	conn = accept(server, NULL, NULL);
+	zassert_true(conn >= 0, "accept failed (%d)", errno);
+
+	set_rcvtimeo(conn);
+
+	len = send(client, large_data, sizeof(large_data), 0);
+	zassert_equal(len, sizeof(large_data), "send failed (%d)", errno);
+
+	/* A recv() without MSG_WAITALL returns the data of one segment */
+	len = recv(conn, large_buf, sizeof(large_buf), 0);
+	zassert_true(len > 0, "recv failed (%d)", errno);
+
+	if (IS_ENABLED(CONFIG_NET_LOOPBACK_TCP_NO_SEGMENTATION)) {
+		zassert_equal(len, sizeof(large_data), "Data segmented");
+	} else {
+		zassert_true(len < sizeof(large_data), "Data not segmented");
+	}
+
+	for (received = len; received < sizeof(large_buf); received += len) {
+		len = recv(conn, large_buf + received,
+			   sizeof(large_buf) - received, 0);
+		zassert_true(len > 0, "recv failed (%d)", errno);
+	}
+
+	zassert_mem_equal(large_buf, large_data, sizeof(large_data),
+			  "Invalid data");
+
+	close(client);
+	close(conn);
+	close(server);
+
+	/* Let the connections finish closing */
+	k_msleep(100);
+}
+
+ZTEST(net_loopback_fast_path, test_dummy_tx_checksum)
+{
+	struct sockaddr_in addr;
+	struct net_pkt *pkt;
+	int sock;
+	ssize_t len;
+
+	sockaddr_init(&addr, &peer_addr, PEER_PORT);
+
+	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sock >= 0, "socket failed (%d)", errno);
+
+	k_sem_reset(&pkt_sent);
+	sent_pkt = NULL;
+
+	len = sendto(sock, test_data, sizeof(test_data), 0,
+		     (struct sockaddr *)&addr, sizeof(addr));
+	zassert_equal(len, sizeof(test_data), "sendto failed (%d)", errno);
+
+	zassert_ok(k_sem_take(&pkt_sent, WAIT_TIME), "Packet not sent");
+
+	pkt = sent_pkt;
+	zassert_equal(net_pkt_iface(pkt), dummy_iface, "Wrong interface");
+	zassert_equal(net_calc_verify_chksum_udp(pkt), 0U,
+		      "Invalid UDP checksum");
+
+	net_pkt_unref(pkt);
+	close(sock);
+}
+
+static struct net_pkt *udp_pkt_create(void)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_rx_alloc_with_buffer(dummy_iface, NET_IPV4UDPH_LEN +
+					   sizeof(test_data), AF_INET,
+					   IPPROTO_UDP, WAIT_TIME);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	net_pkt_set_ipv4_ttl(pkt, 64);
+
+	zassert_ok(net_ipv4_create(pkt, &peer_addr, &my_addr),
+		   "IPv4 header append failed");
+	zassert_ok(net_udp_create(pkt, htons(PEER_PORT), htons(DUMMY_PORT)),
+		   "UDP header append failed");
+	zassert_ok(net_pkt_write(pkt, test_data, sizeof(test_data)),
+		   "Cannot append data");
+
+	net_pkt_cursor_init(pkt);
+	net_ipv4_finalize(pkt, IPPROTO_UDP);
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+ZTEST(net_loopback_fast_path, test_dummy_rx_checksum)
+{
+	struct sockaddr_in addr;
+	struct net_pkt *pkt;
+	char buf[sizeof(test_data)];
+	int sock;
+
+	sockaddr_init(&addr, &my_addr, DUMMY_PORT);
+
+	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sock >= 0, "socket failed (%d)", errno);
+
+	set_rcvtimeo(sock);
+
+	zassert_ok(bind(sock, (struct sockaddr *)&addr, sizeof(addr)),
+		   "bind failed (%d)", errno);
+
+	/* A packet with a broken checksum is dropped */
+	pkt = udp_pkt_create();
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_skip(pkt, NET_IPV4H_LEN + offsetof(struct net_udp_hdr, chksum));
+	net_pkt_write_be16(pkt, 0x1234);
+	net_pkt_cursor_init(pkt);
+
+	zassert_ok(net_recv_data(dummy_iface, pkt), "Cannot receive pkt");
+
+	zassert_equal(recv(sock, buf, sizeof(buf), 0), -1,
+		      "Packet with invalid checksum received");
+	zassert_equal(errno, EAGAIN, "Invalid errno (%d)", errno);
+
+	pkt = udp_pkt_create();
+	zassert_ok(net_recv_data(dummy_iface, pkt), "Cannot receive pkt");
+
+	recv_check(sock);
+
+	close(sock);
+}
+
+static void *test_setup(void)
+{
+	struct net_if_addr *ifaddr;
+
+	net_if_foreach(iface_cb, NULL);
+	zassert_not_null(lo_iface, "No loopback interface");
+	zassert_not_null(dummy_iface, "No dummy interface");
+
+	ifaddr = net_if_ipv4_addr_add(dummy_iface, &my_addr, NET_ADDR_MANUAL,
+				      0);
+	zassert_not_null(ifaddr, "Cannot add address");
+	net_if_ipv4_set_netmask(dummy_iface, &netmask);
+
+	net_if_up(dummy_iface);
+
+	return NULL;
+}
+
+ZTEST_SUITE(net_loopback_fast_path, NULL, test_setup, NULL, NULL, NULL);
@@ -14,6 +14,8 @@
 #include <zephyr/net/net_if.h>
 #include <zephyr/net/net_ip.h>
 #include <zephyr/net/ethernet.h>
+#include <zephyr/net/net_mgmt.h>
+#include <zephyr/net/net_event.h>
 #include <zephyr/random/rand32.h>
 
 #include <zephyr/ztest.h>
@@ -1186,4 +1188,84 @@ ZTEST(net_pkt_test_suite, test_net_pkt_shallow_clone_append_buf_2)
 	test_net_pkt_shallow_clone_append_buf(2);
 }
 
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+static K_SEM_DEFINE(pool_event_sem, 0, 2);
+static uint32_t pool_events[2];
+static int pool_event_count;
+
+static void pool_event_handler(struct net_mgmt_event_callback *cb,
+			       uint32_t mgmt_event, struct net_if *iface)
+{
+	if (pool_event_count < ARRAY_SIZE(pool_events)) {
+		pool_events[pool_event_count++] = mgmt_event;
+	}
+
+	k_sem_give(&pool_event_sem);
+}
+#endif
+
+ZTEST(net_pkt_test_suite, test_net_pkt_pool_pressure)
+{
+#if defined(CONFIG_NET_PKT_POOL_MONITOR)
+	static struct net_mgmt_event_callback cb;
+	struct net_pkt *pkts[CONFIG_NET_PKT_TX_COUNT];
+	struct net_pkt_pool_usage usage;
+	int i, count = 0;
+
+	net_mgmt_init_event_callback(&cb, pool_event_handler,
+				     NET_EVENT_PKT_POOL_LOW |
+				     NET_EVENT_PKT_POOL_OK);
+	net_mgmt_add_event_callback(&cb);
+
+	zassert_false(net_pkt_tx_pool_is_low(), "TX pool low at start");
+
+	/* All the packets must be available even if some of them are
+	 * sitting in the per CPU caches.
+	 */
+	while (count < ARRAY_SIZE(pkts)) {
+		pkts[count] = net_pkt_alloc(K_NO_WAIT);
+		if (!pkts[count]) {
+			break;
+		}
+
+		count++;
+	}
+
+	zassert_equal(count, CONFIG_NET_PKT_TX_COUNT,
+		      "Only %d packets allocated", count);
+	zassert_is_null(net_pkt_alloc(K_NO_WAIT), "Pool not empty");
+	zassert_true(net_pkt_tx_pool_is_low(), "TX pool not low");
+
+	zassert_equal(net_pkt_pool_usage_get(NET_PKT_POOL_TX, &usage), 0,
+		      "Cannot get pool usage");
+	zassert_equal(usage.used, usage.total, "Invalid used count %u/%u",
+		      usage.used, usage.total);
+	zassert_equal(usage.max_used, usage.total, "Invalid max used %u",
+		      usage.max_used);
+	zassert_true(usage.low, "Pool usage not low");
+	zassert_true(usage.hist[NET_PKT_POOL_HIST_BUCKETS - 1] > 0,
+		     "Full pool not in histogram");
+
+	for (i = 0; i < count; i++) {
+		net_pkt_unref(pkts[i]);
+	}
+
+	zassert_false(net_pkt_tx_pool_is_low(), "TX pool still low");
+
+	/* The events are sent from the system work queue */
+	zassert_equal(k_sem_take(&pool_event_sem, K_SECONDS(1)), 0,
+		      "Low event not received");
+	zassert_equal(k_sem_take(&pool_event_sem, K_SECONDS(1)), 0,
+		      "Ok event not received");
+	zassert_equal(pool_events[0], NET_EVENT_PKT_POOL_LOW,
+		      "Invalid first event 0x%x", pool_events[0]);
+	zassert_equal(pool_events[1], NET_EVENT_PKT_POOL_OK,
+		      "Invalid second event 0x%x", pool_events[1]);
+
+	net_mgmt_del_event_callback(&cb);
+#else
+	ztest_test_skip();
+#endif
+}
+
 ZTEST_SUITE(net_pkt_test_suite, NULL, NULL, NULL, NULL, NULL);
@@ -314,4 +314,114 @@ ZTEST(net_pkt_filter_test_suite, test_npf_address_mask)
 	test_npf_eth_mac_addr_mask();
 }
 
+/*
+ * Rule hit counters and evaluation rate with a larger rule list
+ */
+
+#define BENCH_RULES 100
+#define BENCH_PKTS 10000
+#define BENCH_TYPE_BASE 0x8800
+
+static NPF_SIZE_MAX(maxsize_1500, 1500);
+static struct npf_test_eth_type bench_types[BENCH_RULES];
+static uint8_t bench_rules[BENCH_RULES][sizeof(struct npf_rule) +
+					3 * sizeof(struct npf_test *)]
+	__aligned(sizeof(void *));
+
+/* Counts the rules whose tests are looked at */
+static int bench_visits;
+
+static bool bench_visit(struct npf_test *test, struct net_pkt *pkt)
+{
+	ARG_UNUSED(test);
+	ARG_UNUSED(pkt);
+
+	bench_visits++;
+
+	return true;
+}
+
+static struct npf_test bench_visit_test = { .fn = bench_visit };
+
+static struct npf_rule *bench_rule(int i)
+{
+	return (struct npf_rule *)bench_rules[i];
+}
+
+ZTEST(net_pkt_filter_test_suite, test_npf_rule_rate)
+{
+	struct net_pkt *pkt_pass, *pkt_drop;
+	uint32_t start, cycles;
+	struct npf_rule *rule;
+	int i, passed = 0;
+
+	/* Each rule drops one Ethernet type, the last one accepts the rest */
+	for (i = 0; i < BENCH_RULES; i++) {
+		bench_types[i].test.fn = npf_eth_type_match;
+		bench_types[i].type = htons(BENCH_TYPE_BASE + i);
+
+		rule = bench_rule(i);
+		rule->result = NET_DROP;
+		rule->nb_tests = 3;
+		rule->tests[0] = &bench_visit_test;
+		rule->tests[1] = &bench_types[i].test;
+		rule->tests[2] = &maxsize_1500.test;
+		npf_rule_hits_reset(rule);
+
+		npf_append_recv_rule(rule);
+	}
+
+	npf_append_recv_rule(&npf_default_ok);
+	npf_rule_hits_reset(&npf_default_ok);
+
+	pkt_pass = build_test_pkt(NET_ETH_PTYPE_IP, 100, NULL);
+	pkt_drop = build_test_pkt(BENCH_TYPE_BASE + BENCH_RULES / 2, 100, NULL);
+
+	zassert_true(net_pkt_filter_recv_ok(pkt_pass), "");
+	zassert_false(net_pkt_filter_recv_ok(pkt_drop), "");
+
+	/* only the rule that decided the verdict is counted */
+	zassert_equal(npf_rule_hits(&npf_default_ok), 1, "");
+	zassert_equal(npf_rule_hits(bench_rule(BENCH_RULES / 2)), 1, "");
+	zassert_equal(npf_rule_hits(bench_rule(0)), 0, "");
+
+	/* packets that reach the end of the list are the worst case */
+	bench_visits = 0;
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCH_PKTS; i++) {
+		if (net_pkt_filter_recv_ok(pkt_pass)) {
+			passed++;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	zassert_equal(passed, BENCH_PKTS, "");
+	zassert_equal(npf_rule_hits(&npf_default_ok), BENCH_PKTS + 1, "");
+
+	TC_PRINT("%d rules: %d packets in %llu us, %d rules visited\n",
+		 BENCH_RULES, BENCH_PKTS, k_cyc_to_us_floor64(cycles),
+		 bench_visits);
+
+	/* the compiled lists only test the rules indexed for the packet
+	 * Ethernet type, and none of the bench rules is
+	 */
+	if (IS_ENABLED(CONFIG_NET_PKT_FILTER_COMPILED)) {
+		zassert_equal(bench_visits, 0, "Rules visited");
+	} else {
+		zassert_equal(bench_visits, BENCH_PKTS * BENCH_RULES,
+			      "Rules skipped");
+	}
+
+	/* removing a rule is seen by the next packet */
+	zassert_true(npf_remove_recv_rule(bench_rule(BENCH_RULES / 2)), "");
+	zassert_true(net_pkt_filter_recv_ok(pkt_drop), "");
+
+	zassert_true(npf_remove_all_recv_rules(), "");
+
+	net_pkt_unref(pkt_pass);
+	net_pkt_unref(pkt_drop);
+}
+
 ZTEST_SUITE(net_pkt_filter_test_suite, NULL, test_npf_iface, NULL, NULL, NULL);
@@ -26,6 +26,7 @@ LOG_MODULE_REGISTER(net_test, NET_LOG_LEVEL);
 #include <zephyr/net/buf.h>
 #include <zephyr/net/net_ip.h>
 #include <zephyr/net/net_if.h>
+#include <zephyr/net/ppp.h>
 
 #define NET_LOG_ENABLED 1
 #include "net_private.h"
@@ -34,6 +35,7 @@ typedef enum net_verdict (*ppp_l2_callback_t)(struct net_if *iface,
 					      struct net_pkt *pkt);
 void ppp_l2_register_pkt_cb(ppp_l2_callback_t cb); /* found in ppp_l2.c */
 void ppp_driver_feed_data(uint8_t *data, int data_len);
+void ppp_driver_set_loopback(bool enable);
 
 static struct net_if *iface;
 
@@ -537,6 +539,149 @@ static void test_send_ppp_8(void)
 	}
 }
 
+/* Frame spanning several net_bufs, with runs of bytes that need no escaping
+ * between bytes that do.
+ */
+#define LARGE_DATA_LEN 600
+
+static uint8_t ppp_expect_large[LARGE_DATA_LEN];
+static uint8_t ppp_recv_large[2 * (LARGE_DATA_LEN + 4) + 2];
+
+static int escape(uint8_t *dst, const uint8_t *src, int len)
+{
+	int i, pos = 0;
+
+	for (i = 0; i < len; i++) {
+		if (src[i] == 0x7e || src[i] == 0x7d || src[i] < 0x20) {
+			dst[pos++] = 0x7d;
+			dst[pos++] = src[i] ^ 0x20;
+		} else {
+			dst[pos++] = src[i];
+		}
+	}
+
+	return pos;
+}
+
+static void test_send_ppp_large(void)
+{
+	static const uint8_t addr_ctrl[] = { 0xff, 0x03 };
+	uint8_t fcs_bytes[2];
+	uint16_t fcs;
+	int i, len;
+	bool ret;
+
+	ppp_expect_large[0] = 0xc0;
+	ppp_expect_large[1] = 0x21;
+
+	for (i = 2; i < LARGE_DATA_LEN; i++) {
+		ppp_expect_large[i] = (i % 7) ? (i * 31) : (i & 0x1f);
+	}
+
+	fcs = crc16_ccitt(0xffff, addr_ctrl, sizeof(addr_ctrl));
+	fcs = crc16_ccitt(fcs, ppp_expect_large, sizeof(ppp_expect_large));
+	fcs ^= 0xffff;
+	fcs_bytes[0] = fcs & 0xff;
+	fcs_bytes[1] = fcs >> 8;
+
+	len = 0;
+	ppp_recv_large[len++] = 0x7e;
+	len += escape(&ppp_recv_large[len], addr_ctrl, sizeof(addr_ctrl));
+	len += escape(&ppp_recv_large[len], ppp_expect_large,
+		      sizeof(ppp_expect_large));
+	len += escape(&ppp_recv_large[len], fcs_bytes, sizeof(fcs_bytes));
+	ppp_recv_large[len++] = 0x7e;
+
+	/* Drain the results of the previous tests */
+	while (k_sem_take(&wait_data, K_NO_WAIT) == 0) {
+	}
+
+	ret = send_iface(iface, ppp_recv_large, len, ppp_expect_large,
+			 sizeof(ppp_expect_large));
+
+	zassert_true(ret, "iface");
+
+	if (k_sem_take(&wait_data, WAIT_TIME_LONG)) {
+		zassert_true(false, "Timeout, packet not received");
+	}
+
+	zassert_false(test_failed, "Large frame not received intact");
+}
+
+/* Frames sent by the driver are fed back to its receive path */
+#define LOOPBACK_FRAMES 200
+
+static uint8_t loopback_data[LARGE_DATA_LEN];
+static int loopback_received;
+
+static enum net_verdict ppp_l2_loopback_recv(struct net_if *iface,
+					     struct net_pkt *pkt)
+{
+	size_t len = net_pkt_get_len(pkt);
+
+	ARG_UNUSED(iface);
+
+	/* Anything else is a frame that PPP L2 sent by itself */
+	if (len == sizeof(loopback_data) &&
+	    net_pkt_read(pkt, loopback_data, len) == 0 &&
+	    memcmp(loopback_data, ppp_expect_large, len) == 0) {
+		loopback_received++;
+		k_sem_give(&wait_data);
+	}
+
+	return NET_DROP;
+}
+
+static void test_ppp_loopback_rate(void)
+{
+	const struct device *dev = net_if_get_device(iface);
+	const struct ppp_api *api = dev->api;
+	uint32_t start, cycles;
+	struct net_pkt *pkt;
+	int i, ret;
+
+	while (k_sem_take(&wait_data, K_NO_WAIT) == 0) {
+	}
+
+	loopback_received = 0;
+
+	ppp_l2_register_pkt_cb(ppp_l2_loopback_recv);
+	ppp_driver_set_loopback(true);
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < LOOPBACK_FRAMES; i++) {
+		pkt = net_pkt_alloc_with_buffer(iface, sizeof(ppp_expect_large),
+						AF_UNSPEC, 0, K_NO_WAIT);
+		zassert_not_null(pkt, "Cannot allocate pkt");
+
+		/* The data starts with the PPP protocol field */
+		net_pkt_set_ppp(pkt, true);
+
+		ret = net_pkt_write(pkt, ppp_expect_large,
+				    sizeof(ppp_expect_large));
+		zassert_equal(ret, 0, "Cannot write pkt");
+
+		ret = api->send(dev, pkt);
+		net_pkt_unref(pkt);
+
+		zassert_equal(ret, 0, "Cannot send frame %d", i);
+		zassert_equal(k_sem_take(&wait_data, WAIT_TIME_LONG), 0,
+			      "Frame %d not received", i);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	ppp_driver_set_loopback(false);
+	ppp_l2_register_pkt_cb(ppp_l2_recv);
+
+	TC_PRINT("loopback: %d frames of %zd bytes in %llu us\n",
+		 LOOPBACK_FRAMES, sizeof(ppp_expect_large),
+		 k_cyc_to_us_floor64(cycles));
+
+	zassert_equal(loopback_received, LOOPBACK_FRAMES, "Frames lost");
+}
+
 ZTEST(net_ppp_test_suite, test_net_ppp)
 {
 	test_iface_setup();
@@ -551,6 +696,8 @@ ZTEST(net_ppp_test_suite, test_net_ppp)
 	test_send_ppp_6();
 	test_send_ppp_7();
 	test_send_ppp_8();
+	test_send_ppp_large();
+	test_ppp_loopback_rate();
 }
 
 ZTEST_SUITE(net_ppp_test_suite, NULL, NULL, NULL, NULL, NULL);
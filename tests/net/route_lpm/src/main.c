@@ -0,0 +1,359 @@
+/* main.c - Longest prefix match route table tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_ROUTE_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <zephyr/ztest.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/random/rand32.h>
+
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+
+#include "net_private.h"
+#include "route.h"
+#include "route_lpm.h"
+
+#define RANDOM_PREFIXES 256
+#define RANDOM_LOOKUPS 2000
+#define BENCH_LOOKUPS 100000
+
+NET_ROUTE_LPM_DEFINE(test_lpm, RANDOM_PREFIXES, 128);
+
+struct test_prefix {
+	uint8_t addr[16];
+	uint8_t len;
+	bool used;
+};
+
+static struct test_prefix prefixes[RANDOM_PREFIXES];
+
+/* Addresses used in the benchmark, generated beforehand so that the
+ * random generator is not part of the measurement.
+ */
+static struct in_addr bench_addr[1024];
+
+static struct in_addr nexthop1 = { { { 192, 0, 2, 1 } } };
+static struct in_addr nexthop2 = { { { 192, 0, 2, 2 } } };
+
+static void random_addr(uint8_t *addr, size_t len)
+{
+	sys_rand_get(addr, len);
+}
+
+static void mask_prefix(uint8_t *addr, uint8_t len, size_t bytes)
+{
+	int i;
+
+	for (i = len / 8; i < bytes; i++) {
+		if (i == len / 8 && (len % 8)) {
+			addr[i] &= 0xff << (8 - (len % 8));
+		} else {
+			addr[i] = 0;
+		}
+	}
+}
+
+static bool is_prefix(const uint8_t *prefix, const uint8_t *addr, uint8_t len)
+{
+	uint8_t mask;
+
+	if (memcmp(prefix, addr, len / 8)) {
+		return false;
+	}
+
+	if (!(len % 8)) {
+		return true;
+	}
+
+	mask = 0xff << (8 - (len % 8));
+
+	return ((prefix[len / 8] ^ addr[len / 8]) & mask) == 0;
+}
+
+/* Reference longest prefix match */
+static struct test_prefix *linear_lookup(const uint8_t *addr)
+{
+	struct test_prefix *found = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(prefixes); i++) {
+		if (!prefixes[i].used ||
+		    !is_prefix(prefixes[i].addr, addr, prefixes[i].len)) {
+			continue;
+		}
+
+		if (!found || prefixes[i].len > found->len) {
+			found = &prefixes[i];
+		}
+	}
+
+	return found;
+}
+
+static void check_lookups(void)
+{
+	struct test_prefix *expected, *found;
+	uint8_t addr[16];
+	int i;
+
+	for (i = 0; i < RANDOM_LOOKUPS; i++) {
+		/* Use an address that is near some prefix now and then,
+		 * otherwise the long prefixes would never match.
+		 */
+		random_addr(addr, sizeof(addr));
+		if (i % 2) {
+			struct test_prefix *p = &prefixes[i % RANDOM_PREFIXES];
+
+			memcpy(addr, p->addr, p->len / 8);
+		}
+
+		expected = linear_lookup(addr);
+		found = net_route_lpm_lookup(&test_lpm, addr);
+
+		zassert_equal_ptr(found, expected,
+				  "Lookup %d mismatch, found %p expected %p",
+				  i, found, expected);
+	}
+}
+
+ZTEST(route_lpm_test_suite, test_lpm_random)
+{
+	int i, ret, count = 0;
+
+	net_route_lpm_init(&test_lpm);
+
+	for (i = 0; i < ARRAY_SIZE(prefixes); i++) {
+		/* Short prefixes are more likely to be nested */
+		prefixes[i].len = sys_rand32_get() % (i % 4 ? 129 : 33);
+		random_addr(prefixes[i].addr, sizeof(prefixes[i].addr));
+		mask_prefix(prefixes[i].addr, prefixes[i].len,
+			    sizeof(prefixes[i].addr));
+
+		if (net_route_lpm_get(&test_lpm, prefixes[i].addr,
+				      prefixes[i].len)) {
+			/* Duplicate prefix */
+			continue;
+		}
+
+		ret = net_route_lpm_add(&test_lpm, prefixes[i].addr,
+					prefixes[i].len, &prefixes[i]);
+		zassert_equal(ret, 0, "Cannot add prefix %d (%d)", i, ret);
+
+		prefixes[i].used = true;
+		count++;
+	}
+
+	zassert_equal(net_route_lpm_count(&test_lpm), count,
+		      "Invalid prefix count");
+
+	check_lookups();
+
+	/* Remove every third prefix and check that the shorter ones are
+	 * found again.
+	 */
+	for (i = 0; i < ARRAY_SIZE(prefixes); i += 3) {
+		if (!prefixes[i].used) {
+			continue;
+		}
+
+		ret = net_route_lpm_del(&test_lpm, prefixes[i].addr,
+					prefixes[i].len);
+		zassert_equal(ret, 0, "Cannot delete prefix %d (%d)", i, ret);
+
+		ret = net_route_lpm_del(&test_lpm, prefixes[i].addr,
+					prefixes[i].len);
+		zassert_equal(ret, -ENOENT, "Prefix %d deleted twice", i);
+
+		prefixes[i].used = false;
+		count--;
+	}
+
+	zassert_equal(net_route_lpm_count(&test_lpm), count,
+		      "Invalid prefix count after delete");
+
+	check_lookups();
+
+	for (i = 0; i < ARRAY_SIZE(prefixes); i++) {
+		if (!prefixes[i].used) {
+			continue;
+		}
+
+		ret = net_route_lpm_del(&test_lpm, prefixes[i].addr,
+					prefixes[i].len);
+		zassert_equal(ret, 0, "Cannot delete prefix %d (%d)", i, ret);
+
+		prefixes[i].used = false;
+	}
+
+	zassert_equal(net_route_lpm_count(&test_lpm), 0, "Table not empty");
+	zassert_is_null(test_lpm.root, "Nodes left in the table");
+}
+
+ZTEST(route_lpm_test_suite, test_route_ipv4)
+{
+	struct net_if *iface = net_if_get_default();
+	struct net_route_entry_ipv4 *net8, *net16, *host, *route;
+	struct net_route_entry_ipv4 copy;
+	struct in_addr net = { { { 10, 0, 0, 0 } } };
+	struct in_addr subnet = { { { 10, 1, 0, 0 } } };
+	struct in_addr dst = { { { 10, 1, 2, 3 } } };
+	struct in_addr other = { { { 10, 2, 2, 3 } } };
+	struct in_addr outside = { { { 172, 16, 0, 1 } } };
+
+	net8 = net_route_ipv4_add(iface, &net, 8, &nexthop1);
+	zassert_not_null(net8, "Cannot add route");
+
+	net16 = net_route_ipv4_add(iface, &subnet, 16, &nexthop2);
+	zassert_not_null(net16, "Cannot add route");
+
+	host = net_route_ipv4_add(iface, &dst, 32, NULL);
+	zassert_not_null(host, "Cannot add route");
+
+	zassert_equal_ptr(net_route_ipv4_lookup(&dst), host, "Wrong route");
+	zassert_equal_ptr(net_route_ipv4_lookup(&other), net8, "Wrong route");
+	zassert_is_null(net_route_ipv4_lookup(&outside), "Unexpected route");
+
+	zassert_equal_ptr(net_route_ipv4_get_nexthop(host, &dst), &dst,
+			  "Directly connected route has a nexthop");
+	zassert_true(net_ipv4_addr_cmp(net_route_ipv4_get_nexthop(net16, &dst),
+				       &nexthop2), "Wrong nexthop");
+
+	/* Adding the same prefix again updates the entry */
+	route = net_route_ipv4_add(iface, &net, 8, &nexthop2);
+	zassert_equal_ptr(route, net8, "Route not updated");
+	zassert_true(net_ipv4_addr_cmp(&net8->nexthop, &nexthop2),
+		     "Nexthop not updated");
+
+	zassert_true(net_route_ipv4_lookup_copy(&other, &copy), "No route");
+	zassert_true(net_ipv4_addr_cmp(&copy.nexthop, &nexthop2),
+		     "Stale route copy");
+
+	zassert_equal(net_route_ipv4_del(host), 0, "Cannot delete route");
+	zassert_equal_ptr(net_route_ipv4_lookup(&dst), net16, "Wrong route");
+
+	zassert_equal(net_route_ipv4_del(net16), 0, "Cannot delete route");
+	zassert_equal_ptr(net_route_ipv4_lookup(&dst), net8, "Wrong route");
+
+	zassert_equal(net_route_ipv4_del_by_iface(iface), 1,
+		      "Cannot delete routes");
+	zassert_is_null(net_route_ipv4_lookup(&dst), "Route not deleted");
+}
+
+static void route_del_cb(struct net_route_entry_ipv4 *entry, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	net_route_ipv4_del(entry);
+}
+
+struct route_match {
+	struct in_addr *addr;
+	struct net_route_entry_ipv4 *found;
+};
+
+/* Reference longest prefix match over the route entries */
+static void route_match_cb(struct net_route_entry_ipv4 *entry, void *user_data)
+{
+	struct route_match *match = user_data;
+
+	if (!is_prefix(entry->addr.s4_addr, match->addr->s4_addr,
+		       entry->prefix_len)) {
+		return;
+	}
+
+	if (!match->found || entry->prefix_len > match->found->prefix_len) {
+		match->found = entry;
+	}
+}
+
+static void bench_lookup_rate(int routes)
+{
+	struct route_match match;
+	struct net_if *iface = net_if_get_default();
+	struct net_route_entry_ipv4 *route;
+	struct in_addr addr;
+	uint32_t start, cycles, found = 0U;
+	int i, covered = 0;
+	uint8_t len;
+
+	for (i = 0; i < routes; i++) {
+		if (i < ARRAY_SIZE(bench_addr) / 2) {
+			/* Every other benchmark address hits this route */
+			random_addr(bench_addr[2 * i].s4_addr, sizeof(addr));
+			addr = bench_addr[2 * i];
+			len = 24U;
+			covered++;
+		} else {
+			/* Prefix lengths typically seen in a routing table */
+			random_addr(addr.s4_addr, sizeof(addr));
+			len = 8U + sys_rand32_get() % 25;
+		}
+
+		mask_prefix(addr.s4_addr, len, sizeof(addr));
+
+		route = net_route_ipv4_add(iface, &addr, len, &nexthop1);
+		zassert_not_null(route, "Cannot add route %d", i);
+	}
+
+	for (i = 2 * covered; i < ARRAY_SIZE(bench_addr); i++) {
+		random_addr(bench_addr[i].s4_addr, sizeof(addr));
+	}
+
+	for (i = 1; i < 2 * covered; i += 2) {
+		random_addr(bench_addr[i].s4_addr, sizeof(addr));
+	}
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		if (net_route_ipv4_lookup(
+			    &bench_addr[i % ARRAY_SIZE(bench_addr)])) {
+			found++;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	TC_PRINT("%5d routes: %d lookups in %llu us (%u hits)\n", routes,
+		 BENCH_LOOKUPS, k_cyc_to_us_floor64(cycles), found);
+
+	zassert_true(found >= covered * (BENCH_LOOKUPS / ARRAY_SIZE(bench_addr)),
+		     "Too few lookups hit a route");
+
+	/* The trie must agree with a scan of the whole table */
+	for (i = 0; i < ARRAY_SIZE(bench_addr); i++) {
+		match.addr = &bench_addr[i];
+		match.found = NULL;
+
+		net_route_ipv4_foreach(route_match_cb, &match);
+
+		zassert_equal_ptr(net_route_ipv4_lookup(&bench_addr[i]),
+				  match.found, "Wrong route for address %d", i);
+	}
+
+	net_route_ipv4_foreach(route_del_cb, NULL);
+}
+
+ZTEST(route_lpm_test_suite, test_lookup_rate)
+{
+	bench_lookup_rate(10);
+	bench_lookup_rate(1000);
+	bench_lookup_rate(10000);
+
+	zassert_equal(net_route_ipv4_foreach(route_del_cb, NULL), 0,
+		      "Routes left in the table");
+}
+
+ZTEST_SUITE(route_lpm_test_suite, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
+
+#include <stdio.h>
+#include <zephyr/ztest_assert.h>
+
+#include <zephyr/net/socket.h>
+#include <zephyr/net/socket_epoll.h>
+#include <zephyr/sys/fdtable.h>
+
+#include "../../socket_helpers.h"
+
+#define BUF_AND_SIZE(buf) buf, sizeof(buf) - 1
+#define STRLEN(buf) (sizeof(buf) - 1)
+
+#define TEST_STR_SMALL "test"
+
+#define SERVER_PORT 4242
+#define CLIENT_PORT 9898
+
+/* Number of sockets watched at the same time */
+#define NUM_SOCKS 6
+
+/* On QEMU, a wait takes +10ms from the requested time. */
+#define FUZZ 10
+
+static int epoll_add(int epfd, int fd, uint32_t events)
+{
+	struct epoll_event event = {
+		.events = events,
+		.data.fd = fd,
+	};
+
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
+}
+
+ZTEST(net_socket_epoll, test_epoll_udp)
+{
+	struct sockaddr_in6 c_addr;
+	struct sockaddr_in6 s_addr;
+	struct epoll_event events[2];
+	uint32_t tstamp;
+	int c_sock;
+	int s_sock;
+	int epfd;
+	ssize_t len;
+	char buf[10];
+	int res;
+
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, CLIENT_PORT,
+			    &c_sock, &c_addr);
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, SERVER_PORT,
+			    &s_sock, &s_addr);
+
+	res = bind(s_sock, (struct sockaddr *)&s_addr, sizeof(s_addr));
+	zassert_equal(res, 0, "bind failed");
+
+	res = connect(c_sock, (struct sockaddr *)&s_addr, sizeof(s_addr));
+	zassert_equal(res, 0, "connect failed");
+
+	epfd = epoll_create(1);
+	zassert_true(epfd >= 0, "epoll_create failed");
+
+	res = epoll_add(epfd, c_sock, EPOLLIN);
+	zassert_equal(res, 0, "epoll_ctl failed");
+	res = epoll_add(epfd, s_sock, EPOLLIN);
+	zassert_equal(res, 0, "epoll_ctl failed");
+
+	/* Wait with non-ready sockets and timeout of 0 */
+	tstamp = k_uptime_get_32();
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 0);
+	zassert_true(k_uptime_get_32() - tstamp <= FUZZ, "");
+	zassert_equal(res, 0, "");
+
+	/* Wait with non-ready sockets and timeout of 30 */
+	tstamp = k_uptime_get_32();
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 30);
+	tstamp = k_uptime_get_32() - tstamp;
+	zassert_true(tstamp >= 30U && tstamp <= 30 + FUZZ * 2, "tstamp %d",
+		     tstamp);
+	zassert_equal(res, 0, "");
+
+	/* Send pkt for s_sock, only it is reported */
+	len = send(c_sock, BUF_AND_SIZE(TEST_STR_SMALL), 0);
+	zassert_equal(len, STRLEN(TEST_STR_SMALL), "invalid send len");
+
+	tstamp = k_uptime_get_32();
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 30);
+	zassert_true(k_uptime_get_32() - tstamp <= FUZZ, "");
+	zassert_equal(res, 1, "");
+	zassert_equal(events[0].events, EPOLLIN, "");
+	zassert_equal(events[0].data.fd, s_sock, "");
+
+	/* Level triggered, reported until the data is read */
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 0);
+	zassert_equal(res, 1, "");
+	zassert_equal(events[0].data.fd, s_sock, "");
+
+	len = recv(s_sock, BUF_AND_SIZE(buf), 0);
+	zassert_equal(len, STRLEN(TEST_STR_SMALL), "invalid recv len");
+
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 0);
+	zassert_equal(res, 0, "");
+
+	/* UDP sockets are always writable */
+	events[0].events = EPOLLIN | EPOLLOUT;
+	events[0].data.fd = c_sock;
+	res = epoll_ctl(epfd, EPOLL_CTL_MOD, c_sock, &events[0]);
+	zassert_equal(res, 0, "");
+
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 0);
+	zassert_equal(res, 1, "");
+	zassert_equal(events[0].events, EPOLLOUT, "");
+	zassert_equal(events[0].data.fd, c_sock, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_DEL, c_sock, NULL);
+	zassert_equal(res, 0, "");
+
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 0);
+	zassert_equal(res, 0, "");
+
+	res = close(c_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(s_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(epfd);
+	zassert_equal(res, 0, "close failed");
+}
+
+ZTEST(net_socket_epoll, test_epoll_edge_oneshot)
+{
+	struct sockaddr_in6 c_addr;
+	struct sockaddr_in6 s_addr;
+	struct epoll_event event;
+	int c_sock;
+	int s_sock;
+	int epfd;
+	ssize_t len;
+	int res;
+
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, CLIENT_PORT,
+			    &c_sock, &c_addr);
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, SERVER_PORT,
+			    &s_sock, &s_addr);
+
+	res = bind(s_sock, (struct sockaddr *)&s_addr, sizeof(s_addr));
+	zassert_equal(res, 0, "bind failed");
+
+	res = connect(c_sock, (struct sockaddr *)&s_addr, sizeof(s_addr));
+	zassert_equal(res, 0, "connect failed");
+
+	epfd = epoll_create(1);
+	zassert_true(epfd >= 0, "epoll_create failed");
+
+	res = epoll_add(epfd, s_sock, EPOLLIN | EPOLLET);
+	zassert_equal(res, 0, "epoll_ctl failed");
+
+	/* Edge triggered, reported once per new datagram */
+	len = send(c_sock, BUF_AND_SIZE(TEST_STR_SMALL), 0);
+	zassert_equal(len, STRLEN(TEST_STR_SMALL), "invalid send len");
+
+	res = epoll_wait(epfd, &event, 1, 30);
+	zassert_equal(res, 1, "");
+	zassert_equal(event.events, EPOLLIN, "");
+
+	res = epoll_wait(epfd, &event, 1, 0);
+	zassert_equal(res, 0, "");
+
+	len = send(c_sock, BUF_AND_SIZE(TEST_STR_SMALL), 0);
+	zassert_equal(len, STRLEN(TEST_STR_SMALL), "invalid send len");
+
+	res = epoll_wait(epfd, &event, 1, 30);
+	zassert_equal(res, 1, "");
+
+	/* One shot, reported once until re-armed */
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.fd = s_sock;
+	res = epoll_ctl(epfd, EPOLL_CTL_MOD, s_sock, &event);
+	zassert_equal(res, 0, "");
+
+	res = epoll_wait(epfd, &event, 1, 0);
+	zassert_equal(res, 1, "");
+
+	len = send(c_sock, BUF_AND_SIZE(TEST_STR_SMALL), 0);
+	zassert_equal(len, STRLEN(TEST_STR_SMALL), "invalid send len");
+
+	res = epoll_wait(epfd, &event, 1, 30);
+	zassert_equal(res, 0, "");
+
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.fd = s_sock;
+	res = epoll_ctl(epfd, EPOLL_CTL_MOD, s_sock, &event);
+	zassert_equal(res, 0, "");
+
+	res = epoll_wait(epfd, &event, 1, 0);
+	zassert_equal(res, 1, "");
+	zassert_equal(event.data.fd, s_sock, "");
+
+	/* Closing the socket removes it from the interest list */
+	res = close(s_sock);
+	zassert_equal(res, 0, "close failed");
+
+	res = epoll_wait(epfd, &event, 1, 0);
+	zassert_equal(res, 0, "");
+
+	res = close(c_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(epfd);
+	zassert_equal(res, 0, "close failed");
+}
+
+ZTEST(net_socket_epoll, test_epoll_many)
+{
+	struct sockaddr_in6 c_addr;
+	struct sockaddr_in6 s_addr[NUM_SOCKS];
+	struct epoll_event events[NUM_SOCKS];
+	int s_sock[NUM_SOCKS];
+	int c_sock;
+	int epfd;
+	ssize_t len;
+	int res;
+	int i;
+
+	epfd = epoll_create(NUM_SOCKS);
+	zassert_true(epfd >= 0, "epoll_create failed");
+
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, CLIENT_PORT,
+			    &c_sock, &c_addr);
+
+	for (i = 0; i < NUM_SOCKS; i++) {
+		prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR,
+				    SERVER_PORT + i, &s_sock[i], &s_addr[i]);
+
+		res = bind(s_sock[i], (struct sockaddr *)&s_addr[i],
+			   sizeof(s_addr[i]));
+		zassert_equal(res, 0, "bind failed");
+
+		res = epoll_add(epfd, s_sock[i], EPOLLIN);
+		zassert_equal(res, 0, "epoll_ctl failed");
+	}
+
+	/* Only the sockets which received data are reported */
+	for (i = 1; i < NUM_SOCKS; i += 2) {
+		len = sendto(c_sock, BUF_AND_SIZE(TEST_STR_SMALL), 0,
+			     (struct sockaddr *)&s_addr[i], sizeof(s_addr[i]));
+		zassert_equal(len, STRLEN(TEST_STR_SMALL), "invalid send len");
+	}
+
+	k_msleep(10);
+
+	res = epoll_wait(epfd, events, ARRAY_SIZE(events), 0);
+	zassert_equal(res, NUM_SOCKS / 2, "");
+
+	for (i = 0; i < res; i++) {
+		zassert_equal(events[i].events, EPOLLIN, "");
+		zassert_equal(events[i].data.fd, s_sock[i * 2 + 1], "");
+	}
+
+	/* Level triggered sockets still ready are reported in turn */
+	res = epoll_wait(epfd, events, 1, 0);
+	zassert_equal(res, 1, "");
+	zassert_equal(events[0].data.fd, s_sock[1], "");
+
+	res = epoll_wait(epfd, events, 1, 0);
+	zassert_equal(res, 1, "");
+	zassert_equal(events[0].data.fd, s_sock[3], "");
+
+	for (i = 0; i < NUM_SOCKS; i++) {
+		res = close(s_sock[i]);
+		zassert_equal(res, 0, "close failed");
+	}
+
+	res = close(c_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(epfd);
+	zassert_equal(res, 0, "close failed");
+}
+
+#define TEST_SNDBUF_SIZE CONFIG_NET_TCP_MAX_RECV_WINDOW_SIZE
+
+ZTEST(net_socket_epoll, test_epoll_tcp)
+{
+	struct sockaddr_in6 c_addr;
+	struct sockaddr_in6 s_addr;
+	struct epoll_event event;
+	char buf[TEST_SNDBUF_SIZE] = { };
+	int new_sock;
+	int c_sock;
+	int s_sock;
+	int epfd;
+	int res;
+
+	prepare_sock_tcp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, CLIENT_PORT,
+			    &c_sock, &c_addr);
+	prepare_sock_tcp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, SERVER_PORT,
+			    &s_sock, &s_addr);
+
+	res = bind(s_sock, (struct sockaddr *)&s_addr, sizeof(s_addr));
+	zassert_equal(res, 0, "");
+	res = listen(s_sock, 0);
+	zassert_equal(res, 0, "");
+
+	epfd = epoll_create(1);
+	zassert_true(epfd >= 0, "epoll_create failed");
+
+	res = epoll_add(epfd, s_sock, EPOLLIN);
+	zassert_equal(res, 0, "epoll_ctl failed");
+
+	/* Incoming connection is reported on the listening socket */
+	res = connect(c_sock, (const struct sockaddr *)&s_addr,
+		      sizeof(s_addr));
+	zassert_equal(res, 0, "");
+
+	res = epoll_wait(epfd, &event, 1, 100);
+	zassert_equal(res, 1, "");
+	zassert_equal(event.events, EPOLLIN, "");
+	zassert_equal(event.data.fd, s_sock, "");
+
+	new_sock = accept(s_sock, NULL, NULL);
+	zassert_true(new_sock >= 0, "");
+
+	res = epoll_wait(epfd, &event, 1, 0);
+	zassert_equal(res, 0, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_DEL, s_sock, NULL);
+	zassert_equal(res, 0, "");
+
+	k_msleep(10);
+
+	/* EPOLLOUT is reported after connecting */
+	res = epoll_add(epfd, c_sock, EPOLLOUT);
+	zassert_equal(res, 0, "epoll_ctl failed");
+
+	res = epoll_wait(epfd, &event, 1, 10);
+	zassert_equal(res, 1, "");
+	zassert_equal(event.events, EPOLLOUT, "");
+
+	/* Not after filling the window */
+	res = send(c_sock, buf, sizeof(buf), 0);
+	zassert_equal(res, sizeof(buf), "");
+
+	res = epoll_wait(epfd, &event, 1, 10);
+	zassert_equal(res, 0, "%d", event.events);
+
+	/* Reported again once the server has consumed the data, the TCP
+	 * stack pushes the change to the epoll instance.
+	 */
+	res = recv(new_sock, buf, sizeof(buf), 0);
+	zassert_equal(res, sizeof(buf), "");
+
+	res = epoll_wait(epfd, &event, 1, 500);
+	zassert_equal(res, 1, "");
+	zassert_equal(event.events, EPOLLOUT, "");
+
+	k_msleep(10);
+
+	res = close(c_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(s_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(new_sock);
+	zassert_equal(res, 0, "close failed");
+	res = close(epfd);
+	zassert_equal(res, 0, "close failed");
+}
+
+ZTEST(net_socket_epoll, test_epoll_errors)
+{
+	struct sockaddr_in6 addr;
+	struct epoll_event event = { .events = EPOLLIN };
+	int sock;
+	int epfd;
+	int res;
+
+	res = epoll_create(0);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, EINVAL, "");
+
+	epfd = epoll_create(1);
+	zassert_true(epfd >= 0, "epoll_create failed");
+
+	/* Only one instance is configured */
+	res = epoll_create(1);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, ENOMEM, "");
+
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, CLIENT_PORT,
+			    &sock, &addr);
+
+	res = epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &event);
+	zassert_equal(res, 0, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &event);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, EEXIST, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_ADD, epfd, &event);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, EINVAL, "");
+
+	res = epoll_ctl(sock, EPOLL_CTL_ADD, epfd, &event);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, EINVAL, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_DEL, sock, NULL);
+	zassert_equal(res, 0, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_DEL, sock, NULL);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, ENOENT, "");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_MOD, sock, &event);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, ENOENT, "");
+
+	res = epoll_wait(epfd, &event, 0, 0);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, EINVAL, "");
+
+	res = close(sock);
+	zassert_equal(res, 0, "close failed");
+
+	res = epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &event);
+	zassert_equal(res, -1, "");
+	zassert_equal(errno, EBADF, "");
+
+	res = close(epfd);
+	zassert_equal(res, 0, "close failed");
+}
+
+ZTEST_SUITE(net_socket_epoll, NULL, NULL, NULL, NULL, NULL);
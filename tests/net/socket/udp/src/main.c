@@ -16,6 +16,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
 #include <zephyr/net/ethernet.h>
 
 #include "ipv6.h"
+#include "udp_internal.h"
 #include "../../socket_helpers.h"
 
 #if defined(CONFIG_NET_SOCKETS_LOG_LEVEL_DBG)
@@ -1008,9 +1009,111 @@ static int eth_fake_send(const struct device *dev, struct net_pkt *pkt)
 	return 0;
 }
 
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+#define BUSY_POLL_PORT 4243
+#define BUSY_POLL_OTHER_PORT 4244
+
+/* UDP datagram from PEER_IPV6_ADDR:1234 to MY_IPV6_ADDR:4243 */
+static const uint8_t busy_poll_frame[] = {
+	/* Ethernet, to the MAC address of the fake interface */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x02, 0x00, 0x5e, 0x00, 0x53, 0x02,
+	0x86, 0xdd,
+	/* IPv6 */
+	0x60, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x11, 0x40,
+	0x20, 0x01, 0x0d, 0xb8, 0x01, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+	0x20, 0x01, 0x0d, 0xb8, 0x01, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	/* UDP */
+	0x04, 0xd2, 0x10, 0x93, 0x00, 0x0c, 0xa5, 0x22,
+	't', 'e', 's', 't',
+};
+
+/* The same datagram to MY_IPV6_ADDR:4244, which nobody polls for */
+static const uint8_t busy_poll_other_frame[] = {
+	/* Ethernet, to the MAC address of the fake interface */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x02, 0x00, 0x5e, 0x00, 0x53, 0x02,
+	0x86, 0xdd,
+	/* IPv6 */
+	0x60, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x11, 0x40,
+	0x20, 0x01, 0x0d, 0xb8, 0x01, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+	0x20, 0x01, 0x0d, 0xb8, 0x01, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	/* UDP */
+	0x04, 0xd2, 0x10, 0x94, 0x00, 0x0c, 0xa5, 0x21,
+	't', 'e', 's', 't',
+};
+
+static bool busy_poll_pending;
+static k_tid_t busy_poll_thread;
+static k_tid_t busy_poll_other_thread;
+static K_SEM_DEFINE(busy_poll_other_recv, 0, 1);
+
+static int eth_fake_recv_frame(struct net_if *iface, const uint8_t *frame,
+			       size_t len)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface, len, AF_UNSPEC, 0,
+					   K_NO_WAIT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	zassert_ok(net_pkt_write(pkt, frame, len), "Cannot write pkt");
+
+	if (net_recv_data(iface, pkt) < 0) {
+		net_pkt_unref(pkt);
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Deliver the pending frames, if any, in the context of the poller */
+static int eth_fake_poll(const struct device *dev, int budget)
+{
+	struct eth_fake_context *ctx = dev->data;
+	int count;
+
+	zassert_true(budget > 1, "Invalid budget");
+
+	if (!busy_poll_pending) {
+		return 0;
+	}
+
+	busy_poll_pending = false;
+	busy_poll_thread = k_current_get();
+
+	count = eth_fake_recv_frame(ctx->iface, busy_poll_other_frame,
+				    sizeof(busy_poll_other_frame));
+	count += eth_fake_recv_frame(ctx->iface, busy_poll_frame,
+				     sizeof(busy_poll_frame));
+
+	return count;
+}
+
+static enum net_verdict busy_poll_other_cb(struct net_conn *conn,
+					   struct net_pkt *pkt,
+					   union net_ip_header *ip_hdr,
+					   union net_proto_header *proto_hdr,
+					   void *user_data)
+{
+	busy_poll_other_thread = k_current_get();
+	net_pkt_unref(pkt);
+	k_sem_give(&busy_poll_other_recv);
+
+	return NET_OK;
+}
+#endif /* CONFIG_NET_CONTEXT_BUSY_POLL */
+
 static struct ethernet_api eth_fake_api_funcs = {
 	.iface_api.init = eth_fake_iface_init,
 	.send = eth_fake_send,
+#if defined(CONFIG_NET_CONTEXT_BUSY_POLL)
+	.poll = eth_fake_poll,
+#endif
 };
 
 static int eth_fake_init(const struct device *dev)
@@ -1129,6 +1232,88 @@ void test_v6_sendmsg_with_txtime(void)
 	test_started = false;
 }
 
+void test_so_busy_poll(void)
+{
+	struct sockaddr_in6 addr;
+	struct timeval rcvtimeo = {
+		.tv_sec = 1,
+		.tv_usec = 0,
+	};
+	struct net_conn_handle *handle;
+	socklen_t optlen;
+	int sock, rv, optval;
+
+	prepare_sock_udp_v6(MY_IPV6_ADDR, BUSY_POLL_PORT, &sock, &addr);
+
+	rv = net_udp_register(AF_INET6, NULL, NULL, 0, BUSY_POLL_OTHER_PORT,
+			      NULL, busy_poll_other_cb, NULL, &handle);
+	zassert_equal(rv, 0, "Cannot register UDP handler");
+
+	rv = bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+	zassert_equal(rv, 0, "bind failed");
+
+	optval = -1;
+	rv = setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &optval,
+			sizeof(optval));
+	zassert_equal(rv, -1, "negative busy poll time accepted");
+	zassert_equal(errno, EINVAL, "incorrect errno value");
+
+	optval = 100000;
+	rv = setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &optval,
+			sizeof(optval));
+	zassert_equal(rv, 0, "setsockopt failed (%d)", errno);
+
+	optval = 0;
+	optlen = sizeof(optval);
+	rv = getsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &optval, &optlen);
+	zassert_equal(rv, 0, "getsockopt failed (%d)", errno);
+	zassert_equal(optval, 100000, "invalid busy poll time");
+
+	rv = setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &rcvtimeo,
+			sizeof(rcvtimeo));
+	zassert_equal(rv, 0, "setsockopt failed (%d)", errno);
+
+	/* The frames only show up when the driver is polled */
+	busy_poll_thread = NULL;
+	busy_poll_other_thread = NULL;
+	k_sem_reset(&busy_poll_other_recv);
+	busy_poll_pending = true;
+
+	clear_buf(rx_buf);
+	rv = recv(sock, rx_buf, sizeof(rx_buf), 0);
+	zassert_equal(rv, STRLEN(TEST_STR_SMALL), "recv failed (%d)", errno);
+	zassert_mem_equal(rx_buf, BUF_AND_SIZE(TEST_STR_SMALL),
+			  "invalid rx data");
+	zassert_equal(busy_poll_thread, k_current_get(),
+		      "driver not polled by the receiving thread");
+
+	/* The frame for another port is left to the RX queue */
+	rv = k_sem_take(&busy_poll_other_recv, K_SECONDS(1));
+	zassert_equal(rv, 0, "other frame not received");
+	zassert_not_equal(busy_poll_other_thread, k_current_get(),
+			  "other frame processed by the polling thread");
+
+	/* Without busy polling the frame stays in the driver */
+	optval = 0;
+	rv = setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &optval,
+			sizeof(optval));
+	zassert_equal(rv, 0, "setsockopt failed (%d)", errno);
+
+	busy_poll_pending = true;
+
+	rv = recv(sock, rx_buf, sizeof(rx_buf), 0);
+	zassert_equal(rv, -1, "unexpected data received");
+	zassert_equal(errno, EAGAIN, "incorrect errno value");
+
+	busy_poll_pending = false;
+
+	rv = net_udp_unregister(handle);
+	zassert_equal(rv, 0, "Cannot unregister UDP handler");
+
+	rv = close(sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
 void test_msg_trunc(int sock_c, int sock_s, struct sockaddr *addr_c,
 		    socklen_t addrlen_c, struct sockaddr *addr_s,
 		    socklen_t addrlen_s)
@@ -1363,6 +1548,7 @@ void test_main(void)
 			 ztest_unit_test(test_setup_eth),
 			 ztest_unit_test(test_v6_sendmsg_with_txtime),
 			 ztest_user_unit_test(test_v6_sendmsg_with_txtime),
+			 ztest_unit_test(test_so_busy_poll),
 			 ztest_unit_test(test_v4_msg_trunc),
 			 ztest_unit_test(test_v6_msg_trunc),
 			 ztest_unit_test(test_v4_dgram_overflow),
@@ -12,6 +12,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_WEBSOCKET_LOG_LEVEL);
 #include <zephyr/net/net_ip.h>
 #include <zephyr/net/socket.h>
 #include <zephyr/net/websocket.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "websocket_internal.h"
 
@@ -269,12 +270,19 @@ static void test_recv_two_msg(void)
 	test_recv_2(sizeof(frame1) + FRAME1_HDR_SIZE / 2);
 }
 
-int verify_sent_and_received_msg(struct msghdr *msg, bool split_msg)
+/* An empty ping frame followed by frame1 */
+static const unsigned char ping_frame[] = {
+	0x89, 0x00,
+	0x81, 0x8c, 0xe1, 0x7e, 0x8e, 0xb9, 0x95, 0x1b,
+	0xfd, 0xcd, 0xc1, 0x13, 0xeb, 0xca, 0x92, 0x1f,
+	0xe9, 0xdc
+};
+
+static void test_recv_empty_ping(void)
 {
-	static struct websocket_context ctx;
+	struct websocket_context ctx;
 	uint32_t msg_type = -1;
 	uint64_t remaining = -1;
-	size_t split_len = 0, total_read = 0;
 	int ret;
 
 	memset(&ctx, 0, sizeof(ctx));
@@ -282,54 +290,97 @@ int verify_sent_and_received_msg(struct msghdr *msg, bool split_msg)
 	ctx.tmp_buf = temp_recv_buf;
 	ctx.tmp_buf_len = sizeof(temp_recv_buf);
 
-	/* Read first the header */
-	ret = test_recv_buf(msg->msg_iov[0].iov_base,
-			    msg->msg_iov[0].iov_len,
-			    &ctx, &msg_type, &remaining,
+	memcpy(feed_buf, ping_frame, sizeof(ping_frame));
+
+	/* A frame without payload is not mistaken for a closed connection */
+	ret = test_recv_buf(feed_buf, sizeof(ping_frame), &ctx, &msg_type,
+			    &remaining, recv_buf, sizeof(recv_buf));
+	zassert_equal(ret, -EAGAIN, "Empty frame returned %d", ret);
+	zassert_true(msg_type & WEBSOCKET_FLAG_PING, "Ping not reported");
+	zassert_equal(remaining, 0, "Empty frame has data remaining");
+
+	/* The data frame after it is received normally */
+	ret = test_recv_buf(feed_buf, 0, &ctx, &msg_type, &remaining,
 			    recv_buf, sizeof(recv_buf));
-	zassert_equal(ret, -EAGAIN, "Msg header not found");
+	zassert_equal(ret, sizeof(frame1_msg) - 1, "Cannot read data (%d)",
+		      ret);
+	zassert_true(msg_type & WEBSOCKET_FLAG_TEXT, "Text not reported");
+	zassert_equal(remaining, 0, "Data remaining");
+	zassert_mem_equal(recv_buf, frame1_msg, sizeof(frame1_msg) - 1,
+			  "Invalid message");
+}
 
-	/* Then the first split if it is enabled */
-	if (split_msg) {
-		split_len = msg->msg_iov[1].iov_len / 2;
+/* Amount of the sent message that has been received and verified */
+static size_t verified_len;
 
-		ret = test_recv_buf(msg->msg_iov[1].iov_base,
-				    split_len,
+int verify_sent_and_received_msg(struct msghdr *msg, bool split_msg)
+{
+	static struct websocket_context ctx;
+	uint8_t *data = msg->msg_iov[1].iov_base;
+	size_t data_len = msg->msg_iov[1].iov_len;
+	uint32_t msg_type = -1;
+	uint64_t remaining = -1;
+	size_t split_len, data_read = 0;
+	int ret;
+
+	/* A masked message is sent in several parts, the header is sent
+	 * with the first one.
+	 */
+	if (msg->msg_iov[0].iov_len > 0) {
+		memset(&ctx, 0, sizeof(ctx));
+
+		ctx.tmp_buf = temp_recv_buf;
+		ctx.tmp_buf_len = sizeof(temp_recv_buf);
+
+		verified_len = 0;
+
+		/* Read first the header */
+		ret = test_recv_buf(msg->msg_iov[0].iov_base,
+				    msg->msg_iov[0].iov_len,
 				    &ctx, &msg_type, &remaining,
 				    recv_buf, sizeof(recv_buf));
-		zassert_true(ret > 0, "Cannot read data (%d)", ret);
-
-		total_read = ret;
+		zassert_equal(ret, -EAGAIN, "Msg header not found");
 	}
 
+	/* Feed first only half of the data if the split is enabled */
+	split_len = split_msg ? data_len / 2 : data_len;
+
 	/* Then the data */
-	while (remaining > 0) {
-		ret = test_recv_buf((uint8_t *)msg->msg_iov[1].iov_base +
-								total_read,
-				    msg->msg_iov[1].iov_len - total_read,
+	while (data_read < data_len) {
+		ret = test_recv_buf(data + data_read,
+				    MIN(split_len, data_len - data_read),
 				    &ctx, &msg_type, &remaining,
 				    recv_buf, sizeof(recv_buf));
 		zassert_true(ret > 0, "Cannot read data (%d)", ret);
 
-		if (memcmp(recv_buf, lorem_ipsum + total_read, ret) != 0) {
-			LOG_HEXDUMP_ERR(lorem_ipsum + total_read, ret,
+		if (memcmp(recv_buf, lorem_ipsum + verified_len, ret) != 0) {
+			LOG_HEXDUMP_ERR(lorem_ipsum + verified_len, ret,
 					"Received message should be");
 			LOG_HEXDUMP_ERR(recv_buf, ret, "but it was instead");
 			zassert_true(false, "Invalid received message "
-				     "after %d bytes", total_read);
+				     "after %zd bytes", verified_len);
 		}
 
-		total_read += ret;
+		data_read += ret;
+		verified_len += ret;
+		split_len = data_len;
 	}
 
-	zassert_equal(total_read, test_msg_len,
-		      "Msg body not valid, received %d instead of %zd",
-		      total_read, test_msg_len);
+	zassert_true(verified_len <= test_msg_len,
+		     "Msg body not valid, received %zd instead of %zd",
+		     verified_len, test_msg_len);
+
+	/* The whole message has been received with the last part */
+	if (remaining == 0) {
+		zassert_equal(verified_len, test_msg_len,
+			      "Msg body not valid, received %zd instead of %zd",
+			      verified_len, test_msg_len);
+	}
 
 	NET_DBG("Received %zd header and %zd body",
-		msg->msg_iov[0].iov_len, total_read);
+		msg->msg_iov[0].iov_len, data_len);
 
-	return msg->msg_iov[0].iov_len + total_read;
+	return msg->msg_iov[0].iov_len + data_len;
 }
 
 static void test_send_and_recv_lorem_ipsum(void)
@@ -351,6 +402,9 @@ static void test_send_and_recv_lorem_ipsum(void)
 	zassert_equal(ret, test_msg_len,
 		      "Should have sent %zd bytes but sent %d instead",
 		      test_msg_len, ret);
+	zassert_equal(verified_len, test_msg_len,
+		      "Received %zd bytes instead of %zd", verified_len,
+		      test_msg_len);
 }
 
 static void test_recv_two_large_split_msg(void)
@@ -371,6 +425,166 @@ static void test_recv_two_large_split_msg(void)
 	zassert_equal(ret, test_msg_len,
 		      "1st should have sent %zd bytes but sent %d instead",
 		      test_msg_len, ret);
+	zassert_equal(verified_len, test_msg_len,
+		      "Received %zd bytes instead of %zd", verified_len,
+		      test_msg_len);
+}
+
+static void mask_bytes(uint8_t *dst, const uint8_t *src, size_t len,
+		       uint32_t mask, size_t offset)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		dst[i] = src[i] ^ (uint8_t)(mask >> (8 * (3 - (offset + i) % 4)));
+	}
+}
+
+#define MASK_TEST_LEN 40
+#define MASK_TEST_ALIGN 8
+
+static void test_mask(void)
+{
+	static uint8_t src[MASK_TEST_LEN + MASK_TEST_ALIGN];
+	static uint8_t dst[MASK_TEST_LEN + MASK_TEST_ALIGN];
+	static uint8_t expected[MASK_TEST_LEN];
+	const uint32_t mask = 0xe17e8eb9;
+	size_t len, offset;
+	int src_align, dst_align;
+
+	memcpy(src, lorem_ipsum, sizeof(src));
+
+	for (len = 0; len <= MASK_TEST_LEN; len++) {
+		for (offset = 0; offset < 4; offset++) {
+			for (src_align = 0; src_align < MASK_TEST_ALIGN;
+			     src_align++) {
+				mask_bytes(expected, &src[src_align], len,
+					   mask, offset);
+
+				for (dst_align = 0; dst_align < MASK_TEST_ALIGN;
+				     dst_align++) {
+					websocket_mask(&dst[dst_align],
+						       &src[src_align], len,
+						       mask, offset);
+					zassert_mem_equal(&dst[dst_align],
+							  expected, len,
+							  "Invalid mask, len %zd "
+							  "offset %zd", len,
+							  offset);
+				}
+
+				/* Unmasking in place gives back the data */
+				memcpy(&dst[src_align], expected, len);
+				websocket_mask(&dst[src_align],
+					       &dst[src_align], len, mask,
+					       offset);
+				zassert_mem_equal(&dst[src_align],
+						  &src[src_align], len,
+						  "Invalid unmask, len %zd", len);
+			}
+		}
+	}
+}
+
+#define BENCH_PAYLOAD_LEN 1024
+#define BENCH_HDR_LEN 8
+#define BENCH_FRAMES 1024
+
+static uint8_t bench_frame[BENCH_HDR_LEN + BENCH_PAYLOAD_LEN];
+static uint8_t bench_expected[BENCH_PAYLOAD_LEN];
+
+static void print_throughput(const char *name, uint32_t cycles)
+{
+	TC_PRINT("%s: %u bytes in %llu us\n", name,
+		 BENCH_PAYLOAD_LEN * BENCH_FRAMES, k_cyc_to_us_floor64(cycles));
+}
+
+static void test_mask_throughput(void)
+{
+	const uint32_t mask = 0xe17e8eb9;
+	uint32_t start, cycles;
+	int i;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCH_FRAMES; i++) {
+		mask_bytes(recv_buf, lorem_ipsum, BENCH_PAYLOAD_LEN, mask, i);
+	}
+
+	cycles = k_cycle_get_32() - start;
+	print_throughput("byte-wise mask", cycles);
+
+	memcpy(bench_expected, recv_buf, sizeof(bench_expected));
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCH_FRAMES; i++) {
+		websocket_mask(recv_buf, lorem_ipsum, BENCH_PAYLOAD_LEN, mask,
+			       i);
+	}
+
+	cycles = k_cycle_get_32() - start;
+	print_throughput("word-wide mask", cycles);
+
+	zassert_mem_equal(recv_buf, bench_expected, sizeof(bench_expected),
+			  "Word-wide mask differs from the byte-wise one");
+}
+
+static void test_recv_throughput(void)
+{
+	static struct websocket_context ctx;
+	static struct test_data test_data;
+	uint32_t msg_type, start, cycles;
+	uint64_t remaining;
+	size_t received = 0;
+	int ret, i;
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	ctx.tmp_buf = temp_recv_buf;
+	ctx.tmp_buf_len = sizeof(temp_recv_buf);
+
+	/* Masked binary frame with a 16-bit payload length */
+	bench_frame[0] = 0x82;
+	bench_frame[1] = 0x80 | 126;
+	sys_put_be16(BENCH_PAYLOAD_LEN, &bench_frame[2]);
+	sys_put_be32(0xe17e8eb9, &bench_frame[4]);
+	mask_bytes(&bench_frame[BENCH_HDR_LEN], lorem_ipsum, BENCH_PAYLOAD_LEN,
+		   0xe17e8eb9, 0);
+
+	test_data.ctx = &ctx;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < BENCH_FRAMES; i++) {
+		test_data.input_buf = bench_frame;
+		test_data.input_len = sizeof(bench_frame);
+
+		do {
+			ret = websocket_recv_msg(POINTER_TO_INT(&test_data),
+						 recv_buf, sizeof(recv_buf),
+						 &msg_type, &remaining, 0);
+			if (ret == -EAGAIN) {
+				continue;
+			}
+
+			zassert_true(ret > 0, "Cannot read data (%d)", ret);
+			zassert_mem_equal(recv_buf,
+					  &lorem_ipsum[received %
+						       BENCH_PAYLOAD_LEN],
+					  ret, "Invalid payload at %zd",
+					  received);
+			received += ret;
+		} while (test_data.input_len > 0 ||
+			 ctx.tmp_buf_pos > ctx.tmp_buf_start);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	zassert_equal(received, BENCH_PAYLOAD_LEN * BENCH_FRAMES,
+		      "Received %zd bytes", received);
+
+	print_throughput("receive", cycles);
 }
 
 void test_main(void)
@@ -389,8 +603,12 @@ void test_main(void)
 			 ztest_unit_test(test_recv_12_byte),
 			 ztest_unit_test(test_recv_whole_msg),
 			 ztest_unit_test(test_recv_two_msg),
+			 ztest_unit_test(test_recv_empty_ping),
 			 ztest_unit_test(test_send_and_recv_lorem_ipsum),
-			 ztest_unit_test(test_recv_two_large_split_msg)
+			 ztest_unit_test(test_recv_two_large_split_msg),
+			 ztest_unit_test(test_mask),
+			 ztest_unit_test(test_mask_throughput),
+			 ztest_unit_test(test_recv_throughput)
 		);
 
 	ztest_run_test_suite(websocket);
@@ -0,0 +1,374 @@
+/* main.c - Traffic class flow steering tests */
+
+/*
+ * Copyright (c) 2022 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_TC_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/random/rand32.h>
+
+#include <zephyr/ztest.h>
+
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/dummy.h>
+#include <zephyr/net/net_ip.h>
+#include <zephyr/net/net_if.h>
+
+#include "net_private.h"
+#include "ipv4.h"
+#include "udp_internal.h"
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+#define MY_PORT 4242
+#define PEER_PORT_BASE 1000
+
+#define FLOWS 8
+#define PKTS_PER_FLOW 32
+
+/* Packets sent in the scaling benchmark, and the processing time of
+ * each of them in the receiver.
+ */
+#define BENCH_PKTS 512
+#define BENCH_WORK_US 50
+
+#define ALLOC_TIMEOUT K_MSEC(500)
+#define WAIT_TIME K_SECONDS(5)
+
+struct flow_payload {
+	uint32_t flow;
+	uint32_t counter;
+};
+
+struct flow_state {
+	uint32_t next_counter;
+	uint32_t hash;
+	int queue;
+};
+
+static struct net_if *iface1;
+static struct net_conn_handle *handle;
+
+static struct flow_state flows[FLOWS];
+static atomic_t queues_used;
+static bool test_failed;
+static uint32_t work_us;
+static struct k_sem recv_data;
+
+struct net_if_test {
+	uint8_t mac_addr[sizeof(struct net_eth_addr)];
+};
+
+static int net_iface_dev_init(const struct device *dev)
+{
+	return 0;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	struct net_if_test *data = net_if_get_device(iface)->data;
+
+	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
+	data->mac_addr[0] = 0x00;
+	data->mac_addr[1] = 0x00;
+	data->mac_addr[2] = 0x5E;
+	data->mac_addr[3] = 0x00;
+	data->mac_addr[4] = 0x53;
+	data->mac_addr[5] = sys_rand32_get();
+
+	net_if_set_link_addr(iface, data->mac_addr, sizeof(data->mac_addr),
+			     NET_LINK_ETHERNET);
+}
+
+static int sender_iface(const struct device *dev, struct net_pkt *pkt)
+{
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+struct net_if_test net_iface1_data;
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+NET_DEVICE_INIT_INSTANCE(net_iface1_test,
+			 "iface1",
+			 iface1,
+			 net_iface_dev_init,
+			 NULL,
+			 &net_iface1_data,
+			 NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+			 &net_iface_api,
+			 DUMMY_L2,
+			 NET_L2_GET_CTX_TYPE(DUMMY_L2),
+			 NET_ETH_MTU);
+
+/* The packets of one flow are only seen by one RX queue thread, so the
+ * flow state needs no locking.
+ */
+static enum net_verdict udp_data_received(struct net_conn *conn,
+					  struct net_pkt *pkt,
+					  union net_ip_header *ip_hdr,
+					  union net_proto_header *proto_hdr,
+					  void *user_data)
+{
+	struct flow_payload payload;
+	struct flow_state *flow;
+	int queue = net_tc_rx_current();
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, NET_IPV4UDPH_LEN) ||
+	    net_pkt_read(pkt, &payload, sizeof(payload)) ||
+	    payload.flow >= FLOWS || queue < 0) {
+		test_failed = true;
+		goto out;
+	}
+
+	flow = &flows[payload.flow];
+
+	if (flow->queue < 0) {
+		flow->queue = queue;
+		flow->hash = net_pkt_flow_hash(pkt);
+	} else if (flow->queue != queue) {
+		NET_DBG("Flow %u moved from queue %d to %d", payload.flow,
+			flow->queue, queue);
+		test_failed = true;
+	} else if (flow->hash != net_pkt_flow_hash(pkt)) {
+		NET_DBG("Flow %u hash changed", payload.flow);
+		test_failed = true;
+	}
+
+	if (payload.counter != flow->next_counter) {
+		NET_DBG("Flow %u pkt %u received, expected %u", payload.flow,
+			payload.counter, flow->next_counter);
+		test_failed = true;
+	}
+
+	flow->next_counter = payload.counter + 1U;
+
+	atomic_set_bit(&queues_used, queue);
+
+	if (work_us) {
+		k_busy_wait(work_us);
+	}
+
+out:
+	net_pkt_unref(pkt);
+	k_sem_give(&recv_data);
+
+	return NET_OK;
+}
+
+static void send_pkt(uint32_t flow, uint32_t counter, uint32_t hash)
+{
+	struct flow_payload payload = {
+		.flow = flow,
+		.counter = counter,
+	};
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface1, NET_IPV4UDPH_LEN +
+					   sizeof(payload), AF_INET,
+					   IPPROTO_UDP, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate pkt");
+
+	net_pkt_set_ipv4_ttl(pkt, 64);
+
+	ret = net_ipv4_create(pkt, &peer_addr, &my_addr);
+	zassert_equal(ret, 0, "IPv4 header append failed");
+
+	ret = net_udp_create(pkt, htons(PEER_PORT_BASE + flow),
+			     htons(MY_PORT));
+	zassert_equal(ret, 0, "UDP header append failed");
+
+	ret = net_pkt_write(pkt, &payload, sizeof(payload));
+	zassert_equal(ret, 0, "Cannot append data");
+
+	net_pkt_cursor_init(pkt);
+	net_ipv4_finalize(pkt, IPPROTO_UDP);
+	net_pkt_cursor_init(pkt);
+
+	/* Like a driver providing the hash calculated by the hardware */
+	net_pkt_set_flow_hash(pkt, hash);
+
+	ret = net_recv_data(iface1, pkt);
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+		zassert_equal(ret, 0, "Cannot receive pkt");
+	}
+}
+
+static void flows_reset(void)
+{
+	int i;
+
+	for (i = 0; i < FLOWS; i++) {
+		flows[i].next_counter = 0U;
+		flows[i].hash = 0U;
+		flows[i].queue = -1;
+	}
+
+	atomic_clear(&queues_used);
+	test_failed = false;
+	k_sem_reset(&recv_data);
+}
+
+static void wait_pkts(int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(k_sem_take(&recv_data, WAIT_TIME), 0,
+			      "Timeout while waiting pkt %d", i);
+	}
+}
+
+/* Send the packets of the flows interleaved. If hash is set, flow i gets
+ * hash + i like if the driver had calculated it.
+ */
+static void send_flows(int nb_flows, int pkts_per_flow, uint32_t hash)
+{
+	int i, j;
+
+	for (j = 0; j < pkts_per_flow; j++) {
+		for (i = 0; i < nb_flows; i++) {
+			send_pkt(i, j, hash ? hash + i : 0U);
+		}
+	}
+}
+
+ZTEST(net_tc_flow, test_flow_order)
+{
+	atomic_val_t all_queues = BIT_MASK(NET_TC_FLOW_QUEUES);
+	int i, j;
+
+	flows_reset();
+
+	send_flows(FLOWS, PKTS_PER_FLOW, 0U);
+	wait_pkts(FLOWS * PKTS_PER_FLOW);
+
+	zassert_false(test_failed, "Flow order or steering failed");
+
+	for (i = 0; i < FLOWS; i++) {
+		zassert_equal(flows[i].next_counter, PKTS_PER_FLOW,
+			      "Flow %d lost pkts", i);
+		zassert_not_equal(flows[i].hash, 0U, "Flow %d not hashed", i);
+
+		/* The test flows are known not to collide */
+		for (j = 0; j < i; j++) {
+			zassert_not_equal(flows[i].hash, flows[j].hash,
+					  "Flows %d and %d share hash", i, j);
+		}
+	}
+
+	/* The ports of the test flows are known to spread evenly */
+	zassert_equal(atomic_get(&queues_used), all_queues,
+		      "Not all the queues were used (0x%lx)",
+		      atomic_get(&queues_used));
+}
+
+ZTEST(net_tc_flow, test_flow_driver_hash)
+{
+	uint32_t hash = NET_TC_FLOW_QUEUES * 0x100U;
+	int i;
+
+	flows_reset();
+
+	/* The hash from the driver is used as is */
+	send_flows(FLOWS, 4, hash);
+	wait_pkts(FLOWS * 4);
+
+	zassert_false(test_failed, "Flow order or steering failed");
+
+	for (i = 0; i < FLOWS; i++) {
+		zassert_equal(flows[i].hash, hash + i, "Driver hash changed");
+		zassert_equal(flows[i].queue, (hash + i) % NET_TC_FLOW_QUEUES,
+			      "Flow %d not in the queue of its hash", i);
+	}
+}
+
+static uint32_t bench_run(int nb_flows)
+{
+	int64_t start;
+	uint32_t elapsed;
+
+	flows_reset();
+	work_us = BENCH_WORK_US;
+
+	start = k_uptime_get();
+
+	send_flows(nb_flows, BENCH_PKTS / nb_flows, 0U);
+	wait_pkts(BENCH_PKTS);
+
+	elapsed = (uint32_t)(k_uptime_get() - start);
+	work_us = 0U;
+
+	zassert_false(test_failed, "Flow order or steering failed");
+
+	return elapsed;
+}
+
+/* Compare one flow, served by one queue, to flows spread to all the
+ * queues. The flow queues only scale if they run on several CPUs.
+ */
+ZTEST(net_tc_flow, test_flow_scaling)
+{
+	uint32_t single, multi;
+
+	if (CONFIG_MP_NUM_CPUS < 2) {
+		ztest_test_skip();
+	}
+
+	single = bench_run(1);
+	multi = bench_run(FLOWS);
+
+	TC_PRINT("%d pkts, 1 flow %u ms, %d flows %u ms (%u CPUs)\n",
+		 BENCH_PKTS, single, FLOWS, multi, CONFIG_MP_NUM_CPUS);
+
+	zassert_true(multi < single, "No scaling with several flows");
+}
+
+static void *test_setup(void)
+{
+	struct sockaddr local_addr = { 0 };
+	struct net_if_addr *ifaddr;
+	int ret;
+
+	k_sem_init(&recv_data, 0, UINT_MAX);
+
+	iface1 = net_if_get_first_by_type(&NET_L2_GET_NAME(DUMMY));
+	zassert_not_null(iface1, "Interface 1");
+
+	ifaddr = net_if_ipv4_addr_add(iface1, &my_addr, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "addr1");
+
+	net_if_up(iface1);
+
+	net_ipaddr_copy(&net_sin(&local_addr)->sin_addr, &my_addr);
+	local_addr.sa_family = AF_INET;
+
+	ret = net_udp_register(AF_INET, NULL, &local_addr, 0, MY_PORT, NULL,
+			       udp_data_received, NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register UDP handler");
+
+	return NULL;
+}
+
+ZTEST_SUITE(net_tc_flow, NULL, test_setup, NULL, NULL, NULL);
@@ -31,6 +31,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_TCP_LOG_LEVEL);
 #include "ipv6.h"
 #include "tcp.h"
 #include "tcp_private.h"
+#include "tcp_internal.h"
 #include "net_stats.h"
 
 #include <zephyr/ztest.h>
@@ -125,6 +126,8 @@ static void handle_syn_resend(void);
 static void handle_client_fin_wait_2_test(sa_family_t af, struct tcphdr *th);
 static void handle_client_closing_test(sa_family_t af, struct tcphdr *th);
 static void handle_server_recv_out_of_order(struct net_pkt *pkt);
+static void handle_client_keepalive_test(sa_family_t af, struct tcphdr *th);
+static void handle_server_time_wait_test(sa_family_t af, struct tcphdr *th);
 
 static void verify_flags(struct tcphdr *th, uint8_t flags,
 			 const char *fun, int line)
@@ -420,6 +423,12 @@ static int tester_send(const struct device *dev, struct net_pkt *pkt)
 	case 9:
 		handle_server_recv_out_of_order(pkt);
 		break;
+	case 10:
+		handle_client_keepalive_test(net_pkt_family(pkt), &th);
+		break;
+	case 11:
+		handle_server_time_wait_test(net_pkt_family(pkt), &th);
+		break;
 	default:
 		zassert_true(false, "Undefined test case");
 	}
@@ -1484,6 +1493,347 @@ static void test_server_timeout_out_of_order_data(void)
 	net_tcp_put(ooo_ctx);
 }
 
+#define KEEPALIVE_CNT 2
+
+static int keepalive_probes;
+
+static void handle_client_keepalive_test(sa_family_t af, struct tcphdr *th)
+{
+	struct net_pkt *reply;
+	int ret;
+
+	switch (t_state) {
+	case T_SYN:
+		test_verify_flags(th, SYN);
+		seq = 0U;
+		ack = ntohs(th->th_seq) + 1U;
+		reply = prepare_syn_ack_packet(af, htons(MY_PORT),
+					       th->th_sport);
+		t_state = T_SYN_ACK;
+		break;
+	case T_SYN_ACK:
+		test_verify_flags(th, ACK);
+		/* connection is success */
+		t_state = T_DATA;
+		test_sem_give();
+		return;
+	case T_DATA:
+		/* The peer never answers the probes, so the connection is
+		 * reset after the last one.
+		 */
+		if (th->th_flags & RST) {
+			zassert_equal(keepalive_probes, KEEPALIVE_CNT,
+				      "Unexpected number of probes (%d)",
+				      keepalive_probes);
+			test_sem_give();
+			return;
+		}
+
+		test_verify_flags(th, ACK);
+		keepalive_probes++;
+		return;
+	default:
+		zassert_true(false, "%s unexpected state", __func__);
+		return;
+	}
+
+	ret = net_recv_data(iface, reply);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	return;
+fail:
+	zassert_true(false, "%s failed", __func__);
+}
+
+/* Test case scenario IPv4
+ *   send SYN,
+ *   expect SYN ACK,
+ *   send ACK,
+ *   enable keep-alive with a short idle time,
+ *   expect keep-alive probes and do not answer them,
+ *   expect RST after the last probe.
+ *   any failures cause test case to fail.
+ */
+static void test_client_keepalive_ipv4(void)
+{
+	struct net_context *ctx;
+	uint32_t probes_before, timeouts_before;
+	int keepalive = 1, idle = 1, intvl = 1, cnt = KEEPALIVE_CNT;
+	int val = 0;
+	size_t len = sizeof(val);
+	int ret;
+
+	t_state = T_SYN;
+	test_case_no = 10;
+	seq = ack = 0;
+	keepalive_probes = 0;
+
+	probes_before = GET_STAT(iface, tcp.keepalive);
+	timeouts_before = GET_STAT(iface, tcp.conntimeout);
+
+	ret = net_context_get(AF_INET, SOCK_STREAM, IPPROTO_TCP, &ctx);
+	if (ret < 0) {
+		zassert_true(false, "Failed to get net_context");
+	}
+
+	net_context_ref(ctx);
+
+	ret = net_context_connect(ctx, (struct sockaddr *)&peer_addr_s,
+				  sizeof(struct sockaddr_in),
+				  NULL,
+				  K_MSEC(100), NULL);
+	if (ret < 0) {
+		zassert_true(false, "Failed to connect to peer");
+	}
+
+	/* Peer will release the semaphore after it receives
+	 * proper ACK to SYN | ACK
+	 */
+	test_sem_take(K_MSEC(100), __LINE__);
+
+	ret = net_tcp_set_option(ctx, TCP_OPT_KEEPIDLE, &idle, sizeof(idle));
+	zassert_equal(ret, 0, "Cannot set the idle time (%d)", ret);
+
+	ret = net_tcp_set_option(ctx, TCP_OPT_KEEPINTVL, &intvl,
+				 sizeof(intvl));
+	zassert_equal(ret, 0, "Cannot set the interval (%d)", ret);
+
+	ret = net_tcp_set_option(ctx, TCP_OPT_KEEPCNT, &cnt, sizeof(cnt));
+	zassert_equal(ret, 0, "Cannot set the probe count (%d)", ret);
+
+	ret = net_tcp_set_option(ctx, TCP_OPT_KEEPALIVE, &keepalive,
+				 sizeof(keepalive));
+	zassert_equal(ret, 0, "Cannot enable keep-alive (%d)", ret);
+
+	ret = net_tcp_get_option(ctx, TCP_OPT_KEEPCNT, &val, &len);
+	zassert_equal(ret, 0, "Cannot get the probe count (%d)", ret);
+	zassert_equal(val, KEEPALIVE_CNT, "Invalid probe count (%d)", val);
+
+	cnt = 0;
+	ret = net_tcp_set_option(ctx, TCP_OPT_KEEPCNT, &cnt, sizeof(cnt));
+	zassert_equal(ret, -EINVAL, "Invalid probe count accepted (%d)", ret);
+
+	/* Peer will release the semaphore after it receives the RST, the
+	 * idle time and the probes take around 3 seconds.
+	 */
+	test_sem_take(K_MSEC(5000), __LINE__);
+
+	zassert_equal(GET_STAT(iface, tcp.keepalive) - probes_before,
+		      KEEPALIVE_CNT, "Invalid keep-alive stats");
+	zassert_equal(GET_STAT(iface, tcp.conntimeout) - timeouts_before,
+		      1, "Invalid connection timeout stats");
+
+	net_context_put(ctx);
+}
+
+static uint16_t time_wait_peer_port;
+static struct net_context *time_wait_ctx;
+
+static void handle_server_time_wait_test(sa_family_t af, struct tcphdr *th)
+{
+	struct net_pkt *reply;
+	int ret;
+
+	switch (t_state) {
+	case T_SYN_ACK:
+		test_verify_flags(th, SYN | ACK);
+		seq++;
+		ack = ntohl(th->th_seq) + 1U;
+		reply = prepare_ack_packet(af, htons(time_wait_peer_port),
+					   htons(MY_PORT));
+		t_state = T_FIN;
+		break;
+	case T_FIN:
+		test_verify_flags(th, FIN | ACK);
+		ack = ntohl(th->th_seq) + 1U;
+		reply = prepare_fin_ack_packet(af, htons(time_wait_peer_port),
+					       htons(MY_PORT));
+		t_state = T_FIN_ACK;
+		break;
+	case T_FIN_ACK:
+		/* Also the ACK of a retransmitted FIN */
+		test_verify_flags(th, ACK);
+		test_sem_give();
+		return;
+	default:
+		zassert_true(false, "%s unexpected state", __func__);
+		return;
+	}
+
+	ret = net_recv_data(iface, reply);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	return;
+fail:
+	zassert_true(false, "%s failed", __func__);
+}
+
+static void test_time_wait_accept_cb(struct net_context *ctx,
+				     struct sockaddr *addr,
+				     socklen_t addrlen,
+				     int status,
+				     void *user_data)
+{
+	if (status) {
+		zassert_true(false, "failed to accept the conn");
+	}
+
+	ctx->recv_cb = test_tcp_recv_cb;
+	time_wait_ctx = ctx;
+
+	test_sem_give();
+}
+
+/* The peer connects from the given port, or reuses its TIME_WAIT one */
+static void time_wait_connect(uint16_t peer_port, uint32_t peer_seq)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	t_state = T_SYN_ACK;
+	time_wait_peer_port = peer_port;
+	seq = peer_seq;
+
+	pkt = prepare_syn_packet(AF_INET, htons(peer_port), htons(MY_PORT));
+	zassert_not_null(pkt, "Cannot prepare SYN");
+
+	ret = net_recv_data(iface, pkt);
+	zassert_equal(ret, 0, "Cannot receive SYN (%d)", ret);
+
+	/* test_time_wait_accept_cb will release the semaphore after
+	 * successful connection.
+	 */
+	test_sem_take(K_MSEC(100), __LINE__);
+}
+
+/* We close first so that our end of the connection enters TIME_WAIT */
+static void time_wait_close(void)
+{
+	net_context_put(time_wait_ctx);
+
+	/* Peer will release the semaphore after it receives the ACK of
+	 * its FIN.
+	 */
+	test_sem_take(K_MSEC(100), __LINE__);
+
+	/* Let the stack finish entering TIME_WAIT state */
+	k_sleep(K_MSEC(10));
+}
+
+/* Test case scenario IPv4
+ *   expect SYN ACK to SYN, send ACK,
+ *   close, expect FIN ACK, send FIN ACK, expect ACK,
+ *   expect the connection to be released and a TIME_WAIT entry kept,
+ *   send FIN ACK again, expect ACK from the TIME_WAIT entry,
+ *   send SYN with a higher sequence number from the same port,
+ *   expect the TIME_WAIT entry to be reused for a new connection,
+ *   with all the entries in use, expect a closed connection to be kept
+ *   in TIME_WAIT state.
+ *   any failures cause test case to fail.
+ */
+static void test_server_time_wait_compact_ipv4(void)
+{
+#if defined(CONFIG_NET_TCP_TIME_WAIT_COMPACT)
+	struct net_tcp_footprint fp_before, fp;
+	struct net_context *ctx;
+	struct net_pkt *pkt;
+	int ret;
+
+	test_case_no = 11;
+	ack = 0U;
+
+	ret = net_context_get(AF_INET, SOCK_STREAM, IPPROTO_TCP, &ctx);
+	if (ret < 0) {
+		zassert_true(false, "Failed to get net_context");
+	}
+
+	ret = net_context_bind(ctx, (struct sockaddr *)&my_addr_s,
+			       sizeof(struct sockaddr_in));
+	if (ret < 0) {
+		zassert_true(false, "Failed to bind net_context");
+	}
+
+	ret = net_context_listen(ctx, 1);
+	if (ret < 0) {
+		zassert_true(false, "Failed to listen on net_context");
+	}
+
+	ret = net_context_accept(ctx, test_time_wait_accept_cb, K_FOREVER,
+				 NULL);
+	if (ret < 0) {
+		zassert_true(false, "Failed to set accept on net_context");
+	}
+
+	time_wait_connect(PEER_PORT, 0U);
+
+	net_tcp_footprint_get(&fp_before);
+	zassert_equal(fp_before.time_wait_count, 0, "TIME_WAIT entry in use");
+
+	time_wait_close();
+
+	/* The connection is released, only the entry is left */
+	net_tcp_footprint_get(&fp);
+	zassert_equal(fp.time_wait_size, sizeof(struct tcp_time_wait),
+		      "Invalid TIME_WAIT entry size");
+	zassert_true(fp.time_wait_size < fp.conn_size,
+		     "TIME_WAIT entry not smaller than a connection");
+	zassert_equal(fp.time_wait_count, 1, "No TIME_WAIT entry");
+	zassert_equal(fp.conn_count, fp_before.conn_count - 1,
+		      "Connection not released");
+
+	/* A retransmitted FIN is acknowledged by the entry */
+	pkt = prepare_fin_ack_packet(AF_INET, htons(PEER_PORT),
+				     htons(MY_PORT));
+	zassert_not_null(pkt, "Cannot prepare FIN ACK");
+
+	ret = net_recv_data(iface, pkt);
+	zassert_equal(ret, 0, "Cannot receive FIN ACK (%d)", ret);
+
+	test_sem_take(K_MSEC(100), __LINE__);
+
+	/* A SYN which does not overlap the old connection takes over */
+	time_wait_connect(PEER_PORT, seq + 1000U);
+
+	net_tcp_footprint_get(&fp);
+	zassert_equal(fp.time_wait_count, 0, "TIME_WAIT entry not reused");
+	zassert_equal(fp.conn_count, fp_before.conn_count,
+		      "No new connection");
+
+	time_wait_close();
+
+	net_tcp_footprint_get(&fp);
+	zassert_equal(fp.time_wait_count, 1, "No TIME_WAIT entry");
+
+	/* With all the entries in use, the connection itself stays in
+	 * TIME_WAIT state. The test variant only has one entry.
+	 */
+	time_wait_connect(PEER_PORT + 1, 0U);
+	time_wait_close();
+
+	net_tcp_footprint_get(&fp);
+	zassert_equal(fp.time_wait_count, CONFIG_NET_TCP_TIME_WAIT_COUNT,
+		      "Invalid TIME_WAIT entry count");
+	zassert_equal(fp.conn_count, fp_before.conn_count,
+		      "Connection released without a TIME_WAIT entry");
+
+	/* Both the entry and the connection time out */
+	k_sleep(K_MSEC(2 * CONFIG_NET_TCP_TIME_WAIT_DELAY));
+
+	net_tcp_footprint_get(&fp);
+	zassert_equal(fp.time_wait_count, 0, "TIME_WAIT entry not expired");
+	zassert_equal(fp.conn_count, fp_before.conn_count - 1,
+		      "TIME_WAIT connection not released");
+
+	net_context_put(ctx);
+#else
+	ztest_test_skip();
+#endif
+}
+
 /** Test case main entry */
 void test_main(void)
 {
@@ -1499,7 +1849,9 @@ void test_main(void)
 			 ztest_unit_test(test_client_closing_ipv6),
 			 ztest_unit_test(test_client_invalid_rst),
 			 ztest_unit_test(test_server_recv_out_of_order_data),
-			 ztest_unit_test(test_server_timeout_out_of_order_data)
+			 ztest_unit_test(test_server_timeout_out_of_order_data),
+			 ztest_unit_test(test_client_keepalive_ipv4),
+			 ztest_unit_test(test_server_time_wait_compact_ipv4)
 			 );
 
 	ztest_run_test_suite(test_tcp_fn);